@@ -47,7 +47,7 @@ using pws_os::CUUID;
 
 Command::Command(CommandInterface *pcomInt)
 :  m_pcomInt(pcomInt), m_bSaveDBChanged(false), m_bUniqueGTUValidated(false),
-m_bNotifyGUI(true), m_RC(0), m_bState(false)
+m_bNotifyGUI(true), m_bSaveState(true), m_RC(0), m_bState(false)
 {
 }
 
@@ -58,6 +58,9 @@ Command::~Command()
 // Save/restore state
 void Command::SaveState()
 {
+  if (!m_bSaveState)
+    return;
+
   m_bSaveDBChanged = m_pcomInt->IsChanged();
   m_bUniqueGTUValidated = m_pcomInt->GetUniqueGTUValidated();
   m_saved_vnodes_modified = m_pcomInt->GetVnodesModified();
@@ -65,6 +68,9 @@ void Command::SaveState()
 
 void Command::RestoreState()
 {
+  if (!m_bSaveState)
+    return;
+
   m_pcomInt->SetDBChanged(m_bSaveDBChanged);
   m_pcomInt->SetUniqueGTUValidated(m_bUniqueGTUValidated);
   m_pcomInt->SetVnodesModified(m_saved_vnodes_modified);
@@ -90,6 +96,11 @@ MultiCommands::~MultiCommands()
 
 int MultiCommands::Execute()
 {
+  // Saved here rather than by each command, as only the state before the
+  // first is restored on Undo, and copying the changed groups for each of
+  // thousands of commands (e.g., a Merge) takes quadratic time and space
+  SaveState();
+
   std::vector<Command *>::iterator cmd_Iter;
 
   for (cmd_Iter = m_vpcmds.begin(); cmd_Iter != m_vpcmds.end(); cmd_Iter++) {
@@ -113,12 +124,14 @@ void MultiCommands::Undo()
       (*cmd_rIter)->Undo();
   }
 
+  RestoreState();
   m_bState = false;
 }
 
 void MultiCommands::Add(Command *pcmd)
 {
   ASSERT(pcmd != NULL);
+  pcmd->SetNoSaveState();
   m_vpcmds.push_back(pcmd);
 }
 
@@ -127,6 +140,7 @@ void MultiCommands::Insert(Command *pcmd)
   // VERY INEFFICIENT - use sparingly to add commands at the front of the
   // multi-command vector
   ASSERT(pcmd != NULL);
+  pcmd->SetNoSaveState();
   m_vpcmds.insert(m_vpcmds.begin(), pcmd);
 }
 
@@ -179,6 +193,16 @@ bool MultiCommands::GetRC(const size_t ncmd, int &rc)
   }
 }
 
+size_t MultiCommands::GetMemorySize() const
+{
+  size_t size = sizeof(*this) + m_vRCs.capacity() * sizeof(int);
+  std::vector<Command *>::const_iterator cmd_Iter;
+  for (cmd_Iter = m_vpcmds.begin(); cmd_Iter != m_vpcmds.end(); cmd_Iter++) {
+    size += (*cmd_Iter)->GetMemorySize();
+  }
+  return size;
+}
+
 void MultiCommands::ResetSavedState(bool bNewDBState)
 {
   Command::ResetSavedState(bNewDBState);
@@ -489,6 +513,11 @@ AddEntryCommand::~AddEntryCommand()
 {
 }
 
+size_t AddEntryCommand::GetMemorySize() const
+{
+  return sizeof(*this) + m_ci.GetSize();
+}
+
 int AddEntryCommand::Execute()
 {
   SaveState();
@@ -583,6 +612,16 @@ DeleteEntryCommand::~DeleteEntryCommand()
 {
 }
 
+size_t DeleteEntryCommand::GetMemorySize() const
+{
+  size_t size = sizeof(*this) + m_ci.GetSize();
+  std::vector<CItemData>::const_iterator iter;
+  for (iter = m_dependents.begin(); iter != m_dependents.end(); iter++) {
+    size += sizeof(CItemData) + iter->GetSize();
+  }
+  return size;
+}
+
 int DeleteEntryCommand::Execute()
 {
   SaveState();
@@ -664,6 +703,11 @@ EditEntryCommand::~EditEntryCommand()
 {
 }
 
+size_t EditEntryCommand::GetMemorySize() const
+{
+  return sizeof(*this) + m_old_ci.GetSize() + m_new_ci.GetSize();
+}
+
 int EditEntryCommand::Execute()
 {
   SaveState();
@@ -735,6 +779,7 @@ void UpdateEntryCommand::Doit(const CUUID &entry_uuid,
 
   ItemListIter pos = m_pcomInt->Find(entry_uuid);
   if (pos != m_pcomInt->GetEntryEndIter()) {
+    const CItemData old_ci(pos->second); // cheap, field data is shared
     if (ftype != CItemData::PASSWORD)
       pos->second.SetFieldValue(ftype, value);
     else {
@@ -748,6 +793,7 @@ void UpdateEntryCommand::Doit(const CUUID &entry_uuid,
         pos->second.SetPWHistory(m_oldpwhistory);
       }
     }
+    m_pcomInt->ReindexEntry(old_ci, pos->second);
     if (ftype == CItemData::PASSWORD ||
         ftype == CItemData::XTIME)
       m_pcomInt->UpdateExpiryEntry(pos->second);
@@ -811,7 +857,9 @@ int UpdatePasswordCommand::Execute()
 
   ItemListIter pos = m_pcomInt->Find(m_entry_uuid);
   if (pos != m_pcomInt->GetEntryEndIter()) {
+    const CItemData old_ci(pos->second);
     pos->second.UpdatePassword(m_sxNewPassword);
+    m_pcomInt->ReindexEntry(old_ci, pos->second);
     time_t tttNewXTime;
     pos->second.GetXTime(tttNewXTime);
     if (m_tttOldXTime != tttNewXTime) {
@@ -837,10 +885,12 @@ void UpdatePasswordCommand::Undo()
 
   ItemListIter pos = m_pcomInt->Find(m_entry_uuid);
   if (pos != m_pcomInt->GetEntryEndIter()) {
+    const CItemData old_ci(pos->second);
     pos->second.SetPassword(m_sxOldPassword);
     pos->second.SetPWHistory(m_sxOldPWHistory);
     pos->second.SetStatus(m_old_status);
     pos->second.SetXTime(m_tttOldXTime);
+    m_pcomInt->ReindexEntry(old_ci, pos->second);
   }
 
   RestoreState();
@@ -908,6 +958,21 @@ AddDependentEntriesCommand::~AddDependentEntriesCommand()
   delete m_pmapSaveStatus;
 }
 
+size_t AddDependentEntriesCommand::GetMemorySize() const
+{
+  size_t size = sizeof(*this) +
+                m_dependentslist.size() * sizeof(pws_os::CUUID);
+  ItemListConstIter iter;
+  for (iter = m_pmapDeletedItems->begin(); iter != m_pmapDeletedItems->end(); iter++) {
+    size += sizeof(ItemList_Pair) + iter->second.GetSize();
+  }
+  SaveTypePWMap::const_iterator stiter;
+  for (stiter = m_pmapSaveStatus->begin(); stiter != m_pmapSaveStatus->end(); stiter++) {
+    size += sizeof(SaveTypePWMap_Pair) + stiter->second.sxpw.length() * sizeof(TCHAR);
+  }
+  return size;
+}
+
 int AddDependentEntriesCommand::Execute()
 {
   SaveState();
@@ -1028,6 +1093,16 @@ UpdatePasswordHistoryCommand::UpdatePasswordHistoryCommand(CommandInterface *pco
  : Command(pcomInt), m_iAction(iAction), m_new_default_max(new_default_max)
 {}
 
+size_t UpdatePasswordHistoryCommand::GetMemorySize() const
+{
+  size_t size = sizeof(*this);
+  SavePWHistoryMap::const_iterator iter;
+  for (iter = m_mapSavedHistory.begin(); iter != m_mapSavedHistory.end(); iter++) {
+    size += sizeof(*iter) + iter->second.pwh.length() * sizeof(TCHAR);
+  }
+  return size;
+}
+
 int UpdatePasswordHistoryCommand::Execute()
 {
   SaveState();
@@ -1067,7 +1142,13 @@ int RenameGroupCommand::Execute()
   if (m_pcomInt->IsReadOnly())
     return 0;
 
+  // Only the entries under the group are changed, so only they need
+  // refreshing in the GUI
+  UUIDVector vuuids;
+  m_pcomInt->GetGroupEntries(m_sxOldPath, vuuids);
+
   int rc = m_pcomInt->DoRenameGroup(m_sxOldPath, m_sxNewPath);
+  NotifyGUI(vuuids);
   m_bState = true;
   return rc;
 }
@@ -1077,7 +1158,21 @@ void RenameGroupCommand::Undo()
   if (m_pcomInt->IsReadOnly())
     return;
 
+  UUIDVector vuuids;
+  m_pcomInt->GetGroupEntries(m_sxNewPath, vuuids);
+
   m_pcomInt->UndoRenameGroup(m_sxOldPath, m_sxNewPath);
   RestoreState();
+  NotifyGUI(vuuids);
   m_bState = false;
 }
+
+void RenameGroupCommand::NotifyGUI(const UUIDVector &vuuids)
+{
+  if (!m_bNotifyGUI)
+    return;
+
+  for (size_t i = 0; i < vuuids.size(); i++)
+    m_pcomInt->NotifyGUINeedsUpdating(UpdateGUICommand::GUI_REFRESH_ENTRYFIELD,
+                                      vuuids[i], CItemData::GROUP);
+}
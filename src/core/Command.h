@@ -42,9 +42,16 @@ public:
   virtual void Undo() = 0;
 
   void SetNoGUINotify() {m_bNotifyGUI = false;}
+  // For commands in a MultiCommands, which saves and restores the state
+  // once for all of them
+  void SetNoSaveState() {m_bSaveState = false;}
   virtual void ResetSavedState(bool bNewDBState) // overrode in MultiCommands
   {m_bSaveDBChanged = bNewDBState;}
   bool GetGUINotify() const {return m_bNotifyGUI;}
+  // Approximate heap footprint, used to cap the size of the undo list.
+  // Field data shared between entry copies is counted by each holder,
+  // so this errs on the high side.
+  virtual size_t GetMemorySize() const {return sizeof(*this);}
 
 protected:
   Command(CommandInterface *pcomInt); // protected constructor!
@@ -56,6 +63,7 @@ protected:
   bool m_bSaveDBChanged;
   bool m_bUniqueGTUValidated;
   bool m_bNotifyGUI;
+  bool m_bSaveState;
   int m_RC;
   bool m_bState;
 
@@ -208,6 +216,7 @@ public:
   ~AddEntryCommand();
   int Execute();
   void Undo();
+  size_t GetMemorySize() const;
   friend class DeleteEntryCommand; // allow access to c'tor
 
 private:
@@ -230,6 +239,7 @@ public:
   ~DeleteEntryCommand();
   int Execute();
   void Undo();
+  size_t GetMemorySize() const;
   friend class AddEntryCommand; // allow access to c'tor
 
 private:
@@ -251,6 +261,7 @@ public:
   ~EditEntryCommand();
   int Execute();
   void Undo();
+  size_t GetMemorySize() const;
 
 private:
   EditEntryCommand(CommandInterface *pcomInt, const CItemData &old_ci,
@@ -340,6 +351,7 @@ public:
   ~AddDependentEntriesCommand();
   int Execute();
   void Undo();
+  size_t GetMemorySize() const;
 
 private:
   AddDependentEntriesCommand(CommandInterface *pcomInt,
@@ -417,6 +429,7 @@ public:
                                             new_default_max); }
   int Execute();
   void Undo();
+  size_t GetMemorySize() const;
 
 private:
   UpdatePasswordHistoryCommand(CommandInterface *pcomInt, int iAction,
@@ -438,6 +451,8 @@ public:
 private:
   RenameGroupCommand(CommandInterface *pcomInt,
                      StringX sxOldPath, StringX sxNewPath);
+  // Tells the GUI the entries' groups changed
+  void NotifyGUI(const UUIDVector &vuuids);
 
    StringX m_sxOldPath, m_sxNewPath;
 };
@@ -460,6 +475,7 @@ public:
   bool GetRC(const size_t ncmd, int &rc);
   std::size_t GetSize() const {return m_vpcmds.size();}
   void ResetSavedState(bool bNewDBState);
+  size_t GetMemorySize() const;
 
  private:
   MultiCommands(CommandInterface *pcomInt);
@@ -69,6 +69,8 @@ class CommandInterface {
 
   virtual int DoRenameGroup(const StringX &sxOldPath, const StringX &sxNewPath) = 0;
   virtual void UndoRenameGroup(const StringX &sxOldPath, const StringX &sxNewPath) = 0;
+  // Entries in the group or any of its subgroups
+  virtual void GetGroupEntries(const StringX &sxPath, UUIDVector &vuuids) = 0;
 
   virtual const std::vector<StringX> &GetVnodesModified() const = 0;
   virtual void SetVnodesModified(const std::vector<StringX> &) = 0;
@@ -95,6 +97,10 @@ class CommandInterface {
                                  const StringX &value) = 0;
   virtual void RemoveExpiryEntry(const CItemData &ci) = 0;
 
+  // Called after an entry's searchable text (see CItemData::ContainsText)
+  // was changed in place
+  virtual void ReindexEntry(const CItemData &old_ci, const CItemData &new_ci) = 0;
+
   virtual const PSWDPolicyMap &GetPasswordPolicies() = 0;
   virtual void SetPasswordPolicies(const PSWDPolicyMap &MapPSWDPLC) = 0;
   virtual void AddPolicy(const StringX &sxPolicyName, const PWPolicy &st_pp,
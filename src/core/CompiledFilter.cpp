@@ -0,0 +1,689 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+// CompiledFilter.cpp
+//-----------------------------------------------------------------------------
+
+#include "CompiledFilter.h"
+#include "LocalTime.h"
+#include "PWHistory.h"
+#include "PWPolicy.h"
+
+#include "os/debug.h"
+#include "os/funcwrap.h"
+
+#include <algorithm>
+#include <limits>
+
+using namespace PWSMatch;
+
+namespace {
+  const int64 MIN_VALUE = std::numeric_limits<int64>::min();
+  const int64 MAX_VALUE = std::numeric_limits<int64>::max();
+
+  // Relative costs of the tests, to order them
+  enum {COST_ENTRY = 1,    // entry type, status...
+        COST_FIELD = 2,    // lookup & decode of a numeric field
+        COST_SIZE = 3,     // sum of all field lengths
+        COST_STRING = 4,   // compare with the start or end
+        COST_SEARCH = 5,   // search the whole string
+        COST_CHARS = 6,    // search the whole string for each character
+        COST_PATTERN = 6,  // run a pattern's DFA over the whole string
+        COST_GROUPTITLE = 2, // extra, to build Group.Title
+        COST_HISTORY = 8,  // extra, to decode the password history
+        COST_PROGRAM = 10  // running a history/policy program
+  };
+
+  inline bool IsPolicyField(int field)
+  {
+    return field > PT_PRESENT && field < PT_END;
+  }
+};
+
+// Orders the tests of a group
+struct CheaperTest {
+  template<class T> bool operator()(const T &t1, const T &t2) const
+  {
+    if (t1.cost != t2.cost)
+      return t1.cost < t2.cost;
+    // A test is more likely to fail, ending the group, if it's not negated
+    return !t1.bNegate && t2.bNegate;
+  }
+};
+
+CCompiledFilter::Test::Test()
+  : op(OP_FALSE), field(FT_INVALID), rule(MR_INVALID),
+    bNegate(false), bUnsetFails(false), bCase(false), bBase(false),
+    cost(COST_ENTRY), lo(MIN_VALUE), hi(MAX_VALUE), match(0), group_end(0)
+{
+}
+
+struct CCompiledFilter::Context {
+  Context(const CItemData &a_ci, const CItemData &a_pwentry)
+    : ci(a_ci), pwentry(a_pwentry),
+      bGroupTitle(false), bHistory(false), bPolicy(false),
+      bHistoryActive(false), historyMax(0), pHistory(NULL)
+  {}
+
+  const CItemData &Entry(const Test &test) const
+  {return test.bBase ? pwentry : ci;}
+
+  const StringX &GroupTitle()
+  {
+    if (!bGroupTitle) {
+      sxGroupTitle = ci.GetGroup() + TCHAR('.') + ci.GetTitle();
+      bGroupTitle = true;
+    }
+    return sxGroupTitle;
+  }
+
+  void LoadHistory()
+  {
+    if (!bHistory) {
+      size_t num_err;
+      bHistoryActive = pwentry.GetPWHistoryStatus(historyMax, num_err);
+      pHistory = &pwentry.GetPWHistoryPasswords();
+      bHistory = true;
+    }
+  }
+
+  const PWPolicy &Policy()
+  {
+    if (!bPolicy) {
+      pwentry.GetPWPolicy(policy);
+      bPolicy = true;
+    }
+    return policy;
+  }
+
+  const CItemData &ci;
+  const CItemData &pwentry; // holds the password: ci or its alias' base
+  bool bGroupTitle, bHistory, bPolicy;
+  StringX sxGroupTitle;
+  bool bHistoryActive;
+  size_t historyMax;
+  const PWHistPasswords *pHistory; // pwentry's, not copied
+  PWPolicy policy;
+
+private:
+  Context &operator=(const Context &); // Do not implement
+};
+
+CCompiledFilter::CCompiledFilter()
+  : m_bTimeDependent(false)
+{
+}
+
+CCompiledFilter::CCompiledFilter(const st_filters &filters, time_t now)
+  : m_bTimeDependent(false)
+{
+  Compile(filters, now);
+}
+
+void CCompiledFilter::Clear()
+{
+  m_main.clear();
+  m_history.clear();
+  m_policy.clear();
+  m_matches.clear();
+  m_bTimeDependent = false;
+}
+
+void CCompiledFilter::Compile(const st_filters &filters, time_t now)
+{
+  Clear();
+  if (now == time_t(0))
+    time(&now);
+
+  // Sub-programs first, so that rows referring to empty ones are skipped
+  CompileRows(filters.vHfldata, m_history, now);
+  CompileRows(filters.vPfldata, m_policy, now);
+  CompileRows(filters.vMfldata, m_main, now);
+}
+
+void CCompiledFilter::CompileRows(const vFilterRows &rows, Program &program,
+                                  time_t now)
+{
+  std::vector<Program> groups;
+  std::vector<std::pair<int, size_t> > group_costs; // cost, index
+  Program group;
+  bool bFirst(true), bGroupFails(false), bAnyFails(false);
+
+  vFilterRows::const_iterator iter;
+  for (iter = rows.begin(); ; iter++) {
+    const bool bEnd = iter == rows.end();
+    if (!bEnd && !iter->bFilterActive)
+      continue;
+
+    // An "Or" (or the end) closes the current group
+    if (bEnd || (iter->ltype == LC_OR && !bFirst)) {
+      if (bGroupFails)
+        bAnyFails = true;
+      else if (group.empty()) {
+        // None of its rows restricts anything, so every entry passes
+        if (!bFirst) {
+          program.clear();
+          return;
+        }
+      } else {
+        std::stable_sort(group.begin(), group.end(), CheaperTest());
+        int cost(0);
+        for (size_t i = 0; i < group.size(); i++)
+          cost += group[i].cost;
+        group_costs.push_back(std::make_pair(cost, groups.size()));
+        groups.push_back(group);
+      }
+      group.clear();
+      bGroupFails = false;
+      if (bEnd)
+        break;
+    }
+    bFirst = false;
+
+    Test test;
+    if (!CompileRow(*iter, test, now))
+      continue; // doesn't restrict anything
+    if (test.op == OP_FALSE)
+      bGroupFails = true;
+    else
+      group.push_back(test);
+  }
+
+  program.clear();
+  if (groups.empty()) {
+    // Every group had a test that can't pass, so nothing can
+    if (bAnyFails) {
+      program.push_back(Test());
+      program.back().group_end = 1;
+    }
+    return;
+  }
+
+  // Cheapest groups first: any one passing ends the test
+  std::sort(group_costs.begin(), group_costs.end());
+  for (size_t g = 0; g < group_costs.size(); g++) {
+    const Program &sorted_group = groups[group_costs[g].second];
+    const size_t group_end = program.size() + sorted_group.size();
+    for (size_t i = 0; i < sorted_group.size(); i++) {
+      program.push_back(sorted_group[i]);
+      program.back().group_end = group_end;
+    }
+  }
+}
+
+bool CCompiledFilter::CompileRow(const st_FilterRow &row, Test &test, time_t now)
+{
+  test.field = row.ftype;
+  const int iFunction = row.rule;
+
+  switch (row.mtype) {
+    case MT_PASSWORD:
+      test.bBase = true;
+      if (iFunction == MR_EXPIRED) {
+        // As CItemData::IsExpired()
+        test.field = FT_XTIME;
+        test.bUnsetFails = true;
+        test.cost = COST_FIELD;
+        CompileNumber(MR_LT, now, 0, test);
+        m_bTimeDependent = true;
+        break;
+      } else if (iFunction == MR_WILLEXPIRE) {
+        // As CItemData::WillExpire()
+        struct tm st;
+        time_t exptime(now);
+        if (localtime_s(&st, &now) == 0) {
+          st.tm_mday += row.fnum1;
+          exptime = mktime(&st);
+          if (exptime == time_t(-1))
+            exptime = now;
+        }
+        test.field = FT_XTIME;
+        test.bUnsetFails = true;
+        test.cost = COST_FIELD;
+        CompileNumber(MR_BETWEEN, int64(now) + 1, int64(exptime) - 1, test);
+        m_bTimeDependent = true;
+        break;
+      }
+      // Note: purposeful drop through to standard 'string' processing
+    case MT_STRING:
+      CompileString(row, test);
+      break;
+    case MT_INTEGER:
+      // Unset fails, as in CItemData::Matches(), or, for policy
+      // fields, no policy. History counts are taken as they are.
+      test.bUnsetFails = test.field < HT_PRESENT || IsPolicyField(test.field);
+      test.bBase = test.field == FT_PASSWORDLEN;
+      test.cost = test.field < HT_PRESENT ? COST_FIELD : COST_ENTRY;
+      CompileNumber(iFunction, row.fnum1, row.fnum2, test);
+      break;
+    case MT_ENTRYSIZE:
+    {
+      const int64 unit = row.funit > 0 ? int64(1) << (10 * row.funit) : 1;
+      test.bUnsetFails = true;
+      test.cost = COST_SIZE;
+      CompileNumber(iFunction, row.fnum1 * unit, row.fnum2 * unit, test);
+      break;
+    }
+    case MT_DATE:
+      CompileDate(row, test, now);
+      break;
+    case MT_BOOL:
+      if (test.field == PT_EASYVISION || test.field == PT_HEXADECIMAL) {
+        // PWPolicy has no such flags, so they're never set: the row
+        // is a constant, resolved here rather than tested per entry
+        if (Match(false, iFunction))
+          return false;
+        test.op = OP_FALSE;
+        break;
+      }
+      test.cost = (test.field == FT_KBSHORTCUT) ? COST_FIELD : COST_ENTRY;
+      CompileBool(iFunction, test);
+      break;
+    case MT_ENTRYTYPE:
+    case MT_DCA:
+    case MT_SHIFTDCA:
+    case MT_ENTRYSTATUS:
+    {
+      const int64 value = (row.mtype == MT_ENTRYTYPE) ? int64(row.etype) :
+                          (row.mtype == MT_ENTRYSTATUS) ? int64(row.estatus) :
+                          int64(row.fdca);
+      if (row.mtype == MT_DCA || row.mtype == MT_SHIFTDCA) {
+        test.field = (row.mtype == MT_DCA) ? FT_DCA : FT_SHIFTDCA;
+        test.cost = COST_FIELD;
+      }
+      if (iFunction == MR_IS)
+        CompileNumber(MR_EQUALS, value, 0, test);
+      else if (iFunction == MR_ISNOT)
+        CompileNumber(MR_NOTEQUAL, value, 0, test);
+      else {
+        ASSERT(0);
+        test.op = OP_FALSE;
+      }
+      break;
+    }
+    case MT_PWHIST:
+      if (m_history.empty())
+        return false;
+      test.op = OP_HISTORY;
+      test.bBase = true;
+      test.cost = COST_PROGRAM + COST_HISTORY + int(m_history.size());
+      break;
+    case MT_POLICY:
+      if (m_policy.empty())
+        return false;
+      test.op = OP_POLICY;
+      test.bBase = true;
+      test.cost = COST_PROGRAM + int(m_policy.size());
+      break;
+    default:
+      ASSERT(0);
+      return false;
+  }
+  return true;
+}
+
+void CCompiledFilter::CompileString(const st_FilterRow &row, Test &test)
+{
+  const int iFunction = row.rule;
+  int cost = COST_STRING;
+  if (test.field == FT_GROUPTITLE)
+    cost += COST_GROUPTITLE;
+  else if (test.field == HT_PASSWORDS)
+    cost += COST_HISTORY;
+
+  if (iFunction == MR_PRESENT || iFunction == MR_NOTPRESENT) {
+    // On the length
+    test.cost = cost - COST_STRING + COST_FIELD;
+    CompileNumber(iFunction, 0, 0, test);
+    return;
+  }
+
+  test.op = OP_STRING;
+  test.bCase = row.fcase;
+
+  switch (iFunction) {
+    case MR_NOTEQUAL:
+      test.bNegate = true;
+      // drop through
+    case MR_EQUALS:
+      test.rule = MR_EQUALS;
+      break;
+    case MR_NOTBEGIN:
+      test.bNegate = true;
+      // drop through
+    case MR_BEGINS:
+      test.rule = MR_BEGINS;
+      break;
+    case MR_NOTEND:
+      test.bNegate = true;
+      // drop through
+    case MR_ENDS:
+      test.rule = MR_ENDS;
+      break;
+    case MR_NOTCONTAIN:
+      test.bNegate = true;
+      // drop through
+    case MR_CONTAINS:
+      test.rule = MR_CONTAINS;
+      cost += COST_SEARCH - COST_STRING;
+      break;
+    case MR_NOTCNTNANY:
+    case MR_NOTCNTNALL: // same as MR_NOTCNTNANY, as PWSMatch::Match()
+      test.bNegate = true;
+      // drop through
+    case MR_CNTNANY:
+    case MR_CNTNALL:
+      test.rule = (iFunction == MR_CNTNALL) ? MR_CNTNALL : MR_CNTNANY;
+      cost += COST_CHARS - COST_STRING;
+      break;
+    case MR_NOTREGEX:
+    case MR_NOTGLOB:
+      test.bNegate = true;
+      // drop through
+    case MR_REGEX:
+    case MR_GLOB:
+      test.rule = (iFunction == MR_REGEX || iFunction == MR_NOTREGEX) ? MR_REGEX : MR_GLOB;
+      cost += COST_PATTERN - COST_STRING;
+      break;
+    default:
+      ASSERT(0);
+      test.op = OP_FALSE;
+      return;
+  }
+  const CCompiledMatch match(row.fstring, MatchRule(test.rule), test.bCase);
+  if (!match.IsValid()) {
+    // A bad pattern matches nothing, negated or not, as PWSMatch::Match()
+    test.op = OP_FALSE;
+    return;
+  }
+  test.cost = cost;
+  test.match = m_matches.size();
+  m_matches.push_back(match);
+}
+
+void CCompiledFilter::CompileNumber(int iFunction, int64 v1, int64 v2, Test &test)
+{
+  test.op = OP_RANGE;
+  switch (iFunction) {
+    case MR_PRESENT:
+      test.bNegate = true;
+      // drop through
+    case MR_NOTPRESENT:
+      test.bUnsetFails = false;
+      test.lo = test.hi = 0;
+      break;
+    case MR_NOTEQUAL:
+      test.bNegate = true;
+      // drop through
+    case MR_EQUALS:
+      test.lo = test.hi = v1;
+      break;
+    case MR_BETWEEN:
+      test.lo = v1;
+      test.hi = v2;
+      break;
+    case MR_LT:
+    case MR_BEFORE:
+      test.hi = v1 - 1;
+      break;
+    case MR_LE:
+      test.hi = v1;
+      break;
+    case MR_GT:
+    case MR_AFTER:
+      test.lo = v1 + 1;
+      break;
+    case MR_GE:
+      test.lo = v1;
+      break;
+    default:
+      ASSERT(0);
+      test.op = OP_FALSE;
+  }
+}
+
+void CCompiledFilter::CompileDate(const st_FilterRow &row, Test &test, time_t now)
+{
+  /*
+  * CItemData::Matches() compares the date (local midnight) of the entry's
+  * time with the filter's dates. Rather than converting every entry's
+  * time, convert the filter's dates to ranges of times, e.g., "equals"
+  * becomes [start of day, start of next day - 1].
+  */
+  const int iFunction = row.rule;
+  test.bUnsetFails = true;
+  test.cost = (test.field == HT_CHANGEDATE) ? COST_HISTORY : COST_FIELD;
+  if (iFunction == MR_PRESENT || iFunction == MR_NOTPRESENT) {
+    CompileNumber(iFunction, 0, 0, test);
+    return;
+  }
+
+  time_t t1, t2;
+  if (row.fdatetype == 1 /* Relative */) {
+    const time_t today = PWSLocalTime::StartOfDay(now);
+    t1 = PWSLocalTime::StartOfDay(today, row.fnum1);
+    t2 = PWSLocalTime::StartOfDay(today, row.fnum2);
+    m_bTimeDependent = true;
+  } else {
+    t1 = PWSLocalTime::StartOfDay(row.fdate1);
+    t2 = PWSLocalTime::StartOfDay(row.fdate2);
+  }
+  const int64 end1 = int64(PWSLocalTime::StartOfDay(t1, 1)) - 1;
+  const int64 end2 = int64(PWSLocalTime::StartOfDay(t2, 1)) - 1;
+
+  switch (iFunction) {
+    case MR_NOTEQUAL:
+      test.bNegate = true;
+      // drop through
+    case MR_EQUALS:
+      CompileNumber(MR_BETWEEN, t1, end1, test);
+      break;
+    case MR_BETWEEN:
+      CompileNumber(MR_BETWEEN, t1, end2, test);
+      break;
+    case MR_LE:
+      CompileNumber(MR_LE, end1, 0, test);
+      break;
+    case MR_GT:
+    case MR_AFTER:
+      CompileNumber(MR_GT, end1, 0, test);
+      break;
+    default: // MR_LT, MR_BEFORE, MR_GE
+      CompileNumber(iFunction, t1, 0, test);
+  }
+}
+
+void CCompiledFilter::CompileBool(int iFunction, Test &test)
+{
+  // Value is true if non-zero
+  const bool bIfTrue = Match(true, iFunction);
+  const bool bIfFalse = Match(false, iFunction);
+  if (bIfTrue == bIfFalse) {
+    ASSERT(!bIfTrue);
+    test.op = OP_FALSE;
+  } else
+    CompileNumber(bIfTrue ? MR_PRESENT : MR_NOTPRESENT, 0, 0, test);
+}
+
+bool CCompiledFilter::Passes(const CItemData &ci, const CItemData *pBase) const
+{
+  if (m_main.empty())
+    return true;
+
+  Context ctx(ci, (ci.IsAlias() && pBase != NULL) ? *pBase : ci);
+  return Run(m_main, ctx);
+}
+
+bool CCompiledFilter::Run(const Program &program, Context &ctx) const
+{
+  size_t i = 0;
+  while (i < program.size()) {
+    const Test &test = program[i];
+    if (!Evaluate(test, ctx))
+      i = test.group_end; // skip the rest of this group
+    else if (++i == test.group_end)
+      return true; // all of this group passed
+  }
+  return false;
+}
+
+bool CCompiledFilter::Evaluate(const Test &test, Context &ctx) const
+{
+  const CItemData &ci = ctx.Entry(test);
+
+  switch (test.op) {
+    case OP_FALSE:
+      return false;
+    case OP_HISTORY:
+      ctx.LoadHistory();
+      return Run(m_history, ctx);
+    case OP_POLICY:
+      return Run(m_policy, ctx);
+    case OP_STRING:
+    {
+      if (test.field == HT_PASSWORDS) {
+        // Any of them
+        ctx.LoadHistory();
+        PWHistPasswords::const_iterator iter;
+        for (iter = ctx.pHistory->begin(); iter != ctx.pHistory->end(); iter++) {
+          if (EvaluateString(test, iter->password.data(), iter->password.length()))
+            return true;
+        }
+        return false;
+      }
+      if (test.field == FT_GROUPTITLE) {
+        const StringX &sx = ctx.GroupTitle();
+        return EvaluateString(test, sx.data(), sx.length());
+      }
+      const TCHAR *pText;
+      size_t len;
+      ci.GetFieldText(CItemData::FieldType(test.field), pText, len);
+      return EvaluateString(test, pText, len);
+    }
+    case OP_RANGE:
+      break;
+    default:
+      ASSERT(0);
+      return false;
+  }
+
+  int64 value(0);
+  switch (test.field) {
+    case FT_CTIME:
+    case FT_PMTIME:
+    case FT_ATIME:
+    case FT_XTIME:
+    case FT_RMTIME:
+    {
+      time_t t(0);
+      switch (test.field) {
+        case FT_CTIME:  ci.GetCTime(t); break;
+        case FT_PMTIME: ci.GetPMTime(t); break;
+        case FT_ATIME:  ci.GetATime(t); break;
+        case FT_XTIME:  ci.GetXTime(t); break;
+        default:        ci.GetRMTime(t); break;
+      }
+      value = t;
+      break;
+    }
+    case FT_XTIME_INT:
+    {
+      int32 xint;
+      ci.GetXTimeInt(xint);
+      value = xint;
+      break;
+    }
+    case FT_KBSHORTCUT:
+    {
+      int32 iKBShortcut;
+      ci.GetKBShortcut(iKBShortcut);
+      value = iKBShortcut;
+      break;
+    }
+    case FT_DCA:
+    case FT_SHIFTDCA:
+    {
+      int16 iDCA;
+      ci.GetDCA(iDCA, test.field == FT_SHIFTDCA);
+      value = iDCA;
+      break;
+    }
+    case FT_PROTECTED:     value = ci.IsProtected() ? 1 : 0; break;
+    case FT_UNKNOWNFIELDS: value = int64(ci.NumberUnknownFields()); break;
+    case FT_ENTRYSIZE:     value = int64(ci.GetSize()); break;
+    case FT_PASSWORDLEN:   value = int64(ci.GetPasswordLength()); break;
+    case FT_ENTRYTYPE:     value = ci.GetEntryType(); break;
+    case FT_ENTRYSTATUS:   value = ci.GetStatus(); break;
+    case FT_GROUPTITLE:    value = int64(ctx.GroupTitle().length()); break;
+
+    case HT_PRESENT:
+      value = (ctx.historyMax > 0 || !ctx.pHistory->empty()) ? 1 : 0;
+      break;
+    case HT_ACTIVE:   value = ctx.bHistoryActive ? 1 : 0; break;
+    case HT_NUM:      value = int64(ctx.pHistory->size()); break;
+    case HT_MAX:      value = int64(ctx.historyMax); break;
+    case HT_CHANGEDATE:
+    {
+      // Any of them, except for "not present" (the only range of [0, 0]
+      // that isn't negated), which is none of them being set
+      const bool bNotPresent = test.lo == 0 && test.hi == 0 && !test.bNegate;
+      PWHistPasswords::const_iterator iter;
+      for (iter = ctx.pHistory->begin(); iter != ctx.pHistory->end(); iter++) {
+        const int64 t = iter->changetime;
+        if (t == 0)
+          continue;
+        if (bNotPresent)
+          return false;
+        if ((t >= test.lo && t <= test.hi) != test.bNegate)
+          return true;
+      }
+      return bNotPresent;
+    }
+
+    case PT_PRESENT:  value = ctx.Policy().flags != 0 ? 1 : 0; break;
+    case PT_LENGTH:   value = ctx.Policy().length; break;
+    case PT_LOWERCASE:
+      value = (ctx.Policy().flags & PWPolicy::UseLowercase) ? 1 : 0;
+      break;
+    case PT_UPPERCASE:
+      value = (ctx.Policy().flags & PWPolicy::UseUppercase) ? 1 : 0;
+      break;
+    case PT_DIGITS:
+      value = (ctx.Policy().flags & PWPolicy::UseDigits) ? 1 : 0;
+      break;
+    case PT_SYMBOLS:
+      value = (ctx.Policy().flags & PWPolicy::UseSymbols) ? 1 : 0;
+      break;
+    case PT_PRONOUNCEABLE:
+      value = (ctx.Policy().flags & PWPolicy::MakePronounceable) ? 1 : 0;
+      break;
+    default:
+      // String field, for "present" tests
+      if (test.field < FT_END) {
+        const TCHAR *pText;
+        size_t len;
+        ci.GetFieldText(CItemData::FieldType(test.field), pText, len);
+        value = int64(len);
+      } else
+        ASSERT(0);
+  }
+
+  if (test.bUnsetFails &&
+      (IsPolicyField(test.field) ? ctx.Policy().flags == 0 : value == 0))
+    return false;
+  return (value >= test.lo && value <= test.hi) != test.bNegate;
+}
+
+bool CCompiledFilter::EvaluateString(const Test &test,
+                                     const TCHAR *pText, size_t len) const
+{
+  return m_matches[test.match].Matches(pText, len) != test.bNegate;
+}
+//-----------------------------------------------------------------------------
+// Local variables:
+// mode: c++
+// End:
@@ -0,0 +1,122 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+// CompiledFilter.h
+//-----------------------------------------------------------------------------
+
+#ifndef __COMPILEDFILTER_H
+#define __COMPILEDFILTER_H
+
+#include "PWSFilters.h"
+#include "Match.h"
+#include "os/typedefs.h"
+
+#include <vector>
+#include <time.h>
+
+/*
+* CCompiledFilter turns an st_filters into a form that is quick to apply
+* to many entries, e.g., the whole database every time the view is
+* refreshed.
+*
+* Active rows are grouped as the filter dialog shows them: consecutive
+* rows joined by "And" form a group, "Or" starts a new one, and an entry
+* passes if all the tests of any group pass. Each group is compiled to a
+* run of tests in one flat vector, where a failing test jumps to the start
+* of the next group. Within a group, and between groups, tests are
+* ordered cheapest first (and within a cost, most likely to fail first).
+*
+* Constants are resolved up front: case-insensitive strings are folded
+* once, relative dates are resolved against the compile time and all date
+* rules become a range of time_t values (so entries' times needn't be
+* converted to local dates), integer rules become ranges, and entry sizes
+* are scaled to bytes. The password history and policy rows are compiled
+* to programs of their own, run only when an entry reaches a
+* "password history" or "password policy" test.
+*
+* Results are the same as applying each row with CItemData::Matches(),
+* except that relative dates are counted from midnight (today) rather than
+* from the current time, and for an alias the password (and its length,
+* history and policy) tests use its base entry's, as the base entry holds
+* the password. Rows on the policy's "easy vision" and "hexadecimal"
+* flags, which PWPolicy doesn't have, are taken as never set.
+*
+* Relative dates (and the "expired"/"will expire" rules) depend on when
+* the filter was compiled: see IsTimeDependent().
+*/
+
+class CCompiledFilter
+{
+public:
+  CCompiledFilter();
+  // now: time to resolve relative dates against, 0 for the current time
+  explicit CCompiledFilter(const st_filters &filters, time_t now = time_t(0));
+
+  void Compile(const st_filters &filters, time_t now = time_t(0));
+  void Clear();
+
+  // True if there's nothing to test, i.e., all entries pass
+  bool IsEmpty() const {return m_main.empty();}
+  bool IsTimeDependent() const {return m_bTimeDependent;}
+  size_t GetNumTests() const
+  {return m_main.size() + m_history.size() + m_policy.size();}
+
+  // pBase: if ci is an alias, its base entry (else ignored)
+  bool Passes(const CItemData &ci, const CItemData *pBase = NULL) const;
+
+private:
+  enum OpCode {
+    OP_FALSE,    // never passes (rule that can't match)
+    OP_RANGE,    // numeric value of the field within [lo, hi]
+    OP_STRING,   // string rule on the field's text
+    OP_HISTORY,  // the password history program passes
+    OP_POLICY,   // the password policy program passes
+  };
+
+  struct Test {
+    OpCode op;
+    int field;       // FieldType: CItemData, HT_* or PT_* field
+    int rule;        // OP_STRING: MR_EQUALS, MR_BEGINS, MR_ENDS,
+                     // MR_CONTAINS, MR_CNTNANY, MR_CNTNALL, MR_REGEX
+                     // or MR_GLOB
+    bool bNegate;    // result is inverted
+    bool bUnsetFails; // OP_RANGE: fails if the value is unset (0, or for
+                      // policy fields, no policy), whatever bNegate
+    bool bCase;      // OP_STRING: case sensitive
+    bool bBase;      // evaluate on the alias' base entry
+    int cost;        // for ordering
+    int64 lo, hi;
+    size_t match;    // OP_STRING: index into m_matches
+    size_t group_end; // index of the first test of the next group
+
+    Test();
+  };
+  typedef std::vector<Test> Program;
+
+  struct Context; // per entry data, decoded as needed
+
+  void CompileRows(const vFilterRows &rows, Program &program, time_t now);
+  bool CompileRow(const st_FilterRow &row, Test &test, time_t now);
+  void CompileString(const st_FilterRow &row, Test &test);
+  static void CompileNumber(int iFunction, int64 v1, int64 v2, Test &test);
+  void CompileDate(const st_FilterRow &row, Test &test, time_t now);
+  static void CompileBool(int iFunction, Test &test);
+
+  bool Run(const Program &program, Context &ctx) const;
+  bool Evaluate(const Test &test, Context &ctx) const;
+  bool EvaluateString(const Test &test, const TCHAR *pText, size_t len) const;
+
+  Program m_main, m_history, m_policy;
+  std::vector<PWSMatch::CCompiledMatch> m_matches;
+  bool m_bTimeDependent;
+};
+
+#endif /* __COMPILEDFILTER_H */
+//-----------------------------------------------------------------------------
+// Local variables:
+// mode: c++
+// End:
@@ -21,6 +21,10 @@
 #include "VerifyFormat.h"
 #include "PWSfileV3.h" // XXX cleanup with dynamic_cast
 #include "StringXStream.h"
+#include "ParallelScan.h"
+#include "Delta.h"
+#include "XMLWriter.h"
+#include "TextImportFile.h"
 
 #include "XML/XMLDefs.h"  // Required if testing "USE_XML_LIBRARY"
 
@@ -34,6 +38,8 @@
 #include "XML/MSXML/MFileXMLProcessor.h"
 #elif USE_XML_LIBRARY == XERCES
 #include "XML/Xerces/XFileXMLProcessor.h"
+#elif USE_XML_LIBRARY == PUGIXML
+#include "XML/Pugi/PFileXMLProcessor.h"
 #endif
 
 #include <fstream> // for WritePlaintextFile
@@ -42,6 +48,7 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <atomic>
 #include <set>
 
 // These column names must match the field names defined in core_st.cpp
@@ -60,8 +67,8 @@ typedef std::vector<stringT>::iterator viter;
 struct ExportTester {
   ExportTester(const stringT &subgroup_name,
                const int &subgroup_object, const int &subgroup_function)
-  :  m_subgroup_name(subgroup_name), m_subgroup_object(subgroup_object),
-  m_subgroup_function(subgroup_function)
+  :  m_subgroup(std2stringx(subgroup_name), subgroup_function),
+  m_subgroup_object(subgroup_object)
   {}
 
   // operator for ItemList
@@ -69,16 +76,14 @@ struct ExportTester {
   {return operator()(p.second);}
 
   // operator for OrderedItemList
-  bool operator()(const CItemData &item) {
-    return item.Matches(m_subgroup_name,
-                        m_subgroup_object, m_subgroup_function);
+  bool operator()(const CItemData &item) const {
+    return item.Matches(m_subgroup, m_subgroup_object);
   }
 
 private:
   ExportTester& operator=(const ExportTester&); // Do not implement
-  const stringT &m_subgroup_name;
+  const PWSMatch::CCompiledMatch m_subgroup;
   const int &m_subgroup_object;
-  const int &m_subgroup_function;
 };
 
 int PWScore::TestSelection(const bool bAdvanced,
@@ -89,20 +94,19 @@ int PWScore::TestSelection(const bool bAdvanced,
 {
   // Check if any pass restricting criteria
   if (bAdvanced) {
-    bool bAnyMatch(false);
-    if (pOIL != NULL) {
-      if (find_if(pOIL->begin(), pOIL->end(),
-                  ExportTester(subgroup_name,
-                               subgroup_object,
-                               subgroup_function)) != pOIL->end())
-        bAnyMatch = true;
-    } else {
-      if (find_if(m_pwlist.begin(), m_pwlist.end(),
-                  ExportTester(subgroup_name,
-                               subgroup_object,
-                               subgroup_function)) != m_pwlist.end())
-        bAnyMatch = true;
-    }
+    std::vector<const CItemData *> vpci;
+    GetEntryPointers(pOIL, vpci);
+
+    // The scan stops at the first match found
+    const ExportTester tester(subgroup_name, subgroup_object, subgroup_function);
+    const bool bAnyMatch = !CParallelScan().Run(vpci.size(),
+      [&vpci, &tester](size_t first, size_t last, size_t) {
+        for (size_t i = first; i < last; i++) {
+          if (tester(*vpci[i]))
+            return false;
+        }
+        return true;
+      });
 
     if (!bAnyMatch)
       return FAILURE;
@@ -210,71 +214,147 @@ StringX PWScore::BuildHeader(const CItemData::FieldBits &bsFields, const bool bI
   return hdr.c_str();
 }
 
+// What's reported, back on the calling thread, for each entry exported
+struct ExportedEntry {
+  StringX sx_exported; // <<group>> <<title>> <<user>>
+  bool bOK;            // false if it couldn't be converted or had XML errors
+};
+
+// Part of an export, formatted while others are
+struct ExportChunk {
+  ExportChunk() : bReady(false) {}
+  CXMLWriter out; // in memory
+  std::vector<ExportedEntry> exported;
+  std::atomic<bool> bReady;
+};
+
+/*
+* Exports entries through a record writer, which provides:
+*
+*   bool FormatEntry(const CItemData &item, unsigned int id, CXMLWriter &out,
+*                    ExportedEntry &exported) const
+*     formats item, the id'th (from 1) of entries, into out, returning
+*     false if it isn't exported. Called in parallel, see CParallelScan
+*     for what it may do.
+*   void ReportEntry(const ExportedEntry &exported)
+*     called, in order, on the calling thread, for each entry exported.
+*
+* Chunks of entries are formatted in parallel, each into a buffer of its
+* own. The calling thread writes these to xw, in order, as soon as each
+* chunk and all those before it are done, so that what's written and
+* reported is exactly what a single loop over entries would do. With
+* only one thread, that's just what's done.
+*/
+template<typename RecordWriter>
+static void ExportEntries(const std::vector<const CItemData *> &entries,
+                          RecordWriter &writer, CXMLWriter &xw)
+{
+  const CParallelScan scan;
+  const size_t nchunks = scan.GetNumChunks(entries.size());
+  if (scan.GetNumThreads() == 1 || nchunks < 2) {
+    // Nothing to gain from buffering chunks, straight into xw
+    ExportedEntry exported;
+    for (size_t i = 0; i < entries.size(); i++) {
+      if (writer.FormatEntry(*entries[i], static_cast<unsigned int>(i + 1), xw, exported))
+        writer.ReportEntry(exported);
+    }
+    return;
+  }
+
+  std::vector<ExportChunk> chunks(nchunks);
+  size_t next_chunk = 0;
+
+  auto write_chunks = [&chunks, &next_chunk, &writer, &xw]() {
+    for (; next_chunk < chunks.size() &&
+           chunks[next_chunk].bReady.load(std::memory_order_acquire); next_chunk++) {
+      ExportChunk &chunk = chunks[next_chunk];
+      xw.Write(chunk.out);
+      chunk.out.Clear();
+      for (size_t i = 0; i < chunk.exported.size(); i++)
+        writer.ReportEntry(chunk.exported[i]);
+      std::vector<ExportedEntry>().swap(chunk.exported);
+    }
+  };
+
+  scan.Run(entries.size(),
+           [&entries, &chunks, &writer](size_t first, size_t last, size_t ichunk) {
+             ExportChunk &chunk = chunks[ichunk];
+             ExportedEntry exported;
+             for (size_t i = first; i < last; i++) {
+               if (writer.FormatEntry(*entries[i], static_cast<unsigned int>(i + 1),
+                                      chunk.out, exported))
+                 chunk.exported.push_back(exported);
+             }
+             chunk.bReady.store(true, std::memory_order_release);
+             return true;
+           },
+           NULL, [&write_chunks](size_t) {write_chunks();});
+
+  // Whatever other threads finished last
+  write_chunks();
+}
+
 struct TextRecordWriter {
   TextRecordWriter(const stringT &subgroup_name,
           const int &subgroup_object, const int &subgroup_function,
           const CItemData::FieldBits &bsFields,
-          const TCHAR &delimiter, coStringXStream &ofs, FILE * &txtfile,
-          int &numExported, CReport *pRpt, PWScore *pcore) :
+          const TCHAR &delimiter, int &numExported, CReport *pRpt, PWScore *pcore) :
   m_subgroup_name(subgroup_name), m_subgroup_object(subgroup_object),
-  m_subgroup_function(subgroup_function), m_bsFields(bsFields),
-  m_delimiter(delimiter), m_ofs(ofs), m_txtfile(txtfile), m_pcore(pcore),
+  m_subgroup(subgroup_name.empty() ? PWSMatch::CCompiledMatch() :
+             PWSMatch::CCompiledMatch(std2stringx(subgroup_name), subgroup_function)),
+  m_bsFields(bsFields),
+  m_delimiter(delimiter), m_pcore(pcore),
   m_pRpt(pRpt), m_numExported(numExported)
   {}
 
-  // operator for ItemList
-  void operator()(pair<CUUID, CItemData> p)
-  {operator()(p.second);}
+  // See ExportEntries
+  bool FormatEntry(const CItemData &item, unsigned int, CXMLWriter &out,
+                   ExportedEntry &exported) const {
+    if (!m_subgroup_name.empty() &&
+        !item.Matches(m_subgroup, m_subgroup_object))
+      return false;
+
+    const CItemData *pcibase = m_pcore->GetBaseEntry(&item);
+    const StringX line = item.GetPlaintext(TCHAR('\t'),
+                                           m_bsFields, m_delimiter, pcibase);
+    if (line.empty())
+      return false;
+
+    exported.sx_exported = StringX(_T("\xab")) +
+                           item.GetGroup() + StringX(_T("\xbb \xab")) +
+                           item.GetTitle() + StringX(_T("\xbb \xab")) +
+                           item.GetUser()  + StringX(_T("\xbb"));
+
+    CUTF8Conv conv; // can't make a member, as no copy c'tor!
+    const unsigned char *utf8;
+    size_t utf8Len;
+    exported.bOK = conv.ToUTF8(line, utf8, utf8Len);
+    if (exported.bOK) {
+      out.Write(reinterpret_cast<const char *>(utf8), utf8Len);
+      out << '\n';
+    }
+    return true;
+  }
 
-  // operator for OrderedItemList
-  void operator()(const CItemData &item) {
-    if (m_subgroup_name.empty() ||
-        item.Matches(m_subgroup_name, m_subgroup_object,
-        m_subgroup_function)) {
-      const CItemData *pcibase = m_pcore->GetBaseEntry(&item);
-      const StringX line = item.GetPlaintext(TCHAR('\t'),
-                                             m_bsFields, m_delimiter, pcibase);
-      if (!line.empty()) {
-        StringX sx_exported = StringX(_T("\xab")) +
-                             item.GetGroup() + StringX(_T("\xbb \xab")) +
-                             item.GetTitle() + StringX(_T("\xbb \xab")) +
-                             item.GetUser()  + StringX(_T("\xbb"));
-
-        if (m_pRpt != NULL)
-          m_pRpt->WriteLine(sx_exported.c_str());
-        m_pcore->UpdateWizard(sx_exported.c_str());
-
-        CUTF8Conv conv; // can't make a member, as no copy c'tor!
-        const unsigned char *utf8;
-        size_t utf8Len;
-        if (conv.ToUTF8(line, utf8, utf8Len)) {
-          m_ofs.write(reinterpret_cast<const char *>(utf8), utf8Len);
-          m_ofs << endl;
-          m_numExported++;
-        } else {
-          ASSERT(0);
-        }
-        // Write what we have and reset the buffer
-        size_t numwritten = fwrite(m_ofs.str().c_str(), 1, m_ofs.str().length(), m_txtfile);
-#ifdef DEBUG
-        ASSERT(numwritten == m_ofs.str().length());
-#else
-        UNREFERENCED_PARAMETER(numwritten); // In Release build only otherwise MS Compiler warning
-#endif
-        m_ofs.str("");
-      } // !line.IsEmpty()
-    } // we've a match
+  void ReportEntry(const ExportedEntry &exported) {
+    if (m_pRpt != NULL)
+      m_pRpt->WriteLine(exported.sx_exported.c_str());
+    m_pcore->UpdateWizard(exported.sx_exported.c_str());
+
+    if (exported.bOK) {
+      m_numExported++;
+    } else {
+      ASSERT(0);
+    }
   }
 
 private:
   TextRecordWriter& operator=(const TextRecordWriter&); // Do not implement
   const stringT &m_subgroup_name;
   const int &m_subgroup_object;
-  const int &m_subgroup_function;
+  const PWSMatch::CCompiledMatch m_subgroup;
   const CItemData::FieldBits &m_bsFields;
   const TCHAR &m_delimiter;
-  coStringXStream &m_ofs;
-  FILE * &m_txtfile;
   PWScore *m_pcore;
   CReport *m_pRpt;
   int &m_numExported;
@@ -305,7 +385,7 @@ int PWScore::WritePlaintextFile(const StringX &filename,
     return CANT_OPEN_FILE;
 
   CUTF8Conv conv;
-  coStringXStream ofs;
+  CXMLWriter xw(txtfile); // just UTF-8 text, but buffered the same way
 
   StringX hdr(_T(""));
   const unsigned char *utf8 = NULL;
@@ -315,30 +395,24 @@ int PWScore::WritePlaintextFile(const StringX &filename,
     // all fields to be exported, use pre-built header
     StringX exphdr = EXPORTHEADER;
     conv.ToUTF8(exphdr.c_str(), utf8, utf8Len);
-    ofs.write(reinterpret_cast<const char *>(utf8), utf8Len);
-    ofs << endl;
   } else {
     hdr = BuildHeader(bsFields, true);
     conv.ToUTF8(hdr, utf8, utf8Len);
-    ofs.write(reinterpret_cast<const char *>(utf8), utf8Len);
-    ofs << endl;
   }
-
-  // Write what we have and reset the buffer
-  fwrite(ofs.str().c_str(), 1, ofs.str().length(), txtfile);
-  ofs.str("");
+  xw.Write(reinterpret_cast<const char *>(utf8), utf8Len);
+  xw << '\n';
 
   TextRecordWriter put_text(subgroup_name, subgroup_object, subgroup_function,
-                   bsFields, delimiter, ofs, txtfile, numExported, pRpt, this);
+                   bsFields, delimiter, numExported, pRpt, this);
 
-  if (pOIL != NULL) {
-    for_each(pOIL->begin(), pOIL->end(), put_text);
-  } else {
-    for_each(m_pwlist.begin(), m_pwlist.end(), put_text);
-  }
+  std::vector<const CItemData *> entries;
+  GetEntryPointers(pOIL, entries);
+  ExportEntries(entries, put_text, xw);
 
-  // Close the file
-  fclose(txtfile);
+  // Write what's left, close the file
+  const bool bWritten = xw.Flush();
+  if (fclose(txtfile) != 0 || !bWritten)
+    return WRITE_FAIL;
 
   return SUCCESS;
 }
@@ -347,92 +421,80 @@ struct XMLRecordWriter {
   XMLRecordWriter(const stringT &subgroup_name,
                   const int subgroup_object, const int subgroup_function,
                   const CItemData::FieldBits &bsFields,
-                  TCHAR delimiter, coStringXStream &ofs, FILE * &xmlfile,
-                  int &numExported, int &numXMLErrors,
+                  TCHAR delimiter, int &numExported, int &numXMLErrors,
                   CReport *pRpt, PWScore *pcore) :
   m_subgroup_name(subgroup_name), m_subgroup_object(subgroup_object),
-  m_subgroup_function(subgroup_function), m_bsFields(bsFields),
-  m_delimiter(delimiter), m_ofs(ofs), m_xmlfile(xmlfile), m_id(0), m_pcore(pcore),
+  m_subgroup(subgroup_name.empty() ? PWSMatch::CCompiledMatch() :
+             PWSMatch::CCompiledMatch(std2stringx(subgroup_name), subgroup_function)),
+  m_bsFields(bsFields),
+  m_delimiter(delimiter), m_pcore(pcore),
   m_numExported(numExported), m_numXMLErrors(numXMLErrors), m_pRpt(pRpt)
   {
     LoadAString(strXMLErrors, IDSC_XMLCHARACTERERRORS);
   }
 
-  // operator for ItemList
-  void operator()(pair<CUUID, CItemData> p)
-  {operator()(p.second);}
-
-  // operator for OrderedItemList
-  void operator()(const CItemData &item) {
-    m_id++;
-    if (m_subgroup_name.empty() ||
-        item.Matches(m_subgroup_name,
-                     m_subgroup_object, m_subgroup_function)) {
-      StringX sx_exported;
-      Format(sx_exported, GROUPTITLEUSERINCHEVRONS,
-                        item.GetGroup().c_str(), item.GetTitle().c_str(), item.GetUser().c_str());
-      bool bforce_normal_entry(false);
-
-      if (item.IsNormal()) {
-        //  Check password doesn't incorrectly imply alias or shortcut entry
-        StringX pswd;
-        pswd = item.GetPassword();
-
-        // Passwords are mandatory but, if missing, don't crash referencing character out of bounds!
-        // Note: This value will not get to the XML file but the import will fail as the original entry
-        // did not have a password and, as above, it is mandatory.
-        if (pswd.length() == 0)
-          pswd = _T("*MISSING*");
-
-        int num_colons = Replace(pswd, _T(':'), _T(';')) + 1;
-        if ((pswd.length() > 1 && pswd[0] == _T('[')) &&
-            (pswd[pswd.length() - 1] == _T(']')) &&
-            num_colons <= 3) {
-          bforce_normal_entry = true;
-        }
+  // See ExportEntries
+  bool FormatEntry(const CItemData &item, unsigned int id, CXMLWriter &out,
+                   ExportedEntry &exported) const {
+    if (!m_subgroup_name.empty() &&
+        !item.Matches(m_subgroup, m_subgroup_object))
+      return false;
+
+    Format(exported.sx_exported, GROUPTITLEUSERINCHEVRONS,
+                      item.GetGroup().c_str(), item.GetTitle().c_str(), item.GetUser().c_str());
+    bool bforce_normal_entry(false);
+
+    if (item.IsNormal()) {
+      //  Check password doesn't incorrectly imply alias or shortcut entry
+      StringX pswd;
+      pswd = item.GetPassword();
+
+      // Passwords are mandatory but, if missing, don't crash referencing character out of bounds!
+      // Note: This value will not get to the XML file but the import will fail as the original entry
+      // did not have a password and, as above, it is mandatory.
+      if (pswd.length() == 0)
+        pswd = _T("*MISSING*");
+
+      int num_colons = Replace(pswd, _T(':'), _T(';')) + 1;
+      if ((pswd.length() > 1 && pswd[0] == _T('[')) &&
+          (pswd[pswd.length() - 1] == _T(']')) &&
+          num_colons <= 3) {
+        bforce_normal_entry = true;
       }
+    }
 
-      if (m_pRpt != NULL)
-        m_pRpt->WriteLine(sx_exported.c_str(), false);
+    const CItemData *pcibase = m_pcore->GetBaseEntry(&item);
+    // Straight into the chunk's buffer
+    exported.bOK = item.WriteXML(out, id, m_bsFields, m_delimiter,
+                                 pcibase, bforce_normal_entry);
+    return true;
+  }
 
-      m_pcore->UpdateWizard(sx_exported.c_str());
+  void ReportEntry(const ExportedEntry &exported) {
+    if (m_pRpt != NULL)
+      m_pRpt->WriteLine(exported.sx_exported.c_str(), false);
 
-      const CItemData *pcibase = m_pcore->GetBaseEntry(&item);
-      bool bXMLErrorsFound(false);
-      string xml = item.GetXML(m_id, m_bsFields, m_delimiter, pcibase,
-                               bforce_normal_entry, bXMLErrorsFound);
+    m_pcore->UpdateWizard(exported.sx_exported.c_str());
 
-      if (bXMLErrorsFound) {
+    if (!exported.bOK) {
+      if (m_pRpt != NULL) {
         m_pRpt->WriteLine(_T("\t"), false);
         m_pRpt->WriteLine(strXMLErrors.c_str());
-        m_numXMLErrors++;
-      } else
-        m_pRpt->WriteLine();
+      }
+      m_numXMLErrors++;
+    } else if (m_pRpt != NULL)
+      m_pRpt->WriteLine();
 
-      m_ofs.write(xml.c_str(),
-                 static_cast<streamsize>(xml.length()));
-      m_numExported++;
-    }
-    // Write what we have and reset the buffer
-    size_t numwritten = fwrite(m_ofs.str().c_str(), 1, m_ofs.str().length(), m_xmlfile);
-#ifdef DEBUG
-    ASSERT(numwritten == m_ofs.str().length());
-#else
-    UNREFERENCED_PARAMETER(numwritten); // In Release build only otherwise MS Compiler warning
-#endif
-    m_ofs.str("");
+    m_numExported++;
   }
 
 private:
   XMLRecordWriter& operator=(const XMLRecordWriter&); // Do not implement
   const stringT &m_subgroup_name;
   const int m_subgroup_object;
-  const int m_subgroup_function;
+  const PWSMatch::CCompiledMatch m_subgroup;
   const CItemData::FieldBits &m_bsFields;
   TCHAR m_delimiter;
-  coStringXStream &m_ofs;
-  FILE * &m_xmlfile;
-  unsigned int m_id;
   PWScore *m_pcore;
   int &m_numExported;
   int &m_numXMLErrors;
@@ -460,148 +522,103 @@ int PWScore::WriteXMLFile(const StringX &filename,
   if (xmlfile == NULL)
     return CANT_OPEN_FILE;
 
-  CUTF8Conv conv;
-  const unsigned char *utf8 = NULL;
-  size_t utf8Len = 0;
+  // Everything is converted to UTF-8 as it's written to xw's buffer
+  CXMLWriter xw(xmlfile);
 
-  coStringXStream ofs;
-  oStringXStream oss_xml;
-
-  StringX tmp;
   stringT cs_temp;
   time_t time_now;
+  int numXMLErrors(0);
 
   time(&time_now);
-  const StringX now = PWSUtil::ConvertToDateTimeString(time_now, PWSUtil::TMC_XML);
-
-  ofs << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>" << endl;
-  ofs << "<?xml-stylesheet type=\"text/xsl\" href=\"lumimaja.xsl\"?>" << endl;
-  ofs << endl;
-  ofs << "<lumimaja" << endl;
-  tmp = m_currfile;
-  Replace(tmp, StringX(_T("&")), StringX(_T("&amp;")));
-
-  StringX delStr;
-  delStr += delimiter;
-  conv.ToUTF8(delStr, utf8, utf8Len);
-  ofs << "delimiter=\"";
-  ofs.write(reinterpret_cast<const char *>(utf8), utf8Len);
-  ofs << "\"" << endl;
-  conv.ToUTF8(tmp, utf8, utf8Len);
-  ofs << "Database=\"";
-  ofs.write(reinterpret_cast<const char *>(utf8), utf8Len);
-  ofs << "\"" << endl;
-  conv.ToUTF8(now, utf8, utf8Len);
-  ofs << "ExportTimeStamp=\"";
-  ofs.write(reinterpret_cast<const char *>(utf8), utf8Len);
-  ofs << "\"" << endl;
-  ofs << "FromDatabaseFormat=\"";
+
+  xw << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+  xw << "<?xml-stylesheet type=\"text/xsl\" href=\"lumimaja.xsl\"?>\n";
+  xw << "\n";
+  xw << "<lumimaja\n";
+
+  xw << "delimiter=\"";
+  xw.WriteEscaped(&delimiter, 1);
+  xw << "\"\n";
+  xw << "Database=\"";
+  xw.WriteEscaped(m_currfile);
+  xw << "\"\n";
+  xw << "ExportTimeStamp=\"";
+  xw.WriteTime(time_now);
+  xw << "\"\n";
+  xw << "FromDatabaseFormat=\"";
   ostringstream osv; // take advantage of UTF-8 == ascii for version string
   osv << m_hdr.m_nCurrentMajorVersion
       << "." << setw(2) << setfill('0')
       << m_hdr.m_nCurrentMinorVersion;
-  ofs.write(osv.str().c_str(), osv.str().length());
-  ofs << "\"" << endl;
+  xw.Write(osv.str().c_str(), osv.str().length());
+  xw << "\"\n";
   if (!m_hdr.m_lastsavedby.empty() || !m_hdr.m_lastsavedon.empty()) {
     oStringXStream oss;
     oss << m_hdr.m_lastsavedby << _T(" on ") << m_hdr.m_lastsavedon;
-    conv.ToUTF8(oss.str(), utf8, utf8Len);
-    ofs << "WhoSaved=\"";
-    ofs.write(reinterpret_cast<const char *>(utf8), utf8Len);
-    ofs << "\"" << endl;
+    xw << "WhoSaved=\"";
+    xw.WriteEscaped(oss.str());
+    xw << "\"\n";
   }
   if (!m_hdr.m_whatlastsaved.empty()) {
-    conv.ToUTF8(m_hdr.m_whatlastsaved, utf8, utf8Len);
-    ofs << "WhatSaved=\"";
-    ofs.write(reinterpret_cast<const char *>(utf8), utf8Len);
-    ofs << "\"" << endl;
+    xw << "WhatSaved=\"";
+    xw.WriteEscaped(m_hdr.m_whatlastsaved);
+    xw << "\"\n";
   }
   if (m_hdr.m_whenlastsaved != 0) {
-    StringX wls = PWSUtil::ConvertToDateTimeString(m_hdr.m_whenlastsaved,
-                                                   PWSUtil::TMC_XML);
-    conv.ToUTF8(wls.c_str(), utf8, utf8Len);
-    ofs << "WhenLastSaved=\"";
-    ofs.write(reinterpret_cast<const char *>(utf8), utf8Len);
-    ofs << "\"" << endl;
+    xw << "WhenLastSaved=\"";
+    xw.WriteTime(m_hdr.m_whenlastsaved);
+    xw << "\"\n";
   }
 
-  CUUID huuid(*m_hdr.m_file_uuid.GetARep(), true); // true to print canoncally
-
-  ofs << "Database_uuid=\"" << huuid << "\"" << endl;
-  ofs << "xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\"" << endl;
-  ofs << "xsi:noNamespaceSchemaLocation=\"lumimaja.xsd\">" << endl;
-  ofs << endl;
-
-  // Write what we have and reset the buffer
-  fwrite(ofs.str().c_str(), 1, ofs.str().length(), xmlfile);
-  ofs.str("");
+  xw << "Database_uuid=\"";
+  xw.WriteUUID(m_hdr.m_file_uuid, true); // true to print canoncally
+  xw << "\"\n";
+  xw << "xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\"\n";
+  xw << "xsi:noNamespaceSchemaLocation=\"lumimaja.xsd\">\n";
+  xw << "\n";
 
   // Write out preferences stored in database
   LoadAString(cs_temp, IDSC_XMLEXP_PREFERENCES);
-  oss_xml << _T(" <!-- ") << cs_temp << _T(" --> ");
-  conv.ToUTF8(oss_xml.str(), utf8, utf8Len);
-  ofs.write(reinterpret_cast<const char *>(utf8), utf8Len);
-  ofs << endl;
-  oss_xml.str(_T(""));  // Clear buffer for next user
+  xw << " <!-- " << cs_temp << " --> \n";
 
-  stringT prefs = PWSprefs::GetInstance()->GetXMLPreferences();
-  conv.ToUTF8(prefs.c_str(), utf8, utf8Len);
-  ofs.write(reinterpret_cast<const char *>(utf8), utf8Len);
+  xw << PWSprefs::GetInstance()->GetXMLPreferences();
 
   stringT pwpolicies = GetXMLPWPolicies(il);
   if (!pwpolicies.empty()) {
     // Write out password policies stored in database
     LoadAString(cs_temp, IDSC_XMLEXP_POLICIES);
-    oss_xml << _T(" <!-- ") << cs_temp << _T(" --> ");
-    conv.ToUTF8(oss_xml.str(), utf8, utf8Len);
-    ofs.write(reinterpret_cast<const char *>(utf8), utf8Len);
-    ofs << endl;
-    oss_xml.str(_T(""));  // Clear buffer for next user
-
-    conv.ToUTF8(pwpolicies.c_str(), utf8, utf8Len);
-    ofs.write(reinterpret_cast<const char *>(utf8), utf8Len);
-    ofs << endl;
+    xw << " <!-- " << cs_temp << " --> \n";
+    xw << pwpolicies << "\n";
   }
 
   if (!m_vEmptyGroups.empty()) {
     // Write out empty groups stored in database
-    ostringstreamT os;
-    os << "\t<EmptyGroups>" << endl;
+    xw << "\t<EmptyGroups>\n";
     for (size_t n = 0; n < m_vEmptyGroups.size(); n++) {
-      stringT sTemp = PWSUtil::GetSafeXMLString(m_vEmptyGroups[n]);
-      os << "\t\t<EGName>" << sTemp << "</EGName>" << endl;
+      if (!xw.WriteField("\t\t", "EGName", m_vEmptyGroups[n]))
+        numXMLErrors++;
     }
-    os << "\t</EmptyGroups>" << endl << endl;
-    conv.ToUTF8(os.str().c_str(), utf8, utf8Len);
-    ofs.write(reinterpret_cast<const char *>(utf8), utf8Len);
+    xw << "\t</EmptyGroups>\n\n";
   }
 
   bool bStartComment(false);
   if (bFilterActive) {
     if (!bStartComment) {
       bStartComment = true;
-      ofs << " <!-- " << endl;
+      xw << " <!-- \n";
     }
     LoadAString(cs_temp, IDSC_XMLEXP_FILTERACTIVE);
-    oss_xml << _T("     ") << cs_temp;
-    conv.ToUTF8(oss_xml.str(), utf8, utf8Len);
-    ofs.write(reinterpret_cast<const char *>(utf8), utf8Len);
-    ofs << endl;
-    oss_xml.str(_T(""));  // Clear buffer for next user
+    xw << "     " << cs_temp << "\n";
   }
 
   if (!subgroup_name.empty() || bsFields.count() != bsFields.size()) {
     if (!bStartComment) {
       bStartComment = true;
-      ofs << " <!-- " << endl;
+      xw << " <!-- \n";
     }
     // Some restrictions - put in a comment to that effect
     LoadAString(cs_temp, IDSC_XMLEXP_FLDRESTRICT);
-    oss_xml << _T("     ") << cs_temp;
-    conv.ToUTF8(oss_xml.str(), utf8, utf8Len);
-    ofs.write(reinterpret_cast<const char *>(utf8), utf8Len);
-    ofs << endl;
-    oss_xml.str(_T(""));  // Clear buffer for next user
+    xw << "     " << cs_temp << "\n";
 
     if (!subgroup_name.empty()) {
       stringT cs_function, cs_case(_T(""));
@@ -618,36 +635,24 @@ int PWScore::WriteXMLFile(const StringX &filename,
 
       if (!bStartComment) {
         bStartComment = true;
-        ofs << " <!-- " << endl;
+        xw << " <!-- \n";
       }
-      oss_xml << _T("     ") << cs_temp;
-      conv.ToUTF8(oss_xml.str(), utf8, utf8Len);
-      ofs.write(reinterpret_cast<const char *>(utf8), utf8Len);
-      ofs << endl;
-      oss_xml.str(_T(""));  // Clear buffer for next user
-
-      oss_xml << _T("     ") << _T(" '") << cs_object     << _T("' ")
-                             << _T(" '") << cs_function   << _T("' ")
-                             << _T(" '") << subgroup_name << _T("' ")
-                             << cs_case;
-      conv.ToUTF8(oss_xml.str(), utf8, utf8Len);
-      ofs.write(reinterpret_cast<const char *>(utf8), utf8Len);
-      ofs << endl;
-      oss_xml.str(_T(""));  // Clear buffer for next user
+      xw << "     " << cs_temp << "\n";
+
+      xw << "     " << " '" << cs_object     << "' "
+                    << " '" << cs_function   << "' "
+                    << " '" << subgroup_name << "' "
+                    << cs_case << "\n";
     }
 
     if (bsFields.count() != bsFields.size()) {
       if (!bStartComment) {
         bStartComment = true;
-        ofs << " <!-- " << endl;
+        xw << " <!-- \n";
       }
       StringX hdr;
       LoadAString(cs_temp, IDSC_XMLEXP_SUBSETFIELDS);
-      oss_xml << _T("     ") << cs_temp;
-      conv.ToUTF8(oss_xml.str(), utf8, utf8Len);
-      ofs.write(reinterpret_cast<const char *>(utf8), utf8Len);
-      ofs << endl;
-      oss_xml.str(_T(""));  // Clear buffer for next user
+      xw << "     " << cs_temp << "\n";
 
       hdr = BuildHeader(bsFields, false);
       size_t found = hdr.find(_T("\t"));
@@ -658,41 +663,32 @@ int PWScore::WriteXMLFile(const StringX &filename,
         found = hdr.find(_T("\t"));
       }
       hdr = _T("     ") + hdr;
-      conv.ToUTF8(hdr, utf8, utf8Len);
-      ofs.write(reinterpret_cast<const char *>(utf8), utf8Len);
-      ofs << endl;
+      xw << hdr << "\n";
     }
   }
 
   if (bStartComment) {
     bStartComment = false;
-    ofs << " --> " << endl;
-    ofs << endl;
+    xw << " --> \n";
+    xw << "\n";
   }
 
-  // Write what we have and reset the buffer
-  fwrite(ofs.str().c_str(), 1, ofs.str().length(), xmlfile);
-  ofs.str("");
-
-  int numXMLErrors(0);
   XMLRecordWriter put_xml(subgroup_name, subgroup_object, subgroup_function,
-                          bsFields, delimiter, ofs, xmlfile, numExported, 
+                          bsFields, delimiter, numExported,
                           numXMLErrors, pRpt, this);
 
-  if (il != NULL) {
-    for_each(il->begin(), il->end(), put_xml);
-  } else {
-    for_each(m_pwlist.begin(), m_pwlist.end(), put_xml);
-  }
+  std::vector<const CItemData *> entries;
+  GetEntryPointers(il, entries);
+  ExportEntries(entries, put_xml, xw);
 
-  ofs << "</lumimaja>" << endl;
+  xw << "</lumimaja>\n";
 
-  // Write what we have and reset the buffer, close the file
-  fwrite(ofs.str().c_str(), 1, ofs.str().length(), xmlfile);
-  ofs.str("");
-  fclose(xmlfile);
+  // Write what's left, close the file
+  const bool bWritten = xw.Flush();
+  if (fclose(xmlfile) != 0 || !bWritten)
+    return WRITE_FAIL;
 
- return numXMLErrors == 0 ? SUCCESS : OK_WITH_ERRORS;
+  return numXMLErrors == 0 ? SUCCESS : OK_WITH_ERRORS;
 }
 
 #if !defined(USE_XML_LIBRARY) || (!defined(_WIN32) && USE_XML_LIBRARY == MSXML)
@@ -730,25 +726,20 @@ int PWScore::ImportXMLFile(const stringT &ImportedPrefix, const stringT &strXMLF
   MFileXMLProcessor iXML(this, &Possible_Aliases, &Possible_Shortcuts, pmulticmds, &rpt);
 #elif USE_XML_LIBRARY == XERCES
   XFileXMLProcessor iXML(this, &Possible_Aliases, &Possible_Shortcuts, pmulticmds, &rpt);
+#elif USE_XML_LIBRARY == PUGIXML
+  PFileXMLProcessor iXML(this, &Possible_Aliases, &Possible_Shortcuts, pmulticmds, &rpt);
 #endif
 
   bool status, validation;
 
   strXMLErrors = strPWHErrorList = strRenameList = _T("");
 
-  validation = true;
-  status = iXML.Process(validation, ImportedPrefix, strXMLFileName,
-                        strXSDFileName, bImportPSWDsOnly);
-  strXMLErrors = iXML.getXMLErrors();
-  if (!status) {
-    return XML_FAILED_VALIDATION;
-  }
-  numValidated = iXML.getNumEntriesValidated();
-
+  // The file is validated against the schema as it's imported, in one pass
   validation = false;
   status = iXML.Process(validation, ImportedPrefix, strXMLFileName,
                         strXSDFileName, bImportPSWDsOnly);
 
+  numValidated = iXML.getNumEntriesValidated();
   numImported = iXML.getNumEntriesImported();
   numSkipped = iXML.getNumEntriesSkipped();
   numRenamed = iXML.getNumEntriesRenamed();
@@ -765,7 +756,7 @@ int PWScore::ImportXMLFile(const stringT &ImportedPrefix, const stringT &strXMLF
   if (!status) {
     delete pcommand;
     pcommand = NULL;
-    return XML_FAILED_IMPORT;
+    return iXML.getIfValidationErrors() ? XML_FAILED_VALIDATION : XML_FAILED_IMPORT;
   }
 
   if (numImported > 0)
@@ -799,35 +790,12 @@ int PWScore::ImportPlaintextFile(const StringX &ImportedPrefix,
   CUTF8Conv conv;
   pcommand = NULL;
 
-  // We need to use FOpen as the file name/file path may contain non-Latin
-  // characters even though we need the file to contain ASCII and UTF-8 characters
-  // and not Unicode (wchar_t).
-  FILE *fs = pws_os::FOpen(filename.c_str(), _T("rt"));
-  if (fs == NULL)
+  // The file is mapped, and its lines and fields taken from it in place
+  CTextImportFile file;
+  const int rc = file.Open(filename.c_str());
+  if (rc == CTextImportFile::CANT_OPEN)
     return CANT_OPEN_FILE;
-
-  // We need to use file stream I/O but can't with standard FILE I/O
-  // so read in whole file and put it in a StringXStream (may contain sensitive data).
-  // Hopefully, an import text file is not too large!
-  const size_t IMPORT_BUFFER_SIZE = 4096;
-
-  cStringXStream iss;
-  unsigned char buffer[IMPORT_BUFFER_SIZE + 1];
-  bool bError(false);
-  while(!feof(fs)) {
-    size_t count = fread(buffer, 1, IMPORT_BUFFER_SIZE, fs);
-    if (ferror(fs)) {
-      bError = true;
-      break;
-    }
-    buffer[count] = '\0';
-    iss << buffer;
-  }
-
-  // Close the file
-  fclose(fs);
-
-  if (bError)
+  if (rc != CTextImportFile::SUCCESS)
     return FAILURE;
 
   // The following's a stream of chars.  We need to process the header row
@@ -878,10 +846,10 @@ int PWScore::ImportPlaintextFile(const StringX &ImportedPrefix,
   // EXPORTHEADER, or vice versa.
   ASSERT(vs_Header.size() == NUMFIELDS);
 
-  string s_header, linebuf;
+  string s_header;
 
   // Get header record
-  if (!getline(iss, s_header, '\n')) {
+  if (!file.GetLine(s_header)) {
     LoadAString(strError, IDSC_IMPORTNOHEADER);
     rpt.WriteLine(strError);
     return FAILURE;  // not even a title record!
@@ -1003,90 +971,99 @@ int PWScore::ImportPlaintextFile(const StringX &ImportedPrefix,
   InitialiseGTU(setGTU);
   StringX sxImportedEntry;
 
+  // Split on the same char as the header
+  const char sep = pSeps[0];
+  std::vector<CTextImportFile::Field> fields;
+  const char *linebuf;
+  size_t linelen;
+
   for (;;) {
     bool bNoPolicy(false);
     StringX sxPolicyName;
 
     // read a single line.
-    if (!getline(iss, linebuf, '\n')) break;
+    if (!file.GetLine(linebuf, linelen)) break;
     numlines++;
 
     // remove MS-DOS linebreaks, if needed.
-    if (!linebuf.empty() && *(linebuf.end() - 1) == '\r') {
-      linebuf.resize(linebuf.size() - 1);
+    if (linelen > 0 && linebuf[linelen - 1] == '\r') {
+      linelen--;
     }
 
     // skip blank lines
-    if (linebuf.empty()) {
+    if (linelen == 0) {
       Format(cs_error, IDSC_IMPORTEMPTYLINESKIPPED, numlines);
       rpt.WriteLine(cs_error);
       numSkipped++;
       continue;
     }
 
-    // convert linebuf from UTF-8 to StringX
-    StringX slinebuf;
-    if (!conv.FromUTF8(reinterpret_cast<const unsigned char *>(linebuf.c_str()),
-                       linebuf.length(), slinebuf)) {
+    // tokenize into separate elements, each converted from UTF-8.
+    // An empty first field is dropped, as is an empty last one.
+    CTextImportFile::SplitLine(linebuf, linelen, sep, fields);
+    size_t nfields = fields.size();
+    if (nfields > 1 && fields[nfields - 1].len == 0)
+      nfields--;
+    bool bBadUTF8(false);
+    vector<stringT> tokens;
+    tokens.reserve(nfields);
+    for (itoken = 0; itoken < int(nfields); itoken++) {
+      const CTextImportFile::Field &field = fields[itoken];
+      if (itoken == 0 && field.len == 0)
+        continue;
+      if (itoken != i_Offset[NOTES]) {
+        tokens.push_back(stringT());
+        if (!file.Decode(field.p, field.len, tokens.back())) {
+          bBadUTF8 = true;
+          break;
+        }
+      } else {
+        // Notes field, the rest of the line, which may be double-quoted,
+        // and if it is, may span more than one line.
+        stringT note;
+        if (!file.Decode(field.p, linebuf + linelen - field.p, note)) {
+          bBadUTF8 = true;
+          break;
+        }
+        size_t nquotes = 0;
+        for (size_t i = itoken; i < fields.size(); i++)
+          nquotes += fields[i].nquotes;
+        if (nquotes == 1) {
+          //there was exactly one quote, meaning that we've a multi-line Note
+          bool noteClosed = false;
+          do {
+            if (!file.GetLine(linebuf, linelen)) {
+              Format(cs_error, IDSC_IMPMISSINGQUOTE, numlines);
+              rpt.WriteLine(cs_error);
+              return (numImported > 0) ? SUCCESS : INVALID_FORMAT;
+            }
+            numlines++;
+            // remove MS-DOS linebreaks, if needed.
+            if (linelen > 0 && linebuf[linelen - 1] == '\r') {
+              linelen--;
+            }
+            note += _T("\r\n");
+            stringT noteline;
+            if (!file.Decode(linebuf, linelen, noteline)) {
+              // XXX add an appropriate error message
+              numSkipped++;
+              continue;
+            }
+            note += noteline;
+            noteClosed = std::count(linebuf, linebuf + linelen, '\"') == 1;
+          } while (!noteClosed);
+        } // multiline note processed
+        tokens.push_back(note);
+        break;
+      } // Notes handling
+    } // tokenization loop
+
+    if (bBadUTF8) {
       // XXX add an appropriate error message
       numSkipped++;
       continue;
     }
 
-    // tokenize into separate elements
-    itoken = 0;
-    vector<stringT> tokens;
-    for (size_t startpos = 0;
-         startpos < slinebuf.size();
-         /* startpos advanced in body */) {
-      size_t nextchar = slinebuf.find_first_of(fieldSeparator, startpos);
-      if (nextchar == StringX::npos)
-        nextchar = slinebuf.size();
-      if (nextchar > 0) {
-        if (itoken != i_Offset[NOTES]) {
-          const StringX tsx(slinebuf.substr(startpos, nextchar - startpos));
-          tokens.push_back(tsx.c_str());
-        } else {
-          // Notes field which may be double-quoted, and
-          // if they are, they may span more than one line.
-          stringT note(slinebuf.substr(startpos).c_str());
-          size_t first_quote = note.find_first_of('\"');
-          size_t last_quote = note.find_last_of('\"');
-          if (first_quote == last_quote && first_quote != stringT::npos) {
-            //there was exactly one quote, meaning that we've a multi-line Note
-            bool noteClosed = false;
-            do {
-              if (!getline(iss, linebuf, '\n')) {
-                Format(cs_error, IDSC_IMPMISSINGQUOTE, numlines);
-                rpt.WriteLine(cs_error);
-                return (numImported > 0) ? SUCCESS : INVALID_FORMAT;
-              }
-              numlines++;
-              // remove MS-DOS linebreaks, if needed.
-              if (!linebuf.empty() && *(linebuf.end() - 1) == TCHAR('\r')) {
-                linebuf.resize(linebuf.size() - 1);
-              }
-              note += _T("\r\n");
-              if (!conv.FromUTF8(reinterpret_cast<const unsigned char *>(linebuf.c_str()),
-                                 linebuf.length(), slinebuf)) {
-                // XXX add an appropriate error message
-                numSkipped++;
-                continue;
-              }
-              note += slinebuf.c_str();
-              size_t fq = linebuf.find_first_of('\"');
-              size_t lq = linebuf.find_last_of('\"');
-              noteClosed = (fq == lq && fq != string::npos);
-            } while (!noteClosed);
-          } // multiline note processed
-          tokens.push_back(note);
-          break;
-        } // Notes handling
-      } // nextchar > 0
-      startpos = nextchar + 1; // too complex for the 'for statement'
-      itoken++;
-    } // tokenization for loop
-
     // Sanity check
     if (tokens.size() < num_found) {
       Format(cs_error, IDSC_IMPORTLINESKIPPED, numlines, tokens.size(), num_found);
@@ -1472,35 +1449,12 @@ int PWScore::ImportKeePassV1TXTFile(const StringX &filename,
   numImported  = numSkipped = numRenamed = 0;
   uiReasonCode = 0;
 
-  // We need to use FOpen as the file name/file path may contain non-Latin
-  // characters even though we need the file to contain ASCII and UTF-8 characters
-  // and not Unicode (wchar_t).
-  FILE *fs = pws_os::FOpen(filename.c_str(), _T("rt"));
-  if (fs == NULL)
+  // The file is mapped, and its lines taken from it in place
+  CTextImportFile file;
+  const int rc = file.Open(filename.c_str());
+  if (rc == CTextImportFile::CANT_OPEN)
     return CANT_OPEN_FILE;
-
-  // We need to use file stream I/O but can't with standard FILE I/O
-  // so read in whole file and put it in a StringXStream (may contain sensitive data).
-  // Hopefully, an import text file is not too large!
-  const size_t IMPORT_BUFFER_SIZE = 4096;
-
-  cStringXStream iss;
-  unsigned char buffer[IMPORT_BUFFER_SIZE + 1];
-  bool bError(false);
-  while(!feof(fs)) {
-    size_t count = fread(buffer, 1, IMPORT_BUFFER_SIZE, fs);
-    if (ferror(fs)) {
-      bError = true;
-      break;
-    }
-    buffer[count] = '\0';
-    iss << buffer;
-  }
-
-  // Close the file
-  fclose(fs);
-
-  if (bError) {
+  if (rc != CTextImportFile::SUCCESS) {
     uiReasonCode = IDSC_READ_ERROR;
     return FAILURE;
   }
@@ -1537,10 +1491,10 @@ int PWScore::ImportKeePassV1TXTFile(const StringX &filename,
     memset(ua, 0, sizeof(ua));
 
     // read a single line.
-    getline(iss, linebuf, '\n');
+    file.GetLine(linebuf);
 
     // Check if end of file
-    if (iss.eof())
+    if (file.EndOfFile())
       break;
 
     // Check if blank line
@@ -1572,10 +1526,10 @@ int PWScore::ImportKeePassV1TXTFile(const StringX &filename,
 
     bool bTitleFound(false);
     for (;;) {
-      streamoff currentpos = iss.tellg();
-      getline(iss, linebuf, '\n');
+      const size_t currentpos = file.GetPosition();
+      file.GetLine(linebuf);
 
-      if (iss.eof())
+      if (file.EndOfFile())
         break;
 
       // Check if blank line
@@ -1585,7 +1539,7 @@ int PWScore::ImportKeePassV1TXTFile(const StringX &filename,
       // Check if new entry
       if (*(linebuf.begin()) == '[' && *(linebuf.end() - 1) == ']') {
         // Ooops - go back
-        iss.seekg(currentpos);
+        file.SetPosition(currentpos);
         bTitleFound = true;
         break;
       }
@@ -1880,37 +1834,12 @@ int PWScore::ImportKeePassV1CSVFile(const StringX &filename,
   numImported  = numSkipped = numRenamed = 0;
   uiReasonCode = 0;
 
-  // We need to use FOpen as the file name/file path may contain non-Latin
-  // characters even though we need the file to contain ASCII and UTF-8 characters
-  // and not Unicode (wchar_t).
-  FILE *fs = pws_os::FOpen(filename.c_str(), _T("rt"));
-  if (fs == NULL)
+  // The file is mapped, and its lines taken from it in place
+  CTextImportFile file;
+  const int rc = file.Open(filename.c_str());
+  if (rc == CTextImportFile::CANT_OPEN)
     return CANT_OPEN_FILE;
-
-  // We need to use file stream I/O but can't with standard FILE I/O
-  // so read in whole file and put it in a StringXStream (may contain sensitive data).
-  // Hopefully, an import text file is not too large!
-  const size_t IMPORT_BUFFER_SIZE = 4096;
-
-  cStringXStream iss;
-  unsigned char buffer[IMPORT_BUFFER_SIZE + 1];
-  bool bError(false);
-  size_t total(0);
-  while(!feof(fs)) {
-    size_t count = fread(buffer, 1, IMPORT_BUFFER_SIZE, fs);
-    if (ferror(fs)) {
-      bError = true;
-      break;
-    }
-    buffer[count] = '\0';
-    iss << buffer;
-    total += count;
-  }
-
-  // Close the file
-  fclose(fs);
-
-  if (bError) {
+  if (rc != CTextImportFile::SUCCESS) {
     uiReasonCode = IDSC_READ_ERROR;
     return FAILURE;
   }
@@ -1952,7 +1881,7 @@ int PWScore::ImportKeePassV1CSVFile(const StringX &filename,
 
   string s_header, linebuf;
 
-  if (!getline(iss, s_header, '\n')) {
+  if (!file.GetLine(s_header)) {
     LoadAString(strError, IDSC_IMPORTNOCOLS);
     rpt.WriteLine(strError);
     uiReasonCode = IDSC_IMPORTABORTED;
@@ -2046,10 +1975,10 @@ int PWScore::ImportKeePassV1CSVFile(const StringX &filename,
     memset(ua, 0, sizeof(ua));
 
     // read a single line.
-    if (!getline(iss, linebuf, '\n')) break;
+    if (!file.GetLine(linebuf)) break;
 
     // Check if end of file
-    if (iss.eof())
+    if (file.EndOfFile())
       break;
 
     // skip blank lines
@@ -2373,3 +2302,279 @@ stringT PWScore::GetXMLPWPolicies(const OrderedItemList *pOIL)
   }
   return retval;
 }
+
+//-----------------------------------------------------------------------------
+// Delta files
+
+// Tags of their sealed files, as a database's is "LuM3"
+static const char DELTAMANIFESTTAG[] = "LuMm";
+static const char DELTATAG[] = "LuMd";
+
+int PWScore::WriteDeltaManifest(const StringX &filename)
+{
+  CDeltaManifest manifest;
+  manifest.SetFileUUID(GetFileUUID());
+
+  std::vector<char> record;
+  CDeltaManifest::FieldTags tags;
+  for (ItemListConstIter iter = m_pwlist.begin(); iter != m_pwlist.end(); iter++) {
+    const CItemData &ci = iter->second;
+    if (ci.IsDependent())
+      continue;
+    ci.SerializePlainText(record);
+    manifest.GetFieldTags(record, tags);
+    manifest.Add(iter->first, tags);
+    trashMemory(&record[0], record.size());
+  }
+
+  // The payload has the manifest's key
+  std::vector<unsigned char> payload;
+  manifest.Encode(payload);
+  const int status = PWSfileV3::WriteSealed(filename, GetPassKey(), DELTAMANIFESTTAG,
+                                            GetHashPasses(), GetHashMemKiB(), payload);
+  trashMemory(payload.data(), payload.size());
+  return status;
+}
+
+int PWScore::WriteDeltaFile(const StringX &filename, const StringX &manifest,
+                            const CItemData::FieldBits &bsFields, bool bUpdateManifest,
+                            int &numAdded, int &numModified, int &numDeleted)
+{
+  numAdded = numModified = numDeleted = 0;
+
+  const StringX passkey = GetPassKey();
+  std::vector<unsigned char> payload;
+  int status = PWSfileV3::ReadSealed(manifest, passkey, DELTAMANIFESTTAG, payload);
+  if (status != SUCCESS)
+    return status;
+
+  // As the manifests' payloads have their key, they're trashed once used
+  CDeltaManifest base;
+  const bool bDecoded = base.Decode(payload);
+  if (!payload.empty())
+    trashMemory(payload.data(), payload.size());
+  if (!bDecoded)
+    return INVALID_FORMAT;
+  if (base.GetFileUUID() != GetFileUUID())
+    return WRONG_DELTA_BASE;
+
+  std::vector<const CItemData *> vpci;
+  vpci.reserve(m_pwlist.size());
+  for (ItemListConstIter iter = m_pwlist.begin(); iter != m_pwlist.end(); iter++) {
+    if (!iter->second.IsDependent())
+      vpci.push_back(&iter->second);
+  }
+
+  CDelta delta;
+  CDeltaManifest current;
+  delta.Create(base, vpci.size(),
+               [&vpci](size_t i, CUUID &uuid, std::vector<char> &record) {
+                 uuid = vpci[i]->GetUUID();
+                 vpci[i]->SerializePlainText(record);
+               }, bsFields, bUpdateManifest ? &current : NULL);
+
+  const std::vector<CDelta::Change> &changes = delta.GetChanges();
+  for (size_t i = 0; i < changes.size(); i++) {
+    switch (changes[i].cd.indatabase) {
+      case CURRENT: numAdded++;    break;
+      case BOTH:    numModified++; break;
+      case COMPARE: numDeleted++;  break;
+    }
+  }
+
+  delta.Encode(payload);
+  status = PWSfileV3::WriteSealed(filename, passkey, DELTATAG,
+                                  GetHashPasses(), GetHashMemKiB(), payload);
+  trashMemory(payload.data(), payload.size());
+
+  if (status == SUCCESS && bUpdateManifest) {
+    current.Encode(payload);
+    status = PWSfileV3::WriteSealed(manifest, passkey, DELTAMANIFESTTAG,
+                                    GetHashPasses(), GetHashMemKiB(), payload);
+    trashMemory(payload.data(), payload.size());
+  }
+  return status;
+}
+
+int PWScore::ApplyDeltaFile(const StringX &filename,
+                            int &numAdded, int &numUpdated, int &numDeleted,
+                            int &numConflicts, CReport &rpt, Command *&pcommand)
+{
+  pcommand = NULL;
+  numAdded = numUpdated = numDeleted = numConflicts = 0;
+
+  std::vector<unsigned char> payload;
+  int status = PWSfileV3::ReadSealed(filename, GetPassKey(), DELTATAG, payload);
+  if (status != SUCCESS)
+    return status;
+
+  CDelta delta;
+  const bool bDecoded = delta.Decode(payload);
+  trashMemory(payload.data(), payload.size());
+  if (!bDecoded)
+    return INVALID_FORMAT;
+  if (delta.GetBaseUUID() != GetFileUUID())
+    return WRONG_DELTA_BASE;
+
+  MultiCommands *pmulticmds = MultiCommands::Create(this);
+  pcommand = pmulticmds;
+  Command *pcmd1 = UpdateGUICommand::Create(this, UpdateGUICommand::WN_UNDO,
+                                            UpdateGUICommand::GUI_UNDO_IMPORT);
+  pmulticmds->Add(pcmd1);
+
+  // Named policies and keyboard shortcuts aren't in deltas, so drop
+  // references to policies that aren't here, and shortcuts in use here or
+  // by an entry added before, as Merge does
+  StringX sx_imported;
+  LoadAString(sx_imported, IDSC_IMPORTED);
+  std::map<int32, StringX> mapKBShortcutsAdded;
+  auto CheckReferences = [&](CItemData &ci) {
+    PWPolicy pwp;
+    const StringX sxPolicyName = ci.GetPolicyName();
+    if (!sxPolicyName.empty() && !GetPolicyFromName(sxPolicyName, pwp))
+      ci.SetPolicyName(_T(""));
+    StringX sxEntry;
+    Format(sxEntry, GROUPTITLEUSERINCHEVRONS,
+           ci.GetGroup().c_str(), ci.GetTitle().c_str(), ci.GetUser().c_str());
+    CheckAddedKBShortcut(ci, sxEntry, mapKBShortcutsAdded, sx_imported, &rpt);
+  };
+
+  // Entries added, or whose group, title or user change, are renamed as
+  // imported ones are if another entry has the same group/title/user
+  GTUSet setGTU;
+  InitialiseGTU(setGTU);
+  auto MakeUnique = [&](CItemData &ci) {
+    const StringX sx_group = ci.GetGroup();
+    const StringX sx_title = ci.GetTitle();
+    const StringX sx_user = ci.GetUser();
+    StringX sxnewtitle(sx_title);
+    if (MakeEntryUnique(setGTU, sx_group, sxnewtitle, sx_user, IDSC_IMPORTNUMBER))
+      return;
+    ci.SetTitle(sxnewtitle);
+    stringT cs_header, cs_error;
+    if (sx_group.empty())
+      LoadAString(cs_header, IDSC_IMPORTCONFLICTSX2);
+    else
+      Format(cs_header, IDSC_IMPORTCONFLICTSX1, sx_group.c_str());
+    Format(cs_error, IDSC_IMPORTCONFLICTS0, cs_header.c_str(),
+           sx_title.c_str(), sx_user.c_str(), sxnewtitle.c_str());
+    rpt.WriteLine(cs_error);
+  };
+
+  std::vector<char> record;
+  const std::vector<CDelta::Change> &changes = delta.GetChanges();
+  for (size_t i = 0; i < changes.size(); i++) {
+    const CDelta::Change &change = changes[i];
+    ItemListConstIter iter = Find(change.cd.uuid0);
+    const CItemData *pci = iter == m_pwlist.end() ? NULL : &iter->second;
+    if (pci != NULL)
+      pci->SerializePlainText(record);
+
+    CItemData::FieldBits bsConflicts;
+    int check = delta.Check(change, pci == NULL ? NULL : &record, bsConflicts);
+    if (!record.empty())
+      trashMemory(&record[0], record.size());
+    if (check == CDelta::APPLIED)
+      continue;
+
+    // As Synchronize, protected entries are left alone, unless that's
+    // what's changing. Bases aren't deleted from under their dependents.
+    stringT str_conflicts;
+    if (check == CDelta::CONFLICT) {
+      for (size_t ft = 0; ft < bsConflicts.size(); ft++) {
+        if (bsConflicts.test(ft))
+          str_conflicts += CItemData::FieldName(CItemData::FieldType(ft)) + _T(", ");
+      }
+      if (str_conflicts.empty())
+        LoadAString(str_conflicts, IDSC_UNKNOWN);
+      else
+        str_conflicts.erase(str_conflicts.length() - 2);
+    } else if (pci != NULL && pci->IsProtected() &&
+               !change.cd.bsDiffs.test(CItemData::PROTECTED)) {
+      str_conflicts = CItemData::FieldName(CItemData::PROTECTED);
+    } else if (pci != NULL && pci->IsBase() && change.cd.indatabase == COMPARE) {
+      LoadAString(str_conflicts, pci->IsAliasBase() ? IDSC_ALIASES : IDSC_SHORTCUTS);
+    }
+
+    if (!str_conflicts.empty()) {
+      CItemData ci;
+      if (pci != NULL)
+        ci = *pci;
+      else
+        ci.DeSerializePlainText(change.record);
+      stringT strWarnMsg;
+      Format(strWarnMsg, IDSC_DELTACONFLICT, ci.GetGroup().c_str(),
+             ci.GetTitle().c_str(), ci.GetUser().c_str(), str_conflicts.c_str());
+      rpt.WriteLine(strWarnMsg);
+      numConflicts++;
+      continue;
+    }
+
+    Command *pcmd = NULL;
+    switch (change.cd.indatabase) {
+      case CURRENT:
+      {
+        CItemData ci;
+        if (!ci.DeSerializePlainText(change.record) || ci.GetUUID() != change.cd.uuid0) {
+          delete pmulticmds;
+          pcommand = NULL;
+          return INVALID_FORMAT;
+        }
+        MakeUnique(ci);
+        CheckReferences(ci);
+        ci.SetStatus(CItemData::ES_ADDED);
+        GUISetupDisplayInfo(ci);
+        pcmd = AddEntryCommand::Create(this, ci);
+        numAdded++;
+        break;
+      }
+      case BOTH:
+      {
+        CItemData updItem(*pci);
+        updItem.SetDisplayInfo(NULL);
+        for (size_t ft = 0; ft < change.cd.bsDiffs.size(); ft++) {
+          if (change.cd.bsDiffs.test(ft))
+            updItem.ClearField(CItemData::FieldType(ft));
+        }
+        if (!updItem.DeSerializePlainText(change.record)) {
+          delete pmulticmds;
+          pcommand = NULL;
+          return INVALID_FORMAT;
+        }
+        if (change.cd.bsDiffs.test(CItemData::GROUP) ||
+            change.cd.bsDiffs.test(CItemData::TITLE) ||
+            change.cd.bsDiffs.test(CItemData::USER)) {
+          setGTU.erase(st_GroupTitleUser(pci->GetGroup(), pci->GetTitle(),
+                                         pci->GetUser()));
+          MakeUnique(updItem);
+        }
+        CheckReferences(updItem);
+        updItem.SetStatus(CItemData::ES_MODIFIED);
+        GUISetupDisplayInfo(updItem);
+        pcmd = EditEntryCommand::Create(this, *pci, updItem);
+        numUpdated++;
+        break;
+      }
+      case COMPARE:
+        setGTU.erase(st_GroupTitleUser(pci->GetGroup(), pci->GetTitle(),
+                                       pci->GetUser()));
+        pcmd = DeleteEntryCommand::Create(this, *pci);
+        numDeleted++;
+        break;
+    }
+    pcmd->SetNoGUINotify();
+    pmulticmds->Add(pcmd);
+  }
+
+  Command *pcmd2 = UpdateGUICommand::Create(this, UpdateGUICommand::WN_EXECUTE_REDO,
+                                            UpdateGUICommand::GUI_REDO_IMPORT);
+  pmulticmds->Add(pcmd2);
+
+  stringT str_results, str_conflicts;
+  LoadAString(str_conflicts, numConflicts == 1 ? IDSC_CONFLICT : IDSC_CONFLICTS);
+  Format(str_results, IDSC_DELTACOMPLETED, numAdded, numUpdated, numDeleted,
+         numConflicts, str_conflicts.c_str());
+  rpt.WriteLine(str_results);
+
+  return numConflicts == 0 ? SUCCESS : OK_WITH_ERRORS;
+}
@@ -20,6 +20,7 @@
 #include "Report.h"
 #include "StringXStream.h"
 #include "DBCompareData.h"
+#include "ParallelScan.h"
 
 #include "os/typedefs.h"
 
@@ -27,6 +28,8 @@
 #include <vector>
 #include <algorithm>
 #include <set>
+#include <unordered_map>
+#include <unordered_set>
 
 using namespace std;
 
@@ -57,17 +60,264 @@ static void CompareField(CItemData::FieldType field,
   }
 }
 
+namespace {
+  // An entry's group, title & user, pointing into its fields (or the
+  // strings given)
+  struct GTUKey {
+    explicit GTUKey(const CItemData &ci)
+    {
+      ci.GetFieldText(CItemData::GROUP, pText[0], len[0]);
+      ci.GetFieldText(CItemData::TITLE, pText[1], len[1]);
+      ci.GetFieldText(CItemData::USER, pText[2], len[2]);
+    }
+    GTUKey(const StringX &sxGroup, const StringX &sxTitle, const StringX &sxUser)
+    {
+      pText[0] = sxGroup.c_str(); len[0] = sxGroup.length();
+      pText[1] = sxTitle.c_str(); len[1] = sxTitle.length();
+      pText[2] = sxUser.c_str(); len[2] = sxUser.length();
+    }
+    bool operator==(const GTUKey &that) const
+    {
+      for (int i = 0; i < 3; i++)
+        if (len[i] != that.len[i] ||
+            !std::equal(pText[i], pText[i] + len[i], that.pText[i]))
+          return false;
+      return true;
+    }
+
+    const TCHAR *pText[3];
+    size_t len[3];
+  };
+
+  struct GTUKeyHash {
+    // FNV-1a, with the lengths keeping "ab"/"c" apart from "a"/"bc"
+    size_t operator()(const GTUKey &key) const
+    {
+      uint64 h = 14695981039346656037ULL;
+      for (int i = 0; i < 3; i++) {
+        for (size_t j = 0; j < key.len[i]; j++) {
+          h ^= static_cast<uint64>(key.pText[i][j]);
+          h *= 1099511628211ULL;
+        }
+        h ^= key.len[i];
+        h *= 1099511628211ULL;
+      }
+      return static_cast<size_t>(h);
+    }
+  };
+}
+
+// A database's entries by group, title & user, so that finding entries
+// of one database in another (Compare, Merge & Synchronize) needn't
+// search it for each. Only valid while none of the entries is added,
+// removed or changed, as the keys point into the entries' fields.
+class CGTUIndex
+{
+public:
+  explicit CGTUIndex(PWScore *pcore) : m_end(pcore->GetEntryEndIter())
+  {
+    // Keeps the first entry with each group/title/user, i.e., the one
+    // that PWScore::Find(group, title, user) finds
+    m_index.reserve(pcore->GetNumEntries());
+    for (ItemListIter iter = pcore->GetEntryIter(); iter != m_end; iter++)
+      m_index.emplace(GTUKey(pcore->GetEntry(iter)), iter);
+  }
+
+  // As PWScore::Find(group, title, user)
+  ItemListIter Find(const CItemData &ci) const
+  {return Find(GTUKey(ci));}
+  ItemListIter Find(const StringX &sxGroup, const StringX &sxTitle,
+                    const StringX &sxUser) const
+  {return Find(GTUKey(sxGroup, sxTitle, sxUser));}
+
+private:
+  ItemListIter Find(const GTUKey &key) const
+  {
+    Index::const_iterator iter = m_index.find(key);
+    return iter == m_index.end() ? m_end : iter->second;
+  }
+
+  typedef std::unordered_map<GTUKey, ItemListIter, GTUKeyHash> Index;
+  Index m_index;
+  const ItemListIter m_end;
+};
+
+bool PWScore::FindAllInOther(PWScore *pothercore, const bool &subgroup_bset,
+                             const PWSMatch::CCompiledMatch &subgroup,
+                             const int &subgroup_object,
+                             std::vector<ItemListIter> &vFound, bool *pbCancel,
+                             const CParallelScan::ProgressFn &progress)
+{
+  // For each of our entries in the subgroup, the entry with the same
+  // group/title/user in the other database, if any (else its end).
+  // A hash join: the other database is indexed once, rather than
+  // searched entry by entry for each of ours.
+  const CGTUIndex other(pothercore);
+
+  std::vector<const CItemData *> vpci;
+  GetEntryPointers(vpci);
+  vFound.assign(vpci.size(), pothercore->GetEntryEndIter());
+
+  // Each chunk sets its own elements of vFound, the index is only read
+  return CParallelScan().Run(vpci.size(),
+    [&](size_t first, size_t last, size_t) {
+      for (size_t i = first; i < last; i++) {
+        const CItemData &ci = *vpci[i];
+        if (!subgroup_bset || ci.Matches(subgroup, subgroup_object))
+          vFound[i] = other.Find(ci);
+      }
+      return true;
+    }, pbCancel, progress);
+}
+
 /*
  * XXX Logic of comparing two entries should really be moved to CItemData
  */
 
+// Sets the fields of bsFields in which currentItem of pcurrent differs
+// from compItem of pcomp. Only decodes fields of these two entries, so
+// may be run in parallel with other pairs of entries.
+static void CompareEntries(PWScore *pcurrent, const CItemData &currentItem,
+                           PWScore *pcomp, const CItemData &compItem,
+                           const CItemData::FieldBits &bsFields,
+                           const bool &bTreatWhiteSpaceasEmpty,
+                           const PWPolicy &cur_default_pwp,
+                           const PWPolicy &cmp_default_pwp,
+                           CItemData::FieldBits &bsConflicts)
+{
+  // Difference flags:
+  /*
+   First byte (values in square brackets taken from ItemData.h)
+   1... ....  NAME       [0x00] - n/a - depreciated
+   .1.. ....  UUID       [0x01] - n/a - unique
+   ..1. ....  GROUP      [0x02] - not checked - must be identical
+   ...1 ....  TITLE      [0x03] - not checked - must be identical
+   .... 1...  USER       [0x04] - not checked - must be identical
+   .... .1..  NOTES      [0x05]
+   .... ..1.  PASSWORD   [0x06]
+   .... ...1  CTIME      [0x07] - not checked by default
+
+   Second byte
+   1... ....  PMTIME     [0x08] - not checked by default
+   .1.. ....  ATIME      [0x09] - not checked by default
+   ..1. ....  XTIME      [0x0a] - not checked by default
+   ...1 ....  RESERVED   [0x0b] - not used
+   .... 1...  RMTIME     [0x0c] - not checked by default
+   .... .1..  URL        [0x0d]
+   .... ..1.  AUTOTYPE   [0x0e]
+   .... ...1  PWHIST     [0x0f]
+
+   Third byte
+   1... ....  POLICY     [0x10] - not checked by default
+   .1.. ....  XTIME_INT  [0x11] - not checked by default
+   ..1. ....  RUNCMD     [0x12]
+   ...1 ....  DCA        [0x13]
+   .... 1...  EMAIL      [0x14]
+   .... .1..  PROTECTED  [0x15]
+   .... ..1.  SYMBOLS    [0x16]
+   .... ...1  SHIFTDCA   [0x17]
+
+   Fourth byte
+   1... ....  POLICYNAME [0x18] - not checked by default
+   .1.. ....  KBSHORTCUT [0x19] - not checked by default
+  */
+  bsConflicts.reset();
+
+  // Entries with the same fingerprint have the same values in the fields
+  // that depend only on the entry, so then only the rest - the password
+  // of a dependent's base, the policy that may be the default - need
+  // comparing
+  CItemData::FieldBits bsTest(bsFields), bsOwn(bsFields);
+  bsOwn.reset(CItemData::GROUPTITLE);
+  bsOwn.reset(CItemData::UUID);
+  bsOwn.reset(CItemData::GROUP);
+  bsOwn.reset(CItemData::TITLE);
+  bsOwn.reset(CItemData::USER);
+  bsOwn.reset(CItemData::POLICY);
+  if (currentItem.IsDependent() || compItem.IsDependent())
+    bsOwn.reset(CItemData::PASSWORD);
+  if (bsOwn.any() &&
+      currentItem.GetFingerprint(bsOwn) == compItem.GetFingerprint(bsOwn))
+    bsTest &= ~bsOwn;
+
+  StringX sxCurrentPassword, sxComparisonPassword;
+
+  if (currentItem.IsDependent()) {
+    CItemData *pci_base = pcurrent->GetBaseEntry(&currentItem);
+    sxCurrentPassword = pci_base->GetPassword();
+  } else
+    sxCurrentPassword = currentItem.GetPassword();
+
+  if (compItem.IsDependent()) {
+    CItemData *pci_base = pcomp->GetBaseEntry(&compItem);
+    sxComparisonPassword = pci_base->GetPassword();
+  } else
+    sxComparisonPassword = compItem.GetPassword();
+
+  if (bsTest.test(CItemData::PASSWORD) &&
+      sxCurrentPassword != sxComparisonPassword)
+    bsConflicts.flip(CItemData::PASSWORD);
+
+  CompareField(CItemData::NOTES, bsTest, currentItem, compItem,
+               bsConflicts, bTreatWhiteSpaceasEmpty);
+  CompareField(CItemData::CTIME, bsTest, currentItem, compItem, bsConflicts);
+  CompareField(CItemData::PMTIME, bsTest, currentItem, compItem, bsConflicts);
+  CompareField(CItemData::ATIME, bsTest, currentItem, compItem, bsConflicts);
+  CompareField(CItemData::XTIME, bsTest, currentItem, compItem, bsConflicts);
+  CompareField(CItemData::RMTIME, bsTest, currentItem, compItem, bsConflicts);
+
+  if (bsTest.test(CItemData::XTIME_INT)) {
+    int32 current_xint, comp_xint;
+    currentItem.GetXTimeInt(current_xint);
+    compItem.GetXTimeInt(comp_xint);
+    if (current_xint != comp_xint)
+      bsConflicts.flip(CItemData::XTIME_INT);
+  }
+
+  CompareField(CItemData::URL, bsTest, currentItem, compItem,
+               bsConflicts, bTreatWhiteSpaceasEmpty);
+  CompareField(CItemData::AUTOTYPE, bsTest, currentItem, compItem,
+               bsConflicts, bTreatWhiteSpaceasEmpty);
+  CompareField(CItemData::PWHIST, bsTest, currentItem, compItem, bsConflicts);
+  CompareField(CItemData::POLICYNAME, bsTest, currentItem, compItem, bsConflicts);
+
+  // Don't test policy or symbols if either entry is using a named policy
+  // as these are meaningless to compare
+  if (currentItem.GetPolicyName().empty() && compItem.GetPolicyName().empty()) {
+    if (bsTest.test(CItemData::POLICY)) {
+      PWPolicy cur_pwp, cmp_pwp;
+      if (currentItem.GetPWPolicy().empty())
+        cur_pwp = cur_default_pwp;
+      else
+        currentItem.GetPWPolicy(cur_pwp);
+      if (compItem.GetPWPolicy().empty())
+        cmp_pwp = cmp_default_pwp;
+      else
+        compItem.GetPWPolicy(cmp_pwp);
+      if (cur_pwp != cmp_pwp)
+        bsConflicts.flip(CItemData::POLICY);
+    }
+    CompareField(CItemData::SYMBOLS, bsTest, currentItem, compItem, bsConflicts);
+  }
+
+  CompareField(CItemData::RUNCMD, bsTest, currentItem, compItem, bsConflicts);
+  CompareField(CItemData::DCA, bsTest, currentItem, compItem, bsConflicts);
+  CompareField(CItemData::SHIFTDCA, bsTest, currentItem, compItem, bsConflicts);
+  CompareField(CItemData::EMAIL, bsTest, currentItem, compItem, bsConflicts);
+  CompareField(CItemData::PROTECTED, bsTest, currentItem, compItem, bsConflicts);
+
+  if (bsTest.test(CItemData::KBSHORTCUT) &&
+      currentItem.GetKBShortcut() != compItem.GetKBShortcut())
+    bsConflicts.flip(CItemData::KBSHORTCUT);
+}
+
 void PWScore::Compare(PWScore *pothercore,
                       const CItemData::FieldBits &bsFields, const bool &subgroup_bset,
                       const bool &bTreatWhiteSpaceasEmpty,  const stringT &subgroup_name,
                       const int &subgroup_object, const int &subgroup_function,
                       CompareData &list_OnlyInCurrent, CompareData &list_OnlyInComp,
                       CompareData &list_Conflicts, CompareData &list_Identical,
-                      bool *pbCancel)
+                      bool *pbCancel, const CompareProgressFn &progress)
 {
   /*
   Purpose:
@@ -94,14 +344,79 @@ void PWScore::Compare(PWScore *pothercore,
     }
   */
 
-  CItemData::FieldBits bsConflicts(0);
   st_CompareData st_data;
   int numOnlyInCurrent(0), numOnlyInComp(0), numConflicts(0), numIdentical(0);
 
+  // Finding the entries and comparing their fields is what takes the
+  // time, so both are done up front, in parallel: each database's
+  // entries are found in the other's by a hash join, then each pair found
+  // is compared. The loops below then list the results in entry order,
+  // as before. Progress is reported over the finding in both directions
+  // and the comparing.
+  const size_t ncurrent = GetNumEntries(), ncomp = pothercore->GetNumEntries();
+  const size_t nsteps = ncurrent + ncomp + ncurrent;
+  CParallelScan::ProgressFn findProgress, compProgress, diffProgress;
+  if (progress) {
+    findProgress = [&](size_t done) {progress(done, nsteps);};
+    compProgress = [&](size_t done) {progress(ncurrent + done, nsteps);};
+    diffProgress = [&](size_t done) {progress(ncurrent + ncomp + done, nsteps);};
+  }
+
+  const PWSMatch::CCompiledMatch subgroup = subgroup_bset ?
+    PWSMatch::CCompiledMatch(std2stringx(subgroup_name), subgroup_function) :
+    PWSMatch::CCompiledMatch();
+  std::vector<ItemListIter> vFoundInComp, vFoundInCurrent;
+  if (!FindAllInOther(pothercore, subgroup_bset, subgroup,
+                      subgroup_object, vFoundInComp, pbCancel, findProgress) ||
+      !pothercore->FindAllInOther(this, subgroup_bset, subgroup,
+                                  subgroup_object, vFoundInCurrent, pbCancel,
+                                  compProgress))
+    return;
+
+  // A thread may only decode fields of its own entries, so an entry of
+  // the other database found for more than one of ours, and any pair when
+  // comparing a database with itself, is compared afterwards on this one
+  std::vector<const CItemData *> vpci;
+  GetEntryPointers(vpci);
+  std::vector<CItemData::FieldBits> vDiffs(vpci.size());
+  std::vector<size_t> vSerial;
+  std::vector<bool> vParallel(vpci.size(), false);
+  std::unordered_set<const CItemData *> sCompFound;
+  for (size_t i = 0; i < vpci.size(); i++) {
+    if (vFoundInComp[i] == pothercore->GetEntryEndIter())
+      continue;
+    if (pothercore != this && sCompFound.insert(&vFoundInComp[i]->second).second)
+      vParallel[i] = true;
+    else
+      vSerial.push_back(i);
+  }
+
+  const PWPolicy cur_default_pwp = PWSprefs::GetInstance()->GetDefaultPolicy();
+  const PWPolicy cmp_default_pwp = PWSprefs::GetInstance()->GetDefaultPolicy(true);
+
+  if (!CParallelScan().Run(vpci.size(),
+        [&](size_t first, size_t last, size_t) {
+          for (size_t i = first; i < last; i++) {
+            if (vParallel[i])
+              CompareEntries(this, *vpci[i], pothercore, vFoundInComp[i]->second,
+                             bsFields, bTreatWhiteSpaceasEmpty,
+                             cur_default_pwp, cmp_default_pwp, vDiffs[i]);
+          }
+          return true;
+        }, pbCancel, diffProgress))
+    return;
+
+  for (size_t i = 0; i < vSerial.size(); i++)
+    CompareEntries(this, *vpci[vSerial[i]], pothercore,
+                   vFoundInComp[vSerial[i]]->second,
+                   bsFields, bTreatWhiteSpaceasEmpty,
+                   cur_default_pwp, cmp_default_pwp, vDiffs[vSerial[i]]);
+
+  size_t icurrent(0), icomp(0);
   ItemListIter currentPos;
   for (currentPos = GetEntryIter();
        currentPos != GetEntryEndIter();
-       currentPos++) {
+       currentPos++, icurrent++) {
     // See if user has cancelled
     if (pbCancel != NULL && *pbCancel) {
       return;
@@ -111,8 +426,7 @@ void PWScore::Compare(PWScore *pothercore,
     const CItemData &currentItem = GetEntry(currentPos);
 
     if (!subgroup_bset ||
-        currentItem.Matches(std::wstring(subgroup_name), subgroup_object,
-                            subgroup_function)) {
+        currentItem.Matches(subgroup, subgroup_object)) {
       st_data.group = currentItem.GetGroup();
       st_data.title = currentItem.GetTitle();
       st_data.user = currentItem.GetUser();
@@ -124,120 +438,11 @@ void PWScore::Compare(PWScore *pothercore,
       // Update the Wizard page
       UpdateWizard(sx_original.c_str());
 
-      ItemListIter foundPos = pothercore->Find(st_data.group,
-                                               st_data.title, st_data.user);
+      ItemListIter foundPos = vFoundInComp[icurrent];
       if (foundPos != pothercore->GetEntryEndIter()) {
-        // found a match, see if all other fields also match
-        // Difference flags:
-        /*
-         First byte (values in square brackets taken from ItemData.h)
-         1... ....  NAME       [0x00] - n/a - depreciated
-         .1.. ....  UUID       [0x01] - n/a - unique
-         ..1. ....  GROUP      [0x02] - not checked - must be identical
-         ...1 ....  TITLE      [0x03] - not checked - must be identical
-         .... 1...  USER       [0x04] - not checked - must be identical
-         .... .1..  NOTES      [0x05]
-         .... ..1.  PASSWORD   [0x06]
-         .... ...1  CTIME      [0x07] - not checked by default
-
-         Second byte
-         1... ....  PMTIME     [0x08] - not checked by default
-         .1.. ....  ATIME      [0x09] - not checked by default
-         ..1. ....  XTIME      [0x0a] - not checked by default
-         ...1 ....  RESERVED   [0x0b] - not used
-         .... 1...  RMTIME     [0x0c] - not checked by default
-         .... .1..  URL        [0x0d]
-         .... ..1.  AUTOTYPE   [0x0e]
-         .... ...1  PWHIST     [0x0f]
-
-         Third byte
-         1... ....  POLICY     [0x10] - not checked by default
-         .1.. ....  XTIME_INT  [0x11] - not checked by default
-         ..1. ....  RUNCMD     [0x12]
-         ...1 ....  DCA        [0x13]
-         .... 1...  EMAIL      [0x14]
-         .... .1..  PROTECTED  [0x15]
-         .... ..1.  SYMBOLS    [0x16]
-         .... ...1  SHIFTDCA   [0x17]
-
-         Fourth byte
-         1... ....  POLICYNAME [0x18] - not checked by default
-         .1.. ....  KBSHORTCUT [0x19] - not checked by default
-
-
-        */
-        bsConflicts.reset();
-        StringX sxCurrentPassword, sxComparisonPassword;
-
+        // found a match, fields compared above
         const CItemData &compItem = pothercore->GetEntry(foundPos);
-
-        if (currentItem.IsDependent()) {
-          CItemData *pci_base = GetBaseEntry(&currentItem);
-          sxCurrentPassword = pci_base->GetPassword();
-        } else
-          sxCurrentPassword = currentItem.GetPassword();
-
-        if (compItem.IsDependent()) {
-          CItemData *pci_base = pothercore->GetBaseEntry(&compItem);
-          sxComparisonPassword = pci_base->GetPassword();
-        } else
-          sxComparisonPassword = compItem.GetPassword();
-
-        if (bsFields.test(CItemData::PASSWORD) &&
-            sxCurrentPassword != sxComparisonPassword)
-          bsConflicts.flip(CItemData::PASSWORD);
-
-        CompareField(CItemData::NOTES, bsFields, currentItem, compItem,
-                     bsConflicts, bTreatWhiteSpaceasEmpty);
-        CompareField(CItemData::CTIME, bsFields, currentItem, compItem, bsConflicts);
-        CompareField(CItemData::PMTIME, bsFields, currentItem, compItem, bsConflicts);
-        CompareField(CItemData::ATIME, bsFields, currentItem, compItem, bsConflicts);
-        CompareField(CItemData::XTIME, bsFields, currentItem, compItem, bsConflicts);
-        CompareField(CItemData::RMTIME, bsFields, currentItem, compItem, bsConflicts);
-
-        if (bsFields.test(CItemData::XTIME_INT)) {
-          int32 current_xint, comp_xint;
-          currentItem.GetXTimeInt(current_xint);
-          compItem.GetXTimeInt(comp_xint);
-          if (current_xint != comp_xint)
-            bsConflicts.flip(CItemData::XTIME_INT);
-        }
-
-        CompareField(CItemData::URL, bsFields, currentItem, compItem,
-                     bsConflicts, bTreatWhiteSpaceasEmpty);
-        CompareField(CItemData::AUTOTYPE, bsFields, currentItem, compItem,
-                     bsConflicts, bTreatWhiteSpaceasEmpty);
-        CompareField(CItemData::PWHIST, bsFields, currentItem, compItem, bsConflicts);
-        CompareField(CItemData::POLICYNAME, bsFields, currentItem, compItem, bsConflicts);
-
-        // Don't test policy or symbols if either entry is using a named policy
-        // as these are meaningless to compare
-        if (currentItem.GetPolicyName().empty() && compItem.GetPolicyName().empty()) {
-          if (bsFields.test(CItemData::POLICY)) {
-            PWPolicy cur_pwp, cmp_pwp;
-            if (currentItem.GetPWPolicy().empty())
-              cur_pwp = PWSprefs::GetInstance()->GetDefaultPolicy();
-            else
-              currentItem.GetPWPolicy(cur_pwp);
-            if (compItem.GetPWPolicy().empty())
-              cmp_pwp = PWSprefs::GetInstance()->GetDefaultPolicy(true);
-            else
-              compItem.GetPWPolicy(cmp_pwp);
-            if (cur_pwp != cmp_pwp)
-              bsConflicts.flip(CItemData::POLICY);
-          }
-          CompareField(CItemData::SYMBOLS, bsFields, currentItem, compItem, bsConflicts);
-        }
-
-        CompareField(CItemData::RUNCMD, bsFields, currentItem, compItem, bsConflicts);
-        CompareField(CItemData::DCA, bsFields, currentItem, compItem, bsConflicts);
-        CompareField(CItemData::SHIFTDCA, bsFields, currentItem, compItem, bsConflicts);
-        CompareField(CItemData::EMAIL, bsFields, currentItem, compItem, bsConflicts);
-        CompareField(CItemData::PROTECTED, bsFields, currentItem, compItem, bsConflicts);
-
-        if (bsFields.test(CItemData::KBSHORTCUT) &&
-            currentItem.GetKBShortcut() != compItem.GetKBShortcut())
-          bsConflicts.flip(CItemData::KBSHORTCUT);
+        const CItemData::FieldBits &bsConflicts = vDiffs[icurrent];
 
         st_data.uuid0 = currentPos->first;
         st_data.uuid1 = foundPos->first;
@@ -274,18 +479,17 @@ void PWScore::Compare(PWScore *pothercore,
   ItemListIter compPos;
   for (compPos = pothercore->GetEntryIter();
        compPos != pothercore->GetEntryEndIter();
-       compPos++) {
+       compPos++, icomp++) {
     // See if user has cancelled
     if (pbCancel != NULL && *pbCancel) {
       return;
     }
 
     st_data.Empty();
-    CItemData compItem = pothercore->GetEntry(compPos);
+    const CItemData &compItem = pothercore->GetEntry(compPos);
 
     if (!subgroup_bset ||
-        compItem.Matches(std::wstring(subgroup_name), subgroup_object,
-                         subgroup_function)) {
+        compItem.Matches(subgroup, subgroup_object)) {
       st_data.group = compItem.GetGroup();
       st_data.title = compItem.GetTitle();
       st_data.user = compItem.GetUser();
@@ -297,8 +501,7 @@ void PWScore::Compare(PWScore *pothercore,
       // Update the Wizard page
       UpdateWizard(sx_compare.c_str());
 
-      if (Find(st_data.group, st_data.title, st_data.user) ==
-          GetEntryEndIter()) {
+      if (vFoundInCurrent[icomp] == GetEntryEndIter()) {
         // Didn't find any match...
         numOnlyInComp++;
         st_data.uuid0 = CUUID::NullUUID();
@@ -419,6 +622,17 @@ stringT PWScore::Merge(PWScore *pothercore,
                                             UpdateGUICommand::GUI_UNDO_MERGESYNC);
   pmulticmds->Add(pcmd1);
 
+  const PWSMatch::CCompiledMatch subgroup = subgroup_bset ?
+    PWSMatch::CCompiledMatch(std2stringx(subgroup_name), subgroup_function) :
+    PWSMatch::CCompiledMatch();
+
+  // Our entries aren't changed until pmulticmds is executed, at the end,
+  // so can be indexed once for all the other database's entries
+  const CGTUIndex current(this);
+
+  // Keyboard shortcuts of the entries to be added so far, with the entry
+  std::map<int32, StringX> mapKBShortcutsAdded;
+
   ItemListConstIter otherPos;
   for (otherPos = pothercore->GetEntryIter();
        otherPos != pothercore->GetEntryEndIter();
@@ -432,18 +646,12 @@ stringT PWScore::Merge(PWScore *pothercore,
     CItemData otherItem = pothercore->GetEntry(otherPos);
     CItemData::EntryType et = otherItem.GetEntryType();
 
-    // Need to check that entry keyboard shortcut not already in use!
-    int32 iKBShortcut;
-    otherItem.GetKBShortcut(iKBShortcut);
-    CUUID kbshortcut_uuid = GetKBShortcut(iKBShortcut);
-    bool bKBShortcutInUse = (iKBShortcut != 0&& kbshortcut_uuid != CUUID::NullUUID());
-
     // Handle Aliases and Shortcuts when processing their base entries
     if (otherItem.IsDependent())
       continue;
 
     if (subgroup_bset &&
-        !otherItem.Matches(subgroup_name, subgroup_object, subgroup_function))
+        !otherItem.Matches(subgroup, subgroup_object))
       continue;
 
     const StringX sx_otherGroup = otherItem.GetGroup();
@@ -454,7 +662,7 @@ stringT PWScore::Merge(PWScore *pothercore,
     Format(sxMergedEntry, GROUPTITLEUSERINCHEVRONS,
                 sx_otherGroup.c_str(), sx_otherTitle.c_str(), sx_otherUser.c_str());
 
-    ItemListConstIter foundPos = Find(sx_otherGroup, sx_otherTitle, sx_otherUser);
+    ItemListConstIter foundPos = current.Find(otherItem);
 
     otherItem.GetUUID(base_uuid);
     memcpy(new_base_uuid, base_uuid, sizeof(new_base_uuid));
@@ -462,7 +670,7 @@ stringT PWScore::Merge(PWScore *pothercore,
 
     if (foundPos != GetEntryEndIter()) {
       // Found a match, see if other fields also match
-      CItemData curItem = GetEntry(foundPos);
+      const CItemData &curItem = GetEntry(foundPos);
 
       // Can't merge into a protected entry.  If we were going to - add instead
       unsigned char ucprotected;
@@ -632,22 +840,9 @@ stringT PWScore::Merge(PWScore *pothercore,
           pmulticmds->Add(pPolicyCmd);
 
         // About to add entry - check keyboard shortcut
-        if (bKBShortcutInUse) {
-          // Remove it
-          otherItem.SetKBShortcut(0);
-          //  Tell user via the report
-          ItemListIter iter = Find(kbshortcut_uuid);
-          if (iter != m_pwlist.end()) {
-            StringX sxTemp, sxExistingEntry;
-            Format(sxExistingEntry, GROUPTITLEUSERINCHEVRONS,
-                iter->second.GetGroup().c_str(), iter->second.GetTitle().c_str(),
-                iter->second.GetUser().c_str());
-            Format(sxTemp, IDSC_KBSHORTCUT_REMOVED, sx_merged.c_str(), sxMergedEntry.c_str(),
-                          sxExistingEntry.c_str(), sx_merged.c_str());
-            pRpt->WriteLine(sxTemp.c_str());
-          }
-        }
-        
+        CheckAddedKBShortcut(otherItem, sxMergedEntry, mapKBShortcutsAdded,
+                             sx_merged, pRpt);
+
         otherItem.SetTitle(sx_newTitle);
         otherItem.SetStatus(CItemData::ES_ADDED);
         Command *pcmd = AddEntryCommand::Create(this, otherItem);
@@ -680,22 +875,9 @@ stringT PWScore::Merge(PWScore *pothercore,
         pmulticmds->Add(pPolicyCmd);
 
       // About to add entry - check keyboard shortcut
-      if (bKBShortcutInUse) {
-        // Remove it
-        otherItem.SetKBShortcut(0);
-        //  Tell user via the report
-        ItemListIter iter = Find(kbshortcut_uuid);
-        if (iter != m_pwlist.end()) {
-          StringX sxTemp, sxExistingEntry;
-          Format(sxExistingEntry, GROUPTITLEUSERINCHEVRONS,
-                iter->second.GetGroup().c_str(), iter->second.GetTitle().c_str(),
-                iter->second.GetUser().c_str());
-          Format(sxTemp, IDSC_KBSHORTCUT_REMOVED, sx_merged.c_str(), sxMergedEntry.c_str(),
-                        sxExistingEntry.c_str(), sx_merged.c_str());
-          pRpt->WriteLine(sxTemp.c_str());
-        }
-      }
-      
+      CheckAddedKBShortcut(otherItem, sxMergedEntry, mapKBShortcutsAdded,
+                           sx_merged, pRpt);
+
       otherItem.SetStatus(CItemData::ES_ADDED);
       Command *pcmd = AddEntryCommand::Create(this, otherItem);
       pcmd->SetNoGUINotify();
@@ -712,13 +894,13 @@ stringT PWScore::Merge(PWScore *pothercore,
     }
 
     if (et == CItemData::ET_ALIASBASE)
-      numAliasesAdded += MergeDependents(pothercore, pmulticmds,
+      numAliasesAdded += MergeDependents(pothercore, current, pmulticmds,
                       base_uuid, new_base_uuid,
                       bTitleRenamed, str_timestring, CItemData::ET_ALIAS,
                       vs_AliasesAdded);
 
     if (et == CItemData::ET_SHORTCUTBASE)
-      numShortcutsAdded += MergeDependents(pothercore, pmulticmds,
+      numShortcutsAdded += MergeDependents(pothercore, current, pmulticmds,
                       base_uuid, new_base_uuid,
                       bTitleRenamed, str_timestring, CItemData::ET_SHORTCUT,
                       vs_ShortcutsAdded);
@@ -801,7 +983,48 @@ stringT PWScore::Merge(PWScore *pothercore,
   return str_results;
 }
 
-int PWScore::MergeDependents(PWScore *pothercore, MultiCommands *pmulticmds,
+void PWScore::CheckAddedKBShortcut(CItemData &item, const StringX &sxEntry,
+                                   std::map<int32, StringX> &mapKBShortcutsAdded,
+                                   const StringX &sxAdded, CReport *pRpt)
+{
+  int32 iKBShortcut;
+  item.GetKBShortcut(iKBShortcut);
+  if (iKBShortcut == 0)
+    return;
+
+  StringX sxExistingEntry;
+  const CUUID kbshortcut_uuid = GetKBShortcut(iKBShortcut);
+  if (kbshortcut_uuid == item.GetUUID()) {
+    return; // An entry being changed that already has it
+  } else if (kbshortcut_uuid != CUUID::NullUUID()) {
+    ItemListIter iter = Find(kbshortcut_uuid);
+    if (iter != m_pwlist.end())
+      Format(sxExistingEntry, GROUPTITLEUSERINCHEVRONS,
+          iter->second.GetGroup().c_str(), iter->second.GetTitle().c_str(),
+          iter->second.GetUser().c_str());
+  } else {
+    std::map<int32, StringX>::const_iterator iter =
+      mapKBShortcutsAdded.find(iKBShortcut);
+    if (iter == mapKBShortcutsAdded.end()) {
+      mapKBShortcutsAdded[iKBShortcut] = sxEntry;
+      return;
+    }
+    sxExistingEntry = iter->second;
+  }
+
+  // Remove it
+  item.SetKBShortcut(0);
+  //  Tell user via the report
+  if (!sxExistingEntry.empty() && pRpt != NULL) {
+    StringX sxTemp;
+    Format(sxTemp, IDSC_KBSHORTCUT_REMOVED, sxAdded.c_str(), sxEntry.c_str(),
+                  sxExistingEntry.c_str(), sxAdded.c_str());
+    pRpt->WriteLine(sxTemp.c_str());
+  }
+}
+
+int PWScore::MergeDependents(PWScore *pothercore, const CGTUIndex &current,
+                             MultiCommands *pmulticmds,
                              uuid_array_t &base_uuid, uuid_array_t &new_base_uuid,
                              const bool bTitleRenamed, stringT &str_timestring,
                              const CItemData::EntryType et,
@@ -843,7 +1066,7 @@ int PWScore::MergeDependents(PWScore *pothercore, MultiCommands *pmulticmds,
     }
     // Check this is unique - if not - don't add this one! - its only an alias/shortcut!
     // We can't keep trying for uniqueness after adding a timestamp!
-    foundPos = Find(ci_temp.GetGroup(), sx_newTitle, ci_temp.GetUser());
+    foundPos = current.Find(ci_temp.GetGroup(), sx_newTitle, ci_temp.GetUser());
     if (foundPos != GetEntryEndIter())
       continue;
 
@@ -901,6 +1124,13 @@ void PWScore::Synchronize(PWScore *pothercore,
   std::vector<StringX> vs_PoliciesAdded;
   const StringX sxSync_DateTime = PWSUtil::GetTimeStamp(true).c_str();
 
+  const PWSMatch::CCompiledMatch subgroup = subgroup_bset ?
+    PWSMatch::CCompiledMatch(std2stringx(subgroup_name), subgroup_function) :
+    PWSMatch::CCompiledMatch();
+
+  // As for Merge, our entries aren't changed until the end
+  const CGTUIndex current(this);
+
   ItemListConstIter otherPos;
   for (otherPos = pothercore->GetEntryIter();
        otherPos != pothercore->GetEntryEndIter();
@@ -911,7 +1141,7 @@ void PWScore::Synchronize(PWScore *pothercore,
       return;
     }
 
-    CItemData otherItem = pothercore->GetEntry(otherPos);
+    const CItemData &otherItem = pothercore->GetEntry(otherPos);
     CItemData::EntryType et = otherItem.GetEntryType();
 
     // Do not process Aliases and Shortcuts
@@ -919,7 +1149,7 @@ void PWScore::Synchronize(PWScore *pothercore,
       continue;
 
     if (subgroup_bset &&
-        !otherItem.Matches(subgroup_name, subgroup_object, subgroup_function))
+        !otherItem.Matches(subgroup, subgroup_object))
       continue;
 
     const StringX sx_otherGroup = otherItem.GetGroup();
@@ -930,11 +1160,11 @@ void PWScore::Synchronize(PWScore *pothercore,
     Format(sx_mergedentry, GROUPTITLEUSERINCHEVRONS,
                 sx_otherGroup.c_str(), sx_otherTitle.c_str(), sx_otherUser.c_str());
 
-    ItemListConstIter foundPos = Find(sx_otherGroup, sx_otherTitle, sx_otherUser);
+    ItemListConstIter foundPos = current.Find(otherItem);
 
     if (foundPos != GetEntryEndIter()) {
       // found a match
-      CItemData curItem = GetEntry(foundPos);
+      const CItemData &curItem = GetEntry(foundPos);
 
       // Don't update if entry is protected
       if (curItem.IsProtected())
@@ -943,6 +1173,16 @@ void PWScore::Synchronize(PWScore *pothercore,
       CItemData updItem(curItem);
       updItem.SetDisplayInfo(NULL);
 
+      // Nothing needs updating in entries with the same fingerprint, bar
+      // the policy name, as the policy may differ between the databases
+      CItemData::FieldBits bsTest(bsFields), bsOwn(bsFields);
+      bsOwn.reset(CItemData::GROUPTITLE);
+      bsOwn.reset(CItemData::UUID);
+      bsOwn.reset(CItemData::POLICYNAME);
+      if (bsOwn.any() &&
+          curItem.GetFingerprint(bsOwn) == otherItem.GetFingerprint(bsOwn))
+        bsTest &= ~bsOwn;
+
       if (curItem.GetUUID() != otherItem.GetUUID()) {
         pws_os::Trace(_T("Synchronize: Mis-match UUIDs for [%ls:%ls:%ls]\n"),
              sx_otherGroup.c_str(), sx_otherTitle.c_str(), sx_otherUser.c_str());
@@ -950,8 +1190,8 @@ void PWScore::Synchronize(PWScore *pothercore,
 
       bool bUpdated(false);
       // Do not try and change GROUPTITLE = 0x00 (use GROUP & TITLE separately) or UUID = 0x01
-      for (size_t i = 2; i < bsFields.size(); i++) {
-        if (bsFields.test(i)) {
+      for (size_t i = 2; i < bsTest.size(); i++) {
+        if (bsTest.test(i)) {
           StringX sxValue = otherItem.GetFieldValue(static_cast<CItemData::FieldType>(i));
 
           // Special processing for password policies (default & named)
@@ -0,0 +1,526 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+// Delta.cpp
+//-----------------------------------------------------------------------------
+
+#include "Delta.h"
+#include "ParallelScan.h"
+#include "PWSrand.h"
+#include "Util.h"
+
+#include <sodium.h>
+
+#include <algorithm>
+#include <cstring>
+
+using pws_os::CUUID;
+
+namespace {
+  const unsigned char VERSION = 1; // of the encoding
+
+  // Calls fn(type, p, len) for each field of a SerializePlainText() record
+  // but its UUID, p and len being the whole of the field, i.e., its type,
+  // length and value. Returns false if the record's malformed.
+  template<typename Fn>
+  bool ForEachField(const std::vector<char> &record, Fn fn)
+  {
+    const size_t HDRLEN = 1 + sizeof(uint32);
+    size_t pos = 0;
+    while (record.size() - pos >= HDRLEN) {
+      const unsigned char type = static_cast<unsigned char>(record[pos]);
+      uint32 len;
+      memcpy(&len, &record[pos + 1], sizeof(len)); // as push_length
+      if (type == CItemData::END)
+        return true;
+      if (len > record.size() - pos - HDRLEN)
+        return false;
+      if (type != CItemData::UUID)
+        fn(type, &record[pos], HDRLEN + len);
+      pos += HDRLEN + len;
+    }
+    return false;
+  }
+
+  const size_t ENDLEN = 1 + sizeof(uint32);
+
+  void AppendEnd(std::vector<char> &record)
+  {
+    const uint32 len = 0;
+    record.push_back(static_cast<char>(CItemData::END));
+    record.insert(record.end(), reinterpret_cast<const char *>(&len),
+                  reinterpret_cast<const char *>(&len) + sizeof(len));
+  }
+
+  void GetTags(const unsigned char *key, const std::vector<char> &record,
+               CDeltaManifest::FieldTags &tags)
+  {
+    tags.clear();
+    ForEachField(record, [key, &tags](unsigned char type, const char *p, size_t len) {
+        CDeltaManifest::Tag &tag = tags[type];
+        crypto_generichash_blake2b(tag.data(), tag.size(),
+                                   reinterpret_cast<const unsigned char *>(p), len,
+                                   key, CDeltaManifest::KEYLEN);
+      });
+  }
+
+  bool SameTag(const CDeltaManifest::FieldTags &tags1,
+               const CDeltaManifest::FieldTags &tags2, unsigned char type)
+  {
+    CDeltaManifest::FieldTags::const_iterator iter1 = tags1.find(type);
+    CDeltaManifest::FieldTags::const_iterator iter2 = tags2.find(type);
+    if (iter1 == tags1.end() || iter2 == tags2.end())
+      return iter1 == tags1.end() && iter2 == tags2.end();
+    return iter1->second == iter2->second;
+  }
+
+  // Calls fn(type) for each type in either of tags1 and tags2
+  template<typename Fn>
+  void ForEachType(const CDeltaManifest::FieldTags &tags1,
+                   const CDeltaManifest::FieldTags &tags2, Fn fn)
+  {
+    for (CDeltaManifest::FieldTags::const_iterator iter = tags1.begin();
+         iter != tags1.end(); iter++)
+      fn(iter->first);
+    for (CDeltaManifest::FieldTags::const_iterator iter = tags2.begin();
+         iter != tags2.end(); iter++)
+      if (tags1.find(iter->first) == tags1.end())
+        fn(iter->first);
+  }
+
+  // Encoding: fixed size integers are little-endian
+  void Put(std::vector<unsigned char> &v, const void *p, size_t len)
+  {
+    v.insert(v.end(), static_cast<const unsigned char *>(p),
+             static_cast<const unsigned char *>(p) + len);
+  }
+
+  void PutInt32(std::vector<unsigned char> &v, uint32 i)
+  {
+    unsigned char buf[sizeof(i)];
+    putInt32(buf, i);
+    Put(v, buf, sizeof(buf));
+  }
+
+  void PutUUID(std::vector<unsigned char> &v, const CUUID &uuid)
+  {
+    uuid_array_t ua;
+    uuid.GetARep(ua);
+    Put(v, ua, sizeof(ua));
+  }
+
+  void PutTags(std::vector<unsigned char> &v, const CDeltaManifest::FieldTags &tags)
+  {
+    PutInt32(v, uint32(tags.size()));
+    for (CDeltaManifest::FieldTags::const_iterator iter = tags.begin();
+         iter != tags.end(); iter++) {
+      v.push_back(iter->first);
+      Put(v, iter->second.data(), iter->second.size());
+    }
+  }
+
+  class CReader
+  {
+  public:
+    CReader(const std::vector<unsigned char> &v) : m_v(v), m_pos(0) {}
+
+    bool AtEnd() const {return m_pos == m_v.size();}
+
+    bool Get(void *p, size_t len)
+    {
+      if (len > m_v.size() - m_pos)
+        return false;
+      if (len != 0)
+        memcpy(p, &m_v[m_pos], len);
+      m_pos += len;
+      return true;
+    }
+
+    bool GetInt32(uint32 &i)
+    {
+      unsigned char buf[sizeof(i)];
+      if (!Get(buf, sizeof(buf)))
+        return false;
+      i = getInt32(buf);
+      return true;
+    }
+
+    // A count of items of at least itemlen bytes each
+    bool GetCount(uint32 &n, size_t itemlen)
+    {
+      return GetInt32(n) && n <= (m_v.size() - m_pos) / itemlen;
+    }
+
+    bool GetUUID(CUUID &uuid)
+    {
+      uuid_array_t ua;
+      if (!Get(ua, sizeof(ua)))
+        return false;
+      uuid = CUUID(ua);
+      return true;
+    }
+
+    bool GetTags(CDeltaManifest::FieldTags &tags)
+    {
+      uint32 n;
+      if (!GetCount(n, 1 + sizeof(CDeltaManifest::Tag)))
+        return false;
+      tags.clear();
+      for (uint32 i = 0; i < n; i++) {
+        unsigned char type;
+        CDeltaManifest::Tag tag;
+        if (!Get(&type, 1) || !Get(tag.data(), tag.size()))
+          return false;
+        tags[type] = tag;
+      }
+      return true;
+    }
+
+  private:
+    const std::vector<unsigned char> &m_v;
+    size_t m_pos;
+  };
+}
+
+//-----------------------------------------------------------------------------
+
+CDeltaManifest::CDeltaManifest()
+  : m_file_uuid(CUUID::NullUUID())
+{
+  PWSrand::GetInstance()->GetRandomData(m_key, sizeof(m_key));
+}
+
+CDeltaManifest::CDeltaManifest(const CDeltaManifest &that)
+  : m_file_uuid(that.m_file_uuid), m_entries(that.m_entries)
+{
+  memcpy(m_key, that.m_key, sizeof(m_key));
+}
+
+CDeltaManifest::~CDeltaManifest()
+{
+  trashMemory(m_key, sizeof(m_key));
+}
+
+CDeltaManifest &CDeltaManifest::operator=(const CDeltaManifest &that)
+{
+  if (this != &that) {
+    m_file_uuid = that.m_file_uuid;
+    memcpy(m_key, that.m_key, sizeof(m_key));
+    m_entries = that.m_entries;
+  }
+  return *this;
+}
+
+void CDeltaManifest::GetFieldTags(const std::vector<char> &record,
+                                  FieldTags &tags) const
+{
+  GetTags(m_key, record, tags);
+}
+
+const CDeltaManifest::FieldTags *CDeltaManifest::Find(const CUUID &uuid) const
+{
+  std::map<CUUID, FieldTags>::const_iterator iter = m_entries.find(uuid);
+  return iter == m_entries.end() ? NULL : &iter->second;
+}
+
+void CDeltaManifest::Encode(std::vector<unsigned char> &v) const
+{
+  v.clear();
+  v.push_back(VERSION);
+  PutUUID(v, m_file_uuid);
+  Put(v, m_key, sizeof(m_key));
+  PutInt32(v, uint32(m_entries.size()));
+  for (std::map<CUUID, FieldTags>::const_iterator iter = m_entries.begin();
+       iter != m_entries.end(); iter++) {
+    PutUUID(v, iter->first);
+    PutTags(v, iter->second);
+  }
+}
+
+bool CDeltaManifest::Decode(const std::vector<unsigned char> &v)
+{
+  CReader reader(v);
+  unsigned char version;
+  uint32 n;
+  m_entries.clear();
+  if (!reader.Get(&version, 1) || version != VERSION ||
+      !reader.GetUUID(m_file_uuid) || !reader.Get(m_key, sizeof(m_key)) ||
+      !reader.GetCount(n, sizeof(uuid_array_t)))
+    return false;
+
+  CUUID uuid(CUUID::NullUUID());
+  FieldTags tags;
+  for (uint32 i = 0; i < n; i++) {
+    if (!reader.GetUUID(uuid) || !reader.GetTags(tags))
+      return false;
+    m_entries[uuid] = tags;
+  }
+  return reader.AtEnd();
+}
+
+//-----------------------------------------------------------------------------
+
+void CDelta::Create(const CDeltaManifest &base, size_t n, const RecordFn &getrecord,
+                    const CItemData::FieldBits &bsFields,
+                    CDeltaManifest *pcurrent)
+{
+  m_base = base;
+  m_base.m_entries.clear();
+  Clear();
+
+  // As Synchronize, never the group & title together, nor the UUID
+  CItemData::FieldBits bsModify(bsFields);
+  bsModify.reset(CItemData::GROUPTITLE);
+  bsModify.reset(CItemData::UUID);
+
+  // The entries' tags are kept for deletions and the current manifest,
+  // their records only if changed
+  std::vector<CUUID> vuuids(n, CUUID::NullUUID());
+  std::vector<CDeltaManifest::FieldTags> vtags(n);
+  std::vector<std::vector<Change> > vchanges;
+  CParallelScan().Scan(n, vchanges,
+                       [&](size_t i, std::vector<Change> &changes) {
+      std::vector<char> record;
+      getrecord(i, vuuids[i], record);
+      const CDeltaManifest::FieldTags &tags = vtags[i];
+      GetTags(base.m_key, record, vtags[i]);
+
+      const CDeltaManifest::FieldTags *pbase = base.Find(vuuids[i]);
+      if (pbase == NULL) {
+        changes.push_back(Change());
+        Change &change = changes.back();
+        change.cd.uuid0 = vuuids[i];
+        change.cd.indatabase = CURRENT;
+        change.record.swap(record);
+      } else if (*pbase != tags) {
+        CItemData::FieldBits bsDiffs;
+        ForEachType(*pbase, tags, [&](unsigned char type) {
+            if (type < bsModify.size() && bsModify.test(type) &&
+                !SameTag(*pbase, tags, type))
+              bsDiffs.set(type);
+          });
+        if (bsDiffs.any()) {
+          changes.push_back(Change());
+          Change &change = changes.back();
+          change.cd.uuid0 = vuuids[i];
+          change.cd.indatabase = BOTH;
+          change.cd.bsDiffs = bsDiffs;
+          // Sized first, so as not to leave copies behind as it grows
+          size_t len = ENDLEN;
+          ForEachField(record, [&](unsigned char type, const char *, size_t flen) {
+              if (type < bsDiffs.size() && bsDiffs.test(type))
+                len += flen;
+            });
+          change.record.reserve(len);
+          ForEachField(record, [&](unsigned char type, const char *p, size_t len) {
+              if (type < bsDiffs.size() && bsDiffs.test(type))
+                change.record.insert(change.record.end(), p, p + len);
+            });
+          AppendEnd(change.record);
+          for (CDeltaManifest::FieldTags::const_iterator iter = pbase->begin();
+               iter != pbase->end(); iter++)
+            if (iter->first < bsDiffs.size() && bsDiffs.test(iter->first))
+              change.base.insert(*iter);
+        }
+        // The current manifest moves on only for the fields sent, so that
+        // changes to those left out are still in a later delta
+        CDeltaManifest::FieldTags newtags(*pbase);
+        for (size_t type = 0; type < bsDiffs.size(); type++) {
+          if (!bsDiffs.test(type))
+            continue;
+          CDeltaManifest::FieldTags::const_iterator iter =
+            tags.find(static_cast<unsigned char>(type));
+          if (iter != tags.end())
+            newtags[iter->first] = iter->second;
+          else
+            newtags.erase(static_cast<unsigned char>(type));
+        }
+        vtags[i].swap(newtags);
+      }
+      if (!record.empty())
+        trashMemory(&record[0], record.size());
+      return true;
+    });
+
+  for (size_t ichunk = 0; ichunk < vchanges.size(); ichunk++)
+    for (size_t i = 0; i < vchanges[ichunk].size(); i++) {
+      m_changes.push_back(Change());
+      std::swap(m_changes.back(), vchanges[ichunk][i]);
+    }
+
+  // Entries of the base no longer here have been deleted
+  std::vector<CUUID> vsorted(vuuids);
+  std::sort(vsorted.begin(), vsorted.end());
+  for (std::map<CUUID, CDeltaManifest::FieldTags>::const_iterator iter = base.m_entries.begin();
+       iter != base.m_entries.end(); iter++) {
+    if (std::binary_search(vsorted.begin(), vsorted.end(), iter->first))
+      continue;
+    m_changes.push_back(Change());
+    Change &change = m_changes.back();
+    change.cd.uuid0 = iter->first;
+    change.cd.indatabase = COMPARE;
+    change.base = iter->second;
+  }
+
+  if (pcurrent != NULL) {
+    *pcurrent = m_base;
+    for (size_t i = 0; i < n; i++)
+      pcurrent->m_entries[vuuids[i]].swap(vtags[i]);
+  }
+}
+
+int CDelta::Check(const Change &change, const std::vector<char> *precord,
+                  CItemData::FieldBits &bsConflicts) const
+{
+  bsConflicts.reset();
+  CDeltaManifest::FieldTags tags, newtags;
+  if (precord != NULL)
+    GetTags(m_base.m_key, *precord, tags);
+
+  bool bConflict(false);
+  switch (change.cd.indatabase) {
+    case CURRENT:
+      // Already added, or another entry with the same UUID?
+      if (precord == NULL)
+        return APPLIES;
+      GetTags(m_base.m_key, change.record, newtags);
+      ForEachType(tags, newtags, [&](unsigned char type) {
+          if (!SameTag(tags, newtags, type)) {
+            bConflict = true;
+            if (type < bsConflicts.size())
+              bsConflicts.set(type);
+          }
+        });
+      return bConflict ? CONFLICT : APPLIED;
+
+    case BOTH:
+    {
+      if (precord == NULL) {
+        bsConflicts = change.cd.bsDiffs; // Deleted here
+        return CONFLICT;
+      }
+      // Each field must be as at the base, or already changed
+      GetTags(m_base.m_key, change.record, newtags);
+      bool bApplied(true);
+      for (size_t i = 0; i < change.cd.bsDiffs.size(); i++) {
+        if (!change.cd.bsDiffs.test(i))
+          continue;
+        const unsigned char type = static_cast<unsigned char>(i);
+        if (SameTag(tags, newtags, type))
+          continue;
+        bApplied = false;
+        if (!SameTag(tags, change.base, type)) {
+          bConflict = true;
+          bsConflicts.set(i);
+        }
+      }
+      return bConflict ? CONFLICT : (bApplied ? APPLIED : APPLIES);
+    }
+
+    case COMPARE:
+      if (precord == NULL)
+        return APPLIED;
+      ForEachType(tags, change.base, [&](unsigned char type) {
+          if (!SameTag(tags, change.base, type)) {
+            bConflict = true;
+            if (type < bsConflicts.size())
+              bsConflicts.set(type);
+          }
+        });
+      return bConflict ? CONFLICT : APPLIES;
+
+    default:
+      ASSERT(0);
+      return CONFLICT;
+  }
+}
+
+void CDelta::Clear()
+{
+  for (size_t i = 0; i < m_changes.size(); i++) {
+    std::vector<char> &record = m_changes[i].record;
+    if (!record.empty())
+      trashMemory(record.data(), record.size());
+  }
+  m_changes.clear();
+}
+
+void CDelta::Encode(std::vector<unsigned char> &v) const
+{
+  // Sized first, as for the records in Create()
+  size_t len = 1 + sizeof(uuid_array_t) + sizeof(m_base.m_key) + sizeof(uint32);
+  for (size_t i = 0; i < m_changes.size(); i++) {
+    const Change &change = m_changes[i];
+    len += sizeof(uuid_array_t) + 1 + sizeof(uint32) + change.cd.bsDiffs.count() +
+      sizeof(uint32) + change.base.size() * (1 + sizeof(CDeltaManifest::Tag)) +
+      sizeof(uint32) + change.record.size();
+  }
+  if (!v.empty())
+    trashMemory(v.data(), v.size());
+  v.clear();
+  v.reserve(len);
+  v.push_back(VERSION);
+  PutUUID(v, m_base.m_file_uuid);
+  Put(v, m_base.m_key, sizeof(m_base.m_key));
+  PutInt32(v, uint32(m_changes.size()));
+  for (size_t i = 0; i < m_changes.size(); i++) {
+    const Change &change = m_changes[i];
+    PutUUID(v, change.cd.uuid0);
+    v.push_back(static_cast<unsigned char>(change.cd.indatabase));
+    PutInt32(v, uint32(change.cd.bsDiffs.count()));
+    for (size_t ft = 0; ft < change.cd.bsDiffs.size(); ft++)
+      if (change.cd.bsDiffs.test(ft))
+        v.push_back(static_cast<unsigned char>(ft));
+    PutTags(v, change.base);
+    PutInt32(v, uint32(change.record.size()));
+    Put(v, change.record.data(), change.record.size());
+  }
+  ASSERT(v.size() == len);
+}
+
+bool CDelta::Decode(const std::vector<unsigned char> &v)
+{
+  CReader reader(v);
+  unsigned char version;
+  uint32 n;
+  Clear();
+  if (!reader.Get(&version, 1) || version != VERSION ||
+      !reader.GetUUID(m_base.m_file_uuid) ||
+      !reader.Get(m_base.m_key, sizeof(m_base.m_key)) ||
+      !reader.GetCount(n, sizeof(uuid_array_t)))
+    return false;
+
+  m_changes.resize(n);
+  for (uint32 i = 0; i < n; i++) {
+    Change &change = m_changes[i];
+    unsigned char indatabase;
+    uint32 ndiffs, len;
+    if (!reader.GetUUID(change.cd.uuid0) || !reader.Get(&indatabase, 1) ||
+        !reader.GetCount(ndiffs, 1))
+      return false;
+    change.cd.indatabase = static_cast<signed char>(indatabase);
+    if (change.cd.indatabase != CURRENT && change.cd.indatabase != BOTH &&
+        change.cd.indatabase != COMPARE)
+      return false;
+    for (uint32 j = 0; j < ndiffs; j++) {
+      unsigned char ft;
+      if (!reader.Get(&ft, 1) || ft >= change.cd.bsDiffs.size())
+        return false;
+      change.cd.bsDiffs.set(ft);
+    }
+    if (!reader.GetTags(change.base) || !reader.GetCount(len, 1))
+      return false;
+    change.record.resize(len);
+    if (!reader.Get(change.record.data(), len))
+      return false;
+  }
+  return reader.AtEnd();
+}
+//-----------------------------------------------------------------------------
+// Local variables:
+// mode: c++
+// End:
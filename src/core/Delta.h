@@ -0,0 +1,136 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+// Delta.h
+//-----------------------------------------------------------------------------
+
+#ifndef __DELTA_H
+#define __DELTA_H
+
+#include "ItemData.h"
+#include "DBCompareData.h"
+#include "os/UUID.h"
+
+#include <array>
+#include <functional>
+#include <map>
+#include <vector>
+
+/*
+* A delta holds the changes made to a database since a base: the entries
+* added, modified (just the fields changed) and deleted, so that a copy
+* of the base elsewhere can be brought up to date without shipping or
+* merging the whole database.
+*
+* The base is recorded by a manifest: the database's file UUID and, for
+* each entry, a tag of each of its fields. Diffing the entries against
+* the manifest finds the changes. The delta also carries the base's tags
+* of the fields it changes, so that whoever applies it can tell, field by
+* field, whether their entry is still as it was at the base.
+*
+* Tags are 64 bit BLAKE2b hashes of a field as serialized by
+* CItemData::SerializePlainText(), keyed with a random key that's kept in
+* the manifest and deltas, both of which are sealed with the database's
+* passkey (see PWSfileV3::WriteSealed). Aliases and shortcuts are left
+* out, as by Synchronize.
+*/
+
+class CDeltaManifest
+{
+public:
+  typedef std::array<unsigned char, 8> Tag;
+  typedef std::map<unsigned char, Tag> FieldTags; // by field type, unset fields absent
+  enum {KEYLEN = 32};
+
+  CDeltaManifest(); // with a new random key
+  CDeltaManifest(const CDeltaManifest &that);
+  ~CDeltaManifest();
+  CDeltaManifest &operator=(const CDeltaManifest &that);
+
+  const pws_os::CUUID &GetFileUUID() const {return m_file_uuid;}
+  void SetFileUUID(const pws_os::CUUID &uuid) {m_file_uuid = uuid;}
+
+  // The tags of the fields of a SerializePlainText() record, bar its UUID
+  void GetFieldTags(const std::vector<char> &record, FieldTags &tags) const;
+
+  void Add(const pws_os::CUUID &uuid, const FieldTags &tags) {m_entries[uuid] = tags;}
+  const FieldTags *Find(const pws_os::CUUID &uuid) const;
+  size_t GetNumEntries() const {return m_entries.size();}
+
+  void Encode(std::vector<unsigned char> &v) const;
+  bool Decode(const std::vector<unsigned char> &v);
+
+private:
+  friend class CDelta;
+
+  pws_os::CUUID m_file_uuid;
+  unsigned char m_key[KEYLEN];
+  std::map<pws_os::CUUID, FieldTags> m_entries;
+};
+
+class CDelta
+{
+public:
+  // A change to an entry. cd.uuid0 is the entry, cd.indatabase is as for
+  // Compare: CURRENT if added, BOTH if modified, COMPARE if deleted, and
+  // cd.bsDiffs the fields modified.
+  struct Change {
+    st_CompareData cd;
+    // A DeSerializePlainText() record of the entry if added, or of the
+    // fields modified that are set
+    std::vector<char> record;
+    // The base's tags of the fields modified, or of all fields if deleted
+    CDeltaManifest::FieldTags base;
+  };
+
+  // Sets uuid and record to entry i's UUID and SerializePlainText() record.
+  // Called on several threads at once.
+  typedef std::function<void (size_t i, pws_os::CUUID &uuid,
+                              std::vector<char> &record)> RecordFn;
+
+  enum {APPLIES, APPLIED, CONFLICT}; // See Check()
+
+  CDelta() {}
+  ~CDelta() {Clear();}
+
+  // Records are plaintext, so are trashed before they're freed
+  void Clear();
+
+  // Sets the changes of n entries since base, with modifications of the
+  // fields of bsFields only. If pcurrent isn't NULL, it's set to the
+  // manifest of the entries as they are now (with base's key).
+  void Create(const CDeltaManifest &base, size_t n, const RecordFn &getrecord,
+              const CItemData::FieldBits &bsFields,
+              CDeltaManifest *pcurrent = NULL);
+
+  const pws_os::CUUID &GetBaseUUID() const {return m_base.GetFileUUID();}
+  const std::vector<Change> &GetChanges() const {return m_changes;}
+
+  // Whether a change can be made to an entry, given its SerializePlainText()
+  // record, or NULL if there's no such entry: APPLIES if it's as it was at
+  // the base, APPLIED if it already has the change, else CONFLICT, with
+  // bsConflicts set to the fields changed since the base.
+  int Check(const Change &change, const std::vector<char> *precord,
+            CItemData::FieldBits &bsConflicts) const;
+
+  // v holds the records in plaintext, for the caller to trash
+  void Encode(std::vector<unsigned char> &v) const;
+  bool Decode(const std::vector<unsigned char> &v);
+
+private:
+  CDelta(const CDelta &); // Do not implement
+  CDelta &operator=(const CDelta &); // Do not implement
+
+  CDeltaManifest m_base; // just the file UUID and key
+  std::vector<Change> m_changes;
+};
+
+#endif /* __DELTA_H */
+//-----------------------------------------------------------------------------
+// Local variables:
+// mode: c++
+// End:
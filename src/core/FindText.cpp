@@ -0,0 +1,267 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+
+/// \file FindText.cpp
+//-----------------------------------------------------------------------------
+
+#include "FindText.h"
+
+#include <cstring>
+#include <cwchar>
+
+#if defined(__SSE2__) && WCHAR_MAX > 0xffff
+#include <emmintrin.h>
+#define PWS_FIND_SSE2
+#endif
+
+using namespace PWSMatch;
+
+bool PWSMatch::EqualsNoCase(const TCHAR *s1, const TCHAR *s2, size_t len)
+{
+  for (size_t i = 0; i < len; i++) {
+    if (s1[i] != s2[i] && FoldCase(s1[i]) != FoldCase(s2[i]))
+      return false;
+  }
+  return true;
+}
+
+size_t PWSMatch::FindNoCase(const TCHAR *pText, size_t text_len,
+                            const TCHAR *pSearch, size_t search_len)
+{
+  if (search_len == 0)
+    return 0;
+  if (search_len > text_len)
+    return StringX::npos;
+
+  const TCHAR first = FoldCase(pSearch[0]);
+  for (size_t i = 0; i <= text_len - search_len; i++) {
+    if (FoldCase(pText[i]) == first &&
+        EqualsNoCase(pText + i + 1, pSearch + 1, search_len - 1))
+      return i;
+  }
+  return StringX::npos;
+}
+
+static void SetCandidates(TCHAR c, bool bCaseSensitive, TCHAR cands[2], bool &bAny)
+{
+  // c is already folded if case insensitive. Only c and its ASCII upper
+  // case fold to an ASCII c; but we can't tell what folds to anything else
+  bAny = false;
+  cands[0] = cands[1] = c;
+  if (bCaseSensitive)
+    return;
+  if (c >= 0 && c < 0x80) {
+    if (c >= _T('a') && c <= _T('z'))
+      cands[1] = TCHAR(c - (_T('a') - _T('A')));
+  } else
+    bAny = true;
+}
+
+CFinder::CFinder(const StringX &sxSearch, bool bCaseSensitive)
+  : m_sxSearch(sxSearch), m_bCaseSensitive(bCaseSensitive),
+    m_bFirstAny(true), m_bSecondAny(true)
+{
+  m_first[0] = m_first[1] = m_second[0] = m_second[1] = 0;
+
+  if (!m_bCaseSensitive) {
+    for (StringX::iterator iter = m_sxSearch.begin(); iter != m_sxSearch.end(); iter++)
+      *iter = FoldCase(*iter);
+  }
+  if (m_sxSearch.length() > 0)
+    SetCandidates(m_sxSearch[0], m_bCaseSensitive, m_first, m_bFirstAny);
+  if (m_sxSearch.length() > 1)
+    SetCandidates(m_sxSearch[1], m_bCaseSensitive, m_second, m_bSecondAny);
+
+  if (m_bCaseSensitive) {
+    // Case insensitive UTF-8 searches decode as they go, instead
+    for (size_t i = 0; i < m_sxSearch.length(); i++) {
+      const unsigned long c = static_cast<unsigned long>(m_sxSearch[i]);
+      if (c < 0x80) {
+        m_utf8 += char(c);
+      } else if (c < 0x800) {
+        m_utf8 += char(0xc0 | (c >> 6));
+        m_utf8 += char(0x80 | (c & 0x3f));
+      } else if (c < 0x10000) {
+        m_utf8 += char(0xe0 | (c >> 12));
+        m_utf8 += char(0x80 | ((c >> 6) & 0x3f));
+        m_utf8 += char(0x80 | (c & 0x3f));
+      } else {
+        m_utf8 += char(0xf0 | (c >> 18));
+        m_utf8 += char(0x80 | ((c >> 12) & 0x3f));
+        m_utf8 += char(0x80 | ((c >> 6) & 0x3f));
+        m_utf8 += char(0x80 | (c & 0x3f));
+      }
+    }
+  }
+}
+
+bool CFinder::CompareAt(const TCHAR *pText) const
+{
+  const size_t len = m_sxSearch.length();
+  if (m_bCaseSensitive)
+    return memcmp(pText, m_sxSearch.data(), len * sizeof(TCHAR)) == 0;
+
+  for (size_t i = 0; i < len; i++) {
+    if (FoldCase(pText[i]) != m_sxSearch[i])
+      return false;
+  }
+  return true;
+}
+
+#ifdef PWS_FIND_SSE2
+// Bit i set if pText[i] may match, for i in 0..3
+static inline int CandidateMask(const TCHAR *pText, const __m128i &c0, const __m128i &c1,
+                                bool bNonASCII)
+{
+  const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pText));
+  __m128i m = _mm_or_si128(_mm_cmpeq_epi32(v, c0), _mm_cmpeq_epi32(v, c1));
+  if (bNonASCII)
+    m = _mm_or_si128(m, _mm_cmpgt_epi32(v, _mm_set1_epi32(0x7f)));
+  return _mm_movemask_ps(_mm_castsi128_ps(m));
+}
+#endif
+
+size_t CFinder::Find(const TCHAR *pText, size_t len) const
+{
+  const size_t n = m_sxSearch.length();
+  if (n == 0)
+    return 0;
+  if (n > len)
+    return StringX::npos;
+
+  const size_t last = len - n; // last possible match position
+  size_t i = 0;
+
+#ifdef PWS_FIND_SSE2
+  const bool bUseFirst = !m_bFirstAny;
+  const bool bUseSecond = n > 1 && !m_bSecondAny;
+  if (bUseFirst || bUseSecond) {
+    const __m128i f0 = _mm_set1_epi32(int(m_first[0])), f1 = _mm_set1_epi32(int(m_first[1]));
+    const __m128i s0 = _mm_set1_epi32(int(m_second[0])), s1 = _mm_set1_epi32(int(m_second[1]));
+    // Four positions at a time; reads pText[i + 4] at most, which is
+    // within the text as the search is at least 2 long if it's needed
+    for (; i + 3 <= last; i += 4) {
+      int mask = 0xf;
+      if (bUseFirst)
+        mask = CandidateMask(pText + i, f0, f1, !m_bCaseSensitive);
+      if (bUseSecond && mask != 0)
+        mask &= CandidateMask(pText + i + 1, s0, s1, !m_bCaseSensitive);
+      for (int j = 0; mask != 0; j++, mask >>= 1) {
+        if ((mask & 1) != 0 && CompareAt(pText + i + j))
+          return i + j;
+      }
+    }
+  }
+#endif
+
+  for (; i <= last; i++) {
+    if (CompareAt(pText + i))
+      return i;
+  }
+  return StringX::npos;
+}
+
+// Decodes one UTF-8 character, or returns false if the sequence is invalid
+static bool DecodeUTF8(const unsigned char *&p, const unsigned char *end, TCHAR &c)
+{
+  const unsigned char b = *p++;
+  size_t ntrail;
+  unsigned long uc;
+  if (b < 0x80) {
+    c = TCHAR(b);
+    return true;
+  } else if (b < 0xc0) {
+    return false; // continuation byte
+  } else if (b < 0xe0) {
+    ntrail = 1; uc = b & 0x1f;
+  } else if (b < 0xf0) {
+    ntrail = 2; uc = b & 0x0f;
+  } else if (b < 0xf8) {
+    ntrail = 3; uc = b & 0x07;
+  } else
+    return false;
+
+  if (size_t(end - p) < ntrail)
+    return false;
+  for (size_t i = 0; i < ntrail; i++, p++) {
+    if ((*p & 0xc0) != 0x80)
+      return false;
+    uc = (uc << 6) | (*p & 0x3f);
+  }
+  c = TCHAR(uc);
+  return true;
+}
+
+bool CFinder::CompareUTF8At(const unsigned char *pText, size_t len) const
+{
+  const unsigned char *p = pText, *end = pText + len;
+  for (size_t i = 0; i < m_sxSearch.length(); i++) {
+    TCHAR c;
+    if (p == end || !DecodeUTF8(p, end, c) || FoldCase(c) != m_sxSearch[i])
+      return false;
+  }
+  return true;
+}
+
+size_t CFinder::FindUTF8(const unsigned char *pText, size_t len) const
+{
+  if (m_sxSearch.empty())
+    return 0;
+
+  if (m_bCaseSensitive) {
+    // Plain byte search
+    const size_t n = m_utf8.length();
+    const unsigned char first = static_cast<unsigned char>(m_utf8[0]);
+    const unsigned char *p = pText, *end = pText + len;
+    while (size_t(end - p) >= n) {
+      p = static_cast<const unsigned char *>(memchr(p, first, size_t(end - p) - n + 1));
+      if (p == NULL)
+        break;
+      if (memcmp(p, m_utf8.data(), n) == 0)
+        return size_t(p - pText);
+      p++;
+    }
+    return StringX::npos;
+  }
+
+  // An ASCII byte can only match if it folds to the first character,
+  // but any non-ASCII character could
+  const TCHAR first = m_sxSearch[0];
+  const bool bFirstASCII = !m_bFirstAny;
+  size_t i = 0;
+
+#ifdef PWS_FIND_SSE2
+  {
+    const __m128i f0 = _mm_set1_epi8(char(m_first[0])), f1 = _mm_set1_epi8(char(m_first[1]));
+    for (; i + 16 <= len; i += 16) {
+      const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pText + i));
+      int mask = _mm_movemask_epi8(v); // high bit: non-ASCII
+      if (bFirstASCII)
+        mask |= _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, f0),
+                                               _mm_cmpeq_epi8(v, f1)));
+      for (int j = 0; mask != 0; j++, mask >>= 1) {
+        if ((mask & 1) != 0 && CompareUTF8At(pText + i + j, len - i - j))
+          return i + j;
+      }
+    }
+  }
+#endif
+
+  for (; i < len; i++) {
+    const unsigned char b = pText[i];
+    if (b < 0x80 ? (bFirstASCII && FoldCase(TCHAR(b)) == first) : b >= 0xc0) {
+      if (CompareUTF8At(pText + i, len - i))
+        return i;
+    }
+  }
+  return StringX::npos;
+}
+//-----------------------------------------------------------------------------
+// Local variables:
+// mode: c++
+// End:
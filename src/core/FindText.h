@@ -0,0 +1,84 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+
+#ifndef __FINDTEXT_H
+#define __FINDTEXT_H
+
+// FindText.h
+//-----------------------------------------------------------------------------
+// Substring search kernels used by PWSMatch::Match(), free text search
+// and the search index.
+
+#include "StringX.h"
+#include "os/pws_tchar.h"
+
+#include <string>
+
+namespace PWSMatch {
+  // Case folding used by all case insensitive comparisons here and by the
+  // search index. ASCII is folded directly (so 'I' is always 'i', whatever
+  // the locale), anything else as ToLower() does.
+  inline TCHAR FoldCase(TCHAR c)
+  {
+    if (c >= 0 && c < 0x80)
+      return (c >= _T('A') && c <= _T('Z')) ? TCHAR(c + (_T('a') - _T('A'))) : c;
+    return TCHAR(_totlower(c));
+  }
+
+  // Case insensitive (FoldCase) comparisons that don't allocate
+  bool EqualsNoCase(const TCHAR *s1, const TCHAR *s2, size_t len);
+  size_t FindNoCase(const TCHAR *pText, size_t text_len,
+                    const TCHAR *pSearch, size_t search_len);
+
+  /*
+  * CFinder searches for a fixed string, e.g., what the user typed in the
+  * search bar, in many texts. The string is folded once up front, and
+  * searching doesn't allocate: candidate positions for the first two
+  * characters are found several characters at a time (with SSE2 where
+  * available), and only those are compared in full.
+  *
+  * Find() returns the offset of the first occurrence, or StringX::npos.
+  * FindUTF8() does the same on UTF-8 text, e.g., a file buffer, and
+  * returns a byte offset.
+  */
+  class CFinder
+  {
+  public:
+    CFinder(const StringX &sxSearch, bool bCaseSensitive);
+
+    const StringX &GetSearch() const {return m_sxSearch;}
+    bool IsCaseSensitive() const {return m_bCaseSensitive;}
+
+    size_t Find(const TCHAR *pText, size_t len) const;
+    size_t Find(const StringX &sxText) const
+    {return Find(sxText.data(), sxText.length());}
+    bool FoundIn(const StringX &sxText) const
+    {return Find(sxText) != StringX::npos;}
+
+    size_t FindUTF8(const unsigned char *pText, size_t len) const;
+
+  private:
+    bool CompareAt(const TCHAR *pText) const;
+    bool CompareUTF8At(const unsigned char *pText, size_t len) const;
+
+    StringX m_sxSearch; // folded if case insensitive
+    bool m_bCaseSensitive;
+    // Characters that may match the first & second ones of m_sxSearch,
+    // unless m_bFirstAny/m_bSecondAny. If case insensitive, any non-ASCII
+    // character may also match (e.g., KELVIN SIGN folds to 'k').
+    TCHAR m_first[2], m_second[2];
+    bool m_bFirstAny, m_bSecondAny;
+    std::string m_utf8; // m_sxSearch as UTF-8, if case sensitive
+  };
+}
+
+#endif /* __FINDTEXT_H */
+//-----------------------------------------------------------------------------
+// Local variables:
+// mode: c++
+// End:
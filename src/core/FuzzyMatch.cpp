@@ -0,0 +1,286 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+// FuzzyMatch.cpp
+//-----------------------------------------------------------------------------
+
+#include "FuzzyMatch.h"
+#include "ItemData.h"
+#include "ParallelScan.h"
+
+#include <algorithm>
+#include <queue>
+
+using namespace PWSMatch;
+
+namespace {
+  // Per character matched, plus a bonus if next to the previous one or,
+  // failing that, at the start of a word
+  const int SCORE_MATCH = 16;
+  const int BONUS_CONSECUTIVE = 12;
+  const int BONUS_WORD_START = 8;
+  // Matched from the very start of the text, or the text is the query
+  const int BONUS_TEXT_START = 8;
+  const int BONUS_WHOLE_TEXT = 16;
+  // Per character skipped before or between matches, up to MAX_GAP a gap
+  const int PENALTY_GAP = 1;
+  const size_t MAX_GAP = 8;
+  const int PENALTY_TYPO = 24;
+
+  // Fields searched, best weighted first
+  const struct {
+    CItemData::FieldType ft;
+    int weight;
+  } FieldWeights[] = {
+    {CItemData::TITLE, 4},
+    {CItemData::URL, 3},
+    {CItemData::USER, 2},
+    {CItemData::GROUP, 2},
+    {CItemData::NOTES, 1},
+  };
+
+  inline bool IsAlnum(TCHAR c)
+  {
+    if (c >= 0 && c < 0x80)
+      return (c >= _T('a') && c <= _T('z')) || (c >= _T('A') && c <= _T('Z')) ||
+             (c >= _T('0') && c <= _T('9'));
+    return true; // close enough, and doesn't depend on the locale
+  }
+
+  // After a separator, or the capital of "camelCase"
+  inline bool IsWordStart(const TCHAR *pText, size_t pos)
+  {
+    if (pos == 0)
+      return true;
+    const TCHAR prev = pText[pos - 1], c = pText[pos];
+    return !IsAlnum(prev) ||
+           (prev >= _T('a') && prev <= _T('z') && c >= _T('A') && c <= _T('Z'));
+  }
+
+  inline int GapPenalty(size_t gap)
+  {
+    return PENALTY_GAP * int(std::min(gap, MAX_GAP));
+  }
+
+  struct st_Scored {
+    int score;
+    size_t index;
+  };
+
+  // Higher score, then lower index. As a priority_queue's comparison,
+  // puts the worst of those kept on top, to be replaced
+  struct BetterScore {
+    bool operator()(const st_Scored &a, const st_Scored &b) const
+    {
+      return a.score > b.score || (a.score == b.score && a.index < b.index);
+    }
+  };
+
+  typedef std::priority_queue<st_Scored, std::vector<st_Scored>, BetterScore> ScoreHeap;
+};
+
+CFuzzyMatcher::CFuzzyMatcher(const StringX &sxQuery)
+  : m_finder(sxQuery, false)
+{
+  m_sxQuery.reserve(sxQuery.length());
+  m_sxUpper.reserve(sxQuery.length());
+  for (size_t i = 0; i < sxQuery.length(); i++) {
+    const TCHAR c = FoldCase(sxQuery[i]);
+    m_sxQuery += c;
+    m_sxUpper += (c >= _T('a') && c <= _T('z')) ? TCHAR(c - (_T('a') - _T('A'))) : c;
+  }
+
+  const size_t len = m_sxQuery.length();
+  m_maxTypos = len < 4 ? 0 : (len < 8 ? 1 : 2);
+  m_maxScore = len == 0 ? 0 :
+    int(len) * SCORE_MATCH + int(len - 1) * BONUS_CONSECUTIVE +
+    BONUS_WORD_START + BONUS_TEXT_START + BONUS_WHOLE_TEXT;
+}
+
+int CFuzzyMatcher::Score(const TCHAR *pText, size_t len) const
+{
+  if (m_sxQuery.empty() || len == 0)
+    return 0;
+
+  // Most texts don't match at all, which the subsequence search finds
+  // quickest. Only if it matched without typos can the query be there as is.
+  bool bTypos;
+  const int score = ScoreSubsequence(pText, len, bTypos);
+  if (score == 0 || bTypos)
+    return score;
+
+  // Score the first occurrence at the start of a word, if any, else the
+  // first one, if better than the subsequence
+  size_t pos = m_finder.Find(pText, len);
+  if (pos == StringX::npos)
+    return score;
+  size_t next = pos;
+  while (!IsWordStart(pText, next)) {
+    const size_t skip = next + 1;
+    next = m_finder.Find(pText + skip, len - skip);
+    if (next == StringX::npos)
+      break;
+    next += skip;
+  }
+  return std::max(score, ScoreRun(pText, len, next != StringX::npos ? next : pos));
+}
+
+int CFuzzyMatcher::ScoreRun(const TCHAR *pText, size_t len, size_t pos) const
+{
+  const size_t qlen = m_sxQuery.length();
+  int score = int(qlen) * SCORE_MATCH + int(qlen - 1) * BONUS_CONSECUTIVE -
+              GapPenalty(pos);
+  if (IsWordStart(pText, pos))
+    score += BONUS_WORD_START;
+  if (pos == 0)
+    score += BONUS_TEXT_START;
+  if (qlen == len)
+    score += BONUS_WHOLE_TEXT;
+  return score;
+}
+
+int CFuzzyMatcher::ScoreSubsequence(const TCHAR *pText, size_t len,
+                                    bool &bTypos) const
+{
+  bTypos = false;
+  // Each query character is matched at its first occurrence after the
+  // previous match; one that isn't found is a typo, and skipped
+  int score = 0;
+  size_t ntypos = 0, nmatched = 0;
+  size_t i = 0;       // next position in pText
+  bool bLast = false; // last query character matched at i - 1
+
+  for (size_t k = 0; k < m_sxQuery.length(); k++) {
+    // Rather than folding each character of the text, compare it with
+    // both cases of q; only non-ASCII ones need folding
+    const TCHAR q = m_sxQuery[k], qUpper = m_sxUpper[k];
+    size_t j = i;
+    for (; j < len; j++) {
+      const TCHAR c = pText[j];
+      if (c == q || c == qUpper || ((c < 0 || c >= 0x80) && FoldCase(c) == q))
+        break;
+    }
+
+    if (j == len) {
+      if (++ntypos > m_maxTypos)
+        return 0;
+      bLast = false;
+      continue;
+    }
+
+    score += SCORE_MATCH;
+    if (bLast && j == i)
+      score += BONUS_CONSECUTIVE;
+    else {
+      if (IsWordStart(pText, j))
+        score += BONUS_WORD_START;
+      score -= GapPenalty(j - i);
+    }
+    if (j == 0)
+      score += BONUS_TEXT_START;
+
+    nmatched++;
+    bLast = true;
+    i = j + 1;
+  }
+
+  if (nmatched == 0)
+    return 0;
+  bTypos = ntypos != 0;
+  score -= int(ntypos) * PENALTY_TYPO;
+  return std::max(score, 1);
+}
+
+int CFuzzyMatcher::ScoreFields(const CItemData &ci, int minScore) const
+{
+  int best = 0;
+  for (size_t i = 0; i < sizeof(FieldWeights) / sizeof(FieldWeights[0]); i++) {
+    const int weight = FieldWeights[i].weight;
+    if (std::max(best, minScore) >= weight * m_maxScore)
+      break; // no field from here on can do better
+
+    const TCHAR *pText;
+    size_t len;
+    ci.GetFieldText(FieldWeights[i].ft, pText, len);
+    best = std::max(best, weight * Score(pText, len));
+  }
+  return best;
+}
+
+int CFuzzyMatcher::GetRUEBonus(size_t irue, size_t nrue)
+{
+  if (irue >= nrue)
+    return 0;
+  return 16 + int(32 * (nrue - irue) / nrue);
+}
+
+int CFuzzyMatcher::GetRecentBonus(time_t atime, time_t now)
+{
+  if (atime == 0)
+    return 0;
+  const time_t days = atime < now ? (now - atime) / 86400 : 0;
+  if (days < 1)
+    return 32;
+  else if (days < 7)
+    return 24;
+  else if (days < 30)
+    return 16;
+  else if (days < 365)
+    return 8;
+  else
+    return 0;
+}
+
+int CFuzzyMatcher::GetMaxBonus()
+{
+  return GetRUEBonus(0, 1) + GetRecentBonus(1, 1);
+}
+
+void PWSMatch::SelectBest(size_t n, size_t maxResults,
+                          const std::function<int (size_t i, int minScore)> &score,
+                          std::vector<size_t> &best)
+{
+  best.clear();
+  if (maxResults == 0)
+    return;
+
+  // Each chunk keeps its own best maxResults, as the overall best are
+  // among them
+  std::vector<ScoreHeap> heaps;
+  CParallelScan().Scan(n, heaps,
+                       [&score, maxResults](size_t i, ScoreHeap &heap) {
+                         // Later items lose ties, so must do better
+                         const bool bFull = heap.size() == maxResults;
+                         const st_Scored scored = {score(i, bFull ? heap.top().score : 0), i};
+                         if (scored.score <= 0)
+                           return true;
+                         if (!bFull)
+                           heap.push(scored);
+                         else if (BetterScore()(scored, heap.top())) {
+                           heap.pop();
+                           heap.push(scored);
+                         }
+                         return true;
+                       });
+
+  std::vector<st_Scored> merged;
+  for (size_t ichunk = 0; ichunk < heaps.size(); ichunk++) {
+    for (; !heaps[ichunk].empty(); heaps[ichunk].pop())
+      merged.push_back(heaps[ichunk].top());
+  }
+  const size_t nbest = std::min(maxResults, merged.size());
+  std::partial_sort(merged.begin(), merged.begin() + nbest, merged.end(),
+                    BetterScore());
+
+  best.reserve(nbest);
+  for (size_t i = 0; i < nbest; i++)
+    best.push_back(merged[i].index);
+}
+//-----------------------------------------------------------------------------
+// Local variables:
+// mode: c++
+// End:
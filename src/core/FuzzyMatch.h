@@ -0,0 +1,96 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+#ifndef __FUZZYMATCH_H
+#define __FUZZYMATCH_H
+
+// FuzzyMatch.h
+//-----------------------------------------------------------------------------
+// Ranked ("fuzzy") search, for jumping to an entry from the keyboard.
+
+#include "FindText.h"
+#include "StringX.h"
+#include "os/pws_tchar.h"
+
+#include <functional>
+#include <vector>
+#include <time.h>
+
+class CItemData;
+
+namespace PWSMatch {
+  /*
+  * CFuzzyMatcher scores how well a text, or an entry, matches what the
+  * user typed: the higher the better, 0 if not at all. Case is ignored.
+  *
+  * A text matches if the query's characters appear in it in order, not
+  * necessarily next to each other ("gml" matches "Gmail"). Queries of
+  * 4 characters or more may also have a typo: a character that isn't
+  * found is skipped, at a cost ("gmial" still matches "Gmail").
+  * Characters matched next to each other, at the start of the text or at
+  * the start of a word score extra, so the whole query found as is scores
+  * best.
+  *
+  * An entry's score is that of its best matching field, weighted by
+  * field: title, then URL, then user and group, then notes. Entries
+  * matched at all get bonuses for having been recently used - see
+  * GetRUEBonus() and GetRecentBonus() - so that of several entries
+  * matching equally, the one used last comes first.
+  *
+  * Scoring doesn't allocate, and a CFuzzyMatcher may be used by several
+  * threads at once.
+  */
+  class CFuzzyMatcher
+  {
+  public:
+    explicit CFuzzyMatcher(const StringX &sxQuery);
+
+    bool IsEmpty() const {return m_sxQuery.empty();}
+
+    int Score(const TCHAR *pText, size_t len) const;
+    int Score(const StringX &sxText) const
+    {return Score(sxText.data(), sxText.length());}
+
+    // Best weighted field score of ci, without bonuses. Fields that can't
+    // score more than minScore aren't looked at.
+    int ScoreFields(const CItemData &ci, int minScore = 0) const;
+
+    // Bonus for an entry at position irue (0 = most recent) of a recently
+    // used entry list of nrue entries
+    static int GetRUEBonus(size_t irue, size_t nrue);
+    // Bonus for an entry last accessed at atime (0 if never)
+    static int GetRecentBonus(time_t atime, time_t now);
+    // Most that the above may add between them
+    static int GetMaxBonus();
+
+  private:
+    int ScoreSubsequence(const TCHAR *pText, size_t len, bool &bTypos) const;
+    int ScoreRun(const TCHAR *pText, size_t len, size_t pos) const;
+
+    StringX m_sxQuery; // folded
+    StringX m_sxUpper; // ASCII letters of m_sxQuery in upper case
+    CFinder m_finder;  // of the whole query
+    size_t m_maxTypos;
+    int m_maxScore; // of any one field, unweighted
+  };
+
+  // Indices of the (up to) maxResults of n items with the highest score,
+  // best first; of equal scores, the lower index first. Items scoring 0
+  // aren't included. Only a bounded heap of the best so far is kept, not
+  // all scores, and score(i, minScore) is told the score to beat to get
+  // into it, so it may return 0 as soon as it knows it can't. score is
+  // called in parallel, see CParallelScan.
+  void SelectBest(size_t n, size_t maxResults,
+                  const std::function<int (size_t i, int minScore)> &score,
+                  std::vector<size_t> &best);
+}
+
+#endif /* __FUZZYMATCH_H */
+//-----------------------------------------------------------------------------
+// Local variables:
+// mode: c++
+// End:
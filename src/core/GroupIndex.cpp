@@ -0,0 +1,309 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+// GroupIndex.cpp
+//-----------------------------------------------------------------------------
+
+#include "GroupIndex.h"
+#include "os/debug.h"
+
+using pws_os::CUUID;
+
+void CGroupIndex::SplitPath(const StringX &sxPath, std::vector<StringX> &vnames)
+{
+  vnames.clear();
+  const size_t len = sxPath.length();
+  size_t start = 0;
+  for (size_t i = 0; i + 1 < len; i++) {
+    if (sxPath[i] == L'.' && sxPath[i + 1] != L'.') {
+      vnames.push_back(sxPath.substr(start, i - start));
+      start = i + 1;
+    }
+  }
+  vnames.push_back(sxPath.substr(start));
+}
+
+void CGroupIndex::Clear()
+{
+  DeleteChildren(&m_root);
+  m_root.entries.clear();
+  m_root.numentries = m_root.numempty = 0;
+}
+
+void CGroupIndex::DeleteChildren(Node *pnode)
+{
+  NodeMap::iterator iter;
+  for (iter = pnode->children.begin(); iter != pnode->children.end(); iter++) {
+    DeleteChildren(iter->second);
+    delete iter->second;
+  }
+  pnode->children.clear();
+}
+
+const CGroupIndex::Node *CGroupIndex::Find(const StringX &sxPath) const
+{
+  std::vector<StringX> vnames;
+  SplitPath(sxPath, vnames);
+  const Node *pnode = &m_root;
+  for (size_t i = 0; i < vnames.size(); i++) {
+    NodeMap::const_iterator iter = pnode->children.find(vnames[i]);
+    if (iter == pnode->children.end())
+      return NULL;
+    pnode = iter->second;
+  }
+  return pnode;
+}
+
+CGroupIndex::Node *CGroupIndex::FindOrAdd(const StringX &sxPath)
+{
+  std::vector<StringX> vnames;
+  SplitPath(sxPath, vnames);
+  Node *pnode = &m_root;
+  for (size_t i = 0; i < vnames.size(); i++) {
+    std::pair<NodeMap::iterator, bool> pr =
+      pnode->children.insert(NodeMap::value_type(vnames[i], NULL));
+    if (pr.second) {
+      Node *pchild = new Node;
+      pchild->parent = pnode;
+      pchild->psxName = &pr.first->first;
+      pr.first->second = pchild;
+    }
+    pnode = pr.first->second;
+  }
+  return pnode;
+}
+
+void CGroupIndex::Prune(Node *pnode)
+{
+  while (pnode != &m_root && pnode->children.empty() &&
+         pnode->entries.empty() && !pnode->bEmptyGroup) {
+    Node *pparent = pnode->parent;
+    pparent->children.erase(*pnode->psxName);
+    delete pnode;
+    pnode = pparent;
+  }
+}
+
+void CGroupIndex::Add(const StringX &sxGroup, const CUUID &uuid)
+{
+  Node *pnode = FindOrAdd(sxGroup);
+  if (!pnode->entries.insert(uuid).second)
+    return;
+  for (; pnode != NULL; pnode = pnode->parent)
+    pnode->numentries++;
+}
+
+void CGroupIndex::Remove(const StringX &sxGroup, const CUUID &uuid)
+{
+  Node *pnode = Find(sxGroup);
+  if (pnode == NULL || pnode->entries.erase(uuid) == 0) {
+    // Not found means an entry was changed without updating the index
+    ASSERT(0);
+    return;
+  }
+  for (Node *p = pnode; p != NULL; p = p->parent)
+    p->numentries--;
+  Prune(pnode);
+}
+
+void CGroupIndex::Add(const StringX &sxGroup, const UUIDVector &vuuids)
+{
+  if (vuuids.empty())
+    return;
+  Node *pnode = FindOrAdd(sxGroup);
+  size_t nadded = 0;
+  for (size_t i = 0; i < vuuids.size(); i++) {
+    if (pnode->entries.insert(vuuids[i]).second)
+      nadded++;
+  }
+  for (; pnode != NULL; pnode = pnode->parent)
+    pnode->numentries += nadded;
+}
+
+void CGroupIndex::Remove(const StringX &sxGroup, const UUIDVector &vuuids)
+{
+  if (vuuids.empty())
+    return;
+  Node *pnode = Find(sxGroup);
+  if (pnode == NULL) {
+    ASSERT(0);
+    return;
+  }
+  size_t nremoved = 0;
+  for (size_t i = 0; i < vuuids.size(); i++)
+    nremoved += pnode->entries.erase(vuuids[i]);
+  ASSERT(nremoved == vuuids.size());
+  for (Node *p = pnode; p != NULL; p = p->parent)
+    p->numentries -= nremoved;
+  Prune(pnode);
+}
+
+bool CGroupIndex::AddEmptyGroup(const StringX &sxPath)
+{
+  Node *pnode = FindOrAdd(sxPath);
+  if (pnode->bEmptyGroup)
+    return false;
+  pnode->bEmptyGroup = true;
+  for (; pnode != NULL; pnode = pnode->parent)
+    pnode->numempty++;
+  return true;
+}
+
+bool CGroupIndex::RemoveEmptyGroup(const StringX &sxPath)
+{
+  Node *pnode = Find(sxPath);
+  if (pnode == NULL || !pnode->bEmptyGroup)
+    return false;
+  pnode->bEmptyGroup = false;
+  for (Node *p = pnode; p != NULL; p = p->parent)
+    p->numempty--;
+  Prune(pnode);
+  return true;
+}
+
+bool CGroupIndex::IsEmptyGroup(const StringX &sxPath) const
+{
+  const Node *pnode = Find(sxPath);
+  return pnode != NULL && pnode->bEmptyGroup;
+}
+
+void CGroupIndex::ClearEmptyGroups(Node *pnode)
+{
+  if (pnode->numempty == 0)
+    return;
+  pnode->bEmptyGroup = false;
+  pnode->numempty = 0;
+  NodeMap::iterator iter = pnode->children.begin();
+  while (iter != pnode->children.end()) {
+    Node *pchild = iter->second;
+    ClearEmptyGroups(pchild);
+    if (pchild->children.empty() && pchild->entries.empty()) {
+      delete pchild;
+      pnode->children.erase(iter++);
+    } else
+      iter++;
+  }
+}
+
+void CGroupIndex::SetEmptyGroups(const std::vector<StringX> &vEmptyGroups)
+{
+  ClearEmptyGroups(&m_root);
+  for (size_t i = 0; i < vEmptyGroups.size(); i++)
+    AddEmptyGroup(vEmptyGroups[i]);
+}
+
+void CGroupIndex::AddSubtreeEntries(const Node *pnode, UUIDVector &vuuids)
+{
+  vuuids.insert(vuuids.end(), pnode->entries.begin(), pnode->entries.end());
+  NodeMap::const_iterator iter;
+  for (iter = pnode->children.begin(); iter != pnode->children.end(); iter++) {
+    if (iter->second->numentries != 0)
+      AddSubtreeEntries(iter->second, vuuids);
+  }
+}
+
+void CGroupIndex::GetEntries(const StringX &sxPath, UUIDVector &vuuids) const
+{
+  vuuids.clear();
+  const Node *pnode = Find(sxPath);
+  if (pnode != NULL) {
+    vuuids.reserve(pnode->numentries);
+    AddSubtreeEntries(pnode, vuuids);
+  }
+}
+
+void CGroupIndex::AddSubtreeGroups(const Node *pnode, const StringX &sxPath,
+                                   std::vector<GroupEntries> &vgroups)
+{
+  if (!pnode->entries.empty()) {
+    vgroups.push_back(GroupEntries());
+    vgroups.back().sxGroup = sxPath;
+    vgroups.back().vuuids.assign(pnode->entries.begin(), pnode->entries.end());
+  }
+  NodeMap::const_iterator iter;
+  for (iter = pnode->children.begin(); iter != pnode->children.end(); iter++) {
+    if (iter->second->numentries != 0)
+      AddSubtreeGroups(iter->second, sxPath + L"." + iter->first, vgroups);
+  }
+}
+
+void CGroupIndex::GetEntriesByGroup(const StringX &sxPath,
+                                    std::vector<GroupEntries> &vgroups) const
+{
+  vgroups.clear();
+  const Node *pnode = Find(sxPath);
+  if (pnode != NULL)
+    AddSubtreeGroups(pnode, sxPath, vgroups);
+}
+
+size_t CGroupIndex::GetNumEntries(const StringX &sxPath) const
+{
+  const Node *pnode = Find(sxPath);
+  return pnode != NULL ? pnode->numentries : 0;
+}
+
+size_t CGroupIndex::GetNumEmptyGroups(const StringX &sxPath) const
+{
+  const Node *pnode = Find(sxPath);
+  return pnode != NULL ? pnode->numempty : 0;
+}
+
+void CGroupIndex::AddSubtreeEmptyGroups(const Node *pnode, const StringX &sxPath,
+                                        std::vector<StringX> &vEmptyGroups)
+{
+  if (pnode->bEmptyGroup)
+    vEmptyGroups.push_back(sxPath);
+  NodeMap::const_iterator iter;
+  for (iter = pnode->children.begin(); iter != pnode->children.end(); iter++) {
+    if (iter->second->numempty != 0)
+      AddSubtreeEmptyGroups(iter->second, sxPath + L"." + iter->first, vEmptyGroups);
+  }
+}
+
+void CGroupIndex::GetEmptyGroups(const StringX &sxPath,
+                                 std::vector<StringX> &vEmptyGroups) const
+{
+  vEmptyGroups.clear();
+  const Node *pnode = Find(sxPath);
+  if (pnode != NULL && pnode->numempty != 0)
+    AddSubtreeEmptyGroups(pnode, sxPath, vEmptyGroups);
+}
+
+size_t CGroupIndex::CountNodes(const Node *pnode)
+{
+  size_t num = pnode->children.size();
+  NodeMap::const_iterator iter;
+  for (iter = pnode->children.begin(); iter != pnode->children.end(); iter++)
+    num += CountNodes(iter->second);
+  return num;
+}
+
+size_t CGroupIndex::GetNumGroups() const
+{
+  return CountNodes(&m_root);
+}
+
+void CGroupIndex::AddMemoryUsage(const Node *pnode, st_MemoryUsage &usage)
+{
+  usage.Add(pnode->entries.size() * (MAP_NODE_OVERHEAD + sizeof(CUUID)),
+            pnode->entries.size());
+  NodeMap::const_iterator iter;
+  for (iter = pnode->children.begin(); iter != pnode->children.end(); iter++) {
+    usage.Add(MAP_NODE_OVERHEAD + sizeof(NodeMap::value_type) + sizeof(Node), 2);
+    usage.Add(iter->first);
+    AddMemoryUsage(iter->second, usage);
+  }
+}
+
+void CGroupIndex::GetMemoryUsage(st_MemoryUsage &usage) const
+{
+  AddMemoryUsage(&m_root, usage);
+}
+//-----------------------------------------------------------------------------
+// Local variables:
+// mode: c++
+// End:
@@ -0,0 +1,119 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+// GroupIndex.h
+//-----------------------------------------------------------------------------
+
+#ifndef __GROUPINDEX_H
+#define __GROUPINDEX_H
+
+#include "StringX.h"
+#include "MemoryStats.h"
+#include "os/UUID.h"
+
+#include <map>
+#include <set>
+#include <vector>
+
+/*
+* CGroupIndex is the tree of groups: each node is a group, holding the
+* entries directly in it, its subgroups, whether it's an empty group, and
+* how many entries and empty groups there are in its subtree. This is so
+* renaming, moving or deleting a group, or counting what's in it, only
+* looks at the entries under it.
+*
+* Group paths are split at a dot followed by something other than a dot,
+* so "a..b" is group "a." with subgroup "b", matching which entries
+* PWScore::DoRenameGroup() has always moved along with a group. The root
+* node stands for no group, so "" is the path of the (single) group with
+* an empty name, as entries without a group are treated.
+*/
+
+class CGroupIndex
+{
+public:
+  CGroupIndex() {}
+  ~CGroupIndex() {Clear();}
+
+  void Clear();
+  void Add(const StringX &sxGroup, const pws_os::CUUID &uuid);
+  void Remove(const StringX &sxGroup, const pws_os::CUUID &uuid);
+  // Same for several entries of a group
+  void Add(const StringX &sxGroup, const UUIDVector &vuuids);
+  void Remove(const StringX &sxGroup, const UUIDVector &vuuids);
+
+  // Empty groups are kept as flags on their nodes
+  bool AddEmptyGroup(const StringX &sxPath);
+  bool RemoveEmptyGroup(const StringX &sxPath);
+  bool IsEmptyGroup(const StringX &sxPath) const;
+  // Replaces all of them
+  void SetEmptyGroups(const std::vector<StringX> &vEmptyGroups);
+
+  // Entries in the group or any of its subgroups, in no particular order
+  void GetEntries(const StringX &sxPath, UUIDVector &vuuids) const;
+  // Same, by group: those of the group and its subgroups that have
+  // entries, with their entries
+  struct GroupEntries {
+    StringX sxGroup;
+    UUIDVector vuuids;
+  };
+  void GetEntriesByGroup(const StringX &sxPath,
+                         std::vector<GroupEntries> &vgroups) const;
+  size_t GetNumEntries(const StringX &sxPath) const;
+  // Empty groups among the group and its subgroups, and their paths
+  size_t GetNumEmptyGroups(const StringX &sxPath) const;
+  void GetEmptyGroups(const StringX &sxPath, std::vector<StringX> &vEmptyGroups) const;
+  size_t GetNumGroups() const;
+
+  // The group names making up a path, e.g. {"a.", "b"} for "a..b"
+  static void SplitPath(const StringX &sxPath, std::vector<StringX> &vnames);
+
+  void GetMemoryUsage(st_MemoryUsage &usage) const;
+
+private:
+  CGroupIndex(const CGroupIndex &); // Do not implement
+  CGroupIndex &operator=(const CGroupIndex &); // Do not implement
+
+  struct Node;
+  typedef std::map<StringX, Node *> NodeMap;
+
+  struct Node {
+    Node() : parent(NULL), psxName(NULL), numentries(0), numempty(0),
+             bEmptyGroup(false) {}
+    Node *parent;
+    const StringX *psxName; // key of this node in parent->children
+    NodeMap children;
+    std::set<pws_os::CUUID> entries; // those directly in this group
+    size_t numentries; // in this subtree, ditto for numempty
+    size_t numempty;
+    bool bEmptyGroup;
+  };
+
+  const Node *Find(const StringX &sxPath) const;
+  Node *Find(const StringX &sxPath)
+  {return const_cast<Node *>(static_cast<const CGroupIndex *>(this)->Find(sxPath));}
+  Node *FindOrAdd(const StringX &sxPath);
+  // Deletes pnode and its ancestors while they've nothing left in them
+  void Prune(Node *pnode);
+  static void DeleteChildren(Node *pnode);
+  static void ClearEmptyGroups(Node *pnode);
+  static void AddSubtreeEntries(const Node *pnode, UUIDVector &vuuids);
+  static void AddSubtreeGroups(const Node *pnode, const StringX &sxPath,
+                               std::vector<GroupEntries> &vgroups);
+  static void AddSubtreeEmptyGroups(const Node *pnode, const StringX &sxPath,
+                                    std::vector<StringX> &vEmptyGroups);
+  static size_t CountNodes(const Node *pnode);
+  static void AddMemoryUsage(const Node *pnode, st_MemoryUsage &usage);
+
+  Node m_root;
+};
+
+#endif /* __GROUPINDEX_H */
+//-----------------------------------------------------------------------------
+// Local variables:
+// mode: c++
+// End:
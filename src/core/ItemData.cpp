@@ -20,6 +20,8 @@
 #include "PWSfile.h"
 #include "PWScore.h"
 #include "PWStime.h"
+#include "XMLWriter.h"
+#include "LocalTime.h"
 
 #include "os/typedefs.h"
 #include "os/pws_tchar.h"
@@ -27,19 +29,112 @@
 #include "os/env.h"
 #include "os/utf8conv.h"
 
+#include <sodium.h>
+
 #include <time.h>
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
 
 using namespace std;
 using pws_os::CUUID;
 
+//-----------------------------------------------------------------------------
+// Decoded field cache
+
+unsigned int CItemData::m_uiTimeFormatEpoch = 0;
+
+namespace {
+  // Slot in DecodedFields for each cached time field, or -1
+  int TimeSlot(int ft)
+  {
+    switch (ft) {
+      case CItemData::CTIME:  return 0;
+      case CItemData::PMTIME: return 1;
+      case CItemData::ATIME:  return 2;
+      case CItemData::XTIME:  return 3;
+      case CItemData::RMTIME: return 4;
+      default: return -1;
+    }
+  }
+
+  // Key of the entries' fingerprints, random per session
+  struct FingerprintKey {
+    FingerprintKey() {PWSrand::GetInstance()->GetRandomData(key, sizeof(key));}
+    unsigned char key[crypto_generichash_blake2b_KEYBYTES];
+  };
+}
+
+struct CItemData::DecodedFields {
+  enum {NUM_TIMES = 5};
+
+  DecodedFields()
+    : uiTimeStrEpoch(m_uiTimeFormatEpoch), bPolicyValid(false),
+      bHistoryValid(false), bHistoryStatus(false), historyMax(0), historyErr(0),
+      bFingerprintValid(false)
+  {}
+
+  std::bitset<NUM_TIMES> timeValid;
+  time_t times[NUM_TIMES];
+
+  // Key = slot * number of formats + PWSUtil::TMC
+  std::map<int, StringX> timeStrs;
+  unsigned int uiTimeStrEpoch;
+
+  bool bPolicyValid;
+  PWPolicy policy;
+
+  // Times are formatted by GetPWHistoryList() as asked for
+  bool bHistoryValid;
+  bool bHistoryStatus;
+  size_t historyMax, historyErr;
+  PWHistPasswords history;
+
+  // Of the fields in fingerprintFields
+  bool bFingerprintValid;
+  FieldBits fingerprintFields;
+  Fingerprint fingerprint;
+};
+
+void CItemData::ResetTimeFormatCache()
+{
+  m_uiTimeFormatEpoch++;
+}
+
+CItemData::DecodedFields &CItemData::GetDecoded() const
+{
+  if (m_pDecoded == NULL)
+    m_pDecoded = new DecodedFields;
+  return *m_pDecoded;
+}
+
+void CItemData::InvalidateDecoded(FieldType ft)
+{
+  if (m_pDecoded == NULL)
+    return;
+
+  m_pDecoded->bFingerprintValid = false;
+
+  const int slot = TimeSlot(ft);
+  if (slot >= 0) {
+    m_pDecoded->timeValid.reset(slot);
+    const int nformats = PWSUtil::TMC_LOCALE_DATE_ONLY + 1;
+    m_pDecoded->timeStrs.erase(m_pDecoded->timeStrs.lower_bound(slot * nformats),
+                               m_pDecoded->timeStrs.lower_bound((slot + 1) * nformats));
+  } else if (ft == POLICY) {
+    m_pDecoded->bPolicyValid = false;
+  } else if (ft == PWHIST) {
+    m_pDecoded->bHistoryValid = false;
+    m_pDecoded->history.clear();
+  }
+}
+
 //-----------------------------------------------------------------------------
 // Constructors
 
 CItemData::CItemData()
   : m_entrytype(ET_NORMAL), m_entrystatus(ES_CLEAN),
-    m_display_info(NULL)
+    m_display_info(NULL), m_pDecoded(NULL)
 {
 }
 
@@ -47,7 +142,8 @@ CItemData::CItemData(const CItemData &that) :
   m_fields(that.m_fields),
   m_entrytype(that.m_entrytype), m_entrystatus(that.m_entrystatus),
   m_display_info(that.m_display_info == NULL ?
-                      NULL : that.m_display_info->clone())
+                      NULL : that.m_display_info->clone()),
+  m_pDecoded(NULL)
 {
   m_URFL = that.m_URFL;
 }
@@ -55,6 +151,7 @@ CItemData::CItemData(const CItemData &that) :
 CItemData::~CItemData()
 {
   delete m_display_info;
+  delete m_pDecoded;
 }
 
 CItemData& CItemData::operator=(const CItemData &that)
@@ -67,6 +164,9 @@ CItemData& CItemData::operator=(const CItemData &that)
     m_display_info = that.m_display_info == NULL ?
       NULL : that.m_display_info->clone();
 
+    delete m_pDecoded;
+    m_pDecoded = NULL;
+
     m_URFL = that.m_URFL;
 
     m_entrytype = that.m_entrytype;
@@ -80,6 +180,8 @@ void CItemData::Clear()
 {
   m_fields.clear();
   m_URFL.clear();
+  delete m_pDecoded;
+  m_pDecoded = NULL;
   m_entrytype = ET_NORMAL;
   m_entrystatus = ES_CLEAN;
 }
@@ -269,6 +371,22 @@ void CItemData::GetField(const CItemField &field, unsigned char *value, size_t &
   field.Get(value, length);
 }
 
+void CItemData::GetFieldText(FieldType ft, const TCHAR *&pText, size_t &length) const
+{
+  FieldConstIter fiter = m_fields.find(ft);
+  if (fiter == m_fields.end()) {
+    pText = _T("");
+    length = 0;
+  } else
+    pText = fiter->second.GetText(length);
+}
+
+size_t CItemData::GetPasswordLength() const
+{
+  FieldConstIter fiter = m_fields.find(PASSWORD);
+  return fiter == m_fields.end() ? 0 : fiter->second.GetLength() / sizeof(TCHAR);
+}
+
 StringX CItemData::GetFieldValue(FieldType ft) const
 {
   if (IsTextField(static_cast<unsigned char>(ft)) && ft != GROUPTITLE &&
@@ -349,6 +467,45 @@ size_t CItemData::GetSize() const
   return length;
 }
 
+void CItemData::GetMemoryUsage(st_MemoryStats &stats) const
+{
+  for (FieldConstIter fiter = m_fields.begin(); fiter != m_fields.end(); fiter++) {
+    st_MemoryUsage &usage = stats.fields[fiter->first];
+    usage.Add(MAP_NODE_OVERHEAD + sizeof(*fiter)); // FieldMap node
+    if (!fiter->second.IsEmpty())
+      usage.Add(fiter->second.GetLength());
+  }
+
+  if (!m_URFL.empty()) {
+    stats.unknownfields.Add(m_URFL.capacity() * sizeof(CItemField));
+    for (UnknownFieldsConstIter ufiter = m_URFL.begin();
+         ufiter != m_URFL.end(); ufiter++) {
+      if (!ufiter->IsEmpty())
+        stats.unknownfields.Add(ufiter->GetLength());
+    }
+  }
+
+  if (m_pDecoded != NULL) {
+    stats.entrycaches.Add(sizeof(DecodedFields));
+    std::map<int, StringX>::const_iterator siter;
+    for (siter = m_pDecoded->timeStrs.begin(); siter != m_pDecoded->timeStrs.end(); siter++) {
+      stats.entrycaches.Add(MAP_NODE_OVERHEAD + sizeof(*siter));
+      stats.entrycaches.Add(siter->second);
+    }
+    stats.entrycaches.Add(m_pDecoded->policy.symbols);
+    if (!m_pDecoded->history.empty()) {
+      stats.entrycaches.Add(m_pDecoded->history.capacity() * sizeof(PWHistPassword));
+      PWHistPasswords::const_iterator hiter;
+      for (hiter = m_pDecoded->history.begin(); hiter != m_pDecoded->history.end(); hiter++)
+        stats.entrycaches.Add(hiter->password);
+    }
+  }
+
+  // Size of the UI's object is unknown here - just count it
+  if (m_display_info != NULL)
+    stats.displayinfo.Add(0);
+}
+
 static void CleanNotes(StringX &s, TCHAR delimiter)
 {
   if (delimiter != 0) {
@@ -375,11 +532,34 @@ StringX CItemData::GetTime(int whichtime, PWSUtil::TMC result_format) const
   time_t t;
 
   GetTime(whichtime, t);
-  return PWSUtil::ConvertToDateTimeString(t, result_format);
+  const int slot = TimeSlot(whichtime);
+  if (slot < 0)
+    return PWSUtil::ConvertToDateTimeString(t, result_format);
+
+  DecodedFields &decoded = GetDecoded();
+  if (decoded.uiTimeStrEpoch != m_uiTimeFormatEpoch) {
+    decoded.timeStrs.clear();
+    decoded.uiTimeStrEpoch = m_uiTimeFormatEpoch;
+  }
+
+  const int key = slot * (PWSUtil::TMC_LOCALE_DATE_ONLY + 1) + result_format;
+  std::map<int, StringX>::const_iterator iter = decoded.timeStrs.find(key);
+  if (iter != decoded.timeStrs.end())
+    return iter->second;
+
+  const StringX sxTime = PWSUtil::ConvertToDateTimeString(t, result_format);
+  decoded.timeStrs.insert(std::make_pair(key, sxTime));
+  return sxTime;
 }
 
 void CItemData::GetTime(int whichtime, time_t &t) const
 {
+  const int slot = TimeSlot(whichtime);
+  if (slot >= 0 && m_pDecoded != NULL && m_pDecoded->timeValid.test(slot)) {
+    t = m_pDecoded->times[slot];
+    return;
+  }
+
   FieldConstIter fiter = m_fields.find(FieldType(whichtime));
   if (fiter != m_fields.end()) {
     unsigned char in[sizeof(int64)];
@@ -397,6 +577,12 @@ void CItemData::GetTime(int whichtime, time_t &t) const
     }
   } else // fiter == m_fields.end()
     t = 0;
+
+  if (slot >= 0) {
+    DecodedFields &decoded = GetDecoded();
+    decoded.times[slot] = t;
+    decoded.timeValid.set(slot);
+  }
 }
 
 void CItemData::GetUUID(uuid_array_t &uuid_array) const
@@ -425,8 +611,110 @@ const CUUID CItemData::GetUUID() const
 
 void CItemData::GetPWPolicy(PWPolicy &pwp) const
 {
-  PWPolicy mypol(GetField(POLICY));
-  pwp = mypol;
+  DecodedFields &decoded = GetDecoded();
+  if (!decoded.bPolicyValid) {
+    decoded.policy = PWPolicy(GetField(POLICY));
+    decoded.bPolicyValid = true;
+  }
+  pwp = decoded.policy;
+}
+
+CItemData::DecodedFields &CItemData::GetDecodedHistory() const
+{
+  DecodedFields &decoded = GetDecoded();
+  if (!decoded.bHistoryValid) {
+    decoded.bHistoryStatus = ParsePWHistory(GetPWHistory(),
+                                            decoded.historyMax,
+                                            decoded.historyErr,
+                                            decoded.history);
+    decoded.bHistoryValid = true;
+  }
+  return decoded;
+}
+
+bool CItemData::GetPWHistoryList(size_t &pwh_max, size_t &num_err,
+                                 PWHistList &pwhl, PWSUtil::TMC time_format) const
+{
+  const DecodedFields &decoded = GetDecodedHistory();
+  pwhl.clear();
+  pwhl.reserve(decoded.history.size());
+  PWHistPasswords::const_iterator iter;
+  for (iter = decoded.history.begin(); iter != decoded.history.end(); iter++) {
+    PWHistEntry pwh_ent;
+    pwh_ent.changetttdate = iter->changetime;
+    pwh_ent.changedate = FormatPWHistoryTime(iter->changetime, time_format);
+    pwh_ent.password = iter->password;
+    pwhl.push_back(pwh_ent);
+  }
+  pwh_max = decoded.historyMax;
+  num_err = decoded.historyErr;
+  return decoded.bHistoryStatus;
+}
+
+bool CItemData::GetPWHistoryStatus(size_t &pwh_max, size_t &num_err) const
+{
+  const DecodedFields &decoded = GetDecodedHistory();
+  pwh_max = decoded.historyMax;
+  num_err = decoded.historyErr;
+  return decoded.bHistoryStatus;
+}
+
+const PWHistPasswords &CItemData::GetPWHistoryPasswords() const
+{
+  return GetDecodedHistory().history;
+}
+
+CItemData::Fingerprint CItemData::GetFingerprint(const FieldBits &bsFields) const
+{
+  DecodedFields &decoded = GetDecoded();
+  if (decoded.bFingerprintValid && decoded.fingerprintFields == bsFields)
+    return decoded.fingerprint;
+
+  crypto_generichash_blake2b_state state;
+  static const FingerprintKey key; // thread safe initialization
+  crypto_generichash_blake2b_init(&state, key.key, sizeof(key.key),
+                                  decoded.fingerprint.size());
+  for (size_t i = 0; i < bsFields.size(); i++) {
+    if (!bsFields.test(i))
+      continue;
+
+    // Each field as its type, length (all ones if not set) and bytes
+    FieldConstIter fiter = m_fields.find(FieldType(i));
+    const uint64 length = fiter == m_fields.end() ?
+      ~uint64(0) : uint64(fiter->second.GetLength());
+    unsigned char header[1 + sizeof(length)];
+    header[0] = static_cast<unsigned char>(i);
+    memcpy(header + 1, &length, sizeof(length));
+    crypto_generichash_blake2b_update(&state, header, sizeof(header));
+    if (fiter != m_fields.end() && !fiter->second.IsEmpty())
+      crypto_generichash_blake2b_update(&state, fiter->second.GetData(),
+                                        fiter->second.GetLength());
+  }
+  crypto_generichash_blake2b_final(&state, decoded.fingerprint.data(),
+                                   decoded.fingerprint.size());
+  decoded.fingerprintFields = bsFields;
+  decoded.bFingerprintValid = true;
+  return decoded.fingerprint;
+}
+
+bool CItemData::HasPassword(const StringX &sxPassword, bool bIncludeHistory) const
+{
+  const TCHAR *pText;
+  size_t len;
+  GetFieldText(PASSWORD, pText, len);
+  if (len == sxPassword.length() &&
+      std::equal(pText, pText + len, sxPassword.data()))
+    return true;
+
+  if (bIncludeHistory && IsPasswordHistorySet()) {
+    const PWHistPasswords &history = GetPWHistoryPasswords();
+    PWHistPasswords::const_iterator iter;
+    for (iter = history.begin(); iter != history.end(); iter++) {
+      if (iter->password == sxPassword)
+        return true;
+    }
+  }
+  return false;
 }
 
 int32 CItemData::GetXTimeInt(int32 &xint) const
@@ -638,8 +926,8 @@ StringX CItemData::GetPlaintext(const TCHAR &separator,
     size_t pwh_max, num_err;
     PWHistList pwhistlist;
 
-    pwh_status = CreatePWHistoryList(GetPWHistory(), pwh_max, num_err,
-                                     pwhistlist, PWSUtil::TMC_EXPORT_IMPORT);
+    pwh_status = GetPWHistoryList(pwh_max, num_err,
+                                  pwhistlist, PWSUtil::TMC_EXPORT_IMPORT);
 
     //  Build export string
     history = MakePWHistoryHeader(pwh_status, pwh_max, pwhistlist.size());
@@ -781,39 +1069,30 @@ StringX CItemData::GetPlaintext(const TCHAR &separator,
   return ret;
 }
 
-string CItemData::GetXML(unsigned id, const FieldBits &bsExport,
+bool CItemData::WriteXML(CXMLWriter &xw, unsigned id, const FieldBits &bsExport,
                          TCHAR delimiter, const CItemData *pcibase,
-                         bool bforce_normal_entry,
-                         bool &bXMLErrorsFound) const
+                         bool bforce_normal_entry) const
 {
-  bXMLErrorsFound = false;
-  ostringstream oss; // ALWAYS a string of chars, never wchar_t!
-  oss << "\t<entry id=\"" << dec << id << "\"";
+  bool bOK = true;
+  xw << "\t<entry id=\"" << long(id) << "\"";
   if (bforce_normal_entry)
-    oss << " normal=\"" << "true" << "\"";
+    xw << " normal=\"" << "true" << "\"";
 
-  oss << ">" << endl;
+  xw << ">\n";
 
   StringX tmp;
-  CUTF8Conv utf8conv;
   unsigned char uc;
-  bool brc;
 
   tmp = GetGroup();
-  if (bsExport.test(CItemData::GROUP) && !tmp.empty()) {
-    brc = PWSUtil::WriteXMLField(oss, "group", tmp, utf8conv);
-    if (!brc) bXMLErrorsFound = true;
-  }
+  if (bsExport.test(CItemData::GROUP) && !tmp.empty())
+    bOK &= xw.WriteField("\t\t", "group", tmp);
 
   // Title mandatory (see lumimaja.xsd)
-  brc = PWSUtil::WriteXMLField(oss, "title", GetTitle(), utf8conv);
-  if (!brc) bXMLErrorsFound = true;
+  bOK &= xw.WriteField("\t\t", "title", GetTitle());
 
   tmp = GetUser();
-  if (bsExport.test(CItemData::USER) && !tmp.empty()) {
-    brc = PWSUtil::WriteXMLField(oss, "username", tmp, utf8conv);
-    if (!brc) bXMLErrorsFound = true;
-  }
+  if (bsExport.test(CItemData::USER) && !tmp.empty())
+    bOK &= xw.WriteField("\t\t", "username", tmp);
 
   // Password mandatory (see lumimaja.xsd)
   if (m_entrytype == ET_ALIAS) {
@@ -832,29 +1111,25 @@ string CItemData::GetXML(unsigned id, const FieldBits &bsExport,
   } else
     tmp = GetPassword();
 
-  brc = PWSUtil::WriteXMLField(oss, "password", tmp, utf8conv);
-  if (!brc) bXMLErrorsFound = true;
+  bOK &= xw.WriteField("\t\t", "password", tmp);
 
   tmp = GetURL();
-  if (bsExport.test(CItemData::URL) && !tmp.empty()) {
-    brc = PWSUtil::WriteXMLField(oss, "url", tmp, utf8conv);
-    if (!brc) bXMLErrorsFound = true;
-  }
+  if (bsExport.test(CItemData::URL) && !tmp.empty())
+    bOK &= xw.WriteField("\t\t", "url", tmp);
 
   tmp = GetAutoType();
-  if (bsExport.test(CItemData::AUTOTYPE) && !tmp.empty()) {
-    brc = PWSUtil::WriteXMLField(oss, "autotype", tmp, utf8conv);
-    if (!brc) bXMLErrorsFound = true;
-  }
+  if (bsExport.test(CItemData::AUTOTYPE) && !tmp.empty())
+    bOK &= xw.WriteField("\t\t", "autotype", tmp);
 
   tmp = GetNotes();
   if (bsExport.test(CItemData::NOTES) && !tmp.empty()) {
     CleanNotes(tmp, delimiter);
-    brc = PWSUtil::WriteXMLField(oss, "notes", tmp, utf8conv);
-    if (!brc) bXMLErrorsFound = true;
+    bOK &= xw.WriteField("\t\t", "notes", tmp);
   }
 
-  oss << "\t\t<uuid><![CDATA[" << GetUUID() << "]]></uuid>" << endl;
+  xw << "\t\t<uuid><![CDATA[";
+  xw.WriteUUID(GetUUID());
+  xw << "]]></uuid>\n";
 
   time_t t;
   int32 i32;
@@ -862,148 +1137,114 @@ string CItemData::GetXML(unsigned id, const FieldBits &bsExport,
 
   GetCTime(t);
   if (bsExport.test(CItemData::CTIME) && t)
-    oss << PWSUtil::GetXMLTime(2, "ctimex", t, utf8conv);
+    xw.WriteTime("\t\t", "ctimex", t);
 
   GetATime(t);
   if (bsExport.test(CItemData::ATIME) && t)
-    oss << PWSUtil::GetXMLTime(2, "atimex", t, utf8conv);
+    xw.WriteTime("\t\t", "atimex", t);
 
   GetXTime(t);
   if (bsExport.test(CItemData::XTIME) && t)
-    oss << PWSUtil::GetXMLTime(2, "xtimex", t, utf8conv);
+    xw.WriteTime("\t\t", "xtimex", t);
 
   GetXTimeInt(i32);
   if (bsExport.test(CItemData::XTIME_INT) && i32 > 0 && i32 <= 3650)
-    oss << "\t\t<xtime_interval>" << dec << i32 << "</xtime_interval>" << endl;
+    xw << "\t\t<xtime_interval>" << long(i32) << "</xtime_interval>\n";
 
   GetPMTime(t);
   if (bsExport.test(CItemData::PMTIME) && t)
-    oss << PWSUtil::GetXMLTime(2, "pmtimex", t, utf8conv);
+    xw.WriteTime("\t\t", "pmtimex", t);
 
   GetRMTime(t);
   if (bsExport.test(CItemData::RMTIME) && t)
-    oss << PWSUtil::GetXMLTime(2, "rmtimex", t, utf8conv);
+    xw.WriteTime("\t\t", "rmtimex", t);
 
   StringX sxPolicyName = GetPolicyName();
   if (sxPolicyName.empty()) {
     PWPolicy pwp;
     GetPWPolicy(pwp);
     if (bsExport.test(CItemData::POLICY) && pwp.flags != 0) {
-      oss << "\t\t<PasswordPolicy>" << endl;
-      oss << dec;
-      oss << "\t\t\t<PWLength>" << pwp.length << "</PWLength>" << endl;
+      xw << "\t\t<PasswordPolicy>\n";
+      xw << "\t\t\t<PWLength>" << long(pwp.length) << "</PWLength>\n";
       if (pwp.flags & PWPolicy::UseLowercase)
-        oss << "\t\t\t<PWUseLowercase>1</PWUseLowercase>" << endl;
+        xw << "\t\t\t<PWUseLowercase>1</PWUseLowercase>\n";
       if (pwp.flags & PWPolicy::UseUppercase)
-        oss << "\t\t\t<PWUseUppercase>1</PWUseUppercase>" << endl;
+        xw << "\t\t\t<PWUseUppercase>1</PWUseUppercase>\n";
       if (pwp.flags & PWPolicy::UseDigits)
-        oss << "\t\t\t<PWUseDigits>1</PWUseDigits>" << endl;
+        xw << "\t\t\t<PWUseDigits>1</PWUseDigits>\n";
       if (pwp.flags & PWPolicy::UseSymbols)
-        oss << "\t\t\t<PWUseSymbols>1</PWUseSymbols>" << endl;
+        xw << "\t\t\t<PWUseSymbols>1</PWUseSymbols>\n";
       if (pwp.flags & PWPolicy::MakePronounceable)
-        oss << "\t\t\t<PWMakePronounceable>1</PWMakePronounceable>" << endl;
+        xw << "\t\t\t<PWMakePronounceable>1</PWMakePronounceable>\n";
 
-      oss << "\t\t</PasswordPolicy>" << endl;
+      xw << "\t\t</PasswordPolicy>\n";
     }
   } else {
-    if (bsExport.test(CItemData::POLICY) || bsExport.test(CItemData::POLICYNAME)) {
-      brc = PWSUtil::WriteXMLField(oss, "PasswordPolicyName", sxPolicyName,
-                        utf8conv, "\t\t");
-      if (!brc) bXMLErrorsFound = true;
-    }
+    if (bsExport.test(CItemData::POLICY) || bsExport.test(CItemData::POLICYNAME))
+      bOK &= xw.WriteField("\t\t", "PasswordPolicyName", sxPolicyName);
   }
 
   if (bsExport.test(CItemData::PWHIST)) {
+    // The decoded history, so no times are formatted but those written
     size_t pwh_max, num_err;
-    PWHistList pwhistlist;
-    bool pwh_status = CreatePWHistoryList(GetPWHistory(), pwh_max, num_err,
-                                          pwhistlist, PWSUtil::TMC_XML);
-    oss << dec;
-    if (pwh_status || pwh_max > 0 || !pwhistlist.empty()) {
-      oss << "\t\t<pwhistory>" << endl;
-      oss << "\t\t\t<status>" << pwh_status << "</status>" << endl;
-      oss << "\t\t\t<max>" << pwh_max << "</max>" << endl;
-      oss << "\t\t\t<num>" << pwhistlist.size() << "</num>" << endl;
-      if (!pwhistlist.empty()) {
-        oss << "\t\t\t<history_entries>" << endl;
-        int num = 1;
-        PWHistList::iterator hiter;
-        for (hiter = pwhistlist.begin(); hiter != pwhistlist.end();
-             hiter++) {
-          const unsigned char *utf8 = NULL;
-          size_t utf8Len = 0;
-
-          oss << "\t\t\t\t<history_entry num=\"" << num << "\">" << endl;
-          const PWHistEntry &pwshe = *hiter;
-          oss << "\t\t\t\t\t<changedx>";
-          if (utf8conv.ToUTF8(pwshe.changedate.substr(0, 10), utf8, utf8Len))
-            oss.write(reinterpret_cast<const char *>(utf8), utf8Len);
-          else
-            oss << "1970-01-01";
-
-          oss << "T";
-          if (utf8conv.ToUTF8(pwshe.changedate.substr(pwshe.changedate.length() - 8),
-                              utf8, utf8Len))
-            oss.write(reinterpret_cast<const char *>(utf8), utf8Len);
-          else
-            oss << "00:00";
-
-          oss << "</changedx>" << endl;
-          brc = PWSUtil::WriteXMLField(oss, "oldpassword", pwshe.password,
-                        utf8conv, "\t\t\t\t\t");
-          if (!brc) bXMLErrorsFound = true;
-
-          oss << "\t\t\t\t</history_entry>" << endl;
+    const bool pwh_status = GetPWHistoryStatus(pwh_max, num_err);
+    const PWHistPasswords &pwhistory = GetPWHistoryPasswords();
+    if (pwh_status || pwh_max > 0 || !pwhistory.empty()) {
+      xw << "\t\t<pwhistory>\n";
+      xw << "\t\t\t<status>" << (pwh_status ? '1' : '0') << "</status>\n";
+      xw << "\t\t\t<max>" << long(pwh_max) << "</max>\n";
+      xw << "\t\t\t<num>" << long(pwhistory.size()) << "</num>\n";
+      if (!pwhistory.empty()) {
+        xw << "\t\t\t<history_entries>\n";
+        long num = 1;
+        PWHistPasswords::const_iterator hiter;
+        for (hiter = pwhistory.begin(); hiter != pwhistory.end(); hiter++) {
+          xw << "\t\t\t\t<history_entry num=\"" << num << "\">\n";
+          xw.WriteTime("\t\t\t\t\t", "changedx", hiter->changetime);
+          bOK &= xw.WriteField("\t\t\t\t\t", "oldpassword", hiter->password);
+          xw << "\t\t\t\t</history_entry>\n";
 
           num++;
         } // for
-        oss << "\t\t\t</history_entries>" << endl;
+        xw << "\t\t\t</history_entries>\n";
       } // if !empty
-      oss << "\t\t</pwhistory>" << endl;
+      xw << "\t\t</pwhistory>\n";
     }
   }
 
   tmp = GetRunCommand();
-  if (bsExport.test(CItemData::RUNCMD) && !tmp.empty()) {
-    brc = PWSUtil::WriteXMLField(oss, "runcommand", tmp, utf8conv);
-    if (!brc) bXMLErrorsFound = true;
-  }
+  if (bsExport.test(CItemData::RUNCMD) && !tmp.empty())
+    bOK &= xw.WriteField("\t\t", "runcommand", tmp);
 
   GetDCA(i16);
   if (bsExport.test(CItemData::DCA) &&
       i16 >= PWSprefs::minDCA && i16 <= PWSprefs::maxDCA)
-    oss << "\t\t<dca>" << i16 << "</dca>" << endl;
+    xw << "\t\t<dca>" << long(i16) << "</dca>\n";
 
   GetShiftDCA(i16);
   if (bsExport.test(CItemData::SHIFTDCA) &&
       i16 >= PWSprefs::minDCA && i16 <= PWSprefs::maxDCA)
-    oss << "\t\t<shiftdca>" << i16 << "</shiftdca>" << endl;
+    xw << "\t\t<shiftdca>" << long(i16) << "</shiftdca>\n";
 
 
   tmp = GetEmail();
-  if (bsExport.test(CItemData::EMAIL) && !tmp.empty()) {
-    brc = PWSUtil::WriteXMLField(oss, "email", tmp, utf8conv);
-    if (!brc) bXMLErrorsFound = true;
-  }
+  if (bsExport.test(CItemData::EMAIL) && !tmp.empty())
+    bOK &= xw.WriteField("\t\t", "email", tmp);
 
   GetProtected(uc);
   if (bsExport.test(CItemData::PROTECTED) && uc != 0)
-    oss << "\t\t<protected>1</protected>" << endl;
+    xw << "\t\t<protected>1</protected>\n";
 
   tmp = GetSymbols();
-  if (bsExport.test(CItemData::SYMBOLS) && !tmp.empty()) {
-    brc = PWSUtil::WriteXMLField(oss, "symbols", tmp, utf8conv);
-    if (!brc) bXMLErrorsFound = true;
-  }
+  if (bsExport.test(CItemData::SYMBOLS) && !tmp.empty())
+    bOK &= xw.WriteField("\t\t", "symbols", tmp);
 
   tmp = GetKBShortcut();
-  if (bsExport.test(CItemData::KBSHORTCUT) && !tmp.empty()) {
-    brc = PWSUtil::WriteXMLField(oss, "kbshortcut", tmp, utf8conv);
-    if (!brc) bXMLErrorsFound = true;
-  }
+  if (bsExport.test(CItemData::KBSHORTCUT) && !tmp.empty())
+    bOK &= xw.WriteField("\t\t", "kbshortcut", tmp);
 
-  oss << "\t</entry>" << endl << endl;
-  return oss.str();
+  xw << "\t</entry>\n\n";
+  return bOK;
 }
 
 void CItemData::SplitName(const StringX &name,
@@ -1042,6 +1283,7 @@ void CItemData::SetField(FieldType ft, const StringX &value)
     m_fields[ft].Set(value, static_cast<unsigned char>(ft));
   } else
     m_fields.erase(static_cast<FieldType>(ft));
+  InvalidateDecoded(ft);
 }
 
 void CItemData::SetField(FieldType ft, const unsigned char *value, size_t length)
@@ -1051,6 +1293,7 @@ void CItemData::SetField(FieldType ft, const unsigned char *value, size_t length
     m_fields[ft].Set(value, length, static_cast<unsigned char>(ft));
   } else
     m_fields.erase(static_cast<FieldType>(ft));
+  InvalidateDecoded(ft);
 }
 
 void CItemData::CreateUUID()
@@ -1410,7 +1653,7 @@ void CItemData::SetProtected(bool bOnOff)
     const unsigned char ucProtected = 1;
     SetField(PROTECTED, &ucProtected, sizeof(char));
   } else { // remove field
-    m_fields.erase(PROTECTED);
+    ClearField(PROTECTED);
   }
 }
 
@@ -1523,9 +1766,8 @@ bool CItemData::ValidatePWHistory()
   }
 
   size_t pwh_max, num_err;
-  PWHistList pwhistlist;
-  bool pwh_status = CreatePWHistoryList(pwh, pwh_max, num_err,
-                                        pwhistlist, PWSUtil::TMC_EXPORT_IMPORT);
+  PWHistPasswords pwhistlist;
+  bool pwh_status = ParsePWHistory(pwh, pwh_max, num_err, pwhistlist);
   if (num_err == 0)
     return true;
 
@@ -1543,10 +1785,10 @@ bool CItemData::ValidatePWHistory()
   StringX sxBuffer;
   StringX sxNewHistory = MakePWHistoryHeader(pwh_status, pwh_max, listnum);
 
-  PWHistList::const_iterator citer;
+  PWHistPasswords::const_iterator citer;
   for (citer = pwhistlist.begin(); citer != pwhistlist.end(); citer++) {
     Format(sxBuffer, L"%08x%04x%ls",
-             static_cast<long>(citer->changetttdate), citer->password.length(),
+             static_cast<long>(citer->changetime), citer->password.length(),
              citer->password.c_str());
       sxNewHistory += sxBuffer;
       sxBuffer = _T("");
@@ -1558,6 +1800,69 @@ bool CItemData::ValidatePWHistory()
   return false;
 }
 
+typedef StringX (CItemData::*SearchableFieldFn)() const;
+
+static const struct {
+  CItemData::FieldType ft;
+  SearchableFieldFn fn;
+} SearchableFields[] = {
+  {CItemData::GROUP,     &CItemData::GetGroup},
+  {CItemData::TITLE,     &CItemData::GetTitle},
+  {CItemData::USER,      &CItemData::GetUser},
+  {CItemData::PASSWORD,  &CItemData::GetPassword},
+  {CItemData::URL,       &CItemData::GetURL},
+  {CItemData::EMAIL,     &CItemData::GetEmail},
+  {CItemData::RUNCMD,    &CItemData::GetRunCommand},
+  {CItemData::AUTOTYPE,  &CItemData::GetAutoType},
+  {CItemData::XTIME_INT, &CItemData::GetXTimeInt},
+};
+
+bool CItemData::ContainsText(const StringX &sxText, bool bCaseSensitive,
+                             const FieldBits &bsFields) const
+{
+  return ContainsText(PWSMatch::CFinder(sxText, bCaseSensitive), bsFields);
+}
+
+bool CItemData::ContainsText(const PWSMatch::CFinder &finder,
+                             const FieldBits &bsFields) const
+{
+  if (finder.GetSearch().empty())
+    return false;
+
+  for (size_t i = 0; i < NumberOf(SearchableFields); i++) {
+    if (bsFields.test(SearchableFields[i].ft) &&
+        finder.FoundIn((this->*SearchableFields[i].fn)()))
+      return true;
+  }
+
+  if (bsFields.test(NOTES) && finder.FoundIn(GetNotes()))
+    return true;
+
+  if (bsFields.test(PWHIST) && IsPasswordHistorySet()) {
+    const PWHistPasswords &history = GetPWHistoryPasswords();
+    PWHistPasswords::const_iterator iter;
+    for (iter = history.begin(); iter != history.end(); iter++) {
+      if (finder.FoundIn(iter->password))
+        return true;
+    }
+  }
+  return false;
+}
+
+void CItemData::GetSearchableText(std::vector<StringX> &vtext) const
+{
+  vtext.clear();
+  for (size_t i = 0; i < NumberOf(SearchableFields); i++) {
+    if (SearchableFields[i].ft == PASSWORD)
+      continue;
+    const StringX sxText = (this->*SearchableFields[i].fn)();
+    if (!sxText.empty())
+      vtext.push_back(sxText);
+  }
+  if (IsNotesSet())
+    vtext.push_back(GetNotes());
+}
+
 bool CItemData::Matches(const stringT &stValue, int iObject,
                         int iFunction) const
 {
@@ -1591,7 +1896,37 @@ bool CItemData::Matches(const stringT &stValue, int iObject,
     return PWSMatch::Match(bValue, iFunction);
   }
 
-  return PWSMatch::Match(stValue.c_str(), sx_Object, iFunction);
+  return PWSMatch::Match(stValue.data(), stValue.length(),
+                         sx_Object.data(), sx_Object.length(), iFunction);
+}
+
+bool CItemData::Matches(const PWSMatch::CCompiledMatch &match, int iObject) const
+{
+  FieldType ft = static_cast<FieldType>(iObject);
+  switch(ft) {
+    case GROUP:
+    case TITLE:
+    case USER:
+    case URL:
+    case NOTES:
+    case PASSWORD:
+    case RUNCMD:
+    case EMAIL:
+    case SYMBOLS:
+    case POLICYNAME:
+    case AUTOTYPE:
+      {
+        const TCHAR *pText;
+        size_t len;
+        GetFieldText(ft, pText, len);
+        return match.Matches(pText, len);
+      }
+    case GROUPTITLE:
+      return match.Matches(GetGroup() + TCHAR('.') + GetTitle());
+    default:
+      ASSERT(0);
+  }
+  return match.Matches(StringX());
 }
 
 bool CItemData::Matches(int num1, int num2, int iObject,
@@ -1605,7 +1940,7 @@ bool CItemData::Matches(int num1, int num2, int iObject,
       GetXTimeInt(iValue);
       break;
     case ENTRYSIZE:
-      GetSize(reinterpret_cast<size_t &>(iValue));
+      iValue = static_cast<int>(GetSize());
       break;
     case PASSWORDLEN:
       iValue = GetPasswordLength();
@@ -1671,19 +2006,7 @@ bool CItemData::Matches(time_t time1, time_t time2, int iObject,
   if (!bValue)  // date empty - always return false for other comparisons
     return false;
   else {
-    time_t testtime = time_t(0);
-    if (tValue) {
-      struct tm st;
-      errno_t err;
-      err = localtime_s(&st, &tValue);
-      ASSERT(err == 0);
-      if (!err) {
-        st.tm_hour = 0;
-        st.tm_min = 0;
-        st.tm_sec = 0;
-        testtime = mktime(&st);
-      }
-    }
+    const time_t testtime = PWSLocalTime::StartOfDay(tValue);
     return PWSMatch::Match(time1, time2, testtime, iFunction);
   }
 }
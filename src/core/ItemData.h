@@ -12,6 +12,7 @@
 #define __ITEMDATA_H
 
 #include <time.h>
+#include <array>
 #include <bitset>
 #include <vector>
 #include <string>
@@ -22,6 +23,8 @@
 #include "ItemField.h"
 #include "PWSprefs.h"
 #include "PWPolicy.h"
+#include "PWHistory.h"
+#include "MemoryStats.h"
 #include "os/UUID.h"
 #include "StringX.h"
 
@@ -47,6 +50,8 @@ typedef UnknownFields::const_iterator UnknownFieldsConstIter;
 */
 
 class PWSfile;
+class CXMLWriter;
+namespace PWSMatch { class CFinder; class CCompiledMatch; }
 
 struct DisplayInfoBase
 {
@@ -126,6 +131,10 @@ public:
 
   static bool IsTextField(unsigned char t);
 
+  // Call if the locale or timezone changes, to discard cached
+  // formatted time strings of all entries
+  static void ResetTimeFormatCache();
+
   //Construction
   CItemData();
   CItemData(const CItemData& stuffhere);
@@ -144,7 +153,7 @@ public:
   StringX GetTitle() const {return GetField(TITLE);} // V20
   StringX GetUser() const  {return GetField(USER);}  // V20
   StringX GetPassword() const {return GetField(PASSWORD);}
-  size_t GetPasswordLength() const {return GetField(PASSWORD).length();}
+  size_t GetPasswordLength() const;
   StringX GetNotes(TCHAR delimiter = 0) const;
   void GetUUID(uuid_array_t &) const; // V20
   const pws_os::CUUID GetUUID() const; // V20 - see comment in .cpp re return type
@@ -186,6 +195,13 @@ public:
   StringX GetXTimeInt() const; // V30
   StringX GetPWHistory() const;  // V30
   void GetPWPolicy(PWPolicy &pwp) const;
+  // Parsed form of GetPWHistory(), as per CreatePWHistoryList()
+  bool GetPWHistoryList(size_t &pwh_max, size_t &num_err,
+                        PWHistList &pwhl, PWSUtil::TMC time_format) const;
+  // The same without the formatted times or copying, for search and
+  // filters: GetPWHistoryPasswords() is valid until the history is next set
+  bool GetPWHistoryStatus(size_t &pwh_max, size_t &num_err) const;
+  const PWHistPasswords &GetPWHistoryPasswords() const;
   StringX GetPWPolicy() const {return GetField(POLICY);}
   StringX GetRunCommand() const {return GetField(RUNCMD);}
   int16 GetDCA(int16 &iDCA, const bool bShift = false) const;
@@ -202,14 +218,18 @@ public:
   StringX GetKBShortcut() const;
 
   StringX GetFieldValue(FieldType ft) const;
+  // Text field without copying it, valid until the field is next set
+  void GetFieldText(FieldType ft, const TCHAR *&pText, size_t &length) const;
 
   // GetPlaintext returns all fields separated by separator, if delimiter is != 0, then
   // it's used for multi-line notes and to replace '.' within the Title field.
   StringX GetPlaintext(const TCHAR &separator, const FieldBits &bsExport,
                        const TCHAR &delimiter, const CItemData *pcibase) const;
-  std::string GetXML(unsigned id, const FieldBits &bsExport, TCHAR m_delimiter,
-                     const CItemData *pcibase, bool bforce_normal_entry,
-                     bool &bXMLErrorsFound) const;
+  // Writes the entry's <entry> element; returns false if any field was
+  // skipped for having characters XML doesn't allow
+  bool WriteXML(CXMLWriter &xw, unsigned id, const FieldBits &bsExport,
+                TCHAR delimiter, const CItemData *pcibase,
+                bool bforce_normal_entry) const;
 
   void SetUnknownField(unsigned char type, size_t length,
                        const unsigned char *ufield);
@@ -266,7 +286,7 @@ public:
   DisplayInfoBase *GetDisplayInfo() const {return m_display_info;}
   void SetDisplayInfo(DisplayInfoBase *di) {delete m_display_info; m_display_info = di;}
   void Clear();
-  void ClearField(FieldType ft) {m_fields.erase(ft);}
+  void ClearField(FieldType ft) {m_fields.erase(ft); InvalidateDecoded(ft);}
 
   // Check record for correct password history
   bool ValidatePWHistory(); // return true if OK, false if there's a problem
@@ -276,7 +296,9 @@ public:
 
   // Predicate to determine if item matches given criteria
   bool Matches(const stringT &stValue, int iObject, 
-               int iFunction) const;  // string values
+               int iFunction) const;  // string values, see PWSMatch::Match()
+  bool Matches(const PWSMatch::CCompiledMatch &match,
+               int iObject) const;  // string values, compiled
   bool Matches(int num1, int num2, int iObject,
                int iFunction) const;  // integer values
   bool Matches(time_t time1, time_t time2, int iObject,
@@ -285,6 +307,26 @@ public:
   bool Matches(EntryType etype, int iFunction) const;  // Entrytype values
   bool Matches(EntryStatus estatus, int iFunction) const;  // Entrystatus values
 
+  // Free text search: true if any of the fields in bsFields contains sxText.
+  // GetSearchableText() returns the text of the fields that may be searched
+  // but the password and password history, e.g., to build PWScore's search
+  // index, which so holds no passwords, current or old.
+  bool ContainsText(const StringX &sxText, bool bCaseSensitive,
+                    const FieldBits &bsFields) const;
+  bool ContainsText(const PWSMatch::CFinder &finder, const FieldBits &bsFields) const;
+  void GetSearchableText(std::vector<StringX> &vtext) const;
+  // True if sxPassword is the password or, if bIncludeHistory, one of the
+  // old ones (case sensitive, the whole password)
+  bool HasPassword(const StringX &sxPassword, bool bIncludeHistory) const;
+
+  // Keyed BLAKE2b hash of the fields in bsFields as stored: entries with
+  // the same fingerprint have the same values in those fields, so only
+  // entries whose fingerprints differ need comparing field by field.
+  // The key is random per session, so fingerprints mean nothing outside
+  // it. Cached (for the last bsFields asked for) until a field is set.
+  typedef std::array<unsigned char, 16> Fingerprint;
+  Fingerprint GetFingerprint(const FieldBits &bsFields) const;
+
   bool IsGroupSet() const                  { return IsFieldSet(GROUP);     }
   bool IsUserSet() const                   { return IsFieldSet(USER);      }
   bool IsNotesSet() const                  { return IsFieldSet(NOTES);     }
@@ -348,6 +390,9 @@ public:
 
   size_t GetSize() const;
   void GetSize(size_t &isize) const {isize = GetSize();}
+  // Adds this entry's heap usage (fields by type, unknown fields,
+  // caches, display info) to stats
+  void GetMemoryUsage(st_MemoryStats &stats) const;
 
 
 private:
@@ -366,6 +411,18 @@ private:
   // Following used by display methods - we just keep it handy
   DisplayInfoBase *m_display_info;
 
+  // Decoded forms of the time, policy and history fields, formatted time
+  // strings and the fingerprint. Built on first use and discarded per
+  // field whenever that field is set, so the grid, sort and search don't
+  // keep re-parsing.
+  // Purely a cache: not copied with the entry.
+  struct DecodedFields;
+  mutable DecodedFields *m_pDecoded;
+  DecodedFields &GetDecoded() const;
+  DecodedFields &GetDecodedHistory() const;
+  void InvalidateDecoded(FieldType ft);
+  static unsigned int m_uiTimeFormatEpoch;
+
   // move from pre-2.0 name to post-2.0 title+user
   void SplitName(const StringX &name,
                  StringX &title, StringX &username);
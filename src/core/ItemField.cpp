@@ -9,64 +9,81 @@
 //-----------------------------------------------------------------------------
 
 #include <math.h>
+#include <atomic>
+#include <new>
 
 #include "ItemField.h"
 #include "Util.h"
 #include "PWSrand.h"
 #include "os/funcwrap.h"
 
+// Header of a shared field buffer; the data follows it in the
+// same allocation
+struct CItemField::Buffer {
+  std::atomic<unsigned int> refs;
+  unsigned char *Data() {return reinterpret_cast<unsigned char *>(this + 1);}
+
+  static Buffer *Create(const unsigned char *value, size_t length)
+  {
+    void *p = ::operator new(sizeof(Buffer) + length, std::nothrow);
+    if (p == NULL)
+      return NULL;
+    Buffer *buf = new (p) Buffer;
+    buf->refs = 1;
+    memcpy(buf->Data(), value, length);
+    return buf;
+  }
+};
+
 CItemField::CItemField(const CItemField &that)
-  : m_Type(that.m_Type), m_Length(that.m_Length)
+  : m_Type(that.m_Type), m_Length(that.m_Length), m_Buffer(that.m_Buffer)
 {
-  if (m_Length > 0) {
-    m_Data = new unsigned char[m_Length];
-    memcpy(m_Data, that.m_Data, m_Length);
-  } else {
-    m_Data = NULL;
-  }
+  if (m_Buffer != NULL)
+    m_Buffer->refs++;
 }
 
 CItemField &CItemField::operator=(const CItemField &that)
 {
   if (this != &that) {
+    if (that.m_Buffer != NULL)
+      that.m_Buffer->refs++;
+    Release();
     m_Type = that.m_Type;
     m_Length = that.m_Length;
-    delete[] m_Data;
-    if (m_Length > 0) {
-      m_Data = new unsigned char[m_Length];
-      memcpy(m_Data, that.m_Data, m_Length);
-    } else {
-      m_Data = NULL;
-    }
+    m_Buffer = that.m_Buffer;
   }
   return *this;
 }
 
-void CItemField::Empty()
+void CItemField::Release()
 {
-  if (m_Data != NULL) {
-    delete[] m_Data;
-    m_Data = NULL;
-    m_Length = 0;
+  if (m_Buffer != NULL && --m_Buffer->refs == 0) {
+    trashMemory(m_Buffer->Data(), m_Length);
+    m_Buffer->~Buffer();
+    ::operator delete(m_Buffer);
   }
+  m_Buffer = NULL;
+}
+
+void CItemField::Empty()
+{
+  Release();
+  m_Length = 0;
 }
 
 void CItemField::Set(const unsigned char* value, size_t length,
                      unsigned char type)
 {
+  // Never write into a buffer that may be shared with copies
+  Release();
   m_Length = length;
 
-  delete[] m_Data;
-
-  if (m_Length == 0) {
-    m_Data = NULL;
-  } else {
-    m_Data = new unsigned char[m_Length];
-    if (m_Data == NULL) { // out of memory - try to fail gracefully
+  if (m_Length != 0) {
+    m_Buffer = Buffer::Create(value, m_Length);
+    if (m_Buffer == NULL) { // out of memory - try to fail gracefully
       m_Length = 0; // at least keep structure consistent
       return;
     }
-    memcpy(m_Data, value, m_Length);
   }
   if (type != 0xff)
     m_Type = type;
@@ -83,8 +100,8 @@ void CItemField::Set(const StringX &value, unsigned char type)
 void CItemField::Get(unsigned char *value, size_t &length) const
 {
   // Sanity check: length is 0 iff data ptr is NULL
-  ASSERT((m_Length == 0 && m_Data == NULL) ||
-         (m_Length > 0 && m_Data != NULL));
+  ASSERT((m_Length == 0 && m_Buffer == NULL) ||
+         (m_Length > 0 && m_Buffer != NULL));
   /*
   * length is an in/out parameter:
   * In: size of value array - must be at least 1
@@ -95,21 +112,33 @@ void CItemField::Get(unsigned char *value, size_t &length) const
     length = 0;
   } else {
     ASSERT(length >= m_Length);
-    memcpy(value, m_Data, m_Length);
+    memcpy(value, m_Buffer->Data(), m_Length);
     length = m_Length;
   }
 }
 
+const TCHAR *CItemField::GetText(size_t &length) const
+{
+  ASSERT(m_Length % sizeof(TCHAR) == 0);
+  length = m_Length / sizeof(TCHAR);
+  return m_Length == 0 ? _T("") : reinterpret_cast<const TCHAR *>(m_Buffer->Data());
+}
+
+const unsigned char *CItemField::GetData() const
+{
+  return m_Length == 0 ? NULL : m_Buffer->Data();
+}
+
 void CItemField::Get(StringX &value) const
 {
   // Sanity check: length is 0 iff data ptr is NULL
-  ASSERT((m_Length == 0 && m_Data == NULL) ||
-         (m_Length > 0 && m_Data != NULL && m_Length % sizeof(TCHAR) == 0));
+  ASSERT((m_Length == 0 && m_Buffer == NULL) ||
+         (m_Length > 0 && m_Buffer != NULL && m_Length % sizeof(TCHAR) == 0));
 
   if (m_Length == 0) {
     value = _T("");
   } else {
-    TCHAR *pt = reinterpret_cast<TCHAR *>(m_Data);
+    const TCHAR *pt = reinterpret_cast<const TCHAR *>(m_Buffer->Data());
     size_t x;
 
     // copy to value TCHAR by TCHAR
@@ -18,15 +18,20 @@
 * CItemField contains the data for a given CItemData field in encrypted
 * form.
 * Set() encrypts, Get() decrypts
+*
+* The data is immutable once set, so copies share a single reference
+* counted buffer, and Set() always starts a new one (copy-on-write).
+* This keeps copies of CItemData, e.g., those held by undo/redo
+* Commands, cheap in both time and memory.
 */
 
 class CItemField
 {
 public:
-  explicit CItemField(unsigned char type = 0xff): m_Type(type), m_Length(0), m_Data(NULL)
+  explicit CItemField(unsigned char type = 0xff): m_Type(type), m_Length(0), m_Buffer(NULL)
   {}
   CItemField(const CItemField &that); // copy ctor
-  ~CItemField() {if (m_Length > 0) delete[] m_Data;}
+  ~CItemField() {Release();}
 
   CItemField &operator=(const CItemField &that);
 
@@ -35,15 +40,28 @@ public:
 
   void Get(StringX &value) const;
   void Get(unsigned char *value, size_t &length) const;
+  // The stored text in place, without copying: valid until this
+  // field is set or destroyed. length is in characters.
+  const TCHAR *GetText(size_t &length) const;
+  // The stored bytes in place, as GetText(), of any type of field.
+  // GetLength() bytes, or NULL if empty.
+  const unsigned char *GetData() const;
   unsigned char GetType() const {return m_Type;}
   size_t GetLength() const {return m_Length;}
   bool IsEmpty() const {return m_Length == 0;}
   void Empty();
+  // True if both fields refer to the same buffer (i.e., one is an
+  // unmodified copy of the other)
+  bool SharesDataWith(const CItemField &that) const
+  {return m_Buffer != NULL && m_Buffer == that.m_Buffer;}
 
 private:
+  struct Buffer;
+  void Release();
+
   unsigned char m_Type; // almost const
   size_t m_Length;
-  unsigned char *m_Data;
+  Buffer *m_Buffer;
 };
 
 #endif /* __ITEMFIELD_H */
@@ -0,0 +1,184 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+// LocalTime.cpp
+//-----------------------------------------------------------------------------
+
+#include "LocalTime.h"
+
+#include "os/funcwrap.h"
+
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+  const int SECS_PER_DAY = 24 * 60 * 60;
+  const time_t CACHE_LIFETIME = 60;   // seconds
+  const size_t MAX_CACHE_SIZE = 32768; // days, i.e., ~90 years
+
+  struct DayInfo {
+    time_t midnight;
+    bool bRegular; // false if the UTC offset changes during the day
+  };
+
+  struct DayCache {
+    std::mutex mutex;
+    std::unordered_map<long long, DayInfo> days;
+    time_t expires;
+  };
+
+  DayCache &GetDayCache()
+  {
+    static DayCache cache;
+    return cache;
+  }
+
+  // Days from 1970-01-01 to a date of the (proleptic) Gregorian calendar,
+  // and back. See http://howardhinnant.github.io/date_algorithms.html
+  long long DaysFromCivil(long long y, int m, int d)
+  {
+    y -= m <= 2;
+    const long long era = (y >= 0 ? y : y - 399) / 400;
+    const long long yoe = y - era * 400;
+    const long long doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const long long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+  }
+
+  void CivilFromDays(long long z, long long &y, int &m, int &d)
+  {
+    z += 719468;
+    const long long era = (z >= 0 ? z : z - 146096) / 146097;
+    const long long doe = z - era * 146097;
+    const long long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const long long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const long long mp = (5 * doy + 2) / 153;
+    d = int(doy - (153 * mp + 2) / 5 + 1);
+    m = int(mp < 10 ? mp + 3 : mp - 9);
+    y = yoe + era * 400 + (m <= 2);
+  }
+
+  time_t StdMakeTime(long long yyyy, int mon, int dd,
+                     int hh, int min, int sec, int *dow)
+  {
+    struct tm xtm;
+    std::memset(&xtm, 0, sizeof(xtm));
+    xtm.tm_year = int(yyyy - 1900);
+    xtm.tm_mon = mon - 1;
+    xtm.tm_mday = dd;
+    xtm.tm_hour = hh;
+    xtm.tm_min = min;
+    xtm.tm_sec = sec;
+    xtm.tm_isdst = -1;
+    const time_t retval = std::mktime(&xtm);
+    if (dow != NULL)
+      *dow = xtm.tm_wday + 1;
+    return retval;
+  }
+
+  inline bool IsTime(const struct tm &st, long long y, int m, int d,
+                     int hh, int min, int sec)
+  {
+    return st.tm_year + 1900LL == y && st.tm_mon + 1 == m && st.tm_mday == d &&
+           st.tm_hour == hh && st.tm_min == min && st.tm_sec == sec;
+  }
+
+  // The first second of the day and whether the rest follow on from it,
+  // i.e., whether it ends at 23:59:59 local time exactly a day later
+  DayInfo GetDayInfo(long long day)
+  {
+    long long y;
+    int m, d;
+    CivilFromDays(day, y, m, d);
+
+    DayInfo info;
+    info.midnight = StdMakeTime(y, m, d, 0, 0, 0, NULL);
+    info.bRegular = false;
+    if (info.midnight != time_t(-1)) {
+      struct tm st;
+      const time_t last = info.midnight + (SECS_PER_DAY - 1);
+      info.bRegular = localtime_s(&st, &info.midnight) == 0 &&
+                      IsTime(st, y, m, d, 0, 0, 0) &&
+                      localtime_s(&st, &last) == 0 &&
+                      IsTime(st, y, m, d, 23, 59, 59);
+    }
+    return info;
+  }
+
+  bool GetMidnight(long long day, time_t &midnight)
+  {
+    DayCache &cache = GetDayCache();
+    const time_t now = time(NULL);
+    {
+      std::lock_guard<std::mutex> lock(cache.mutex);
+      if (now >= cache.expires || now < cache.expires - CACHE_LIFETIME) {
+        cache.days.clear();
+        cache.expires = now + CACHE_LIFETIME;
+      } else {
+        const std::unordered_map<long long, DayInfo>::const_iterator it =
+          cache.days.find(day);
+        if (it != cache.days.end()) {
+          midnight = it->second.midnight;
+          return it->second.bRegular;
+        }
+      }
+    }
+
+    // Without holding up other threads
+    const DayInfo info = GetDayInfo(day);
+
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if (cache.days.size() >= MAX_CACHE_SIZE)
+      cache.days.clear();
+    cache.days[day] = info;
+    midnight = info.midnight;
+    return info.bRegular;
+  }
+};
+
+time_t PWSLocalTime::MakeTime(int yyyy, int mon, int dd,
+                              int hh, int min, int sec, int *dow)
+{
+  const long long secs = (hh * 60LL + min) * 60LL + sec;
+  if (mon >= 1 && mon <= 12 && secs >= 0 && secs < SECS_PER_DAY) {
+    const long long day = DaysFromCivil(yyyy, mon, 1) + (dd - 1);
+    time_t midnight;
+    if (GetMidnight(day, midnight)) {
+      if (dow != NULL)
+        *dow = int(((day + 4) % 7 + 7) % 7) + 1; // 1970-01-01 was a Thursday
+      return midnight + time_t(secs);
+    }
+  }
+  return StdMakeTime(yyyy, mon, dd, hh, min, sec, dow);
+}
+
+time_t PWSLocalTime::StartOfDay(time_t t, int days)
+{
+  struct tm st;
+  if (localtime_s(&st, &t) != 0)
+    return t;
+  return MakeTime(st.tm_year + 1900, st.tm_mon + 1, st.tm_mday + days);
+}
+
+size_t PWSLocalTime::GetCacheSize()
+{
+  DayCache &cache = GetDayCache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  return cache.days.size();
+}
+
+void PWSLocalTime::ClearCache()
+{
+  DayCache &cache = GetDayCache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  cache.days.clear();
+}
+//-----------------------------------------------------------------------------
+// Local variables:
+// mode: c++
+// End:
@@ -0,0 +1,48 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+// LocalTime.h
+//-----------------------------------------------------------------------------
+
+#ifndef __LOCALTIME_H
+#define __LOCALTIME_H
+
+#include <ctime>
+
+/*
+* Conversions from local date and time to time_t, as std::mktime() does
+* with tm_isdst = -1, for parsing imported times and evaluating filter
+* dates.
+*
+* std::mktime() looks up the timezone again on every call, then searches
+* for the time. Here, each day's local midnight is found once and cached,
+* so the time of day is just added to it. Days on which the UTC offset
+* changes are left to std::mktime(), as the gap or overlap has to be
+* resolved the way it does. The cache is dropped every minute, so that a
+* change of timezone is seen about as soon as before.
+*/
+
+namespace PWSLocalTime {
+  // yyyy/mon/dd hh:min:sec local time. Days past the end of the month
+  // carry into the next, as with std::mktime(). dow, if given, is set to
+  // the day of the week, 1 (Sunday) to 7
+  time_t MakeTime(int yyyy, int mon, int dd,
+                  int hh = 0, int min = 0, int sec = 0, int *dow = NULL);
+
+  // Local midnight starting the day 'days' after t's. Returns t if it's
+  // not a valid time
+  time_t StartOfDay(time_t t, int days = 0);
+
+  size_t GetCacheSize();
+  void ClearCache();
+};
+
+#endif /* __LOCALTIME_H */
+//-----------------------------------------------------------------------------
+// Local variables:
+// mode: c++
+// End:
@@ -11,161 +11,143 @@
 
 #include "Match.h"
 #include "ItemData.h"
+#include "PatternMatch.h"
 #include "core.h"
 
 #include "os/pws_tchar.h"
 
 #include <time.h>
+#include <cstring>
+#include <algorithm>
+#include <vector>
 
-bool PWSMatch::Match(const StringX &stValue, StringX sx_Object,
-                     const int &iFunction)
+using namespace PWSMatch;
+
+static bool Equals(const TCHAR *s1, const TCHAR *s2, size_t len, bool bCaseSensitive)
+{
+  return bCaseSensitive ? memcmp(s1, s2, len * sizeof(TCHAR)) == 0 :
+                          EqualsNoCase(s1, s2, len);
+}
+
+static bool Contains(const TCHAR *pText, size_t text_len,
+                     const TCHAR *pSearch, size_t search_len, bool bCaseSensitive)
 {
-  // Note: sx_Object may be changed within this routine.
+  if (!bCaseSensitive)
+    return FindNoCase(pText, text_len, pSearch, search_len) != StringX::npos;
+
+  if (search_len == 0)
+    return true;
+  for (size_t i = 0; i + search_len <= text_len; i++) {
+    if (pText[i] == pSearch[0] &&
+        memcmp(pText + i + 1, pSearch + 1, (search_len - 1) * sizeof(TCHAR)) == 0)
+      return true;
+  }
+  return false;
+}
 
-  const StringX::size_type val_len = stValue.length();
-  const StringX::size_type obj_len = sx_Object.length();
+static bool ContainsChar(const TCHAR *pText, size_t text_len, TCHAR c,
+                         bool bCaseSensitive)
+{
+  return Contains(pText, text_len, &c, 1, bCaseSensitive);
+}
 
-  StringX sx_Object_lc(sx_Object);
-  ToLower(sx_Object_lc);
+static CPattern::Syntax GetSyntax(MatchRule rule)
+{
+  return (rule == MR_REGEX || rule == MR_NOTREGEX) ? CPattern::REGEX : CPattern::GLOB;
+}
 
-  StringX stValue_lc(stValue);
-  ToLower(stValue_lc);
+// As this is called for each object, the pattern comes from the cache
+static bool MatchPattern(const TCHAR *pValue, size_t val_len,
+                         const TCHAR *pObject, size_t obj_len, int iFunction)
+{
+  const bool bCase = iFunction < 0;
+  const MatchRule rule = MatchRule(bCase ? -iFunction : iFunction);
+  const std::shared_ptr<const CPattern> pattern =
+    CPattern::Get(StringX(pValue, val_len), GetSyntax(rule), bCase);
+  if (!pattern->IsValid())
+    return false;
+  return pattern->Matches(pObject, obj_len) !=
+         (rule == MR_NOTREGEX || rule == MR_NOTGLOB);
+}
 
+bool PWSMatch::Match(const StringX &stValue, const StringX &sx_Object,
+                     const int &iFunction)
+{
+  return Match(stValue.data(), stValue.length(),
+               sx_Object.data(), sx_Object.length(), iFunction);
+}
+
+bool PWSMatch::Match(const TCHAR *pValue, size_t val_len,
+                     const TCHAR *pObject, size_t obj_len, int iFunction)
+{
   // Negative = Case   Sensitive
   // Positive = Case INsensitive
+  const bool bCase = iFunction < 0;
+
   switch (iFunction) {
     case -MR_EQUALS:
     case  MR_EQUALS:
-      return ((obj_len == val_len) &&
-             (((iFunction < 0) && (sx_Object == stValue)) ||
-              ((iFunction > 0) && CompareNoCase(sx_Object, stValue) == 0)));
+      return obj_len == val_len && Equals(pObject, pValue, val_len, bCase);
     case -MR_NOTEQUAL:
     case  MR_NOTEQUAL:
-      return (((iFunction < 0) && (sx_Object != stValue)) ||
-              ((iFunction > 0) && CompareNoCase(sx_Object, stValue) != 0));
+      return obj_len != val_len || !Equals(pObject, pValue, val_len, bCase);
     case -MR_BEGINS:
     case  MR_BEGINS:
-      if (obj_len >= val_len) {
-        StringX sx_Subset = sx_Object.substr(0, val_len);
-        return (((iFunction < 0) && (stValue == sx_Subset)) ||
-                ((iFunction > 0) && CompareNoCase(stValue, sx_Subset) == 0));
-      } else {
-        return false;
-      }
+      return obj_len >= val_len && Equals(pObject, pValue, val_len, bCase);
     case -MR_NOTBEGIN:
     case  MR_NOTBEGIN:
-      if (obj_len >= val_len) {
-        StringX sx_Subset = sx_Object.substr(0, val_len);
-        return (((iFunction < 0) && (stValue != sx_Subset)) ||
-                ((iFunction > 0) && CompareNoCase(stValue, sx_Subset) != 0));
-      } else {
-        return true;
-      }
+      return obj_len < val_len || !Equals(pObject, pValue, val_len, bCase);
     case -MR_ENDS:
     case  MR_ENDS:
-      if (obj_len > val_len) {
-        StringX sx_Subset = sx_Object.substr(obj_len - val_len);
-        return (((iFunction < 0) && (stValue == sx_Subset)) ||
-                ((iFunction > 0) && CompareNoCase(stValue, sx_Subset) == 0));
-      } else {
-        return false;
-      }
+      return obj_len > val_len &&
+             Equals(pObject + obj_len - val_len, pValue, val_len, bCase);
     case -MR_NOTEND:
     case  MR_NOTEND:
-      if (obj_len > val_len) {
-        StringX sx_Subset = sx_Object.substr(obj_len - val_len);
-        return (((iFunction < 0) && (stValue != sx_Subset)) ||
-                ((iFunction > 0) && CompareNoCase(stValue, sx_Subset) != 0));
-      } else
-        return true;
+      return obj_len <= val_len ||
+             !Equals(pObject + obj_len - val_len, pValue, val_len, bCase);
     case -MR_CONTAINS:
-      return (sx_Object.find(stValue) != StringX::npos);
     case  MR_CONTAINS:
-      return (sx_Object_lc.find(stValue_lc) != StringX::npos);
+      return Contains(pObject, obj_len, pValue, val_len, bCase);
     case -MR_NOTCONTAIN:
-      return (sx_Object.find(stValue) == StringX::npos);
     case  MR_NOTCONTAIN:
-      return (sx_Object_lc.find(stValue_lc) == StringX::npos);
+      return !Contains(pObject, obj_len, pValue, val_len, bCase);
     case -MR_CNTNANY:
-    {
-      const charT *c = stValue.c_str();
-      for (size_t i = 0; i < stValue.length(); i++) {
-        if (sx_Object.find(c, 0, 1) != StringX::npos)
-          return true;
-        c++;
-      }
-      return false;
-    }
     case  MR_CNTNANY:
-    {
-      const charT *c = stValue_lc.c_str();
-      for (size_t i = 0; i < stValue_lc.length(); i++) {
-        if (sx_Object_lc.find(c, 0, 1) != StringX::npos)
+      for (size_t i = 0; i < val_len; i++) {
+        if (ContainsChar(pObject, obj_len, pValue[i], bCase))
           return true;
-        c++;
       }
       return false;
-    }
     case -MR_NOTCNTNANY:
-    {
-      const charT *c = stValue.c_str();
-      for (size_t i = 0; i < stValue.length(); i++) {
-        if (sx_Object.find(c, 0, 1) != StringX::npos)
-          return false;
-        c++;
-      }
-      return true;
-    }
     case  MR_NOTCNTNANY:
-    {
-      const charT *c = stValue_lc.c_str();
-      for (size_t i = 0; i < stValue_lc.length(); i++) {
-        if (sx_Object_lc.find(c, 0, 1) != StringX::npos)
+      for (size_t i = 0; i < val_len; i++) {
+        if (ContainsChar(pObject, obj_len, pValue[i], bCase))
           return false;
-        c++;
       }
       return true;
-    }
     case -MR_CNTNALL:
-    {
-      const charT *c = stValue.c_str();
-      for (size_t i = 0; i < stValue.length(); i++) {
-        if (sx_Object.find(c, 0, 1) == StringX::npos)
-          return false;
-        c++;
-      }
-      return true;
-    }
     case  MR_CNTNALL:
-    {
-      const charT *c = stValue_lc.c_str();
-      for (size_t i = 0; i < stValue_lc.length(); i++) {
-        if (sx_Object_lc.find(c, 0, 1) == StringX::npos)
+      for (size_t i = 0; i < val_len; i++) {
+        if (!ContainsChar(pObject, obj_len, pValue[i], bCase))
           return false;
-        c++;
       }
       return true;
-    }
     case -MR_NOTCNTNALL:
-    {
-      const charT *c = stValue.c_str();
-      for (size_t i = 0; i < stValue.length(); i++) {
-        if (sx_Object.find(c, 0, 1) != StringX::npos)
-          return false;
-        c++;
-      }
-      return true;
-    }
     case  MR_NOTCNTNALL:
-    {
-      const charT *c = stValue_lc.c_str();
-      for (size_t i = 0; i < stValue_lc.length(); i++) {
-        if (sx_Object_lc.find(c, 0, 1) != StringX::npos)
+      for (size_t i = 0; i < val_len; i++) {
+        if (ContainsChar(pObject, obj_len, pValue[i], bCase))
           return false;
-        c++;
       }
       return true;
-    }
+    case -MR_REGEX:
+    case  MR_REGEX:
+    case -MR_NOTREGEX:
+    case  MR_NOTREGEX:
+    case -MR_GLOB:
+    case  MR_GLOB:
+    case -MR_NOTGLOB:
+    case  MR_NOTGLOB:
+      return MatchPattern(pValue, val_len, pObject, obj_len, iFunction);
     default:
       ASSERT(0);
   }
@@ -173,17 +155,220 @@ bool PWSMatch::Match(const StringX &stValue, StringX sx_Object,
   return true; // should never get here!
 }
 
+CCompiledMatch::CCompiledMatch()
+  : m_given(MR_INVALID), m_rule(MR_INVALID), m_bNegate(false), m_bCase(false),
+    m_finder(StringX(), false)
+{
+  m_ascii[0] = m_ascii[1] = 0;
+}
+
+CCompiledMatch::CCompiledMatch(const StringX &sxValue, int iFunction)
+  : m_given(MatchRule(iFunction < 0 ? -iFunction : iFunction)),
+    m_bCase(iFunction < 0), m_finder(sxValue, iFunction < 0)
+{
+  Compile(sxValue);
+}
+
+CCompiledMatch::CCompiledMatch(const StringX &sxValue, MatchRule rule,
+                               bool bCaseSensitive)
+  : m_given(rule), m_bCase(bCaseSensitive), m_finder(sxValue, bCaseSensitive)
+{
+  Compile(sxValue);
+}
+
+void CCompiledMatch::Compile(const StringX &sxValue)
+{
+  m_sxValue = sxValue;
+  if (!m_bCase) {
+    for (size_t i = 0; i < m_sxValue.length(); i++)
+      m_sxValue[i] = FoldCase(m_sxValue[i]);
+  }
+
+  m_bNegate = false;
+  switch (m_given) {
+    case MR_NOTEQUAL:
+      m_bNegate = true;
+      // drop through
+    case MR_EQUALS:
+      m_rule = MR_EQUALS;
+      break;
+    case MR_NOTBEGIN:
+      m_bNegate = true;
+      // drop through
+    case MR_BEGINS:
+      m_rule = MR_BEGINS;
+      break;
+    case MR_NOTEND:
+      m_bNegate = true;
+      // drop through
+    case MR_ENDS:
+      m_rule = MR_ENDS;
+      break;
+    case MR_NOTCONTAIN:
+      m_bNegate = true;
+      // drop through
+    case MR_CONTAINS:
+      m_rule = MR_CONTAINS;
+      break;
+    case MR_NOTCNTNANY:
+    case MR_NOTCNTNALL: // same as MR_NOTCNTNANY, as Match()
+      m_bNegate = true;
+      // drop through
+    case MR_CNTNANY:
+    case MR_CNTNALL:
+      m_rule = (m_given == MR_CNTNALL) ? MR_CNTNALL : MR_CNTNANY;
+      break;
+    case MR_NOTPRESENT:
+      m_bNegate = true;
+      // drop through
+    case MR_PRESENT:
+      m_rule = MR_PRESENT;
+      break;
+    case MR_NOTREGEX:
+    case MR_NOTGLOB:
+      m_bNegate = true;
+      // drop through
+    case MR_REGEX:
+    case MR_GLOB:
+      m_rule = (m_given == MR_REGEX || m_given == MR_NOTREGEX) ? MR_REGEX : MR_GLOB;
+      m_pattern = CPattern::Get(sxValue, GetSyntax(m_rule), m_bCase);
+      break;
+    default:
+      ASSERT(0);
+      m_rule = MR_INVALID;
+  }
+
+  m_ascii[0] = m_ascii[1] = 0;
+  m_sxOthers.clear();
+  if (m_rule == MR_CNTNANY || m_rule == MR_CNTNALL) {
+    for (size_t i = 0; i < m_sxValue.length(); i++) {
+      const TCHAR c = m_sxValue[i];
+      if (c >= 0 && c < 0x80)
+        m_ascii[c >> 6] |= uint64(1) << (c & 63);
+      else
+        m_sxOthers += c;
+    }
+    std::sort(m_sxOthers.begin(), m_sxOthers.end());
+    m_sxOthers.erase(std::unique(m_sxOthers.begin(), m_sxOthers.end()),
+                     m_sxOthers.end());
+  }
+}
+
+bool CCompiledMatch::Equals(const TCHAR *pObject) const
+{
+  const TCHAR *pValue = m_sxValue.data();
+  const size_t len = m_sxValue.length();
+  if (m_bCase)
+    return memcmp(pObject, pValue, len * sizeof(TCHAR)) == 0;
+  for (size_t i = 0; i < len; i++) {
+    if (FoldCase(pObject[i]) != pValue[i])
+      return false;
+  }
+  return true;
+}
+
+bool CCompiledMatch::IsValid() const
+{
+  return !m_pattern || m_pattern->IsValid();
+}
+
+inline bool CCompiledMatch::IsInSet(TCHAR c) const
+{
+  if (c >= 0 && c < 0x80)
+    return (m_ascii[c >> 6] & (uint64(1) << (c & 63))) != 0;
+  return !m_sxOthers.empty() &&
+         std::binary_search(m_sxOthers.begin(), m_sxOthers.end(), c);
+}
+
+bool CCompiledMatch::ContainsAny(const TCHAR *pObject, size_t obj_len) const
+{
+  for (size_t i = 0; i < obj_len; i++) {
+    if (IsInSet(m_bCase ? pObject[i] : FoldCase(pObject[i])))
+      return true;
+  }
+  return false;
+}
+
+bool CCompiledMatch::ContainsAll(const TCHAR *pObject, size_t obj_len) const
+{
+  // Tick off the value's characters as they're found
+  uint64 missing[2] = {m_ascii[0], m_ascii[1]};
+  std::vector<bool> others_found(m_sxOthers.size(), false);
+  size_t nothers = m_sxOthers.size();
+
+  for (size_t i = 0; i < obj_len; i++) {
+    const TCHAR c = m_bCase ? pObject[i] : FoldCase(pObject[i]);
+    if (c >= 0 && c < 0x80)
+      missing[c >> 6] &= ~(uint64(1) << (c & 63));
+    else if (nothers != 0) {
+      const StringX::const_iterator pos =
+        std::lower_bound(m_sxOthers.begin(), m_sxOthers.end(), c);
+      if (pos != m_sxOthers.end() && *pos == c &&
+          !others_found[pos - m_sxOthers.begin()]) {
+        others_found[pos - m_sxOthers.begin()] = true;
+        nothers--;
+      }
+    }
+    if ((missing[0] | missing[1]) == 0 && nothers == 0)
+      return true;
+  }
+  return (missing[0] | missing[1]) == 0 && nothers == 0;
+}
+
+bool CCompiledMatch::Matches(const TCHAR *pObject, size_t obj_len) const
+{
+  const size_t val_len = m_sxValue.length();
+  bool bResult(false);
+
+  switch (m_rule) {
+    case MR_EQUALS:
+      bResult = obj_len == val_len && Equals(pObject);
+      break;
+    case MR_BEGINS:
+      bResult = obj_len >= val_len && Equals(pObject);
+      break;
+    case MR_ENDS:
+      // Note: as Match(), the whole string doesn't "end with" itself
+      bResult = obj_len > val_len && Equals(pObject + obj_len - val_len);
+      break;
+    case MR_CONTAINS:
+      bResult = obj_len >= val_len &&
+                m_finder.Find(pObject, obj_len) != StringX::npos;
+      break;
+    case MR_CNTNANY:
+      bResult = ContainsAny(pObject, obj_len);
+      break;
+    case MR_CNTNALL:
+      bResult = ContainsAll(pObject, obj_len);
+      break;
+    case MR_PRESENT:
+      bResult = obj_len != 0;
+      break;
+    case MR_REGEX:
+    case MR_GLOB:
+      if (!m_pattern->IsValid())
+        return false;
+      bResult = m_pattern->Matches(pObject, obj_len);
+      break;
+    default:
+      return true; // default constructed (or invalid rule, as Match())
+  }
+  return bResult != m_bNegate;
+}
+
 bool PWSMatch::Match(const bool bValue, int iFunction)
 {
   if (bValue) {
     return (iFunction == MR_EQUALS     ||
             iFunction == MR_ACTIVE     ||
             iFunction == MR_PRESENT    ||
+            iFunction == MR_SET        ||
             iFunction == MR_IS);
   } else {
     return (iFunction == MR_NOTEQUAL   ||
             iFunction == MR_INACTIVE   ||
             iFunction == MR_NOTPRESENT ||
+            iFunction == MR_NOTSET     ||
             iFunction == MR_ISNOT);
   }
 }
@@ -222,6 +407,10 @@ const char *PWSMatch::GetRuleString(const MatchRule rule)
     case MR_AFTER:      pszrule = "AF"; break;
     case MR_EXPIRED:    pszrule = "EX"; break;  // Special Password rule
     case MR_WILLEXPIRE: pszrule = "WX"; break;  // Special Password rule
+    case MR_REGEX:      pszrule = "RX"; break;
+    case MR_NOTREGEX:   pszrule = "NX"; break;
+    case MR_GLOB:       pszrule = "GL"; break;
+    case MR_NOTGLOB:    pszrule = "NG"; break;
     default:
       ASSERT(0);
   }
@@ -265,6 +454,10 @@ UINT PWSMatch::GetRule(MatchRule rule)
     case MR_AFTER:      id = IDSC_AFTER; break;
     case MR_EXPIRED:    id = IDSC_EXPIRED; break;     // Special Password rule
     case MR_WILLEXPIRE: id = IDSC_WILLEXPIRE; break;  // Special Password rule
+    case MR_REGEX:      id = IDSC_MATCHESREGEX; break;
+    case MR_NOTREGEX:   id = IDSC_DOESNOTMATCHREGEX; break;
+    case MR_GLOB:       id = IDSC_MATCHESGLOB; break;
+    case MR_NOTGLOB:    id = IDSC_DOESNOTMATCHGLOB; break;
     default:
       ASSERT(0);
   }
@@ -306,6 +499,10 @@ PWSMatch::MatchRule PWSMatch::GetRule(const StringX &sx_mnemonic)
     {_T("AF"), MR_AFTER},
     {_T("EX"), MR_EXPIRED},
     {_T("WX"), MR_WILLEXPIRE},
+    {_T("RX"), MR_REGEX},
+    {_T("NX"), MR_NOTREGEX},
+    {_T("GL"), MR_GLOB},
+    {_T("NG"), MR_NOTGLOB},
     {NULL, MR_INVALID}
   };
 
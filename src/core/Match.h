@@ -14,11 +14,16 @@
 
 #include "StringX.h"
 #include "ItemData.h"
+#include "FindText.h"
 //#include "PWSFilters.h"  // For DateType
 
+#include <memory>
+
 namespace PWSMatch {
   // namespace of common utility functions
 
+  class CPattern;
+
   // For  any comparing functions
   // SubGroup Function - if value used is negative, string compare IS case sensitive
   enum MatchRule {
@@ -44,6 +49,10 @@ namespace PWSMatch {
     MR_BEFORE, MR_AFTER,
     // Special rules for Passwords
     MR_EXPIRED, MR_WILLEXPIRE,
+    // For string comparisons/filters: regular expression & glob patterns,
+    // see CPattern
+    MR_REGEX, MR_NOTREGEX,
+    MR_GLOB, MR_NOTGLOB,
     MR_LAST // MUST be last entry
   };
 
@@ -52,8 +61,12 @@ namespace PWSMatch {
                   MT_BOOL, MT_PWHIST, MT_POLICY, MT_ENTRYTYPE,
                   MT_DCA, MT_SHIFTDCA, MT_ENTRYSTATUS, MT_ENTRYSIZE};
 
-  // Generalised checking
-  bool Match(const StringX &stValue, StringX sx_Object, const int &iFunction);
+  // Generalised checking. For a one-off test: pattern rules look their
+  // pattern up in a cache shared by all threads, under a lock, each time,
+  // so to test many objects against the same value use a CCompiledMatch.
+  bool Match(const StringX &stValue, const StringX &sx_Object, const int &iFunction);
+  bool Match(const TCHAR *pValue, size_t val_len,
+             const TCHAR *pObject, size_t obj_len, int iFunction);
 
   template<typename T> bool Match(T v1, T v2, T value, int iFunction)
   {
@@ -74,6 +87,60 @@ namespace PWSMatch {
 
   bool Match(bool bValue, int iFunction);  // bool - if field present or not
 
+  /*
+  * CCompiledMatch is Match(stValue, sx_Object, iFunction) for a value and
+  * rule known up front, applied to many objects, e.g., a subgroup
+  * restriction or a filter row tested against every entry.
+  *
+  * The value is folded once (unless the match is case sensitive), the
+  * lengths it implies are checked before any characters, "contains" uses
+  * a CFinder, and the "contains any/all" rules a set of the value's
+  * characters, so that each object is scanned just once. Pattern rules
+  * hold on to their compiled CPattern, rather than looking it up in the
+  * cache for each object. Results are the same as Match()'s, as are the
+  * rules allowed: the string ones, plus MR_PRESENT & MR_NOTPRESENT.
+  * A default constructed CCompiledMatch matches everything, e.g., for
+  * "no subgroup restriction".
+  */
+  class CCompiledMatch
+  {
+  public:
+    CCompiledMatch();
+    // iFunction as for Match(): negative if case sensitive
+    CCompiledMatch(const StringX &sxValue, int iFunction);
+    CCompiledMatch(const StringX &sxValue, MatchRule rule, bool bCaseSensitive);
+
+    // The rule as given (e.g., MR_NOTBEGIN, not MR_BEGINS)
+    MatchRule GetRule() const {return m_given;}
+    bool IsCaseSensitive() const {return m_bCase;}
+    // False if a pattern that doesn't compile, which matches nothing,
+    // whether the rule is negated or not
+    bool IsValid() const;
+
+    bool Matches(const TCHAR *pObject, size_t obj_len) const;
+    bool Matches(const StringX &sxObject) const
+    {return Matches(sxObject.data(), sxObject.length());}
+
+  private:
+    void Compile(const StringX &sxValue);
+    bool Equals(const TCHAR *pObject) const;
+    bool ContainsAny(const TCHAR *pObject, size_t obj_len) const;
+    bool ContainsAll(const TCHAR *pObject, size_t obj_len) const;
+    bool IsInSet(TCHAR c) const;
+
+    MatchRule m_given;
+    MatchRule m_rule; // the positive form of m_given
+    bool m_bNegate;   // m_given is m_rule's negation
+    bool m_bCase;
+    StringX m_sxValue; // folded unless m_bCase
+    CFinder m_finder;  // MR_CONTAINS
+    // MR_CNTNANY & MR_CNTNALL: the (folded) value's distinct characters,
+    // ASCII ones as bits, others sorted
+    uint64 m_ascii[2];
+    StringX m_sxOthers;
+    std::shared_ptr<const CPattern> m_pattern; // MR_REGEX & MR_GLOB
+  };
+
   UINT GetRule(MatchRule rule);
   MatchRule GetRule(const StringX &sx_mnemonic);
   const char *GetRuleString(const MatchRule rule);
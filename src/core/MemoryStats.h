@@ -0,0 +1,88 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+// MemoryStats.h
+//-----------------------------------------------------------------------------
+
+#ifndef __MEMORYSTATS_H
+#define __MEMORYSTATS_H
+
+#include <map>
+#include <cstddef>
+
+#include "StringX.h"
+
+/*
+ * Approximate heap usage of an open database, as reported by
+ * PWScore::GetMemoryStats(). Figures are estimates based on object sizes
+ * and typical allocator/container overheads, not allocator statistics:
+ * they are meant for sizing and for spotting regressions.
+ */
+
+// Typical per-node cost of a std::map/std::set node on top of its value:
+// three links and colour, rounded to pointer size
+const size_t MAP_NODE_OVERHEAD = 4 * sizeof(void *);
+
+struct st_MemoryUsage {
+  size_t bytes;
+  size_t allocations;
+
+  st_MemoryUsage() : bytes(0), allocations(0) {}
+
+  void Add(size_t nbytes, size_t nallocations = 1)
+  {bytes += nbytes; allocations += nallocations;}
+
+  // Heap part of a string, if any
+  void Add(const StringX &sx)
+  {if (!sx.empty()) Add((sx.capacity() + 1) * sizeof(TCHAR));}
+
+  st_MemoryUsage &operator+=(const st_MemoryUsage &that)
+  {bytes += that.bytes; allocations += that.allocations; return *this;}
+};
+
+struct st_MemoryStats {
+  // Key = CItemData::FieldType; field data shared between copies of an
+  // entry (see CItemField) is counted once per holder
+  std::map<int, st_MemoryUsage> fields;
+  st_MemoryUsage entries;       // entry list nodes & CItemData objects
+  st_MemoryUsage unknownfields; // unknown entry & header fields
+  st_MemoryUsage entrycaches;   // per-entry decoded field caches
+  st_MemoryUsage displayinfo;   // UI objects attached to entries
+  st_MemoryUsage indices;       // lookup indices and dependents maps
+  st_MemoryUsage undo;          // undo/redo commands
+  st_MemoryUsage filters;       // database filters
+  st_MemoryUsage other;         // expiry list, policies, empty groups...
+  st_MemoryUsage ui;            // tree/grid mirrors, as reported by the UI
+  size_t kdf_peak;              // key derivation working memory (Argon2)
+
+  st_MemoryStats() : kdf_peak(0) {}
+
+  st_MemoryUsage Fields() const
+  {
+    st_MemoryUsage total;
+    std::map<int, st_MemoryUsage>::const_iterator iter;
+    for (iter = fields.begin(); iter != fields.end(); iter++)
+      total += iter->second;
+    return total;
+  }
+
+  // Total excluding kdf_peak, which is only held while opening or saving
+  st_MemoryUsage Total() const
+  {
+    st_MemoryUsage total = Fields();
+    total += entries; total += unknownfields; total += entrycaches;
+    total += displayinfo; total += indices; total += undo;
+    total += filters; total += other; total += ui;
+    return total;
+  }
+};
+
+#endif /* __MEMORYSTATS_H */
+//-----------------------------------------------------------------------------
+// Local variables:
+// mode: c++
+// End:
@@ -10,18 +10,77 @@
 #include "PWHistory.h"
 #include <sstream>
 #include <iomanip>
+#include <limits>
 #include "StringXStream.h"
 
 using namespace std;
 
-bool CreatePWHistoryList(const StringX &pwh_str,
-                         size_t &pwh_max, size_t &num_err,
-                         PWHistList &pwhl, PWSUtil::TMC time_format)
+// As iStringXStream(StringX(str, offset, width)) >> hex >> value, without
+// the cost of constructing a stream: leading white space, a sign and a
+// "0x" are allowed, and there must be at least one digit.
+template<typename T>
+static bool ReadHex(const StringX &str, size_t offset, size_t width, T &value)
+{
+  const TCHAR *p = str.data() + offset;
+  const TCHAR *end = str.data() + min(offset + width, str.length());
+
+  value = 0;
+  while (p < end && (*p == _T(' ') || (*p >= _T('\t') && *p <= _T('\r'))))
+    p++;
+  bool bNegative = false;
+  if (p < end && (*p == _T('-') || *p == _T('+')))
+    bNegative = *p++ == _T('-');
+
+  bool bDigits = false;
+  if (p < end && *p == _T('0')) {
+    p++;
+    bDigits = true;
+    if (p < end && (*p == _T('x') || *p == _T('X'))) {
+      p++;
+      bDigits = false;
+    }
+  }
+
+  uint64 result = 0; // widths are at most 8 digits, so can't overflow
+  for (; p < end; p++) {
+    int digit;
+    if (*p >= _T('0') && *p <= _T('9'))
+      digit = *p - _T('0');
+    else if (*p >= _T('a') && *p <= _T('f'))
+      digit = *p - _T('a') + 10;
+    else if (*p >= _T('A') && *p <= _T('F'))
+      digit = *p - _T('A') + 10;
+    else
+      break;
+    result = result * 16 + digit;
+    bDigits = true;
+  }
+  if (!bDigits)
+    return false;
+
+  if (numeric_limits<T>::is_signed) {
+    const uint64 limit = bNegative ?
+      uint64(-(numeric_limits<T>::min() + 1)) + 1 : uint64(numeric_limits<T>::max());
+    if (result > limit) {
+      value = bNegative ? numeric_limits<T>::min() : numeric_limits<T>::max();
+      return false;
+    }
+  } else if (result > uint64(numeric_limits<T>::max())) {
+    value = numeric_limits<T>::max();
+    return false;
+  }
+  value = bNegative ? T(-result) : T(result);
+  return true;
+}
+
+bool ParsePWHistory(const StringX &pwh_str,
+                    size_t &pwh_max, size_t &num_err,
+                    PWHistPasswords &pwhp)
 {
   // Return boolean value stating if PWHistory status is active
   pwh_max = num_err = 0;
-  pwhl.clear();
-  StringX pwh_s = pwh_str;
+  pwhp.clear();
+  const StringX &pwh_s = pwh_str;
   const size_t len = pwh_s.length();
 
   if (len < 5) {
@@ -31,14 +90,10 @@ bool CreatePWHistoryList(const StringX &pwh_str,
   bool bStatus = pwh_s[0] != charT('0');
 
   int n;
-  iStringXStream ism(StringX(pwh_s, 1, 2)); // max history 1 byte hex
-  ism >> hex >> pwh_max;
-  if (!ism)
+  if (!ReadHex(pwh_s, 1, 2, pwh_max)) // max history 1 byte hex
     return false;
 
-  iStringXStream isn(StringX(pwh_s, 3, 2)); // cur # entries 1 byte hex
-  isn >> hex >> n;
-  if (!isn)
+  if (!ReadHex(pwh_s, 3, 2, n)) // cur # entries 1 byte hex
     return false;
 
   // Sanity check: Each entry has at least 12 bytes representing
@@ -53,13 +108,8 @@ bool CreatePWHistoryList(const StringX &pwh_str,
         err = true;
         break;
       }
-      iStringXStream ispwlen(StringX(pwh_s, offset, 4)); // pw length 2 byte hex
-      if (!ispwlen){
-        err = true;
-        break;
-      }
       int ipwlen = 0;
-      ispwlen >> hex >> ipwlen;
+      ReadHex(pwh_s, offset, 4, ipwlen); // pw length 2 byte hex
       if ( (ipwlen <= 0) || (offset + 4 + ipwlen > len) ) {
         err = true;
         break;
@@ -79,6 +129,9 @@ bool CreatePWHistoryList(const StringX &pwh_str,
     return bStatus;
   }
 
+  if (n > 0)
+    pwhp.reserve(n);
+
   size_t offset = 1 + 2 + 2; // where to extract the next token from pwh_s
 
   for (int i = 0; i < n; i++) {
@@ -88,13 +141,10 @@ bool CreatePWHistoryList(const StringX &pwh_str,
       break;
     }
 
-    PWHistEntry pwh_ent;
     long t = 0L;
-    iStringXStream ist(StringX(pwh_s, offset, 8)); // time in 4 byte hex
-    ist >> hex >> t;
     // Note: t == 0 - means time is unknown - quite possible for the
     // oldest saved ppassword
-    if (!ist) {
+    if (!ReadHex(pwh_s, offset, 8, t)) { // time in 4 byte hex
       // Invalid time of password change
       num_err++;
       continue;
@@ -104,34 +154,56 @@ bool CreatePWHistoryList(const StringX &pwh_str,
     if (offset >= pwh_s.length())
       break;
 
-    pwh_ent.changetttdate = static_cast<time_t>(t);
-    pwh_ent.changedate =
-      PWSUtil::ConvertToDateTimeString(static_cast<time_t>(t), time_format);
-    if (pwh_ent.changedate.empty()) {
-      //                       1234567890123456789
-      pwh_ent.changedate = _T("1970-01-01 00:00:00");
-    }
-
-    iStringXStream ispwlen(StringX(pwh_s, offset, 4)); // pw length 2 byte hex
     int ipwlen = 0;
-    ispwlen >> hex >> ipwlen;
+    const bool bLength = ReadHex(pwh_s, offset, 4, ipwlen); // pw length 2 byte hex
     if (offset + 4 + ipwlen > pwh_s.length())
       break;
 
-    if (!ispwlen || ipwlen == 0) {
+    if (!bLength || ipwlen == 0) {
       // Invalid password length of zero
       num_err++; 
       continue;
     }
 
     offset += 4;
-    const StringX pw(pwh_s, offset, ipwlen);
-    pwh_ent.password = pw.c_str();
+    PWHistPassword pwh_pw;
+    pwh_pw.changetime = static_cast<time_t>(t);
+    pwh_pw.password.assign(pwh_s, offset, ipwlen);
     offset += ipwlen;
-    pwhl.push_back(pwh_ent);
+    pwhp.push_back(pwh_pw);
   }
 
-  num_err += n - pwhl.size();
+  num_err += n - pwhp.size();
+  return bStatus;
+}
+
+StringX FormatPWHistoryTime(time_t t, PWSUtil::TMC time_format)
+{
+  StringX changedate = PWSUtil::ConvertToDateTimeString(t, time_format);
+  if (changedate.empty()) {
+    //                       1234567890123456789
+    changedate = _T("1970-01-01 00:00:00");
+  }
+  return changedate;
+}
+
+bool CreatePWHistoryList(const StringX &pwh_str,
+                         size_t &pwh_max, size_t &num_err,
+                         PWHistList &pwhl, PWSUtil::TMC time_format)
+{
+  PWHistPasswords pwhp;
+  const bool bStatus = ParsePWHistory(pwh_str, pwh_max, num_err, pwhp);
+
+  pwhl.clear();
+  pwhl.reserve(pwhp.size());
+  PWHistPasswords::const_iterator iter;
+  for (iter = pwhp.begin(); iter != pwhp.end(); iter++) {
+    PWHistEntry pwh_ent;
+    pwh_ent.changetttdate = iter->changetime;
+    pwh_ent.changedate = FormatPWHistoryTime(iter->changetime, time_format);
+    pwh_ent.password = iter->password;
+    pwhl.push_back(pwh_ent);
+  }
   return bStatus;
 }
 
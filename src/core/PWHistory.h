@@ -69,6 +69,17 @@ PWHistEntry(const PWHistEntry &that) :
 
 typedef std::vector<PWHistEntry> PWHistList;
 
+// An old password without its formatted time, for those (search, filters)
+// that only need the password: see ParsePWHistory()
+struct PWHistPassword {
+  time_t changetime;
+  StringX password;
+
+  PWHistPassword() : changetime(0), password() {}
+};
+
+typedef std::vector<PWHistPassword> PWHistPasswords;
+
 // Parses a password history string as defined
 // in format spec to a vector of PWHistEntry
 // returns true iff password storing flag in string is set.
@@ -79,6 +90,15 @@ bool CreatePWHistoryList(const StringX &pwh_str,
                         size_t &pwh_max, size_t &num_err,
                          PWHistList &pwhl, PWSUtil::TMC time_format);
 
+// As CreatePWHistoryList(), but leaves the times unformatted, which is
+// most of the cost of parsing
+bool ParsePWHistory(const StringX &pwh_str,
+                    size_t &pwh_max, size_t &num_err,
+                    PWHistPasswords &pwhp);
+
+// The formatted change time of an old password, as in PWHistEntry
+StringX FormatPWHistoryTime(time_t t, PWSUtil::TMC time_format);
+
 StringX MakePWHistoryHeader(BOOL status, size_t pwh_max, size_t pwh_num);
 
 #endif
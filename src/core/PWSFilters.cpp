@@ -23,6 +23,8 @@
 #include "XML/MSXML/MFilterXMLProcessor.h"
 #elif USE_XML_LIBRARY == XERCES
 #include "XML/Xerces/XFilterXMLProcessor.h"
+#elif USE_XML_LIBRARY == PUGIXML
+#include "XML/Pugi/PFilterXMLProcessor.h"
 #endif
 
 #define PWS_XML_FILTER_VERSION 1
@@ -622,6 +624,8 @@ int PWSFilters::ImportFilterXMLFile(const FilterPool fpool,
   MFilterXMLProcessor fXML(*this, fpool, pAsker);
 #elif USE_XML_LIBRARY == XERCES
   XFilterXMLProcessor fXML(*this, fpool, pAsker);
+#elif USE_XML_LIBRARY == PUGIXML
+  PFilterXMLProcessor fXML(*this, fpool, pAsker);
 #endif
   bool status, validation;
 
@@ -19,6 +19,8 @@
 #include "VerifyFormat.h"
 #include "PWSfileV3.h" // XXX cleanup with dynamic_cast
 #include "StringXStream.h"
+#include "ParallelScan.h"
+#include "FuzzyMatch.h"
 
 #include "os/pws_tchar.h"
 #include "os/typedefs.h"
@@ -70,9 +72,11 @@ PWScore::PWScore() :
                      m_ReadFileVersion(PWSfile::UNKNOWN_VERSION),
                      m_bDBChanged(false), m_bDBPrefsChanged(false),
                      m_IsReadOnly(false), m_bUniqueGTUValidated(false),
+                     m_bEntryIndicesValid(false), m_bSearchIndexValid(false),
+                     m_bTargetIndexValid(false), m_nModifications(0),
                      m_nRecordsWithUnknownFields(0),
-                     m_bNotifyDB(false), m_pUIIF(NULL), m_pFileSig(NULL),
-                     m_iAppHotKey(0)
+                     m_bNotifyDB(false), m_pUIIF(NULL), m_commands_size(0),
+                     m_pFileSig(NULL), m_iAppHotKey(0)
 {
   // following should ideally be wrapped in a mutex
   if (!PWScore::m_session_initialized) {
@@ -98,7 +102,7 @@ PWScore::~PWScore()
   }
 
   m_UHFL.clear();
-  m_vnodes_modified.clear();
+  ClearChangedNodes();
 
   delete m_pFileSig;
 }
@@ -202,6 +206,7 @@ void PWScore::DoAddEntry(const CItemData &item)
   // Also "UndoDeleteEntry" !
   ASSERT(m_pwlist.find(item.GetUUID()) == m_pwlist.end());
   m_pwlist[item.GetUUID()] = item;
+  AddToEntryIndices(item);
 
   if (item.NumberUnknownFields() > 0)
     IncrementNumRecordsWithUnknownFields();
@@ -298,6 +303,7 @@ void PWScore::DoDeleteEntry(const CItemData &item)
       VERIFY(DelKBShortcut(iKBShortcut, item.GetUUID()));
 
     m_bDBChanged = true;
+    RemoveFromEntryIndices(pos->second);
     m_pwlist.erase(pos); // at last!
 
     if (item.NumberUnknownFields() > 0)
@@ -315,7 +321,11 @@ void PWScore::DoReplaceEntry(const CItemData &old_ci, const CItemData &new_ci)
 {
   // Assumes that old_uuid == new_uuid
   ASSERT(old_ci.GetUUID() == new_ci.GetUUID());
+  ItemListIter pos = m_pwlist.find(old_ci.GetUUID());
+  if (pos != m_pwlist.end())
+    RemoveFromEntryIndices(pos->second);
   m_pwlist[old_ci.GetUUID()] = new_ci;
+  AddToEntryIndices(new_ci);
   if (old_ci.GetEntryType() != new_ci.GetEntryType() || old_ci.IsProtected() != new_ci.IsProtected())
     GUIRefreshEntry(new_ci);
 
@@ -365,6 +375,7 @@ void PWScore::ClearData(void)
 
   //Composed of ciphertext, so doesn't need to be overwritten
   m_pwlist.clear();
+  InvalidateEntryIndices();
 
   // Clear out out dependents mappings
   m_base2aliases_mmap.clear();
@@ -612,7 +623,50 @@ void PWScore::ClearCommands()
     delete m_vpcommands.back();
     m_vpcommands.pop_back();
   }
+  m_vcommand_sizes.clear();
   m_undo_iter = m_redo_iter = m_vpcommands.end();
+  m_commands_size = 0;
+}
+
+void PWScore::DeleteCommands(std::vector<Command *>::iterator first,
+                             std::vector<Command *>::iterator last)
+{
+  const size_t ifirst = first - m_vpcommands.begin();
+  const size_t ilast = last - m_vpcommands.begin();
+  for (size_t i = ifirst; i < ilast; i++) {
+    ASSERT(m_vcommand_sizes[i] <= m_commands_size);
+    m_commands_size -= m_vcommand_sizes[i];
+    delete m_vpcommands[i];
+  }
+  m_vpcommands.erase(first, last);
+  m_vcommand_sizes.erase(m_vcommand_sizes.begin() + ifirst,
+                         m_vcommand_sizes.begin() + ilast);
+}
+
+void PWScore::TrimCommands()
+{
+  // Called after Execute, when there's nothing to redo.
+  // Drop the oldest commands while the undo list is over the user's limit,
+  // but always keep the one just executed.
+  const size_t limit = size_t(PWSprefs::GetInstance()->
+                              GetPref(PWSprefs::MaxUndoMemoryMiB)) << 20;
+  if (limit == 0 || m_commands_size <= limit || m_vpcommands.size() < 2)
+    return;
+
+  size_t total(m_commands_size);
+  std::vector<Command *>::iterator cmd_iter;
+  for (cmd_iter = m_vpcommands.begin();
+       total > limit && cmd_iter != m_vpcommands.end() - 1; cmd_iter++) {
+    total -= m_vcommand_sizes[cmd_iter - m_vpcommands.begin()];
+  }
+
+  if (cmd_iter != m_vpcommands.begin()) {
+    pws_os::Trace(_T("PWScore::TrimCommands - dropped %d undo commands\n"),
+                  int(cmd_iter - m_vpcommands.begin()));
+    DeleteCommands(m_vpcommands.begin(), cmd_iter);
+    m_undo_iter = m_redo_iter = m_vpcommands.end();
+    m_undo_iter--;
+  }
 }
 
 void PWScore::ResetStateAfterSave()
@@ -638,19 +692,18 @@ void PWScore::ResetStateAfterSave()
 
 int PWScore::Execute(Command *pcmd)
 {
-  if (m_redo_iter != m_vpcommands.end()) {
-    std::vector<Command *>::iterator cmd_Iter;
-
-    for (cmd_Iter = m_redo_iter; cmd_Iter != m_vpcommands.end(); cmd_Iter++) {
-      delete (*cmd_Iter);
-    }
-    m_vpcommands.erase(m_redo_iter, m_vpcommands.end());
-  }
+  if (m_redo_iter != m_vpcommands.end())
+    DeleteCommands(m_redo_iter, m_vpcommands.end());
 
   m_vpcommands.push_back(pcmd);
   m_undo_iter = m_redo_iter = m_vpcommands.end();
   int rc = pcmd->Execute();
   m_undo_iter--;
+  // Sized once executed, as commands hold on to what they change then
+  m_vcommand_sizes.push_back(pcmd->GetMemorySize());
+  m_commands_size += m_vcommand_sizes.back();
+
+  TrimCommands();
 
   NotifyGUINeedsUpdating(UpdateGUICommand::GUI_UPDATE_STATUSBAR, CUUID::NullUUID());
   return rc;
@@ -908,6 +961,7 @@ int PWScore::ReadFile(const StringX &a_filename, const StringX &a_passkey,
     } // switch
   } while (go);
 
+  InvalidateEntryIndices();
   ParseDependants();
 
   m_nRecordsWithUnknownFields = in->GetNumRecordsWithUnknownFields();
@@ -1188,94 +1242,414 @@ ItemListIter PWScore::Find(const StringX &a_group,const StringX &a_title,
   return retval;
 }
 
-struct TitleMatch {
-  bool operator()(std::pair<CUUID, CItemData> p) {
-    const CItemData &item = p.second;
-    return (m_title == item.GetTitle());
+void PWScore::UpdateSearchIndex(const CItemData &ci)
+{
+  // Called whenever an entry is added or its text changes
+  m_nModifications++;
+  if (!m_bSearchIndexValid)
+    return;
+
+  std::vector<StringX> vtext;
+  ci.GetSearchableText(vtext);
+  m_searchindex.Add(ci.GetUUID(), vtext); // replaces any previous text
+}
+
+void PWScore::UpdateTargetIndex(const CItemData &ci)
+{
+  if (!m_bTargetIndexValid)
+    return;
+
+  m_targetindex.Add(ci.GetUUID(), ci.GetTitle(), ci.GetURL());
+}
+
+void PWScore::AddToEntryIndices(const CItemData &ci)
+{
+  UpdateSearchIndex(ci);
+  UpdateTargetIndex(ci);
+
+  if (!m_bEntryIndicesValid)
+    return; // will be rebuilt from m_pwlist on next use
+
+  IndexEntry(ci);
+}
+
+void PWScore::IndexEntry(const CItemData &ci)
+{
+  const CUUID uuid = ci.GetUUID();
+  const StringX sxGroup(ci.GetGroup()), sxTitle(ci.GetTitle()), sxUser(ci.GetUser());
+  m_title_index.insert(std::make_pair(sxTitle, uuid));
+  m_grouptitle_index.insert(std::make_pair(StringXPair(sxGroup, sxTitle), uuid));
+  m_titleuser_index.insert(std::make_pair(StringXPair(sxTitle, sxUser), uuid));
+  m_groupindex.Add(sxGroup, uuid);
+}
+
+template<class IndexType, class KeyType>
+static void EraseFromIndex(IndexType &index, const KeyType &key, const CUUID &uuid)
+{
+  typename IndexType::iterator iter = index.lower_bound(key);
+  const typename IndexType::iterator end = index.upper_bound(key);
+  while (iter != end) {
+    if (iter->second == uuid) {
+      index.erase(iter);
+      return;
+    }
+    iter++;
   }
+  // Not found means an entry was changed without updating the indices
+  ASSERT(0);
+}
 
-  TitleMatch(const StringX &a_title) :
-    m_title(a_title) {}
+void PWScore::RemoveFromEntryIndices(const CItemData &ci)
+{
+  const CUUID uuid = ci.GetUUID();
+  m_nModifications++;
+  if (m_bSearchIndexValid)
+    m_searchindex.Remove(uuid);
+  if (m_bTargetIndexValid)
+    m_targetindex.Remove(uuid);
 
-private:
-  TitleMatch& operator=(const TitleMatch&); // Do not implement
-  const StringX &m_title;
-};
+  if (!m_bEntryIndicesValid)
+    return;
 
-ItemListIter PWScore::GetUniqueBase(const StringX &a_title, bool &bMultiple)
+  const StringX sxGroup(ci.GetGroup()), sxTitle(ci.GetTitle()), sxUser(ci.GetUser());
+  EraseFromIndex(m_title_index, sxTitle, uuid);
+  EraseFromIndex(m_grouptitle_index, StringXPair(sxGroup, sxTitle), uuid);
+  EraseFromIndex(m_titleuser_index, StringXPair(sxTitle, sxUser), uuid);
+  m_groupindex.Remove(sxGroup, uuid);
+}
+
+void PWScore::ReindexEntry(const CItemData &old_ci, const CItemData &new_ci)
 {
-  ItemListIter retval(m_pwlist.end());
-  int num(0);
-  TitleMatch TitleMatch(a_title);
+  if (old_ci.GetGroup() == new_ci.GetGroup() &&
+      old_ci.GetTitle() == new_ci.GetTitle() &&
+      old_ci.GetUser() == new_ci.GetUser()) {
+    UpdateSearchIndex(new_ci);
+    UpdateTargetIndex(new_ci);
+    return;
+  }
 
-  ItemListIter found(m_pwlist.begin());
-  do {
-    found = find_if(found, m_pwlist.end(), TitleMatch);
-    if (found != m_pwlist.end()) {
-      num++;
-      if (num == 1) {
-        // Save first
-        retval = found;
-      } else {
-        // More than 1, set to end()
-        retval = m_pwlist.end();
-        break;
-      }
-      found++;
-    } else
-      break;
-  } while (found != m_pwlist.end());
+  RemoveFromEntryIndices(old_ci);
+  AddToEntryIndices(new_ci);
+}
 
-  // It is 1 if only 1, but 0 if none & 2 if more than 1 (we just stopped at the second)
-  bMultiple = (num > 1);
-  return retval;
+void PWScore::BuildEntryIndices()
+{
+  m_title_index.clear();
+  m_grouptitle_index.clear();
+  m_titleuser_index.clear();
+  m_groupindex.Clear();
+
+  m_bEntryIndicesValid = true;
+  ItemListConstIter iter;
+  for (iter = m_pwlist.begin(); iter != m_pwlist.end(); iter++) {
+    IndexEntry(iter->second);
+  }
+  m_groupindex.SetEmptyGroups(m_vEmptyGroups);
 }
 
-struct GroupTitle_TitleUserMatch {
-  bool operator()(std::pair<CUUID, CItemData> p) {
-    const CItemData &item = p.second;
-    return ((m_gt == item.GetGroup() && m_tu == item.GetTitle()) ||
-            (m_gt == item.GetTitle() && m_tu == item.GetUser()));
+void PWScore::BuildSearchIndex()
+{
+  m_searchindex.Clear();
+
+  m_bSearchIndexValid = true;
+  ItemListConstIter iter;
+  std::vector<StringX> vtext;
+  for (iter = m_pwlist.begin(); iter != m_pwlist.end(); iter++) {
+    // Not via UpdateSearchIndex(), as nothing's changed
+    iter->second.GetSearchableText(vtext);
+    m_searchindex.Add(iter->first, vtext);
   }
+}
 
-  GroupTitle_TitleUserMatch(const StringX &a_grouptitle,
-                            const StringX &a_titleuser) :
-                            m_gt(a_grouptitle),  m_tu(a_titleuser) {}
+void PWScore::BuildTargetIndex()
+{
+  m_targetindex.Clear();
 
-private:
-  GroupTitle_TitleUserMatch& operator=(const GroupTitle_TitleUserMatch&); // Do not implement
-  const StringX &m_gt;
-  const StringX &m_tu;
-};
+  m_bTargetIndexValid = true;
+  ItemListConstIter iter;
+  for (iter = m_pwlist.begin(); iter != m_pwlist.end(); iter++) {
+    UpdateTargetIndex(iter->second);
+  }
+}
+
+bool PWScore::GetSearchCandidates(const StringX &sxText, UUIDVector &candidates)
+{
+  if (!m_bSearchIndexValid)
+    BuildSearchIndex();
+
+  return m_searchindex.GetCandidates(sxText, candidates);
+}
+
+CItemData::FieldBits PWScore::GetUnindexedFields(const CItemData::FieldBits &bsFields)
+{
+  CItemData::FieldBits bsUnindexed;
+  bsUnindexed.set(CItemData::PASSWORD);
+  bsUnindexed.set(CItemData::PWHIST);
+  return bsUnindexed & bsFields;
+}
+
+// Indices of the entries passing test, in order. The entries are tested
+// in parallel, see CParallelScan for what test may do.
+template<typename Test>
+static void SelectEntries(const std::vector<const CItemData *> &vpci, Test test,
+                          std::vector<size_t> &selected)
+{
+  std::vector<std::vector<size_t> > results;
+  CParallelScan().Scan(vpci.size(), results,
+                       [&vpci, &test](size_t i, std::vector<size_t> &passed) {
+                         if (test(*vpci[i]))
+                           passed.push_back(i);
+                         return true;
+                       });
+
+  selected.clear();
+  for (size_t ichunk = 0; ichunk < results.size(); ichunk++)
+    selected.insert(selected.end(), results[ichunk].begin(), results[ichunk].end());
+}
+
+void PWScore::GetEntryPointers(std::vector<const CItemData *> &vpci) const
+{
+  vpci.clear();
+  vpci.reserve(m_pwlist.size());
+  ItemListConstIter iter;
+  for (iter = m_pwlist.begin(); iter != m_pwlist.end(); iter++)
+    vpci.push_back(&iter->second);
+}
+
+void PWScore::GetEntryPointers(const OrderedItemList *pOIL,
+                               std::vector<const CItemData *> &vpci) const
+{
+  if (pOIL == NULL) {
+    GetEntryPointers(vpci);
+    return;
+  }
+  vpci.clear();
+  vpci.reserve(pOIL->size());
+  OrderedItemList::const_iterator iter;
+  for (iter = pOIL->begin(); iter != pOIL->end(); iter++)
+    vpci.push_back(&*iter);
+}
+
+void PWScore::FindText(const StringX &sxText, bool bCaseSensitive,
+                       const CItemData::FieldBits &bsFields, UUIDVector &matches)
+{
+  matches.clear();
+
+  std::vector<const CItemData *> vpci;
+  UUIDVector candidates;
+  const CItemData::FieldBits bsUnindexed = GetUnindexedFields(bsFields);
+  const bool bUseCandidates = GetSearchCandidates(sxText, candidates);
+  if (bUseCandidates && bsUnindexed.none()) {
+    vpci.reserve(candidates.size());
+    UUIDVectorIter iter;
+    for (iter = candidates.begin(); iter != candidates.end(); iter++) {
+      ItemListConstIter pos = m_pwlist.find(*iter);
+      ASSERT(pos != m_pwlist.end());
+      if (pos != m_pwlist.end())
+        vpci.push_back(&pos->second);
+    }
+  } else
+    GetEntryPointers(vpci);
+
+  // Searching passwords, entries that aren't candidates are checked for
+  // those only
+  const bool bCheckAll = !bUseCandidates || bsUnindexed.none();
+  if (!bCheckAll)
+    std::sort(candidates.begin(), candidates.end());
+  const PWSMatch::CFinder finder(sxText, bCaseSensitive);
+  std::vector<size_t> found;
+  SelectEntries(vpci, [&](const CItemData &ci) {
+                  if (bCheckAll || std::binary_search(candidates.begin(), candidates.end(),
+                                                      ci.GetUUID()))
+                    return ci.ContainsText(finder, bsFields);
+                  return ci.ContainsText(finder, bsUnindexed);
+                }, found);
+
+  matches.reserve(found.size());
+  for (size_t i = 0; i < found.size(); i++)
+    matches.push_back(vpci[found[i]]->GetUUID());
+}
+
+void PWScore::FindPassword(const StringX &sxPassword, bool bIncludeHistory,
+                           UUIDVector &matches)
+{
+  matches.clear();
+  if (sxPassword.empty())
+    return;
+
+  // Passwords aren't in the search index, so all entries are checked
+  std::vector<const CItemData *> vpci;
+  GetEntryPointers(vpci);
+
+  std::vector<size_t> found;
+  SelectEntries(vpci, [&sxPassword, bIncludeHistory](const CItemData &ci) {
+                  return ci.HasPassword(sxPassword, bIncludeHistory);
+                }, found);
+
+  matches.reserve(found.size());
+  for (size_t i = 0; i < found.size(); i++)
+    matches.push_back(vpci[found[i]]->GetUUID());
+}
+
+void PWScore::FindTargets(const StringX &sxWindowTitle, const StringX &sxURL,
+                          size_t maxResults, UUIDVector &matches)
+{
+  if (!m_bTargetIndexValid)
+    BuildTargetIndex();
+
+  m_targetindex.FindBest(sxWindowTitle, sxURL, maxResults, matches);
+}
+
+void PWScore::GetGroupEntries(const StringX &sxPath, UUIDVector &vuuids)
+{
+  if (!m_bEntryIndicesValid)
+    BuildEntryIndices();
+
+  m_groupindex.GetEntries(sxPath, vuuids);
+}
+
+size_t PWScore::GetNumGroupEntries(const StringX &sxPath)
+{
+  if (!m_bEntryIndicesValid)
+    BuildEntryIndices();
+
+  return m_groupindex.GetNumEntries(sxPath);
+}
+
+void PWScore::GetGroupEmptyGroups(const StringX &sxPath,
+                                  std::vector<StringX> &vEmptyGroups)
+{
+  if (!m_bEntryIndicesValid)
+    BuildEntryIndices();
+
+  m_groupindex.GetEmptyGroups(sxPath, vEmptyGroups);
+}
+
+void PWScore::GetFilteredEntries(const CCompiledFilter &filter,
+                                 UUIDVector &entries) const
+{
+  entries.clear();
+
+  std::vector<const CItemData *> vpci;
+  GetEntryPointers(vpci);
+
+  // An alias' tests may need its base entry, which may be being tested by
+  // another thread, so aliases are tested afterwards
+  std::vector<size_t> passed;
+  SelectEntries(vpci, [&filter](const CItemData &ci) {
+                  return ci.IsAlias() || filter.Passes(ci);
+                }, passed);
+
+  entries.reserve(passed.size());
+  for (size_t i = 0; i < passed.size(); i++) {
+    const CItemData &ci = *vpci[passed[i]];
+    if (!ci.IsAlias() || filter.Passes(ci, GetBaseEntry(&ci)))
+      entries.push_back(ci.GetUUID());
+  }
+}
+
+void PWScore::FindFuzzy(const StringX &sxText, size_t maxResults,
+                        UUIDVector &matches, const UUIDList *pRUEList) const
+{
+  std::vector<const CItemData *> vpci;
+  GetEntryPointers(vpci);
+  FindFuzzy(vpci, sxText, maxResults, matches, pRUEList);
+}
+
+void PWScore::FindFuzzy(const std::vector<const CItemData *> &vpci,
+                        const StringX &sxText, size_t maxResults,
+                        UUIDVector &matches, const UUIDList *pRUEList) const
+{
+  matches.clear();
+
+  const PWSMatch::CFuzzyMatcher matcher(sxText);
+  if (matcher.IsEmpty())
+    return;
+
+  if (pRUEList == NULL)
+    pRUEList = &m_RUEList;
+  std::map<CUUID, size_t> rue_pos;
+  for (UUIDList::const_iterator iter = pRUEList->begin(); iter != pRUEList->end(); iter++)
+    rue_pos.insert(std::make_pair(*iter, rue_pos.size()));
+  const size_t nrue = pRUEList->size();
+  const time_t now = time(NULL);
+
+  std::vector<size_t> best;
+  PWSMatch::SelectBest(vpci.size(), maxResults,
+                       [&](size_t i, int minScore) {
+                         const CItemData &ci = *vpci[i];
+                         int score = matcher.ScoreFields(ci,
+                           minScore - PWSMatch::CFuzzyMatcher::GetMaxBonus());
+                         if (score == 0)
+                           return 0;
+
+                         std::map<CUUID, size_t>::const_iterator pos =
+                           rue_pos.find(ci.GetUUID());
+                         if (pos != rue_pos.end())
+                           score += PWSMatch::CFuzzyMatcher::GetRUEBonus(pos->second, nrue);
+                         time_t atime;
+                         ci.GetATime(atime);
+                         return score + PWSMatch::CFuzzyMatcher::GetRecentBonus(atime, now);
+                       }, best);
+
+  matches.reserve(best.size());
+  for (size_t i = 0; i < best.size(); i++)
+    matches.push_back(vpci[best[i]]->GetUUID());
+}
+
+ItemListIter PWScore::GetUniqueBase(const StringX &a_title, bool &bMultiple)
+{
+  if (!m_bEntryIndicesValid)
+    BuildEntryIndices();
+
+  std::pair<TitleIndexConstIter, TitleIndexConstIter> range =
+    m_title_index.equal_range(a_title);
+
+  ItemListIter retval(m_pwlist.end());
+  bMultiple = false;
+  if (range.first != range.second) {
+    TitleIndexConstIter next(range.first);
+    if (++next == range.second) {
+      // Exactly one
+      retval = m_pwlist.find(range.first->second);
+      ASSERT(retval != m_pwlist.end() && retval->second.GetTitle() == a_title);
+    } else
+      bMultiple = true;
+  }
+  return retval;
+}
 
 ItemListIter PWScore::GetUniqueBase(const StringX &grouptitle,
                                     const StringX &titleuser, bool &bMultiple)
 {
-  ItemListIter retval(m_pwlist.end());
-  int num(0);
-  GroupTitle_TitleUserMatch GroupTitle_TitleUserMatch(grouptitle, titleuser);
+  // Matches entries with (group == grouptitle && title == titleuser) or
+  // (title == grouptitle && user == titleuser) - an entry may satisfy both,
+  // so count distinct uuids across the two indices, stopping at the second.
+  if (!m_bEntryIndicesValid)
+    BuildEntryIndices();
 
-  ItemListIter found(m_pwlist.begin());
-  do {
-    found = find_if(found, m_pwlist.end(), GroupTitle_TitleUserMatch);
-    if (found != m_pwlist.end()) {
-      num++;
-      if (num == 1) {
-        // Save first
-        retval = found;
-      } else {
-        // More than 1, set to end()
-        retval = m_pwlist.end();
-        break;
-      }
-      found++;
-    } else
-      break;
-  } while (found != m_pwlist.end());
+  const StringXPair key(grouptitle, titleuser);
+  std::pair<PairIndexConstIter, PairIndexConstIter> ranges[2] = {
+    m_grouptitle_index.equal_range(key),
+    m_titleuser_index.equal_range(key)
+  };
+
+  CUUID first_uuid(CUUID::NullUUID());
+  int num(0);
+  for (int i = 0; i < 2 && num < 2; i++) {
+    for (PairIndexConstIter iter = ranges[i].first;
+         iter != ranges[i].second && num < 2; iter++) {
+      if (num == 0) {
+        first_uuid = iter->second;
+        num++;
+      } else if (iter->second != first_uuid)
+        num++;
+    }
+  }
 
   // It is 1 if only 1, but 0 if none & 2 if more than 1 (we just stopped at the second)
   bMultiple = (num > 1);
-  return retval;
+  return (num == 1) ? m_pwlist.find(first_uuid) : m_pwlist.end();
 }
 
 void PWScore::EncryptPassword(const unsigned char *plaintext, size_t len,
@@ -1537,6 +1911,46 @@ void PWScore::ParseDependants()
   }
 }
 
+// Problems found by Validate in an entry on its own, see CheckEntry
+struct st_EntryProblems {
+  size_t index; // in m_pwlist
+  bool bPWHFixed;
+  StringX sxPWH; // fixed password history
+  bool bBigField;
+
+  explicit st_EntryProblems(size_t i = 0)
+    : index(i), bPWHFixed(false), bBigField(false) {}
+};
+
+// Returns true if there's anything in ep
+static bool CheckEntry(const CItemData &ci, const size_t iMAXCHARS,
+                       st_EntryProblems &ep)
+{
+  if (ci.IsPasswordHistorySet()) {
+    CItemData fixedItem(ci);
+    if (!fixedItem.ValidatePWHistory()) {
+      ep.bPWHFixed = true;
+      ep.sxPWH = fixedItem.GetPWHistory();
+    }
+  }
+
+  if (iMAXCHARS > 0) {
+    for (unsigned char uc = static_cast<unsigned char>(CItemData::GROUP);
+         uc < static_cast<unsigned char>(CItemData::LAST); uc++) {
+      if (CItemData::IsTextField(uc)) {
+        StringX sxvalue = ci.GetFieldValue(static_cast<CItemData::FieldType>(uc));
+        if (sxvalue.length() > iMAXCHARS) {
+          ep.bBigField = true;
+          //  We don't truncate the field, but if we did, then the the code would be:
+          //  fixedItem.SetFieldValue((CItemData::FieldType)uc, sxvalue.substr(0, iMAXCHARS))
+          break;
+        }
+      }
+    }
+  }
+  return ep.bPWHFixed || ep.bBigField;
+}
+
 bool PWScore::Validate(const size_t iMAXCHARS, CReport *pRpt, st_ValidateResults &st_vr)
 {
   /*
@@ -1571,6 +1985,25 @@ bool PWScore::Validate(const size_t iMAXCHARS, CReport *pRpt, st_ValidateResults
                                  vGTU_ALIASES, vGTU_SHORTCUTS;
   std::vector<st_GroupTitleUser2> vGTU_NONUNIQUE, vGTU_EmptyTitle;
 
+  // Password histories and field lengths are checked for all entries up
+  // front, in parallel, as these don't depend on the other entries (unlike
+  // group/title/user uniqueness)
+  std::vector<const CItemData *> vpci;
+  GetEntryPointers(vpci);
+  std::vector<std::vector<st_EntryProblems> > vProblemChunks;
+  CParallelScan().Scan(vpci.size(), vProblemChunks,
+                       [&vpci, iMAXCHARS](size_t i, std::vector<st_EntryProblems> &problems) {
+                         st_EntryProblems ep(i);
+                         if (CheckEntry(*vpci[i], iMAXCHARS, ep))
+                           problems.push_back(ep);
+                         return true;
+                       });
+  std::vector<st_EntryProblems> vProblems;
+  for (size_t ichunk = 0; ichunk < vProblemChunks.size(); ichunk++)
+    vProblems.insert(vProblems.end(), vProblemChunks[ichunk].begin(),
+                     vProblemChunks[ichunk].end());
+  std::vector<st_EntryProblems>::const_iterator problem_iter = vProblems.begin();
+
   ItemListIter iter;
 
   for (iter = m_pwlist.begin(); iter != m_pwlist.end(); iter++) {
@@ -1580,6 +2013,10 @@ bool PWScore::Validate(const size_t iMAXCHARS, CReport *pRpt, st_ValidateResults
 
     n++;
 
+    const st_EntryProblems *pProblems = NULL;
+    if (problem_iter != vProblems.end() && problem_iter->index == size_t(n))
+      pProblems = &*problem_iter++;
+
     // Fix GTU uniqueness - can't do this in a CItemData member function as it causes
     // circular includes:
     //  "ItemData.h" would need to include "coredefs.h", which needs to include "ItemData.h"!
@@ -1641,32 +2078,18 @@ bool PWScore::Validate(const size_t iMAXCHARS, CReport *pRpt, st_ValidateResults
     }
 
     // Test if Password History was fixed
-    if (!fixedItem.ValidatePWHistory()) {
+    if (pProblems != NULL && pProblems->bPWHFixed) {
+      fixedItem.SetPWHistory(pProblems->sxPWH);
       bFixed = true;
       vGTU_PWH.push_back(st_GroupTitleUser(sxgroup, sxtitle, sxuser));
       st_vr.num_PWH_fixed++;
     }
 
     // Note excessively sized text fields
-    if (iMAXCHARS > 0) {
-      bool bEntryHasBigField(false);
-      for (unsigned char uc = static_cast<unsigned char>(CItemData::GROUP);
-           uc < static_cast<unsigned char>(CItemData::LAST); uc++) {
-        if (CItemData::IsTextField(uc)) {
-          StringX sxvalue = ci.GetFieldValue(static_cast<CItemData::FieldType>(uc));
-          if (sxvalue.length() > iMAXCHARS) {
-            bEntryHasBigField = true;
-            //  We don't truncate the field, but if we did, then the the code would be:
-            //  fixedItem.SetFieldValue((CItemData::FieldType)uc, sxvalue.substr(0, iMAXCHARS))
-            break;
-          }
-        }
-      }
-      if (bEntryHasBigField) {
-        uimaxsize = std::max(uimaxsize, ci.GetSize());
-        vGTU_TEXT.push_back(st_GroupTitleUser(sxgroup, sxtitle, sxuser));
-        st_vr.num_excessivetxt_found++;
-      }
+    if (pProblems != NULL && pProblems->bBigField) {
+      uimaxsize = std::max(uimaxsize, ci.GetSize());
+      vGTU_TEXT.push_back(st_GroupTitleUser(sxgroup, sxtitle, sxuser));
+      st_vr.num_excessivetxt_found++;
     }
 
     if (bFixed) {
@@ -1675,6 +2098,7 @@ bool PWScore::Validate(const size_t iMAXCHARS, CReport *pRpt, st_ValidateResults
       // We assume that this is run during file read. If not, then we
       // need to run using the Command mechanism for Undo/Redo.
       m_pwlist[fixedItem.GetUUID()] = fixedItem;
+      InvalidateEntryIndices();
     }
   } // iteration over m_pwlist
 #if 0 // XXX We've separated alias/shortcut processing from Validate - reconsider this!
@@ -2256,6 +2680,7 @@ int PWScore::DoAddDependentEntries(UUIDVector &dependentlist, CReport *pRpt,
             // Invalid - delete!
             if (pmapDeletedItems != NULL)
               pmapDeletedItems->insert(ItemList_Pair(*paiter, *pci_curitem));
+            RemoveFromEntryIndices(iter->second);
             m_pwlist.erase(iter);
             continue;
           }
@@ -2280,6 +2705,7 @@ int PWScore::DoAddDependentEntries(UUIDVector &dependentlist, CReport *pRpt,
             // Invalid - delete!
             if (pmapDeletedItems != NULL)
               pmapDeletedItems->insert(ItemList_Pair(*paiter, *pci_curitem));
+            RemoveFromEntryIndices(iter->second);
             m_pwlist.erase(iter);
             continue;
           }
@@ -2347,6 +2773,7 @@ int PWScore::DoAddDependentEntries(UUIDVector &dependentlist, CReport *pRpt,
           pci_curitem->SetPassword(_T("[Shortcut]"));
           pci_curitem->SetShortcut();
         }
+        UpdateSearchIndex(*pci_curitem);
       } else {
         // Specified base does not exist!
         if (pRpt != NULL) {
@@ -2390,6 +2817,7 @@ void PWScore::UndoAddDependentEntries(ItemList *pmapDeletedItems,
        add_iter != pmapDeletedItems->end();
        add_iter++) {
     m_pwlist[add_iter->first] = add_iter->second;
+    AddToEntryIndices(add_iter->second);
   }
 
   for (restore_iter = pmapSaveTypePW->begin();
@@ -2402,8 +2830,10 @@ void PWScore::UndoAddDependentEntries(ItemList *pmapDeletedItems,
     CItemData *pci_changeditem = &iter->second;
     st_SaveTypePW *pst_typepw = &restore_iter->second;
     pci_changeditem->SetEntryType(pst_typepw->et);
-    if (!pst_typepw->sxpw.empty())
+    if (!pst_typepw->sxpw.empty()) {
       pci_changeditem->SetPassword(pst_typepw->sxpw);
+      UpdateSearchIndex(*pci_changeditem);
+    }
   }
 }
 
@@ -2435,6 +2865,7 @@ void PWScore::ResetAllAliasPasswords(const CUUID &base_uuid)
     if (alias_itr != m_pwlist.end()) {
       alias_itr->second.SetPassword(csBasePassword);
       alias_itr->second.SetNormal();
+      UpdateSearchIndex(alias_itr->second);
       GUIRefreshEntry(alias_itr->second);
     }
   }
@@ -2675,6 +3106,13 @@ void PWScore::UpdateWizard(const stringT &s)
     m_pUIIF->UpdateWizard(s);
 }
 
+void PWScore::GUIMemoryUsage(st_MemoryUsage &usage) const
+{
+  if (m_pUIIF != NULL &&
+      m_bsSupportedFunctions.test(UIInterFace::GUIMEMORYUSAGE))
+    m_pUIIF->GUIMemoryUsage(usage);
+}
+
 /*
  *  End UI Interface feedback routines
  */
@@ -2710,16 +3148,16 @@ void PWScore::UnlockFile2(const stringT &filename)
 
 bool PWScore::IsNodeModified(StringX &path) const
 {
-  return std::find(m_vnodes_modified.begin(),
-                   m_vnodes_modified.end(), path) != m_vnodes_modified.end();
+  return m_snodes_modified.find(path) != m_snodes_modified.end();
 }
 
 void PWScore::AddChangedNodes(StringX path)
 {
   StringX nextpath(path);
   while (!nextpath.empty()) {
-    if (std::find(m_vnodes_modified.begin(), m_vnodes_modified.end(), nextpath) == m_vnodes_modified.end())
-      m_vnodes_modified.push_back(nextpath);
+    if (!m_snodes_modified.insert(nextpath).second)
+      break; // so are the groups it's in
+    m_vnodes_modified.push_back(nextpath);
     size_t i = nextpath.find_last_of(_T("."));
     if (i == nextpath.npos)
       i = 0;
@@ -2928,6 +3366,9 @@ int PWScore::DoUpdatePasswordHistory(int iAction, int new_default_max,
       (*updater)(curitem);
     }
   }
+  // Password history is searchable
+  if (num_altered != 0)
+    InvalidateSearchIndex();
   return num_altered;
 }
 
@@ -2942,29 +3383,47 @@ void PWScore::UndoUpdatePasswordHistory(SavePWHistoryMap &mapSavedHistory)
       listPos->second.SetStatus(itr->second.es);
     }
   }
+  if (!mapSavedHistory.empty())
+    InvalidateSearchIndex();
 }
 
 int PWScore::DoRenameGroup(const StringX &sxOldPath, const StringX &sxNewPath)
 {
-  const StringX sxDot(L".");
-  const wchar_t wcDot=L'.';
-  StringX sxOldPath2 = sxOldPath + sxDot;
-  const size_t len2 = sxOldPath2.length();
-  ItemListIter iter;
-
-  for (iter = m_pwlist.begin(); iter != m_pwlist.end(); iter++) {
-    if (iter->second.GetGroup() == sxOldPath) {
-      iter->second.SetGroup(sxNewPath);
-    }
-    else if ((iter->second.GetGroup().length() > len2) && (iter->second.GetGroup().substr(0, len2) == sxOldPath2) &&
-     (iter->second.GetGroup()[len2] != wcDot)) {
-      // Need to check that next symbol is not a dot
-      // to ensure not affecting another group
-      // (group name could contain traling dots, for example abc..def.g)
-      // subgroup name will have len > len2 (old_name + dot + subgroup_name)
-      StringX sxSubGroups = iter->second.GetGroup().substr(len2);
-      iter->second.SetGroup(sxNewPath + sxDot + sxSubGroups);
-    }
+  if (sxOldPath == sxNewPath)
+    return 0;
+
+  if (!m_bEntryIndicesValid)
+    BuildEntryIndices();
+
+  // The group index has the entries in the group or its subgroups, i.e.,
+  // in sxOldPath or in a group starting with sxOldPath + "." followed by
+  // something other than a dot (group names can end with dots, for
+  // example "abc..def.g" is subgroup "g" of "def" of "abc."). All are
+  // found before any is moved, as the new path may be under the old.
+  std::vector<CGroupIndex::GroupEntries> vgroups;
+  m_groupindex.GetEntriesByGroup(sxOldPath, vgroups);
+
+  // Of the other indices, only the (group, title) one depends on the
+  // group, and the search index on all the text
+  const size_t len = sxOldPath.length();
+  for (size_t ig = 0; ig < vgroups.size(); ig++) {
+    const StringX &sxGroup = vgroups[ig].sxGroup;
+    const UUIDVector &vuuids = vgroups[ig].vuuids;
+    const StringX sxNewGroup = sxNewPath + sxGroup.substr(len);
+
+    for (size_t i = 0; i < vuuids.size(); i++) {
+      const CUUID &uuid = vuuids[i];
+      ItemListIter iter = m_pwlist.find(uuid);
+      ASSERT(iter != m_pwlist.end());
+      CItemData &ci = iter->second;
+      const StringX sxTitle = ci.GetTitle();
+      EraseFromIndex(m_grouptitle_index, StringXPair(sxGroup, sxTitle), uuid);
+      ci.SetGroup(sxNewGroup);
+      m_grouptitle_index.insert(std::make_pair(StringXPair(sxNewGroup, sxTitle), uuid));
+      UpdateSearchIndex(ci);
+    }
+    m_groupindex.Remove(sxGroup, vuuids);
+    m_groupindex.Add(sxNewGroup, vuuids);
   }
   return 0;
 }
@@ -3043,6 +3502,80 @@ void PWScore::GetDBProperties(st_DBProperties &st_dbp)
   st_dbp.db_description = m_hdr.m_dbdesc;
 }
 
+template<class MapType>
+static void AddMapUsage(st_MemoryUsage &usage, const MapType &m)
+{
+  usage.Add(m.size() * (MAP_NODE_OVERHEAD + sizeof(typename MapType::value_type)),
+            m.size());
+}
+
+void PWScore::GetMemoryStats(st_MemoryStats &stats) const
+{
+  // Entries: list nodes + everything each CItemData holds
+  AddMapUsage(stats.entries, m_pwlist);
+  ItemListConstIter iter;
+  for (iter = m_pwlist.begin(); iter != m_pwlist.end(); iter++) {
+    iter->second.GetMemoryUsage(stats);
+  }
+
+  UnknownFieldList::const_iterator hufiter;
+  for (hufiter = m_UHFL.begin(); hufiter != m_UHFL.end(); hufiter++) {
+    stats.unknownfields.Add(sizeof(*hufiter) + hufiter->st_length);
+  }
+
+  // Lookup indices & dependents maps (keys' heap parts not included)
+  AddMapUsage(stats.indices, m_title_index);
+  AddMapUsage(stats.indices, m_grouptitle_index);
+  AddMapUsage(stats.indices, m_titleuser_index);
+  m_searchindex.GetMemoryUsage(stats.indices);
+  m_targetindex.GetMemoryUsage(stats.indices);
+  m_groupindex.GetMemoryUsage(stats.indices);
+  AddMapUsage(stats.indices, m_base2aliases_mmap);
+  AddMapUsage(stats.indices, m_base2shortcuts_mmap);
+  AddMapUsage(stats.indices, m_alias2base_map);
+  AddMapUsage(stats.indices, m_shortcut2base_map);
+  AddMapUsage(stats.indices, m_KBShortcutMap);
+
+  // Undo/redo
+  std::vector<Command *>::const_iterator cmd_iter;
+  for (cmd_iter = m_vpcommands.begin(); cmd_iter != m_vpcommands.end(); cmd_iter++) {
+    stats.undo.Add((*cmd_iter)->GetMemorySize());
+  }
+
+  // Filters
+  PWSFilters::const_iterator fiter;
+  for (fiter = m_MapFilters.begin(); fiter != m_MapFilters.end(); fiter++) {
+    const st_filters &filters = fiter->second;
+    stats.filters.Add(MAP_NODE_OVERHEAD + sizeof(*fiter));
+    const vFilterRows *vrows[3] = {&filters.vMfldata, &filters.vHfldata,
+                                   &filters.vPfldata};
+    for (int i = 0; i < 3; i++) {
+      if (vrows[i]->empty())
+        continue;
+      stats.filters.Add(vrows[i]->capacity() * sizeof(st_FilterRow));
+      vFilterRows::const_iterator riter;
+      for (riter = vrows[i]->begin(); riter != vrows[i]->end(); riter++) {
+        stats.filters.Add(riter->fstring);
+      }
+    }
+  }
+
+  // Everything else
+  stats.other.Add(m_ExpireCandidates.capacity() * sizeof(ExpPWEntry));
+  AddMapUsage(stats.other, m_MapPSWDPLC);
+  stats.other.Add(m_vEmptyGroups.capacity() * sizeof(StringX));
+  std::vector<StringX>::const_iterator sxiter;
+  for (sxiter = m_vEmptyGroups.begin(); sxiter != m_vEmptyGroups.end(); sxiter++) {
+    stats.other.Add(*sxiter);
+  }
+  stats.other.Add(m_RUEList.size() * (2 * sizeof(void *) + sizeof(CUUID)),
+                  m_RUEList.size());
+
+  GUIMemoryUsage(stats.ui);
+
+  stats.kdf_peak = size_t(m_hashMemKiB) << 10;
+}
+
 void PWScore::SetHeaderUserFields(st_DBProperties &st_dbp)
 {
   // Currently only 2 user fields in DB header
@@ -3223,16 +3756,28 @@ void PWScore::AddPolicy(const StringX &sxPolicyName, const PWPolicy &st_pp,
   }
 }
 
+void PWScore::SetEmptyGroups(const std::vector<StringX> &vEmptyGroups)
+{
+  m_vEmptyGroups = vEmptyGroups;
+  if (m_bEntryIndicesValid)
+    m_groupindex.SetEmptyGroups(m_vEmptyGroups);
+  SetDBChanged(true);
+}
+
 bool PWScore::IsEmptyGroup(const StringX &sxEmptyGroup)
 {
-  return find(m_vEmptyGroups.begin(), m_vEmptyGroups.end(), sxEmptyGroup) !=
-                   m_vEmptyGroups.end();
+  if (!m_bEntryIndicesValid)
+    BuildEntryIndices();
+
+  return m_groupindex.IsEmptyGroup(sxEmptyGroup);
 }
 
 bool PWScore::AddEmptyGroup(const StringX &sxEmptyGroup)
 {
-  if (find(m_vEmptyGroups.begin(), m_vEmptyGroups.end(), sxEmptyGroup) ==
-           m_vEmptyGroups.end()) {
+  if (!m_bEntryIndicesValid)
+    BuildEntryIndices();
+
+  if (m_groupindex.AddEmptyGroup(sxEmptyGroup)) {
     m_vEmptyGroups.push_back(sxEmptyGroup);
     return true;
   } else
@@ -3241,14 +3786,17 @@ bool PWScore::AddEmptyGroup(const StringX &sxEmptyGroup)
 
 bool PWScore::RemoveEmptyGroup(const StringX &sxEmptyGroup)
 {
-  std::vector<StringX>::iterator iter;
-  iter = find(m_vEmptyGroups.begin(), m_vEmptyGroups.end(), sxEmptyGroup);
+  if (!m_bEntryIndicesValid)
+    BuildEntryIndices();
 
-  if (iter != m_vEmptyGroups.end()) {
-    m_vEmptyGroups.erase(iter);
-    return true;
-  } else
+  if (!m_groupindex.RemoveEmptyGroup(sxEmptyGroup))
     return false;
+
+  std::vector<StringX>::iterator iter;
+  iter = find(m_vEmptyGroups.begin(), m_vEmptyGroups.end(), sxEmptyGroup);
+  ASSERT(iter != m_vEmptyGroups.end());
+  m_vEmptyGroups.erase(iter);
+  return true;
 }
 
 void PWScore::RenameEmptyGroup(const StringX &sxOldGroup, const StringX &sxNewGroup)
@@ -3258,20 +3806,42 @@ void PWScore::RenameEmptyGroup(const StringX &sxOldGroup, const StringX &sxNewGr
   ASSERT(iter !=  m_vEmptyGroups.end());
 
   m_vEmptyGroups.erase(iter);
-  m_vEmptyGroups.push_back(sxNewGroup);
+  if (!m_bEntryIndicesValid)
+    BuildEntryIndices();
+  m_groupindex.RemoveEmptyGroup(sxOldGroup);
+  if (m_groupindex.AddEmptyGroup(sxNewGroup))
+    m_vEmptyGroups.push_back(sxNewGroup);
 }
 
 void PWScore::RenameEmptyGroupPaths(const StringX &sxOldPath, const StringX &sxNewPath)
 {
   // Rename all empty group paths below this renamed group so that they 
-  // stay within this new group tree
+  // stay within this new group tree. As for the entries in DoRenameGroup,
+  // "abc..def" is not below "abc", but group "def" of "abc."
+  if (!m_bEntryIndicesValid)
+    BuildEntryIndices();
+
+  const size_t nbelow = m_groupindex.GetNumEmptyGroups(sxOldPath) -
+                        (m_groupindex.IsEmptyGroup(sxOldPath) ? 1 : 0);
+  if (nbelow == 0)
+    return;
+
   const StringX sxOldPath2 = sxOldPath + L".";
   const size_t len = sxOldPath2.length();
 
-  for (size_t ig = 0; ig < m_vEmptyGroups.size(); ig++) {
-    if (m_vEmptyGroups[ig].length() > len && m_vEmptyGroups[ig].substr(0, len) == sxOldPath2) {
-      m_vEmptyGroups[ig].replace(0, len - 1, sxNewPath);
+  std::vector<StringX>::iterator iter = m_vEmptyGroups.begin();
+  while (iter != m_vEmptyGroups.end()) {
+    if (iter->length() > len && iter->compare(0, len, sxOldPath2) == 0 &&
+        (*iter)[len] != L'.') {
+      m_groupindex.RemoveEmptyGroup(*iter);
+      iter->replace(0, len - 1, sxNewPath);
+      // Dropped if the new group tree already has it
+      if (!m_groupindex.AddEmptyGroup(*iter)) {
+        iter = m_vEmptyGroups.erase(iter);
+        continue;
+      }
     }
+    iter++;
   }
 }
 
@@ -25,6 +25,11 @@
 #include "CommandInterface.h"
 #include "DBCompareData.h"
 #include "ExpiredList.h"
+#include "SearchIndex.h"
+#include "TargetIndex.h"
+#include "GroupIndex.h"
+#include "CompiledFilter.h"
+#include "ParallelScan.h"
 
 #include "coredefs.h"
 
@@ -114,6 +119,8 @@ struct st_ValidateResults {
   }
 };
 
+class CGTUIndex; // Entries by group, title & user, see CoreOtherDB.cpp
+
 class PWScore : public CommandInterface
 {
 public:
@@ -144,7 +151,8 @@ public:
     NO_ENTRIES_EXPORTED,
     OK_WITH_ERRORS,
     OK_WITH_VALIDATION_ERRORS,
-    OPEN_NODB
+    OPEN_NODB,
+    WRONG_DELTA_BASE
   };
 
   PWScore();
@@ -218,13 +226,16 @@ public:
                     const int &subgroup_function,
                     const OrderedItemList *pOIL);
 
+  // Called by Compare on the calling thread with the steps done so far
+  typedef std::function<void (size_t done, size_t total)> CompareProgressFn;
   void Compare(PWScore *pothercore,
                const CItemData::FieldBits &bsFields, const bool &subgroup_bset,
                const bool &bTreatWhiteSpaceasEmpty, const stringT &subgroup_name,
                const int &subgroup_object, const int &subgroup_function,
                CompareData &list_OnlyInCurrent, CompareData &list_OnlyInComp,
                CompareData &list_Conflicts, CompareData &list_Identical,
-               bool *pbCancel = NULL);
+               bool *pbCancel = NULL,
+               const CompareProgressFn &progress = CompareProgressFn());
 
   stringT Merge(PWScore *pothercore,
                 const bool &subgroup_bset,
@@ -282,6 +293,21 @@ public:
                              int &numImported, int &numSkipped, int &numRenamed,
                              UINT &uiReasonCode, CReport &rpt, Command *&pcommand);
 
+  // Delta files: the changes since a manifest of the database was
+  // written, to be applied to a copy of it (see Delta.h). Modifications
+  // carry the fields of bsFields only. If bUpdateManifest, the manifest
+  // is then rewritten, so that the next delta follows on from this one.
+  int WriteDeltaManifest(const StringX &filename);
+  int WriteDeltaFile(const StringX &filename, const StringX &manifest,
+                     const CItemData::FieldBits &bsFields, bool bUpdateManifest,
+                     int &numAdded, int &numModified, int &numDeleted);
+  // If returned status is SUCCESS, then returned Command * can be executed.
+  // Changes to entries changed here since the delta's base are skipped
+  // and reported as conflicts, and OK_WITH_ERRORS is returned instead.
+  int ApplyDeltaFile(const StringX &filename,
+                     int &numAdded, int &numUpdated, int &numDeleted,
+                     int &numConflicts, CReport &rpt, Command *&pcommand);
+
   // Locking files open in R/W mode
   bool LockFile(const stringT &filename, stringT &locker);
   bool IsLockedFile(const stringT &filename) const;
@@ -390,6 +416,48 @@ public:
   ItemListIter GetUniqueBase(const StringX &grouptitle, 
                              const StringX &titleuser, bool &bMultiple);
 
+  // Free text search, see CItemData::ContainsText().
+  // GetSearchCandidates() returns false if sxText is too short for the
+  // search index to narrow the search down, otherwise fills candidates with
+  // the only entries that may contain it, in no particular order, other
+  // than in the fields GetUnindexedFields() returns of those searched: the
+  // password and its history aren't indexed, so the other entries still
+  // have to be checked for those.
+  bool GetSearchCandidates(const StringX &sxText, UUIDVector &candidates);
+  // Bumped by every change to the entries or their text, however made
+  // (commands, imports, merges...), whether or not the GUI was notified,
+  // so that results kept from an earlier search can tell they're stale.
+  size_t GetModificationCount() const {return m_nModifications;}
+  static CItemData::FieldBits GetUnindexedFields(const CItemData::FieldBits &bsFields);
+  void FindText(const StringX &sxText, bool bCaseSensitive,
+                const CItemData::FieldBits &bsFields, UUIDVector &matches);
+  // Entries whose password, or if bIncludeHistory one of whose old
+  // passwords, is sxPassword: see CItemData::HasPassword()
+  void FindPassword(const StringX &sxPassword, bool bIncludeHistory,
+                    UUIDVector &matches);
+  // The (up to) maxResults entries best matching a window's title and/or
+  // a web page's URL, best first: see CTargetIndex. Used by the command
+  // line's --target; the wx UI autotypes the selected entry, so doesn't
+  // look one up by window title (yet).
+  void FindTargets(const StringX &sxWindowTitle, const StringX &sxURL,
+                   size_t maxResults, UUIDVector &matches);
+  // Entries in a group or any of its subgroups, in no particular order,
+  // and how many there are, and the empty groups among them: see CGroupIndex
+  virtual void GetGroupEntries(const StringX &sxPath, UUIDVector &vuuids);
+  size_t GetNumGroupEntries(const StringX &sxPath);
+  void GetGroupEmptyGroups(const StringX &sxPath, std::vector<StringX> &vEmptyGroups);
+  // Entries passing the filter, see CCompiledFilter
+  void GetFilteredEntries(const CCompiledFilter &filter, UUIDVector &entries) const;
+  // Ranked search, see PWSMatch::CFuzzyMatcher: the (up to) maxResults best
+  // matches, best first. Recently used entries are ranked by pRUEList (most
+  // recent first) if given, else by the database's list.
+  void FindFuzzy(const StringX &sxText, size_t maxResults, UUIDVector &matches,
+                 const UUIDList *pRUEList = NULL) const;
+  // The same, among vpci's entries only (e.g., those a filtered view shows)
+  void FindFuzzy(const std::vector<const CItemData *> &vpci,
+                 const StringX &sxText, size_t maxResults, UUIDVector &matches,
+                 const UUIDList *pRUEList = NULL) const;
+
   // Use following calls to 'SetChanged' & 'SetDBChanged' sparingly
   // outside of core
   void SetChanged(const bool bDBChanged, const bool bDBprefschanged)
@@ -420,6 +488,7 @@ public:
 
   void GUISetupDisplayInfo(CItemData &ci);
   void GUIRefreshEntry(const CItemData &ci);
+  void GUIMemoryUsage(st_MemoryUsage &usage) const;
   void UpdateWizard(const stringT &s);
 
   // Get/Set Display information from/to database
@@ -430,6 +499,8 @@ public:
   const PWSfile::HeaderRecord &GetHeader() const {return m_hdr;}
   void SetHeader(const PWSfile::HeaderRecord &hdr) { m_hdr = hdr; }
   void GetDBProperties(st_DBProperties &st_dbp);
+  // Approximate memory used by the open database, see MemoryStats.h
+  void GetMemoryStats(st_MemoryStats &stats) const;
   void SetHeaderUserFields(st_DBProperties &st_dbp);
 
   StringX &GetDBPreferences() {return m_hdr.m_prefString;}
@@ -439,7 +510,7 @@ public:
 
   // Changed nodes
   void ClearChangedNodes()
-  {m_vnodes_modified.clear();}
+  {m_vnodes_modified.clear(); m_snodes_modified.clear();}
   bool IsNodeModified(StringX &path) const;
 
   void GetRUEList(UUIDList &RUElist)
@@ -467,8 +538,7 @@ public:
                  const bool bAllowReplace = false);
 
   // Empty Groups
-  void SetEmptyGroups(const std::vector<StringX> &vEmptyGroups)
-  {m_vEmptyGroups = vEmptyGroups; SetDBChanged(true);}
+  void SetEmptyGroups(const std::vector<StringX> &vEmptyGroups);
   const std::vector<StringX> &GetEmptyGroups() {return m_vEmptyGroups;}
   bool IsEmptyGroup(const StringX &sxEmptyGroup);
 
@@ -544,11 +614,20 @@ private:
   void EncryptPassword(const unsigned char *plaintext, size_t len,
                        unsigned char *ciphertext) const;
 
-  int MergeDependents(PWScore *pothercore, MultiCommands *pmulticmds,
+  int MergeDependents(PWScore *pothercore, const CGTUIndex &current,
+                      MultiCommands *pmulticmds,
                       uuid_array_t &base_uuid, uuid_array_t &new_base_uuid, 
                       const bool bTitleRenamed, stringT &timeStr, 
                       const CItemData::EntryType et, std::vector<StringX> &vs_added);
 
+  // About to add (or change) item, whose group/title/user is sxEntry:
+  // removes its keyboard shortcut if another of our entries, or one to be
+  // added before it, already has it, saying so in pRpt. mapKBShortcutsAdded
+  // holds the shortcuts of the entries to be added so far.
+  void CheckAddedKBShortcut(CItemData &item, const StringX &sxEntry,
+                            std::map<int32, StringX> &mapKBShortcutsAdded,
+                            const StringX &sxAdded, CReport *pRpt);
+
   StringX m_currfile; // current pw db filespec
 
   unsigned char *m_passkey; // encrypted by session key
@@ -582,6 +661,61 @@ private:
   //  Key = entry's uuid; Value = entry's CItemData
   ItemList m_pwlist;
 
+  // Secondary indices on m_pwlist, used by GetUniqueBase() to resolve
+  // [title], [group:title] and [title:user] base references without
+  // scanning every entry. Kept in step by DoAdd/Delete/ReplaceEntry and
+  // DoRenameGroup; bulk changes (file read, validation...) just
+  // invalidate them and they are rebuilt on next use.
+  TitleIndex m_title_index;
+  PairIndex m_grouptitle_index;
+  PairIndex m_titleuser_index;
+  // The tree of groups, with the empty groups, so a group rename only
+  // touches the entries under it
+  CGroupIndex m_groupindex;
+  bool m_bEntryIndicesValid;
+
+  // Trigram index of the entries' searchable text, for GetSearchCandidates().
+  // Built on first search rather than on load, as most cores (e.g., those
+  // opened for Compare or Merge) are never searched; thereafter maintained
+  // like the indices above.
+  CSearchIndex m_searchindex;
+  bool m_bSearchIndexValid;
+
+  // Index of the entries' URL hosts and title words, for FindTargets().
+  // Built and maintained as the search index.
+  CTargetIndex m_targetindex;
+  bool m_bTargetIndexValid;
+
+  // See GetModificationCount()
+  size_t m_nModifications;
+
+  void BuildEntryIndices();
+  void BuildSearchIndex();
+  void BuildTargetIndex();
+  // All entries, in m_pwlist order, for a CParallelScan
+  void GetEntryPointers(std::vector<const CItemData *> &vpci) const;
+  // Those of pOIL, in its order, or all of them if it's NULL
+  void GetEntryPointers(const OrderedItemList *pOIL,
+                        std::vector<const CItemData *> &vpci) const;
+  // For Compare: returns false if cancelled
+  bool FindAllInOther(PWScore *pothercore, const bool &subgroup_bset,
+                      const PWSMatch::CCompiledMatch &subgroup,
+                      const int &subgroup_object,
+                      std::vector<ItemListIter> &vFound, bool *pbCancel,
+                      const CParallelScan::ProgressFn &progress);
+  void InvalidateEntryIndices()
+  {m_bEntryIndicesValid = false; InvalidateSearchIndex(); InvalidateTargetIndex();}
+  void InvalidateSearchIndex()
+  {m_nModifications++; m_bSearchIndexValid = false; m_searchindex.Clear();}
+  void InvalidateTargetIndex() {m_bTargetIndexValid = false; m_targetindex.Clear();}
+  void UpdateSearchIndex(const CItemData &ci);
+  void UpdateTargetIndex(const CItemData &ci);
+  void AddToEntryIndices(const CItemData &ci);
+  void IndexEntry(const CItemData &ci); // into the title & group indices only
+  void RemoveFromEntryIndices(const CItemData &ci);
+  // Following is private in PWScore, public in CommandInterface:
+  virtual void ReindexEntry(const CItemData &old_ci, const CItemData &new_ci);
+
   // Alias/Shortcut structures
   // Permanent Multimap: since potentially more than one alias/shortcut per base
   //  Key = base uuid; Value = multiple alias/shortcut uuids
@@ -604,11 +738,16 @@ private:
   
   // Changed groups
   std::vector<StringX> m_vnodes_modified;
+  std::set<StringX> m_snodes_modified; // the same, to look up
   // Following are private in PWScore, public in CommandInterface:
   virtual const std::vector<StringX> &GetVnodesModified() const
   {return m_vnodes_modified;}
   virtual void SetVnodesModified(const std::vector<StringX> &mvm)
-  {m_vnodes_modified = mvm;}
+  {
+    m_vnodes_modified = mvm;
+    m_snodes_modified.clear();
+    m_snodes_modified.insert(mvm.begin(), mvm.end());
+  }
   void AddChangedNodes(StringX path);
 
   // EmptyGroups
@@ -635,6 +774,14 @@ private:
   std::vector<Command *> m_vpcommands;
   std::vector<Command *>::iterator m_undo_iter;
   std::vector<Command *>::iterator m_redo_iter;
+  // Each command's GetMemorySize() when it was executed, and their sum.
+  // Undo and Redo change what commands hold, so their current sizes can't
+  // be taken away from the sum.
+  std::vector<size_t> m_vcommand_sizes;
+  size_t m_commands_size;
+  void DeleteCommands(std::vector<Command *>::iterator first,
+                      std::vector<Command *>::iterator last);
+  void TrimCommands(); // enforce PWSprefs::MaxUndoMemoryMiB
 
   static Reporter *m_pReporter; // set as soon as possible to show errors
   static Asker *m_pAsker;
@@ -227,7 +227,8 @@ int PWSfileV3::Close()
 
 int PWSfileV3::CheckPasskey(const StringX &filename,
                             const StringX &passkey, FILE *a_fd,
-                            unsigned char *aPtag, uint32 *tCOST, uint32 *mCOST)
+                            unsigned char *aPtag, uint32 *tCOST, uint32 *mCOST,
+                            const char *tag)
 {
   PWS_LOGIT;
 
@@ -254,7 +255,8 @@ int PWSfileV3::CheckPasskey(const StringX &filename,
     goto err;
   }
 
-  if (memcmp(&hdr.taghdr.tag, V3TAG, sizeof(hdr.taghdr.tag)) != 0) {
+  if (memcmp(&hdr.taghdr.tag, tag != NULL ? tag : V3TAG,
+             sizeof(hdr.taghdr.tag)) != 0) {
     retval = PWScore::NOT_LUMI3_FILE;
     goto err;
   }
@@ -317,6 +319,19 @@ int PWSfileV3::ReadRecord(CItemData &item)
 
 const uint16 VersionNum = 0x030E;
 
+// Argon2 lanes when writing: one per processor
+static uint32 GetNumLanes()
+{
+#ifndef _SC_NPROCESSORS_CONF
+  long nProcs = 1;
+#else
+  long nProcs = sysconf(_SC_NPROCESSORS_CONF);
+#endif
+  if (nProcs < ARGON2_MIN_LANES) nProcs = ARGON2_MIN_LANES;
+  if (nProcs > ARGON2_MAX_LANES) nProcs = ARGON2_MAX_LANES;
+  return uint32(nProcs);
+}
+
 int PWSfileV3::WriteHeader()
 {
   PWS_LOGIT;
@@ -327,14 +342,7 @@ int PWSfileV3::WriteHeader()
   // See formatV3.txt for explanation of what's written here and why
   uint32 NumHashPasses = std::max(m_HashPasses, MIN_HASH_PASSES);
   uint32 NumHashMemKiB = std::max(m_HashMemKiB, MIN_HASH_MEM_KIB);
-#ifndef _SC_NPROCESSORS_CONF
-  long nProcs = 1;
-#else
-  long nProcs = sysconf(_SC_NPROCESSORS_CONF);
-#endif
-  if (nProcs < ARGON2_MIN_LANES) nProcs = ARGON2_MIN_LANES;
-  if (nProcs > ARGON2_MAX_LANES) nProcs = ARGON2_MAX_LANES;
-  uint32 nLanes = nProcs;
+  const uint32 nLanes = GetNumLanes();
 
   memcpy(hdr.taghdr.tag, V3TAG, TAGHDR::V3TAGLEN);
   hdr.taghdr.Argon2Type = V3_ARGON2_D13; // XXX make configurable
@@ -900,3 +908,125 @@ int PWSfileV3::ReadHeader()
   return SUCCESS;
 }
 
+int PWSfileV3::WriteSealed(const StringX &filename, const StringX &passkey,
+                           const char tag[TAGHDR::V3TAGLEN],
+                           uint32 nPasses, uint32 nMemKiB,
+                           const std::vector<unsigned char> &payload)
+{
+  PWS_LOGIT;
+
+  if (passkey.empty())
+    return PWScore::WRONG_PASSWORD;
+
+  // As WriteHeader
+  PTHDR hdr;
+  unsigned char Ptag[ARGON2_TAGLEN];
+  uint8_t nonce[crypto_aead_chacha20poly1305_NPUBBYTES];
+  uint8_t key[crypto_aead_chacha20poly1305_KEYBYTES];
+  const uint32 nLanes = GetNumLanes();
+  nPasses = std::max(nPasses, MIN_HASH_PASSES);
+  nMemKiB = std::max(nMemKiB, MIN_HASH_MEM_KIB);
+
+  memcpy(hdr.taghdr.tag, tag, TAGHDR::V3TAGLEN);
+  hdr.taghdr.Argon2Type = V3_ARGON2_D13;
+  hdr.taghdr.AEAD = V3_AEAD_CHACHA20POLY1305;
+  hdr.taghdr.Hash = V3_HASH_BLAKE2B;
+  PWSrand::GetInstance()->GetRandomData(hdr.salt, sizeof(hdr.salt));
+  putInt32(&hdr.nPasses[0], nPasses);
+  putInt32(&hdr.nMemKiB[0], nMemKiB);
+  putInt32(&hdr.nLanes[0], nLanes);
+
+  if (Argon2HashPass(passkey, &hdr.taghdr, Ptag, sizeof(Ptag),
+                     hdr.salt, sizeof(hdr.salt),
+                     nPasses, nMemKiB, nLanes) != true)
+    return PWScore::ARGON2_FAIL;
+  crypto_generichash_blake2b(hdr.HPtag, sizeof(hdr.HPtag), Ptag,
+                             sizeof(Ptag), NULL, 0);
+  memcpy(nonce, &Ptag[0], sizeof(nonce));
+  memcpy(key, &Ptag[sizeof(nonce)], sizeof(key));
+  trashMemory(Ptag, sizeof(Ptag));
+
+  // As Close
+  int status = SUCCESS;
+  ENCSIZEHDR encsz;
+  unsigned long long ctlen;
+  std::vector<unsigned char> ct(payload.size() + crypto_aead_chacha20poly1305_ABYTES);
+  putInt64(reinterpret_cast<unsigned char *>(&encsz.sz), payload.size());
+  crypto_aead_chacha20poly1305_encrypt(reinterpret_cast<unsigned char *>(&encsz),
+                                       &ctlen, reinterpret_cast<unsigned char *>(&encsz.sz),
+                                       sizeof(encsz.sz), NULL, 0, NULL, nonce, key);
+  nonce[0]++;
+  crypto_aead_chacha20poly1305_encrypt(&ct[0], &ctlen, payload.data(), payload.size(),
+                                       NULL, 0, NULL, nonce, key);
+  trashMemory(key, sizeof(key));
+
+  FILE *fd = pws_os::FOpen(filename.c_str(), _T("wb"));
+  if (fd == NULL)
+    return PWScore::CANT_OPEN_FILE;
+  if (fwrite(&hdr, sizeof(hdr), 1, fd) != 1 ||
+      fwrite(&encsz, sizeof(encsz), 1, fd) != 1 ||
+      fwrite(&ct[0], ct.size(), 1, fd) != 1)
+    status = PWScore::WRITE_FAIL;
+  if (fclose(fd) != 0)
+    status = PWScore::WRITE_FAIL;
+  return status;
+}
+
+int PWSfileV3::ReadSealed(const StringX &filename, const StringX &passkey,
+                          const char tag[TAGHDR::V3TAGLEN],
+                          std::vector<unsigned char> &payload)
+{
+  PWS_LOGIT;
+
+  payload.clear();
+  if (passkey.empty())
+    return PWScore::WRONG_PASSWORD;
+
+  FILE *fd = pws_os::FOpen(filename.c_str(), _T("rb"));
+  if (fd == NULL)
+    return PWScore::CANT_OPEN_FILE;
+
+  unsigned char Ptag[ARGON2_TAGLEN];
+  int status = CheckPasskey(filename, passkey, fd, Ptag, NULL, NULL, tag);
+  if (status != SUCCESS) {
+    trashMemory(Ptag, sizeof(Ptag));
+    fclose(fd);
+    return status;
+  }
+
+  uint8_t nonce[crypto_aead_chacha20poly1305_NPUBBYTES];
+  uint8_t key[crypto_aead_chacha20poly1305_KEYBYTES];
+  memcpy(nonce, &Ptag[0], sizeof(nonce));
+  memcpy(key, &Ptag[sizeof(nonce)], sizeof(key));
+  trashMemory(Ptag, sizeof(Ptag));
+
+  // As ReadHeader
+  ENCSIZEHDR encsz;
+  uint64_t sz64;
+  unsigned long long ptlen;
+  if (fread(&encsz, sizeof(encsz), 1, fd) != 1) {
+    status = PWScore::TRUNCATED_FILE;
+  } else if (crypto_aead_chacha20poly1305_decrypt(reinterpret_cast<unsigned char *>(&sz64),
+               &ptlen, NULL, reinterpret_cast<unsigned char *>(&encsz), sizeof(encsz),
+               NULL, 0, nonce, key) != 0) {
+    status = PWScore::CRYPTO_ERROR;
+  } else {
+    sz64 = getInt64(reinterpret_cast<unsigned char *>(&sz64));
+    std::vector<unsigned char> ct(size_t(sz64) + crypto_aead_chacha20poly1305_ABYTES);
+    nonce[0]++;
+    if (fread(&ct[0], 1, ct.size(), fd) != ct.size()) {
+      status = PWScore::TRUNCATED_FILE;
+    } else {
+      payload.resize(size_t(sz64));
+      if (crypto_aead_chacha20poly1305_decrypt(payload.data(), &ptlen, NULL,
+                                               &ct[0], ct.size(), NULL, 0,
+                                               nonce, key) != 0) {
+        payload.clear();
+        status = PWScore::CRYPTO_ERROR;
+      }
+    }
+  }
+  trashMemory(key, sizeof(key));
+  fclose(fd);
+  return status;
+}
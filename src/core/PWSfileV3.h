@@ -95,7 +95,19 @@ public:
                           const StringX &passkey,
                           FILE *a_fd = NULL,
                           unsigned char *aPtag = NULL, uint32 *nPasses = NULL,
-                          uint32 *nMemKiB = NULL);
+                          uint32 *nMemKiB = NULL,
+                          const char *tag = NULL); // NULL: a database's
+
+  // Files that go with a database but aren't one, such as delta files,
+  // are sealed with its passkey: a header as a database's, but with the
+  // file's own tag, then the payload, encrypted as a database's data.
+  static int WriteSealed(const StringX &filename, const StringX &passkey,
+                         const char tag[TAGHDR::V3TAGLEN],
+                         uint32 nPasses, uint32 nMemKiB,
+                         const std::vector<unsigned char> &payload);
+  static int ReadSealed(const StringX &filename, const StringX &passkey,
+                        const char tag[TAGHDR::V3TAGLEN],
+                        std::vector<unsigned char> &payload);
 
   PWSfileV3(const StringX &filename, RWmode mode, VERSION version);
   ~PWSfileV3();
@@ -165,6 +165,8 @@ const PWSprefs::intPref PWSprefs::m_int_prefs[NumIntPrefs] = {
   {_T("TimedTaskChainDelay"), 100, ptApplication, -1, -1},         // application
   {_T("AutotypeSelectAllKeyCode"), 0, ptApplication, 0, 255},         // application
   {_T("AutotypeSelectAllModMask"), 0, ptApplication, 0, 255},         // application
+  // Undo/redo list size limit, oldest commands dropped first. 0=unlimited
+  {_T("MaxUndoMemoryMiB"), 0, ptApplication, 0, 4096},            // application
 };
 
 const PWSprefs::stringPref PWSprefs::m_string_prefs[NumStringPrefs] = {
@@ -0,0 +1,122 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+// ParallelScan.cpp
+//-----------------------------------------------------------------------------
+
+#include "ParallelScan.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+namespace {
+  // Fewer items than this aren't worth handing to another thread
+  const size_t MIN_CHUNK = 256;
+  // Enough chunks per thread that all finish at about the same time,
+  // however uneven the cost of items
+  const size_t CHUNKS_PER_THREAD = 8;
+};
+
+unsigned int CParallelScan::m_nDefaultThreads = 0;
+
+CParallelScan::CParallelScan(unsigned int nThreads)
+  : m_nThreads(nThreads != 0 ? nThreads : GetDefaultNumThreads())
+{
+}
+
+unsigned int CParallelScan::GetDefaultNumThreads()
+{
+  if (m_nDefaultThreads != 0)
+    return m_nDefaultThreads;
+  const unsigned int n = std::thread::hardware_concurrency();
+  return n != 0 ? n : 1; // 0 if unknown
+}
+
+void CParallelScan::SetDefaultNumThreads(unsigned int nThreads)
+{
+  m_nDefaultThreads = nThreads;
+}
+
+size_t CParallelScan::GetChunkSize(size_t n) const
+{
+  return std::max(n / (m_nThreads * CHUNKS_PER_THREAD) + 1, MIN_CHUNK);
+}
+
+size_t CParallelScan::GetNumChunks(size_t n) const
+{
+  const size_t chunk_size = GetChunkSize(n);
+  return (n + chunk_size - 1) / chunk_size;
+}
+
+bool CParallelScan::Run(size_t n, const ChunkFn &fn, bool *pbCancel,
+                        const ProgressFn &progress) const
+{
+  const size_t chunk_size = GetChunkSize(n);
+  const size_t nchunks = (n + chunk_size - 1) / chunk_size;
+
+  std::atomic<size_t> next_chunk(0), num_done(0);
+  std::atomic<bool> bStop(pbCancel != NULL && *pbCancel);
+  std::exception_ptr eptr;
+  std::mutex eptr_mutex;
+
+  // Only the calling thread looks at *pbCancel and reports progress
+  auto work = [&](bool bCaller) {
+    try {
+      while (!bStop.load(std::memory_order_relaxed)) {
+        const size_t ichunk = next_chunk.fetch_add(1);
+        if (ichunk >= nchunks)
+          break;
+
+        const size_t first = ichunk * chunk_size;
+        const size_t last = std::min(first + chunk_size, n);
+        if (!fn(first, last, ichunk))
+          bStop = true;
+        num_done += last - first;
+
+        if (bCaller) {
+          if (pbCancel != NULL && *pbCancel)
+            bStop = true;
+          else if (progress)
+            progress(num_done.load());
+        }
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(eptr_mutex);
+      if (!eptr)
+        eptr = std::current_exception();
+      bStop = true;
+    }
+  };
+
+  std::vector<std::thread> workers;
+  const size_t nworkers = std::min(size_t(m_nThreads), nchunks);
+  for (size_t i = 1; i < nworkers; i++) {
+    try {
+      workers.push_back(std::thread(work, false));
+    } catch (const std::system_error &) {
+      break; // carry on with the threads we have
+    }
+  }
+
+  work(true);
+
+  for (size_t i = 0; i < workers.size(); i++)
+    workers[i].join();
+
+  if (eptr)
+    std::rethrow_exception(eptr);
+
+  return !bStop;
+}
+//-----------------------------------------------------------------------------
+// Local variables:
+// mode: c++
+// End:
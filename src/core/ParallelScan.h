@@ -0,0 +1,100 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+// ParallelScan.h
+//-----------------------------------------------------------------------------
+
+#ifndef __PARALLELSCAN_H
+#define __PARALLELSCAN_H
+
+#include <functional>
+#include <vector>
+#include <stddef.h>
+
+/*
+* CParallelScan runs a read-only pass over n items (typically database
+* entries, collected into a vector so they can be indexed) on several
+* threads at once.
+*
+* The items are split into consecutive chunks, numbered in index order,
+* which the threads take in turn. Each chunk is scanned by exactly one
+* thread, so a scan that accumulates into a result per chunk and then
+* merges these in chunk order gets exactly what a sequential loop would,
+* however many threads there are - see Scan().
+*
+* The calling thread scans chunks too, and between chunks it checks
+* *pbCancel and calls the progress function, so both can be handled as
+* they would be in a single threaded loop (e.g., PWScore::UpdateWizard()).
+*
+* What a scan may do: read the item it's given, including anything only
+* that item's scan touches, such as an entry's decoded fields (see
+* CItemData::GetDecoded()), as no other thread will touch them meanwhile.
+* Anything shared - other entries, e.g., an alias' base, the core's
+* indices - must not be modified, which includes lazily built caches:
+* either build these beforehand, or leave such items to be handled when
+* the results are merged, back on the calling thread.
+*
+* Small scans (a few chunks' worth) are run on the calling thread alone,
+* without starting any threads.
+*/
+
+class CParallelScan
+{
+public:
+  // Scans [first, last) of chunk number ichunk. Returns false to stop the
+  // scan, e.g., if all that's needed has been found
+  typedef std::function<bool (size_t first, size_t last, size_t ichunk)> ChunkFn;
+  // Called on the calling thread with the number of items scanned so far
+  typedef std::function<void (size_t done)> ProgressFn;
+
+  // nThreads == 0: one per hardware thread (see GetDefaultNumThreads)
+  explicit CParallelScan(unsigned int nThreads = 0);
+
+  unsigned int GetNumThreads() const {return m_nThreads;}
+  static unsigned int GetDefaultNumThreads();
+  // Set the number of threads used by default, 0 to reset to one per
+  // hardware thread
+  static void SetDefaultNumThreads(unsigned int nThreads);
+
+  size_t GetChunkSize(size_t n) const;
+  size_t GetNumChunks(size_t n) const;
+
+  // Returns true if all chunks were scanned, false if stopped or cancelled
+  // (in which case *pbCancel is left set)
+  bool Run(size_t n, const ChunkFn &fn, bool *pbCancel = NULL,
+           const ProgressFn &progress = ProgressFn()) const;
+
+  // Calls visit(i, acc) for each item, where acc is results[ichunk] of
+  // the chunk containing i; visit returns false to stop. results is
+  // resized to one Acc per chunk, to be merged in order by the caller.
+  template<typename Acc, typename Visit>
+  bool Scan(size_t n, std::vector<Acc> &results, Visit visit,
+            bool *pbCancel = NULL,
+            const ProgressFn &progress = ProgressFn()) const
+  {
+    results.clear();
+    results.resize(GetNumChunks(n));
+    return Run(n, [&results, &visit](size_t first, size_t last, size_t ichunk) {
+      Acc &acc = results[ichunk];
+      for (size_t i = first; i < last; i++) {
+        if (!visit(i, acc))
+          return false;
+      }
+      return true;
+    }, pbCancel, progress);
+  }
+
+private:
+  static unsigned int m_nDefaultThreads;
+  unsigned int m_nThreads;
+};
+
+#endif /* __PARALLELSCAN_H */
+//-----------------------------------------------------------------------------
+// Local variables:
+// mode: c++
+// End:
@@ -0,0 +1,1031 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+// PatternMatch.cpp
+//-----------------------------------------------------------------------------
+
+#include "PatternMatch.h"
+#include "FindText.h"
+
+#include <algorithm>
+#include <list>
+#include <map>
+#include <mutex>
+
+using namespace PWSMatch;
+
+namespace {
+  const uint32 MAX_CHAR = 0xffffffff;
+  const int MAX_REPEAT = 1000;        // as RE2
+  const int MAX_DEPTH = 200;          // of nested groups
+  const size_t MAX_NODES = 20000;     // in the NFA
+  const size_t MAX_CLASSES = 256;     // of characters, for a DFA
+  const size_t MAX_DFA_STATES = 4096;
+  const size_t MAX_DFA_CELLS = 256 * 1024; // states * classes
+  const size_t MAX_FOLD_RANGE = 0x800; // non-ASCII characters folded one by one
+  const size_t CACHE_SIZE = 64;       // patterns
+
+  enum {ACCEPT = 1, ACCEPT_AT_END = 2};
+
+  inline bool IsDigit(TCHAR c)
+  {
+    return c >= _T('0') && c <= _T('9');
+  }
+
+  inline int HexValue(TCHAR c)
+  {
+    if (IsDigit(c))
+      return c - _T('0');
+    if (c >= _T('a') && c <= _T('f'))
+      return c - _T('a') + 10;
+    if (c >= _T('A') && c <= _T('F'))
+      return c - _T('A') + 10;
+    return -1;
+  }
+
+  struct CacheKey {
+    StringX sxPattern;
+    int syntax;
+    bool bCase;
+
+    bool operator<(const CacheKey &that) const
+    {
+      if (syntax != that.syntax)
+        return syntax < that.syntax;
+      if (bCase != that.bCase)
+        return bCase < that.bCase;
+      return sxPattern < that.sxPattern;
+    }
+  };
+
+  // Most recently used first
+  typedef std::list<std::pair<CacheKey, std::shared_ptr<const CPattern> > > LRUList;
+
+  struct PatternCache {
+    std::mutex mutex;
+    LRUList lru;
+    std::map<CacheKey, LRUList::iterator> index;
+  };
+
+  PatternCache &GetPatternCache()
+  {
+    static PatternCache cache;
+    return cache;
+  }
+};
+
+//-----------------------------------------------------------------------------
+// Parser: a pattern to a syntax tree, whose character sets are already
+// folded (unless case sensitive)
+
+class CPattern::Parser
+{
+public:
+  enum AstKind {A_CHARS, A_EMPTY, A_CONCAT, A_ALT, A_REPEAT, A_BOL, A_EOL};
+  struct Ast {
+    AstKind kind;
+    int set;               // A_CHARS: index into m_sets
+    std::vector<int> subs; // A_CONCAT, A_ALT; A_REPEAT: the one repeated
+    int min, max;          // A_REPEAT: max < 0 if no limit
+  };
+
+  Parser(const StringX &sxPattern, Syntax syntax, bool bCaseSensitive);
+
+  bool m_bOK;
+  size_t m_errorPos;
+  bool m_bCase;
+  std::vector<Ast> m_ast;
+  std::vector<CharSet> m_sets;
+  int m_root;
+
+private:
+  int ParseAlt(int depth);
+  int ParseConcat(int depth);
+  int ParseRepeat(int depth);
+  int ParseAtom(int depth);
+  bool ParseRepeatCount(int &min, int &max);
+  bool ParseClass(CharSet &set, bool &bNegate);
+  bool ParseClassEscape(CharSet &set, bool &bSingle, uint32 &c);
+  bool ParseHex(uint32 &c);
+  int ParseGlob();
+
+  int NewAst(AstKind kind, int set = -1);
+  int NewChars(CharSet &set, bool bNegate = false);
+  int NewChar(uint32 c);
+  int Error();
+  bool Fail() {Error(); return false;}
+
+  bool AtEnd() const {return m_pos >= m_sx.length();}
+  TCHAR Peek() const {return m_sx[m_pos];}
+
+  static void Add(CharSet &set, uint32 lo, uint32 hi);
+  static void Normalize(CharSet &set);
+  static void Negate(CharSet &set);
+  static void Fold(CharSet &set);
+  static bool AddNamed(CharSet &set, TCHAR c);
+  bool AddPosix(CharSet &set);
+
+  const StringX &m_sx;
+  size_t m_pos;
+};
+
+CPattern::Parser::Parser(const StringX &sxPattern, Syntax syntax,
+                         bool bCaseSensitive)
+  : m_bOK(true), m_errorPos(0), m_bCase(bCaseSensitive), m_root(-1),
+    m_sx(sxPattern), m_pos(0)
+{
+  if (syntax == GLOB) {
+    m_root = ParseGlob();
+    return;
+  }
+
+  static const TCHAR *CASE_INSENSITIVE = _T("(?i)");
+  if (m_sx.compare(0, 4, CASE_INSENSITIVE) == 0) {
+    m_bCase = false;
+    m_pos = 4;
+  }
+  m_root = ParseAlt(0);
+  if (m_bOK && !AtEnd())
+    Error(); // unmatched ')'
+}
+
+int CPattern::Parser::Error()
+{
+  if (m_bOK) {
+    m_bOK = false;
+    m_errorPos = m_pos;
+  }
+  return -1;
+}
+
+int CPattern::Parser::NewAst(AstKind kind, int set)
+{
+  Ast ast;
+  ast.kind = kind;
+  ast.set = set;
+  ast.min = ast.max = 0;
+  m_ast.push_back(ast);
+  return int(m_ast.size() - 1);
+}
+
+// If bNegate, of the characters not in set. It's the folded set that's
+// negated, so that, say, [^a] doesn't match 'A'.
+int CPattern::Parser::NewChars(CharSet &set, bool bNegate)
+{
+  Normalize(set);
+  if (!m_bCase)
+    Fold(set);
+  if (bNegate)
+    Negate(set);
+  m_sets.push_back(set);
+  return NewAst(A_CHARS, int(m_sets.size() - 1));
+}
+
+int CPattern::Parser::NewChar(uint32 c)
+{
+  CharSet set;
+  Add(set, c, c);
+  return NewChars(set);
+}
+
+int CPattern::Parser::ParseAlt(int depth)
+{
+  if (depth > MAX_DEPTH)
+    return Error();
+
+  int first = ParseConcat(depth);
+  if (!m_bOK || AtEnd() || Peek() != _T('|'))
+    return first;
+
+  const int alt = NewAst(A_ALT);
+  m_ast[alt].subs.push_back(first);
+  while (m_bOK && !AtEnd() && Peek() == _T('|')) {
+    m_pos++;
+    const int next = ParseConcat(depth);
+    m_ast[alt].subs.push_back(next);
+  }
+  return alt;
+}
+
+int CPattern::Parser::ParseConcat(int depth)
+{
+  const int concat = NewAst(A_CONCAT);
+  while (m_bOK && !AtEnd() && Peek() != _T('|') && Peek() != _T(')')) {
+    const int next = ParseRepeat(depth);
+    m_ast[concat].subs.push_back(next);
+  }
+  return concat;
+}
+
+int CPattern::Parser::ParseRepeat(int depth)
+{
+  const TCHAR c = Peek();
+  if (c == _T('*') || c == _T('+') || c == _T('?'))
+    return Error(); // nothing to repeat
+
+  const int atom = ParseAtom(depth);
+  bool bRepeated = false;
+  int result = atom;
+  while (m_bOK && !AtEnd()) {
+    int min, max;
+    const size_t start = m_pos;
+    switch (Peek()) {
+      case _T('*'): min = 0; max = -1; m_pos++; break;
+      case _T('+'): min = 1; max = -1; m_pos++; break;
+      case _T('?'): min = 0; max = 1;  m_pos++; break;
+      case _T('{'):
+        if (!ParseRepeatCount(min, max)) {
+          if (!m_bOK)
+            return -1;
+          return result; // a literal '{'
+        }
+        break;
+      default:
+        return result;
+    }
+    if (bRepeated) {
+      m_pos = start;
+      return Error(); // as RE2, no "a**"
+    }
+    bRepeated = true;
+    if (!AtEnd() && Peek() == _T('?'))
+      m_pos++; // non-greedy, all the same here
+
+    const int repeat = NewAst(A_REPEAT);
+    m_ast[repeat].subs.push_back(atom);
+    m_ast[repeat].min = min;
+    m_ast[repeat].max = max;
+    result = repeat;
+  }
+  return result;
+}
+
+// At '{'. Returns false, leaving m_pos, if not a repeat count.
+bool CPattern::Parser::ParseRepeatCount(int &min, int &max)
+{
+  size_t pos = m_pos + 1;
+  int values[2] = {-1, -1};
+  bool bComma = false;
+  for (int i = 0; i < 2; i++) {
+    int value = -1;
+    while (pos < m_sx.length() && IsDigit(m_sx[pos])) {
+      value = (value < 0 ? 0 : value * 10) + (m_sx[pos] - _T('0'));
+      if (value > MAX_REPEAT) {
+        m_pos = pos;
+        Error();
+        return false;
+      }
+      pos++;
+    }
+    values[i] = value;
+    if (i == 0 && pos < m_sx.length() && m_sx[pos] == _T(',')) {
+      bComma = true;
+      pos++;
+    } else
+      break;
+  }
+  if (values[0] < 0 || pos >= m_sx.length() || m_sx[pos] != _T('}'))
+    return false;
+
+  min = values[0];
+  max = bComma ? values[1] : min;
+  if (max >= 0 && max < min) {
+    Error();
+    return false;
+  }
+  m_pos = pos + 1;
+  return true;
+}
+
+int CPattern::Parser::ParseAtom(int depth)
+{
+  const TCHAR c = Peek();
+  m_pos++;
+  switch (c) {
+    case _T('('): {
+      if (!AtEnd() && Peek() == _T('?')) {
+        if (m_pos + 1 < m_sx.length() && m_sx[m_pos + 1] == _T(':'))
+          m_pos += 2;
+        else
+          return Error(); // flags, names... not supported
+      }
+      const int group = ParseAlt(depth + 1);
+      if (!m_bOK)
+        return -1;
+      if (AtEnd())
+        return Error(); // missing ')'
+      m_pos++;
+      return group;
+    }
+    case _T('['): {
+      CharSet set;
+      bool bNegate;
+      if (!ParseClass(set, bNegate))
+        return -1;
+      return NewChars(set, bNegate);
+    }
+    case _T('.'): {
+      CharSet set;
+      Add(set, 0, _T('\n') - 1);
+      Add(set, _T('\n') + 1, MAX_CHAR);
+      return NewChars(set);
+    }
+    case _T('^'):
+      return NewAst(A_BOL);
+    case _T('$'):
+      return NewAst(A_EOL);
+    case _T('\\'): {
+      if (AtEnd())
+        return Error();
+      if (Peek() == _T('A')) {
+        m_pos++;
+        return NewAst(A_BOL);
+      } else if (Peek() == _T('z')) {
+        m_pos++;
+        return NewAst(A_EOL);
+      }
+      CharSet set;
+      bool bSingle;
+      uint32 uc;
+      if (!ParseClassEscape(set, bSingle, uc))
+        return -1;
+      if (bSingle)
+        return NewChar(uc);
+      return NewChars(set);
+    }
+    default:
+      return NewChar(uint32(c));
+  }
+}
+
+// After '['
+bool CPattern::Parser::ParseClass(CharSet &set, bool &bNegate)
+{
+  bNegate = false;
+  if (!AtEnd() && Peek() == _T('^')) {
+    bNegate = true;
+    m_pos++;
+  }
+
+  bool bFirst = true;
+  while (!AtEnd() && (Peek() != _T(']') || bFirst)) {
+    bFirst = false;
+    if (Peek() == _T('[') && m_pos + 1 < m_sx.length() &&
+        m_sx[m_pos + 1] == _T(':')) {
+      if (!AddPosix(set))
+        return false;
+      continue;
+    }
+
+    uint32 lo;
+    if (Peek() == _T('\\')) {
+      m_pos++;
+      bool bSingle;
+      if (AtEnd() || !ParseClassEscape(set, bSingle, lo))
+        return Fail();
+      if (!bSingle)
+        continue;
+    } else
+      lo = uint32(m_sx[m_pos++]);
+
+    uint32 hi = lo;
+    if (m_pos + 1 < m_sx.length() && Peek() == _T('-') &&
+        m_sx[m_pos + 1] != _T(']')) {
+      m_pos++;
+      if (Peek() == _T('\\')) {
+        m_pos++;
+        bool bSingle;
+        CharSet named;
+        if (AtEnd() || !ParseClassEscape(named, bSingle, hi) || !bSingle)
+          return Fail();
+      } else
+        hi = uint32(m_sx[m_pos++]);
+      if (hi < lo)
+        return Fail();
+    }
+    Add(set, lo, hi);
+  }
+  if (AtEnd())
+    return Fail(); // missing ']'
+  m_pos++;
+  return true;
+}
+
+// After '\'. Either a single character, in c, or a named class, added to
+// set.
+bool CPattern::Parser::ParseClassEscape(CharSet &set, bool &bSingle, uint32 &c)
+{
+  const TCHAR e = m_sx[m_pos++];
+  bSingle = true;
+  switch (e) {
+    case _T('t'): c = _T('\t'); return true;
+    case _T('n'): c = _T('\n'); return true;
+    case _T('r'): c = _T('\r'); return true;
+    case _T('f'): c = _T('\f'); return true;
+    case _T('v'): c = _T('\v'); return true;
+    case _T('a'): c = _T('\a'); return true;
+    case _T('x'):
+      return ParseHex(c) || Fail();
+    default:
+      break;
+  }
+  if (AddNamed(set, e)) {
+    bSingle = false;
+    return true;
+  }
+  if ((e >= 0 && e < 0x80) && (IsDigit(e) || (e >= _T('a') && e <= _T('z')) ||
+                               (e >= _T('A') && e <= _T('Z')))) {
+    m_pos--;
+    return Fail(); // unknown escape, e.g., \b or a backreference
+  }
+  c = uint32(e); // punctuation
+  return true;
+}
+
+// After "\x": "HH" or "{H...}"
+bool CPattern::Parser::ParseHex(uint32 &c)
+{
+  c = 0;
+  if (!AtEnd() && Peek() == _T('{')) {
+    m_pos++;
+    int ndigits = 0;
+    for (; !AtEnd() && HexValue(Peek()) >= 0; m_pos++, ndigits++)
+      c = c * 16 + uint32(HexValue(Peek()));
+    if (ndigits == 0 || ndigits > 8 || AtEnd() || Peek() != _T('}'))
+      return false;
+    m_pos++;
+    return true;
+  }
+  for (int i = 0; i < 2; i++, m_pos++) {
+    if (AtEnd() || HexValue(Peek()) < 0)
+      return false;
+    c = c * 16 + uint32(HexValue(Peek()));
+  }
+  return true;
+}
+
+// \d \w \s and their negations
+bool CPattern::Parser::AddNamed(CharSet &set, TCHAR c)
+{
+  CharSet named;
+  switch (c) {
+    case _T('d'): case _T('D'):
+      Add(named, _T('0'), _T('9'));
+      break;
+    case _T('w'): case _T('W'):
+      Add(named, _T('0'), _T('9'));
+      Add(named, _T('A'), _T('Z'));
+      Add(named, _T('_'), _T('_'));
+      Add(named, _T('a'), _T('z'));
+      break;
+    case _T('s'): case _T('S'):
+      Add(named, _T('\t'), _T('\n'));
+      Add(named, _T('\f'), _T('\r'));
+      Add(named, _T(' '), _T(' '));
+      break;
+    default:
+      return false;
+  }
+  if (c == _T('D') || c == _T('W') || c == _T('S'))
+    Negate(named);
+  set.insert(set.end(), named.begin(), named.end());
+  return true;
+}
+
+// At "[:", e.g., "[:alpha:]"
+bool CPattern::Parser::AddPosix(CharSet &set)
+{
+  static const struct {
+    const TCHAR *name;
+    uint32 ranges[4][2];
+  } classes[] = {
+    {_T("alnum"),  {{'0', '9'}, {'A', 'Z'}, {'a', 'z'}, {1, 0}}},
+    {_T("alpha"),  {{'A', 'Z'}, {'a', 'z'}, {1, 0}, {1, 0}}},
+    {_T("digit"),  {{'0', '9'}, {1, 0}, {1, 0}, {1, 0}}},
+    {_T("lower"),  {{'a', 'z'}, {1, 0}, {1, 0}, {1, 0}}},
+    {_T("upper"),  {{'A', 'Z'}, {1, 0}, {1, 0}, {1, 0}}},
+    {_T("space"),  {{'\t', '\r'}, {' ', ' '}, {1, 0}, {1, 0}}},
+    {_T("xdigit"), {{'0', '9'}, {'A', 'F'}, {'a', 'f'}, {1, 0}}},
+    {_T("punct"),  {{'!', '/'}, {':', '@'}, {'[', '`'}, {'{', '~'}}},
+  };
+
+  const size_t end = m_sx.find(_T(":]"), m_pos + 2);
+  if (end == StringX::npos)
+    return Fail();
+  const StringX sxName = m_sx.substr(m_pos + 2, end - m_pos - 2);
+  for (size_t i = 0; i < sizeof(classes) / sizeof(classes[0]); i++) {
+    if (sxName == classes[i].name) {
+      for (int j = 0; j < 4; j++) {
+        if (classes[i].ranges[j][0] <= classes[i].ranges[j][1])
+          Add(set, classes[i].ranges[j][0], classes[i].ranges[j][1]);
+      }
+      m_pos = end + 2;
+      return true;
+    }
+  }
+  return Fail();
+}
+
+// A whole text match of '*', '?', "[...]" and literals
+int CPattern::Parser::ParseGlob()
+{
+  const int concat = NewAst(A_CONCAT);
+  const int bol = NewAst(A_BOL);
+  m_ast[concat].subs.push_back(bol);
+  CharSet any;
+  Add(any, 0, MAX_CHAR);
+
+  while (m_bOK && !AtEnd()) {
+    const TCHAR c = m_sx[m_pos++];
+    int next;
+    switch (c) {
+      case _T('*'): {
+        while (!AtEnd() && Peek() == _T('*'))
+          m_pos++;
+        const int repeat = NewAst(A_REPEAT);
+        const int chars = NewChars(any);
+        m_ast[repeat].subs.push_back(chars);
+        m_ast[repeat].min = 0;
+        m_ast[repeat].max = -1;
+        next = repeat;
+        break;
+      }
+      case _T('?'):
+        next = NewChars(any);
+        break;
+      case _T('['): {
+        CharSet set;
+        bool bNegate = false;
+        if (!AtEnd() && (Peek() == _T('!') || Peek() == _T('^'))) {
+          bNegate = true;
+          m_pos++;
+        }
+        bool bFirst = true;
+        while (!AtEnd() && (Peek() != _T(']') || bFirst)) {
+          bFirst = false;
+          if (Peek() == _T('\\'))
+            m_pos++;
+          if (AtEnd())
+            break;
+          const uint32 lo = uint32(m_sx[m_pos++]);
+          uint32 hi = lo;
+          if (m_pos + 1 < m_sx.length() && Peek() == _T('-') &&
+              m_sx[m_pos + 1] != _T(']')) {
+            m_pos++;
+            if (Peek() == _T('\\') && m_pos + 1 < m_sx.length())
+              m_pos++;
+            hi = uint32(m_sx[m_pos++]);
+            if (hi < lo)
+              return Error();
+          }
+          Add(set, lo, hi);
+        }
+        if (AtEnd())
+          return Error(); // missing ']'
+        m_pos++;
+        next = NewChars(set, bNegate);
+        break;
+      }
+      case _T('\\'):
+        if (AtEnd())
+          return Error();
+        next = NewChar(uint32(m_sx[m_pos++]));
+        break;
+      default:
+        next = NewChar(uint32(c));
+    }
+    m_ast[concat].subs.push_back(next);
+  }
+  const int eol = NewAst(A_EOL);
+  m_ast[concat].subs.push_back(eol);
+  return concat;
+}
+
+void CPattern::Parser::Add(CharSet &set, uint32 lo, uint32 hi)
+{
+  const Range range = {lo, hi};
+  set.push_back(range);
+}
+
+void CPattern::Parser::Normalize(CharSet &set)
+{
+  std::sort(set.begin(), set.end(),
+            [](const Range &a, const Range &b) {return a.lo < b.lo;});
+  size_t n = 0;
+  for (size_t i = 0; i < set.size(); i++) {
+    if (n != 0 && (set[n - 1].hi == MAX_CHAR || set[i].lo <= set[n - 1].hi + 1))
+      set[n - 1].hi = std::max(set[n - 1].hi, set[i].hi);
+    else
+      set[n++] = set[i];
+  }
+  set.resize(n);
+}
+
+// Of a normalized set
+void CPattern::Parser::Negate(CharSet &set)
+{
+  Normalize(set);
+  CharSet negated;
+  uint32 next = 0;
+  bool bDone = false;
+  for (size_t i = 0; i < set.size(); i++) {
+    if (set[i].lo > next)
+      Add(negated, next, set[i].lo - 1);
+    if (set[i].hi == MAX_CHAR) {
+      bDone = true;
+      break;
+    }
+    next = set[i].hi + 1;
+  }
+  if (!bDone)
+    Add(negated, next, MAX_CHAR);
+  set.swap(negated);
+}
+
+// Adds the folded form of each character. Folding non-ASCII characters
+// means looking at each one, so isn't done for the biggest ranges, e.g.,
+// those of "." or [^...], which hold most characters anyway.
+void CPattern::Parser::Fold(CharSet &set)
+{
+  const size_t n = set.size();
+  for (size_t i = 0; i < n; i++) {
+    const uint32 lo = set[i].lo, hi = set[i].hi;
+    const uint32 upper_lo = std::max(lo, uint32('A'));
+    const uint32 upper_hi = std::min(hi, uint32('Z'));
+    if (upper_lo <= upper_hi)
+      Add(set, upper_lo + ('a' - 'A'), upper_hi + ('a' - 'A'));
+
+    const uint32 other_lo = std::max(lo, uint32(0x80));
+    if (hi >= other_lo && hi - other_lo < MAX_FOLD_RANGE && hi <= 0x10ffff) {
+      for (uint32 c = other_lo; c <= hi; c++) {
+        const uint32 folded = uint32(FoldCase(TCHAR(c)));
+        if (folded != c)
+          Add(set, folded, folded);
+      }
+    }
+  }
+  Normalize(set);
+}
+
+//-----------------------------------------------------------------------------
+
+CPattern::CPattern(const StringX &sxPattern, Syntax syntax, bool bCaseSensitive)
+  : m_bValid(false), m_errorPos(0), m_bCase(bCaseSensitive), m_start(-1),
+    m_startState(0), m_bEmptyMatch(false)
+{
+  const Parser parser(sxPattern, syntax, bCaseSensitive);
+  if (!parser.m_bOK) {
+    m_errorPos = parser.m_errorPos;
+    return;
+  }
+  m_bCase = parser.m_bCase;
+  m_sets = parser.m_sets;
+
+  const int match = NewNode(N_MATCH, -1);
+  m_start = Emit(parser, parser.m_root, match);
+  if (m_nodes.size() > MAX_NODES) {
+    // Too big, e.g., "(a{1000}){1000}"
+    m_nodes.clear();
+    m_errorPos = sxPattern.length();
+    return;
+  }
+  m_bValid = true;
+
+  std::vector<int> mark(m_nodes.size(), 0);
+  StateSet states;
+  AddNode(states, mark, 1, m_start, true, true);
+  for (size_t i = 0; i < states.size(); i++) {
+    if (m_nodes[states[i]].op == N_MATCH)
+      m_bEmptyMatch = true;
+  }
+
+  BuildDFA();
+}
+
+int CPattern::NewNode(NodeOp op, int out, int out1, int set)
+{
+  const Node node = {op, out, out1, set};
+  m_nodes.push_back(node);
+  return int(m_nodes.size() - 1);
+}
+
+// Thompson's construction, backwards: returns the start of ast's NFA,
+// which continues to next
+int CPattern::Emit(const Parser &parser, int ast, int next)
+{
+  if (m_nodes.size() > MAX_NODES)
+    return next; // given up
+  const Parser::Ast &node = parser.m_ast[ast];
+  switch (node.kind) {
+    case Parser::A_CHARS:
+      return NewNode(N_CHARS, next, -1, node.set);
+    case Parser::A_EMPTY:
+      return next;
+    case Parser::A_BOL:
+      return NewNode(N_BOL, next);
+    case Parser::A_EOL:
+      return NewNode(N_EOL, next);
+    case Parser::A_CONCAT:
+      for (size_t i = node.subs.size(); i > 0; i--)
+        next = Emit(parser, node.subs[i - 1], next);
+      return next;
+    case Parser::A_ALT: {
+      int start = Emit(parser, node.subs.back(), next);
+      for (size_t i = node.subs.size() - 1; i > 0; i--)
+        start = NewNode(N_SPLIT, Emit(parser, node.subs[i - 1], next), start);
+      return start;
+    }
+    case Parser::A_REPEAT: {
+      const int sub = node.subs[0];
+      int start = next;
+      if (node.max < 0) {
+        // Loop back to a split between another one and what's next
+        const int split = NewNode(N_SPLIT, -1, next);
+        m_nodes[split].out = Emit(parser, sub, split);
+        start = split;
+      } else {
+        // Optional ones, each within the previous
+        for (int i = node.min; i < node.max; i++)
+          start = NewNode(N_SPLIT, Emit(parser, sub, start), next);
+      }
+      for (int i = 0; i < node.min; i++)
+        start = Emit(parser, sub, start);
+      return start;
+    }
+    default:
+      ASSERT(0);
+      return next;
+  }
+}
+
+// Adds node, and those reachable from it without reading a character, to
+// states. Only nodes that read a character, or that match, or "$" nodes
+// if not bEOL, are kept. mark[n] == gen for nodes already seen.
+void CPattern::AddNode(StateSet &states, std::vector<int> &mark, int gen,
+                       int node, bool bBOL, bool bEOL) const
+{
+  std::vector<int> stack(1, node);
+  while (!stack.empty()) {
+    const int n = stack.back();
+    stack.pop_back();
+    if (mark[n] == gen)
+      continue;
+    mark[n] = gen;
+    const Node &nd = m_nodes[n];
+    switch (nd.op) {
+      case N_CHARS:
+      case N_MATCH:
+        states.push_back(n);
+        break;
+      case N_SPLIT:
+        stack.push_back(nd.out1);
+        stack.push_back(nd.out);
+        break;
+      case N_EMPTY:
+        stack.push_back(nd.out);
+        break;
+      case N_BOL:
+        if (bBOL)
+          stack.push_back(nd.out);
+        break;
+      case N_EOL:
+        if (bEOL)
+          stack.push_back(nd.out);
+        else
+          states.push_back(n);
+        break;
+    }
+  }
+}
+
+// The states after reading c: as a regular expression may match anywhere,
+// also those at the start of a match starting after c
+void CPattern::Step(const StateSet &from, uint32 c, StateSet &to,
+                    std::vector<int> &mark, int &gen) const
+{
+  gen++;
+  to.clear();
+  for (size_t i = 0; i < from.size(); i++) {
+    const Node &nd = m_nodes[from[i]];
+    if (nd.op == N_CHARS && InSet(nd.set, c))
+      AddNode(to, mark, gen, nd.out, false, false);
+  }
+  AddNode(to, mark, gen, m_start, false, false);
+  std::sort(to.begin(), to.end());
+}
+
+bool CPattern::MatchesAtEnd(const StateSet &states, bool bBOL) const
+{
+  std::vector<int> mark(m_nodes.size(), 0);
+  StateSet end;
+  for (size_t i = 0; i < states.size(); i++) {
+    const Node &nd = m_nodes[states[i]];
+    if (nd.op == N_MATCH)
+      return true;
+    if (nd.op == N_EOL)
+      AddNode(end, mark, 1, nd.out, bBOL, true);
+  }
+  for (size_t i = 0; i < end.size(); i++) {
+    if (m_nodes[end[i]].op == N_MATCH)
+      return true;
+  }
+  return false;
+}
+
+bool CPattern::InSet(int set, uint32 c) const
+{
+  const CharSet &cs = m_sets[set];
+  // Last range starting at or before c
+  const CharSet::const_iterator it =
+    std::upper_bound(cs.begin(), cs.end(), c,
+                     [](uint32 v, const Range &r) {return v < r.lo;});
+  return it != cs.begin() && c <= (it - 1)->hi;
+}
+
+inline uint32 CPattern::Fold(TCHAR c) const
+{
+  return uint32(m_bCase ? c : FoldCase(c));
+}
+
+inline int CPattern::GetClass(TCHAR c) const
+{
+  if (c >= 0 && c < 0x80)
+    return m_asciiClass[int(c)];
+  return int(std::upper_bound(m_bounds.begin(), m_bounds.end(), Fold(c)) -
+             m_bounds.begin()) - 1;
+}
+
+// Subset construction, of all states up front (so that matching, maybe by
+// several threads, changes nothing), unless there'd be too many
+void CPattern::BuildDFA()
+{
+  m_bounds.push_back(0);
+  for (size_t i = 0; i < m_sets.size(); i++) {
+    for (size_t j = 0; j < m_sets[i].size(); j++) {
+      m_bounds.push_back(m_sets[i][j].lo);
+      if (m_sets[i][j].hi != MAX_CHAR)
+        m_bounds.push_back(m_sets[i][j].hi + 1);
+    }
+  }
+  std::sort(m_bounds.begin(), m_bounds.end());
+  m_bounds.erase(std::unique(m_bounds.begin(), m_bounds.end()), m_bounds.end());
+  const size_t nclasses = m_bounds.size();
+  if (nclasses > MAX_CLASSES) {
+    m_bounds.clear();
+    return;
+  }
+  for (int c = 0; c < 0x80; c++)
+    m_asciiClass[c] = int(std::upper_bound(m_bounds.begin(), m_bounds.end(),
+                                           Fold(TCHAR(c))) - m_bounds.begin()) - 1;
+
+  std::map<StateSet, int> ids;
+  std::vector<StateSet> states;
+  std::vector<int> mark(m_nodes.size(), 0);
+  int gen = 1;
+
+  // The dead state, then the start
+  states.push_back(StateSet());
+  ids[states[0]] = 0;
+  StateSet start;
+  AddNode(start, mark, gen, m_start, true, false);
+  std::sort(start.begin(), start.end());
+  if (!start.empty()) {
+    ids[start] = 1;
+    states.push_back(start);
+  }
+  m_startState = int(states.size() - 1);
+
+  StateSet to;
+  for (size_t s = 0; s < states.size(); s++) {
+    for (size_t k = 0; k < nclasses; k++) {
+      Step(states[s], m_bounds[k], to, mark, gen);
+      const std::map<StateSet, int>::const_iterator it = ids.find(to);
+      if (it != ids.end()) {
+        m_next.push_back(it->second);
+        continue;
+      }
+      if (states.size() == MAX_DFA_STATES ||
+          (states.size() + 1) * nclasses > MAX_DFA_CELLS) {
+        // Match with the NFA instead
+        m_next.clear();
+        m_accept.clear();
+        m_bounds.clear();
+        return;
+      }
+      const int id = int(states.size());
+      ids[to] = id;
+      states.push_back(to);
+      m_next.push_back(id);
+    }
+
+    unsigned char accept = 0;
+    for (size_t i = 0; i < states[s].size(); i++) {
+      if (m_nodes[states[s][i]].op == N_MATCH)
+        accept |= ACCEPT;
+    }
+    if (MatchesAtEnd(states[s], false))
+      accept |= ACCEPT_AT_END;
+    m_accept.push_back(accept);
+  }
+}
+
+bool CPattern::Matches(const TCHAR *pText, size_t len) const
+{
+  if (!m_bValid)
+    return false;
+  if (len == 0)
+    return m_bEmptyMatch;
+  if (m_next.empty())
+    return SimulateNFA(pText, len);
+
+  const size_t nclasses = m_bounds.size();
+  int s = m_startState;
+  for (size_t i = 0; i < len; i++) {
+    if (m_accept[s] & ACCEPT)
+      return true;
+    s = m_next[s * nclasses + GetClass(pText[i])];
+    if (s == 0)
+      return false; // dead
+  }
+  return m_accept[s] != 0;
+}
+
+bool CPattern::SimulateNFA(const TCHAR *pText, size_t len) const
+{
+  std::vector<int> mark(m_nodes.size(), 0);
+  int gen = 1;
+  StateSet states, next;
+  AddNode(states, mark, gen, m_start, true, false);
+
+  for (size_t i = 0; i < len; i++) {
+    for (size_t j = 0; j < states.size(); j++) {
+      if (m_nodes[states[j]].op == N_MATCH)
+        return true;
+    }
+    Step(states, Fold(pText[i]), next, mark, gen);
+    states.swap(next);
+    if (states.empty())
+      return false;
+  }
+  return MatchesAtEnd(states, false);
+}
+
+//-----------------------------------------------------------------------------
+// The cache
+
+std::shared_ptr<const CPattern> CPattern::Get(const StringX &sxPattern,
+                                              Syntax syntax, bool bCaseSensitive)
+{
+  PatternCache &cache = GetPatternCache();
+  const CacheKey key = {sxPattern, syntax, bCaseSensitive};
+  {
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    const std::map<CacheKey, LRUList::iterator>::iterator it = cache.index.find(key);
+    if (it != cache.index.end()) {
+      cache.lru.splice(cache.lru.begin(), cache.lru, it->second);
+      return it->second->second;
+    }
+  }
+
+  // Compile without holding up other threads
+  std::shared_ptr<const CPattern> pattern =
+    std::make_shared<const CPattern>(sxPattern, syntax, bCaseSensitive);
+
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  const std::map<CacheKey, LRUList::iterator>::iterator it = cache.index.find(key);
+  if (it != cache.index.end()) {
+    // Another thread got there first
+    cache.lru.splice(cache.lru.begin(), cache.lru, it->second);
+    return it->second->second;
+  }
+  cache.lru.push_front(std::make_pair(key, pattern));
+  cache.index[key] = cache.lru.begin();
+  if (cache.lru.size() > CACHE_SIZE) {
+    cache.index.erase(cache.lru.back().first);
+    cache.lru.pop_back();
+  }
+  return pattern;
+}
+
+size_t CPattern::GetCacheSize()
+{
+  PatternCache &cache = GetPatternCache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  return cache.lru.size();
+}
+
+void CPattern::ClearCache()
+{
+  PatternCache &cache = GetPatternCache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  cache.index.clear();
+  cache.lru.clear();
+}
+//-----------------------------------------------------------------------------
+// Local variables:
+// mode: c++
+// End:
@@ -0,0 +1,128 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+#ifndef __PATTERNMATCH_H
+#define __PATTERNMATCH_H
+
+// PatternMatch.h
+//-----------------------------------------------------------------------------
+// Regular expression and glob (wildcard) patterns, for the MR_REGEX and
+// MR_GLOB match rules.
+
+#include "StringX.h"
+#include "os/pws_tchar.h"
+#include "os/typedefs.h"
+
+#include <memory>
+#include <vector>
+
+namespace PWSMatch {
+  /*
+  * CPattern is a regular expression or glob pattern, compiled to a DFA so
+  * that matching looks at each character of the text once, without
+  * backtracking or allocating.
+  *
+  * Regular expressions use RE2's syntax, less what a DFA can't do
+  * (backreferences, \b...): literals, ".", classes ("[a-z]", "[^0-9]",
+  * \d \w \s and their negations), "^" & "$" (or \A & \z), groups
+  * ("(...)", "(?:...)"), alternation and the *, +, ?, {n}, {n,} & {n,m}
+  * repeats (a trailing "?", for non-greedy, is allowed and has no
+  * effect). "(?i)" at the start makes the pattern case insensitive.
+  * A regular expression matches a text if found anywhere in it; use
+  * "^...$" for the whole text.
+  *
+  * A glob pattern matches the whole text: "*" is any number of
+  * characters, "?" any one, "[...]" one of a class ("[!...]" or "[^...]"
+  * one not in it), and "\" makes the next character a literal.
+  *
+  * Unless case sensitive, case is ignored as by FoldCase(). A pattern
+  * that doesn't compile matches nothing: see IsValid(). Patterns whose
+  * DFA would be too big are matched by simulating the NFA instead.
+  *
+  * Compiling is far dearer than matching, so patterns should be got from
+  * the cache of recently used ones with Get(), which is shared by all
+  * threads. A CPattern is never changed once compiled, so may be used by
+  * several threads at once.
+  */
+  class CPattern
+  {
+  public:
+    enum Syntax {REGEX, GLOB};
+
+    CPattern(const StringX &sxPattern, Syntax syntax, bool bCaseSensitive);
+
+    bool IsValid() const {return m_bValid;}
+    // If not valid, where in the pattern the error was found
+    size_t GetErrorPos() const {return m_errorPos;}
+    bool HasDFA() const {return !m_next.empty();}
+
+    bool Matches(const TCHAR *pText, size_t len) const;
+    bool Matches(const StringX &sxText) const
+    {return Matches(sxText.data(), sxText.length());}
+
+    // The compiled pattern, from the cache if there
+    static std::shared_ptr<const CPattern> Get(const StringX &sxPattern,
+                                               Syntax syntax,
+                                               bool bCaseSensitive);
+    static size_t GetCacheSize();
+    static void ClearCache();
+
+  private:
+    struct Range {
+      uint32 lo, hi;
+    };
+    typedef std::vector<Range> CharSet; // sorted, not overlapping
+
+    enum NodeOp {N_CHARS, N_SPLIT, N_EMPTY, N_BOL, N_EOL, N_MATCH};
+    struct Node {
+      NodeOp op;
+      int out, out1; // next node(s): N_SPLIT uses both
+      int set;       // N_CHARS: index into m_sets
+    };
+    typedef std::vector<int> StateSet; // sorted NFA node numbers
+
+    class Parser;
+
+    int Emit(const Parser &parser, int ast, int next);
+    int NewNode(NodeOp op, int out, int out1 = -1, int set = -1);
+    void BuildDFA();
+    void AddNode(StateSet &states, std::vector<int> &mark, int gen,
+                 int node, bool bBOL, bool bEOL) const;
+    void Step(const StateSet &from, uint32 c, StateSet &to,
+              std::vector<int> &mark, int &gen) const;
+    bool MatchesAtEnd(const StateSet &states, bool bBOL) const;
+    bool InSet(int set, uint32 c) const;
+    uint32 Fold(TCHAR c) const;
+    int GetClass(TCHAR c) const;
+    bool SimulateNFA(const TCHAR *pText, size_t len) const;
+
+    bool m_bValid;
+    size_t m_errorPos;
+    bool m_bCase;
+
+    // The NFA
+    std::vector<Node> m_nodes;
+    std::vector<CharSet> m_sets;
+    int m_start;
+
+    // The DFA, if not too big: the characters are divided into classes
+    // that no character set tells apart, m_bounds holding where each
+    // class starts. State 0 is the dead state.
+    std::vector<uint32> m_bounds;
+    int m_asciiClass[128];  // (ASCII characters folded, unless m_bCase)
+    std::vector<int> m_next; // [state * number of classes + class]
+    std::vector<unsigned char> m_accept; // per state, ACCEPT_* bits
+    int m_startState;
+    bool m_bEmptyMatch; // the empty text matches
+  };
+}
+
+#endif /* __PATTERNMATCH_H */
+//-----------------------------------------------------------------------------
+// Local variables:
+// mode: c++
+// End:
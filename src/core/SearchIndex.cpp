@@ -0,0 +1,194 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+// SearchIndex.cpp
+//-----------------------------------------------------------------------------
+
+#include "SearchIndex.h"
+#include "FindText.h"
+#include "os/debug.h"
+#include "os/pws_tchar.h"
+
+#include <algorithm>
+#include <iterator>
+
+using pws_os::CUUID;
+
+namespace {
+  // Three 21-bit characters (enough for any Unicode code point) per trigram
+  const unsigned int CHAR_BITS = 21;
+  const uint64 CHAR_MASK = (uint64(1) << CHAR_BITS) - 1;
+  const uint64 TRIGRAM_MASK = (uint64(1) << (3 * CHAR_BITS)) - 1;
+
+  // Folded as case insensitive searches do
+  inline uint64 FoldChar(TCHAR c)
+  {
+    return uint64(PWSMatch::FoldCase(c)) & CHAR_MASK;
+  }
+};
+
+void CSearchIndex::Clear()
+{
+  m_postings.clear();
+  m_docids.clear();
+  m_uuids.clear();
+  m_doc_trigrams.clear();
+  m_free_docids.clear();
+}
+
+void CSearchIndex::AddTrigrams(const StringX &sxText, TrigramVector &vtrigrams)
+{
+  const size_t len = sxText.length();
+  if (len < 3)
+    return;
+
+  Trigram t = (FoldChar(sxText[0]) << CHAR_BITS) | FoldChar(sxText[1]);
+  for (size_t i = 2; i < len; i++) {
+    t = ((t << CHAR_BITS) | FoldChar(sxText[i])) & TRIGRAM_MASK;
+    vtrigrams.push_back(t);
+  }
+}
+
+void CSearchIndex::GetTrigrams(const StringX &sxText, TrigramVector &vtrigrams)
+{
+  vtrigrams.clear();
+  AddTrigrams(sxText, vtrigrams);
+  std::sort(vtrigrams.begin(), vtrigrams.end());
+  vtrigrams.erase(std::unique(vtrigrams.begin(), vtrigrams.end()), vtrigrams.end());
+}
+
+void CSearchIndex::Add(const CUUID &uuid, const std::vector<StringX> &vtext)
+{
+  Remove(uuid);
+
+  TrigramVector vtrigrams;
+  std::vector<StringX>::const_iterator text_iter;
+  for (text_iter = vtext.begin(); text_iter != vtext.end(); text_iter++) {
+    AddTrigrams(*text_iter, vtrigrams);
+  }
+  std::sort(vtrigrams.begin(), vtrigrams.end());
+  vtrigrams.erase(std::unique(vtrigrams.begin(), vtrigrams.end()), vtrigrams.end());
+
+  DocID id;
+  if (!m_free_docids.empty()) {
+    id = m_free_docids.back();
+    m_free_docids.pop_back();
+    m_uuids[id] = uuid;
+  } else {
+    id = DocID(m_uuids.size());
+    m_uuids.push_back(uuid);
+    m_doc_trigrams.push_back(TrigramVector());
+  }
+  m_docids.insert(std::make_pair(uuid, id));
+
+  TrigramVector::const_iterator iter;
+  for (iter = vtrigrams.begin(); iter != vtrigrams.end(); iter++) {
+    PostingList &postings = m_postings[*iter];
+    // Appending is the common case when building from scratch
+    if (postings.empty() || postings.back() < id)
+      postings.push_back(id);
+    else
+      postings.insert(std::lower_bound(postings.begin(), postings.end(), id), id);
+  }
+  m_doc_trigrams[id].swap(vtrigrams);
+}
+
+void CSearchIndex::Remove(const CUUID &uuid)
+{
+  std::map<CUUID, DocID>::iterator doc_iter = m_docids.find(uuid);
+  if (doc_iter == m_docids.end())
+    return;
+
+  const DocID id = doc_iter->second;
+  m_docids.erase(doc_iter);
+
+  TrigramVector::const_iterator iter;
+  for (iter = m_doc_trigrams[id].begin(); iter != m_doc_trigrams[id].end(); iter++) {
+    PostingMap::iterator pm_iter = m_postings.find(*iter);
+    ASSERT(pm_iter != m_postings.end());
+    if (pm_iter == m_postings.end())
+      continue;
+
+    PostingList &postings = pm_iter->second;
+    PostingList::iterator pl_iter = std::lower_bound(postings.begin(), postings.end(), id);
+    ASSERT(pl_iter != postings.end() && *pl_iter == id);
+    if (pl_iter != postings.end() && *pl_iter == id)
+      postings.erase(pl_iter);
+    if (postings.empty())
+      m_postings.erase(pm_iter);
+  }
+
+  TrigramVector().swap(m_doc_trigrams[id]);
+  m_uuids[id] = CUUID::NullUUID();
+  m_free_docids.push_back(id);
+}
+
+struct ShorterPostingList {
+  bool operator()(const std::vector<uint32> *p1, const std::vector<uint32> *p2) const
+  {return p1->size() < p2->size();}
+};
+
+bool CSearchIndex::GetCandidates(const StringX &sxText, UUIDVector &candidates) const
+{
+  candidates.clear();
+
+  TrigramVector vtrigrams;
+  GetTrigrams(sxText, vtrigrams);
+  if (vtrigrams.empty())
+    return false; // too short to use the index
+
+  std::vector<const PostingList *> vpostings;
+  vpostings.reserve(vtrigrams.size());
+  TrigramVector::const_iterator iter;
+  for (iter = vtrigrams.begin(); iter != vtrigrams.end(); iter++) {
+    PostingMap::const_iterator pm_iter = m_postings.find(*iter);
+    if (pm_iter == m_postings.end())
+      return true; // no entry has this trigram, so nothing can match
+    vpostings.push_back(&pm_iter->second);
+  }
+
+  // Intersect starting with the shortest lists, to keep the result small
+  std::sort(vpostings.begin(), vpostings.end(), ShorterPostingList());
+  PostingList result(*vpostings[0]);
+  for (size_t i = 1; i < vpostings.size() && !result.empty(); i++) {
+    PostingList intersection;
+    std::set_intersection(result.begin(), result.end(),
+                          vpostings[i]->begin(), vpostings[i]->end(),
+                          std::back_inserter(intersection));
+    result.swap(intersection);
+  }
+
+  candidates.reserve(result.size());
+  PostingList::const_iterator pl_iter;
+  for (pl_iter = result.begin(); pl_iter != result.end(); pl_iter++) {
+    candidates.push_back(m_uuids[*pl_iter]);
+  }
+  return true;
+}
+
+void CSearchIndex::GetMemoryUsage(st_MemoryUsage &usage) const
+{
+  PostingMap::const_iterator pm_iter;
+  for (pm_iter = m_postings.begin(); pm_iter != m_postings.end(); pm_iter++) {
+    usage.Add(MAP_NODE_OVERHEAD + sizeof(PostingMap::value_type) +
+              pm_iter->second.capacity() * sizeof(DocID), 2);
+  }
+  usage.Add(m_docids.size() * (MAP_NODE_OVERHEAD + sizeof(std::pair<CUUID, DocID>)),
+            m_docids.size());
+  usage.Add(m_uuids.capacity() * sizeof(CUUID));
+  usage.Add(m_doc_trigrams.capacity() * sizeof(TrigramVector));
+  std::vector<TrigramVector>::const_iterator dt_iter;
+  for (dt_iter = m_doc_trigrams.begin(); dt_iter != m_doc_trigrams.end(); dt_iter++) {
+    if (dt_iter->capacity() != 0)
+      usage.Add(dt_iter->capacity() * sizeof(Trigram));
+  }
+  usage.Add(m_free_docids.capacity() * sizeof(DocID));
+}
+//-----------------------------------------------------------------------------
+// Local variables:
+// mode: c++
+// End:
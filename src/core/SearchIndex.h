@@ -0,0 +1,83 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+// SearchIndex.h
+//-----------------------------------------------------------------------------
+
+#ifndef __SEARCHINDEX_H
+#define __SEARCHINDEX_H
+
+#include "StringX.h"
+#include "MemoryStats.h"
+#include "os/UUID.h"
+#include "os/typedefs.h"
+
+#include <map>
+#include <vector>
+
+/*
+* CSearchIndex is an inverted index from trigrams (runs of three
+* characters) to the entries whose text contains them, used to speed up
+* substring searches over the whole database.
+*
+* Text is case-folded when indexed, and each string (field) is split
+* separately, so no trigram spans two fields. A string containing the
+* search text, ignoring case, contains all of the search text's trigrams,
+* so the entries in the intersection of their posting lists are a superset
+* of the matches: callers still have to check each candidate, but only the
+* candidates.
+*
+* Search text shorter than a trigram can't be narrowed down this way,
+* in which case GetCandidates() returns false and all entries have to be
+* checked.
+*/
+
+class CSearchIndex
+{
+public:
+  CSearchIndex() {}
+  ~CSearchIndex() {Clear();}
+
+  void Clear();
+  // Replaces any existing text of the entry
+  void Add(const pws_os::CUUID &uuid, const std::vector<StringX> &vtext);
+  void Remove(const pws_os::CUUID &uuid);
+  bool IsIndexed(const pws_os::CUUID &uuid) const
+  {return m_docids.find(uuid) != m_docids.end();}
+  size_t GetNumEntries() const {return m_docids.size();}
+
+  bool GetCandidates(const StringX &sxText, UUIDVector &candidates) const;
+
+  void GetMemoryUsage(st_MemoryUsage &usage) const;
+
+private:
+  CSearchIndex(const CSearchIndex &); // Do not implement
+  CSearchIndex &operator=(const CSearchIndex &); // Do not implement
+
+  typedef uint64 Trigram;
+  typedef uint32 DocID;
+  typedef std::vector<Trigram> TrigramVector;
+  typedef std::vector<DocID> PostingList; // sorted
+  typedef std::map<Trigram, PostingList> PostingMap;
+
+  static void GetTrigrams(const StringX &sxText, TrigramVector &vtrigrams);
+  static void AddTrigrams(const StringX &sxText, TrigramVector &vtrigrams);
+
+  PostingMap m_postings;
+  std::map<pws_os::CUUID, DocID> m_docids;
+  // Indexed by DocID: owning entry (NullUUID if free) and its trigrams,
+  // needed to find its postings on removal
+  std::vector<pws_os::CUUID> m_uuids;
+  std::vector<TrigramVector> m_doc_trigrams;
+  std::vector<DocID> m_free_docids;
+};
+
+#endif /* __SEARCHINDEX_H */
+//-----------------------------------------------------------------------------
+// Local variables:
+// mode: c++
+// End:
@@ -0,0 +1,415 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+// TargetIndex.cpp
+//-----------------------------------------------------------------------------
+
+#include "TargetIndex.h"
+#include "FindText.h"
+#include "os/debug.h"
+#include "os/pws_tchar.h"
+
+#include <algorithm>
+#include <cmath>
+
+using pws_os::CUUID;
+
+namespace {
+  // Letters and digits, as far as telling words apart in titles goes: the
+  // C library's classification of non-ASCII characters depends on the
+  // locale, so those are taken as letters unless punctuation or spaces
+  // commonly found in window titles
+  inline bool IsWordChar(TCHAR c)
+  {
+    if (c < 0x80)
+      return (c >= _T('0') && c <= _T('9')) || (c >= _T('a') && c <= _T('z')) ||
+        (c >= _T('A') && c <= _T('Z'));
+    return !(c <= 0xbf || c == 0xd7 || c == 0xf7 ||
+             (c >= 0x2000 && c <= 0x2bff) || (c >= 0x3000 && c <= 0x303f) ||
+             (c >= 0xfe30 && c <= 0xfe4f) || (c >= 0xff00 && c <= 0xff0f));
+  }
+
+  inline bool IsHostChar(TCHAR c)
+  {
+    return (c >= _T('0') && c <= _T('9')) || (c >= _T('a') && c <= _T('z')) ||
+      c == _T('-') || c == _T('.') || c == _T('_') || c >= 0x80;
+  }
+
+  inline bool IsSpace(TCHAR c)
+  {
+    return c == _T(' ') || (c >= _T('\t') && c <= _T('\r'));
+  }
+
+  // Second level labels under which a country code domain's registrable
+  // domains are, as in "example.co.uk"
+  bool IsSecondLevelSuffix(const StringX &sxLabel)
+  {
+    static const TCHAR *suffixes[] = {
+      _T("ac"), _T("co"), _T("com"), _T("edu"), _T("go"), _T("gob"),
+      _T("gov"), _T("ltd"), _T("mil"), _T("ne"), _T("net"), _T("nic"),
+      _T("or"), _T("org"), _T("plc"), _T("sch"),
+    };
+    for (size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); i++) {
+      if (sxLabel == suffixes[i])
+        return true;
+    }
+    return false;
+  }
+
+  // An entry found by FindBest()
+  struct Hit {
+    Hit(const CUUID &a_uuid) : uuid(a_uuid), tier(0), score(0) {}
+    CUUID uuid;
+    int tier; // 2 - same host, 1 - same domain, 0 - title words only
+    double score; // of the title words
+  };
+
+  struct BetterHit {
+    bool operator()(const Hit &h1, const Hit &h2) const
+    {
+      if (h1.tier != h2.tier)
+        return h1.tier > h2.tier;
+      if (h1.score != h2.score)
+        return h1.score > h2.score;
+      return h1.uuid < h2.uuid;
+    }
+  };
+};
+
+void CTargetIndex::Clear()
+{
+  m_hosts.clear();
+  m_domains.clear();
+  m_words.clear();
+  m_docids.clear();
+  m_docs.clear();
+  m_free_docids.clear();
+}
+
+StringX CTargetIndex::GetHost(const StringX &sxURL)
+{
+  const TCHAR *p = sxURL.data();
+  const TCHAR *end = p + sxURL.length();
+  while (p < end && IsSpace(*p))
+    p++;
+
+  // Autotype/browser prefixes, e.g., "[alt]" or "{ssh}"
+  if (p < end && (*p == _T('[') || *p == _T('{'))) {
+    const TCHAR close = *p == _T('[') ? _T(']') : _T('}');
+    const TCHAR *q = p + 1;
+    while (q < end && ((*q >= _T('a') && *q <= _T('z')) ||
+                       (*q >= _T('A') && *q <= _T('Z'))))
+      q++;
+    if (q < end && q > p + 1 && *q == close)
+      p = q + 1;
+  }
+
+  // Scheme, if any: without one, a host needs a dot, so that plain
+  // words aren't taken for hosts
+  bool bScheme = false;
+  for (const TCHAR *q = p; q + 2 < end && *q != _T('/') && !IsSpace(*q); q++) {
+    if (q[0] == _T(':') && q[1] == _T('/') && q[2] == _T('/')) {
+      p = q + 3;
+      bScheme = true;
+      break;
+    }
+  }
+
+  // The authority, less any user
+  const TCHAR *auth_end = p;
+  while (auth_end < end && *auth_end != _T('/') && *auth_end != _T('?') &&
+         *auth_end != _T('#') && !IsSpace(*auth_end))
+    auth_end++;
+  for (const TCHAR *q = auth_end; q > p; q--) {
+    if (q[-1] == _T('@')) {
+      p = q;
+      break;
+    }
+  }
+
+  StringX sxHost;
+  if (p < auth_end && *p == _T('[')) {
+    // IPv6 address
+    const TCHAR *q = std::find(p, auth_end, _T(']'));
+    if (q == auth_end)
+      return StringX();
+    for (; p <= q; p++)
+      sxHost += PWSMatch::FoldCase(*p);
+    return sxHost;
+  }
+
+  for (; p < auth_end && *p != _T(':'); p++) {
+    const TCHAR c = PWSMatch::FoldCase(*p);
+    if (!IsHostChar(c))
+      return StringX();
+    sxHost += c;
+  }
+
+  while (!sxHost.empty() && sxHost[sxHost.length() - 1] == _T('.'))
+    sxHost.erase(sxHost.length() - 1);
+  if (sxHost.empty() || sxHost[0] == _T('.') ||
+      (!bScheme && sxHost.find(_T('.')) == StringX::npos))
+    return StringX();
+  if (sxHost.compare(0, 4, _T("www.")) == 0 &&
+      sxHost.find(_T('.'), 4) != StringX::npos)
+    sxHost.erase(0, 4);
+  return sxHost;
+}
+
+StringX CTargetIndex::GetDomain(const StringX &sxHost)
+{
+  if (sxHost.empty() || sxHost[0] == _T('['))
+    return sxHost;
+
+  // Split into labels, leaving IP addresses whole
+  std::vector<size_t> dots;
+  bool bNumeric = true;
+  for (size_t i = 0; i < sxHost.length(); i++) {
+    if (sxHost[i] == _T('.'))
+      dots.push_back(i);
+    else if (sxHost[i] < _T('0') || sxHost[i] > _T('9'))
+      bNumeric = false;
+  }
+  if (bNumeric || dots.size() < 2)
+    return sxHost;
+
+  const size_t ndots = dots.size();
+  const size_t tld_len = sxHost.length() - dots[ndots - 1] - 1;
+  const StringX sxSecond(sxHost, dots[ndots - 2] + 1,
+                         dots[ndots - 1] - dots[ndots - 2] - 1);
+  if (tld_len == 2 && IsSecondLevelSuffix(sxSecond))
+    return ndots == 2 ? sxHost : sxHost.substr(dots[ndots - 3] + 1);
+  return sxHost.substr(dots[ndots - 2] + 1);
+}
+
+void CTargetIndex::GetWords(const StringX &sxText, std::vector<StringX> &vwords)
+{
+  vwords.clear();
+  const size_t len = sxText.length();
+  size_t i = 0;
+  while (i < len) {
+    while (i < len && !IsWordChar(sxText[i]))
+      i++;
+    const size_t start = i;
+    while (i < len && IsWordChar(sxText[i]))
+      i++;
+    if (i - start >= 2) {
+      StringX sxWord(sxText, start, i - start);
+      for (size_t j = 0; j < sxWord.length(); j++)
+        sxWord[j] = PWSMatch::FoldCase(sxWord[j]);
+      vwords.push_back(sxWord);
+    }
+  }
+  std::sort(vwords.begin(), vwords.end());
+  vwords.erase(std::unique(vwords.begin(), vwords.end()), vwords.end());
+}
+
+void CTargetIndex::AddPosting(PostingMap &postings, const StringX &sxKey, DocID id)
+{
+  PostingList &pl = postings[sxKey];
+  // Appending is the common case when building from scratch
+  if (pl.empty() || pl.back() < id)
+    pl.push_back(id);
+  else
+    pl.insert(std::lower_bound(pl.begin(), pl.end(), id), id);
+}
+
+void CTargetIndex::RemovePosting(PostingMap &postings, const StringX &sxKey, DocID id)
+{
+  PostingMap::iterator pm_iter = postings.find(sxKey);
+  ASSERT(pm_iter != postings.end());
+  if (pm_iter == postings.end())
+    return;
+
+  PostingList &pl = pm_iter->second;
+  PostingList::iterator pl_iter = std::lower_bound(pl.begin(), pl.end(), id);
+  ASSERT(pl_iter != pl.end() && *pl_iter == id);
+  if (pl_iter != pl.end() && *pl_iter == id)
+    pl.erase(pl_iter);
+  if (pl.empty())
+    postings.erase(pm_iter);
+}
+
+const CTargetIndex::PostingList *CTargetIndex::FindPostings(const PostingMap &postings,
+                                                           const StringX &sxKey)
+{
+  if (sxKey.empty())
+    return NULL;
+  PostingMap::const_iterator pm_iter = postings.find(sxKey);
+  return pm_iter == postings.end() ? NULL : &pm_iter->second;
+}
+
+void CTargetIndex::Add(const CUUID &uuid, const StringX &sxTitle, const StringX &sxURL)
+{
+  Remove(uuid);
+
+  DocID id;
+  if (!m_free_docids.empty()) {
+    id = m_free_docids.back();
+    m_free_docids.pop_back();
+  } else {
+    id = DocID(m_docs.size());
+    m_docs.push_back(Doc());
+  }
+  m_docids.insert(std::make_pair(uuid, id));
+
+  Doc &doc = m_docs[id];
+  doc.uuid = uuid;
+  doc.sxHost = GetHost(sxURL);
+  doc.sxDomain = GetDomain(doc.sxHost);
+  GetWords(sxTitle + _T(' ') + doc.sxDomain.substr(0, doc.sxDomain.find(_T('.'))),
+           doc.vwords);
+
+  if (!doc.sxHost.empty()) {
+    AddPosting(m_hosts, doc.sxHost, id);
+    AddPosting(m_domains, doc.sxDomain, id);
+  }
+  std::vector<StringX>::const_iterator iter;
+  for (iter = doc.vwords.begin(); iter != doc.vwords.end(); iter++)
+    AddPosting(m_words, *iter, id);
+}
+
+void CTargetIndex::Remove(const CUUID &uuid)
+{
+  std::map<CUUID, DocID>::iterator doc_iter = m_docids.find(uuid);
+  if (doc_iter == m_docids.end())
+    return;
+
+  const DocID id = doc_iter->second;
+  m_docids.erase(doc_iter);
+
+  Doc &doc = m_docs[id];
+  if (!doc.sxHost.empty()) {
+    RemovePosting(m_hosts, doc.sxHost, id);
+    RemovePosting(m_domains, doc.sxDomain, id);
+  }
+  std::vector<StringX>::const_iterator iter;
+  for (iter = doc.vwords.begin(); iter != doc.vwords.end(); iter++)
+    RemovePosting(m_words, *iter, id);
+
+  doc = Doc();
+  m_free_docids.push_back(id);
+}
+
+void CTargetIndex::FindBest(const StringX &sxWindowTitle, const StringX &sxURL,
+                            size_t maxResults, UUIDVector &matches) const
+{
+  matches.clear();
+  if (maxResults == 0 || m_docids.empty())
+    return;
+
+  const StringX sxHost = GetHost(sxURL), sxDomain = GetDomain(sxHost);
+  // The page's domain may also be in the entries' titles
+  std::vector<StringX> vwords;
+  GetWords(sxWindowTitle + _T(' ') + sxDomain.substr(0, sxDomain.find(_T('.'))),
+           vwords);
+
+  // The posting lists of the domain and the words, merged in DocID order
+  // below so that each entry found is scored in one go
+  struct Cursor {
+    const PostingList *pl;
+    size_t pos;
+    double weight; // < 0 for the domain's list
+  };
+  std::vector<Cursor> cursors;
+  const PostingList *pl = FindPostings(m_domains, sxDomain);
+  if (pl != NULL) {
+    const Cursor cursor = {pl, 0, -1};
+    cursors.push_back(cursor);
+  }
+  const double ndocs = double(m_docids.size());
+  std::vector<StringX>::const_iterator word_iter;
+  for (word_iter = vwords.begin(); word_iter != vwords.end(); word_iter++) {
+    pl = FindPostings(m_words, *word_iter);
+    if (pl != NULL) {
+      // Rarer words tell more
+      const Cursor cursor = {pl, 0, std::log(1.0 + ndocs / double(pl->size()))};
+      cursors.push_back(cursor);
+    }
+  }
+
+  // The best maxResults so far, as a heap with the worst on top
+  std::vector<Hit> vhits;
+  const BetterHit better;
+  for (;;) {
+    DocID id = 0;
+    bool bFound = false;
+    for (size_t i = 0; i < cursors.size(); i++) {
+      const Cursor &cursor = cursors[i];
+      if (cursor.pos < cursor.pl->size() && (!bFound || (*cursor.pl)[cursor.pos] < id)) {
+        id = (*cursor.pl)[cursor.pos];
+        bFound = true;
+      }
+    }
+    if (!bFound)
+      break;
+
+    const Doc &doc = m_docs[id];
+    Hit hit(doc.uuid);
+    double weight = 0;
+    size_t nwords = 0;
+    for (size_t i = 0; i < cursors.size(); i++) {
+      Cursor &cursor = cursors[i];
+      if (cursor.pos < cursor.pl->size() && (*cursor.pl)[cursor.pos] == id) {
+        if (cursor.weight < 0)
+          hit.tier = doc.sxHost == sxHost ? 2 : 1;
+        else {
+          weight += cursor.weight;
+          nwords++;
+        }
+        cursor.pos++;
+      }
+    }
+    // The more of the entry's words found, the better
+    if (nwords != 0)
+      hit.score = weight * double(nwords) / double(doc.vwords.size());
+    if (vhits.size() < maxResults) {
+      vhits.push_back(hit);
+      std::push_heap(vhits.begin(), vhits.end(), better);
+    } else if (better(hit, vhits.front())) {
+      std::pop_heap(vhits.begin(), vhits.end(), better);
+      vhits.back() = hit;
+      std::push_heap(vhits.begin(), vhits.end(), better);
+    }
+  }
+
+  std::sort_heap(vhits.begin(), vhits.end(), better);
+  matches.reserve(vhits.size());
+  for (size_t i = 0; i < vhits.size(); i++)
+    matches.push_back(vhits[i].uuid);
+}
+
+void CTargetIndex::GetMemoryUsage(st_MemoryUsage &usage) const
+{
+  const PostingMap *maps[] = {&m_hosts, &m_domains, &m_words};
+  for (size_t i = 0; i < sizeof(maps) / sizeof(maps[0]); i++) {
+    PostingMap::const_iterator pm_iter;
+    for (pm_iter = maps[i]->begin(); pm_iter != maps[i]->end(); pm_iter++) {
+      usage.Add(MAP_NODE_OVERHEAD + sizeof(PostingMap::value_type) +
+                pm_iter->second.capacity() * sizeof(DocID), 2);
+      usage.Add(pm_iter->first);
+    }
+  }
+  usage.Add(m_docids.size() * (MAP_NODE_OVERHEAD + sizeof(std::pair<CUUID, DocID>)),
+            m_docids.size());
+  usage.Add(m_docs.capacity() * sizeof(Doc));
+  std::vector<Doc>::const_iterator doc_iter;
+  for (doc_iter = m_docs.begin(); doc_iter != m_docs.end(); doc_iter++) {
+    usage.Add(doc_iter->sxHost);
+    usage.Add(doc_iter->sxDomain);
+    if (doc_iter->vwords.capacity() != 0)
+      usage.Add(doc_iter->vwords.capacity() * sizeof(StringX));
+    std::vector<StringX>::const_iterator iter;
+    for (iter = doc_iter->vwords.begin(); iter != doc_iter->vwords.end(); iter++)
+      usage.Add(*iter);
+  }
+  usage.Add(m_free_docids.capacity() * sizeof(DocID));
+}
+//-----------------------------------------------------------------------------
+// Local variables:
+// mode: c++
+// End:
@@ -0,0 +1,102 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+// TargetIndex.h
+//-----------------------------------------------------------------------------
+
+#ifndef __TARGETINDEX_H
+#define __TARGETINDEX_H
+
+#include "StringX.h"
+#include "MemoryStats.h"
+#include "os/UUID.h"
+#include "os/typedefs.h"
+
+#include <map>
+#include <vector>
+
+/*
+* CTargetIndex finds the entries for a window or web page - e.g., the
+* target of an autotype - from its title and/or URL, without looking at
+* every entry.
+*
+* Each entry is indexed by its URL's host (case-folded, without scheme,
+* user, port or a leading "www."), the host's registrable domain (the
+* last two labels, or three for the likes of "co.uk" - there's no public
+* suffix list here, so this is a heuristic), and the words of its title
+* plus the first label of that domain ("github" for github.com).
+*
+* FindBest() ranks an entry for the same host above one for the same
+* domain, and those above entries found by title words alone. Title
+* words count for more the fewer entries have them, and for more the
+* more of the entry's words are in the window's title, so "Gmail" beats
+* "Gmail (work)" for "Inbox - Gmail - Mozilla Firefox".
+*/
+
+class CTargetIndex
+{
+public:
+  CTargetIndex() {}
+  ~CTargetIndex() {Clear();}
+
+  void Clear();
+  // Replaces any existing title and URL of the entry
+  void Add(const pws_os::CUUID &uuid, const StringX &sxTitle, const StringX &sxURL);
+  void Remove(const pws_os::CUUID &uuid);
+  bool IsIndexed(const pws_os::CUUID &uuid) const
+  {return m_docids.find(uuid) != m_docids.end();}
+  size_t GetNumEntries() const {return m_docids.size();}
+
+  // The (up to) maxResults entries best matching a window's title and a
+  // web page's URL, either of which may be empty, best first
+  void FindBest(const StringX &sxWindowTitle, const StringX &sxURL,
+                size_t maxResults, UUIDVector &matches) const;
+
+  // Normalized host of a URL, e.g. "example.com" for
+  // "[alt]https://user@www.Example.com:8080/login", or empty if none
+  static StringX GetHost(const StringX &sxURL);
+  // Registrable domain of a GetHost() host, e.g. "example.co.uk" for
+  // "mail.example.co.uk"
+  static StringX GetDomain(const StringX &sxHost);
+  // Case-folded words (runs of two or more letters and digits), sorted
+  // and without duplicates
+  static void GetWords(const StringX &sxText, std::vector<StringX> &vwords);
+
+  void GetMemoryUsage(st_MemoryUsage &usage) const;
+
+private:
+  CTargetIndex(const CTargetIndex &); // Do not implement
+  CTargetIndex &operator=(const CTargetIndex &); // Do not implement
+
+  typedef uint32 DocID;
+  typedef std::vector<DocID> PostingList; // sorted
+  typedef std::map<StringX, PostingList> PostingMap;
+
+  // What an entry was indexed by, needed to find its postings on removal
+  struct Doc {
+    Doc() : uuid(pws_os::CUUID::NullUUID()) {}
+    pws_os::CUUID uuid; // NullUUID if free
+    StringX sxHost, sxDomain;
+    std::vector<StringX> vwords;
+  };
+
+  static void AddPosting(PostingMap &postings, const StringX &sxKey, DocID id);
+  static void RemovePosting(PostingMap &postings, const StringX &sxKey, DocID id);
+  static const PostingList *FindPostings(const PostingMap &postings,
+                                         const StringX &sxKey);
+
+  PostingMap m_hosts, m_domains, m_words;
+  std::map<pws_os::CUUID, DocID> m_docids;
+  std::vector<Doc> m_docs; // indexed by DocID
+  std::vector<DocID> m_free_docids;
+};
+
+#endif /* __TARGETINDEX_H */
+//-----------------------------------------------------------------------------
+// Local variables:
+// mode: c++
+// End:
@@ -0,0 +1,280 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+// TextImportFile.cpp
+//-----------------------------------------------------------------------------
+
+#include "TextImportFile.h"
+#include "Util.h"
+
+#include "os/debug.h"
+#include "os/file.h"
+#include "os/mem.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cwchar>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define PWS_TEXTIMPORT_SSE2
+#endif
+
+// Read at a time, when the file can't be mapped
+static const size_t READ_SIZE = 64 * 1024;
+
+CTextImportFile::CTextImportFile()
+  : m_pdata(NULL), m_size(0), m_pos(0), m_bEOF(false), m_bMapped(false),
+    m_allocated(0)
+{
+}
+
+CTextImportFile::~CTextImportFile()
+{
+  Close();
+}
+
+int CTextImportFile::Open(const stringT &filename)
+{
+  Close();
+
+  m_pdata = static_cast<const char *>(pws_os::MapFile(filename, m_size));
+  if (m_pdata != NULL) {
+    m_bMapped = true;
+    return SUCCESS;
+  }
+
+  // Empty, or not a regular file
+  bool bCantOpen;
+  if (!ReadFile(filename, bCantOpen)) {
+    Close();
+    return bCantOpen ? CANT_OPEN : READ_ERROR;
+  }
+  return SUCCESS;
+}
+
+bool CTextImportFile::ReadFile(const stringT &filename, bool &bCantOpen)
+{
+  std::FILE *fs = pws_os::FOpen(filename, _T("rb"));
+  bCantOpen = fs == NULL;
+  if (fs == NULL)
+    return false;
+
+  char *pdata = NULL;
+  bool bError(false);
+  for (;;) {
+    if (m_size + READ_SIZE > m_allocated) {
+      // Grow, trashing what's been read so far
+      const size_t allocated = std::max(2 * m_allocated, m_size + READ_SIZE);
+      char *const pnew = new char[allocated];
+      pws_os::mlock(pnew, allocated);
+      if (pdata != NULL) {
+        std::memcpy(pnew, pdata, m_size);
+        trashMemory(pdata, m_allocated);
+        pws_os::munlock(pdata, m_allocated);
+        delete[] pdata;
+      }
+      pdata = pnew;
+      m_pdata = pdata;
+      m_allocated = allocated;
+    }
+    const size_t count = std::fread(pdata + m_size, 1, READ_SIZE, fs);
+    m_size += count;
+    if (count < READ_SIZE) {
+      bError = std::ferror(fs) != 0;
+      break;
+    }
+  }
+  std::fclose(fs);
+  return !bError;
+}
+
+void CTextImportFile::Close()
+{
+  if (m_pdata != NULL) {
+    if (m_bMapped) {
+      pws_os::UnmapFile(m_pdata, m_size);
+    } else {
+      char *pdata = const_cast<char *>(m_pdata);
+      trashMemory(pdata, m_allocated);
+      pws_os::munlock(pdata, m_allocated);
+      delete[] pdata;
+    }
+  }
+  m_pdata = NULL;
+  m_size = m_pos = m_allocated = 0;
+  m_bEOF = m_bMapped = false;
+}
+
+bool CTextImportFile::GetLine(const char *&line, size_t &len)
+{
+  if (m_pos >= m_size) {
+    m_bEOF = true;
+    return false;
+  }
+
+  line = m_pdata + m_pos;
+  const char *const end = m_pdata + m_size;
+  const char *const nl = static_cast<const char *>(std::memchr(line, '\n', end - line));
+  if (nl == NULL) {
+    len = end - line;
+    m_pos = m_size;
+    m_bEOF = true;
+  } else {
+    len = nl - line;
+    m_pos = (nl - m_pdata) + 1;
+    if (len > 0 && line[len - 1] == '\r')
+      len--;
+  }
+  return true;
+}
+
+bool CTextImportFile::GetLine(std::string &line)
+{
+  const char *p;
+  size_t len;
+  if (!GetLine(p, len)) {
+    line.clear();
+    return false;
+  }
+  line.assign(p, len);
+  return true;
+}
+
+void CTextImportFile::SplitLine(const char *line, size_t len, char sep,
+                                std::vector<Field> &fields)
+{
+  fields.clear();
+  Field field = {line, 0, 0};
+  size_t i = 0;
+
+#ifdef PWS_TEXTIMPORT_SSE2
+  const __m128i vsep = _mm_set1_epi8(sep), vquote = _mm_set1_epi8('"');
+  for (; i + 16 <= len; i += 16) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(line + i));
+    unsigned int seps = unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(v, vsep)));
+    unsigned int quotes = unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(v, vquote))) & ~seps;
+    if ((seps | quotes) == 0)
+      continue;
+    // Quotes below each separator are its field's
+    while (seps != 0) {
+      const unsigned int below = (seps & (0u - seps)) - 1;
+      field.nquotes += __builtin_popcount(quotes & below);
+      quotes &= ~below;
+      const size_t isep = i + __builtin_ctz(seps);
+      field.len = (line + isep) - field.p;
+      fields.push_back(field);
+      field.p = line + isep + 1;
+      field.nquotes = 0;
+      seps &= seps - 1;
+    }
+    field.nquotes += __builtin_popcount(quotes);
+  }
+#endif
+
+  for (; i < len; i++) {
+    if (line[i] == sep) {
+      field.len = (line + i) - field.p;
+      fields.push_back(field);
+      field.p = line + i + 1;
+      field.nquotes = 0;
+    } else if (line[i] == '"') {
+      field.nquotes++;
+    }
+  }
+  field.len = (line + len) - field.p;
+  fields.push_back(field);
+}
+
+// As PXMLDocument::Decode(): a strict decoder, as anything else is left to
+// CUTF8Conv. Never gives more characters than there are bytes.
+template<typename S>
+static bool DecodeUTF8(const char *p, size_t len, S &s)
+{
+  s.resize(len);
+  if (len == 0)
+    return true;
+
+  const unsigned char *pdata = reinterpret_cast<const unsigned char *>(p);
+  typename S::value_type *const pstart = &s[0];
+  typename S::value_type *pw = pstart;
+  size_t i = 0;
+  while (i < len) {
+    unsigned int c = pdata[i];
+    if (c < 0x80) {
+      *pw++ = static_cast<typename S::value_type>(c);
+      i++;
+      continue;
+    }
+
+    size_t n;
+    unsigned int cmin;
+    if ((c & 0xE0) == 0xC0) {
+      n = 2; c &= 0x1F; cmin = 0x80;
+    } else if ((c & 0xF0) == 0xE0) {
+      n = 3; c &= 0x0F; cmin = 0x800;
+    } else if ((c & 0xF8) == 0xF0) {
+      n = 4; c &= 0x07; cmin = 0x10000;
+    } else {
+      n = 0; cmin = 0;
+    }
+    bool bValid = n != 0 && i + n <= len;
+    for (size_t j = 1; bValid && j < n; j++) {
+      bValid = (pdata[i + j] & 0xC0) == 0x80;
+      c = (c << 6) | (pdata[i + j] & 0x3F);
+    }
+    if (!bValid || c < cmin || c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF)) {
+      s.clear();
+      return false;
+    }
+    i += n;
+#if WCHAR_MAX <= 0xFFFF
+    if (c >= 0x10000) {
+      c -= 0x10000;
+      *pw++ = static_cast<typename S::value_type>(0xD800 + (c >> 10));
+      *pw++ = static_cast<typename S::value_type>(0xDC00 + (c & 0x3FF));
+      continue;
+    }
+#endif
+    *pw++ = static_cast<typename S::value_type>(c);
+  }
+  s.resize(pw - pstart);
+  return true;
+}
+
+bool CTextImportFile::Convert(const char *p, size_t len, StringX &sx)
+{
+  // CUTF8Conv needs a '\0' at the end
+  m_tmp.assign(p, p + len);
+  m_tmp.push_back('\0');
+  const bool bConverted = m_conv.FromUTF8(reinterpret_cast<const unsigned char *>(&m_tmp[0]),
+                                          len, sx);
+  trashMemory(&m_tmp[0], m_tmp.size());
+  return bConverted;
+}
+
+bool CTextImportFile::Decode(const char *p, size_t len, StringX &s)
+{
+  return DecodeUTF8(p, len, s) || Convert(p, len, s);
+}
+
+bool CTextImportFile::Decode(const char *p, size_t len, stringT &s)
+{
+  if (DecodeUTF8(p, len, s))
+    return true;
+
+  StringX sx;
+  if (!Convert(p, len, sx))
+    return false;
+  s = sx.c_str();
+  return true;
+}
+//-----------------------------------------------------------------------------
+// Local variables:
+// mode: c++
+// End:
@@ -0,0 +1,90 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+// TextImportFile.h
+//-----------------------------------------------------------------------------
+
+#ifndef __TEXTIMPORTFILE_H
+#define __TEXTIMPORTFILE_H
+
+#include "StringX.h"
+#include "UTF8Conv.h"
+
+#include <string>
+#include <vector>
+
+/*
+* CTextImportFile reads a text file being imported (plain text export, or
+* KeePass TXT or CSV) by mapping it, and returns its lines in place rather
+* than copying the whole file into a stream and then each line out of it.
+* A file that can't be mapped, e.g., a pipe, is read into memory instead,
+* locked and trashed when done.
+*
+* Lines end with "\n" or "\r\n", which aren't part of the line, as if the
+* file were read in text mode on Windows. As with std::getline(), reading
+* a last line that doesn't end with either sets EndOfFile().
+*
+* SplitLine() finds the separators and quotes in a line 16 bytes at a
+* time, giving its fields as slices of the line, which Decode() converts
+* from UTF-8 only as they're needed.
+*/
+
+class CTextImportFile
+{
+public:
+  enum {SUCCESS = 0, CANT_OPEN, READ_ERROR};
+
+  CTextImportFile();
+  ~CTextImportFile();
+
+  int Open(const stringT &filename);
+  void Close();
+
+  // The next line, in place, valid until Close(). Returns false if there
+  // are none left
+  bool GetLine(const char *&line, size_t &len);
+  // As above, as a copy
+  bool GetLine(std::string &line);
+  bool EndOfFile() const {return m_bEOF;}
+  // Where the next line starts, to go back to it
+  size_t GetPosition() const {return m_pos;}
+  void SetPosition(size_t pos) {m_pos = pos; m_bEOF = false;}
+
+  struct Field {
+    const char *p;
+    size_t len;
+    size_t nquotes; // how many '"' in it
+  };
+  // Splits line at every sep (an ASCII character), into one more field
+  // than there are separators
+  static void SplitLine(const char *line, size_t len, char sep,
+                        std::vector<Field> &fields);
+
+  // Converts len bytes of UTF-8, which needn't be followed by a '\0'.
+  // Returns false if they're not valid UTF-8, and CUTF8Conv can't make
+  // anything of them either
+  bool Decode(const char *p, size_t len, stringT &s);
+  bool Decode(const char *p, size_t len, StringX &s);
+
+private:
+  CTextImportFile(const CTextImportFile &);            // Do not implement
+  CTextImportFile &operator=(const CTextImportFile &); // Do not implement
+
+  bool ReadFile(const stringT &filename, bool &bCantOpen);
+  bool Convert(const char *p, size_t len, StringX &sx);
+
+  const char *m_pdata;
+  size_t m_size, m_pos;
+  bool m_bEOF;
+  bool m_bMapped;        // else m_pdata is ours, of m_allocated bytes
+  size_t m_allocated;
+
+  CUTF8Conv m_conv;      // for what isn't valid UTF-8
+  std::vector<char> m_tmp;
+};
+
+#endif /* __TEXTIMPORTFILE_H */
@@ -35,7 +35,7 @@ public:
    */
   enum Functions {
     DATABASEMODIFIED = 0, UPDATEGUI, GUISETUPDISPLAYINFO, GUIREFRESHENTRY,
-    UPDATEWIZARD,
+    UPDATEWIZARD, GUIMEMORYUSAGE,
     // Add new functions here!
     NUM_SUPPORTED};
 
@@ -64,6 +64,10 @@ public:
   // UpdateWizard: called to update text in Wizard during export Text/XML.
   virtual void UpdateWizard(const stringT &s) = 0;
 
+  // GUIMemoryUsage: add the memory used by the UI's own copies of
+  // the database (tree, list...) for PWScore::GetMemoryStats.
+  virtual void GUIMemoryUsage(st_MemoryUsage &usage) const = 0;
+
   virtual ~UIInterFace() {}
 };
 
@@ -384,59 +384,27 @@ bool PWSUtil::WriteXMLField(ostream &os, const char *fname,
     // value has "]]>" sequence(s) that need(s) to be escaped
     // Each "]]>" splits the field into two CDATA sections, one ending with
     // ']]', the other starting with '>'
-    os << tabs << "<" << fname << ">";
-    size_t from = 0, to = p + 2;
+    os << tabs << "<" << fname << "><![CDATA[";
+    size_t from = 0;
     do {
-      StringX slice = value.substr(from, (to - from));
-      os << "<![CDATA[";
+      const StringX slice = value.substr(from, p + 2 - from);
       if (utf8conv.ToUTF8(slice, utf8, utf8Len))
         os.write(reinterpret_cast<const char *>(utf8), utf8Len);
       else
         os << "Internal error - unable to convert field to utf-8";
       os << "]]><![CDATA[";
-      from = to;
+      from = p + 2;
       p = value.find(_T("]]>"), from); // are there more?
-      if (p == StringX::npos) {
-        to = value.length();
-        slice = value.substr(from, (to - from));
-      } else {
-        to = p + 2;
-        slice = value.substr(from, (to - from));
-        from = to;
-        to = value.length();
-      }
-      if (utf8conv.ToUTF8(slice, utf8, utf8Len))
-        os.write(reinterpret_cast<const char *>(utf8), utf8Len);
-      else
-        os << "Internal error - unable to convert field to utf-8";
-      os << "]]>";
     } while (p != StringX::npos);
-    os << "</" << fname << ">" << endl;
+    if (utf8conv.ToUTF8(value.substr(from), utf8, utf8Len))
+      os.write(reinterpret_cast<const char *>(utf8), utf8Len);
+    else
+      os << "Internal error - unable to convert field to utf-8";
+    os << "]]></" << fname << ">" << endl;
   } // special handling of "]]>" in value.
   return true;
 }
 
-string PWSUtil::GetXMLTime(int indent, const char *name,
-                           time_t t, CUTF8Conv &utf8conv)
-{
-  int i;
-  const StringX tmp = PWSUtil::ConvertToDateTimeString(t, TMC_XML);
-  ostringstream oss;
-  const unsigned char *utf8 = NULL;
-  size_t utf8Len = 0;
-
-
-  for (i = 0; i < indent; i++) oss << "\t";
-  oss << "<" << name << ">" ;
-  utf8conv.ToUTF8(tmp.substr(0, 10), utf8, utf8Len);
-  oss.write(reinterpret_cast<const char *>(utf8), utf8Len);
-  oss << "T";
-  utf8conv.ToUTF8(tmp.substr(tmp.length() - 8), utf8, utf8Len);
-  oss.write(reinterpret_cast<const char *>(utf8), utf8Len);
-  oss << "</" << name << ">" << endl;
-  return oss.str();
-}
-
 /**
  * Get TCHAR buffer size by format string with parameters
  * @param[in] fmt - format string
@@ -514,24 +482,14 @@ stringT PWSUtil::GetSafeXMLString(const StringX &sxInString)
     // value has "]]>" sequence(s) that need(s) to be escaped
     // Each "]]>" splits the field into two CDATA sections, one ending with
     // ']]', the other starting with '>'
-    const StringX value = sxInString;
-    size_t from = 0, to = p + 2;
+    size_t from = 0;
+    os << "<![CDATA[";
     do {
-      StringX slice = value.substr(from, (to - from));
-      os << "<![CDATA[" << slice << "]]><![CDATA[";
-      from = to;
-      p = value.find(_T("]]>"), from); // are there more?
-      if (p == StringX::npos) {
-        to = value.length();
-        slice = value.substr(from, (to - from));
-      } else {
-        to = p + 2;
-        slice = value.substr(from, (to - from));
-        from = to;
-        to = value.length();
-      }
-      os <<  slice << "]]>";
+      os << sxInString.substr(from, p + 2 - from) << "]]><![CDATA[";
+      from = p + 2;
+      p = sxInString.find(_T("]]>"), from); // are there more?
     } while (p != StringX::npos);
+    os << sxInString.substr(from) << "]]>";
   }
   retval = os.str().c_str();
   return retval;
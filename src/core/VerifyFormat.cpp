@@ -7,6 +7,7 @@
 */
 
 #include "VerifyFormat.h"
+#include "LocalTime.h"
 #include "core.h"
 #include "StringXStream.h"
 
@@ -15,23 +16,26 @@
 
 static const TCHAR *sHex = _T("0123456789abcdefABCDEF");
 
-// Our own mktime, differs from libc's via argument overloading
-static time_t mktime(int yyyy, int mon, int dd,
-                     int hh = 0, int min = 0, int sec = 0, int *dow = NULL)
+// The n digits starting at str[i], without the locale or a stream
+static bool GetDigits(const stringT &str, size_t i, size_t n, int &value)
 {
-  struct tm xtm;
-  memset(&xtm, 0, sizeof(tm));
-  xtm.tm_year = yyyy - 1900;
-  xtm.tm_mon = mon - 1;
-  xtm.tm_mday = dd;
-  xtm.tm_hour = hh;
-  xtm.tm_min = min;
-  xtm.tm_sec = sec;
-  xtm.tm_isdst = -1;
-  time_t retval = std::mktime(&xtm);
-  if (dow != NULL)
-    *dow = xtm.tm_wday + 1;
-  return retval;
+  value = 0;
+  for (size_t j = i; j < i + n; j++) {
+    if (str[j] < TCHAR('0') || str[j] > TCHAR('9'))
+      return false;
+    value = value * 10 + (str[j] - TCHAR('0'));
+  }
+  return true;
+}
+
+// The 3 letter name at str[i] in names, 1-based, or 0 if not there
+static int GetName(const stringT &str, size_t i, const TCHAR *names, int count)
+{
+  for (int n = 0; n < count; n++) {
+    if (str.compare(i, 3, names + 3 * n, 3) == 0)
+      return n + 1;
+  }
+  return 0;
 }
 
 bool verifyDTvalues(int yyyy, int mon, int dd,
@@ -69,8 +73,6 @@ bool VerifyImportDateTimeString(const stringT &time_str, time_t &t)
   //  String format must be "yyyy/mm/dd hh:mm:ss"
   //                        "0123456789012345678"
 
-  const int ndigits = 14;
-  const int idigits[ndigits] = {0, 1, 2, 3, 5, 6, 8, 9, 11, 12, 14, 15, 17, 18};
   int yyyy, mon, dd, hh, min, ss;
 
   t = time_t(-1);
@@ -86,15 +88,10 @@ bool VerifyImportDateTimeString(const stringT &time_str, time_t &t)
       time_str[16] != TCHAR(':'))
     return false;
 
-  for (int i = 0;  i < ndigits; i++)
-    if (!isdigit(time_str[idigits[i]]))
-      return false;
-
-  istringstreamT is(time_str);
-  TCHAR dummy;
-
-  is >> yyyy >> dummy >> mon >> dummy >> dd
-     >> hh >> dummy >> min >> dummy >> ss;
+  if (!GetDigits(time_str, 0, 4, yyyy) || !GetDigits(time_str, 5, 2, mon) ||
+      !GetDigits(time_str, 8, 2, dd) || !GetDigits(time_str, 11, 2, hh) ||
+      !GetDigits(time_str, 14, 2, min) || !GetDigits(time_str, 17, 2, ss))
+    return false;
 
   if (!verifyDTvalues(yyyy, mon, dd, hh, min, ss))
     return false;
@@ -106,7 +103,7 @@ bool VerifyImportDateTimeString(const stringT &time_str, time_t &t)
     return true;
   }
 
-  t = mktime(yyyy, mon, dd, hh, min, ss);
+  t = PWSLocalTime::MakeTime(yyyy, mon, dd, hh, min, ss);
   return true;
 }
 
@@ -116,12 +113,9 @@ bool VerifyASCDateTimeString(const stringT &time_str, time_t &t)
   //                        "012345678901234567890123"
   // e.g.,                  "Wed Oct 06 21:02:38 2008"
 
-  const stringT str_months = _T("JanFebMarAprMayJunJulAugSepOctNovDec");
-  const stringT str_days = _T("SunMonTueWedThuFriSat");
-  const int ndigits = 12;
-  const int idigits[ndigits] = {8, 9, 11, 12, 14, 15, 17, 18, 20, 21, 22, 23};
-  stringT::size_type iMON, iDOW;
-  int yyyy, mon, dd, hh, min, ss;
+  const TCHAR *str_months = _T("JanFebMarAprMayJunJulAugSepOctNovDec");
+  const TCHAR *str_days = _T("SunMonTueWedThuFriSat");
+  int iDOW, yyyy, mon, dd, hh, min, ss;
 
   t = time_t(-1);
 
@@ -129,24 +123,22 @@ bool VerifyASCDateTimeString(const stringT &time_str, time_t &t)
     return false;
 
   // Validate time_str
-  if (time_str[13] != TCHAR(':') ||
-      time_str[16] != TCHAR(':'))
+  if (time_str[3] != TCHAR(' ') ||
+      time_str[7] != TCHAR(' ') ||
+      time_str[10] != TCHAR(' ') ||
+      time_str[13] != TCHAR(':') ||
+      time_str[16] != TCHAR(':') ||
+      time_str[19] != TCHAR(' '))
     return false;
 
-  for (int i = 0; i < ndigits; i++)
-    if (!isdigit(time_str[idigits[i]]))
-      return false;
-
-  istringstreamT is(time_str);
-  stringT dow, mon_str;
-  TCHAR dummy;
-  is >> dow >> mon_str >> dd >> hh >> dummy >> min >> dummy >> ss >> yyyy;
-
-  iMON = str_months.find(mon_str);
-  if (iMON == stringT::npos)
+  if (!GetDigits(time_str, 8, 2, dd) || !GetDigits(time_str, 11, 2, hh) ||
+      !GetDigits(time_str, 14, 2, min) || !GetDigits(time_str, 17, 2, ss) ||
+      !GetDigits(time_str, 20, 4, yyyy))
     return false;
 
-  mon = ((reinterpret_cast<int &>(iMON) / 3) + 1);
+  mon = GetName(time_str, 4, str_months, 12);
+  if (mon == 0)
+    return false;
 
   if (!verifyDTvalues(yyyy, mon, dd, hh, min, ss))
     return false;
@@ -159,14 +151,10 @@ bool VerifyASCDateTimeString(const stringT &time_str, time_t &t)
   }
 
   int  mktime_dow;
-  time_t xt = mktime(yyyy, mon, dd, hh, min, ss, &mktime_dow);
-
-  iDOW = str_days.find(dow);
-  if (iDOW == stringT::npos)
-    return false;
+  time_t xt = PWSLocalTime::MakeTime(yyyy, mon, dd, hh, min, ss, &mktime_dow);
 
-  iDOW = (iDOW / 3) + 1;
-  if (iDOW != stringT::size_type(mktime_dow))
+  iDOW = GetName(time_str, 0, str_days, 7);
+  if (iDOW == 0 || iDOW != mktime_dow)
     return false;
 
   t = xt;
@@ -186,10 +174,6 @@ bool VerifyXMLDateTimeString(const stringT &time_str, time_t &t)
   //                        "2008-10-06T21:20:56+01:00"
   //                        "2008-10-06T21:20:56-01:00"
 
-  stringT xtime_str;
-
-  int ndigits(14);
-  const int idigits[18] = {0, 1, 2, 3, 5, 6, 8, 9, 11, 12, 14, 15, 17, 18, 20, 21, 23, 24};
   int yyyy, mon, dd, hh, min, ss, tz_hh(0), tz_mm(0);
 
   t = time_t(-1);
@@ -206,6 +190,11 @@ bool VerifyXMLDateTimeString(const stringT &time_str, time_t &t)
       time_str[16] != TCHAR(':'))
     return false;
 
+  if (!GetDigits(time_str, 0, 4, yyyy) || !GetDigits(time_str, 5, 2, mon) ||
+      !GetDigits(time_str, 8, 2, dd) || !GetDigits(time_str, 11, 2, hh) ||
+      !GetDigits(time_str, 14, 2, min) || !GetDigits(time_str, 17, 2, ss))
+    return false;
+
   switch (len) {
     case 19:
       break;
@@ -214,34 +203,33 @@ bool VerifyXMLDateTimeString(const stringT &time_str, time_t &t)
         return false;
       break;
     case 25:
+    {
+      const TCHAR sign = time_str[19];
       if (time_str[22] != TCHAR(':')  &&
-          (time_str[19] != TCHAR('+') &&
-           time_str[19] != TCHAR('-')))
+          (sign != TCHAR('+') &&
+           sign != TCHAR('-')))
+        return false;
+      int digit;
+      if (!GetDigits(time_str, 20, 2, tz_hh) || !GetDigits(time_str, 23, 2, tz_mm) ||
+          GetDigits(time_str, 19, 1, digit))
         return false;
-      ndigits = 18;
+      if ((sign != TCHAR('+') && sign != TCHAR('-')) ||
+          GetDigits(time_str, 22, 1, digit)) {
+        // Not an offset after all
+        tz_hh = tz_mm = 0;
+      } else if (sign == TCHAR('-')) {
+        tz_hh = -tz_hh;
+      }
+
+      if (tz_mm > 59 || abs(tz_hh) > 14 ||
+          (abs(tz_hh) == 14 && tz_mm != 0))
+        tz_hh = tz_mm = 0;
       break;
+    }
     default:
       return false;
   }
 
-  for (int i = 0; i < ndigits; i++) {
-    if (!isdigit(time_str[idigits[i]]))
-      return false;
-  }
-
-  istringstreamT is(time_str);
-  TCHAR dummy;
-  is >> yyyy >> dummy >> mon >> dummy >> dd >> dummy
-     >>  hh  >> dummy >> min >> dummy >> ss;
-
-  if (len == 25) {
-    is >> tz_hh >> dummy >> tz_mm;
-
-    if (tz_mm > 59 || abs(tz_hh) > 14 ||
-        (abs(tz_hh) == 14 && tz_mm != 0))
-      tz_hh = tz_mm = 0;
-  }
-
   if (!verifyDTvalues(yyyy, mon, dd, hh, min, ss))
     return false;
 
@@ -252,7 +240,7 @@ bool VerifyXMLDateTimeString(const stringT &time_str, time_t &t)
     return true;
   }
 
-  t = mktime(yyyy, mon, dd, hh, min, ss);
+  t = PWSLocalTime::MakeTime(yyyy, mon, dd, hh, min, ss);
 
   // Add timezone offsets
   if (tz_hh != 0 || tz_mm != 0) {
@@ -267,9 +255,6 @@ bool VerifyXMLDateString(const stringT &time_str, time_t &t)
   //  String format must be "yyyy-mm-dd"
   //                        "0123456789"
 
-  stringT xtime_str;
-  const int ndigits = 8;
-  const int idigits[ndigits] = {0, 1, 2, 3, 5, 6, 8, 9};
   int yyyy, mon, dd;
 
   t = time_t(-1);
@@ -278,19 +263,13 @@ bool VerifyXMLDateString(const stringT &time_str, time_t &t)
     return false;
 
   // Validate time_str
-  if (time_str.substr(4,1) != _S("-") ||
-      time_str.substr(7,1) != _S("-"))
+  if (time_str[4] != TCHAR('-') ||
+      time_str[7] != TCHAR('-'))
     return false;
 
-  for (int i = 0; i < ndigits; i++) {
-    if (!isdigit(time_str[idigits[i]]))
-      return false;
-  }
-
-  istringstreamT is(time_str);
-  TCHAR dummy;
-
-  is >> yyyy >> dummy >> mon >> dummy >> dd;
+  if (!GetDigits(time_str, 0, 4, yyyy) || !GetDigits(time_str, 5, 2, mon) ||
+      !GetDigits(time_str, 8, 2, dd))
+    return false;
 
   if (!verifyDTvalues(yyyy, mon, dd, 1, 2, 3))
     return false;
@@ -302,7 +281,7 @@ bool VerifyXMLDateString(const stringT &time_str, time_t &t)
     return true;
   }
 
-  t = mktime(yyyy, mon, dd);
+  t = PWSLocalTime::MakeTime(yyyy, mon, dd);
   return true;
 }
 
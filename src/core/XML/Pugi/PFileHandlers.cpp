@@ -0,0 +1,337 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+
+#include "../XMLDefs.h"    // Required if testing "USE_XML_LIBRARY"
+
+#ifdef USE_XML_LIBRARY
+
+// PWS includes
+#include "PFileHandlers.h"
+
+#include "../../core.h"
+#include "../../StringXStream.h"
+
+using namespace std;
+
+static bool Contains(const std::vector<const TCHAR *> &vnames, const TCHAR *name)
+{
+  for (size_t i = 0; i < vnames.size(); i++) {
+    if (_tcscmp(vnames[i], name) == 0)
+      return true;
+  }
+  return false;
+}
+
+/*
+* The elements each element may hold, as in lumimaja.xsd. The database's
+* root is passwordsafe, though exports are named lumimaja.
+*/
+
+static const struct {
+  const TCHAR *name; const TCHAR *elements;
+} ExpectedElements[] = {
+  {_T("passwordsafe"), _T("Preferences NamedPasswordPolicies EmptyGroups entry")},
+  {_T("Preferences"),
+   _T("DisplayExpandedAddEditDlg MaintainDateTimeStamps LockDBOnIdleTimeout ")
+   _T("PWUseDigits PWUseEasyVision PWUseHexDigits PWUseLowercase PWUseSymbols ")
+   _T("PWUseUppercase PWMakePronounceable SaveImmediately SavePasswordHistory ")
+   _T("ShowNotesDefault ShowPWDefault ShowPasswordInTree ShowUsernameInTree ")
+   _T("SortAscending UseDefaultUser CopyPasswordWhenBrowseToURL ")
+   _T("PWDefaultLength IdleTimeout TreeDisplayStatusAtOpen NumPWHistoryDefault ")
+   _T("PWDigitMinLength PWLowercaseMinLength PWSymbolMinLength PWUppercaseMinLength ")
+   _T("DefaultUsername DefaultAutotypeString DefaultSymbols")},
+  {_T("NamedPasswordPolicies"), _T("Policy")},
+  {_T("Policy"),
+   _T("PWName PWDefaultLength PWUseDigits PWUseEasyVision PWUseHexDigits ")
+   _T("PWUseLowercase PWUseSymbols PWUseUppercase PWMakePronounceable ")
+   _T("PWLowercaseMinLength PWUppercaseMinLength PWDigitMinLength PWSymbolMinLength ")
+   _T("symbols")},
+  {_T("EmptyGroups"), _T("EGName")},
+  {_T("entry"),
+   _T("group title username password url autotype notes uuid ")
+   _T("ctimex atimex xtimex pmtimex rmtimex xtime_interval pwhistory ")
+   _T("PasswordPolicy PasswordPolicyName runcommand dca shiftdca email ")
+   _T("protected symbols kbshortcut")},
+  {_T("pwhistory"), _T("status max num history_entries")},
+  {_T("history_entries"), _T("history_entry")},
+  {_T("history_entry"), _T("changedx oldpassword")},
+  {_T("PasswordPolicy"),
+   _T("PWLength PWUseDigits PWUseEasyVision PWUseHexDigits PWUseLowercase ")
+   _T("PWUseSymbols PWUseUppercase PWMakePronounceable ")
+   _T("PWLowercaseMinLength PWUppercaseMinLength PWDigitMinLength PWSymbolMinLength")},
+};
+
+// The order of the root's elements, of which only entries may be repeated
+static const TCHAR *RootElements[] = {
+  _T("Preferences"), _T("NamedPasswordPolicies"), _T("EmptyGroups"), _T("entry"),
+};
+
+// Those that must be in each element that has any
+static const struct {
+  const TCHAR *name; const TCHAR *elements;
+} RequiredElements[] = {
+  {_T("NamedPasswordPolicies"), _T("Policy")},
+  {_T("Policy"), _T("PWName PWDefaultLength")},
+  {_T("EmptyGroups"), _T("EGName")},
+  {_T("entry"), _T("title password")},
+  {_T("pwhistory"), _T("status max num")},
+  {_T("history_entry"), _T("oldpassword")},
+  {_T("PasswordPolicy"), _T("PWLength")},
+};
+
+// Elements but these may only be once in theirs, and entries may have
+// a PasswordPolicy or a PasswordPolicyName, not both
+static const TCHAR *RepeatedElements = _T("Policy EGName history_entry");
+static const size_t MAX_HISTORY_ENTRIES = 255;
+
+// The types of the elements whose values aren't just strings (see
+// PSchemaType), any element being of the same type wherever it is
+static const struct {
+  const TCHAR *type; const TCHAR *elements;
+} ElementTypes[] = {
+  {_T("int 0 1"),
+   _T("DisplayExpandedAddEditDlg MaintainDateTimeStamps LockDBOnIdleTimeout ")
+   _T("PWUseDigits PWUseEasyVision PWUseHexDigits PWUseLowercase PWUseSymbols ")
+   _T("PWUseUppercase PWMakePronounceable SaveImmediately SavePasswordHistory ")
+   _T("ShowNotesDefault ShowPWDefault ShowPasswordInTree ShowUsernameInTree ")
+   _T("SortAscending UseDefaultUser CopyPasswordWhenBrowseToURL status protected")},
+  {_T("int 4 1024"), _T("PWDefaultLength PWLength")},
+  {_T("int 0 1024"),
+   _T("PWDigitMinLength PWLowercaseMinLength PWSymbolMinLength PWUppercaseMinLength")},
+  {_T("int 1 120"), _T("IdleTimeout")},
+  {_T("enum AllCollapsed AllExpanded AsPerLastSave"), _T("TreeDisplayStatusAtOpen")},
+  {_T("int 0 255"), _T("NumPWHistoryDefault max num")},
+  {_T("hexBinary 16"), _T("uuid")},
+  {_T("dateTime"), _T("ctimex atimex xtimex pmtimex rmtimex changedx")},
+  {_T("int 1 3650"), _T("xtime_interval")},
+  {_T("int 0 9"), _T("dca shiftdca")},
+  {_T("kbshortcut"), _T("kbshortcut")},
+};
+
+// The attributes each element may have, with their types
+static const struct {
+  const TCHAR *element; const TCHAR *attribute; const TCHAR *type; bool bRequired;
+} ElementAttributes[] = {
+  {_T("passwordsafe"), _T("delimiter"), _T("char"), true},
+  {_T("passwordsafe"), _T("Database"), _T("string"), false},
+  {_T("passwordsafe"), _T("ExportTimeStamp"), _T("dateTime"), false},
+  {_T("passwordsafe"), _T("FromDatabaseFormat"), _T("string"), false},
+  {_T("passwordsafe"), _T("WhatSaved"), _T("string"), false},
+  {_T("passwordsafe"), _T("WhoSaved"), _T("string"), false},
+  {_T("passwordsafe"), _T("WhenLastSaved"), _T("dateTime"), false},
+  {_T("passwordsafe"), _T("Database_uuid"), _T("fileuuid"), false},
+  {_T("entry"), _T("id"), _T("int"), false},
+  {_T("entry"), _T("normal"), _T("boolean"), false},
+  {_T("history_entry"), _T("num"), _T("int"), false},
+};
+
+PFileHandlers::PFileHandlers()
+  : m_pdoc(NULL)
+{
+  for (size_t i = 0; i < NumberOf(ExpectedElements); i++) {
+    ElementSet &elements = m_mapExpected[ExpectedElements[i].name];
+    istringstreamT is(ExpectedElements[i].elements);
+    stringT strElement;
+    while (is >> strElement)
+      elements.insert(strElement);
+  }
+  for (size_t i = 0; i < NumberOf(RequiredElements); i++) {
+    ElementSet &elements = m_mapRequired[RequiredElements[i].name];
+    istringstreamT is(RequiredElements[i].elements);
+    stringT strElement;
+    while (is >> strElement)
+      elements.insert(strElement);
+  }
+  istringstreamT is(RepeatedElements);
+  stringT strElement;
+  while (is >> strElement)
+    m_setRepeated.insert(strElement);
+  for (size_t i = 0; i < NumberOf(ElementTypes); i++) {
+    const PSchemaType type(ElementTypes[i].type);
+    istringstreamT is(ElementTypes[i].elements);
+    while (is >> strElement)
+      m_mapTypes[strElement] = type;
+  }
+  for (size_t i = 0; i < NumberOf(ElementAttributes); i++)
+    m_attributes.Add(ElementAttributes[i].element, ElementAttributes[i].attribute,
+                     ElementAttributes[i].type, ElementAttributes[i].bRequired);
+}
+
+PFileHandlers::~PFileHandlers()
+{
+}
+
+void PFileHandlers::LoadError(const PXMLDocument &doc)
+{
+  doc.FormatError(m_strValidationResult, pugi::xml_node(), doc.GetError(),
+                  SAX2_FATALERROR);
+  m_bErrors = true;
+}
+
+void PFileHandlers::UnexpectedElement(const pugi::xml_node &node)
+{
+  stringT strMessage;
+  Format(strMessage, IDSC_XMLUNEXPECTEDELEMENT, node.name());
+  m_pdoc->FormatError(m_strValidationResult, node, strMessage);
+  m_bErrors = true;
+}
+
+void PFileHandlers::Error(const pugi::xml_node &node, const int id,
+                          const TCHAR *name1, const TCHAR *name2)
+{
+  stringT strMessage;
+  Format(strMessage, id, name1, name2);
+  m_pdoc->FormatError(m_strValidationResult, node, strMessage);
+  m_bErrors = true;
+}
+
+void PFileHandlers::Process(const PXMLDocument &doc)
+{
+  m_pdoc = &doc;
+  m_strXMLErrors = _T("");
+  m_bEntryBeingProcessed = false;
+
+  const pugi::xml_node root = doc.GetRoot();
+  if (_tcscmp(root.name(), _T("lumimaja")) != 0 &&
+      _tcscmp(root.name(), _T("passwordsafe")) != 0) {
+    UnexpectedElement(root);
+    return;
+  }
+
+  // The delimiter is needed before the first entry is added
+  const TCHAR *szDelimiter = root.attribute(_T("delimiter")).value();
+  if (szDelimiter[0] != _T('\0'))
+    m_delimiter = szDelimiter[0];
+
+  if (!m_attributes.Check(doc, root, _T("passwordsafe"), m_strValidationResult))
+    m_bErrors = true;
+  XMLFileHandlers::ProcessStartElement(XLE_PASSWORDSAFE);
+
+  // As Xerces would find, the root's elements must be in the schema's
+  // order, with only the entries repeated
+  const ElementSet &expected = m_mapExpected.find(_T("passwordsafe"))->second;
+  const size_t ientry = NumberOf(RootElements) - 1;
+  size_t inext(0);
+  for (pugi::xml_node node = root.first_child(); node; node = node.next_sibling()) {
+    if (node.type() != pugi::node_element)
+      continue;
+
+    size_t i(0);
+    while (i < NumberOf(RootElements) && _tcscmp(node.name(), RootElements[i]) != 0)
+      i++;
+    if (i < inext) {
+      UnexpectedElement(node);
+      continue;
+    }
+    if (i <= ientry)
+      inext = i == ientry ? i : i + 1;
+    ProcessElement(node, expected);
+  }
+
+  if (!m_bValidation)
+    XMLFileHandlers::ProcessEndElement(XLE_PASSWORDSAFE);
+}
+
+void PFileHandlers::ProcessElement(const pugi::xml_node &node, const ElementSet &expected)
+{
+  const TCHAR *name = node.name();
+  if (expected.find(name) == expected.end()) {
+    UnexpectedElement(node);
+    return;
+  }
+
+  if (!m_attributes.Check(*m_pdoc, node, name, m_strValidationResult))
+    m_bErrors = true;
+  const TypeMap::const_iterator iter_type = m_mapTypes.find(name);
+  const bool bTyped = iter_type != m_mapTypes.end();
+
+  m_sxElemContent = _T("");
+
+  st_file_element_data edata;
+  m_validator.FindElementInfo(name, edata);
+  const int icurrent_element = m_bEntryBeingProcessed ? edata.element_entry_code : edata.element_code;
+  if (XMLFileHandlers::ProcessStartElement(icurrent_element) &&
+      icurrent_element == XLE_ENTRY) {
+    const TCHAR *szValue1 = node.attribute(_T("normal")).value();
+    m_cur_entry->bforce_normal_entry =
+      _tcscmp(szValue1, _T("1")) == 0 || _tcscmp(szValue1, _T("true")) == 0;
+    const pugi::xml_attribute id = node.attribute(_T("id"));
+    if (id)
+      m_cur_entry->id = id.as_int();
+  }
+
+  // The text is the element's own, as that's all the SAX2 handlers keep by
+  // the time it ends
+  const std::map<stringT, ElementSet, std::less<> >::const_iterator iter =
+    m_mapExpected.find(name);
+  StringX sxContent;
+  std::vector<const TCHAR *> vonce;  // those seen that may only be once
+  size_t numHistoryEntries(0);
+  for (pugi::xml_node child = node.first_child(); child; child = child.next_sibling()) {
+    switch (child.type()) {
+      case pugi::node_element:
+      {
+        if (iter == m_mapExpected.end()) {
+          UnexpectedElement(child);
+          break;
+        }
+        const TCHAR *szChild = child.name();
+        if (m_setRepeated.find(szChild) != m_setRepeated.end()) {
+          if (_tcscmp(szChild, _T("history_entry")) == 0 &&
+              ++numHistoryEntries > MAX_HISTORY_ENTRIES) {
+            UnexpectedElement(child);
+            break;
+          }
+        } else {
+          // A PasswordPolicyName is in place of a PasswordPolicy
+          const TCHAR *szOnce = _tcscmp(szChild, _T("PasswordPolicyName")) == 0 ?
+                                  _T("PasswordPolicy") : szChild;
+          if (Contains(vonce, szOnce)) {
+            UnexpectedElement(child);
+            break;
+          }
+          vonce.push_back(szOnce);
+        }
+        ProcessElement(child, iter->second);
+        break;
+      }
+      case pugi::node_pcdata:
+      case pugi::node_cdata:
+        if (!m_bValidation || bTyped)
+          sxContent += child.value();
+        break;
+      default:
+        break;
+    }
+  }
+
+  const std::map<stringT, ElementSet, std::less<> >::const_iterator iter_required =
+    m_mapRequired.find(name);
+  if (iter_required != m_mapRequired.end()) {
+    ElementSet::const_iterator iter_element;
+    for (iter_element = iter_required->second.begin();
+         iter_element != iter_required->second.end(); iter_element++) {
+      if (!node.child(iter_element->c_str()))
+        Error(node, IDSC_XMLMISSINGELEMENT, iter_element->c_str(), name);
+    }
+  }
+  if (bTyped && !iter_type->second.IsValid(sxContent.c_str()))
+    Error(node, IDSC_XMLINVALIDVALUE, sxContent.c_str(), name);
+
+  if (m_bValidation) {
+    if (_tcscmp(name, _T("entry")) == 0)
+      m_numEntries++;
+    return;
+  }
+
+  m_sxElemContent = sxContent;
+  const int iend_element = m_bEntryBeingProcessed ? edata.element_entry_code : edata.element_code;
+  XMLFileHandlers::ProcessEndElement(iend_element);
+}
+
+#endif /* USE_XML_LIBRARY */
@@ -0,0 +1,76 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+
+/*
+* Walks a File XML document parsed by pugixml (see PXMLDocument), handing
+* each element to XMLFileHandlers as the Xerces SAX2 handlers do.
+*
+* In place of validating against the schema, each element is checked as
+* Xerces would against lumimaja.xsd: that it's one the schema allows where
+* it is, as often as it's allowed and, for the root's, in the schema's
+* order; that the elements and attributes the schema requires are there;
+* and that values are of their simple types, with their facets (see
+* PSchemaType). The values are then checked further as they're imported,
+* as they are with Xerces.
+*/
+
+#ifndef __PFILEHANDLERS_H
+#define __PFILEHANDLERS_H
+
+#include "PXMLDocument.h"
+#include "PSchemaType.h"
+
+#include "../XMLFileValidation.h"
+#include "../XMLFileHandlers.h"
+
+// PWS includes
+#include "../../StringX.h"
+
+#include <map>
+#include <set>
+#include <vector>
+
+class PFileHandlers : public XMLFileHandlers
+{
+public:
+  PFileHandlers();
+  virtual ~PFileHandlers();
+
+  // Processes a document that loaded, as Xerces would parse it
+  void Process(const PXMLDocument &doc);
+  // Notes why a document didn't load
+  void LoadError(const PXMLDocument &doc);
+
+  stringT getValidationResult() const {return m_strValidationResult;}
+
+private:
+  typedef std::set<stringT, std::less<> > ElementSet;
+
+  typedef std::map<stringT, PSchemaType, std::less<> > TypeMap;
+
+  void ProcessElement(const pugi::xml_node &node, const ElementSet &expected);
+  void UnexpectedElement(const pugi::xml_node &node);
+  void Error(const pugi::xml_node &node, const int id,
+             const TCHAR *name1, const TCHAR *name2 = NULL);
+
+  const PXMLDocument *m_pdoc;
+  XMLFileValidation m_validator;
+  // The elements that may be in each element that has any, and those that
+  // must be
+  std::map<stringT, ElementSet, std::less<> > m_mapExpected;
+  std::map<stringT, ElementSet, std::less<> > m_mapRequired;
+  // Those that may be more than once in theirs
+  ElementSet m_setRepeated;
+  // The types of the elements with simple types other than strings, and
+  // of each element's attributes
+  TypeMap m_mapTypes;
+  PSchemaAttributes m_attributes;
+  stringT m_strValidationResult;
+};
+
+#endif /* __PFILEHANDLERS_H */
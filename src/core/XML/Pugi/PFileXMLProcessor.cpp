@@ -0,0 +1,116 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+
+/*
+* This routine processes File XML using pugixml, as shipped in core/pugixml,
+* in place of Xerces (USE_XML_LIBRARY == PUGIXML).
+*/
+
+#include "../XMLDefs.h"    // Required if testing "USE_XML_LIBRARY"
+
+#ifdef USE_XML_LIBRARY
+
+// PWS includes
+#include "PFileXMLProcessor.h"
+#include "PFileHandlers.h"
+#include "PXMLDocument.h"
+
+#include "../../core.h"
+#include "../../PWScore.h"
+
+PFileXMLProcessor::PFileXMLProcessor(PWScore *pcore,
+                                     UUIDVector *pPossible_Aliases,
+                                     UUIDVector *pPossible_Shortcuts,
+                                     MultiCommands *p_multicmds,
+                                     CReport *prpt)
+  : m_pXMLcore(pcore),
+    m_pPossible_Aliases(pPossible_Aliases), m_pPossible_Shortcuts(pPossible_Shortcuts),
+    m_pmulticmds(p_multicmds), m_prpt(prpt), m_numEntriesValidated(0),
+    m_numEntriesImported(0), m_numEntriesSkipped(0), m_numEntriesPWHErrors(0),
+    m_numEntriesRenamed(0), m_numRenamedPolicies(0), m_numNoPolicies(0),
+    m_numShortcutsRemoved(0), m_delimiter(TCHAR('^')), m_bValidation(false),
+    m_bValidationErrors(false)
+{
+}
+
+PFileXMLProcessor::~PFileXMLProcessor()
+{
+}
+
+// ---------------------------------------------------------------------------
+bool PFileXMLProcessor::Process(const bool &bvalidation, const stringT &ImportedPrefix,
+                                const stringT &strXMLFileName,
+                                const stringT & /* strXSDFileName */,
+                                const bool &bImportPSWDsOnly)
+{
+  bool bErrorOccurred = false;
+  bool b_into_empty = false;
+  stringT cs_validation;
+  LoadAString(cs_validation, IDSC_XMLVALIDATION);
+  stringT cs_import;
+  LoadAString(cs_import, IDSC_XMLIMPORT);
+  m_bValidation = bvalidation;  // Validate or Import
+  m_bValidationErrors = false;
+
+  PFileHandlers handler;
+  handler.SetVariables(m_bValidation ? NULL : m_pXMLcore, m_bValidation,
+                       ImportedPrefix, m_delimiter, bImportPSWDsOnly,
+                       m_bValidation ? NULL : m_pPossible_Aliases,
+                       m_bValidation ? NULL : m_pPossible_Shortcuts,
+                       m_pmulticmds, m_prpt);
+  if (!m_bValidation) {
+    b_into_empty = m_pXMLcore->GetNumEntries() == 0;
+  }
+
+  PXMLDocument doc;
+  if (doc.Load(strXMLFileName))
+    handler.Process(doc);
+  else
+    handler.LoadError(doc);
+
+  if (handler.getIfErrors()) {
+    // A file that doesn't parse, or has elements where the schema has none,
+    // fails validation, as with Xerces
+    m_bValidationErrors = true;
+    bErrorOccurred = true;
+    Format(m_strXMLErrors, IDSC_XERCESPARSEERROR, cs_validation.c_str(),
+           handler.getValidationResult().c_str());
+  } else {
+    if (m_bValidation) {
+      m_strXMLErrors = handler.getValidationResult();
+      m_numEntriesValidated = handler.getNumEntries();
+      m_delimiter = handler.getDelimiter();
+    } else {
+      // The entries were added as they were read
+      handler.EndXMLEntries();
+
+      m_numEntriesValidated = handler.getNumEntriesRead();
+      m_numEntriesImported = handler.getNumEntries();
+      m_numEntriesSkipped = handler.getNumSkipped();
+      m_numEntriesRenamed = handler.getNumRenamed();
+      m_numEntriesPWHErrors = handler.getNumPWHErrors();
+      m_numNoPolicies = handler.getNumNoPolicies();
+      m_numRenamedPolicies = handler.getNumRenamedPolicies();
+      m_numShortcutsRemoved = handler.getNumShortcutsRemoved();
+
+      // Get lists
+      m_strXMLErrors = handler.getXMLErrors();
+      m_strSkippedList = handler.getSkippedList();
+      m_strPWHErrorList = handler.getPWHErrorList();
+      m_strRenameList = handler.getRenameList();
+
+      if (b_into_empty) {
+        handler.AddDBPreferences();
+      }
+    }
+  }
+
+  return !bErrorOccurred;
+}
+
+#endif /* USE_XML_LIBRARY */
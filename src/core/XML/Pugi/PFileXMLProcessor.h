@@ -0,0 +1,72 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+
+/*
+* This routine processes File XML using pugixml, as shipped in core/pugixml,
+* in place of Xerces (USE_XML_LIBRARY == PUGIXML).
+*
+* See PXMLDocument.h and PFileHandlers.h for how it differs.
+*/
+
+#ifndef __PFILEXMLPROCESSOR_H
+#define __PFILEXMLPROCESSOR_H
+
+// PWS includes
+#include "PFileHandlers.h"
+
+#include "../../UnknownField.h"
+#include "os/typedefs.h"
+#include "os/UUID.h"
+
+class PWScore;
+
+class PFileXMLProcessor
+{
+public:
+  PFileXMLProcessor(PWScore *pcore, UUIDVector *pPossible_Aliases,
+                    UUIDVector *pPossible_Shortcuts, MultiCommands *p_multicmds,
+                    CReport *prpt);
+  ~PFileXMLProcessor();
+
+  // As XFileXMLProcessor::Process(), but strXSDFileName isn't needed
+  bool Process(const bool &bvalidation, const stringT &ImportedPrefix,
+               const stringT &strXMLFileName, const stringT &strXSDFileName,
+               const bool &bImportPSWDsOnly);
+
+  stringT getXMLErrors() {return m_strXMLErrors;}
+  stringT getRenameList() {return m_strRenameList;}
+  stringT getPWHErrorList() {return m_strPWHErrorList;}
+  stringT getSkippedList() {return m_strSkippedList;}
+  bool getIfValidationErrors() const {return m_bValidationErrors;}
+
+  int getNumEntriesValidated() {return m_numEntriesValidated;}
+  int getNumEntriesImported() {return m_numEntriesImported;}
+  int getNumEntriesSkipped() {return m_numEntriesSkipped;}
+  int getNumEntriesRenamed() {return m_numEntriesRenamed;}
+  int getNumEntriesPWHErrors() {return m_numEntriesPWHErrors;}
+  int getNumNoPolicies() {return m_numNoPolicies;}
+  int getNumRenamedPolicies() const {return m_numRenamedPolicies;}
+  int getNumShortcutsRemoved() const {return m_numShortcutsRemoved;}
+
+private:
+  PWScore *m_pXMLcore;
+  UUIDVector *m_pPossible_Aliases;
+  UUIDVector *m_pPossible_Shortcuts;
+  MultiCommands *m_pmulticmds;
+  CReport *m_prpt;
+
+  stringT m_strXMLErrors, m_strSkippedList, m_strRenameList, m_strPWHErrorList;
+  int m_numEntriesValidated, m_numEntriesImported, m_numEntriesSkipped;
+  int m_numEntriesPWHErrors, m_numEntriesRenamed;
+  int m_numRenamedPolicies, m_numNoPolicies;
+  int m_numShortcutsRemoved;
+  TCHAR m_delimiter;
+  bool m_bValidation, m_bValidationErrors;
+};
+
+#endif /* __PFILEXMLPROCESSOR_H */
@@ -0,0 +1,349 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+
+#include "../XMLDefs.h"    // Required if testing "USE_XML_LIBRARY"
+
+#ifdef USE_XML_LIBRARY
+
+// PWS includes
+#include "PFilterHandlers.h"
+
+#include "../../core.h"
+
+#include "../../StringXStream.h"
+
+// Where filters, filter and filter_entry elements must be, and no others,
+// then the fields of the entries
+enum {FILTERS_LEVEL, FILTER_LEVEL, FILTER_ENTRY_LEVEL, FIELD_LEVEL};
+
+/*
+* The filter_group elements, i.e. the fields, as in lumimaja_filter.xsd:
+* each has a logic, between the kind of rule and the kind(s) of test it
+* has, if any.
+*/
+
+static const struct {
+  const TCHAR *rule; const TCHAR *tests; const TCHAR *elements;
+} FieldTypes[] = {
+  {_T("string"), _T("string"), _T("grouptitle title policy_name")},
+  {_T("stringpresent"), _T("string"),
+   _T("group user notes url runcommand email autotype symbols")},
+  {_T("password"), _T("password"), _T("password history_passwords")},
+  {_T("integer"), _T("integer"),
+   _T("password_expiry_interval history_number history_maximum policy_length ")
+   _T("policy_number_lowercase policy_number_uppercase policy_number_digits ")
+   _T("policy_number_symbols password_length")},
+  {_T("integer"), _T("size"), _T("entrysize")},
+  {_T("date"), _T("date dateint"),
+   _T("create_time password_modified_time last_access_time expiry_time ")
+   _T("record_modified_time history_changedate")},
+  {_T("is"), _T("dca"), _T("DCA ShiftDCA")},
+  {_T("is"), _T("entrytype"), _T("entrytype")},
+  {_T("is"), _T("entrystatus"), _T("entrystatus")},
+  {_T("is"), NULL, _T("protected")},
+  {_T("present"), NULL, _T("kbshortcut history_present policy_present unknownfields")},
+  {_T("active"), NULL, _T("history_active")},
+  {_T("set"), NULL, _T("policy_easyvision policy_pronounceable policy_hexadecimal")},
+  {NULL, NULL, _T("password_history password_policy")},
+};
+
+static const struct {
+  const TCHAR *rule; const TCHAR *type;
+} RuleTypes[] = {
+  {_T("password"), _T("enum EQ NE BE NB EN ND CO NC RX NX GL NG EX WX")},
+  {_T("string"), _T("enum EQ NE BE NB EN ND CO NC CY NY CA NA RX NX GL NG")},
+  {_T("stringpresent"), _T("enum EQ NE PR NP BE NB EN ND CO NC CY NY CA NA RX NX GL NG")},
+  {_T("integer"), _T("enum EQ NE PR NP BT LT LE GT GE")},
+  {_T("date"), _T("enum EQ NE PR NP BT BF AF")},
+  {_T("is"), _T("enum IS NI")},
+  {_T("present"), _T("enum PR NP")},
+  {_T("active"), _T("enum AC IA")},
+  {_T("set"), _T("enum SE NS")},
+};
+
+// The elements of each kind of test, in their order, with their types
+static const struct {
+  const TCHAR *test; const TCHAR *element; const TCHAR *type;
+} TestElements[] = {
+  {_T("password"), _T("string"), _T("string")},
+  {_T("password"), _T("case"), _T("int 0 1")},
+  {_T("password"), _T("warn"), _T("int")},
+  {_T("string"), _T("string"), _T("string")},
+  {_T("string"), _T("case"), _T("int 0 1")},
+  {_T("integer"), _T("num1"), _T("int")},
+  {_T("integer"), _T("num2"), _T("int")},
+  {_T("size"), _T("num1"), _T("int")},
+  {_T("size"), _T("num2"), _T("int")},
+  {_T("size"), _T("unit"), _T("int 0 2")},
+  {_T("date"), _T("date1"), _T("date")},
+  {_T("date"), _T("date2"), _T("date")},
+  {_T("dateint"), _T("num1"), _T("int -3650 3650")},
+  {_T("dateint"), _T("num2"), _T("int -3650 3650")},
+  {_T("entrytype"), _T("type"), _T("enum normal alias shortcut aliasbase shortcutbase")},
+  {_T("entrystatus"), _T("status"), _T("enum clean added modified")},
+  {_T("dca"), _T("dca"), _T("int 0 9")},
+};
+
+static const struct {
+  const TCHAR *element; const TCHAR *attribute; const TCHAR *type; bool bRequired;
+} ElementAttributes[] = {
+  {_T("filters"), _T("version"), _T("int 1 2147483647"), true},
+  {_T("filters"), _T("Database"), _T("string"), false},
+  {_T("filters"), _T("ExportTimeStamp"), _T("dateTime"), false},
+  {_T("filters"), _T("FromDatabaseFormat"), _T("string"), false},
+  {_T("filters"), _T("WhatSaved"), _T("string"), false},
+  {_T("filters"), _T("WhoSaved"), _T("string"), false},
+  {_T("filters"), _T("WhenLastSaved"), _T("dateTime"), false},
+  {_T("filters"), _T("Database_uuid"), _T("fileuuid"), false},
+  {_T("filter"), _T("filtername"), _T("nonblank"), true},
+  {_T("filter_entry"), _T("active"), _T("enum yes no"), false},
+};
+
+PFilterHandlers::PFilterHandlers()
+  : m_pdoc(NULL)
+{
+  std::map<stringT, PSchemaType> mapRules;
+  for (size_t i = 0; i < NumberOf(RuleTypes); i++)
+    mapRules[RuleTypes[i].rule] = PSchemaType(RuleTypes[i].type);
+  for (size_t i = 0; i < NumberOf(TestElements); i++) {
+    m_mapTests[TestElements[i].test].push_back(
+      SequenceElement(TestElements[i].element, PSchemaType(TestElements[i].type)));
+  }
+
+  const PSchemaType logic(_T("enum and or"));
+  for (size_t i = 0; i < NumberOf(FieldTypes); i++) {
+    Field field;
+    if (FieldTypes[i].rule != NULL)
+      field.sequence.push_back(SequenceElement(_T("rule"), mapRules[FieldTypes[i].rule]));
+    field.sequence.push_back(SequenceElement(_T("logic"), logic));
+    if (FieldTypes[i].tests != NULL) {
+      field.sequence.push_back(SequenceElement(_T("test"), PSchemaType(), false));
+      istringstreamT is(FieldTypes[i].tests);
+      stringT strTest;
+      while (is >> strTest)
+        field.vtests.push_back(&m_mapTests[strTest]);
+    }
+
+    istringstreamT is(FieldTypes[i].elements);
+    stringT strElement;
+    while (is >> strElement)
+      m_mapFields[strElement] = field;
+  }
+
+  for (size_t i = 0; i < NumberOf(ElementAttributes); i++)
+    m_attributes.Add(ElementAttributes[i].element, ElementAttributes[i].attribute,
+                     ElementAttributes[i].type, ElementAttributes[i].bRequired);
+}
+
+PFilterHandlers::~PFilterHandlers()
+{
+}
+
+void PFilterHandlers::LoadError(const PXMLDocument &doc)
+{
+  doc.FormatError(m_strValidationResult, pugi::xml_node(), doc.GetError(),
+                  SAX2_FATALERROR);
+  m_bErrors = true;
+}
+
+void PFilterHandlers::Error(const pugi::xml_node &node, const stringT &message)
+{
+  m_pdoc->FormatError(m_strValidationResult, node, message);
+  m_bErrors = true;
+}
+
+bool PFilterHandlers::CheckSequence(const pugi::xml_node &node, const Sequence &sequence)
+{
+  bool bValid(true);
+  stringT strMessage;
+  size_t i(0);
+  for (pugi::xml_node child = node.first_child(); child; child = child.next_sibling()) {
+    if (child.type() != pugi::node_element)
+      continue;
+
+    if (i == sequence.size() || _tcscmp(child.name(), sequence[i].name.c_str()) != 0) {
+      Format(strMessage, IDSC_XMLUNEXPECTEDELEMENT, child.name());
+      Error(child, strMessage);
+      return false;
+    }
+    if (sequence[i].bSimple) {
+      StringX sxValue;
+      for (pugi::xml_node text = child.first_child(); text; text = text.next_sibling()) {
+        switch (text.type()) {
+          case pugi::node_element:
+            Format(strMessage, IDSC_XMLUNEXPECTEDELEMENT, text.name());
+            Error(text, strMessage);
+            return false;
+          case pugi::node_pcdata:
+          case pugi::node_cdata:
+            sxValue += text.value();
+            break;
+          default:
+            break;
+        }
+      }
+      if (!sequence[i].type.IsValid(sxValue.c_str())) {
+        Format(strMessage, IDSC_XMLINVALIDVALUE, sxValue.c_str(), child.name());
+        Error(child, strMessage);
+        bValid = false;
+      }
+    }
+    i++;
+  }
+
+  if (i < sequence.size()) {
+    Format(strMessage, IDSC_XMLMISSINGELEMENT, sequence[i].name.c_str(), node.name());
+    Error(node, strMessage);
+    return false;
+  }
+  return bValid;
+}
+
+bool PFilterHandlers::CheckField(const pugi::xml_node &node)
+{
+  const Field &field = m_mapFields.find(node.name())->second;
+  if (!CheckSequence(node, field.sequence))
+    return false;
+  if (field.vtests.empty())
+    return true;
+
+  // Of the kinds of test the field may have, the one the test starts as
+  const pugi::xml_node test = node.child(_T("test"));
+  pugi::xml_node first = test.first_child();
+  while (first && first.type() != pugi::node_element)
+    first = first.next_sibling();
+  const Sequence *psequence = field.vtests.front();
+  for (size_t i = 0; first && i < field.vtests.size(); i++) {
+    if (field.vtests[i]->front().name == first.name())
+      psequence = field.vtests[i];
+  }
+  return CheckSequence(test, *psequence);
+}
+
+void PFilterHandlers::Process(const PXMLDocument &doc, const bool &bCheckVersion)
+{
+  m_pdoc = &doc;
+  m_strXMLErrors = _T("");
+  m_bEntryBeingProcessed = false;
+  m_setFilterNames.clear();
+
+  const pugi::xml_node root = doc.GetRoot();
+  if (bCheckVersion && _tcscmp(root.name(), _T("filters")) == 0) {
+    // Check that the XML file version is present and that it is less than
+    // or equal to the version supported by this PWS
+    const pugi::xml_attribute version = root.attribute(_T("version"));
+    stringT strMessage;
+    if (!version) {
+      LoadAString(strMessage, IDSC_MISSING_XML_VER);
+      Error(root, strMessage);
+      return;
+    }
+    if (version.as_int() > PWS_XML_FILTER_VERSION) {
+      Format(strMessage, IDSC_INVALID_XML_VER2, version.as_int(), PWS_XML_FILTER_VERSION);
+      Error(root, strMessage);
+      return;
+    }
+  }
+
+  ProcessElement(root, FILTERS_LEVEL);
+}
+
+void PFilterHandlers::ProcessElement(const pugi::xml_node &node, const int level)
+{
+  const TCHAR *name = node.name();
+  bool bExpected;
+  switch (level) {
+    case FILTERS_LEVEL:
+      bExpected = _tcscmp(name, _T("filters")) == 0;
+      break;
+    case FILTER_LEVEL:
+      bExpected = _tcscmp(name, _T("filter")) == 0;
+      break;
+    case FILTER_ENTRY_LEVEL:
+      bExpected = _tcscmp(name, _T("filter_entry")) == 0;
+      break;
+    case FIELD_LEVEL:
+      bExpected = m_mapFields.find(name) != m_mapFields.end();
+      break;
+    default:
+      // Anything else ProcessEndElement knows
+      bExpected = _tcscmp(name, _T("filters")) != 0 &&
+                  _tcscmp(name, _T("filter")) != 0 &&
+                  _tcscmp(name, _T("filter_entry")) != 0;
+      break;
+  }
+  stringT strMessage;
+  if (!bExpected) {
+    Format(strMessage, IDSC_XMLUNEXPECTEDELEMENT, name);
+    Error(node, strMessage);
+    return;
+  }
+
+  if (level < FIELD_LEVEL) {
+    if (!m_attributes.Check(*m_pdoc, node, name, m_strValidationResult))
+      m_bErrors = true;
+    if (level == FILTER_LEVEL) {
+      const TCHAR *szFilterName = node.attribute(_T("filtername")).value();
+      if (!m_setFilterNames.insert(szFilterName).second) {
+        Format(strMessage, IDSC_XMLDUPLICATEVALUE, szFilterName, _T("filtername"));
+        Error(node, strMessage);
+      }
+    }
+
+    // Each has at least one of what may be in it
+    static const TCHAR *Contents[] = {
+      _T("filter"), _T("filter_entry"), _T("filter_group"),
+    };
+    pugi::xml_node child = node.first_child();
+    while (child && child.type() != pugi::node_element)
+      child = child.next_sibling();
+    if (!child) {
+      Format(strMessage, IDSC_XMLMISSINGELEMENT, Contents[level], name);
+      Error(node, strMessage);
+    }
+  } else if (level == FIELD_LEVEL && !CheckField(node))
+    return;
+
+  if (XMLFilterHandlers::ProcessStartElement(name)) {
+    // Process the attributes we need.
+    if (level == FILTER_LEVEL) {
+      const pugi::xml_attribute filtername = node.attribute(_T("filtername"));
+      if (filtername)
+        cur_filter->fname = filtername.value();
+    } else if (level == FILTER_ENTRY_LEVEL) {
+      if (_tcscmp(node.attribute(_T("active")).value(), _T("no")) == 0)
+        cur_filterentry->bFilterActive = false;
+    }
+  }
+
+  StringX sxContent;
+  for (pugi::xml_node child = node.first_child(); child; child = child.next_sibling()) {
+    switch (child.type()) {
+      case pugi::node_element:
+        ProcessElement(child, level + 1);
+        break;
+      case pugi::node_pcdata:
+      case pugi::node_cdata:
+        sxContent += child.value();
+        break;
+      default:
+        break;
+    }
+  }
+
+  if (m_bValidation)
+    return;
+
+  m_sxElemContent = sxContent;
+  if (!XMLFilterHandlers::ProcessEndElement(name)) {
+    Format(strMessage, IDSC_XMLUNEXPECTEDELEMENT, name);
+    Error(node, strMessage);
+  }
+}
+
+#endif /* USE_XML_LIBRARY */
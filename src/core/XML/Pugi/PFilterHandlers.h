@@ -0,0 +1,81 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+
+/*
+* Walks a Filter XML document parsed by pugixml (see PXMLDocument), handing
+* each element to XMLFilterHandlers as the Xerces SAX2 handlers do.
+*
+* In place of validating against the schema, each element is checked as
+* Xerces would against lumimaja_filter.xsd: filters, filter and
+* filter_entry elements in their places, each with at least one of what
+* it holds and with valid attributes, the filter names being unique, and
+* each field with the rule, logic and test elements of its kind, in order,
+* their values being of their simple types (see PSchemaType).
+* PFilterXMLProcessor validates by importing into a scratch map, as that
+* also finds any element the import doesn't know, with the filters'
+* version checked too.
+*/
+
+#ifndef __PFILTERHANDLERS_H
+#define __PFILTERHANDLERS_H
+
+#include "PXMLDocument.h"
+#include "PSchemaType.h"
+
+#include "../XMLFilterHandlers.h"
+
+#include <map>
+#include <set>
+#include <vector>
+
+class PFilterHandlers : public XMLFilterHandlers
+{
+public:
+  PFilterHandlers();
+  virtual ~PFilterHandlers();
+
+  // Processes a document that loaded, as Xerces would parse it
+  void Process(const PXMLDocument &doc, const bool &bCheckVersion);
+  // Notes why a document didn't load
+  void LoadError(const PXMLDocument &doc);
+
+private:
+  PFilterHandlers(const PFilterHandlers &);            // Do not implement
+  PFilterHandlers &operator=(const PFilterHandlers &); // Do not implement
+
+  // An element of a sequence, each being there once, with its type if
+  // it's a simple one
+  struct SequenceElement {
+    SequenceElement(const stringT &name_, const PSchemaType &type_,
+                    const bool bSimple_ = true)
+      : name(name_), type(type_), bSimple(bSimple_) {}
+    stringT name;
+    PSchemaType type;
+    bool bSimple;
+  };
+  typedef std::vector<SequenceElement> Sequence;
+
+  // A field's sequence, and those its test may be
+  struct Field {
+    Sequence sequence;
+    std::vector<const Sequence *> vtests;
+  };
+
+  void ProcessElement(const pugi::xml_node &node, const int level);
+  bool CheckField(const pugi::xml_node &node);
+  bool CheckSequence(const pugi::xml_node &node, const Sequence &sequence);
+  void Error(const pugi::xml_node &node, const stringT &message);
+
+  const PXMLDocument *m_pdoc;
+  std::map<stringT, Sequence> m_mapTests;
+  std::map<stringT, Field, std::less<> > m_mapFields;
+  PSchemaAttributes m_attributes;
+  std::set<stringT> m_setFilterNames;
+};
+
+#endif /* __PFILTERHANDLERS_H */
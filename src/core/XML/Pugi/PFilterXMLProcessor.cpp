@@ -0,0 +1,75 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+
+/*
+* This routine processes Filter XML using pugixml, as shipped in core/pugixml,
+* in place of Xerces (USE_XML_LIBRARY == PUGIXML).
+*/
+
+#include "../XMLDefs.h"    // Required if testing "USE_XML_LIBRARY"
+
+#ifdef USE_XML_LIBRARY
+
+// PWS includes
+#include "PFilterXMLProcessor.h"
+#include "PXMLDocument.h"
+
+#include "../../core.h"
+
+PFilterXMLProcessor::PFilterXMLProcessor(PWSFilters &mapfilters, const FilterPool fpool,
+                                         Asker *pAsker)
+  : m_pAsker(pAsker), m_MapFilters(mapfilters), m_FPool(fpool), m_bValidation(false)
+{
+}
+
+PFilterXMLProcessor::~PFilterXMLProcessor()
+{
+}
+
+bool PFilterXMLProcessor::Process(const bool &bvalidation,
+                                  const StringX &strXMLData,
+                                  const stringT &strXMLFileName,
+                                  const stringT & /* strXSDFileName */)
+{
+  bool bErrorOccurred = false;
+  stringT cs_validation;
+  LoadAString(cs_validation, IDSC_XMLVALIDATION);
+  stringT cs_import;
+  LoadAString(cs_import, IDSC_XMLIMPORT);
+  m_bValidation = bvalidation;  // Validate or Import
+
+  // Validation is an import into a scratch map, without asking whether to
+  // replace filters, so that nothing's imported for real from a document
+  // with elements the import doesn't know
+  PWSFilters scratch_filters;
+  PFilterHandlers handler;
+  handler.SetVariables(m_bValidation ? NULL : m_pAsker,
+                       m_bValidation ? &scratch_filters : &m_MapFilters,
+                       m_FPool, false);
+
+  PXMLDocument doc;
+  const bool bLoaded = strXMLFileName.empty() ?
+                         doc.Load(strXMLData) : doc.Load(strXMLFileName);
+  if (bLoaded)
+    handler.Process(doc, m_bValidation);
+  else
+    handler.LoadError(doc);
+
+  if (handler.getIfErrors()) {
+    bErrorOccurred = true;
+    Format(m_strXMLErrors, IDSC_XERCESPARSEERROR,
+           m_bValidation ? cs_validation.c_str() : cs_import.c_str(),
+           handler.getValidationResult().c_str());
+  } else {
+    m_strXMLErrors = _T("");
+  }
+
+  return !bErrorOccurred;
+}
+
+#endif /* USE_XML_LIBRARY */
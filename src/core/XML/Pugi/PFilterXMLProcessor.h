@@ -0,0 +1,49 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+
+/*
+* This routine processes Filter XML using pugixml, as shipped in core/pugixml,
+* in place of Xerces (USE_XML_LIBRARY == PUGIXML).
+*
+* See PXMLDocument.h and PFilterHandlers.h for how it differs.
+*/
+
+#ifndef __PFILTERXMLPROCESSOR_H
+#define __PFILTERXMLPROCESSOR_H
+
+#include "PFilterHandlers.h"
+
+// PWS includes
+#include "../../StringX.h"
+#include "../../PWSFilters.h"
+#include "../../Proxy.h"
+
+class PFilterXMLProcessor
+{
+public:
+  PFilterXMLProcessor(PWSFilters &mapfilters, const FilterPool fpool, Asker *pAsker);
+  ~PFilterXMLProcessor();
+
+  // As XFilterXMLProcessor::Process(), but strXSDFileName isn't needed
+  bool Process(const bool &bvalidation,
+               const StringX &strXMLData,
+               const stringT &strXMLFileName,
+               const stringT &strXSDFileName);
+
+  stringT getXMLErrors() {return m_strXMLErrors;}
+
+private:
+  PFilterXMLProcessor& operator=(const PFilterXMLProcessor&); // Do not implement
+  Asker *m_pAsker;
+  PWSFilters &m_MapFilters;
+  FilterPool m_FPool;
+  stringT m_strXMLErrors;
+  bool m_bValidation;
+};
+
+#endif /* __PFILTERXMLPROCESSOR_H */
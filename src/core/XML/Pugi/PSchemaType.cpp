@@ -0,0 +1,222 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+
+#include "../XMLDefs.h"    // Required if testing "USE_XML_LIBRARY"
+
+#ifdef USE_XML_LIBRARY
+
+#include "PSchemaType.h"
+
+#include "../../core.h"
+#include "../../StringXStream.h"
+#include "../../VerifyFormat.h"
+
+#include "os/debug.h"
+#include "os/pws_tchar.h"
+
+#include <climits>
+
+static bool IsXMLSpace(const TCHAR c)
+{
+  return c == _T(' ') || c == _T('\t') || c == _T('\r') || c == _T('\n');
+}
+
+static bool IsHexDigit(const TCHAR c)
+{
+  return (c >= _T('0') && c <= _T('9')) ||
+         (c >= _T('a') && c <= _T('f')) || (c >= _T('A') && c <= _T('F'));
+}
+
+static bool IsHexDigits(const stringT &str, size_t start, size_t len)
+{
+  for (size_t i = start; i < start + len; i++) {
+    if (!IsHexDigit(str[i]))
+      return false;
+  }
+  return true;
+}
+
+static bool IsInt(const stringT &str, long min, long max)
+{
+  size_t i = 0;
+  if (i < str.length() && (str[i] == _T('+') || str[i] == _T('-')))
+    i++;
+  if (i == str.length())
+    return false;
+
+  const bool bNegative = str[0] == _T('-');
+  long long value = 0;
+  for (; i < str.length(); i++) {
+    if (str[i] < _T('0') || str[i] > _T('9'))
+      return false;
+    // Whatever's beyond an int is out of range of any of them
+    if (value <= INT_MAX)
+      value = value * 10 + (str[i] - _T('0'));
+  }
+  if (bNegative)
+    value = -value;
+  return value >= min && value <= max;
+}
+
+PSchemaType::PSchemaType()
+  : m_kind(ST_STRING), m_min(0), m_max(0)
+{
+}
+
+PSchemaType::PSchemaType(const stringT &strType)
+  : m_kind(ST_STRING), m_min(INT_MIN), m_max(INT_MAX)
+{
+  istringstreamT is(strType);
+  stringT strKind;
+  is >> strKind;
+  if (strKind == _T("int")) {
+    m_kind = ST_INT;
+    long min, max;
+    if (is >> min >> max) {
+      m_min = min;
+      m_max = max;
+    }
+  } else if (strKind == _T("boolean")) {
+    m_kind = ST_BOOLEAN;
+  } else if (strKind == _T("dateTime")) {
+    m_kind = ST_DATETIME;
+  } else if (strKind == _T("date")) {
+    m_kind = ST_DATE;
+  } else if (strKind == _T("hexBinary")) {
+    m_kind = ST_HEXBINARY;
+    is >> m_min;
+  } else if (strKind == _T("kbshortcut")) {
+    m_kind = ST_KBSHORTCUT;
+  } else if (strKind == _T("fileuuid")) {
+    m_kind = ST_FILEUUID;
+  } else if (strKind == _T("char")) {
+    m_kind = ST_CHAR;
+  } else if (strKind == _T("nonblank")) {
+    m_kind = ST_NONBLANK;
+  } else if (strKind == _T("enum")) {
+    m_kind = ST_ENUM;
+    stringT strValue;
+    while (is >> strValue)
+      m_values.insert(strValue);
+  } else {
+    ASSERT(strKind == _T("string"));
+  }
+}
+
+bool PSchemaType::IsValid(const TCHAR *value) const
+{
+  stringT str(value);
+  switch (m_kind) {
+    case ST_INT:
+    case ST_BOOLEAN:
+    case ST_DATETIME:
+    case ST_DATE:
+    case ST_HEXBINARY:
+    {
+      // Not being strings, their whitespace is collapsed
+      size_t start = 0, end = str.length();
+      while (start < end && IsXMLSpace(str[start]))
+        start++;
+      while (end > start && IsXMLSpace(str[end - 1]))
+        end--;
+      str = str.substr(start, end - start);
+      break;
+    }
+    default:
+      break;
+  }
+
+  time_t t;
+  switch (m_kind) {
+    case ST_STRING:
+      return true;
+    case ST_INT:
+      return IsInt(str, m_min, m_max);
+    case ST_BOOLEAN:
+      return str == _T("true") || str == _T("false") ||
+             str == _T("1") || str == _T("0");
+    case ST_DATETIME:
+      return VerifyXMLDateTimeString(str, t);
+    case ST_DATE:
+      return VerifyXMLDateString(str, t);
+    case ST_HEXBINARY:
+      return str.length() == size_t(2 * m_min) && IsHexDigits(str, 0, str.length());
+    case ST_KBSHORTCUT:
+    {
+      const size_t colon = str.find(_T(':'));
+      if (colon == 0 || colon == stringT::npos || str.length() != colon + 5)
+        return false;
+      return str.find_first_not_of(_T("ACSEMWD")) == colon &&
+             IsHexDigits(str, colon + 1, 4);
+    }
+    case ST_FILEUUID:
+      return str.length() == 36 &&
+             str[8] == _T('-') && str[13] == _T('-') &&
+             str[18] == _T('-') && str[23] == _T('-') &&
+             IsHexDigits(str, 0, 8) && IsHexDigits(str, 9, 4) &&
+             IsHexDigits(str, 14, 4) && IsHexDigits(str, 19, 4) &&
+             IsHexDigits(str, 24, 12);
+    case ST_CHAR:
+      return str.length() == 1;
+    case ST_NONBLANK:
+      return !str.empty();
+    case ST_ENUM:
+      return m_values.find(str) != m_values.end();
+    default:
+      ASSERT(0);
+      return false;
+  }
+}
+
+void PSchemaAttributes::Add(const TCHAR *element, const TCHAR *attribute,
+                            const TCHAR *type, const bool bRequired)
+{
+  Attribute &attr = m_mapAttributes[element][attribute];
+  attr.type = PSchemaType(type);
+  attr.bRequired = bRequired;
+}
+
+bool PSchemaAttributes::Check(const PXMLDocument &doc, const pugi::xml_node &node,
+                              const TCHAR *element, stringT &errors) const
+{
+  bool bValid(true);
+  stringT strMessage;
+  const std::map<stringT, AttributeTypes, std::less<> >::const_iterator iter =
+    m_mapAttributes.find(element);
+  for (pugi::xml_attribute attr = node.first_attribute(); attr;
+       attr = attr.next_attribute()) {
+    const TCHAR *name = attr.name();
+    if (_tcsncmp(name, _T("xmlns"), 5) == 0 || _tcsncmp(name, _T("xsi:"), 4) == 0)
+      continue;
+
+    AttributeTypes::const_iterator iter_attr;
+    if (iter == m_mapAttributes.end() ||
+        (iter_attr = iter->second.find(name)) == iter->second.end())
+      Format(strMessage, IDSC_XMLUNEXPECTEDATTRIBUTE, name);
+    else if (!iter_attr->second.type.IsValid(attr.value()))
+      Format(strMessage, IDSC_XMLINVALIDVALUE, attr.value(), name);
+    else
+      continue;
+    doc.FormatError(errors, node, strMessage);
+    bValid = false;
+  }
+
+  if (iter == m_mapAttributes.end())
+    return bValid;
+  AttributeTypes::const_iterator iter_attr;
+  for (iter_attr = iter->second.begin(); iter_attr != iter->second.end(); iter_attr++) {
+    if (iter_attr->second.bRequired && !node.attribute(iter_attr->first.c_str())) {
+      Format(strMessage, IDSC_XMLMISSINGATTRIBUTE, iter_attr->first.c_str(), node.name());
+      doc.FormatError(errors, node, strMessage);
+      bValid = false;
+    }
+  }
+  return bValid;
+}
+
+#endif /* USE_XML_LIBRARY */
@@ -0,0 +1,87 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+
+/*
+* A simple type of lumimaja.xsd or lumimaja_filter.xsd, with its facets,
+* for the pugixml handlers to check element and attribute values against
+* as Xerces does when validating against the schema.
+*
+* The handlers describe each type in their tables as one of:
+*   "int [min max]"    xs:int, within [min, max] if given
+*   "boolean"          xs:boolean
+*   "dateTime"         xs:dateTime, as VerifyXMLDateTimeString() takes it
+*   "date"             xs:date, as VerifyXMLDateString() takes it
+*   "hexBinary length" xs:hexBinary of length bytes
+*   "kbshortcut"       (A|C|S|E|M|W|D)+:[0-9a-fA-F]{4}
+*   "fileuuid"         a database's uuid, as in its header
+*   "char"             one character
+*   "nonblank"         at least one character
+*   "enum value..."    one of the values
+*   "string"           anything
+* As in the schema, only the types derived from xs:string keep the
+* whitespace around their values.
+*/
+
+#ifndef __PSCHEMATYPE_H
+#define __PSCHEMATYPE_H
+
+#include "../XMLDefs.h"    // Required if testing "USE_XML_LIBRARY"
+
+#include "PXMLDocument.h"
+
+#include "../../StringX.h"
+
+#include <map>
+#include <set>
+
+class PSchemaType
+{
+public:
+  PSchemaType();
+  explicit PSchemaType(const stringT &strType);
+
+  bool IsValid(const TCHAR *value) const;
+
+private:
+  enum Kind {ST_STRING, ST_INT, ST_BOOLEAN, ST_DATETIME, ST_DATE, ST_HEXBINARY,
+             ST_KBSHORTCUT, ST_FILEUUID, ST_CHAR, ST_NONBLANK, ST_ENUM};
+
+  Kind m_kind;
+  long m_min, m_max;  // ST_INT's range, ST_HEXBINARY's length in m_min
+  std::set<stringT> m_values;
+};
+
+/*
+* The attributes a schema's elements may have, with their types and
+* whether they're required. Those of the XML namespaces and of the schema
+* instance namespace (xsi:) are Xerces' business, so allowed anywhere.
+*/
+
+class PSchemaAttributes
+{
+public:
+  void Add(const TCHAR *element, const TCHAR *attribute, const TCHAR *type,
+           const bool bRequired);
+
+  // Appends an error to errors, as doc formats them, for each of node's
+  // attributes that it may not have, or whose value isn't valid, and for
+  // each it should have and hasn't, taking node to be element. Returns
+  // whether there were none.
+  bool Check(const PXMLDocument &doc, const pugi::xml_node &node,
+             const TCHAR *element, stringT &errors) const;
+
+private:
+  struct Attribute {
+    PSchemaType type;
+    bool bRequired;
+  };
+  typedef std::map<stringT, Attribute, std::less<> > AttributeTypes;
+  std::map<stringT, AttributeTypes, std::less<> > m_mapAttributes;
+};
+
+#endif /* __PSCHEMATYPE_H */
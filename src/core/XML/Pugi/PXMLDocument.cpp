@@ -0,0 +1,206 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+
+#include "../XMLDefs.h"    // Required if testing "USE_XML_LIBRARY"
+
+#ifdef USE_XML_LIBRARY
+
+#include "PXMLDocument.h"
+
+#include "../../core.h"
+#include "../../Util.h"
+
+#include "os/file.h"
+#include "os/mem.h"
+
+#include <algorithm>
+
+PXMLDocument::PXMLDocument()
+  : m_buffer(NULL), m_size(0), m_length(0), m_error_offset(-1)
+{
+}
+
+PXMLDocument::~PXMLDocument()
+{
+  Free();
+}
+
+void PXMLDocument::Allocate(size_t len)
+{
+  Free();
+  m_size = len + 1;
+  m_buffer = new wchar_t[m_size];
+  m_length = 0;
+  pws_os::mlock(m_buffer, m_size * sizeof(wchar_t));
+  m_vlines.assign(1, 0);
+}
+
+void PXMLDocument::Free()
+{
+  // The document points into the buffer
+  m_doc.reset();
+  if (m_buffer != NULL) {
+    trashMemory(m_buffer, m_size);
+    pws_os::munlock(m_buffer, m_size * sizeof(wchar_t));
+    delete[] m_buffer;
+    m_buffer = NULL;
+  }
+  m_size = m_length = 0;
+  m_vlines.clear();
+  m_error_offset = -1;
+  m_strError = _T("");
+}
+
+bool PXMLDocument::Load(const stringT &strXMLFileName)
+{
+  size_t len;
+  const void *pmap = pws_os::MapFile(strXMLFileName, len);
+  if (pmap == NULL) {
+    // An empty file is no more readable than a missing one
+    Free();
+    LoadAString(m_strError, IDSC_FILE_UNREADABLE);
+    return false;
+  }
+
+  const bool bDecoded = Decode(static_cast<const unsigned char *>(pmap), len);
+  pws_os::UnmapFile(pmap, len);
+  return bDecoded && Parse();
+}
+
+bool PXMLDocument::Load(const StringX &strXMLData)
+{
+  Allocate(strXMLData.length());
+  std::copy(strXMLData.begin(), strXMLData.end(), m_buffer);
+  m_length = strXMLData.length();
+  m_buffer[m_length] = L'\0';
+  for (size_t i = 0; i < m_length; i++) {
+    if (m_buffer[i] == L'\n')
+      m_vlines.push_back(i + 1);
+  }
+  return Parse();
+}
+
+bool PXMLDocument::Decode(const unsigned char *pdata, size_t len)
+{
+  // Skip any byte order mark
+  if (len >= 3 && pdata[0] == 0xEF && pdata[1] == 0xBB && pdata[2] == 0xBF) {
+    pdata += 3;
+    len -= 3;
+  }
+
+  // There are never more characters than bytes
+  Allocate(len);
+  wchar_t *pw = m_buffer;
+  size_t i = 0;
+  while (i < len) {
+    unsigned int c = pdata[i];
+    if (c < 0x80) {
+      if (c == '\n')
+        m_vlines.push_back(size_t(pw - m_buffer) + 1);
+      *pw++ = wchar_t(c);
+      i++;
+      continue;
+    }
+
+    size_t n;
+    unsigned int cmin;
+    if ((c & 0xE0) == 0xC0) {
+      n = 2; c &= 0x1F; cmin = 0x80;
+    } else if ((c & 0xF0) == 0xE0) {
+      n = 3; c &= 0x0F; cmin = 0x800;
+    } else if ((c & 0xF8) == 0xF0) {
+      n = 4; c &= 0x07; cmin = 0x10000;
+    } else {
+      n = 0; cmin = 0;
+    }
+    bool bValid = n != 0 && i + n <= len;
+    for (size_t j = 1; bValid && j < n; j++) {
+      bValid = (pdata[i + j] & 0xC0) == 0x80;
+      c = (c << 6) | (pdata[i + j] & 0x3F);
+    }
+    // Overlong encodings, surrogates and beyond Unicode are as invalid
+    if (!bValid || c < cmin || c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF)) {
+      m_length = size_t(pw - m_buffer);
+      m_buffer[m_length] = L'\0';
+      m_error_offset = ptrdiff_t(m_length);
+      LoadAString(m_strError, IDSC_XMLINVALIDUTF8);
+      return false;
+    }
+    i += n;
+#if WCHAR_MAX <= 0xFFFF
+    if (c >= 0x10000) {
+      c -= 0x10000;
+      *pw++ = wchar_t(0xD800 + (c >> 10));
+      *pw++ = wchar_t(0xDC00 + (c & 0x3FF));
+      continue;
+    }
+#endif
+    *pw++ = wchar_t(c);
+  }
+  m_length = size_t(pw - m_buffer);
+  m_buffer[m_length] = L'\0';
+  return true;
+}
+
+bool PXMLDocument::Parse()
+{
+  // Whitespace is kept if it's all there is in an element, as a password
+  // may be nothing but
+  const pugi::xml_parse_result result =
+    m_doc.load_buffer_inplace(m_buffer, m_length * sizeof(wchar_t),
+                              pugi::parse_default | pugi::parse_ws_pcdata_single,
+                              pugi::encoding_wchar);
+  if (result)
+    return true;
+
+  m_error_offset = result.offset;
+  m_strError = pugi::as_wide(result.description());
+  return false;
+}
+
+void PXMLDocument::GetPosition(ptrdiff_t offset, int &line, int &character) const
+{
+  if (offset < 0 || m_vlines.empty()) {
+    line = character = 0;
+    return;
+  }
+  const std::vector<size_t>::const_iterator iter =
+    std::upper_bound(m_vlines.begin(), m_vlines.end(), size_t(offset)) - 1;
+  line = static_cast<int>(iter - m_vlines.begin()) + 1;
+  character = static_cast<int>(size_t(offset) - *iter) + 1;
+}
+
+void PXMLDocument::FormatError(stringT &errors, const pugi::xml_node &node,
+                               const stringT &message, const int type) const
+{
+  int iLineNumber, iCharacter;
+  GetPosition(node ? node.offset_debug() : m_error_offset, iLineNumber, iCharacter);
+
+  stringT cs_format, cs_errortype, FormatString;
+  LoadAString(cs_format, IDSC_XERCESSAXGENERROR);
+  switch (type) {
+    case SAX2_WARNING:
+      LoadAString(cs_errortype, IDSC_SAX2WARNING);
+      break;
+    case SAX2_ERROR:
+      LoadAString(cs_errortype, IDSC_SAX2ERROR);
+      break;
+    case SAX2_FATALERROR:
+      LoadAString(cs_errortype, IDSC_SAX2FATALERROR);
+      break;
+    default:
+      ASSERT(0);
+  }
+
+  Format(FormatString, cs_format.c_str(),
+         cs_errortype.c_str(), iLineNumber, iCharacter, message.c_str());
+
+  errors += FormatString + _T("\r\n");
+}
+
+#endif /* USE_XML_LIBRARY */
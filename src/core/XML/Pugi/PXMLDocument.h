@@ -0,0 +1,74 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+
+/*
+* An XML file or string parsed with pugixml, for the pugixml import of
+* File and Filter XML (USE_XML_LIBRARY == PUGIXML).
+*
+* The document is parsed in place, in a buffer that's locked in memory
+* and trashed when done with, as the XML imported holds the passwords in
+* the clear: all the element and attribute names and values parsed point
+* into it. As pugixml is built with wchar_t characters (see pugiconfig.hpp)
+* it can't parse the file's UTF-8 where it's mapped, so files are decoded
+* straight from the mapping into the buffer, noting where each line starts
+* on the way, to give the line and character of errors as Xerces does.
+*
+* Unlike Xerces, nothing is validated against the schema here: the
+* handlers walking the document check what the schema says as they go (see
+* PFileHandlers, PFilterHandlers).
+*/
+
+#ifndef __PXMLDOCUMENT_H
+#define __PXMLDOCUMENT_H
+
+#include "../XMLDefs.h"    // Required if testing "USE_XML_LIBRARY"
+
+#include "../../StringX.h"
+#include "../../pugixml/pugixml.hpp"
+
+#include <vector>
+
+class PXMLDocument
+{
+public:
+  PXMLDocument();
+  ~PXMLDocument();
+
+  // Both return false, with GetError() set, if the XML isn't well formed
+  bool Load(const stringT &strXMLFileName);
+  bool Load(const StringX &strXMLData);
+
+  pugi::xml_node GetRoot() const {return m_doc.document_element();}
+  stringT GetError() const {return m_strError;}
+
+  // Appends a message to errors, as the Xerces handlers format them: with
+  // the line and character (both from 1) of node or, if node is empty, of
+  // where the load failed
+  void FormatError(stringT &errors, const pugi::xml_node &node,
+                   const stringT &message, const int type = SAX2_ERROR) const;
+
+private:
+  PXMLDocument(const PXMLDocument &);            // Do not implement
+  PXMLDocument &operator=(const PXMLDocument &); // Do not implement
+
+  bool Decode(const unsigned char *pdata, size_t len);
+  bool Parse();
+  void GetPosition(ptrdiff_t offset, int &line, int &character) const;
+  void Allocate(size_t len);
+  void Free();
+
+  pugi::xml_document m_doc;
+  wchar_t *m_buffer;
+  size_t m_size;                  // characters allocated
+  size_t m_length;                // characters in m_buffer, bar the null
+  std::vector<size_t> m_vlines;   // where each line starts in m_buffer
+  ptrdiff_t m_error_offset;
+  stringT m_strError;
+};
+
+#endif /* __PXMLDOCUMENT_H */
@@ -13,6 +13,7 @@
 //#define EXPAT  1
 #define MSXML  2
 #define XERCES 3
+#define PUGIXML 4  // core/pugixml, no schema validation, see XML/Pugi
 
 #if USE_XML_LIBRARY == XERCES
 #ifndef XERCES_STATIC_LIBRARY
@@ -44,6 +44,9 @@ XMLFileHandlers::XMLFileHandlers()
   m_iErrorCode = 0;
 
   m_bheader = false;
+  m_bEntriesStarted = false;
+  m_bPolicyBeingProcessed = false;
+  m_bInPolicyNames = m_bInEmptyGroups = false;
   m_bDatabaseHeaderErrors = false;
   m_bRecordHeaderErrors = false;
   m_bErrors = false;
@@ -61,6 +64,9 @@ XMLFileHandlers::XMLFileHandlers()
 
 XMLFileHandlers::~XMLFileHandlers()
 {
+  // Only left if the parse stopped part way through an entry
+  delete m_cur_entry;
+  delete m_cur_pwhistory_entry;
   m_ukhxl.clear();
 }
 
@@ -86,6 +92,7 @@ bool XMLFileHandlers::ProcessStartElement(const int icurrent_element)
   switch (icurrent_element) {
     case XLE_PASSWORDSAFE:
       m_numEntries = 0;
+      m_numEntriesRead = 0;
       m_numEntriesSkipped = 0;
       m_numEntriesRenamed = 0;
       m_numEntriesPWHErrors = 0;
@@ -99,6 +106,12 @@ bool XMLFileHandlers::ProcessStartElement(const int icurrent_element)
       if (m_bValidation)
         return false;
 
+      // The schema has the preferences, policy names and empty groups
+      // before the first entry
+      if (!m_bEntriesStarted)
+        StartXMLEntries();
+
+      ASSERT(m_cur_entry == NULL);
       m_cur_entry = new pw_entry;
       // Clear all fields XXX Do we need this? The default c'tor should handle this for us
       m_cur_entry->id = 0;
@@ -179,8 +192,15 @@ void XMLFileHandlers::ProcessEndElement(const int icurrent_element)
 
   switch (icurrent_element) {
     case XLE_ENTRY:
-      m_ventries.push_back(m_cur_entry);
-      m_numEntries++;
+      m_numEntriesRead++;
+      // Nothing more is added once the file is known to be in error, as
+      // the import will be abandoned
+      if (!m_bErrors) {
+        m_numEntries++;
+        AddXMLEntry(m_cur_entry);
+      }
+      delete m_cur_entry;
+      m_cur_entry = NULL;
       break;
 
     case XLE_PREFERENCES:
@@ -501,8 +521,10 @@ void XMLFileHandlers::ProcessEndElement(const int icurrent_element)
     PWSprefs::GetInstance()->SetPref(spref, m_sxElemContent, true);
 }
 
-void XMLFileHandlers::AddXMLEntries()
+void XMLFileHandlers::StartXMLEntries()
 {
+  m_bEntriesStarted = true;
+
   // First add any Policy Names imported that are not already in the database
   // This must be done prior to importing entries that may reference them
   if (!m_MapPSWDPLC.empty()) {
@@ -523,335 +545,332 @@ void XMLFileHandlers::AddXMLEntries()
   PWPolicy st_to_default_pp, st_import_default_pp;
   st_to_default_pp = PWSprefs::GetInstance()->GetDefaultPolicy();
   st_import_default_pp = PWSprefs::GetInstance()->GetDefaultPolicy(true);
-  const bool bPWPDefaults_Different = st_to_default_pp != st_import_default_pp;
+  m_import_default_pwp = st_import_default_pp;
+  m_bPWPDefaults_Different = st_to_default_pp != st_import_default_pp;
 
-  StringX sxEntriesWithNewNamedPolicies;
-  vdb_entries::iterator entry_iter;
-  CItemData ci_temp;
-  bool bMaintainDateTimeStamps = PWSprefs::GetInstance()->
+  m_sxEntriesWithNewNamedPolicies = _T("");
+  m_bMaintainDateTimeStamps = PWSprefs::GetInstance()->
               GetPref(PWSprefs::MaintainDateTimeStamps);
-  bool bIntoEmpty = m_pXMLcore->GetNumEntries() == 0;
+  m_bIntoEmpty = m_pXMLcore->GetNumEntries() == 0;
 
   // Initialize sets
-  GTUSet setGTU;
-  m_pXMLcore->InitialiseGTU(setGTU);
-  UUIDSet setUUID;
-  m_pXMLcore->InitialiseUUID(setUUID);
+  m_setGTU.clear();
+  m_pXMLcore->InitialiseGTU(m_setGTU);
+  m_setUUID.clear();
+  m_pXMLcore->InitialiseUUID(m_setUUID);
 
   Command *pcmd1 = UpdateGUICommand::Create(m_pXMLcore,
                                             UpdateGUICommand::WN_UNDO,
                                             UpdateGUICommand::GUI_UNDO_IMPORT);
   m_pmulticmds->Add(pcmd1);
+}
 
-  for (entry_iter = m_ventries.begin(); entry_iter != m_ventries.end(); entry_iter++) {
-    bool bNoPolicy(false);
-    pw_entry *cur_entry = *entry_iter;
-    StringX sxtitle(cur_entry->title);
-    StringX sxMissingPolicyName;
-    EmptyIfOnlyWhiteSpace(sxtitle);
-    // Title and Password are mandatory fields!
-    if (sxtitle.empty() || cur_entry->password.empty()) {
-      stringT cs_error, cs_temp, cs_id, cs_tp, cs_t(_T("")), cs_p(_T(""));
-      int num = 0;
-      if (sxtitle.empty()) {
-        num++;
-        cs_t = CItemData::EngFieldName(CItemData::TITLE);
-      }
-      if (cur_entry->password.empty()) {
-        num++;
-        cs_p = CItemData::EngFieldName(CItemData::PASSWORD);
-      }
+void XMLFileHandlers::AddXMLEntry(pw_entry *cur_entry)
+{
+  bool bNoPolicy(false);
+  CItemData ci_temp;
+  StringX sxtitle(cur_entry->title);
+  StringX sxMissingPolicyName;
+  EmptyIfOnlyWhiteSpace(sxtitle);
+  // Title and Password are mandatory fields!
+  if (sxtitle.empty() || cur_entry->password.empty()) {
+    stringT cs_error, cs_temp, cs_id, cs_tp, cs_t(_T("")), cs_p(_T(""));
+    int num = 0;
+    if (sxtitle.empty()) {
+      num++;
+      cs_t = CItemData::EngFieldName(CItemData::TITLE);
+    }
+    if (cur_entry->password.empty()) {
+      num++;
+      cs_p = CItemData::EngFieldName(CItemData::PASSWORD);
+    }
 
-      Format(cs_tp, _T("%s%s%s"), cs_t.c_str(), num == 2 ? _T(" & ") : _T(""), cs_p.c_str());
-      stringT::iterator new_end = std::remove(cs_tp.begin(), cs_tp.end(), TCHAR('\t'));
-      cs_tp.erase(new_end, cs_tp.end());
+    Format(cs_tp, _T("%s%s%s"), cs_t.c_str(), num == 2 ? _T(" & ") : _T(""), cs_p.c_str());
+    stringT::iterator new_end = std::remove(cs_tp.begin(), cs_tp.end(), TCHAR('\t'));
+    cs_tp.erase(new_end, cs_tp.end());
+
+    LoadAString(cs_id, IDSC_IMPORT_ENTRY_ID);
+    Format(cs_temp, IDSC_IMPORTENTRY, cs_id.c_str(), cur_entry->id,
+           cur_entry->group.c_str(), cur_entry->title.c_str(), cur_entry->username.c_str());
+    Format(cs_error, IDSC_IMPORTRECSKIPPED, cs_temp.c_str(), cs_tp.c_str());
+    m_strSkippedList += cs_error;
+    m_numEntriesSkipped++;
+    m_numEntries--;
+    return;
+  }
 
+  if (m_bImportPSWDsOnly) {
+    ItemListIter iter = m_pXMLcore->Find(cur_entry->group, cur_entry->title, cur_entry->username);
+    if (iter == m_pXMLcore->GetEntryEndIter()) {
+      stringT cs_error, cs_id, cs_temp;
       LoadAString(cs_id, IDSC_IMPORT_ENTRY_ID);
       Format(cs_temp, IDSC_IMPORTENTRY, cs_id.c_str(), cur_entry->id,
              cur_entry->group.c_str(), cur_entry->title.c_str(), cur_entry->username.c_str());
-      Format(cs_error, IDSC_IMPORTRECSKIPPED, cs_temp.c_str(), cs_tp.c_str());
+      Format(cs_error, IDSC_IMPORTRECNOTFOUND, cs_temp.c_str());
+
       m_strSkippedList += cs_error;
       m_numEntriesSkipped++;
       m_numEntries--;
-      delete cur_entry;
-      continue;
-    }
-
-    if (m_bImportPSWDsOnly) {
-      ItemListIter iter = m_pXMLcore->Find(cur_entry->group, cur_entry->title, cur_entry->username);
-      if (iter == m_pXMLcore->GetEntryEndIter()) {
-        stringT cs_error, cs_id, cs_temp;
-        LoadAString(cs_id, IDSC_IMPORT_ENTRY_ID);
-        Format(cs_temp, IDSC_IMPORTENTRY, cs_id.c_str(), cur_entry->id,
-               cur_entry->group.c_str(), cur_entry->title.c_str(), cur_entry->username.c_str());
-        Format(cs_error, IDSC_IMPORTRECNOTFOUND, cs_temp.c_str());
-
-        m_strSkippedList += cs_error;
-        m_numEntriesSkipped++;
-        m_numEntries--;
-      } else {
-        CItemData *pci = &iter->second;
-        Command *pcmd = UpdatePasswordCommand::Create(m_pXMLcore, *pci,
-                                                      cur_entry->password);
-        pcmd->SetNoGUINotify();
-        m_pmulticmds->Add(pcmd);
-        if (bMaintainDateTimeStamps) {
-          pci->SetATime();
-        }
+    } else {
+      CItemData *pci = &iter->second;
+      Command *pcmd = UpdatePasswordCommand::Create(m_pXMLcore, *pci,
+                                                    cur_entry->password);
+      pcmd->SetNoGUINotify();
+      m_pmulticmds->Add(pcmd);
+      if (m_bMaintainDateTimeStamps) {
+        m_vATimeUpdates.push_back(pci->GetUUID());
       }
-      delete cur_entry;
-      continue;
     }
+    return;
+  }
 
-    uuid_array_t ua;
-    ci_temp.Clear();
-    bool bNewUUID(true);
-    if (!cur_entry->uuid.empty()) {
-      stringT temp = cur_entry->uuid.c_str();
-      // Verify it is the correct length (should be or the schema is wrong!)
-      if (temp.length() == sizeof(uuid_array_t) * 2) {
-        unsigned int x(0);
-        for (size_t i = 0; i < sizeof(uuid_array_t); i++) {
-          stringstreamT ss;
-          ss.str(temp.substr(i * 2, 2));
-          ss >> hex >> x;
-          ua[i] = static_cast<unsigned char>(x);
-        }
-        const CUUID uuid(ua);
-        if (uuid != CUUID::NullUUID()) {
-          UUIDSetPair pr_uuid = setUUID.insert(uuid);
-          if (pr_uuid.second) {
-            ci_temp.SetUUID(uuid);
-            bNewUUID = false;
-          }
+  uuid_array_t ua;
+  ci_temp.Clear();
+  bool bNewUUID(true);
+  if (!cur_entry->uuid.empty()) {
+    stringT temp = cur_entry->uuid.c_str();
+    // Verify it is the correct length (should be or the schema is wrong!)
+    if (temp.length() == sizeof(uuid_array_t) * 2) {
+      unsigned int x(0);
+      for (size_t i = 0; i < sizeof(uuid_array_t); i++) {
+        stringstreamT ss;
+        ss.str(temp.substr(i * 2, 2));
+        ss >> hex >> x;
+        ua[i] = static_cast<unsigned char>(x);
+      }
+      const CUUID uuid(ua);
+      if (uuid != CUUID::NullUUID()) {
+        UUIDSetPair pr_uuid = m_setUUID.insert(uuid);
+        if (pr_uuid.second) {
+          ci_temp.SetUUID(uuid);
+          bNewUUID = false;
         }
       }
     }
+  }
 
-    if (bNewUUID) {
-      // Need to create new UUID (missing or duplicate in DB or import file)
-      // and add to set
-      CUUID uuid;
-      setUUID.insert(uuid);
-      ci_temp.SetUUID(uuid);
-    }
-
-    StringX sxnewgroup, sxnewtitle(cur_entry->title);
-    if (!m_ImportedPrefix.empty()) {
-      sxnewgroup = m_ImportedPrefix.c_str();
-      if (!cur_entry->group.empty())
-         sxnewgroup += _T(".");
-    }
-    sxnewgroup += cur_entry->group;
-    EmptyIfOnlyWhiteSpace(sxnewgroup);
-    EmptyIfOnlyWhiteSpace(sxnewtitle);
-
-    bool conflict = !m_pXMLcore->MakeEntryUnique(setGTU,
-                                                 sxnewgroup, sxnewtitle,
-                                                 cur_entry->username,
-                                                 IDSC_IMPORTNUMBER);
-
-    if (conflict) {
-      stringT cs_header, cs_error;
-      if (cur_entry->group.empty())
-        LoadAString(cs_header, IDSC_IMPORTCONFLICTSX2);
-      else
-        Format(cs_header, IDSC_IMPORTCONFLICTSX1, cur_entry->group.c_str());
+  if (bNewUUID) {
+    // Need to create new UUID (missing or duplicate in DB or import file)
+    // and add to set
+    CUUID uuid;
+    m_setUUID.insert(uuid);
+    ci_temp.SetUUID(uuid);
+  }
 
-      Format(cs_error, IDSC_IMPORTCONFLICTS0, cs_header.c_str(),
-               cur_entry->title.c_str(), cur_entry->username.c_str(), sxnewtitle.c_str());
-      m_strRenameList += cs_error;
-      m_numEntriesRenamed++;
-    }
+  StringX sxnewgroup, sxnewtitle(cur_entry->title);
+  if (!m_ImportedPrefix.empty()) {
+    sxnewgroup = m_ImportedPrefix.c_str();
+    if (!cur_entry->group.empty())
+       sxnewgroup += _T(".");
+  }
+  sxnewgroup += cur_entry->group;
+  EmptyIfOnlyWhiteSpace(sxnewgroup);
+  EmptyIfOnlyWhiteSpace(sxnewtitle);
+
+  bool conflict = !m_pXMLcore->MakeEntryUnique(m_setGTU,
+                                               sxnewgroup, sxnewtitle,
+                                               cur_entry->username,
+                                               IDSC_IMPORTNUMBER);
+
+  if (conflict) {
+    stringT cs_header, cs_error;
+    if (cur_entry->group.empty())
+      LoadAString(cs_header, IDSC_IMPORTCONFLICTSX2);
+    else
+      Format(cs_header, IDSC_IMPORTCONFLICTSX1, cur_entry->group.c_str());
+
+    Format(cs_error, IDSC_IMPORTCONFLICTS0, cs_header.c_str(),
+             cur_entry->title.c_str(), cur_entry->username.c_str(), sxnewtitle.c_str());
+    m_strRenameList += cs_error;
+    m_numEntriesRenamed++;
+  }
 
-    ci_temp.SetGroup(sxnewgroup);
+  ci_temp.SetGroup(sxnewgroup);
 
-    if (!sxnewtitle.empty())
-      ci_temp.SetTitle(sxnewtitle, m_delimiter);
+  if (!sxnewtitle.empty())
+    ci_temp.SetTitle(sxnewtitle, m_delimiter);
 
-    EmptyIfOnlyWhiteSpace(cur_entry->username);
-    if (!cur_entry->username.empty())
-      ci_temp.SetUser(cur_entry->username);
+  EmptyIfOnlyWhiteSpace(cur_entry->username);
+  if (!cur_entry->username.empty())
+    ci_temp.SetUser(cur_entry->username);
 
-    if (!cur_entry->password.empty())
-      ci_temp.SetPassword(cur_entry->password);
+  if (!cur_entry->password.empty())
+    ci_temp.SetPassword(cur_entry->password);
 
-    EmptyIfOnlyWhiteSpace(cur_entry->url);
-    if (!cur_entry->url.empty())
-      ci_temp.SetURL(cur_entry->url);
+  EmptyIfOnlyWhiteSpace(cur_entry->url);
+  if (!cur_entry->url.empty())
+    ci_temp.SetURL(cur_entry->url);
 
-    EmptyIfOnlyWhiteSpace(cur_entry->autotype);
-    if (!cur_entry->autotype.empty())
-      ci_temp.SetAutoType(cur_entry->autotype);
+  EmptyIfOnlyWhiteSpace(cur_entry->autotype);
+  if (!cur_entry->autotype.empty())
+    ci_temp.SetAutoType(cur_entry->autotype);
 
-    if (!cur_entry->ctime.empty())
-      ci_temp.SetCTime(cur_entry->ctime.c_str());
+  if (!cur_entry->ctime.empty())
+    ci_temp.SetCTime(cur_entry->ctime.c_str());
 
-    if (!cur_entry->pmtime.empty())
-      ci_temp.SetPMTime(cur_entry->pmtime.c_str());
+  if (!cur_entry->pmtime.empty())
+    ci_temp.SetPMTime(cur_entry->pmtime.c_str());
 
-    if (!cur_entry->atime.empty())
-      ci_temp.SetATime(cur_entry->atime.c_str());
+  if (!cur_entry->atime.empty())
+    ci_temp.SetATime(cur_entry->atime.c_str());
 
-    if (!cur_entry->xtime.empty())
-      ci_temp.SetXTime(cur_entry->xtime.c_str());
+  if (!cur_entry->xtime.empty())
+    ci_temp.SetXTime(cur_entry->xtime.c_str());
 
-    if (!cur_entry->xtime_interval.empty()) {
-      int32 numdays = _ttoi(cur_entry->xtime_interval.c_str());
-      if (numdays > 0 && numdays <= 3650)
-        ci_temp.SetXTimeInt(numdays);
-    }
+  if (!cur_entry->xtime_interval.empty()) {
+    int32 numdays = _ttoi(cur_entry->xtime_interval.c_str());
+    if (numdays > 0 && numdays <= 3650)
+      ci_temp.SetXTimeInt(numdays);
+  }
 
-    if (!cur_entry->rmtime.empty())
-      ci_temp.SetRMTime(cur_entry->rmtime.c_str());
+  if (!cur_entry->rmtime.empty())
+    ci_temp.SetRMTime(cur_entry->rmtime.c_str());
 
-    if (!cur_entry->run_command.empty())
-      ci_temp.SetRunCommand(cur_entry->run_command);
+  if (!cur_entry->run_command.empty())
+    ci_temp.SetRunCommand(cur_entry->run_command);
 
-    if (cur_entry->pwp.flags != 0)
-      ci_temp.SetPWPolicy(cur_entry->pwp);
+  if (cur_entry->pwp.flags != 0)
+    ci_temp.SetPWPolicy(cur_entry->pwp);
 
-    if (!cur_entry->dca.empty())
-      ci_temp.SetDCA(cur_entry->dca.c_str());
+  if (!cur_entry->dca.empty())
+    ci_temp.SetDCA(cur_entry->dca.c_str());
 
-    if (!cur_entry->shiftdca.empty())
-      ci_temp.SetShiftDCA(cur_entry->shiftdca.c_str());
+  if (!cur_entry->shiftdca.empty())
+    ci_temp.SetShiftDCA(cur_entry->shiftdca.c_str());
 
-    if (!cur_entry->email.empty())
-      ci_temp.SetEmail(cur_entry->email);
+  if (!cur_entry->email.empty())
+    ci_temp.SetEmail(cur_entry->email);
 
-    if (cur_entry->ucprotected)
-      ci_temp.SetProtected(cur_entry->ucprotected != 0);
+  if (cur_entry->ucprotected)
+    ci_temp.SetProtected(cur_entry->ucprotected != 0);
 
-    if (!cur_entry->symbols.empty())
-      ci_temp.SetSymbols(cur_entry->symbols);
+  if (!cur_entry->symbols.empty())
+    ci_temp.SetSymbols(cur_entry->symbols);
 
-    if (cur_entry->policyname.empty()) {
-      // Not using a named password policy
-      if (cur_entry->pwp.flags == 0) {
-        // If no specific policy (meaning use default) and they are different,
-        // Make this entry have the imported default its specific policy
-        if (bPWPDefaults_Different) {
-          ci_temp.SetPWPolicy(st_import_default_pp);
-        }
-      } else {
-        // Has been imported with a specific password policy - set it
-        ci_temp.SetPWPolicy(cur_entry->pwp);
+  if (cur_entry->policyname.empty()) {
+    // Not using a named password policy
+    if (cur_entry->pwp.flags == 0) {
+      // If no specific policy (meaning use default) and they are different,
+      // Make this entry have the imported default its specific policy
+      if (m_bPWPDefaults_Different) {
+        ci_temp.SetPWPolicy(m_import_default_pwp);
       }
     } else {
-      // Using a named password policy
-      // Checks:
-      // 1. Are we about to add it?
-      // 2. If not, did we rename it?
-      // 3. Is it in our current DB?
-
-      if (m_MapPSWDPLC.find(cur_entry->policyname) == m_MapPSWDPLC.end()) {
-        // We are not about to add it - so
-        // Is it one we renamed because it exists in the current
-        // database but with different settings?
-        std::map<StringX, StringX>::const_iterator citer;
-        citer = m_mapRenamedPolicies.find(cur_entry->policyname);
-        if (citer != m_mapRenamedPolicies.end()) {
-          // Yes we did, so use renamed version
-          cur_entry->policyname = citer->second;
-          StringX sxChanged = L"\r\n\xab" + cur_entry->group    + L"\xbb " +
-                              L"\xab"     + cur_entry->title    + L"\xbb " +
-                              L"\xab"     + cur_entry->username + L"\xbb";
-          sxEntriesWithNewNamedPolicies += sxChanged;
-        } else {
-          // No we didn't, verify current database has it
-          PWPolicy currentDB_named_st_pp;
-          if (!m_pXMLcore->GetPolicyFromName(cur_entry->policyname, currentDB_named_st_pp)) {
-            // Not here - make a note and clear the name
-            // As we have no information about it's settings we can't even give
-            // this entry a specific policy
-            sxMissingPolicyName = cur_entry->policyname;
-            cur_entry->policyname = _T("");
-            m_numNoPolicies++;
-            bNoPolicy = true;
-          }
+      // Has been imported with a specific password policy - set it
+      ci_temp.SetPWPolicy(cur_entry->pwp);
+    }
+  } else {
+    // Using a named password policy
+    // Checks:
+    // 1. Are we about to add it?
+    // 2. If not, did we rename it?
+    // 3. Is it in our current DB?
+
+    if (m_MapPSWDPLC.find(cur_entry->policyname) == m_MapPSWDPLC.end()) {
+      // We are not about to add it - so
+      // Is it one we renamed because it exists in the current
+      // database but with different settings?
+      std::map<StringX, StringX>::const_iterator citer;
+      citer = m_mapRenamedPolicies.find(cur_entry->policyname);
+      if (citer != m_mapRenamedPolicies.end()) {
+        // Yes we did, so use renamed version
+        cur_entry->policyname = citer->second;
+        StringX sxChanged = L"\r\n\xab" + cur_entry->group    + L"\xbb " +
+                            L"\xab"     + cur_entry->title    + L"\xbb " +
+                            L"\xab"     + cur_entry->username + L"\xbb";
+        m_sxEntriesWithNewNamedPolicies += sxChanged;
+      } else {
+        // No we didn't, verify current database has it
+        PWPolicy currentDB_named_st_pp;
+        if (!m_pXMLcore->GetPolicyFromName(cur_entry->policyname, currentDB_named_st_pp)) {
+          // Not here - make a note and clear the name
+          // As we have no information about it's settings we can't even give
+          // this entry a specific policy
+          sxMissingPolicyName = cur_entry->policyname;
+          cur_entry->policyname = _T("");
+          m_numNoPolicies++;
+          bNoPolicy = true;
         }
       }
-      ci_temp.SetPolicyName(cur_entry->policyname);
     }
+    ci_temp.SetPolicyName(cur_entry->policyname);
+  }
 
-    if (!cur_entry->kbshortcut.empty()) {
-      ci_temp.SetKBShortcut(cur_entry->kbshortcut);
-    }
+  if (!cur_entry->kbshortcut.empty()) {
+    ci_temp.SetKBShortcut(cur_entry->kbshortcut);
+  }
 
-    StringX newPWHistory;
-    stringT strPWHErrorList;
+  StringX newPWHistory;
+  stringT strPWHErrorList;
 
-    switch (VerifyXMLImportPWHistoryString(cur_entry->pwhistory,
-                                           newPWHistory, strPWHErrorList)) {
-      case PWH_OK:
-        ci_temp.SetPWHistory(newPWHistory.c_str());
-        break;
-      case PWH_IGNORE:
-        break;
-      case PWH_INVALID_HDR:
-      case PWH_INVALID_STATUS:
-      case PWH_INVALID_NUM:
-      case PWH_INVALID_DATETIME:
-      case PWH_PSWD_LENGTH_NOTHEX:
-      case PWH_INVALID_PSWD_LENGTH:
-      case PWH_INVALID_FIELD_LENGTH:
-      {
-        stringT buffer;
-        Format(buffer, IDSC_SAXERRORPWH, cur_entry->group.c_str(),
-               cur_entry->title.c_str(),
-               cur_entry->username.c_str());
-        m_strPWHErrorList += buffer;
-        m_strPWHErrorList += strPWHErrorList;
-        m_numEntriesPWHErrors++;
-        break;
-      }
-      default:
-        ASSERT(0);
+  switch (VerifyXMLImportPWHistoryString(cur_entry->pwhistory,
+                                         newPWHistory, strPWHErrorList)) {
+    case PWH_OK:
+      ci_temp.SetPWHistory(newPWHistory.c_str());
+      break;
+    case PWH_IGNORE:
+      break;
+    case PWH_INVALID_HDR:
+    case PWH_INVALID_STATUS:
+    case PWH_INVALID_NUM:
+    case PWH_INVALID_DATETIME:
+    case PWH_PSWD_LENGTH_NOTHEX:
+    case PWH_INVALID_PSWD_LENGTH:
+    case PWH_INVALID_FIELD_LENGTH:
+    {
+      stringT buffer;
+      Format(buffer, IDSC_SAXERRORPWH, cur_entry->group.c_str(),
+             cur_entry->title.c_str(),
+             cur_entry->username.c_str());
+      m_strPWHErrorList += buffer;
+      m_strPWHErrorList += strPWHErrorList;
+      m_numEntriesPWHErrors++;
+      break;
     }
+    default:
+      ASSERT(0);
+  }
 
-    EmptyIfOnlyWhiteSpace(cur_entry->notes);
-    if (!cur_entry->notes.empty())
-      ci_temp.SetNotes(cur_entry->notes, m_delimiter);
+  EmptyIfOnlyWhiteSpace(cur_entry->notes);
+  if (!cur_entry->notes.empty())
+    ci_temp.SetNotes(cur_entry->notes, m_delimiter);
 
-    // If a potential alias, add to the vector for later verification and processing
-    if (cur_entry->entrytype == ALIAS && !cur_entry->bforce_normal_entry) {
-      m_pPossible_Aliases->push_back(ci_temp.GetUUID());
-    }
-    if (cur_entry->entrytype == SHORTCUT && !cur_entry->bforce_normal_entry) {
-      m_pPossible_Shortcuts->push_back(ci_temp.GetUUID());
-    }
-
-    if (!bIntoEmpty) {
-      ci_temp.SetStatus(CItemData::ES_ADDED);
-    }
+  // If a potential alias, add to the vector for later verification and processing
+  if (cur_entry->entrytype == ALIAS && !cur_entry->bforce_normal_entry) {
+    m_pPossible_Aliases->push_back(ci_temp.GetUUID());
+  }
+  if (cur_entry->entrytype == SHORTCUT && !cur_entry->bforce_normal_entry) {
+    m_pPossible_Shortcuts->push_back(ci_temp.GetUUID());
+  }
 
-    StringX sxImportedEntry;
-    // Use new group if the entries have been imported under a new level.
-    Format(sxImportedEntry, GROUPTITLEUSERINCHEVRONS,
-                        sxnewgroup.c_str(), cur_entry->title.c_str(),
-                        cur_entry->username.c_str());
-    m_prpt->WriteLine(sxImportedEntry.c_str());
+  if (!m_bIntoEmpty) {
+    ci_temp.SetStatus(CItemData::ES_ADDED);
+  }
 
-    if (bNoPolicy) {
-      Format(sxImportedEntry, IDSC_MISSINGPOLICYNAME, sxMissingPolicyName.c_str());
-      m_prpt->WriteLine(sxImportedEntry.c_str());
-    }
+  StringX sxImportedEntry;
+  // Use new group if the entries have been imported under a new level.
+  Format(sxImportedEntry, GROUPTITLEUSERINCHEVRONS,
+                      sxnewgroup.c_str(), cur_entry->title.c_str(),
+                      cur_entry->username.c_str());
+  m_vReportLines.push_back(sxImportedEntry);
 
-    // Need to check that entry keyboard shortcut not already in use!
-    int32 iKBShortcut;
-    ci_temp.GetKBShortcut(iKBShortcut);
-    
-    if (iKBShortcut != 0) {
-      // Check if already in use as an Entry Keyboard Shortcut
-      CUUID existingUUID = m_pXMLcore->GetKBShortcut(iKBShortcut);
-      if (existingUUID != CUUID::NullUUID()) {
-        // Remove it
-        ci_temp.SetKBShortcut(0);
-        ItemListIter iter = m_pXMLcore->Find(existingUUID);
-        if (iter == m_pXMLcore->GetEntryEndIter())
-          break;
+  if (bNoPolicy) {
+    Format(sxImportedEntry, IDSC_MISSINGPOLICYNAME, sxMissingPolicyName.c_str());
+    m_vReportLines.push_back(sxImportedEntry);
+  }
 
+  // Need to check that entry keyboard shortcut not already in use!
+  int32 iKBShortcut;
+  ci_temp.GetKBShortcut(iKBShortcut);
+  
+  if (iKBShortcut != 0) {
+    // Check if already in use as an Entry Keyboard Shortcut
+    CUUID existingUUID = m_pXMLcore->GetKBShortcut(iKBShortcut);
+    if (existingUUID != CUUID::NullUUID()) {
+      // Remove it
+      ci_temp.SetKBShortcut(0);
+      ItemListIter iter = m_pXMLcore->Find(existingUUID);
+      if (iter != m_pXMLcore->GetEntryEndIter()) {
         // Tell the user via the report
         StringX sxExistingEntry;
         Format(sxExistingEntry, GROUPTITLEUSERINCHEVRONS,
@@ -862,28 +881,48 @@ void XMLFileHandlers::AddXMLEntries()
         LoadAString(sxImported, IDSC_IMPORTED);
         Format(sxTemp, IDSC_KBSHORTCUT_REMOVED,
                sxImported.c_str(), sxImportedEntry.c_str(), sxExistingEntry.c_str(), sxImported.c_str());
-        m_prpt->WriteLine(sxTemp.c_str());
-        m_numShortcutsRemoved++;
-      }
-      // Check if already in use as an the PaswordSafe Application HotKey
-      if (m_pXMLcore->GetAppHotKey() == iKBShortcut) {
-        // Remove it
-        ci_temp.SetKBShortcut(0);
-
-        // Tell the user via the report
-        StringX sxTemp, sxImported;
-        LoadAString(sxImported, IDSC_IMPORTED);
-        Format(sxTemp, IDSC_KBSHORTCUT_USEBYAPP, sxImported.c_str(), sxImportedEntry.c_str());
-        m_prpt->WriteLine(sxTemp.c_str());
-        m_numShortcutsRemoved++;
+        m_vReportLines.push_back(sxTemp);
       }
+      m_numShortcutsRemoved++;
     }
-    m_pXMLcore->GUISetupDisplayInfo(ci_temp);
-    Command *pcmd = AddEntryCommand::Create(m_pXMLcore, ci_temp);
-    pcmd->SetNoGUINotify();
-    m_pmulticmds->Add(pcmd);
-    delete cur_entry;
+    // Check if already in use as an the PaswordSafe Application HotKey
+    if (m_pXMLcore->GetAppHotKey() == iKBShortcut) {
+      // Remove it
+      ci_temp.SetKBShortcut(0);
+
+      // Tell the user via the report
+      StringX sxTemp, sxImported;
+      LoadAString(sxImported, IDSC_IMPORTED);
+      Format(sxTemp, IDSC_KBSHORTCUT_USEBYAPP, sxImported.c_str(), sxImportedEntry.c_str());
+      m_vReportLines.push_back(sxTemp);
+      m_numShortcutsRemoved++;
+    }
+  }
+  m_pXMLcore->GUISetupDisplayInfo(ci_temp);
+  Command *pcmd = AddEntryCommand::Create(m_pXMLcore, ci_temp);
+  pcmd->SetNoGUINotify();
+  m_pmulticmds->Add(pcmd);
+}
+
+void XMLFileHandlers::EndXMLEntries()
+{
+  if (!m_bEntriesStarted)
+    StartXMLEntries();
+
+  // The whole file is valid, so what was held back for the entries can go ahead
+  std::vector<StringX>::const_iterator line_iter;
+  for (line_iter = m_vReportLines.begin(); line_iter != m_vReportLines.end(); line_iter++) {
+    m_prpt->WriteLine(line_iter->c_str());
+  }
+  m_vReportLines.clear();
+
+  UUIDVectorIter uuid_iter;
+  for (uuid_iter = m_vATimeUpdates.begin(); uuid_iter != m_vATimeUpdates.end(); uuid_iter++) {
+    ItemListIter iter = m_pXMLcore->Find(*uuid_iter);
+    if (iter != m_pXMLcore->GetEntryEndIter())
+      iter->second.SetATime();
   }
+  m_vATimeUpdates.clear();
 
   Command *pcmdA = AddDependentEntriesCommand::Create(m_pXMLcore, *m_pPossible_Aliases, m_prpt,
                                                       CItemData::ET_ALIAS,
@@ -901,10 +940,10 @@ void XMLFileHandlers::AddXMLEntries()
                                             UpdateGUICommand::GUI_REDO_IMPORT);
   m_pmulticmds->Add(pcmd2);
 
-  if (!sxEntriesWithNewNamedPolicies.empty()) {
+  if (!m_sxEntriesWithNewNamedPolicies.empty()) {
     StringX sxRenamedPolicies;
     Format(sxRenamedPolicies, IDSC_ENTRIES_POLICIES, m_sxXML_DateTime.c_str(),
-                sxEntriesWithNewNamedPolicies.c_str());
+                m_sxEntriesWithNewNamedPolicies.c_str());
     m_prpt->WriteLine();
     m_prpt->WriteLine(sxRenamedPolicies.c_str());
     m_prpt->WriteLine();
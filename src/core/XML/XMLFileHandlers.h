@@ -57,8 +57,6 @@ struct pwhistory_entry {
   StringX oldpassword;
 };
 
-typedef std::vector<pw_entry *> vdb_entries;
-
 class PWScore;
 
 class XMLFileHandlers
@@ -69,6 +67,7 @@ class XMLFileHandlers
 #elif USE_XML_LIBRARY == XERCES
   friend class XFileXMLProcessor;
 #endif
+  friend class PFileXMLProcessor;
 
 public:
   XMLFileHandlers();
@@ -88,11 +87,10 @@ public:
   stringT getPWHErrorList() const {return m_strPWHErrorList;}
   stringT getRenameList() const {return m_strRenameList;}
 
-  vdb_entries & getVDB_Entries() {return m_ventries;}
-
   TCHAR getDelimiter() const {return m_delimiter;}
 
   int getNumEntries() const {return m_numEntries;}
+  int getNumEntriesRead() const {return m_numEntriesRead;}
   int getNumSkipped() const {return m_numEntriesSkipped;}
   int getNumRenamed() const {return m_numEntriesRenamed;}
   int getNumPWHErrors() const {return m_numEntriesPWHErrors;}
@@ -106,12 +104,15 @@ public:
 protected:
   bool ProcessStartElement(const int icurrent_element);
   void ProcessEndElement(const int icurrent_element);
-  void AddXMLEntries();
+  // Entries are added as each is read: StartXMLEntries() adds what they
+  // may depend on, AddXMLEntry() each entry, and EndXMLEntries() the rest
+  void StartXMLEntries();
+  void AddXMLEntry(pw_entry *cur_entry);
+  void EndXMLEntries();
   void AddDBPreferences();
 
   PWPolicy currentDB_default_pwp, importDB_default_pwp;
 
-  vdb_entries m_ventries;
   pw_entry *m_cur_entry;
 
   StringX m_sxElemContent;
@@ -122,6 +123,7 @@ protected:
   stringT m_strSkippedList;
 
   int m_numEntries;
+  int m_numEntriesRead;
   int m_numEntriesSkipped;
   int m_numEntriesRenamed;
   int m_numEntriesPWHErrors;
@@ -133,6 +135,7 @@ protected:
   TCHAR m_delimiter;
 
   bool m_bEntryBeingProcessed;
+  bool m_bEntriesStarted;
   bool m_bPolicyBeingProcessed;
   bool m_bValidation;
   bool m_bInPolicyNames, m_bInEmptyGroups;
@@ -165,6 +168,19 @@ private:
   std::vector<StringX> m_vEmptyGroups;
   StringX m_sxXML_DateTime;
   pwhistory_entry *m_cur_pwhistory_entry;
+
+  // State kept from one imported entry to the next
+  GTUSet m_setGTU;
+  UUIDSet m_setUUID;
+  PWPolicy m_import_default_pwp;
+  bool m_bPWPDefaults_Different;
+  bool m_bMaintainDateTimeStamps;
+  bool m_bIntoEmpty;
+  StringX m_sxEntriesWithNewNamedPolicies;
+  // Kept back until EndXMLEntries(), so that nothing is reported or
+  // changed if a later entry fails validation
+  std::vector<StringX> m_vReportLines;
+  UUIDVector m_vATimeUpdates;
 };
 
 #endif /* __XMLFILEHANDLERS_H */
@@ -81,7 +81,7 @@ const XMLFileValidation::st_file_elements XMLFileValidation::m_file_elements[XLE
   {_T("xtime_interval"), {0, XLE_XTIME_INTERVAL}},
   {_T("pwhistory"), {0, XLE_PWHISTORY}},
   {_T("PasswordPolicy"), {0, XLE_ENTRY_PASSWORDPOLICY}},
-  {_T("symbols"), {0, XLE_SYMBOLS}},
+  {_T("symbols"), {XLE_SYMBOLS, XLE_SYMBOLS}},                    // Policy and entry
   {_T("kbshortcut"), {0, XLE_KBSHORTCUT}},
   {_T("status"), {0, XLE_STATUS}},
   {_T("max"), {0, XLE_MAX}},
@@ -91,7 +91,7 @@ const XMLFileValidation::st_file_elements XMLFileValidation::m_file_elements[XLE
   {_T("changedx"), {0, XLE_CHANGEDX}},
   {_T("oldpassword"), {0, XLE_OLDPASSWORD}},
   {_T("PWLength"), {0, XLE_ENTRY_PWLENGTH}},
-  {_T("NamedPasswordPolicies"), {0, XLE_PASSWORDPOLICYNAMES}},
+  {_T("NamedPasswordPolicies"), {XLE_PASSWORDPOLICYNAMES, 0}},
   {_T("Policy"), {XLE_POLICY, 0}},
   {_T("PWName"), {XLE_PWNAME, 0}},
   {_T("PasswordPolicyName"), {0, XLE_ENTRY_PASSWORDPOLICYNAME}},
@@ -114,21 +114,24 @@ XMLFileValidation::~XMLFileValidation()
 
 #if USE_XML_LIBRARY == MSXML
 bool XMLFileValidation::GetElementInfo(const wchar_t *name, st_file_element_data &edata)
+{
+  return FindElementInfo(name, edata);
+}
 #elif USE_XML_LIBRARY == XERCES
 bool XMLFileValidation::GetElementInfo(const XMLCh *name, st_file_element_data &edata)
-#endif
 {
-#if USE_XML_LIBRARY == XERCES
   const stringT strValue(_X2ST(name));
-#else
-  const stringT strValue(name);
+  return FindElementInfo(strValue.c_str(), edata);
+}
 #endif
 
-  if (strValue.length() == 0)
+bool XMLFileValidation::FindElementInfo(const TCHAR *name, st_file_element_data &edata) const
+{
+  if (name[0] == _T('\0'))
     return false;
 
-  std::map<stringT, st_file_element_data> :: const_iterator e_iter;
-  e_iter = m_element_map.find(strValue);
+  std::map<stringT, st_file_element_data, std::less<> > :: const_iterator e_iter;
+  e_iter = m_element_map.find(name);
   if (e_iter != m_element_map.end()) {
     edata = e_iter->second;
     return true;
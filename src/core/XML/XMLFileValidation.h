@@ -148,9 +148,11 @@ public:
 #elif USE_XML_LIBRARY == XERCES
   bool GetElementInfo(const XMLCh *name, st_file_element_data &edata);
 #endif
+  bool FindElementInfo(const TCHAR *name, st_file_element_data &edata) const;
 
 private:
-  std::map<stringT, st_file_element_data> m_element_map;
+  // std::less<> so that names are looked up without making a stringT of each
+  std::map<stringT, st_file_element_data, std::less<> > m_element_map;
   typedef std::pair<stringT, st_file_element_data> file_element_pair;
 
   static const struct st_file_elements {
@@ -0,0 +1,478 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+
+/*
+* Common Filter XML import processing, for all the XML libraries: the
+* library's handlers pass each element here by name once they've done
+* their own checks
+*/
+
+#include "XMLDefs.h"    // Required if testing "USE_XML_LIBRARY"
+
+#ifdef USE_XML_LIBRARY
+
+#include "XMLFilterHandlers.h"
+
+// PWS includes
+#include "../Util.h"
+#include "../core.h"
+#include "../PWSFilters.h"
+#include "../VerifyFormat.h"
+#include "../Match.h"
+#include "../../os/pws_tchar.h"
+
+using namespace std;
+
+XMLFilterHandlers::XMLFilterHandlers()
+  : m_MapFilters(NULL), m_type(DFTYPE_INVALID), cur_filter(NULL),
+    cur_filterentry(NULL), m_pAsker(NULL), m_bValidation(false),
+    m_bEntryBeingProcessed(false), m_bInTest(false), m_bErrors(false)
+{
+  m_sxElemContent = _T("");
+}
+
+XMLFilterHandlers::~XMLFilterHandlers()
+{
+  // Only left if the document was abandoned part way through
+  delete cur_filter;
+  delete cur_filterentry;
+}
+
+bool XMLFilterHandlers::ProcessStartElement(const TCHAR *name)
+{
+  if (m_bValidation)
+    return false;
+
+  if (_tcscmp(name, _T("filter")) == 0) {
+    delete cur_filter;
+    cur_filter = new st_filters;
+  } else if (_tcscmp(name, _T("filter_entry")) == 0) {
+    delete cur_filterentry;
+    cur_filterentry = new st_FilterRow;
+    cur_filterentry->Empty();
+    cur_filterentry->bFilterActive = true;
+    m_bEntryBeingProcessed = true;
+  } else if (_tcscmp(name, _T("test")) == 0) {
+    m_bInTest = true;
+  }
+
+  m_sxElemContent = _T("");
+  return true;
+}
+
+bool XMLFilterHandlers::ProcessEndElement(const TCHAR *name)
+{
+  if (_tcscmp(name, _T("filter")) == 0) {
+    bool bAddFilter(true);
+    st_Filterkey fk;
+    fk.fpool = m_FPool;
+    fk.cs_filtername = cur_filter->fname;
+    if (m_MapFilters->find(fk) != m_MapFilters->end()) {
+      stringT question;
+      Format(question, IDSC_FILTEREXISTS, cur_filter->fname.c_str());
+      if (m_pAsker == NULL || (bAddFilter = (*m_pAsker)(question)) == true) {
+        m_MapFilters->erase(fk);
+      }
+    }
+    if (bAddFilter) {
+      m_MapFilters->insert(PWSFilters::Pair(fk, *cur_filter));
+    }
+    delete cur_filter;
+    cur_filter = NULL;
+  }
+
+  else if (_tcscmp(name, _T("filter_entry")) == 0) {
+    if (cur_filterentry->mtype  == PWSMatch::MT_DATE &&
+        cur_filterentry->rule   != PWSMatch::MR_PRESENT &&
+        cur_filterentry->rule   != PWSMatch::MR_NOTPRESENT &&
+        cur_filterentry->fdate1 == time_t(0) &&
+        cur_filterentry->fdate2 == time_t(0))
+      cur_filterentry->fdatetype = 1; // Relative Date
+    if (m_type == DFTYPE_MAIN) {
+      cur_filter->num_Mactive++;
+      cur_filter->vMfldata.push_back(*cur_filterentry);
+    } else if (m_type == DFTYPE_PWHISTORY) {
+      cur_filter->num_Hactive++;
+      cur_filter->vHfldata.push_back(*cur_filterentry);
+    } else if (m_type == DFTYPE_PWPOLICY) {
+      cur_filter->num_Pactive++;
+      cur_filter->vPfldata.push_back(*cur_filterentry);
+    }
+    delete cur_filterentry;
+    cur_filterentry = NULL;
+  }
+
+  else if (_tcscmp(name, _T("grouptitle")) == 0) {
+    m_type = DFTYPE_MAIN;
+    cur_filterentry->mtype = PWSMatch::MT_STRING;
+    cur_filterentry->ftype = FT_GROUPTITLE;
+  }
+
+  else if (_tcscmp(name, _T("group")) == 0) {
+    m_type = DFTYPE_MAIN;
+    cur_filterentry->mtype = PWSMatch::MT_STRING;
+    cur_filterentry->ftype = FT_GROUP;
+  }
+
+  else if (_tcscmp(name, _T("title")) == 0) {
+    m_type = DFTYPE_MAIN;
+    cur_filterentry->mtype = PWSMatch::MT_STRING;
+    cur_filterentry->ftype = FT_TITLE;
+  }
+
+  else if (_tcscmp(name, _T("user")) == 0) {
+    m_type = DFTYPE_MAIN;
+    cur_filterentry->mtype = PWSMatch::MT_STRING;
+    cur_filterentry->ftype = FT_USER;
+  }
+
+  else if (_tcscmp(name, _T("password")) == 0) {
+    m_type = DFTYPE_MAIN;
+    cur_filterentry->mtype = PWSMatch::MT_PASSWORD;
+    cur_filterentry->ftype = FT_PASSWORD;
+  }
+
+  else if (_tcscmp(name, _T("notes")) == 0) {
+    m_type = DFTYPE_MAIN;
+    cur_filterentry->mtype = PWSMatch::MT_STRING;
+    cur_filterentry->ftype = FT_NOTES;
+  }
+
+  else if (_tcscmp(name, _T("autotype")) == 0) {
+    m_type = DFTYPE_MAIN;
+    cur_filterentry->mtype = PWSMatch::MT_STRING;
+    cur_filterentry->ftype = FT_AUTOTYPE;
+  }
+
+  else if (_tcscmp(name, _T("url")) == 0) {
+    m_type = DFTYPE_MAIN;
+    cur_filterentry->mtype = PWSMatch::MT_STRING;
+    cur_filterentry->ftype = FT_URL;
+  }
+
+  else if (_tcscmp(name, _T("runcommand")) == 0) {
+    m_type = DFTYPE_MAIN;
+    cur_filterentry->mtype = PWSMatch::MT_STRING;
+    cur_filterentry->ftype = FT_RUNCMD;
+  }
+
+  // Both the field and, within its test, the value tested for
+  else if (_tcscmp(name, _T("dca")) == 0) {
+    if (m_bInTest) {
+      cur_filterentry->fdca = static_cast<short>(_ttoi(m_sxElemContent.c_str()));
+    } else {
+      m_type = DFTYPE_MAIN;
+      cur_filterentry->mtype = PWSMatch::MT_DCA;
+      cur_filterentry->ftype = FT_DCA;
+    }
+  }
+
+  else if (_tcscmp(name, _T("shiftdca")) == 0) {
+    if (m_bInTest) {
+      cur_filterentry->fdca = static_cast<short>(_ttoi(m_sxElemContent.c_str()));
+    } else {
+      m_type = DFTYPE_MAIN;
+      cur_filterentry->mtype = PWSMatch::MT_SHIFTDCA;
+      cur_filterentry->ftype = FT_SHIFTDCA;
+    }
+  }
+
+  else if (_tcscmp(name, _T("email")) == 0) {
+    m_type = DFTYPE_MAIN;
+    cur_filterentry->mtype = PWSMatch::MT_STRING;
+    cur_filterentry->ftype = FT_EMAIL;
+  }
+
+  else if (_tcscmp(name, _T("protected")) == 0) {
+    m_type = DFTYPE_MAIN;
+    cur_filterentry->mtype = PWSMatch::MT_BOOL;
+    cur_filterentry->ftype = FT_PROTECTED;
+  }
+
+  else if (_tcscmp(name, _T("kbshortcut")) == 0) {
+    m_type = DFTYPE_MAIN;
+    cur_filterentry->mtype = PWSMatch::MT_BOOL;
+    cur_filterentry->ftype = FT_KBSHORTCUT;
+  }
+
+  else if (_tcscmp(name, _T("symbols")) == 0) {
+    m_type = DFTYPE_MAIN;
+    cur_filterentry->mtype = PWSMatch::MT_STRING;
+    cur_filterentry->ftype = FT_SYMBOLS;
+    cur_filterentry->fstring = PWSUtil::DeDupString(cur_filterentry->fstring);
+  }
+
+  else if (_tcscmp(name, _T("policyname")) == 0) {
+    m_type = DFTYPE_MAIN;
+    cur_filterentry->mtype = PWSMatch::MT_STRING;
+    cur_filterentry->ftype = FT_POLICYNAME;
+  }
+
+  else if (_tcscmp(name, _T("create_time")) == 0) {
+    m_type = DFTYPE_MAIN;
+    cur_filterentry->mtype = PWSMatch::MT_DATE;
+    cur_filterentry->ftype = FT_CTIME;
+  }
+
+  else if (_tcscmp(name, _T("password_modified_time")) == 0) {
+    m_type = DFTYPE_MAIN;
+    cur_filterentry->mtype = PWSMatch::MT_DATE;
+    cur_filterentry->ftype = FT_PMTIME;
+  }
+
+  else if (_tcscmp(name, _T("last_access_time")) == 0) {
+    m_type = DFTYPE_MAIN;
+    cur_filterentry->mtype = PWSMatch::MT_DATE;
+    cur_filterentry->ftype = FT_ATIME;
+  }
+
+  else if (_tcscmp(name, _T("expiry_time")) == 0) {
+    m_type = DFTYPE_MAIN;
+    cur_filterentry->mtype = PWSMatch::MT_DATE;
+    cur_filterentry->ftype = FT_XTIME;
+  }
+
+  else if (_tcscmp(name, _T("record_modified_time")) == 0) {
+    m_type = DFTYPE_MAIN;
+    cur_filterentry->mtype = PWSMatch::MT_DATE;
+    cur_filterentry->ftype = FT_RMTIME;
+  }
+
+  else if (_tcscmp(name, _T("password_expiry_interval")) == 0) {
+    m_type = DFTYPE_MAIN;
+    cur_filterentry->mtype = PWSMatch::MT_INTEGER;
+    cur_filterentry->ftype = FT_XTIME_INT;
+  }
+
+  else if (_tcscmp(name, _T("password_length")) == 0) {
+    m_type = DFTYPE_MAIN;
+    cur_filterentry->mtype = PWSMatch::MT_INTEGER;
+    cur_filterentry->ftype = FT_PASSWORDLEN;
+  }
+
+  else if (_tcscmp(name, _T("entrysize")) == 0) {
+    m_type = DFTYPE_MAIN;
+    cur_filterentry->mtype = PWSMatch::MT_ENTRYSIZE;
+    cur_filterentry->ftype = FT_ENTRYSIZE;
+  }
+
+  else if (_tcscmp(name, _T("entrytype")) == 0) {
+    m_type = DFTYPE_MAIN;
+    cur_filterentry->mtype = PWSMatch::MT_ENTRYTYPE;
+    cur_filterentry->ftype = FT_ENTRYTYPE;
+  }
+
+  else if (_tcscmp(name, _T("entrystatus")) == 0) {
+    m_type = DFTYPE_MAIN;
+    cur_filterentry->mtype = PWSMatch::MT_ENTRYSTATUS;
+    cur_filterentry->ftype = FT_ENTRYSTATUS;
+  }
+
+  else if (_tcscmp(name, _T("unknownfields")) == 0) {
+    m_type = DFTYPE_MAIN;
+    cur_filterentry->ftype = FT_UNKNOWNFIELDS;
+  }
+
+  else if (_tcscmp(name, _T("password_history")) == 0) {
+    m_type = DFTYPE_MAIN;
+    cur_filterentry->mtype = PWSMatch::MT_PWHIST;
+    cur_filterentry->ftype = FT_PWHIST;
+  }
+
+  else if (_tcscmp(name, _T("history_present")) == 0) {
+    m_type = DFTYPE_PWHISTORY;
+    cur_filterentry->mtype = PWSMatch::MT_BOOL;
+    cur_filterentry->ftype = HT_PRESENT;
+  }
+
+  else if (_tcscmp(name, _T("history_active")) == 0) {
+    m_type = DFTYPE_PWHISTORY;
+    cur_filterentry->mtype = PWSMatch::MT_BOOL;
+    cur_filterentry->ftype = HT_ACTIVE;
+  }
+
+  else if (_tcscmp(name, _T("history_number")) == 0) {
+    m_type = DFTYPE_PWHISTORY;
+    cur_filterentry->mtype = PWSMatch::MT_INTEGER;
+    cur_filterentry->ftype = HT_NUM;
+  }
+
+  else if (_tcscmp(name, _T("history_maximum")) == 0) {
+    m_type = DFTYPE_PWHISTORY;
+    cur_filterentry->mtype = PWSMatch::MT_INTEGER;
+    cur_filterentry->ftype = HT_MAX;
+  }
+
+  else if (_tcscmp(name, _T("history_changedate")) == 0) {
+    m_type = DFTYPE_PWHISTORY;
+    cur_filterentry->mtype = PWSMatch::MT_DATE;
+    cur_filterentry->ftype = HT_CHANGEDATE;
+  }
+
+  else if (_tcscmp(name, _T("history_passwords")) == 0) {
+    m_type = DFTYPE_PWHISTORY;
+    cur_filterentry->mtype = PWSMatch::MT_PASSWORD;
+    cur_filterentry->ftype = HT_PASSWORDS;
+  }
+
+  else if (_tcscmp(name, _T("password_policy")) == 0) {
+    m_type = DFTYPE_MAIN;
+    cur_filterentry->mtype = PWSMatch::MT_POLICY;
+    cur_filterentry->ftype = FT_POLICY;
+  }
+
+  else if (_tcscmp(name, _T("policy_present")) == 0) {
+    m_type = DFTYPE_PWPOLICY;
+    cur_filterentry->mtype = PWSMatch::MT_BOOL;
+    cur_filterentry->ftype = PT_PRESENT;
+  }
+
+  else if (_tcscmp(name, _T("policy_length")) == 0) {
+    m_type = DFTYPE_PWPOLICY;
+    cur_filterentry->mtype = PWSMatch::MT_INTEGER;
+    cur_filterentry->ftype = PT_LENGTH;
+  }
+
+  else if (_tcscmp(name, _T("policy_number_lowercase")) == 0) {
+    m_type = DFTYPE_PWPOLICY;
+    cur_filterentry->mtype = PWSMatch::MT_INTEGER;
+    cur_filterentry->ftype = PT_LOWERCASE;
+  }
+
+  else if (_tcscmp(name, _T("policy_number_uppercase")) == 0) {
+    m_type = DFTYPE_PWPOLICY;
+    cur_filterentry->mtype = PWSMatch::MT_INTEGER;
+    cur_filterentry->ftype = PT_UPPERCASE;
+  }
+
+  else if (_tcscmp(name, _T("policy_number_digits")) == 0) {
+    m_type = DFTYPE_PWPOLICY;
+    cur_filterentry->mtype = PWSMatch::MT_INTEGER;
+    cur_filterentry->ftype = PT_DIGITS;
+  }
+
+  else if (_tcscmp(name, _T("policy_number_symbols")) == 0) {
+    m_type = DFTYPE_PWPOLICY;
+    cur_filterentry->mtype = PWSMatch::MT_INTEGER;
+    cur_filterentry->ftype = PT_SYMBOLS;
+  }
+
+  else if (_tcscmp(name, _T("policy_easyvision")) == 0) {
+    m_type = DFTYPE_PWPOLICY;
+    cur_filterentry->mtype = PWSMatch::MT_BOOL;
+    cur_filterentry->ftype = PT_EASYVISION;
+  }
+
+  else if (_tcscmp(name, _T("policy_pronounceable")) == 0) {
+    m_type = DFTYPE_PWPOLICY;
+    cur_filterentry->mtype = PWSMatch::MT_BOOL;
+    cur_filterentry->ftype = PT_PRONOUNCEABLE;
+  }
+
+  else if (_tcscmp(name, _T("policy_hexadecimal")) == 0) {
+    m_type = DFTYPE_PWPOLICY;
+    cur_filterentry->mtype = PWSMatch::MT_BOOL;
+    cur_filterentry->ftype = PT_HEXADECIMAL;
+  }
+
+  else if (_tcscmp(name, _T("rule")) == 0) {
+    ToUpper(m_sxElemContent);
+    cur_filterentry->rule = PWSMatch::GetRule(m_sxElemContent.c_str());
+  }
+
+  else if (_tcscmp(name, _T("logic")) == 0) {
+    if (m_sxElemContent == _T("or"))
+      cur_filterentry->ltype = LC_OR;
+    else
+      cur_filterentry->ltype = LC_AND;
+  }
+
+  else if (_tcscmp(name, _T("string")) == 0) {
+    cur_filterentry->fstring = m_sxElemContent;
+  }
+
+  else if (_tcscmp(name, _T("case")) == 0) {
+    cur_filterentry->fcase = _ttoi(m_sxElemContent.c_str()) != 0;
+  }
+
+  else if (_tcscmp(name, _T("warn")) == 0) {
+    cur_filterentry->fnum1 = _ttoi(m_sxElemContent.c_str());
+  }
+
+  else if (_tcscmp(name, _T("num1")) == 0) {
+    cur_filterentry->fnum1 = _ttoi(m_sxElemContent.c_str());
+  }
+
+  else if (_tcscmp(name, _T("num2")) == 0) {
+    cur_filterentry->fnum2 = _ttoi(m_sxElemContent.c_str());
+  }
+
+  else if (_tcscmp(name, _T("unit")) == 0) {
+    cur_filterentry->funit = _ttoi(m_sxElemContent.c_str());
+  }
+
+  else if (_tcscmp(name, _T("date1")) == 0) {
+    time_t t(0);
+    if (VerifyXMLDateString(m_sxElemContent.c_str(), t) &&
+        (t != time_t(-1)))
+      cur_filterentry->fdate1 = t;
+    else
+      cur_filterentry->fdate1 = time_t(0);
+  }
+
+  else if (_tcscmp(name, _T("date2")) == 0) {
+    time_t t(0);
+    if (VerifyXMLDateString(m_sxElemContent.c_str(), t) &&
+        (t != time_t(-1)))
+      cur_filterentry->fdate2 = t;
+    else
+      cur_filterentry->fdate2 = time_t(0);
+  }
+
+  else if (_tcscmp(name, _T("DCA")) == 0) {
+    cur_filterentry->fdca = static_cast<short>(_ttoi(m_sxElemContent.c_str()));
+  }
+
+  else if (_tcscmp(name, _T("type")) == 0) {
+    if (m_sxElemContent == _T("normal"))
+      cur_filterentry->etype = CItemData::ET_NORMAL;
+    else if (m_sxElemContent == _T("alias"))
+      cur_filterentry->etype = CItemData::ET_ALIAS;
+    else if (m_sxElemContent == _T("shortcut"))
+      cur_filterentry->etype = CItemData::ET_SHORTCUT;
+    else if (m_sxElemContent == _T("aliasbase"))
+      cur_filterentry->etype = CItemData::ET_ALIASBASE;
+    else if (m_sxElemContent == _T("shortcutbase"))
+      cur_filterentry->etype = CItemData::ET_SHORTCUTBASE;
+    else
+      cur_filterentry->etype = CItemData::ET_INVALID;
+  }
+
+  else if (_tcscmp(name, _T("status")) == 0) {
+    if (m_sxElemContent == _T("clean"))
+      cur_filterentry->estatus = CItemData::ES_CLEAN;
+    else if (m_sxElemContent == _T("added"))
+      cur_filterentry->estatus = CItemData::ES_ADDED;
+    else if (m_sxElemContent == _T("modified"))
+      cur_filterentry->estatus = CItemData::ES_MODIFIED;
+    else
+      cur_filterentry->estatus = CItemData::ES_INVALID;
+  }
+
+  else if (_tcscmp(name, _T("test")) == 0) {
+    m_bInTest = false;
+  }
+
+  else if (_tcscmp(name, _T("filters")) != 0) {
+    return false;
+  }
+
+  return true;
+}
+
+#endif /* USE_XML_LIBRARY */
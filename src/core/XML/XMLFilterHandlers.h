@@ -0,0 +1,63 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+
+/*
+* Common Filter XML import processing, for all the XML libraries, as
+* XMLFileHandlers is for File XML
+*/
+
+#ifndef __XMLFILTERHANDLERS_H
+#define __XMLFILTERHANDLERS_H
+
+// PWS includes
+#include "../PWSFilters.h"
+#include "../Proxy.h"
+
+#include "XMLDefs.h"  // Required if testing "USE_XML_LIBRARY"
+
+class XMLFilterHandlers
+{
+public:
+  XMLFilterHandlers();
+  virtual ~XMLFilterHandlers();
+
+  void SetVariables(Asker *pAsker, PWSFilters *mapfilters, const FilterPool fpool,
+                    const bool &bValidation)
+  {m_pAsker = pAsker; m_MapFilters = mapfilters, m_FPool = fpool; m_bValidation = bValidation;}
+
+  PWSFilters *m_MapFilters;
+  FilterPool m_FPool;
+  int m_type;
+
+  bool getIfErrors() {return m_bErrors;}
+  void resetErrors() {m_bErrors = false;}
+  stringT getValidationResult() {return m_strValidationResult;}
+  stringT getXMLErrors() {return m_strXMLErrors;}
+
+protected:
+  // Import each element by name. ProcessStartElement returns false if
+  // there's nothing more to do for it (in validation mode), and
+  // ProcessEndElement false if it's not a filter element at all.
+  bool ProcessStartElement(const TCHAR *name);
+  bool ProcessEndElement(const TCHAR *name);
+
+  st_filters *cur_filter;
+  st_FilterRow *cur_filterentry;
+  Asker *m_pAsker;
+
+  StringX m_sxElemContent;
+  stringT m_strValidationResult;
+  stringT m_strXMLErrors;
+
+  bool m_bValidation;
+  bool m_bEntryBeingProcessed;
+  bool m_bInTest;
+  bool m_bErrors;
+};
+
+#endif /* __XMLFILTERHANDLERS_H */
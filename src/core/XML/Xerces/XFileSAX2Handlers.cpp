@@ -70,10 +70,11 @@ void XFileSAX2Handlers::startElement(const XMLCh* const /* uri */,
 {
   USES_XMLCH_STR
 
-  if (m_bValidation) {
+  if (!m_bEntryBeingProcessed) {
     const XMLCh* lum = _A2X("lumimaja");
     if (XMLString::equals(qname, lum)) {
-      // Only interested in the delimiter attribute
+      // Only interested in the delimiter attribute, which is needed
+      // before the first entry is added
       const XMLCh *szValue = attrs.getValue(_A2X("delimiter"));
       if (szValue != NULL) {
         m_delimiter = szValue[0];
@@ -66,7 +66,11 @@ XFileXMLProcessor::XFileXMLProcessor(PWScore *pcore,
                                      CReport *prpt)
   : m_pXMLcore(pcore),
     m_pPossible_Aliases(pPossible_Aliases), m_pPossible_Shortcuts(pPossible_Shortcuts),
-    m_pmulticmds(p_multicmds), m_prpt(prpt), m_delimiter(TCHAR('^'))
+    m_pmulticmds(p_multicmds), m_prpt(prpt), m_numEntriesValidated(0),
+    m_numEntriesImported(0), m_numEntriesSkipped(0), m_numEntriesPWHErrors(0),
+    m_numEntriesRenamed(0), m_numRenamedPolicies(0), m_numNoPolicies(0),
+    m_numShortcutsRemoved(0), m_delimiter(TCHAR('^')), m_bValidation(false),
+    m_bValidationErrors(false)
 {
 }
 
@@ -89,6 +93,7 @@ bool XFileXMLProcessor::Process(const bool &bvalidation, const stringT &Imported
   LoadAString(cs_import, IDSC_XMLIMPORT);
   stringT strResultText(_T(""));
   m_bValidation = bvalidation;  // Validate or Import
+  m_bValidationErrors = false;
 
   XSecMemMgr sec_mm;
 
@@ -160,10 +165,12 @@ bool XFileXMLProcessor::Process(const bool &bvalidation, const stringT &Imported
   }
 
   if (pSAX2Handler->getIfErrors() || bErrorOccurred) {
+    // Errors reported by the parser are the file failing validation
+    m_bValidationErrors = pSAX2Handler->getIfErrors();
     bErrorOccurred = true;
     strResultText = pSAX2Handler->getValidationResult();
     Format(m_strXMLErrors, IDSC_XERCESPARSEERROR,
-           m_bValidation ? cs_validation.c_str() : cs_import.c_str(),
+           (m_bValidation || m_bValidationErrors) ? cs_validation.c_str() : cs_import.c_str(),
            strResultText.c_str());
   } else {
     if (m_bValidation) {
@@ -171,9 +178,10 @@ bool XFileXMLProcessor::Process(const bool &bvalidation, const stringT &Imported
       m_numEntriesValidated = pSAX2Handler->getNumEntries();
       m_delimiter = pSAX2Handler->getDelimiter();
     } else {
-      pSAX2Handler->AddXMLEntries();
+      // The entries were added as they were read
+      pSAX2Handler->EndXMLEntries();
 
-      // Get numbers (may have been modified by AddXMLEntries
+      m_numEntriesValidated = pSAX2Handler->getNumEntriesRead();
       m_numEntriesImported = pSAX2Handler->getNumEntries();
       m_numEntriesSkipped = pSAX2Handler->getNumSkipped();
       m_numEntriesRenamed = pSAX2Handler->getNumRenamed();
@@ -61,6 +61,9 @@ public:
                     CReport *prpt);
   ~XFileXMLProcessor();
 
+  // Both validates the file against the schema and, unless bvalidation,
+  // imports it, in one pass: each entry's commands are added as the entry
+  // is read. If false is returned, the commands added must be discarded.
   bool Process(const bool &bvalidation, const stringT &ImportedPrefix, 
                const stringT &strXMLFileName, const stringT &strXSDFileName,
                const bool &bImportPSWDsOnly);
@@ -69,6 +72,7 @@ public:
   stringT getRenameList() {return m_strRenameList;}
   stringT getPWHErrorList() {return m_strPWHErrorList;}
   stringT getSkippedList() {return m_strSkippedList;}
+  bool getIfValidationErrors() const {return m_bValidationErrors;}
 
   int getNumEntriesValidated() {return m_numEntriesValidated;}
   int getNumEntriesImported() {return m_numEntriesImported;}
@@ -92,7 +96,7 @@ private:
   int m_numRenamedPolicies, m_numNoPolicies;
   int m_numShortcutsRemoved;
   TCHAR m_delimiter;
-  bool m_bValidation;
+  bool m_bValidation, m_bValidationErrors;
 };
 
 #endif /* __XFILEXMLPROCESSOR_H */
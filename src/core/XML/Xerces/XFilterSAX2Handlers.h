@@ -30,6 +30,7 @@
 #define __XFILTERSAX2HANDLERS_H
 
 // PWS includes
+#include "../XMLFilterHandlers.h"
 #include "../../PWSFilters.h"
 #include "../../Proxy.h"
 
@@ -41,23 +42,16 @@ class PWSFilters;
 
 XERCES_CPP_NAMESPACE_USE
 
-class XFilterSAX2Handlers : public DefaultHandler
+class XFilterSAX2Handlers : public DefaultHandler, public XMLFilterHandlers
 {
 public:
   XFilterSAX2Handlers();
   virtual ~XFilterSAX2Handlers();
 
   // Local variables & functions
-  void SetVariables(Asker *pAsker, PWSFilters *mapfilters, const FilterPool fpool, 
-                    const bool &bValidation)
-  {m_pAsker = pAsker; m_MapFilters = mapfilters, m_FPool = fpool; m_bValidation = bValidation;}
   void SetSchemaVersion(int ischema_version)
   {m_iSchema_Version = ischema_version;}
 
-  PWSFilters *m_MapFilters;
-  FilterPool m_FPool;
-  int m_type;
-
   // -----------------------------------------------------------------------
   //  Handlers for the SAX ContentHandler interface
   // -----------------------------------------------------------------------
@@ -70,7 +64,6 @@ public:
                   const XMLCh* const qname);
   void setDocumentLocator(const Locator *const locator) {m_pLocator = locator;}
   void startDocument();
-  bool getIfErrors() {return m_bErrors;}
 
   // -----------------------------------------------------------------------
   //  Handlers for the SAX ErrorHandler interface
@@ -78,30 +71,17 @@ public:
   void warning(const SAXParseException& exc);
   void error(const SAXParseException& exc);
   void fatalError(const SAXParseException& exc);
-  void resetErrors() {m_bErrors = false;}
-  stringT getValidationResult() {return m_strValidationResult;}
-  stringT getXMLErrors() {return m_strXMLErrors;}
 
 private:
   void FormatError(const SAXParseException& e, const int type);
 
   // Local variables
-  st_filters *cur_filter;
-  st_FilterRow *cur_filterentry;
   const Locator *m_pLocator;
   XMLCh * m_pSchema_Version;
-  Asker *m_pAsker;
-
-  StringX m_sxElemContent;
-  stringT m_strValidationResult;
-  stringT m_strXMLErrors;
 
   int m_fieldlen;
   int m_iXMLVersion, m_iSchemaVersion;
   int m_iSchema_Version;
-  bool m_bValidation;
-  bool m_bEntryBeingProcessed;
-  bool m_bErrors;
   unsigned char m_ctype;
   unsigned char *m_pfield;
 };
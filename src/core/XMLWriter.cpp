@@ -0,0 +1,422 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+// XMLWriter.cpp
+//-----------------------------------------------------------------------------
+
+#include "XMLWriter.h"
+#include "Util.h"
+
+#include "os/debug.h"
+#include "os/mem.h"
+#include "os/pws_tchar.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cwchar>
+
+#if defined(__SSE2__) && WCHAR_MAX > 0xffff
+#include <emmintrin.h>
+#define PWS_XMLWRITER_SSE2
+#endif
+
+// Written out whenever full; more is allocated only for a field bigger
+// than this
+static const size_t BUFFER_SIZE = 1024 * 1024;
+// Initial size in memory, doubled whenever full
+static const size_t MEMORY_SIZE = 64 * 1024;
+
+// As PWSUtil::WriteXMLField(), i.e., ValidateXMLCharacters()
+static inline bool IsXMLChar(TCHAR c)
+{
+  const unsigned long uc = static_cast<unsigned long>(c);
+  return uc == 0x09 || uc == 0x0A || uc == 0x0D ||
+         (uc >= 0x20 && uc <= 0xD7FF) ||
+         (uc >= 0xE000 && uc <= 0xFFFD) ||
+         (uc >= 0x10000 && uc <= 0x10FFFF);
+}
+
+// Whether c is written as the one ASCII char, in a CDATA section (where
+// only "]]>" matters) or an attribute value (where &<>"' are entities)
+template<bool bCDATA>
+static inline bool IsPlain(TCHAR c)
+{
+  if (c < 0x20 || c >= 0x7F)
+    return false;
+  if (bCDATA)
+    return c != _T(']');
+  return c != _T('&') && c != _T('<') && c != _T('>') &&
+         c != _T('"') && c != _T('\'');
+}
+
+// Copies characters to out up to the first that isn't plain, returns the
+// number copied
+template<bool bCDATA>
+static size_t CopyPlain(const TCHAR *p, size_t n, char *out)
+{
+  size_t i = 0;
+#ifdef PWS_XMLWRITER_SSE2
+  const __m128i lo = _mm_set1_epi32(0x20), hi = _mm_set1_epi32(0x7E);
+  for (; i + 8 <= n; i += 8) {
+    const __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+    const __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i + 4));
+    // Signed compares, so anything above 0x7fffffff is less than lo
+    __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmplt_epi32(v0, lo), _mm_cmpgt_epi32(v0, hi)),
+                             _mm_or_si128(_mm_cmplt_epi32(v1, lo), _mm_cmpgt_epi32(v1, hi)));
+    if (bCDATA) {
+      const __m128i rb = _mm_set1_epi32(']');
+      m = _mm_or_si128(m, _mm_or_si128(_mm_cmpeq_epi32(v0, rb), _mm_cmpeq_epi32(v1, rb)));
+    } else {
+      static const int special[] = {'&', '<', '>', '"', '\''};
+      for (size_t j = 0; j < sizeof(special) / sizeof(special[0]); j++) {
+        const __m128i s = _mm_set1_epi32(special[j]);
+        m = _mm_or_si128(m, _mm_or_si128(_mm_cmpeq_epi32(v0, s), _mm_cmpeq_epi32(v1, s)));
+      }
+    }
+    if (_mm_movemask_epi8(m) != 0)
+      break;
+    // All are ASCII, so narrow without saturating
+    const __m128i w = _mm_packs_epi32(v0, v1);
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(out + i), _mm_packus_epi16(w, w));
+  }
+#endif
+  for (; i < n && IsPlain<bCDATA>(p[i]); i++)
+    out[i] = static_cast<char>(p[i]);
+  return i;
+}
+
+static inline char *Append(char *out, const char *s, size_t len)
+{
+  std::memcpy(out, s, len);
+  return out + len;
+}
+
+static inline char *Append(char *out, const char *s)
+{
+  return Append(out, s, std::strlen(s));
+}
+
+static inline char *EncodeUTF8(char *out, unsigned long uc)
+{
+  if (uc < 0x80) {
+    *out++ = static_cast<char>(uc);
+  } else if (uc < 0x800) {
+    *out++ = static_cast<char>(0xC0 | (uc >> 6));
+    *out++ = static_cast<char>(0x80 | (uc & 0x3F));
+  } else if (uc < 0x10000) {
+    *out++ = static_cast<char>(0xE0 | (uc >> 12));
+    *out++ = static_cast<char>(0x80 | ((uc >> 6) & 0x3F));
+    *out++ = static_cast<char>(0x80 | (uc & 0x3F));
+  } else {
+    *out++ = static_cast<char>(0xF0 | (uc >> 18));
+    *out++ = static_cast<char>(0x80 | ((uc >> 12) & 0x3F));
+    *out++ = static_cast<char>(0x80 | ((uc >> 6) & 0x3F));
+    *out++ = static_cast<char>(0x80 | (uc & 0x3F));
+  }
+  return out;
+}
+
+// Encodes p[i], and the rest of a surrogate pair if it's one, returning
+// the number of TCHARs used. Anything that isn't a character is U+FFFD
+static inline size_t EncodeChar(const TCHAR *p, size_t i, size_t n, char *&out)
+{
+  unsigned long uc = static_cast<unsigned long>(p[i]);
+  size_t used = 1;
+  if (uc >= 0xD800 && uc <= 0xDFFF) {
+#if WCHAR_MAX <= 0xffff
+    if (uc <= 0xDBFF && i + 1 < n &&
+        p[i + 1] >= 0xDC00 && p[i + 1] <= 0xDFFF) {
+      uc = 0x10000 + ((uc - 0xD800) << 10) + (p[i + 1] - 0xDC00);
+      used = 2;
+    } else
+#else
+    UNREFERENCED_PARAMETER(n);
+#endif
+      uc = 0xFFFD;
+  } else if (uc > 0x10FFFF) {
+    uc = 0xFFFD;
+  }
+  out = EncodeUTF8(out, uc);
+  return used;
+}
+
+static inline char *Append2Digits(char *out, int n)
+{
+  *out++ = static_cast<char>('0' + n / 10);
+  *out++ = static_cast<char>('0' + n % 10);
+  return out;
+}
+
+CXMLWriter::CXMLWriter(std::FILE *fp)
+  : m_fp(fp), m_buffer(NULL), m_size(0), m_len(0), m_bWriteFailed(false),
+    m_lastTime(0)
+{
+  std::strcpy(m_szLastTime, "1970-01-01T00:00:00");
+  Allocate(BUFFER_SIZE);
+}
+
+CXMLWriter::CXMLWriter()
+  : m_fp(NULL), m_buffer(NULL), m_size(0), m_len(0), m_bWriteFailed(false),
+    m_lastTime(0)
+{
+  std::strcpy(m_szLastTime, "1970-01-01T00:00:00");
+}
+
+CXMLWriter::~CXMLWriter()
+{
+  Flush();
+  Free();
+}
+
+void CXMLWriter::Allocate(size_t size)
+{
+  m_buffer = new char[size];
+  m_size = size;
+  pws_os::mlock(m_buffer, m_size);
+}
+
+void CXMLWriter::Grow(size_t size)
+{
+  char *const old_buffer = m_buffer;
+  const size_t old_size = m_size;
+  Allocate(std::max(size, std::max(2 * old_size, MEMORY_SIZE)));
+  if (old_buffer != NULL) {
+    std::memcpy(m_buffer, old_buffer, m_len);
+    trashMemory(old_buffer, old_size);
+    pws_os::munlock(old_buffer, old_size);
+    delete[] old_buffer;
+  }
+}
+
+void CXMLWriter::Free()
+{
+  if (m_buffer != NULL) {
+    trashMemory(m_buffer, m_size);
+    pws_os::munlock(m_buffer, m_size);
+    delete[] m_buffer;
+    m_buffer = NULL;
+  }
+  m_size = m_len = 0;
+}
+
+bool CXMLWriter::Flush()
+{
+  if (m_fp != NULL && m_len > 0) {
+    if (std::fwrite(m_buffer, 1, m_len, m_fp) != m_len)
+      m_bWriteFailed = true;
+    m_len = 0;
+  }
+  return !m_bWriteFailed;
+}
+
+char *CXMLWriter::Reserve(size_t n)
+{
+  if (m_len + n > m_size) {
+    if (m_fp == NULL) {
+      Grow(m_len + n);
+    } else {
+      Flush();
+      if (n > m_size) {
+        Free();
+        Allocate(n);
+      }
+    }
+  }
+  return m_buffer + m_len;
+}
+
+void CXMLWriter::Write(const char *s, size_t len)
+{
+  Commit(Append(Reserve(len), s, len));
+}
+
+CXMLWriter &CXMLWriter::operator<<(const char *s)
+{
+  Write(s, std::strlen(s));
+  return *this;
+}
+
+CXMLWriter &CXMLWriter::operator<<(char c)
+{
+  char *out = Reserve(1);
+  *out++ = c;
+  Commit(out);
+  return *this;
+}
+
+CXMLWriter &CXMLWriter::operator<<(long n)
+{
+  char digits[24];
+  char *p = digits + sizeof(digits);
+  unsigned long un = n < 0 ? 0UL - static_cast<unsigned long>(n) : static_cast<unsigned long>(n);
+  do {
+    *--p = static_cast<char>('0' + un % 10);
+    un /= 10;
+  } while (un != 0);
+  if (n < 0)
+    *--p = '-';
+  Write(p, digits + sizeof(digits) - p);
+  return *this;
+}
+
+void CXMLWriter::WriteText(const TCHAR *s, size_t len)
+{
+  char *const start = Reserve(4 * len);
+  char *out = start;
+  for (size_t i = 0; i < len; ) {
+    const size_t nplain = CopyPlain<false>(s + i, len - i, out);
+    out += nplain;
+    i += nplain;
+    if (i < len)
+      i += EncodeChar(s, i, len, out);
+  }
+  Commit(out);
+}
+
+void CXMLWriter::WriteEscaped(const TCHAR *s, size_t len)
+{
+  // "&quot;" is the longest for one character
+  char *const start = Reserve(6 * len);
+  char *out = start;
+  for (size_t i = 0; i < len; ) {
+    const size_t nplain = CopyPlain<false>(s + i, len - i, out);
+    out += nplain;
+    i += nplain;
+    if (i == len)
+      break;
+    switch (s[i]) {
+      case _T('&'):  out = Append(out, "&amp;", 5);  i++; break;
+      case _T('<'):  out = Append(out, "&lt;", 4);   i++; break;
+      case _T('>'):  out = Append(out, "&gt;", 4);   i++; break;
+      case _T('"'):  out = Append(out, "&quot;", 6); i++; break;
+      case _T('\''): out = Append(out, "&apos;", 6); i++; break;
+      default:
+        if (IsXMLChar(s[i]) || (s[i] >= 0xD800 && s[i] <= 0xDFFF))
+          i += EncodeChar(s, i, len, out);
+        else
+          i++; // can't be written, even as a character reference
+        break;
+    }
+  }
+  Commit(out);
+}
+
+void CXMLWriter::WriteUUID(const pws_os::CUUID &uuid, bool bCanonic)
+{
+  static const char hex[] = "0123456789abcdef";
+  uuid_array_t ua;
+  uuid.GetARep(ua);
+  char *out = Reserve(2 * sizeof(ua) + 4);
+  for (size_t i = 0; i < sizeof(ua); i++) {
+    *out++ = hex[ua[i] >> 4];
+    *out++ = hex[ua[i] & 0x0F];
+    if (bCanonic && (i == 3 || i == 5 || i == 7 || i == 9))
+      *out++ = '-';
+  }
+  Commit(out);
+}
+
+void CXMLWriter::WriteTime(time_t t)
+{
+  if (t != m_lastTime) {
+    // As PWSUtil::ConvertToDateTimeString(t, TMC_XML), without the
+    // conversions; unknown times (0 or invalid) are the epoch, as there
+    struct tm st;
+    if (t == 0 || localtime_s(&st, &t) != 0 ||
+        st.tm_year + 1900 < 0 || st.tm_year + 1900 > 9999) {
+      std::strcpy(m_szLastTime, "1970-01-01T00:00:00");
+    } else {
+      const int year = st.tm_year + 1900;
+      char *p = m_szLastTime;
+      p = Append2Digits(p, year / 100);
+      p = Append2Digits(p, year % 100);
+      *p++ = '-';
+      p = Append2Digits(p, st.tm_mon + 1);
+      *p++ = '-';
+      p = Append2Digits(p, st.tm_mday);
+      *p++ = 'T';
+      p = Append2Digits(p, st.tm_hour);
+      *p++ = ':';
+      p = Append2Digits(p, st.tm_min);
+      *p++ = ':';
+      p = Append2Digits(p, st.tm_sec);
+      *p = '\0';
+    }
+    m_lastTime = t;
+  }
+  Write(m_szLastTime, sizeof(m_szLastTime) - 1);
+}
+
+void CXMLWriter::WriteTime(const char *tabs, const char *name, time_t t)
+{
+  *this << tabs << '<' << name << '>';
+  WriteTime(t);
+  *this << "</" << name << ">\n";
+}
+
+bool CXMLWriter::WriteField(const char *tabs, const char *name, const StringX &value)
+{
+  const TCHAR *p = value.c_str();
+  const size_t n = value.length();
+  const size_t tabslen = std::strlen(tabs), namelen = std::strlen(name);
+
+  // Each character takes at most 4 bytes of UTF-8, and "]]>" takes 15
+  char *const start = Reserve(tabslen + 2 * namelen + 5 * n + 32);
+  char *out = Append(start, tabs, tabslen);
+  *out++ = '<';
+  out = Append(out, name, namelen);
+  out = Append(out, "><![CDATA[", 10);
+
+  for (size_t i = 0; i < n; ) {
+    const size_t nplain = CopyPlain<true>(p + i, n - i, out);
+    out += nplain;
+    i += nplain;
+    if (i == n)
+      break;
+    const TCHAR c = p[i];
+    if (c == _T(']')) {
+      if (i + 2 < n && p[i + 1] == _T(']') && p[i + 2] == _T('>')) {
+        // Each "]]>" ends one CDATA section with "]]" and starts another
+        // with ">"
+        out = Append(out, "]]]]><![CDATA[>", 15);
+        i += 3;
+      } else {
+        *out++ = ']';
+        i++;
+      }
+    } else if (!IsXMLChar(c)) {
+      // Nothing of the field has been committed
+      WriteInvalidComment(tabs, name, value);
+      return false;
+    } else {
+      i += EncodeChar(p, i, n, out);
+    }
+  }
+
+  out = Append(out, "]]></", 5);
+  out = Append(out, name, namelen);
+  out = Append(out, ">\n", 2);
+  Commit(out);
+  return true;
+}
+
+void CXMLWriter::WriteInvalidComment(const char *tabs, const char *name,
+                                     const StringX &value)
+{
+  *this << tabs << "<!-- Field '<" << name << ">' contains invalid XML character(s)\n";
+  *this << tabs << "   at position(s): ";
+  bool bFirst = true;
+  for (size_t i = 0; i < value.length(); i++) {
+    if (!IsXMLChar(value[i])) {
+      if (!bFirst)
+        *this << ", ";
+      bFirst = false;
+      *this << static_cast<long>(i + 1);
+    }
+  }
+  *this << '\n' << tabs << "   and has been skipped -->\n";
+}
@@ -0,0 +1,100 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+// XMLWriter.h
+//-----------------------------------------------------------------------------
+
+#ifndef __XMLWRITER_H
+#define __XMLWRITER_H
+
+#include "StringX.h"
+#include "os/UUID.h"
+
+#include <cstdio>
+#include <ctime>
+
+/*
+* CXMLWriter writes an XML export file as UTF-8, converting straight from
+* TCHARs into one large buffer, locked in memory and trashed when done,
+* which is written out with a single fwrite each time it fills.
+*
+* Fields are written as CDATA sections, split around any "]]>", and
+* attribute values with &<>"' replaced by entities. Runs of printable
+* ASCII, which is most of any field, are copied 8 characters at a time.
+*
+* A field is only added to the buffer once all of it has been converted,
+* so one found to have characters XML doesn't allow can be replaced by a
+* comment saying so, as PWSUtil::WriteXMLField() does.
+*
+* Constructed without a file, everything written is kept, the buffer
+* growing as needed, so that part of an export can be formatted on one
+* thread and then added to the file's writer on another, in order (see
+* the exports in CoreImpExp.cpp).
+*/
+
+class CXMLWriter
+{
+public:
+  explicit CXMLWriter(std::FILE *fp);
+  CXMLWriter(); // in memory
+  ~CXMLWriter();
+
+  // ASCII (or UTF-8) as is
+  void Write(const char *s, size_t len);
+  // All that's been written to an in memory writer
+  void Write(const CXMLWriter &part) {if (part.m_len != 0) Write(part.m_buffer, part.m_len);}
+  CXMLWriter &operator<<(const char *s);
+  CXMLWriter &operator<<(char c);
+  CXMLWriter &operator<<(long n); // in decimal
+  // Converted to UTF-8
+  void WriteText(const TCHAR *s, size_t len);
+  CXMLWriter &operator<<(const StringX &sx) {WriteText(sx.c_str(), sx.length()); return *this;}
+  CXMLWriter &operator<<(const stringT &s) {WriteText(s.c_str(), s.length()); return *this;}
+  // Converted to UTF-8, with &<>"' as entities, for attribute values
+  void WriteEscaped(const TCHAR *s, size_t len);
+  void WriteEscaped(const StringX &sx) {WriteEscaped(sx.c_str(), sx.length());}
+  // As hex digits, with hyphens if bCanonic
+  void WriteUUID(const pws_os::CUUID &uuid, bool bCanonic = false);
+  // yyyy-mm-ddThh:mm:ss, local time
+  void WriteTime(time_t t);
+
+  // tabs<name><![CDATA[value]]></name> on a line of its own, or a comment
+  // if value has characters XML doesn't allow, in which case returns false
+  bool WriteField(const char *tabs, const char *name, const StringX &value);
+  // tabs<name>time</name> on a line of its own
+  void WriteTime(const char *tabs, const char *name, time_t t);
+
+  // Writes out what's buffered, returns false if this or any earlier
+  // write failed. Does nothing in memory
+  bool Flush();
+  // In memory, discards all that's been written, trashing it
+  void Clear() {Free();}
+
+private:
+  CXMLWriter(const CXMLWriter &);            // Do not implement
+  CXMLWriter &operator=(const CXMLWriter &); // Do not implement
+
+  // Room for n more chars, at the returned pointer. Nothing is added
+  // until Commit() says how many were used
+  char *Reserve(size_t n);
+  void Commit(const char *end) {m_len = end - m_buffer;}
+  void Allocate(size_t size);
+  void Grow(size_t size);
+  void Free();
+  void WriteInvalidComment(const char *tabs, const char *name, const StringX &value);
+
+  std::FILE *m_fp;
+  char *m_buffer;
+  size_t m_size, m_len;
+  bool m_bWriteFailed;
+
+  // Last time formatted, as timestamps repeat
+  time_t m_lastTime;
+  char m_szLastTime[20];
+};
+
+#endif /* __XMLWRITER_H */
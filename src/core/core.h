@@ -274,6 +274,19 @@
 #define IDSC_REMOVEDKBSHORTCUTS         3450
 #define IDSC_XMLCHARACTERERRORS         3451
 #define IDSC_EXPORTDESCRIPTION          3452
+#define IDSC_MATCHESREGEX               3453
+#define IDSC_DOESNOTMATCHREGEX          3454
+#define IDSC_MATCHESGLOB                3455
+#define IDSC_DOESNOTMATCHGLOB           3456
+#define IDSC_DELTACONFLICT              3457
+#define IDSC_DELTACOMPLETED             3458
+#define IDSC_XMLUNEXPECTEDELEMENT       3459
+#define IDSC_XMLINVALIDUTF8             3460
+#define IDSC_XMLINVALIDVALUE            3461
+#define IDSC_XMLMISSINGELEMENT          3462
+#define IDSC_XMLMISSINGATTRIBUTE        3463
+#define IDSC_XMLUNEXPECTEDATTRIBUTE     3464
+#define IDSC_XMLDUPLICATEVALUE          3465
 
 // Keep DCA together
 #define IDSC_CURRENTDEFAULTDCA          4000
@@ -73,12 +73,16 @@ namespace {
     make_pair(IDSC_DELETEABASE, _("This entry has the following %d %ls:\n%ls\nPlease confirm to continue (alias entry's passwords will be replaced by this entry's password)?")),
     make_pair(IDSC_DELETEBASET, _("Delete Base Entry Confirmation")),
     make_pair(IDSC_DELETESBASE, _("This entry has the following %d %ls:\n%ls\nPlease confirm to continue (All shortcuts to this entry will be deleted)?")),
+    make_pair(IDSC_DELTACOMPLETED, _("\nDelta applied: %d added, %d updated, %d deleted, %d %ls")),
+    make_pair(IDSC_DELTACONFLICT, _("Change to \"%ls\" \"%ls\" \"%ls\" not applied.\n    Conflicting: %ls")),
     make_pair(IDSC_DOESNOTBEGINSWITH, _("does not begin with")),
     make_pair(IDSC_DOESNOTCONTAIN, _("does not contain")),
     make_pair(IDSC_DOESNOTCONTAINALL, _("does not contain all of")),
     make_pair(IDSC_DOESNOTCONTAINANY, _("does not contain any of")),
     make_pair(IDSC_DOESNOTENDWITH, _("does not end with")),
     make_pair(IDSC_DOESNOTEQUAL, _("does not equal")),
+    make_pair(IDSC_DOESNOTMATCHGLOB, _("does not match wildcard pattern")),
+    make_pair(IDSC_DOESNOTMATCHREGEX, _("does not match regular expression")),
     make_pair(IDSC_DUPLICATENUMBER, _(" Duplicate # %d")),
     make_pair(IDSC_ENCODING_PROBLEM, _("Trouble with a non-textual (e.g., time) field in record '%ls' - please check data carefully.")),
     make_pair(IDSC_END_REPORT1, _("End Report")),
@@ -213,6 +217,8 @@ namespace {
     make_pair(IDSC_LESSTHAN, _("less than")),
     make_pair(IDSC_LESSTHANEQUAL, _("less than or equal to")),
     make_pair(IDSC_LOCKFILEPATHNF, _("File or path not found")),
+    make_pair(IDSC_MATCHESGLOB, _("matches wildcard pattern")),
+    make_pair(IDSC_MATCHESREGEX, _("matches regular expression")),
     make_pair(IDSC_MERGEADDED, _("\nThe following new %ls %ls merged into this database:")),
     make_pair(IDSC_MERGECOMPLETED, _("\nMerge completed: %d %ls added (%d %ls, %d %ls, %d %ls)")),
     make_pair(IDSC_MERGECONFLICTS, _("Conflicting entries for \"%ls\" \"%ls\" \"%ls\".\n  Adding merged entry as \"%ls\" \"%ls\" \"%ls\".\n    Differing field(s): %ls")),
@@ -297,6 +303,7 @@ namespace {
     make_pair(IDSC_XERCESSAXGENERROR, _("XML %ls: line %d character %d: %ls")),
     make_pair(IDSC_XMLCHARACTERERRORS, _("*** Invalid XML characters found - see exported XML file for more details ***")),
     make_pair(IDSC_XMLCREATE_CFG_FAILED, _("Internal error: Couldn't initialize config file XML structure")),
+    make_pair(IDSC_XMLDUPLICATEVALUE, _("Value '%ls' of '%ls' is repeated")),
     make_pair(IDSC_XMLEXP_FILTERACTIVE, _("A filter was active. Export of data was restricted to include only those displayed.")),
     make_pair(IDSC_XMLEXP_FLDRESTRICT, _("Export of data was restricted to certain fields by the user.")),
     make_pair(IDSC_XMLEXP_POLICIES, _("Note: These Password Policies will not replace existing policies with the same name in the current database.")),
@@ -305,9 +312,15 @@ namespace {
     make_pair(IDSC_XMLEXP_SUBSETFIELDS, _("The user specified that the following fields be excluded from the export:")),
     make_pair(IDSC_XMLFILEERROR, _("Configuration file error:\n%ls\n%ls\noffset approximately at %d")),
     make_pair(IDSC_XMLIMPORT, _("import")),
+    make_pair(IDSC_XMLINVALIDUTF8, _("Invalid UTF-8 character")),
+    make_pair(IDSC_XMLINVALIDVALUE, _("Value '%ls' of '%ls' is not valid")),
     make_pair(IDSC_XMLLOADFAILURE, _("Unable to load configuration file")),
     make_pair(IDSC_XMLLOCK_CFG_FAILED, _("Failed to lock configuration file - opened by another instance of Lumimaja?")),
+    make_pair(IDSC_XMLMISSINGATTRIBUTE, _("Attribute '%ls' is missing from '%ls'")),
+    make_pair(IDSC_XMLMISSINGELEMENT, _("Element '%ls' is missing from '%ls'")),
     make_pair(IDSC_XMLSAVEFAILURE, _("Unable to save configuration file")),
+    make_pair(IDSC_XMLUNEXPECTEDATTRIBUTE, _("Attribute '%ls' is not expected here")),
+    make_pair(IDSC_XMLUNEXPECTEDELEMENT, _("Element '%ls' is not expected here")),
     make_pair(IDSC_XMLVALIDATION, _("validation")),
     make_pair(IDSC_YES, _("Yes")),
   }; // Pairs array
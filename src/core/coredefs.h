@@ -114,6 +114,14 @@ typedef KBShortcutMap::iterator KBShortcutMapIter;
 typedef KBShortcutMap::const_iterator KBShortcutMapConstIter;
 typedef std::pair<int32, pws_os::CUUID> KBShortcutMapPair;
 
+// Secondary indices on m_pwlist, used to resolve base entry references
+//  Key = title, or (group, title) / (title, user) pair; Value = entry uuid
+typedef std::multimap<StringX, pws_os::CUUID> TitleIndex;
+typedef TitleIndex::const_iterator TitleIndexConstIter;
+typedef std::pair<StringX, StringX> StringXPair;
+typedef std::multimap<StringXPair, pws_os::CUUID> PairIndex;
+typedef PairIndex::const_iterator PairIndexConstIter;
+
 struct PopulatePWPVector {
   PopulatePWPVector(std::vector<StringX> *pvPWPolicies) :
     m_pvPWPolicies(pvPWPolicies) {}
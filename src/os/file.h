@@ -29,6 +29,11 @@ namespace pws_os {
 
   extern std::FILE *FOpen(const stringT &filename, const TCHAR *mode);
   extern ulong64 fileLength(std::FILE *fp);
+  // Maps a whole file read-only, for reading through once. Returns NULL
+  // if it can't be read or is empty, else the mapping, to be unmapped
+  // with UnmapFile.
+  extern const void *MapFile(const stringT &filename, size_t &size);
+  extern void UnmapFile(const void *p, size_t size);
   extern const TCHAR PathSeparator; // slash for Unix, backslash for Windows
 }
 #endif /* __FILE_H */
@@ -36,12 +36,8 @@ inline errno_t localtime_s(struct tm *_tm, const time_t *time)
     _tm->tm_wday=_tm->tm_yday=_tm->tm_isdst=-1;
     return EINVAL;
   }
-  struct tm *res = std::localtime(time);
-  if (res) {
-    *_tm = *res;
-    return 0;
-  }
-  return EINVAL;
+  // As reentrant as the real thing, unlike std::localtime()
+  return localtime_r(time, _tm) != NULL ? 0 : EINVAL;
 }
 
 inline errno_t memcpy_s(void *dst, size_t dst_size, const void *src, size_t cnt)
@@ -11,6 +11,7 @@
  */
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdlib.h>
@@ -363,3 +364,30 @@ ulong64 pws_os::fileLength(std::FILE *fp)
   return ulong64(st.st_size);
 }
 
+const void *pws_os::MapFile(const stringT &filename, size_t &size)
+{
+  size = 0;
+  FILE *fp = pws_os::FOpen(filename, _T("rb"));
+  if (fp == NULL)
+    return NULL;
+  void *p = NULL;
+  struct stat st;
+  if (fstat(fileno(fp), &st) == 0 && st.st_size > 0) {
+    p = mmap(NULL, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+    if (p == MAP_FAILED) {
+      p = NULL;
+    } else {
+      size = size_t(st.st_size);
+      madvise(p, size, MADV_SEQUENTIAL);
+    }
+  }
+  fclose(fp); // the mapping outlives the descriptor
+  return p;
+}
+
+void pws_os::UnmapFile(const void *p, size_t size)
+{
+  if (p != NULL)
+    munmap(const_cast<void *>(p), size);
+}
+
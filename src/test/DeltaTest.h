@@ -0,0 +1,257 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+
+#include "test.h"
+#include "core/Delta.h"
+#include "core/PWScore.h"
+#include "core/Report.h"
+#include "os/file.h"
+
+class DeltaTest : public Test
+{
+
+public:
+  DeltaTest()
+    {
+  }
+  void run()
+  {
+    // The tests to run:
+    testDelta();
+    testCoreDelta();
+  }
+
+  static CItemData MakeEntry(const TCHAR *title, const TCHAR *password)
+  {
+    CItemData ci;
+    ci.CreateUUID();
+    ci.SetGroup(_T("Sites"));
+    ci.SetTitle(title);
+    ci.SetPassword(password);
+    ci.SetNotes(_T("Notes"));
+    return ci;
+  }
+
+  static std::vector<char> Record(const CItemData &ci)
+  {
+    std::vector<char> record;
+    ci.SerializePlainText(record);
+    return record;
+  }
+
+  void testDelta()
+  {
+    const pws_os::CUUID file_uuid;
+    std::vector<CItemData> entries;
+    entries.push_back(MakeEntry(_T("Bank"), _T("secret")));
+    entries.push_back(MakeEntry(_T("Mail"), _T("password")));
+    entries.push_back(MakeEntry(_T("Shop"), _T("letmein")));
+    const CItemData bank(entries[0]), mail(entries[1]), shop(entries[2]);
+
+    CDeltaManifest manifest, base;
+    manifest.SetFileUUID(file_uuid);
+    CDeltaManifest::FieldTags tags;
+    for (size_t i = 0; i < entries.size(); i++) {
+      manifest.GetFieldTags(Record(entries[i]), tags);
+      manifest.Add(entries[i].GetUUID(), tags);
+    }
+    std::vector<unsigned char> v;
+    manifest.Encode(v);
+    _test(base.Decode(v));
+    _test(base.GetFileUUID() == file_uuid && base.GetNumEntries() == 3);
+    v.pop_back();
+    _test(!CDeltaManifest().Decode(v));
+
+    // Mail's password changed, Shop deleted, Forum added
+    entries[1].SetPassword(_T("changed"));
+    entries.erase(entries.begin() + 2);
+    entries.push_back(MakeEntry(_T("Forum"), _T("forum")));
+    const CDelta::RecordFn getrecord =
+      [&entries](size_t i, pws_os::CUUID &uuid, std::vector<char> &record) {
+        uuid = entries[i].GetUUID();
+        entries[i].SerializePlainText(record);
+      };
+    CItemData::FieldBits bsAll;
+    bsAll.set();
+    CDelta delta;
+    CDeltaManifest current;
+    delta.Create(base, entries.size(), getrecord, bsAll, &current);
+    _test(delta.GetBaseUUID() == file_uuid);
+    const std::vector<CDelta::Change> &changes = delta.GetChanges();
+    _test(changes.size() == 3);
+    if (changes.size() != 3)
+      return;
+    _test(changes[0].cd.indatabase == BOTH && changes[0].cd.uuid0 == mail.GetUUID());
+    _test(changes[0].cd.bsDiffs.count() == 1 &&
+          changes[0].cd.bsDiffs.test(CItemData::PASSWORD));
+    _test(changes[1].cd.indatabase == CURRENT &&
+          changes[1].cd.uuid0 == entries[2].GetUUID());
+    _test(changes[2].cd.indatabase == COMPARE && changes[2].cd.uuid0 == shop.GetUUID());
+    _test(current.GetNumEntries() == 3 && current.Find(shop.GetUUID()) == NULL);
+
+    // Checked against the entries where it's applied
+    CItemData::FieldBits bsConflicts;
+    std::vector<char> record = Record(mail);
+    _test(delta.Check(changes[0], &record, bsConflicts) == CDelta::APPLIES);
+    record = Record(entries[1]);
+    _test(delta.Check(changes[0], &record, bsConflicts) == CDelta::APPLIED);
+    CItemData other(mail);
+    other.SetNotes(_T("Other notes"));
+    record = Record(other);
+    _test(delta.Check(changes[0], &record, bsConflicts) == CDelta::APPLIES);
+    other.SetPassword(_T("other"));
+    record = Record(other);
+    _test(delta.Check(changes[0], &record, bsConflicts) == CDelta::CONFLICT);
+    _test(bsConflicts.count() == 1 && bsConflicts.test(CItemData::PASSWORD));
+    _test(delta.Check(changes[0], NULL, bsConflicts) == CDelta::CONFLICT);
+
+    _test(delta.Check(changes[1], NULL, bsConflicts) == CDelta::APPLIES);
+    record = Record(entries[2]);
+    _test(delta.Check(changes[1], &record, bsConflicts) == CDelta::APPLIED);
+
+    record = Record(shop);
+    _test(delta.Check(changes[2], &record, bsConflicts) == CDelta::APPLIES);
+    _test(delta.Check(changes[2], NULL, bsConflicts) == CDelta::APPLIED);
+    other = shop;
+    other.SetTitle(_T("Store"));
+    record = Record(other);
+    _test(delta.Check(changes[2], &record, bsConflicts) == CDelta::CONFLICT);
+    _test(bsConflicts.test(CItemData::TITLE));
+
+    // Round tripped, and the records read back
+    CDelta copy;
+    delta.Encode(v);
+    _test(copy.Decode(v));
+    _test(copy.GetChanges().size() == 3);
+    const CDelta::Change &change = copy.GetChanges()[0];
+    CItemData updItem(mail);
+    updItem.ClearField(CItemData::PASSWORD);
+    _test(updItem.DeSerializePlainText(change.record));
+    _test(updItem.GetPassword() == _T("changed") && updItem.GetNotes() == _T("Notes"));
+    CItemData added;
+    _test(added.DeSerializePlainText(copy.GetChanges()[1].record));
+    _test(added.GetUUID() == entries[2].GetUUID() && added.GetTitle() == _T("Forum"));
+
+    // Only the fields asked for are modified
+    CItemData::FieldBits bsNotes;
+    bsNotes.set(CItemData::NOTES);
+    CDeltaManifest next;
+    delta.Create(base, entries.size(), getrecord, bsNotes, &next);
+    _test(delta.GetChanges().size() == 2);
+    // and those left out are still in the next delta
+    delta.Create(next, entries.size(), getrecord, bsAll);
+    _test(delta.GetChanges().size() == 1 &&
+          delta.GetChanges()[0].cd.uuid0 == mail.GetUUID() &&
+          delta.GetChanges()[0].cd.bsDiffs.test(CItemData::PASSWORD));
+  }
+
+  // The entry titled title in core
+  static const CItemData *FindTitle(PWScore &core, const TCHAR *title)
+  {
+    for (ItemListConstIter iter = core.GetEntryIter(); iter != core.GetEntryEndIter(); iter++) {
+      if (iter->second.GetTitle() == title)
+        return &iter->second;
+    }
+    return NULL;
+  }
+
+  static void EditEntry(PWScore &core, const TCHAR *title,
+                        CItemData::FieldType ft, const TCHAR *value)
+  {
+    const CItemData *pci = FindTitle(core, title);
+    if (pci == NULL)
+      return;
+    const CItemData old(*pci);
+    CItemData ci(old);
+    ci.SetFieldValue(ft, value);
+    core.Execute(EditEntryCommand::Create(&core, old, ci));
+  }
+
+  void testCoreDelta()
+  {
+    // A database and its copy, as PWScore writes and applies deltas
+    const StringX passkey(_T("delta test"));
+    const StringX dbfile(_T("DeltaTest.psafe3")), manifest(_T("DeltaTest.manifest"));
+    const StringX deltafile(_T("DeltaTest.delta"));
+    PWScore source, copy;
+    source.NewFile(passkey);
+    const TCHAR *titles[] = {_T("Bank"), _T("Mail"), _T("Shop"), _T("Forum")};
+    for (size_t i = 0; i < NumberOf(titles); i++)
+      source.Execute(AddEntryCommand::Create(&source, MakeEntry(titles[i], _T("secret"))));
+    _test(source.WriteFile(dbfile) == PWScore::SUCCESS);
+    _test(source.ReadFile(dbfile, passkey) == PWScore::SUCCESS);
+    _test(copy.ReadFile(dbfile, passkey) == PWScore::SUCCESS);
+    _test(source.GetFileUUID() != pws_os::CUUID::NullUUID() &&
+          copy.GetFileUUID() == source.GetFileUUID());
+    _test(source.WriteDeltaManifest(manifest) == PWScore::SUCCESS);
+
+    // Added, modified and deleted in the source; Forum's notes changed in
+    // both, differently, which is a conflict
+    source.Execute(AddEntryCommand::Create(&source, MakeEntry(_T("News"), _T("news"))));
+    EditEntry(source, _T("Mail"), CItemData::PASSWORD, _T("changed"));
+    EditEntry(source, _T("Forum"), CItemData::NOTES, _T("Source notes"));
+    const CItemData *pshop = FindTitle(source, _T("Shop"));
+    if (pshop != NULL)
+      source.Execute(DeleteEntryCommand::Create(&source, CItemData(*pshop)));
+    EditEntry(copy, _T("Forum"), CItemData::NOTES, _T("Copy notes"));
+
+    CItemData::FieldBits bsAll;
+    bsAll.set();
+    int numAdded, numModified, numDeleted, numConflicts;
+    _test(source.WriteDeltaFile(deltafile, manifest, bsAll, true,
+                                numAdded, numModified, numDeleted) == PWScore::SUCCESS);
+    _test(numAdded == 1 && numModified == 2 && numDeleted == 1);
+
+    CReport rpt;
+    Command *pcmd = NULL;
+    _test(copy.ApplyDeltaFile(deltafile, numAdded, numModified, numDeleted,
+                              numConflicts, rpt, pcmd) == PWScore::OK_WITH_ERRORS);
+    _test(numAdded == 1 && numModified == 1 && numDeleted == 1 && numConflicts == 1);
+    _test(pcmd != NULL);
+    if (pcmd != NULL)
+      copy.Execute(pcmd);
+    _test(copy.GetNumEntries() == 4);
+    _test(FindTitle(copy, _T("News")) != NULL && FindTitle(copy, _T("Shop")) == NULL);
+    const CItemData *pmail = FindTitle(copy, _T("Mail"));
+    _test(pmail != NULL && pmail->GetPassword() == _T("changed") &&
+          pmail->GetNotes() == _T("Notes"));
+    const CItemData *pforum = FindTitle(copy, _T("Forum"));
+    _test(pforum != NULL && pforum->GetNotes() == _T("Copy notes"));
+    _test(rpt.GetString().find(_T("Forum")) != StringX::npos);
+
+    // Applied again, only the conflict is left
+    pcmd = NULL;
+    _test(copy.ApplyDeltaFile(deltafile, numAdded, numModified, numDeleted,
+                              numConflicts, rpt, pcmd) == PWScore::OK_WITH_ERRORS);
+    _test(numAdded == 0 && numModified == 0 && numDeleted == 0 && numConflicts == 1);
+    delete pcmd;
+
+    // The manifest was rewritten, so the next delta has nothing in it
+    _test(source.WriteDeltaFile(deltafile, manifest, bsAll, false,
+                                numAdded, numModified, numDeleted) == PWScore::SUCCESS);
+    _test(numAdded == 0 && numModified == 0 && numDeleted == 0);
+
+    // Another database isn't the delta's base, and a wrong passkey can't
+    // read it
+    PWScore other;
+    other.NewFile(passkey);
+    pcmd = NULL;
+    _test(other.ApplyDeltaFile(deltafile, numAdded, numModified, numDeleted,
+                               numConflicts, rpt, pcmd) == PWScore::WRONG_DELTA_BASE);
+    _test(pcmd == NULL);
+    _test(other.WriteDeltaFile(deltafile, manifest, bsAll, false,
+                               numAdded, numModified, numDeleted) == PWScore::WRONG_DELTA_BASE);
+    other.NewFile(_T("not the passkey"));
+    _test(other.ApplyDeltaFile(deltafile, numAdded, numModified, numDeleted,
+                               numConflicts, rpt, pcmd) == PWScore::WRONG_PASSWORD);
+
+    pws_os::DeleteAFile(stringT(dbfile.c_str()));
+    pws_os::DeleteAFile(stringT(manifest.c_str()));
+    pws_os::DeleteAFile(stringT(deltafile.c_str()));
+  }
+};
@@ -0,0 +1,713 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+
+#include "test.h"
+#include "core/CompiledFilter.h"
+#include "core/LocalTime.h"
+#include "core/PWScore.h"
+#include "core/StringXStream.h"
+#include "core/UTF8Conv.h"
+#include "os/file.h"
+
+#include <cwchar>
+#include <vector>
+
+class FilterTest : public Test
+{
+
+public:
+  FilterTest()
+    : m_now(time(NULL)), m_seed(12345)
+    {
+  }
+  void run()
+  {
+    // The tests to run:
+    MakeEntries();
+    MakeRows();
+    testRows();
+    testHistoryRows();
+    testPolicyRows();
+    testGroups();
+    testUnsupportedPolicyFlags();
+    testPatternRulesXML();
+    testFilterSchema();
+  }
+
+  void testRows()
+  {
+    // Each row on its own
+    int nwrong = 0;
+    for (size_t i = 0; i < m_mainRows.size(); i++) {
+      st_filters filters;
+      filters.vMfldata.push_back(m_mainRows[i]);
+      nwrong += Compare(filters);
+    }
+    _test(nwrong == 0);
+  }
+
+  void testHistoryRows()
+  {
+    int nwrong = 0;
+    for (size_t i = 0; i < m_historyRows.size(); i++) {
+      st_filters filters;
+      filters.vMfldata.push_back(Row(FT_PWHIST, PWSMatch::MT_PWHIST, PWSMatch::MR_INVALID));
+      filters.vHfldata.push_back(m_historyRows[i]);
+      nwrong += Compare(filters);
+    }
+    _test(nwrong == 0);
+  }
+
+  void testPolicyRows()
+  {
+    int nwrong = 0;
+    for (size_t i = 0; i < m_policyRows.size(); i++) {
+      st_filters filters;
+      filters.vMfldata.push_back(Row(FT_POLICY, PWSMatch::MT_POLICY, PWSMatch::MR_INVALID));
+      filters.vPfldata.push_back(m_policyRows[i]);
+      nwrong += Compare(filters);
+    }
+    _test(nwrong == 0);
+  }
+
+  void testGroups()
+  {
+    // Random "And"/"Or" combinations of rows, some inactive
+    int nwrong = 0;
+    for (int i = 0; i < 2000; i++) {
+      st_filters filters;
+      AddRandomRows(m_mainRows, 1 + Random(4), filters.vMfldata);
+      AddRandomRows(m_historyRows, Random(4), filters.vHfldata);
+      AddRandomRows(m_policyRows, Random(4), filters.vPfldata);
+      if (Random(2) == 0)
+        InsertRandomRow(Row(FT_PWHIST, PWSMatch::MT_PWHIST, PWSMatch::MR_INVALID),
+                        filters.vMfldata);
+      if (Random(2) == 0)
+        InsertRandomRow(Row(FT_POLICY, PWSMatch::MT_POLICY, PWSMatch::MR_INVALID),
+                        filters.vMfldata);
+      nwrong += Compare(filters);
+    }
+    _test(nwrong == 0);
+
+    // An "Or" with a group that doesn't restrict anything lets all through
+    st_filters filters;
+    filters.vMfldata.push_back(Row(FT_TITLE, PWSMatch::MT_STRING, PWSMatch::MR_EQUALS));
+    filters.vMfldata.back().fstring = _T("no such title");
+    filters.vMfldata.push_back(Row(FT_PWHIST, PWSMatch::MT_PWHIST, PWSMatch::MR_INVALID));
+    filters.vMfldata.back().ltype = LC_OR;
+    _test(CCompiledFilter(filters, m_now).IsEmpty());
+    _test(Compare(filters) == 0);
+  }
+
+  void testUnsupportedPolicyFlags()
+  {
+    // PWPolicy has no "easy vision" or "hexadecimal" flags, so they're
+    // never set, even with every flag PWPolicy has
+    CItemData ci;
+    ci.CreateUUID();
+    PWPolicy pwp;
+    pwp.flags = PWPolicy::UseLowercase | PWPolicy::UseUppercase |
+                PWPolicy::UseDigits | PWPolicy::UseSymbols |
+                PWPolicy::MakePronounceable;
+    pwp.length = 12;
+    ci.SetPWPolicy(pwp);
+
+    const FieldType fields[] = {PT_EASYVISION, PT_HEXADECIMAL};
+    for (size_t i = 0; i < NumberOf(fields); i++) {
+      st_filters filters;
+      filters.vMfldata.push_back(Row(FT_POLICY, PWSMatch::MT_POLICY, PWSMatch::MR_INVALID));
+      filters.vPfldata.push_back(Row(fields[i], PWSMatch::MT_BOOL, PWSMatch::MR_SET));
+      CCompiledFilter filter(filters, m_now);
+      _test(!filter.IsEmpty() && !filter.Passes(ci));
+      _test(Compare(filters) == 0);
+
+      // "Not set" doesn't restrict anything
+      filters.vPfldata[0].rule = PWSMatch::MR_NOTSET;
+      filter.Compile(filters, m_now);
+      _test(filter.IsEmpty() && filter.Passes(ci));
+    }
+
+    // Unlike the flags it does have
+    st_filters filters;
+    filters.vMfldata.push_back(Row(FT_POLICY, PWSMatch::MT_POLICY, PWSMatch::MR_INVALID));
+    filters.vPfldata.push_back(Row(PT_PRONOUNCEABLE, PWSMatch::MT_BOOL, PWSMatch::MR_SET));
+    _test(CCompiledFilter(filters, m_now).Passes(ci));
+  }
+
+  void testPatternRulesXML()
+  {
+    // The regular expression and glob rules are written to filter XML
+    // and imported back as they were, with their patterns and case
+    st_filters filters;
+    filters.fname = _T("Patterns");
+    filters.vMfldata.push_back(Row(FT_TITLE, PWSMatch::MT_STRING, PWSMatch::MR_REGEX));
+    filters.vMfldata.back().fstring = _T("^(Visa|bank)[0-9]*$");
+    filters.vMfldata.back().fcase = true;
+    filters.vMfldata.push_back(Row(FT_USER, PWSMatch::MT_STRING, PWSMatch::MR_NOTREGEX));
+    filters.vMfldata.back().fstring = _T("a&b <c>");
+    filters.vMfldata.push_back(Row(FT_URL, PWSMatch::MT_STRING, PWSMatch::MR_GLOB));
+    filters.vMfldata.back().fstring = _T("https://*.example.com/*");
+    filters.vMfldata.back().ltype = LC_OR;
+    filters.vMfldata.push_back(Row(FT_NOTES, PWSMatch::MT_STRING, PWSMatch::MR_NOTGLOB));
+    filters.vMfldata.back().fstring = _T("*[0-9]?");
+    filters.vMfldata.back().fcase = true;
+    filters.vMfldata.push_back(Row(FT_PASSWORD, PWSMatch::MT_PASSWORD, PWSMatch::MR_REGEX));
+    filters.vMfldata.back().fstring = _T("^hunter");
+    filters.vMfldata.push_back(Row(FT_PWHIST, PWSMatch::MT_PWHIST, PWSMatch::MR_INVALID));
+    filters.vHfldata.push_back(Row(HT_PASSWORDS, PWSMatch::MT_PASSWORD, PWSMatch::MR_GLOB));
+    filters.vHfldata.back().fstring = _T("Bank*");
+    filters.vHfldata.push_back(Row(HT_PASSWORDS, PWSMatch::MT_PASSWORD, PWSMatch::MR_NOTREGEX));
+    filters.vHfldata.back().fstring = _T("^old$");
+    filters.num_Mactive = int(filters.vMfldata.size());
+    filters.num_Hactive = int(filters.vHfldata.size());
+
+    PWSFilters mapFilters;
+    st_Filterkey fk;
+    fk.fpool = FPOOL_DATABASE;
+    fk.cs_filtername = filters.fname;
+    mapFilters.insert(PWSFilters::Pair(fk, filters));
+    coStringXStream oss;
+    _test(mapFilters.WriteFilterXMLFile(oss, PWSfile::HeaderRecord(), _T("")) ==
+          PWScore::SUCCESS);
+
+    CUTF8Conv conv;
+    StringX sxXML;
+    _test(conv.FromUTF8(reinterpret_cast<const unsigned char *>(oss.str().c_str()),
+                        oss.str().length(), sxXML));
+    PWSFilters imported;
+    stringT strErrors;
+    _test(imported.ImportFilterXMLFile(FPOOL_DATABASE, sxXML, _T(""),
+                                       GetXSDFile(_T("lumimaja_filter.xsd")),
+                                       strErrors, NULL) == PWScore::SUCCESS);
+    _test(strErrors.empty());
+    _test(imported.size() == 1);
+    if (imported.size() == 1) {
+      const st_filters &result = imported.begin()->second;
+      _test(result.fname == filters.fname);
+      _test(result.vMfldata == filters.vMfldata);
+      _test(result.vHfldata == filters.vHfldata);
+      _test(result.vPfldata.empty());
+      _test(Compare(result) == 0);
+    }
+  }
+
+  void testFilterSchema()
+  {
+    // Whichever library checks the filters, they must fail as the schema does
+    const TCHAR *title = _T("<title><rule>CO</rule><logic>and</logic>")
+                         _T("<test><string>Bank</string><case>0</case></test></title>");
+    _test(ImportFilter(title) == PWScore::SUCCESS);
+    _test(ImportFilter(title, _T("filterz")) == PWScore::XML_FAILED_VALIDATION);
+    _test(ImportFilter(title, _T("filters"), _T("")) == PWScore::XML_FAILED_VALIDATION);
+
+    // Facets
+    _test(ImportFilter(_T("<title><rule>PR</rule><logic>and</logic>")
+                       _T("<test><string>Bank</string><case>0</case></test></title>")) ==
+          PWScore::XML_FAILED_VALIDATION);
+    _test(ImportFilter(_T("<title><rule>CO</rule><logic>and</logic>")
+                       _T("<test><string>Bank</string><case>2</case></test></title>")) ==
+          PWScore::XML_FAILED_VALIDATION);
+    _test(ImportFilter(_T("<DCA><rule>IS</rule><logic>and</logic>")
+                       _T("<test><dca>10</dca></test></DCA>")) ==
+          PWScore::XML_FAILED_VALIDATION);
+
+    // Missing or unexpected elements
+    _test(ImportFilter(_T("<title><rule>CO</rule>")
+                       _T("<test><string>Bank</string><case>0</case></test></title>")) ==
+          PWScore::XML_FAILED_VALIDATION);
+    _test(ImportFilter(_T("<title><rule>CO</rule><logic>and</logic>")
+                       _T("<test><string>Bank</string></test></title>")) ==
+          PWScore::XML_FAILED_VALIDATION);
+    _test(ImportFilter(_T("")) == PWScore::XML_FAILED_VALIDATION);
+    _test(ImportFilter(_T("<colour><rule>EQ</rule><logic>and</logic></colour>")) ==
+          PWScore::XML_FAILED_VALIDATION);
+  }
+
+  // Imports a filter with one entry, with field as its content, under root,
+  // with filtername as the filter's name if it's not empty
+  static int ImportFilter(const stringT &field, const stringT &root = _T("filters"),
+                          const stringT &filtername = _T("Test"))
+  {
+    stringT xml = _T("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<") + root +
+                  _T(" version=\"1\">\n<filter");
+    if (!filtername.empty())
+      xml += _T(" filtername=\"") + filtername + _T("\"");
+    xml += _T(">\n<filter_entry active=\"yes\">") + field +
+           _T("</filter_entry>\n</filter>\n</") + root + _T(">\n");
+
+    PWSFilters imported;
+    stringT strErrors;
+    return imported.ImportFilterXMLFile(FPOOL_DATABASE, StringX(xml.c_str()), _T(""),
+                                        GetXSDFile(_T("lumimaja_filter.xsd")),
+                                        strErrors, NULL);
+  }
+
+  // The schema is in the source tree's xml directory, which is a sibling
+  // of the build directory or two levels up from src/test
+  static stringT GetXSDFile(const stringT &name)
+  {
+    const stringT sibling = _T("../xml/") + name;
+    return pws_os::FileExists(sibling) ? sibling : _T("../../xml/") + name;
+  }
+
+private:
+  unsigned int Random(unsigned int n)
+  {
+    m_seed = m_seed * 1103515245 + 12345;
+    return (m_seed >> 8) % n;
+  }
+
+  static st_FilterRow Row(FieldType ft, PWSMatch::MatchType mt,
+                          PWSMatch::MatchRule rule)
+  {
+    st_FilterRow row;
+    row.bFilterComplete = true;
+    row.ftype = ft;
+    row.mtype = mt;
+    row.rule = rule;
+    row.ltype = LC_AND;
+    return row;
+  }
+
+  // A time a whole number of days and a half hour or so from now, so
+  // that "expired" tests don't depend on exactly when they're run
+  time_t RandomTime()
+  {
+    if (Random(4) == 0)
+      return time_t(0);
+    const int days = int(Random(9)) - 4;
+    const int hours = int(Random(23)) - 11;
+    return m_now + days * 86400 + hours * 3600 + 1800;
+  }
+
+  StringX RandomHistory()
+  {
+    const unsigned int num = Random(4);
+    TCHAR buf[32];
+    swprintf(buf, 32, L"%d%02x%02x", int(Random(2)), Random(6), num);
+    StringX sxHistory(buf);
+    const TCHAR *passwords[] = {_T("secret"), _T("Bank123"), _T("old"), _T("")};
+    for (unsigned int i = 0; i < num; i++) {
+      const StringX sxPassword = passwords[Random(4)];
+      swprintf(buf, 32, L"%08x%04x", unsigned(RandomTime()), unsigned(sxPassword.length()));
+      sxHistory += buf;
+      sxHistory += sxPassword;
+    }
+    return sxHistory;
+  }
+
+  void MakeEntries()
+  {
+    const TCHAR *groups[] = {_T(""), _T("Bank"), _T("bank.Cards"), _T("Mail"), _T("Work.mail.Old")};
+    const TCHAR *titles[] = {_T(""), _T("Visa"), _T("bank"), _T("Gmail"), _T("Router k")};
+    const TCHAR *texts[] = {_T(""), _T("bank notes"), _T("https://mail.example.com"),
+                            _T("k"), _T("BANK"), _T("Online Bank")};
+    const TCHAR *passwords[] = {_T(""), _T("secret"), _T("Bank123"), _T("hunter2"), _T("aaaa")};
+    const CItemData::EntryType types[] = {
+      CItemData::ET_NORMAL, CItemData::ET_ALIASBASE, CItemData::ET_SHORTCUTBASE,
+      CItemData::ET_SHORTCUT};
+    const CItemData::EntryStatus statuses[] = {
+      CItemData::ES_CLEAN, CItemData::ES_ADDED, CItemData::ES_MODIFIED};
+    const uint16 policyflags[] = {
+      PWPolicy::UseLowercase, PWPolicy::UseUppercase, PWPolicy::UseDigits,
+      PWPolicy::UseSymbols, PWPolicy::MakePronounceable};
+    const int16 dcas[] = {-1, 0, 3};
+
+    for (int i = 0; i < 40; i++) {
+      CItemData ci;
+      ci.CreateUUID();
+      ci.SetGroup(groups[Random(5)]);
+      ci.SetTitle(titles[Random(5)]);
+      ci.SetUser(texts[Random(6)]);
+      ci.SetNotes(texts[Random(6)]);
+      ci.SetURL(texts[Random(6)]);
+      ci.SetEmail(texts[Random(6)]);
+      ci.SetRunCommand(texts[Random(6)]);
+      ci.SetAutoType(texts[Random(6)]);
+      ci.SetPolicyName(texts[Random(6)]);
+      ci.SetPassword(passwords[Random(5)]);
+      ci.SetCTime(RandomTime());
+      ci.SetPMTime(RandomTime());
+      ci.SetATime(RandomTime());
+      ci.SetXTime(RandomTime());
+      ci.SetRMTime(RandomTime());
+      int32 xint = int32(Random(3)) * 15;
+      ci.SetXTimeInt(xint);
+      if (Random(2) == 0)
+        ci.SetKBShortcut(int32(0x0441 + Random(3)));
+      int16 dca = dcas[Random(3)];
+      ci.SetDCA(dca);
+      dca = dcas[Random(3)];
+      ci.SetShiftDCA(dca);
+      ci.SetProtected(Random(2) == 0);
+      if (Random(3) == 0) {
+        const unsigned char data[] = {1, 2, 3};
+        ci.SetUnknownField(0x70, sizeof(data), data);
+      }
+      if (Random(3) != 0)
+        ci.SetPWHistory(RandomHistory());
+      if (Random(2) == 0) {
+        PWPolicy pwp;
+        for (size_t f = 0; f < NumberOf(policyflags); f++) {
+          if (Random(2) == 0)
+            pwp.flags |= policyflags[f];
+        }
+        pwp.length = Random(20);
+        if (Random(2) == 0)
+          pwp.symbols = _T("#$%");
+        ci.SetPWPolicy(pwp);
+      }
+      ci.SetEntryType(types[Random(4)]);
+      ci.SetStatus(statuses[Random(3)]);
+      m_entries.push_back(ci);
+    }
+    // The first entry, a base, has an alias: the password tests are of
+    // the base's
+    m_entries[0].SetAliasBase();
+    m_entries[1].SetAlias();
+  }
+
+  void MakeRows()
+  {
+    const FieldType stringfields[] = {
+      FT_GROUPTITLE, FT_GROUP, FT_TITLE, FT_USER, FT_NOTES, FT_URL,
+      FT_AUTOTYPE, FT_RUNCMD, FT_EMAIL, FT_SYMBOLS, FT_POLICYNAME, FT_PASSWORD};
+    const PWSMatch::MatchRule stringrules[] = {
+      PWSMatch::MR_EQUALS, PWSMatch::MR_NOTEQUAL,
+      PWSMatch::MR_BEGINS, PWSMatch::MR_NOTBEGIN,
+      PWSMatch::MR_ENDS, PWSMatch::MR_NOTEND,
+      PWSMatch::MR_CONTAINS, PWSMatch::MR_NOTCONTAIN,
+      PWSMatch::MR_CNTNANY, PWSMatch::MR_NOTCNTNANY,
+      PWSMatch::MR_CNTNALL, PWSMatch::MR_NOTCNTNALL,
+      PWSMatch::MR_REGEX, PWSMatch::MR_NOTREGEX,
+      PWSMatch::MR_GLOB, PWSMatch::MR_NOTGLOB};
+    const TCHAR *values[] = {
+      _T("bank"), _T("Bank"), _T("k"), _T("^[bm]a"), _T("*a?l*"), _T("")};
+    const PWSMatch::MatchRule intrules[] = {
+      PWSMatch::MR_EQUALS, PWSMatch::MR_NOTEQUAL,
+      PWSMatch::MR_PRESENT, PWSMatch::MR_NOTPRESENT,
+      PWSMatch::MR_BETWEEN, PWSMatch::MR_LT, PWSMatch::MR_LE,
+      PWSMatch::MR_GT, PWSMatch::MR_GE};
+    const int nums[][2] = {{0, 0}, {3, 8}, {6, 6}, {15, 30}};
+    const FieldType datefields[] = {FT_CTIME, FT_PMTIME, FT_ATIME, FT_XTIME, FT_RMTIME};
+    const PWSMatch::MatchRule daterules[] = {
+      PWSMatch::MR_EQUALS, PWSMatch::MR_NOTEQUAL,
+      PWSMatch::MR_PRESENT, PWSMatch::MR_NOTPRESENT,
+      PWSMatch::MR_BETWEEN, PWSMatch::MR_BEFORE, PWSMatch::MR_AFTER,
+      PWSMatch::MR_LT, PWSMatch::MR_LE, PWSMatch::MR_GT, PWSMatch::MR_GE};
+    const int days[][2] = {{-2, 1}, {0, 0}, {3, -1}, {-4, 4}};
+
+    // Main rows
+    for (size_t f = 0; f < NumberOf(stringfields); f++) {
+      const PWSMatch::MatchType mt = (stringfields[f] == FT_PASSWORD) ?
+        PWSMatch::MT_PASSWORD : PWSMatch::MT_STRING;
+      AddStringRows(stringfields[f], mt, stringrules, NumberOf(stringrules),
+                    values, NumberOf(values), m_mainRows);
+      m_mainRows.push_back(Row(stringfields[f], mt, PWSMatch::MR_PRESENT));
+      m_mainRows.push_back(Row(stringfields[f], mt, PWSMatch::MR_NOTPRESENT));
+    }
+    for (int n = 1; n <= 10; n += 3) {
+      m_mainRows.push_back(Row(FT_PASSWORD, PWSMatch::MT_PASSWORD, PWSMatch::MR_WILLEXPIRE));
+      m_mainRows.back().fnum1 = n;
+    }
+    m_mainRows.push_back(Row(FT_PASSWORD, PWSMatch::MT_PASSWORD, PWSMatch::MR_EXPIRED));
+
+    AddIntegerRows(FT_XTIME_INT, intrules, NumberOf(intrules), nums, NumberOf(nums), m_mainRows);
+    AddIntegerRows(FT_PASSWORDLEN, intrules, NumberOf(intrules), nums, NumberOf(nums), m_mainRows);
+    for (size_t r = 0; r < NumberOf(intrules); r++) {
+      for (int unit = 0; unit <= 1; unit++) {
+        st_FilterRow row = Row(FT_ENTRYSIZE, PWSMatch::MT_ENTRYSIZE, intrules[r]);
+        row.funit = unit;
+        row.fnum1 = unit == 0 ? 150 : 0;
+        row.fnum2 = unit == 0 ? 250 : 1;
+        m_mainRows.push_back(row);
+      }
+    }
+    for (size_t f = 0; f < NumberOf(datefields); f++)
+      AddDateRows(datefields[f], daterules, NumberOf(daterules), days, NumberOf(days), m_mainRows);
+
+    const FieldType boolfields[] = {FT_PROTECTED, FT_KBSHORTCUT, FT_UNKNOWNFIELDS};
+    const PWSMatch::MatchRule boolrules[] = {
+      PWSMatch::MR_IS, PWSMatch::MR_ISNOT, PWSMatch::MR_PRESENT, PWSMatch::MR_NOTPRESENT};
+    for (size_t f = 0; f < NumberOf(boolfields); f++) {
+      for (size_t r = 0; r < NumberOf(boolrules); r++)
+        m_mainRows.push_back(Row(boolfields[f], PWSMatch::MT_BOOL, boolrules[r]));
+    }
+
+    const CItemData::EntryType types[] = {
+      CItemData::ET_NORMAL, CItemData::ET_ALIASBASE, CItemData::ET_ALIAS,
+      CItemData::ET_SHORTCUTBASE, CItemData::ET_SHORTCUT};
+    const CItemData::EntryStatus statuses[] = {
+      CItemData::ES_CLEAN, CItemData::ES_ADDED, CItemData::ES_MODIFIED};
+    const short dcas[] = {-1, 0, 3};
+    for (int r = PWSMatch::MR_IS; r <= PWSMatch::MR_ISNOT; r++) {
+      const PWSMatch::MatchRule rule = PWSMatch::MatchRule(r);
+      for (size_t t = 0; t < NumberOf(types); t++) {
+        m_mainRows.push_back(Row(FT_ENTRYTYPE, PWSMatch::MT_ENTRYTYPE, rule));
+        m_mainRows.back().etype = types[t];
+      }
+      for (size_t s = 0; s < NumberOf(statuses); s++) {
+        m_mainRows.push_back(Row(FT_ENTRYSTATUS, PWSMatch::MT_ENTRYSTATUS, rule));
+        m_mainRows.back().estatus = statuses[s];
+      }
+      for (size_t d = 0; d < NumberOf(dcas); d++) {
+        m_mainRows.push_back(Row(FT_DCA, PWSMatch::MT_DCA, rule));
+        m_mainRows.back().fdca = dcas[d];
+        m_mainRows.push_back(Row(FT_SHIFTDCA, PWSMatch::MT_SHIFTDCA, rule));
+        m_mainRows.back().fdca = dcas[d];
+      }
+    }
+
+    // Password history rows
+    m_historyRows.push_back(Row(HT_PRESENT, PWSMatch::MT_BOOL, PWSMatch::MR_PRESENT));
+    m_historyRows.push_back(Row(HT_PRESENT, PWSMatch::MT_BOOL, PWSMatch::MR_NOTPRESENT));
+    m_historyRows.push_back(Row(HT_ACTIVE, PWSMatch::MT_BOOL, PWSMatch::MR_ACTIVE));
+    m_historyRows.push_back(Row(HT_ACTIVE, PWSMatch::MT_BOOL, PWSMatch::MR_INACTIVE));
+    AddIntegerRows(HT_NUM, intrules, NumberOf(intrules), nums, NumberOf(nums), m_historyRows);
+    AddIntegerRows(HT_MAX, intrules, NumberOf(intrules), nums, NumberOf(nums), m_historyRows);
+    AddDateRows(HT_CHANGEDATE, daterules, NumberOf(daterules), days, NumberOf(days), m_historyRows);
+    // "Contains any/all" aren't password rules
+    AddStringRows(HT_PASSWORDS, PWSMatch::MT_PASSWORD, stringrules, 8,
+                  values, NumberOf(values), m_historyRows);
+    AddStringRows(HT_PASSWORDS, PWSMatch::MT_PASSWORD, stringrules + 12, 4,
+                  values, NumberOf(values), m_historyRows);
+
+    // Password policy rows
+    m_policyRows.push_back(Row(PT_PRESENT, PWSMatch::MT_BOOL, PWSMatch::MR_PRESENT));
+    m_policyRows.push_back(Row(PT_PRESENT, PWSMatch::MT_BOOL, PWSMatch::MR_NOTPRESENT));
+    const FieldType intpolicyfields[] = {
+      PT_LENGTH, PT_LOWERCASE, PT_UPPERCASE, PT_DIGITS, PT_SYMBOLS};
+    for (size_t f = 0; f < NumberOf(intpolicyfields); f++)
+      AddIntegerRows(intpolicyfields[f], intrules, NumberOf(intrules), nums, NumberOf(nums),
+                     m_policyRows);
+    const FieldType boolpolicyfields[] = {PT_EASYVISION, PT_PRONOUNCEABLE, PT_HEXADECIMAL};
+    for (size_t f = 0; f < NumberOf(boolpolicyfields); f++) {
+      m_policyRows.push_back(Row(boolpolicyfields[f], PWSMatch::MT_BOOL, PWSMatch::MR_SET));
+      m_policyRows.push_back(Row(boolpolicyfields[f], PWSMatch::MT_BOOL, PWSMatch::MR_NOTSET));
+    }
+  }
+
+  static void AddStringRows(FieldType ft, PWSMatch::MatchType mt,
+                            const PWSMatch::MatchRule *rules, size_t nrules,
+                            const TCHAR **values, size_t nvalues, vFilterRows &rows)
+  {
+    for (size_t r = 0; r < nrules; r++) {
+      for (size_t v = 0; v < nvalues; v++) {
+        for (int bCase = 0; bCase <= 1; bCase++) {
+          rows.push_back(Row(ft, mt, rules[r]));
+          rows.back().fstring = values[v];
+          rows.back().fcase = bCase != 0;
+        }
+      }
+    }
+  }
+
+  static void AddIntegerRows(FieldType ft, const PWSMatch::MatchRule *rules, size_t nrules,
+                             const int (*nums)[2], size_t nnums, vFilterRows &rows)
+  {
+    for (size_t r = 0; r < nrules; r++) {
+      for (size_t n = 0; n < nnums; n++) {
+        rows.push_back(Row(ft, PWSMatch::MT_INTEGER, rules[r]));
+        rows.back().fnum1 = nums[n][0];
+        rows.back().fnum2 = nums[n][1];
+      }
+    }
+  }
+
+  // Both absolute and relative dates
+  void AddDateRows(FieldType ft, const PWSMatch::MatchRule *rules, size_t nrules,
+                   const int (*days)[2], size_t ndays, vFilterRows &rows)
+  {
+    const time_t today = PWSLocalTime::StartOfDay(m_now);
+    for (size_t r = 0; r < nrules; r++) {
+      for (size_t d = 0; d < ndays; d++) {
+        st_FilterRow row = Row(ft, PWSMatch::MT_DATE, rules[r]);
+        row.fdatetype = 0;
+        row.fdate1 = PWSLocalTime::StartOfDay(today, days[d][0]);
+        row.fdate2 = PWSLocalTime::StartOfDay(today, days[d][1]);
+        rows.push_back(row);
+        row.fdatetype = 1;
+        row.fdate1 = row.fdate2 = time_t(0);
+        row.fnum1 = days[d][0];
+        row.fnum2 = days[d][1];
+        rows.push_back(row);
+      }
+    }
+  }
+
+  void AddRandomRows(const vFilterRows &pool, unsigned int num, vFilterRows &rows)
+  {
+    for (unsigned int i = 0; i < num; i++)
+      InsertRandomRow(pool[Random(unsigned(pool.size()))], rows);
+  }
+
+  void InsertRandomRow(const st_FilterRow &row, vFilterRows &rows)
+  {
+    st_FilterRow newrow(row);
+    newrow.ltype = Random(3) == 0 ? LC_OR : LC_AND;
+    newrow.bFilterActive = Random(10) != 0;
+    rows.insert(rows.begin() + Random(unsigned(rows.size()) + 1), newrow);
+  }
+
+  // Number of entries for which the compiled filter differs from
+  // evaluating the rows one by one
+  int Compare(const st_filters &filters) const
+  {
+    const CCompiledFilter filter(filters, m_now);
+    int nwrong = 0;
+    for (size_t i = 0; i < m_entries.size(); i++) {
+      const CItemData &ci = m_entries[i];
+      const CItemData *pBase = ci.IsAlias() ? &m_entries[0] : NULL;
+      const CItemData &pwentry = pBase != NULL ? *pBase : ci;
+      if (filter.Passes(ci, pBase) !=
+          RowsPass(filters.vMfldata, filters, ci, pwentry))
+        nwrong++;
+    }
+    return nwrong;
+  }
+
+  // Groups of rows joined by "And", themselves joined by "Or"
+  bool RowsPass(const vFilterRows &rows, const st_filters &filters,
+                const CItemData &ci, const CItemData &pwentry) const
+  {
+    bool bFirst(true), bGroup(true);
+    for (vFilterRows::const_iterator iter = rows.begin(); iter != rows.end(); iter++) {
+      if (!iter->bFilterActive)
+        continue;
+      if (iter->ltype == LC_OR && !bFirst) {
+        if (bGroup)
+          return true;
+        bGroup = true;
+      }
+      bFirst = false;
+      if (bGroup && !RowPasses(*iter, filters, ci, pwentry))
+        bGroup = false;
+    }
+    return bGroup;
+  }
+
+  // A row, as CItemData::Matches() and PWSMatch::Match() have it
+  bool RowPasses(const st_FilterRow &row, const st_filters &filters,
+                 const CItemData &ci, const CItemData &pwentry) const
+  {
+    const int ft = row.ftype;
+    const int iFunction = row.rule;
+    const int iCaseFunction = row.fcase ? -iFunction : iFunction;
+
+    size_t historyMax(0), num_err;
+    const bool bHistoryActive = pwentry.GetPWHistoryStatus(historyMax, num_err);
+    const PWHistPasswords &history = pwentry.GetPWHistoryPasswords();
+    PWPolicy pwp;
+    pwentry.GetPWPolicy(pwp);
+
+    switch (row.mtype) {
+      case PWSMatch::MT_PASSWORD:
+        if (ft == HT_PASSWORDS) {
+          for (size_t i = 0; i < history.size(); i++) {
+            if (PWSMatch::Match(row.fstring, history[i].password, iCaseFunction))
+              return true;
+          }
+          return false;
+        }
+        if (iFunction == PWSMatch::MR_EXPIRED)
+          return pwentry.IsExpired();
+        if (iFunction == PWSMatch::MR_WILLEXPIRE)
+          return pwentry.WillExpire(row.fnum1);
+        return pwentry.Matches(row.fstring.c_str(), ft, iCaseFunction);
+      case PWSMatch::MT_STRING:
+        return ci.Matches(row.fstring.c_str(), ft, iCaseFunction);
+      case PWSMatch::MT_INTEGER:
+      {
+        if (ft < HT_PRESENT)
+          return (ft == FT_PASSWORDLEN ? pwentry : ci).Matches(row.fnum1, row.fnum2, ft, iFunction);
+        int iValue(0);
+        switch (ft) {
+          case HT_NUM:       iValue = int(history.size()); break;
+          case HT_MAX:       iValue = int(historyMax); break;
+          case PT_LENGTH:    iValue = int(pwp.length); break;
+          case PT_LOWERCASE: iValue = (pwp.flags & PWPolicy::UseLowercase) ? 1 : 0; break;
+          case PT_UPPERCASE: iValue = (pwp.flags & PWPolicy::UseUppercase) ? 1 : 0; break;
+          case PT_DIGITS:    iValue = (pwp.flags & PWPolicy::UseDigits) ? 1 : 0; break;
+          case PT_SYMBOLS:   iValue = (pwp.flags & PWPolicy::UseSymbols) ? 1 : 0; break;
+        }
+        if (iFunction == PWSMatch::MR_PRESENT || iFunction == PWSMatch::MR_NOTPRESENT)
+          return PWSMatch::Match(iValue != 0, iFunction);
+        // Policy values of entries without a policy don't match
+        if (ft >= PT_PRESENT && pwp.flags == 0)
+          return false;
+        return PWSMatch::Match(row.fnum1, row.fnum2, iValue, iFunction);
+      }
+      case PWSMatch::MT_ENTRYSIZE:
+        return ci.Matches(row.fnum1 << (10 * row.funit), row.fnum2 << (10 * row.funit),
+                          ft, iFunction);
+      case PWSMatch::MT_DATE:
+      {
+        time_t t1(row.fdate1), t2(row.fdate2);
+        if (row.fdatetype == 1 /* Relative */) {
+          const time_t today = PWSLocalTime::StartOfDay(m_now);
+          t1 = PWSLocalTime::StartOfDay(today, row.fnum1);
+          t2 = PWSLocalTime::StartOfDay(today, row.fnum2);
+        }
+        if (ft != HT_CHANGEDATE)
+          return ci.Matches(t1, t2, ft, iFunction);
+        // Any of the history's dates, or, for "present", whether any is set
+        bool bAnySet(false);
+        for (size_t i = 0; i < history.size(); i++) {
+          const time_t t = history[i].changetime;
+          if (t == 0)
+            continue;
+          bAnySet = true;
+          if (iFunction != PWSMatch::MR_PRESENT && iFunction != PWSMatch::MR_NOTPRESENT &&
+              PWSMatch::Match(t1, t2, PWSLocalTime::StartOfDay(t), iFunction))
+            return true;
+        }
+        if (iFunction == PWSMatch::MR_PRESENT || iFunction == PWSMatch::MR_NOTPRESENT)
+          return PWSMatch::Match(bAnySet, iFunction);
+        return false;
+      }
+      case PWSMatch::MT_BOOL:
+      {
+        bool bValue(false);
+        switch (ft) {
+          case FT_PROTECTED:     bValue = ci.IsProtected(); break;
+          case FT_KBSHORTCUT:
+          {
+            int32 iKBShortcut;
+            bValue = ci.GetKBShortcut(iKBShortcut) != 0;
+            break;
+          }
+          case FT_UNKNOWNFIELDS: bValue = ci.NumberUnknownFields() > 0; break;
+          case HT_PRESENT:       bValue = historyMax > 0 || !history.empty(); break;
+          case HT_ACTIVE:        bValue = bHistoryActive; break;
+          case PT_PRESENT:       bValue = pwp.flags != 0; break;
+          case PT_PRONOUNCEABLE: bValue = (pwp.flags & PWPolicy::MakePronounceable) != 0; break;
+          default:               bValue = false; // PT_EASYVISION, PT_HEXADECIMAL
+        }
+        return PWSMatch::Match(bValue, iFunction);
+      }
+      case PWSMatch::MT_ENTRYTYPE:
+        return ci.Matches(row.etype, iFunction);
+      case PWSMatch::MT_ENTRYSTATUS:
+        return ci.Matches(row.estatus, iFunction);
+      case PWSMatch::MT_DCA:
+      case PWSMatch::MT_SHIFTDCA:
+        return ci.Matches(int16(row.fdca), iFunction, row.mtype == PWSMatch::MT_SHIFTDCA);
+      case PWSMatch::MT_PWHIST:
+        return RowsPass(filters.vHfldata, filters, ci, pwentry);
+      case PWSMatch::MT_POLICY:
+        return RowsPass(filters.vPfldata, filters, ci, pwentry);
+      default:
+        return false;
+    }
+  }
+
+  const time_t m_now;
+  unsigned int m_seed;
+  std::vector<CItemData> m_entries;
+  vFilterRows m_mainRows, m_historyRows, m_policyRows;
+};
@@ -0,0 +1,134 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+
+#include "test.h"
+#include "core/FindText.h"
+#include "core/Match.h"
+
+#include <cstring>
+
+class FindTextTest : public Test
+{
+
+public:
+  FindTextTest()
+    {
+  }
+  void run()
+  {
+    // The tests to run:
+    testNoCase();
+    testFinder();
+    testUTF8();
+    testCompiledMatch();
+  }
+
+  void testNoCase()
+  {
+    const StringX text(_T("Hello World"));
+    _test(PWSMatch::EqualsNoCase(_T("hello"), text.c_str(), 5));
+    _test(!PWSMatch::EqualsNoCase(_T("hellp"), text.c_str(), 5));
+    _test(PWSMatch::FindNoCase(text.c_str(), text.length(), _T("WORLD"), 5) == 6);
+    _test(PWSMatch::FindNoCase(text.c_str(), text.length(), _T("worlds"), 6) == StringX::npos);
+    _test(PWSMatch::FindNoCase(text.c_str(), text.length(), _T(""), 0) == 0);
+  }
+
+  void testFinder()
+  {
+    // Long enough to go through the vectorized loop, with the match
+    // at various offsets from a 4 character boundary
+    const StringX prefix(_T("abcdefghijklmnopqrstuvwxyz0123456789"));
+    for (size_t offset = 0; offset < 8; offset++) {
+      const StringX text = prefix.substr(0, 20 + offset) + _T("NeedleX") + prefix;
+      const PWSMatch::CFinder nocase(_T("needlex"), false);
+      _test(nocase.Find(text) == 20 + offset);
+      const PWSMatch::CFinder withcase(_T("NeedleX"), true);
+      _test(withcase.Find(text) == 20 + offset);
+      const PWSMatch::CFinder wrongcase(_T("needlex"), true);
+      _test(wrongcase.Find(text) == StringX::npos);
+    }
+
+    // Match at the very end, and text shorter than the search
+    const StringX text(_T("0123456789abcdefXY"));
+    _test(PWSMatch::CFinder(_T("xy"), false).Find(text) == 16);
+    _test(PWSMatch::CFinder(_T("y"), false).Find(text) == 17);
+    _test(PWSMatch::CFinder(_T("XYZ"), true).Find(text) == StringX::npos);
+    _test(PWSMatch::CFinder(_T("abc"), false).Find(_T("ab")) == StringX::npos);
+    _test(PWSMatch::CFinder(_T(""), false).Find(text) == 0);
+
+    // Non-ASCII: a folded first character, and a non-ASCII character
+    // folding to an ASCII one (KELVIN SIGN -> 'k'). Folding these depends
+    // on the locale, so only check if it does.
+    if (_totlower(0x212a) != _T('k'))
+      return;
+    const StringX sxGreek(_T("0123456789 \x039a\x0391\x039b\x0397 0123456789"));
+    _test(PWSMatch::CFinder(_T("\x03ba\x03b1\x03bb\x03b7"), false).Find(sxGreek) == 11);
+    const StringX sxKelvin(_T("0123456789 \x212a" L"elvin 0123456789"));
+    _test(PWSMatch::CFinder(_T("kelvin"), false).Find(sxKelvin) == 11);
+    _test(PWSMatch::CFinder(_T("kelvin"), true).Find(sxKelvin) == StringX::npos);
+  }
+
+  void testUTF8()
+  {
+    const char *text = "0123456789abcdef Hello, \xc3\x96sterreich! 0123456789";
+    const unsigned char *utext = reinterpret_cast<const unsigned char *>(text);
+    const size_t len = strlen(text);
+
+    _test(PWSMatch::CFinder(_T("hello"), false).FindUTF8(utext, len) == 17);
+    _test(PWSMatch::CFinder(_T("Hello"), true).FindUTF8(utext, len) == 17);
+    _test(PWSMatch::CFinder(_T("hello"), true).FindUTF8(utext, len) == StringX::npos);
+    _test(PWSMatch::CFinder(_T("REICH!"), false).FindUTF8(utext, len) == 30);
+    _test(PWSMatch::CFinder(_T("Vienna"), false).FindUTF8(utext, len) == StringX::npos);
+    // Byte offset of a match starting with a non-ASCII character
+    _test(PWSMatch::CFinder(_T("\x00d6sterreich"), true).FindUTF8(utext, len) == 24);
+    if (_totlower(0x00d6) == 0x00f6)
+      _test(PWSMatch::CFinder(_T("\x00f6sterreich"), false).FindUTF8(utext, len) == 24);
+  }
+
+  void testCompiledMatch()
+  {
+    // Same results as Match(), for all string rules, either case
+    const PWSMatch::MatchRule rules[] = {
+      PWSMatch::MR_EQUALS, PWSMatch::MR_NOTEQUAL,
+      PWSMatch::MR_BEGINS, PWSMatch::MR_NOTBEGIN,
+      PWSMatch::MR_ENDS, PWSMatch::MR_NOTEND,
+      PWSMatch::MR_CONTAINS, PWSMatch::MR_NOTCONTAIN,
+      PWSMatch::MR_CNTNANY, PWSMatch::MR_NOTCNTNANY,
+      PWSMatch::MR_CNTNALL, PWSMatch::MR_NOTCNTNALL,
+    };
+    const TCHAR *values[] = {
+      _T(""), _T("bank"), _T("BANK"), _T("Online Bank"), _T("xyz"),
+      _T("kz"), _T("\x00d6!"), _T("online bank"),
+    };
+    const TCHAR *objects[] = {
+      _T(""), _T("bank"), _T("Online Bank"), _T("My bank account"),
+      _T("\x00d6sterreich!"), _T("Zork"), _T("online bank"),
+    };
+
+    int nwrong = 0;
+    for (size_t r = 0; r < sizeof(rules) / sizeof(rules[0]); r++) {
+      for (int sign = -1; sign <= 1; sign += 2) {
+        const int iFunction = sign * rules[r];
+        for (size_t v = 0; v < sizeof(values) / sizeof(values[0]); v++) {
+          const PWSMatch::CCompiledMatch match(values[v], iFunction);
+          for (size_t o = 0; o < sizeof(objects) / sizeof(objects[0]); o++) {
+            if (match.Matches(objects[o]) !=
+                PWSMatch::Match(values[v], objects[o], iFunction))
+              nwrong++;
+          }
+        }
+      }
+    }
+    _test(nwrong == 0);
+
+    _test(PWSMatch::CCompiledMatch(_T("bank"), PWSMatch::MR_PRESENT, false).Matches(_T("x")));
+    _test(!PWSMatch::CCompiledMatch(_T("bank"), PWSMatch::MR_PRESENT, false).Matches(_T("")));
+    // Default constructed: no restriction
+    _test(PWSMatch::CCompiledMatch().Matches(_T("")));
+  }
+};
@@ -0,0 +1,98 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+
+#include "test.h"
+#include "core/FuzzyMatch.h"
+
+#include <vector>
+
+using namespace PWSMatch;
+
+class FuzzyMatchTest : public Test
+{
+
+public:
+  FuzzyMatchTest()
+    {
+  }
+  void run()
+  {
+    // The tests to run:
+    testScore();
+    testTypos();
+    testSelectBest();
+  }
+
+  void testScore()
+  {
+    const CFuzzyMatcher bank(_T("bank"));
+    _test(bank.Score(_T("")) == 0);
+    _test(bank.Score(_T("Mail")) == 0);
+    _test(bank.Score(_T("knab")) == 0);
+
+    // Exact beats prefix beats word beats inside a word beats subsequence
+    const int exact = bank.Score(_T("Bank"));
+    const int prefix = bank.Score(_T("Banking"));
+    const int word = bank.Score(_T("My bank"));
+    const int inside = bank.Score(_T("Embankment"));
+    const int subseq = bank.Score(_T("Abandoned track"));
+    _test(exact > prefix);
+    _test(prefix > word);
+    _test(word > inside);
+    _test(inside > subseq);
+    _test(subseq > 0);
+
+    // The occurrence at the start of a word counts
+    _test(bank.Score(_T("embankment Bank")) == bank.Score(_T("xxxxxxxxxx Bank")));
+
+    // Initials
+    const CFuzzyMatcher initials(_T("gm"));
+    _test(initials.Score(_T("Google mail")) > initials.Score(_T("agxmx")));
+    _test(initials.Score(_T("GoogleMail")) > initials.Score(_T("Googlemail")));
+
+    _test(CFuzzyMatcher(_T("")).Score(_T("Bank")) == 0);
+  }
+
+  void testTypos()
+  {
+    // None for short queries, one for 4-7 characters, two from 8 on
+    _test(CFuzzyMatcher(_T("gxl")).Score(_T("Gmail")) == 0);
+    _test(CFuzzyMatcher(_T("gmial")).Score(_T("Gmail")) > 0);
+    _test(CFuzzyMatcher(_T("gmial")).Score(_T("Gmail")) <
+          CFuzzyMatcher(_T("gmail")).Score(_T("Gmail")));
+    _test(CFuzzyMatcher(_T("gmxxl")).Score(_T("Gmail")) == 0);
+    _test(CFuzzyMatcher(_T("accuont")).Score(_T("account")) > 0);
+    _test(CFuzzyMatcher(_T("acxoxnt")).Score(_T("account")) == 0);
+    _test(CFuzzyMatcher(_T("accuonnt")).Score(_T("account")) > 0);
+  }
+
+  void testSelectBest()
+  {
+    // Best first, ties in index order, zeros left out
+    const int scores[] = {5, 0, 9, 5, 1, 9, 0, 7};
+    const size_t n = sizeof(scores) / sizeof(scores[0]);
+    std::vector<size_t> best;
+    SelectBest(n, 4, [&scores](size_t i, int) {return scores[i];}, best);
+    const size_t expected[] = {2, 5, 7, 0};
+    _test(best == std::vector<size_t>(expected, expected + 4));
+
+    SelectBest(n, 100, [&scores](size_t i, int) {return scores[i];}, best);
+    _test(best.size() == 6);
+    SelectBest(n, 0, [&scores](size_t i, int) {return scores[i];}, best);
+    _test(best.empty());
+
+    // Across many chunks, whatever the threads do
+    const size_t nbig = 100000;
+    // (100 items score 999: 999, 1999, 2999...)
+    SelectBest(nbig, 50, [](size_t i, int) {return int(i % 1000);}, best);
+    bool bInOrder = best.size() == 50;
+    for (size_t i = 0; bInOrder && i < best.size(); i++)
+      bInOrder = best[i] == i * 1000 + 999;
+    _test(bInOrder);
+  }
+};
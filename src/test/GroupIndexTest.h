@@ -0,0 +1,154 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+
+#include "test.h"
+#include "core/GroupIndex.h"
+
+#include <algorithm>
+#include <vector>
+
+class GroupIndexTest : public Test
+{
+
+public:
+  GroupIndexTest()
+    {
+  }
+  void run()
+  {
+    // The tests to run:
+    testSplitPath();
+    testEntries();
+    testEmptyGroups();
+  }
+
+  // Whether an entry in sxGroup is in sxPath's subtree, as
+  // PWScore::DoRenameGroup() has always decided it
+  static bool IsUnder(const StringX &sxGroup, const StringX &sxPath)
+  {
+    const StringX sxPath2 = sxPath + _T(".");
+    const size_t len2 = sxPath2.length();
+    return sxGroup == sxPath ||
+      (sxGroup.length() > len2 && sxGroup.substr(0, len2) == sxPath2 &&
+       sxGroup[len2] != _T('.'));
+  }
+
+  void testSplitPath()
+  {
+    std::vector<StringX> vnames;
+    CGroupIndex::SplitPath(_T("a.b.c"), vnames);
+    _test(vnames.size() == 3 && vnames[0] == _T("a") && vnames[2] == _T("c"));
+    CGroupIndex::SplitPath(_T("a..b.c."), vnames);
+    _test(vnames.size() == 3 && vnames[0] == _T("a.") && vnames[1] == _T("b") &&
+          vnames[2] == _T("c."));
+    CGroupIndex::SplitPath(_T(".a"), vnames);
+    _test(vnames.size() == 2 && vnames[0].empty() && vnames[1] == _T("a"));
+    CGroupIndex::SplitPath(_T(""), vnames);
+    _test(vnames.size() == 1 && vnames[0].empty());
+  }
+
+  void testEntries()
+  {
+    static const TCHAR *groups[] = {
+      _T(""), _T("a"), _T("a.b"), _T("a.b.c"), _T("a.."), _T("a..b"),
+      _T("a.b.."), _T("ab"), _T("a.bc"), _T(".a"), _T("."), _T("b.a"),
+    };
+    const size_t ngroups = sizeof(groups) / sizeof(groups[0]);
+    CGroupIndex index;
+    std::vector<pws_os::CUUID> vuuids;
+    for (size_t i = 0; i < ngroups; i++) {
+      vuuids.push_back(pws_os::CUUID());
+      index.Add(groups[i], vuuids.back());
+    }
+    _test(index.GetNumEntries(_T("a.b")) == 2);
+
+    // Each group's subtree is what DoRenameGroup() used to find
+    bool bOK = true;
+    for (size_t i = 0; i < ngroups; i++) {
+      UUIDVector found;
+      index.GetEntries(groups[i], found);
+      std::sort(found.begin(), found.end());
+      UUIDVector expected;
+      for (size_t j = 0; j < ngroups; j++) {
+        if (IsUnder(groups[j], groups[i]))
+          expected.push_back(vuuids[j]);
+      }
+      std::sort(expected.begin(), expected.end());
+      bOK &= found == expected && index.GetNumEntries(groups[i]) == expected.size();
+
+      // The same entries by group, with their groups' paths
+      std::vector<CGroupIndex::GroupEntries> vgroups;
+      index.GetEntriesByGroup(groups[i], vgroups);
+      found.clear();
+      for (size_t ig = 0; ig < vgroups.size(); ig++) {
+        for (size_t j = 0; j < vgroups[ig].vuuids.size(); j++) {
+          const pws_os::CUUID &uuid = vgroups[ig].vuuids[j];
+          const size_t k = std::find(vuuids.begin(), vuuids.end(), uuid) - vuuids.begin();
+          bOK &= k < ngroups && vgroups[ig].sxGroup == groups[k];
+          found.push_back(uuid);
+        }
+      }
+      std::sort(found.begin(), found.end());
+      bOK &= found == expected;
+    }
+    _test(bOK);
+
+    index.Remove(_T("a.b.c"), vuuids[3]);
+    _test(index.GetNumEntries(_T("a")) == 4);
+    _test(index.GetNumEntries(_T("a.b.c")) == 0);
+    _test(index.GetNumEntries(_T("no.such")) == 0);
+    const size_t ngroupsbefore = index.GetNumGroups();
+    index.Remove(_T("a.b.."), vuuids[6]);
+    // Group "b.." of "a", nothing being left in it
+    _test(index.GetNumGroups() == ngroupsbefore - 1);
+    index.Clear();
+    _test(index.GetNumGroups() == 0 && index.GetNumEntries(_T("a")) == 0);
+  }
+
+  void testEmptyGroups()
+  {
+    CGroupIndex index;
+    const pws_os::CUUID uuid;
+    std::vector<StringX> vEmptyGroups;
+    index.Add(_T("x.y"), uuid);
+    _test(index.AddEmptyGroup(_T("x.e1")));
+    _test(!index.AddEmptyGroup(_T("x.e1")));
+    _test(index.AddEmptyGroup(_T("x.y.e2")));
+    _test(index.AddEmptyGroup(_T("z")));
+    _test(index.IsEmptyGroup(_T("x.e1")) && !index.IsEmptyGroup(_T("x")));
+    _test(index.GetNumEmptyGroups(_T("x")) == 2);
+    _test(index.GetNumEmptyGroups(_T("")) == 0);
+    _test(index.GetNumEntries(_T("x")) == 1);
+    index.GetEmptyGroups(_T("x"), vEmptyGroups);
+    std::sort(vEmptyGroups.begin(), vEmptyGroups.end());
+    _test(vEmptyGroups.size() == 2 && vEmptyGroups[0] == _T("x.e1") &&
+          vEmptyGroups[1] == _T("x.y.e2"));
+    index.GetEmptyGroups(_T("x.y"), vEmptyGroups);
+    _test(vEmptyGroups.size() == 1 && vEmptyGroups[0] == _T("x.y.e2"));
+    index.GetEmptyGroups(_T("x.e1"), vEmptyGroups);
+    _test(vEmptyGroups.size() == 1 && vEmptyGroups[0] == _T("x.e1"));
+
+    _test(index.RemoveEmptyGroup(_T("x.e1")));
+    _test(!index.RemoveEmptyGroup(_T("x.e1")));
+    _test(index.GetNumEmptyGroups(_T("x")) == 1);
+
+    vEmptyGroups.clear();
+    vEmptyGroups.push_back(_T("w"));
+    index.SetEmptyGroups(vEmptyGroups);
+    _test(index.IsEmptyGroup(_T("w")) && !index.IsEmptyGroup(_T("z")));
+    _test(!index.IsEmptyGroup(_T("x.y.e2")));
+    // x, x.y & w
+    _test(index.GetNumGroups() == 3);
+    index.Remove(_T("x.y"), uuid);
+    _test(index.GetNumGroups() == 1);
+
+    st_MemoryUsage usage;
+    index.GetMemoryUsage(usage);
+    _test(usage.bytes > 0);
+  }
+};
@@ -0,0 +1,73 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+
+#include "test.h"
+#include "core/ItemData.h"
+
+class ItemDataTest : public Test
+{
+
+public:
+  ItemDataTest()
+    {
+  }
+  void run()
+  {
+    // The tests to run:
+    testFingerprint();
+  }
+
+  void testFingerprint()
+  {
+    CItemData ci1, ci2;
+    ci1.CreateUUID();
+    ci1.SetTitle(_T("Bank"));
+    ci1.SetPassword(_T("secret"));
+    ci1.SetNotes(_T("Notes"));
+    ci2.CreateUUID();
+    ci2.SetTitle(_T("Bank"));
+    ci2.SetPassword(_T("secret"));
+    ci2.SetNotes(_T("Notes"));
+
+    CItemData::FieldBits bsFields;
+    bsFields.set(CItemData::TITLE);
+    bsFields.set(CItemData::PASSWORD);
+    bsFields.set(CItemData::NOTES);
+    bsFields.set(CItemData::URL);
+    _test(ci1.GetFingerprint(bsFields) == ci2.GetFingerprint(bsFields));
+    // Different UUIDs
+    CItemData::FieldBits bsUUID(bsFields);
+    bsUUID.set(CItemData::UUID);
+    _test(ci1.GetFingerprint(bsUUID) != ci2.GetFingerprint(bsUUID));
+
+    // Recomputed when a field is set or cleared
+    ci2.SetPassword(_T("Secret"));
+    _test(ci1.GetFingerprint(bsFields) != ci2.GetFingerprint(bsFields));
+    ci2.SetPassword(_T("secret"));
+    _test(ci1.GetFingerprint(bsFields) == ci2.GetFingerprint(bsFields));
+    ci2.SetURL(_T("https://example.com/"));
+    _test(ci1.GetFingerprint(bsFields) != ci2.GetFingerprint(bsFields));
+    ci2.ClearField(CItemData::URL);
+    _test(ci1.GetFingerprint(bsFields) == ci2.GetFingerprint(bsFields));
+
+    // Field boundaries count: not the same as "Ban" + "ksecret"
+    CItemData ci3(ci1);
+    ci3.SetTitle(_T("Ban"));
+    ci3.SetPassword(_T("ksecret"));
+    _test(ci1.GetFingerprint(bsFields) != ci3.GetFingerprint(bsFields));
+
+    // Set, then removed
+    CItemData::FieldBits bsProtected;
+    bsProtected.set(CItemData::PROTECTED);
+    const CItemData::Fingerprint fpUnprotected = ci1.GetFingerprint(bsProtected);
+    ci1.SetProtected(true);
+    _test(ci1.GetFingerprint(bsProtected) != fpUnprotected);
+    ci1.SetProtected(false);
+    _test(ci1.GetFingerprint(bsProtected) == fpUnprotected);
+  }
+};
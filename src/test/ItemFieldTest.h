@@ -52,5 +52,23 @@ public:
     i1.Get(v2, lenV2);
     _test(lenV2 == sizeof(v1));
     _test(memcmp(v1, v2, sizeof(v1)) == 0);
+
+    // Copies share data until one of them is Set()
+    CItemField i2(i1);
+    _test(i2.SharesDataWith(i1));
+    i2.Set(v2, 8);
+    _test(!i2.SharesDataWith(i1));
+    _test(i2.GetLength() == 8);
+    lenV2 = sizeof(v2);
+    i1.Get(v2, lenV2);
+    _test(lenV2 == sizeof(v1));
+    _test(memcmp(v1, v2, sizeof(v1)) == 0);
+    i2 = i1;
+    _test(i2.SharesDataWith(i1));
+    _test(i2.GetData() != NULL && memcmp(i2.GetData(), v1, sizeof(v1)) == 0);
+    i1.Empty();
+    _test(i1.IsEmpty());
+    _test(i1.GetData() == NULL);
+    _test(i2.GetLength() == sizeof(v1));
   }
 };
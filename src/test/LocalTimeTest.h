@@ -0,0 +1,140 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+
+#include "test.h"
+#include "core/LocalTime.h"
+#include "core/VerifyFormat.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+class LocalTimeTest : public Test
+{
+
+public:
+  LocalTimeTest()
+    {
+  }
+  void run()
+  {
+    // The tests to run, in zones with and without daylight saving time
+    const char *tz = std::getenv("TZ");
+    const std::string saved_tz(tz != NULL ? tz : "");
+    static const char *zones[] = {
+      "UTC0", "CET-1CEST,M3.5.0,M10.5.0/3", "EST5EDT,M3.2.0,M11.1.0",
+      "NZST-12NZDT,M9.5.0,M4.1.0/3", "<+0545>-5:45",
+    };
+    for (size_t i = 0; i < sizeof(zones) / sizeof(zones[0]); i++) {
+      SetZone(zones[i]);
+      testMakeTime();
+      testStartOfDay();
+    }
+    SetZone("CET-1CEST,M3.5.0,M10.5.0/3");
+    testVerify();
+    SetZone(tz != NULL ? saved_tz.c_str() : NULL);
+  }
+
+  static void SetZone(const char *tz)
+  {
+    if (tz != NULL)
+      ::setenv("TZ", tz, 1);
+    else
+      ::unsetenv("TZ");
+    tzset();
+    PWSLocalTime::ClearCache();
+  }
+
+  static time_t StdMakeTime(int yyyy, int mon, int dd, int hh, int min,
+                            int sec, int *dow = NULL)
+  {
+    struct tm xtm;
+    std::memset(&xtm, 0, sizeof(xtm));
+    xtm.tm_year = yyyy - 1900;
+    xtm.tm_mon = mon - 1;
+    xtm.tm_mday = dd;
+    xtm.tm_hour = hh;
+    xtm.tm_min = min;
+    xtm.tm_sec = sec;
+    xtm.tm_isdst = -1;
+    const time_t t = std::mktime(&xtm);
+    if (dow != NULL)
+      *dow = xtm.tm_wday + 1;
+    return t;
+  }
+
+  void testMakeTime()
+  {
+    // Every third day, at times including those around the changes to and
+    // from daylight saving time, as std::mktime() has it
+    static const int hours[] = {0, 1, 2, 3, 12, 23};
+    bool bOK = true;
+    for (int day = 1; day < 25000; day += 3) {
+      const int dd = day; // carried into the months and years
+      for (size_t i = 0; i < sizeof(hours) / sizeof(hours[0]); i++) {
+        int dow1, dow2;
+        const time_t t1 = PWSLocalTime::MakeTime(1970, 1, dd, hours[i], 30, 15, &dow1);
+        const time_t t2 = StdMakeTime(1970, 1, dd, hours[i], 30, 15, &dow2);
+        bOK &= t1 == t2 && dow1 == dow2;
+      }
+    }
+    _test(bOK);
+    _test(PWSLocalTime::GetCacheSize() > 0);
+    _test(PWSLocalTime::MakeTime(2015, 1, 32) == StdMakeTime(2015, 2, 1, 0, 0, 0));
+    _test(PWSLocalTime::MakeTime(2015, 3, 0, 24, 0, 0) == StdMakeTime(2015, 3, 1, 0, 0, 0));
+  }
+
+  void testStartOfDay()
+  {
+    bool bOK = true;
+    for (time_t t = 86400 * 3 + 1234; t < time_t(0x7f000000); t += 86400 * 5 + 3607) {
+      struct tm st;
+      if (localtime_r(&t, &st) == NULL)
+        continue;
+      bOK &= PWSLocalTime::StartOfDay(t) ==
+             StdMakeTime(st.tm_year + 1900, st.tm_mon + 1, st.tm_mday, 0, 0, 0);
+      bOK &= PWSLocalTime::StartOfDay(t, 40) ==
+             StdMakeTime(st.tm_year + 1900, st.tm_mon + 1, st.tm_mday + 40, 0, 0, 0);
+    }
+    _test(bOK);
+  }
+
+  void testVerify()
+  {
+    time_t t;
+    const time_t expected = StdMakeTime(2008, 10, 6, 21, 20, 56);
+    _test(VerifyImportDateTimeString(_T("2008/10/06 21:20:56"), t) && t == expected);
+    _test(VerifyImportDateTimeString(_T("2008/10/06T21:20:56"), t) && t == expected);
+    _test(!VerifyImportDateTimeString(_T("2008/10/06 21:20:5x"), t) && t == time_t(-1));
+    _test(!VerifyImportDateTimeString(_T("2008/02/30 21:20:56"), t));
+    _test(VerifyImportDateTimeString(_T("1970/01/01 12:00:00"), t) && t == 0);
+
+    _test(VerifyXMLDateTimeString(_T("2008-10-06T21:20:56"), t) && t == expected);
+    _test(VerifyXMLDateTimeString(_T("2008-10-06T21:20:56Z"), t) && t == expected);
+    _test(VerifyXMLDateTimeString(_T("2008-10-06T21:20:56+01:00"), t) &&
+          t == expected - 3600);
+    _test(VerifyXMLDateTimeString(_T("2008-10-06T21:20:56-01:00"), t) &&
+          t == expected + 3600);
+    // An out of range offset is ignored
+    _test(VerifyXMLDateTimeString(_T("2008-10-06T21:20:56+15:00"), t) && t == expected);
+    _test(!VerifyXMLDateTimeString(_T("2008-10-06T21:20:56+1:00"), t));
+    _test(!VerifyXMLDateTimeString(_T("2008-10-06 21:20:56"), t));
+    _test(!VerifyXMLDateTimeString(_T("2008-10-06T21:20:56X"), t));
+
+    _test(VerifyXMLDateString(_T("2008-10-06"), t) &&
+          t == StdMakeTime(2008, 10, 6, 0, 0, 0));
+    _test(!VerifyXMLDateString(_T("2008-13-06"), t));
+
+    _test(VerifyASCDateTimeString(_T("Mon Oct 06 21:20:56 2008"), t) && t == expected);
+    // Wrong day of the week
+    _test(!VerifyASCDateTimeString(_T("Tue Oct 06 21:20:56 2008"), t));
+    _test(!VerifyASCDateTimeString(_T("Mon Okt 06 21:20:56 2008"), t));
+    _test(!VerifyASCDateTimeString(_T("Mon Oct  6 21:20:56 2008"), t));
+  }
+};
@@ -0,0 +1,122 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+
+#include "test.h"
+#include "core/PWHistory.h"
+#include "core/ItemData.h"
+
+#include <algorithm>
+
+class PWHistoryTest : public Test
+{
+
+public:
+  PWHistoryTest()
+    {
+  }
+  void run()
+  {
+    // The tests to run:
+    testParse();
+    testErrors();
+    testEntry();
+  }
+
+  void testParse()
+  {
+    // Active, max 5, two passwords
+    const StringX sxHistory(_T("10502") _T("5000000a0003abc") _T("5000000b0004defg"));
+    size_t pwh_max, num_err;
+    PWHistPasswords pwhp;
+    _test(ParsePWHistory(sxHistory, pwh_max, num_err, pwhp));
+    _test(pwh_max == 5 && num_err == 0);
+    _test(pwhp.size() == 2);
+    _test(pwhp[0].changetime == 0x5000000a && pwhp[0].password == _T("abc"));
+    _test(pwhp[1].changetime == 0x5000000b && pwhp[1].password == _T("defg"));
+
+    PWHistList pwhl;
+    _test(CreatePWHistoryList(sxHistory, pwh_max, num_err, pwhl, PWSUtil::TMC_XML));
+    _test(pwhl.size() == 2);
+    _test(pwhl[1].changetttdate == 0x5000000b && pwhl[1].password == _T("defg"));
+    _test(pwhl[1].changedate == FormatPWHistoryTime(0x5000000b, PWSUtil::TMC_XML));
+    _test(!pwhl[1].changedate.empty());
+
+    // Inactive, nothing kept
+    _test(!ParsePWHistory(_T("00000"), pwh_max, num_err, pwhp));
+    _test(pwh_max == 0 && num_err == 0 && pwhp.empty());
+  }
+
+  void testErrors()
+  {
+    size_t pwh_max, num_err;
+    PWHistPasswords pwhp;
+    // Too short
+    _test(!ParsePWHistory(_T("105"), pwh_max, num_err, pwhp));
+    _test(num_err == 1);
+    // Bad maximum: as the stream parser, which needs a digit after "0x"
+    _test(!ParsePWHistory(_T("10x01") _T("5000000a0003abc"), pwh_max, num_err, pwhp));
+    _test(ParsePWHistory(_T("1 501") _T("5000000a0003abc"), pwh_max, num_err, pwhp));
+    _test(pwh_max == 5 && pwhp.size() == 1);
+    // Says two, has one
+    _test(ParsePWHistory(_T("10502") _T("5000000a0003abc"), pwh_max, num_err, pwhp));
+    _test(num_err != 0 && pwhp.size() == 1);
+    // Not a whole number of passwords
+    _test(!ParsePWHistory(_T("10502") _T("5000000a0003ab"), pwh_max, num_err, pwhp));
+    _test(num_err == 2 && pwhp.empty());
+    // A bad time is skipped
+    _test(ParsePWHistory(_T("10502") _T("zzzzzzzz0003abc") _T("5000000b0004defg"),
+                         pwh_max, num_err, pwhp));
+    _test(num_err != 0);
+  }
+
+  void testEntry()
+  {
+    CItemData ci;
+    ci.CreateUUID();
+    ci.SetPassword(_T("current"));
+    ci.SetPWHistory(_T("10502") _T("5000000a0003old") _T("5000000b0006Older!"));
+
+    size_t pwh_max, num_err;
+    _test(ci.GetPWHistoryStatus(pwh_max, num_err));
+    _test(pwh_max == 5 && num_err == 0);
+    const PWHistPasswords &history = ci.GetPWHistoryPasswords();
+    _test(history.size() == 2 && history[1].password == _T("Older!"));
+
+    // Formatted as asked for, from the same parse
+    PWHistList pwhl;
+    ci.GetPWHistoryList(pwh_max, num_err, pwhl, PWSUtil::TMC_EXPORT_IMPORT);
+    _test(pwhl.size() == 2 &&
+          pwhl[0].changedate == FormatPWHistoryTime(0x5000000a, PWSUtil::TMC_EXPORT_IMPORT));
+    ci.GetPWHistoryList(pwh_max, num_err, pwhl, PWSUtil::TMC_XML);
+    _test(pwhl[0].changedate == FormatPWHistoryTime(0x5000000a, PWSUtil::TMC_XML));
+
+    _test(ci.HasPassword(_T("current"), false));
+    _test(!ci.HasPassword(_T("old"), false));
+    _test(ci.HasPassword(_T("old"), true));
+    _test(!ci.HasPassword(_T("older!"), true));
+    _test(!ci.HasPassword(_T("ol"), true));
+
+    CItemData::FieldBits bsHistory;
+    bsHistory.set(CItemData::PWHIST);
+    _test(ci.ContainsText(_T("older"), false, bsHistory));
+    _test(!ci.ContainsText(_T("current"), false, bsHistory));
+
+    // Passwords, current or old, aren't given to the search index
+    std::vector<StringX> vtext;
+    ci.GetSearchableText(vtext);
+    _test(std::find(vtext.begin(), vtext.end(), _T("current")) == vtext.end() &&
+          std::find(vtext.begin(), vtext.end(), _T("old")) == vtext.end() &&
+          std::find(vtext.begin(), vtext.end(), _T("Older!")) == vtext.end());
+
+    // The cache follows the field
+    ci.SetPWHistory(_T("10501") _T("5000000c0003new"));
+    _test(ci.GetPWHistoryPasswords().size() == 1);
+    _test(ci.HasPassword(_T("new"), true));
+    _test(!ci.HasPassword(_T("old"), true));
+  }
+};
@@ -0,0 +1,86 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+
+#include "test.h"
+#include "core/ParallelScan.h"
+
+#include <vector>
+
+class ParallelScanTest : public Test
+{
+
+public:
+  ParallelScanTest()
+    {
+  }
+  void run()
+  {
+    // The tests to run:
+    testOrder();
+    testStop();
+    testCancel();
+  }
+
+  void testOrder()
+  {
+    // Whatever the number of threads, merging the chunks' results in
+    // order gives what a sequential loop would
+    const size_t n = 100000;
+    for (unsigned int nThreads = 1; nThreads <= 8; nThreads *= 2) {
+      const CParallelScan scan(nThreads);
+      std::vector<std::vector<size_t> > results;
+      _test(scan.Scan(n, results, [](size_t i, std::vector<size_t> &acc) {
+        if (i % 7 == 3)
+          acc.push_back(i);
+        return true;
+      }));
+      _test(results.size() == scan.GetNumChunks(n));
+
+      std::vector<size_t> merged;
+      for (size_t ichunk = 0; ichunk < results.size(); ichunk++)
+        merged.insert(merged.end(), results[ichunk].begin(), results[ichunk].end());
+      bool bInOrder = merged.size() == (n + 3) / 7;
+      for (size_t i = 0; bInOrder && i < merged.size(); i++)
+        bInOrder = merged[i] == 7 * i + 3;
+      _test(bInOrder);
+    }
+
+    // Nothing to do, and too little to share
+    std::vector<int> results;
+    _test(CParallelScan(4).Scan(0, results, [](size_t, int &) {return true;}));
+    _test(results.empty());
+    _test(CParallelScan(4).GetNumChunks(10) == 1);
+  }
+
+  void testStop()
+  {
+    const CParallelScan scan(4);
+    std::vector<int> results;
+    _test(!scan.Scan(100000, results, [](size_t i, int &) {return i != 5000;}));
+  }
+
+  void testCancel()
+  {
+    const CParallelScan scan(4);
+    bool bCancel(true);
+    std::vector<int> results;
+    _test(!scan.Scan(100000, results, [](size_t, int &acc) {acc++; return true;},
+                     &bCancel));
+    int nvisited = 0;
+    for (size_t i = 0; i < results.size(); i++)
+      nvisited += results[i];
+    _test(nvisited == 0);
+
+    // Cancelled from the progress function, which is called by the calling
+    // thread after each chunk it scans (on its own, so it scans them all)
+    bCancel = false;
+    _test(!CParallelScan(1).Scan(100000, results, [](size_t, int &) {return true;},
+                     &bCancel, [&bCancel](size_t) {bCancel = true;}));
+    _test(bCancel);
+  }
+};
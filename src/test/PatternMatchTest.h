@@ -0,0 +1,179 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+
+#include "test.h"
+#include "core/PatternMatch.h"
+#include "core/Match.h"
+
+#include <cstring>
+
+using namespace PWSMatch;
+
+class PatternMatchTest : public Test
+{
+
+public:
+  PatternMatchTest()
+    {
+  }
+  void run()
+  {
+    // The tests to run:
+    testRegex();
+    testGlob();
+    testErrors();
+    testNFA();
+    testCache();
+    testRules();
+  }
+
+  bool Regex(const TCHAR *pattern, const TCHAR *text, bool bCase = true)
+  {
+    return CPattern(pattern, CPattern::REGEX, bCase).Matches(text);
+  }
+
+  bool Glob(const TCHAR *pattern, const TCHAR *text, bool bCase = true)
+  {
+    return CPattern(pattern, CPattern::GLOB, bCase).Matches(text);
+  }
+
+  void testRegex()
+  {
+    // Found anywhere, unless anchored
+    _test(Regex(_T("bank"), _T("My bank account")));
+    _test(!Regex(_T("^bank"), _T("My bank account")));
+    _test(Regex(_T("^My"), _T("My bank account")));
+    _test(Regex(_T("account$"), _T("My bank account")));
+    _test(!Regex(_T("^bank$"), _T("bank2")));
+    _test(Regex(_T(""), _T("")));
+    _test(Regex(_T("^$"), _T("")));
+    _test(!Regex(_T("^$"), _T("x")));
+
+    _test(Regex(_T("^[a-z]+\\d{2,4}$"), _T("user123")));
+    _test(!Regex(_T("^[a-z]+\\d{2,4}$"), _T("user12345")));
+    _test(Regex(_T("^(?:www\\.)?example\\.(com|org)$"), _T("example.org")));
+    _test(!Regex(_T("^(?:www\\.)?example\\.(com|org)$"), _T("wwwxexample.org")));
+    _test(Regex(_T("a.c"), _T("abc")));
+    _test(!Regex(_T("a.c"), _T("a\nc")));
+    _test(Regex(_T("[^0-9]"), _T("12a")));
+    _test(!Regex(_T("[^0-9]"), _T("123")));
+    _test(Regex(_T("[[:upper:]][[:punct:]]"), _T("xY!")));
+    _test(Regex(_T("\\x41\\x{263a}"), _T("A\x263a")));
+    _test(Regex(_T("colou?r"), _T("color")));
+    _test(Regex(_T("(ab)+?c"), _T("xababc")));
+    _test(Regex(_T("x{2"), _T("x{2"))); // not a repeat
+
+    // Case
+    _test(!Regex(_T("BANK"), _T("bank")));
+    _test(Regex(_T("BANK"), _T("bank"), false));
+    _test(Regex(_T("(?i)BANK"), _T("bank")));
+    _test(Regex(_T("[A-C]x"), _T("bX"), false));
+    _test(!Regex(_T("[^a]"), _T("A"), false));
+    // Only if the locale knows it, as for CFinder
+    if (_totlower(0x00c9) == 0x00e9)
+      _test(Regex(_T("\x00c9T\x00c9"), _T("\x00e9t\x00e9"), false));
+  }
+
+  void testGlob()
+  {
+    // The whole text
+    _test(Glob(_T("*.example.com"), _T("www.example.com")));
+    _test(!Glob(_T("*.example.com"), _T("www.example.com.au")));
+    _test(!Glob(_T("*.example.com"), _T("www.EXAMPLE.com")));
+    _test(Glob(_T("*.example.com"), _T("www.EXAMPLE.com"), false));
+    _test(Glob(_T("user??"), _T("user01")));
+    _test(!Glob(_T("user??"), _T("user1")));
+    _test(Glob(_T("[a-c]*[!0-9]"), _T("bank x")));
+    _test(!Glob(_T("[a-c]*[!0-9]"), _T("bank 9")));
+    _test(Glob(_T("a\\*b"), _T("a*b")));
+    _test(!Glob(_T("a\\*b"), _T("axb")));
+    _test(Glob(_T("*"), _T("")));
+    _test(Glob(_T(""), _T("")));
+    _test(!Glob(_T(""), _T("x")));
+    _test(Glob(_T("a.(b)+"), _T("a.(b)+"))); // no regex operators
+  }
+
+  void testErrors()
+  {
+    const TCHAR *bad[] = {
+      _T("a**"), _T("(ab"), _T("ab)"), _T("[ab"), _T("*a"), _T("\\1"),
+      _T("\\b"), _T("x{3,2}"), _T("x{1001}"), _T("(?P<n>x)"), _T("[z-a]"),
+      _T("(a{1000}){1000}"),
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+      const CPattern pattern(bad[i], CPattern::REGEX, true);
+      _test(!pattern.IsValid());
+      _test(!pattern.Matches(bad[i]));
+    }
+    _test(CPattern(_T("(ab"), CPattern::REGEX, true).GetErrorPos() == 3);
+    _test(!CPattern(_T("[ab"), CPattern::GLOB, true).IsValid());
+    _test(!CPattern(_T("ab\\"), CPattern::GLOB, true).IsValid());
+  }
+
+  void testNFA()
+  {
+    // Far too many DFA states: matched with the NFA, all the same
+    const CPattern pattern(_T("[ab]*a[ab]{15}$"), CPattern::REGEX, true);
+    _test(pattern.IsValid());
+    _test(!pattern.HasDFA());
+    _test(pattern.Matches(_T("bbbabbbbbbbbbbbbbbb")));
+    _test(!pattern.Matches(_T("bbbabbbbbbbbbbbbbbbb")));
+    _test(CPattern(_T("[ab]*a[ab]{3}$"), CPattern::REGEX, true).HasDFA());
+  }
+
+  void testCache()
+  {
+    CPattern::ClearCache();
+    const std::shared_ptr<const CPattern> p1 = CPattern::Get(_T("^a+$"), CPattern::REGEX, true);
+    const std::shared_ptr<const CPattern> p2 = CPattern::Get(_T("^a+$"), CPattern::REGEX, true);
+    _test(p1 == p2);
+    _test(p1 != CPattern::Get(_T("^a+$"), CPattern::REGEX, false));
+    _test(p1 != CPattern::Get(_T("^a+$"), CPattern::GLOB, true));
+    _test(CPattern::GetCacheSize() == 3);
+
+    // Least recently used go first
+    for (size_t i = 1; i <= 100; i++)
+      CPattern::Get(StringX(i, _T('x')), CPattern::GLOB, true);
+    _test(CPattern::GetCacheSize() < 100);
+    _test(p1 != CPattern::Get(_T("^a+$"), CPattern::REGEX, true));
+    _test(p1->Matches(_T("aaa"))); // still usable
+  }
+
+  void testRules()
+  {
+    // Match(), CCompiledMatch and the mnemonics
+    const StringX sxValue(_T("^ba.k$")), sxObject(_T("BANK"));
+    _test(!Match(sxValue, sxObject, -MR_REGEX));
+    _test(Match(sxValue, sxObject, MR_REGEX));
+    _test(!Match(sxValue, sxObject, MR_NOTREGEX));
+    _test(Match(StringX(_T("b?n*")), sxObject, MR_GLOB));
+    _test(Match(StringX(_T("b?n*")), sxObject, -MR_NOTGLOB));
+
+    _test(CCompiledMatch(sxValue, MR_REGEX).Matches(sxObject));
+    _test(!CCompiledMatch(sxValue, -MR_REGEX).Matches(sxObject));
+    _test(CCompiledMatch(sxValue, MR_NOTREGEX, true).Matches(sxObject));
+    _test(!CCompiledMatch(StringX(_T("b?n*")), MR_NOTGLOB, false).Matches(sxObject));
+
+    // A bad pattern matches nothing, negated or not
+    _test(!Match(StringX(_T("(")), sxObject, MR_REGEX));
+    _test(!Match(StringX(_T("(")), sxObject, MR_NOTREGEX));
+    _test(!CCompiledMatch(StringX(_T("(")), MR_NOTREGEX, false).IsValid());
+    _test(!CCompiledMatch(StringX(_T("(")), MR_NOTREGEX, false).Matches(sxObject));
+    _test(CCompiledMatch(sxValue, MR_CONTAINS, false).IsValid());
+
+    const MatchRule rules[] = {MR_REGEX, MR_NOTREGEX, MR_GLOB, MR_NOTGLOB};
+    for (size_t i = 0; i < sizeof(rules) / sizeof(rules[0]); i++)
+      _test(GetRule(std2stringx(GetRuleStringT(rules[i]))) == rules[i]);
+  }
+
+  static stringT GetRuleStringT(MatchRule rule)
+  {
+    const char *psz = GetRuleString(rule);
+    return stringT(psz, psz + strlen(psz));
+  }
+};
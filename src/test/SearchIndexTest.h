@@ -0,0 +1,95 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+
+#include "test.h"
+#include "core/SearchIndex.h"
+
+#include <algorithm>
+
+class SearchIndexTest : public Test
+{
+
+public:
+  SearchIndexTest()
+    {
+  }
+  void run()
+  {
+    // The tests to run:
+    testMe();
+  }
+
+  void testMe()
+  {
+    const pws_os::CUUID u1, u2, u3;
+    std::vector<StringX> v1, v2, v3;
+    v1.push_back(_T("Mail")); v1.push_back(_T("GMail account"));
+    v1.push_back(_T("alice@example.com"));
+    v2.push_back(_T("Bank")); v2.push_back(_T("Online banking"));
+    v3.push_back(_T("ab")); // too short to be indexed
+
+    CSearchIndex index;
+    index.Add(u1, v1);
+    index.Add(u2, v2);
+    index.Add(u3, v3);
+    _test(index.GetNumEntries() == 3);
+
+    UUIDVector candidates;
+    // Case is ignored
+    _test(index.GetCandidates(_T("gmail"), candidates));
+    _test(candidates.size() == 1 && candidates[0] == u1);
+    _test(index.GetCandidates(_T("BANK"), candidates));
+    _test(candidates.size() == 1 && candidates[0] == u2);
+    // No trigram spans two strings
+    _test(index.GetCandidates(_T("ilgm"), candidates));
+    _test(candidates.empty());
+    _test(index.GetCandidates(_T("ccount"), candidates));
+    _test(candidates.size() == 1 && candidates[0] == u1);
+    // Candidates are a superset of the matches: "abcd" isn't in
+    // "abcXbcd", but both its trigrams are
+    const pws_os::CUUID u4;
+    std::vector<StringX> v4(1, _T("abcXbcd"));
+    index.Add(u4, v4);
+    _test(index.GetCandidates(_T("abcd"), candidates));
+    _test(candidates.size() == 1 && candidates[0] == u4);
+    index.Remove(u4);
+    _test(index.GetCandidates(_T("xyz"), candidates));
+    _test(candidates.empty());
+    // Too short to narrow down the search
+    _test(!index.GetCandidates(_T("ab"), candidates));
+
+    // Replacing and removing entries
+    v2.push_back(_T("mail@bank.example.com"));
+    index.Add(u2, v2);
+    _test(index.GetNumEntries() == 3);
+    _test(index.GetCandidates(_T("example"), candidates));
+    _test(candidates.size() == 2 &&
+          std::find(candidates.begin(), candidates.end(), u1) != candidates.end() &&
+          std::find(candidates.begin(), candidates.end(), u2) != candidates.end());
+    index.Remove(u1);
+    _test(!index.IsIndexed(u1));
+    _test(index.GetCandidates(_T("example"), candidates));
+    _test(candidates.size() == 1 && candidates[0] == u2);
+    _test(index.GetCandidates(_T("gmail"), candidates));
+    _test(candidates.empty());
+
+    // Freed slots are reused
+    index.Add(u1, v1);
+    _test(index.GetCandidates(_T("gmail"), candidates));
+    _test(candidates.size() == 1 && candidates[0] == u1);
+
+    st_MemoryUsage usage;
+    index.GetMemoryUsage(usage);
+    _test(usage.bytes > 0);
+
+    index.Clear();
+    _test(index.GetNumEntries() == 0);
+    _test(index.GetCandidates(_T("gmail"), candidates));
+    _test(candidates.empty());
+  }
+};
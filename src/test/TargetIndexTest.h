@@ -0,0 +1,107 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+
+#include "test.h"
+#include "core/TargetIndex.h"
+
+class TargetIndexTest : public Test
+{
+
+public:
+  TargetIndexTest()
+    {
+  }
+  void run()
+  {
+    // The tests to run:
+    testHost();
+    testWords();
+    testFind();
+  }
+
+  void testHost()
+  {
+    _test(CTargetIndex::GetHost(_T("https://www.Example.com/login?x=1")) == _T("example.com"));
+    _test(CTargetIndex::GetHost(_T("[alt]https://user:pw@Mail.example.com:8443/")) ==
+          _T("mail.example.com"));
+    _test(CTargetIndex::GetHost(_T("{ssh}example.org")) == _T("example.org"));
+    _test(CTargetIndex::GetHost(_T("example.co.uk./path")) == _T("example.co.uk"));
+    _test(CTargetIndex::GetHost(_T("http://intranet/wiki")) == _T("intranet"));
+    _test(CTargetIndex::GetHost(_T("http://[::1]:8080/")) == _T("[::1]"));
+    _test(CTargetIndex::GetHost(_T("www.com")) == _T("www.com"));
+    // Not hosts
+    _test(CTargetIndex::GetHost(_T("Inbox - Gmail")).empty());
+    _test(CTargetIndex::GetHost(_T("intranet")).empty());
+    _test(CTargetIndex::GetHost(_T("")).empty());
+    _test(CTargetIndex::GetHost(_T("http://a*b.com/")).empty());
+
+    _test(CTargetIndex::GetDomain(_T("mail.example.com")) == _T("example.com"));
+    _test(CTargetIndex::GetDomain(_T("a.b.example.co.uk")) == _T("example.co.uk"));
+    _test(CTargetIndex::GetDomain(_T("co.uk")) == _T("co.uk"));
+    _test(CTargetIndex::GetDomain(_T("www.example.de")) == _T("example.de"));
+    _test(CTargetIndex::GetDomain(_T("192.168.1.1")) == _T("192.168.1.1"));
+    _test(CTargetIndex::GetDomain(_T("intranet")) == _T("intranet"));
+  }
+
+  void testWords()
+  {
+    std::vector<StringX> vwords;
+    CTargetIndex::GetWords(_T("Inbox (3) - GMAIL \x2014 Mozilla Firefox - gmail"), vwords);
+    _test(vwords.size() == 4);
+    _test(vwords[0] == _T("firefox") && vwords[1] == _T("gmail") &&
+          vwords[2] == _T("inbox") && vwords[3] == _T("mozilla"));
+    CTargetIndex::GetWords(_T("\x00d6sterreich\x00a0") _T("Bank"), vwords);
+    _test(vwords.size() == 2 && vwords[0] == _T("bank"));
+  }
+
+  void testFind()
+  {
+    const pws_os::CUUID gmail, gmailwork, google, github, bank, bank2;
+    CTargetIndex index;
+    index.Add(gmail, _T("Gmail"), _T(""));
+    index.Add(gmailwork, _T("Gmail (work)"), _T(""));
+    index.Add(google, _T("Google account"), _T("https://accounts.google.com/"));
+    index.Add(github, _T("Personal"), _T("https://github.com/login"));
+    index.Add(bank, _T("Bank"), _T("https://www.mybank.co.uk/"));
+    index.Add(bank2, _T("Bank"), _T("https://login.mybank.co.uk/"));
+    _test(index.GetNumEntries() == 6);
+
+    UUIDVector matches;
+    // By title: the whole of "Gmail" beats half of "Gmail (work)"
+    index.FindBest(_T("Inbox - Gmail - Mozilla Firefox"), _T(""), 10, matches);
+    _test(matches.size() == 2 && matches[0] == gmail && matches[1] == gmailwork);
+
+    // Same host, then same domain
+    index.FindBest(_T(""), _T("https://login.mybank.co.uk/start"), 10, matches);
+    _test(matches.size() == 2 && matches[0] == bank2 && matches[1] == bank);
+    index.FindBest(_T("Sign in"), _T("https://mail.google.com/"), 10, matches);
+    _test(!matches.empty() && matches[0] == google);
+
+    // The domain is a word of both
+    index.FindBest(_T("GitHub - Mozilla Firefox"), _T(""), 10, matches);
+    _test(matches.size() == 1 && matches[0] == github);
+
+    index.FindBest(_T("Inbox - Gmail"), _T(""), 1, matches);
+    _test(matches.size() == 1 && matches[0] == gmail);
+    index.FindBest(_T("Nothing here"), _T("https://example.com/"), 10, matches);
+    _test(matches.empty());
+
+    // Replacing and removing entries
+    index.Add(gmail, _T("Mail"), _T("https://mail.google.com/"));
+    index.FindBest(_T("Inbox - Gmail"), _T(""), 10, matches);
+    _test(matches.size() == 1 && matches[0] == gmailwork);
+    index.FindBest(_T(""), _T("https://mail.google.com/"), 10, matches);
+    _test(matches.size() == 2 && matches[0] == gmail && matches[1] == google);
+    index.Remove(gmail);
+    _test(!index.IsIndexed(gmail));
+    index.FindBest(_T(""), _T("https://mail.google.com/"), 10, matches);
+    _test(matches.size() == 1 && matches[0] == google);
+    index.Clear();
+    _test(index.GetNumEntries() == 0);
+  }
+};
@@ -0,0 +1,110 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+
+#include "test.h"
+#include "core/TextImportFile.h"
+#include "os/file.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class TextImportFileTest : public Test
+{
+
+public:
+  TextImportFileTest()
+    {
+  }
+  void run()
+  {
+    // The tests to run:
+    testSplitLine();
+    testDecode();
+    testGetLine();
+  }
+
+  static std::string Field(const CTextImportFile::Field &field)
+  {
+    return std::string(field.p, field.len);
+  }
+
+  void testSplitLine()
+  {
+    std::vector<CTextImportFile::Field> fields;
+    const std::string s1("\ta\t\"b\"\t\t");
+    CTextImportFile::SplitLine(s1.data(), s1.length(), '\t', fields);
+    _test(fields.size() == 5);
+    if (fields.size() == 5) {
+      _test(Field(fields[0]).empty() && Field(fields[1]) == "a");
+      _test(Field(fields[2]) == "\"b\"" && fields[2].nquotes == 2);
+      _test(Field(fields[3]).empty() && Field(fields[4]).empty());
+    }
+
+    // Longer than 16 bytes, with fields and quotes spanning blocks
+    std::string s2;
+    for (int i = 0; i < 40; i++) {
+      s2 += "0123456789abcde";
+      s2 += (i % 3 == 0) ? '"' : ',';
+    }
+    CTextImportFile::SplitLine(s2.data(), s2.length(), ',', fields);
+    _test(fields.size() == 27);
+    size_t nquotes = 0, len = 0;
+    for (size_t i = 0; i < fields.size(); i++) {
+      nquotes += fields[i].nquotes;
+      len += fields[i].len;
+    }
+    _test(nquotes == 14);
+    _test(len + fields.size() - 1 == s2.length());
+    _test(Field(fields[0]) == "0123456789abcde\"0123456789abcde");
+    _test(fields[0].nquotes == 1);
+
+    CTextImportFile::SplitLine("", 0, ',', fields);
+    _test(fields.size() == 1 && fields[0].len == 0);
+  }
+
+  void testDecode()
+  {
+    CTextImportFile file;
+    stringT s;
+    StringX sx;
+    const char utf8[] = "\xc3\x96\xe2\x82\xac\xf0\x9f\x98\x80x";
+    // Not followed by a '\0'
+    _test(file.Decode(utf8, sizeof(utf8) - 2, s));
+    _test(s == _T("\x00d6\x20ac\U0001F600"));
+    _test(file.Decode("abc", 3, sx) && sx == _T("abc"));
+    _test(file.Decode("", 0, sx) && sx.empty());
+  }
+
+  void testGetLine()
+  {
+    const stringT filename(_T("TextImportFileTest.txt"));
+    std::FILE *fp = pws_os::FOpen(filename, _T("wb"));
+    _test(fp != NULL);
+    if (fp == NULL)
+      return;
+    std::fputs("one\r\ntwo\n\nlast", fp);
+    std::fclose(fp);
+
+    CTextImportFile file;
+    _test(file.Open(filename) == CTextImportFile::SUCCESS);
+    std::string line;
+    _test(file.GetLine(line) && line == "one");
+    const size_t pos = file.GetPosition();
+    _test(file.GetLine(line) && line == "two");
+    _test(file.GetLine(line) && line.empty());
+    _test(file.GetLine(line) && line == "last" && file.EndOfFile());
+    _test(!file.GetLine(line));
+    file.SetPosition(pos);
+    _test(!file.EndOfFile() && file.GetLine(line) && line == "two");
+    file.Close();
+    pws_os::DeleteAFile(filename);
+
+    _test(file.Open(_T("no such file.txt")) == CTextImportFile::CANT_OPEN);
+  }
+};
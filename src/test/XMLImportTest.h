@@ -0,0 +1,280 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+
+#include "test.h"
+#include "core/PWScore.h"
+#include "core/PWSprefs.h"
+#include "core/Report.h"
+#include "core/XML/XMLDefs.h"
+#if USE_XML_LIBRARY == PUGIXML
+#include "core/XML/Pugi/PSchemaType.h"
+#endif
+#include "os/file.h"
+#include "os/utf8conv.h"
+
+#include <fstream>
+#include <sstream>
+
+class XMLImportTest : public Test
+{
+
+public:
+  XMLImportTest()
+    {
+  }
+  void run()
+  {
+    // The tests to run:
+    testImport();
+    testFailedImport();
+    testSchema();
+#if USE_XML_LIBRARY == PUGIXML
+    testSchemaTypes();
+#endif
+  }
+
+  void testImport()
+  {
+    PWScore source, imported;
+    MakeSource(source);
+    const std::string xml = Export(source);
+    _test(!xml.empty());
+    WriteFile(xml);
+
+    CReport rpt;
+    Command *pcmd = NULL;
+    _test(Import(imported, false, rpt, pcmd) == PWScore::SUCCESS);
+    _test(pcmd != NULL);
+    if (pcmd != NULL)
+      imported.Execute(pcmd);
+    _test(imported.GetNumEntries() == 2);
+    const StringX sxReport = rpt.GetString();
+    _test(sxReport.find(_T("Bank")) != StringX::npos &&
+          sxReport.find(_T("Mail")) != StringX::npos);
+
+    // Only the passwords are imported, and the entries accessed
+    PWSprefs::GetInstance()->SetPref(PWSprefs::MaintainDateTimeStamps, true);
+    SetPassword(source, _T("Bank"), _T("old"));
+    CReport rptPasswords;
+    _test(Import(source, true, rptPasswords, pcmd) == PWScore::SUCCESS);
+    if (pcmd != NULL)
+      source.Execute(pcmd);
+    _test(GetPassword(source, _T("Bank")) == _T("secret"));
+    _test(GetATime(source, _T("Bank")) > OLD_ATIME);
+    PWSprefs::GetInstance()->SetPref(PWSprefs::MaintainDateTimeStamps, false);
+
+    pws_os::DeleteAFile(FILENAME);
+  }
+
+  void testFailedImport()
+  {
+    PWScore source, imported;
+    MakeSource(source);
+    std::string xml = Export(source);
+
+    // The valid entries are followed by one without a password
+    const std::string::size_type iend = xml.rfind("</");
+    _test(iend != std::string::npos);
+    if (iend == std::string::npos)
+      return;
+    xml.insert(iend, "<entry><title>Broken</title></entry>\n");
+    WriteFile(xml);
+
+    CReport rpt;
+    Command *pcmd = NULL;
+    _test(Import(imported, false, rpt, pcmd) == PWScore::XML_FAILED_VALIDATION);
+    _test(pcmd == NULL);
+    _test(imported.GetNumEntries() == 0);
+    _test(rpt.GetString().empty());
+
+    // Nor are the entries whose passwords were read touched
+    PWSprefs::GetInstance()->SetPref(PWSprefs::MaintainDateTimeStamps, true);
+    SetPassword(source, _T("Bank"), _T("old"));
+    CReport rptPasswords;
+    _test(Import(source, true, rptPasswords, pcmd) == PWScore::XML_FAILED_VALIDATION);
+    _test(pcmd == NULL);
+    _test(rptPasswords.GetString().empty());
+    _test(GetPassword(source, _T("Bank")) == _T("old"));
+    _test(GetATime(source, _T("Bank")) == OLD_ATIME &&
+          GetATime(source, _T("Mail")) == OLD_ATIME);
+    PWSprefs::GetInstance()->SetPref(PWSprefs::MaintainDateTimeStamps, false);
+
+    pws_os::DeleteAFile(FILENAME);
+  }
+
+  void testSchema()
+  {
+    // Whichever library checks the file, it must fail as the schema does
+    _test(ImportEntries("<entry><title>t</title><password>p</password></entry>") ==
+          PWScore::SUCCESS);
+    _test(ImportEntries("<entry><title>t</title><password>p</password>"
+                        "<uuid>0123456789abcdef0123456789abcdef</uuid>"
+                        "<dca>9</dca></entry>") == PWScore::SUCCESS);
+    _test(ImportEntries("<entry><title>t</title><password>p</password></entry>",
+                        "keepass") == PWScore::XML_FAILED_VALIDATION);
+    _test(ImportEntries("<entry><title>t</title><password>p</password></entry>",
+                        "lumimaja", "") == PWScore::XML_FAILED_VALIDATION);
+
+    // Facets
+    _test(ImportEntries("<entry><title>t</title><password>p</password>"
+                        "<dca>10</dca></entry>") == PWScore::XML_FAILED_VALIDATION);
+    _test(ImportEntries("<entry><title>t</title><password>p</password>"
+                        "<uuid>0123456789abcdef</uuid></entry>") ==
+          PWScore::XML_FAILED_VALIDATION);
+    _test(ImportEntries("<entry><title>t</title><password>p</password>"
+                        "<PasswordPolicy><PWLength>3</PWLength></PasswordPolicy>"
+                        "</entry>") == PWScore::XML_FAILED_VALIDATION);
+    _test(ImportEntries("<entry><title>t</title><password>p</password>"
+                        "<ctimex>yesterday</ctimex></entry>") ==
+          PWScore::XML_FAILED_VALIDATION);
+
+    // Missing or unexpected elements
+    _test(ImportEntries("<entry><password>p</password></entry>") ==
+          PWScore::XML_FAILED_VALIDATION);
+    _test(ImportEntries("<entry><title>t</title><password>p</password>"
+                        "<pwhistory><status>1</status><max>3</max></pwhistory>"
+                        "</entry>") == PWScore::XML_FAILED_VALIDATION);
+    _test(ImportEntries("<entry><title>t</title><password>p</password>"
+                        "<colour>red</colour></entry>") ==
+          PWScore::XML_FAILED_VALIDATION);
+    _test(ImportEntries("<entry><title>t</title><password>p</password></entry>"
+                        "<EmptyGroups><EGName>g</EGName></EmptyGroups>") ==
+          PWScore::XML_FAILED_VALIDATION);
+
+    pws_os::DeleteAFile(FILENAME);
+  }
+
+#if USE_XML_LIBRARY == PUGIXML
+  void testSchemaTypes()
+  {
+    const PSchemaType range(_T("int 4 1024")), any(_T("int"));
+    _test(range.IsValid(_T("4")) && range.IsValid(_T(" 1024 ")));
+    _test(!range.IsValid(_T("3")) && !range.IsValid(_T("1025")) &&
+          !range.IsValid(_T("")) && !range.IsValid(_T("12a")));
+    _test(any.IsValid(_T("-7")) && !any.IsValid(_T("1.5")));
+
+    const PSchemaType hex(_T("hexBinary 2"));
+    _test(hex.IsValid(_T("a0Ff")));
+    _test(!hex.IsValid(_T("a0f")) && !hex.IsValid(_T("a0fg")) && !hex.IsValid(_T("a0ff00")));
+
+    const PSchemaType values(_T("enum yes no")), nonblank(_T("nonblank"));
+    _test(values.IsValid(_T("yes")) && !values.IsValid(_T("Yes")));
+    _test(nonblank.IsValid(_T("x")) && !nonblank.IsValid(_T("")));
+
+    const PSchemaType boolean(_T("boolean")), character(_T("char"));
+    _test(boolean.IsValid(_T("true")) && boolean.IsValid(_T("0")) &&
+          !boolean.IsValid(_T("yes")));
+    _test(character.IsValid(_T("^")) && !character.IsValid(_T("^^")));
+
+    const PSchemaType datetime(_T("dateTime")), shortcut(_T("kbshortcut"));
+    _test(datetime.IsValid(_T("2015-01-31T12:00:00")) &&
+          !datetime.IsValid(_T("2015-02-31T12:00:00")));
+    _test(shortcut.IsValid(_T("CA:0041")) && !shortcut.IsValid(_T("X:0041")) &&
+          !shortcut.IsValid(_T("CA:41")));
+  }
+#endif
+
+private:
+  static const time_t OLD_ATIME = 1000000000;
+  const stringT FILENAME = _T("XMLImportTest.xml");
+
+  static void MakeSource(PWScore &core)
+  {
+    const TCHAR *titles[] = {_T("Bank"), _T("Mail")};
+    for (size_t i = 0; i < 2; i++) {
+      CItemData ci;
+      ci.CreateUUID();
+      ci.SetGroup(_T("Sites"));
+      ci.SetTitle(titles[i]);
+      ci.SetUser(_T("me"));
+      ci.SetPassword(_T("secret"));
+      ci.SetATime(OLD_ATIME);
+      core.Execute(AddEntryCommand::Create(&core, ci));
+    }
+  }
+
+  std::string Export(PWScore &core)
+  {
+    CItemData::FieldBits bsAll;
+    bsAll.set();
+    int numExported = 0;
+    CReport rpt;
+    if (core.WriteXMLFile(StringX(FILENAME.c_str()), bsAll, _T(""), 0, 0, _T('\xbb'),
+                          numExported, NULL, false, &rpt) != PWScore::SUCCESS)
+      return "";
+    std::ifstream is(pws_os::tomb(FILENAME).c_str());
+    std::ostringstream os;
+    os << is.rdbuf();
+    return os.str();
+  }
+
+  void WriteFile(const std::string &xml)
+  {
+    std::ofstream os(pws_os::tomb(FILENAME).c_str());
+    os << xml;
+  }
+
+  // Imports entries in a file with the given root and delimiter into an
+  // empty core
+  int ImportEntries(const std::string &entries, const std::string &root = "lumimaja",
+                    const std::string &delimiter = "^")
+  {
+    std::string xml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<" + root;
+    if (!delimiter.empty())
+      xml += " delimiter=\"" + delimiter + "\"";
+    WriteFile(xml + ">\n" + entries + "\n</" + root + ">\n");
+
+    PWScore core;
+    CReport rpt;
+    Command *pcmd = NULL;
+    const int rc = Import(core, false, rpt, pcmd);
+    delete pcmd;
+    return rc;
+  }
+
+  int Import(PWScore &core, bool bImportPSWDsOnly, CReport &rpt, Command *&pcmd)
+  {
+    stringT strXMLErrors, strSkippedList, strPWHErrorList, strRenameList;
+    int numValidated, numImported, numSkipped, numPWHErrors, numRenamed;
+    int numNoPolicy, numRenamedPolicies, numShortcutsRemoved;
+    return core.ImportXMLFile(_T(""), FILENAME, GetXSDFile(_T("lumimaja.xsd")),
+                              bImportPSWDsOnly, strXMLErrors, strSkippedList,
+                              strPWHErrorList, strRenameList, numValidated,
+                              numImported, numSkipped, numPWHErrors, numRenamed,
+                              numNoPolicy, numRenamedPolicies, numShortcutsRemoved,
+                              rpt, pcmd);
+  }
+
+  static ItemListIter Find(PWScore &core, const TCHAR *title)
+  {
+    return core.Find(_T("Sites"), title, _T("me"));
+  }
+
+  static void SetPassword(PWScore &core, const TCHAR *title, const TCHAR *password)
+  {
+    Find(core, title)->second.SetPassword(password);
+  }
+
+  static StringX GetPassword(PWScore &core, const TCHAR *title)
+  {
+    return Find(core, title)->second.GetPassword();
+  }
+
+  static time_t GetATime(PWScore &core, const TCHAR *title)
+  {
+    time_t t;
+    Find(core, title)->second.GetATime(t);
+    return t;
+  }
+
+  static stringT GetXSDFile(const stringT &name)
+  {
+    const stringT sibling = _T("../xml/") + name;
+    return pws_os::FileExists(sibling) ? sibling : _T("../../xml/") + name;
+  }
+};
@@ -0,0 +1,140 @@
+/*
+* Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+* All rights reserved. Use of the code is allowed under the
+* Artistic License 2.0 terms, as specified in the LICENSE file
+* distributed with this code, or available from
+* http://www.opensource.org/licenses/artistic-license-2.0.php
+*/
+
+#include "test.h"
+#include "core/XMLWriter.h"
+
+#include <cstdio>
+#include <string>
+
+class XMLWriterTest : public Test
+{
+
+public:
+  XMLWriterTest()
+    {
+  }
+  void run()
+  {
+    // The tests to run:
+    testFields();
+    testEscaped();
+    testLargeField();
+    testInMemory();
+  }
+
+  // What writer wrote to fp, once flushed
+  static std::string Contents(CXMLWriter &xw, std::FILE *fp)
+  {
+    std::string s;
+    if (!xw.Flush())
+      return s;
+    std::rewind(fp);
+    char buf[4096];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof(buf), fp)) > 0)
+      s.append(buf, n);
+    return s;
+  }
+
+  void testFields()
+  {
+    std::FILE *fp = std::tmpfile();
+    _test(fp != NULL);
+    if (fp == NULL)
+      return;
+    CXMLWriter xw(fp);
+    _test(xw.WriteField("\t", "title", _T("Bank")));
+    // "]]>" can't be in a CDATA section, however many times it appears
+    _test(xw.WriteField("\t", "notes", _T("a]]>b]]>c]]>d]]")));
+    // Non-ASCII, including beyond the BMP, as UTF-8
+    _test(xw.WriteField("\t", "user", _T("\x00d6\x20ac\U0001F600")));
+    // Characters XML doesn't allow, reported by (1-based) position
+    _test(!xw.WriteField("\t", "url", _T("x\x01y\x02")));
+    xw << "<n>" << 42L << "</n>\n";
+    const std::string s = Contents(xw, fp);
+    std::fclose(fp);
+
+    _test(s ==
+          "\t<title><![CDATA[Bank]]></title>\n"
+          "\t<notes><![CDATA[a]]]]><![CDATA[>b]]]]><![CDATA[>c]]]]><![CDATA[>d]]]]></notes>\n"
+          "\t<user><![CDATA[\xc3\x96\xe2\x82\xac\xf0\x9f\x98\x80]]></user>\n"
+          "\t<!-- Field '<url>' contains invalid XML character(s)\n"
+          "\t   at position(s): 2, 4\n"
+          "\t   and has been skipped -->\n"
+          "<n>42</n>\n");
+  }
+
+  void testEscaped()
+  {
+    std::FILE *fp = std::tmpfile();
+    _test(fp != NULL);
+    if (fp == NULL)
+      return;
+    CXMLWriter xw(fp);
+    xw << "a=\"";
+    xw.WriteEscaped(StringX(_T("<&>\"' \x00e9\x01")));
+    xw << "\"";
+    const std::string s = Contents(xw, fp);
+    std::fclose(fp);
+
+    _test(s == "a=\"&lt;&amp;&gt;&quot;&apos; \xc3\xa9\"");
+  }
+
+  void testLargeField()
+  {
+    // Longer than the buffer, mixing ASCII runs with other characters
+    std::FILE *fp = std::tmpfile();
+    _test(fp != NULL);
+    if (fp == NULL)
+      return;
+    StringX sx;
+    std::string expected("<notes><![CDATA[");
+    for (int i = 0; i < 100000; i++) {
+      sx += _T("0123456789abc\x00e9");
+      expected += "0123456789abc\xc3\xa9";
+    }
+    expected += "]]></notes>\n";
+    CXMLWriter xw(fp);
+    _test(xw.WriteField("", "notes", sx));
+    const std::string s = Contents(xw, fp);
+    std::fclose(fp);
+
+    _test(s == expected);
+  }
+
+  void testInMemory()
+  {
+    // Parts kept in memory, growing as needed, then written in order
+    std::FILE *fp = std::tmpfile();
+    _test(fp != NULL);
+    if (fp == NULL)
+      return;
+    CXMLWriter part1, part2;
+    std::string expected("<entries>\n");
+    bool bOK = true;
+    for (int i = 0; i < 10000; i++) {
+      bOK &= part1.WriteField("\t", "title", _T("Bank"));
+      expected += "\t<title><![CDATA[Bank]]></title>\n";
+    }
+    _test(bOK);
+    part2 << "\t<n>" << -7L << "</n>\n";
+    _test(part2.Flush()); // does nothing
+    CXMLWriter xw(fp);
+    xw << "<entries>\n";
+    xw.Write(part1);
+    xw.Write(part2);
+    part2.Clear();
+    xw.Write(part2); // nothing
+    expected += "\t<n>-7</n>\n";
+    const std::string s = Contents(xw, fp);
+    std::fclose(fp);
+
+    _test(s == expected);
+  }
+};
@@ -16,6 +16,21 @@ using namespace std;
 
 #define TEST_STRINGX
 #define TEST_ITEMFIELD
+#define TEST_SEARCHINDEX
+#define TEST_FINDTEXT
+#define TEST_PARALLELSCAN
+#define TEST_FUZZYMATCH
+#define TEST_PATTERNMATCH
+#define TEST_PWHISTORY
+#define TEST_TARGETINDEX
+#define TEST_ITEMDATA
+#define TEST_DELTA
+#define TEST_XMLWRITER
+#define TEST_TEXTIMPORTFILE
+#define TEST_LOCALTIME
+#define TEST_GROUPINDEX
+#define TEST_FILTER
+#define TEST_XMLIMPORT
 
 #ifdef TEST_STRINGX
 #include "StringXTest.h"
@@ -23,6 +38,51 @@ using namespace std;
 #ifdef TEST_ITEMFIELD
 #include "ItemFieldTest.h"
 #endif
+#ifdef TEST_SEARCHINDEX
+#include "SearchIndexTest.h"
+#endif
+#ifdef TEST_FINDTEXT
+#include "FindTextTest.h"
+#endif
+#ifdef TEST_PARALLELSCAN
+#include "ParallelScanTest.h"
+#endif
+#ifdef TEST_FUZZYMATCH
+#include "FuzzyMatchTest.h"
+#endif
+#ifdef TEST_PATTERNMATCH
+#include "PatternMatchTest.h"
+#endif
+#ifdef TEST_PWHISTORY
+#include "PWHistoryTest.h"
+#endif
+#ifdef TEST_TARGETINDEX
+#include "TargetIndexTest.h"
+#endif
+#ifdef TEST_ITEMDATA
+#include "ItemDataTest.h"
+#endif
+#ifdef TEST_DELTA
+#include "DeltaTest.h"
+#endif
+#ifdef TEST_XMLWRITER
+#include "XMLWriterTest.h"
+#endif
+#ifdef TEST_TEXTIMPORTFILE
+#include "TextImportFileTest.h"
+#endif
+#ifdef TEST_LOCALTIME
+#include "LocalTimeTest.h"
+#endif
+#ifdef TEST_GROUPINDEX
+#include "GroupIndexTest.h"
+#endif
+#ifdef TEST_FILTER
+#include "FilterTest.h"
+#endif
+#ifdef TEST_XMLIMPORT
+#include "XMLImportTest.h"
+#endif
 
 #include <iostream>
 using namespace std;
@@ -70,6 +130,96 @@ int main()
   t6.setStream(&cout);
   t6.run();
   t6.report();
+#endif
+#ifdef TEST_SEARCHINDEX
+  SearchIndexTest t7;
+  t7.setStream(&cout);
+  t7.run();
+  t7.report();
+#endif
+#ifdef TEST_FINDTEXT
+  FindTextTest t8;
+  t8.setStream(&cout);
+  t8.run();
+  t8.report();
+#endif
+#ifdef TEST_PARALLELSCAN
+  ParallelScanTest t9;
+  t9.setStream(&cout);
+  t9.run();
+  t9.report();
+#endif
+#ifdef TEST_FUZZYMATCH
+  FuzzyMatchTest t10;
+  t10.setStream(&cout);
+  t10.run();
+  t10.report();
+#endif
+#ifdef TEST_PATTERNMATCH
+  PatternMatchTest t11;
+  t11.setStream(&cout);
+  t11.run();
+  t11.report();
+#endif
+#ifdef TEST_PWHISTORY
+  PWHistoryTest t12;
+  t12.setStream(&cout);
+  t12.run();
+  t12.report();
+#endif
+#ifdef TEST_TARGETINDEX
+  TargetIndexTest t13;
+  t13.setStream(&cout);
+  t13.run();
+  t13.report();
+#endif
+#ifdef TEST_ITEMDATA
+  ItemDataTest t14;
+  t14.setStream(&cout);
+  t14.run();
+  t14.report();
+#endif
+#ifdef TEST_DELTA
+  DeltaTest t15;
+  t15.setStream(&cout);
+  t15.run();
+  t15.report();
+#endif
+#ifdef TEST_XMLWRITER
+  XMLWriterTest t16;
+  t16.setStream(&cout);
+  t16.run();
+  t16.report();
+#endif
+#ifdef TEST_TEXTIMPORTFILE
+  TextImportFileTest t17;
+  t17.setStream(&cout);
+  t17.run();
+  t17.report();
+#endif
+#ifdef TEST_LOCALTIME
+  LocalTimeTest t18;
+  t18.setStream(&cout);
+  t18.run();
+  t18.report();
+#endif
+#ifdef TEST_GROUPINDEX
+  GroupIndexTest t19;
+  t19.setStream(&cout);
+  t19.run();
+  t19.report();
+#endif
+#ifdef TEST_FILTER
+  FilterTest t20;
+  t20.setStream(&cout);
+  t20.run();
+  t20.report();
+#endif
+#ifdef TEST_XMLIMPORT
+  XMLImportTest t21;
+  t21.setStream(&cout);
+  t21.run();
+  t21.report();
 #endif
   return 0;
 }
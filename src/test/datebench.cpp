@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+ * All rights reserved. Use of the code is allowed under the
+ * Artistic License 2.0 terms, as specified in the LICENSE file
+ * distributed with this code, or available from
+ * http://www.opensource.org/licenses/artistic-license-2.0.php
+ */
+//-----------------------------------------------------------------------------
+/*
+ * Micro-benchmark of parsing imported date/times: the old way (a string
+ * stream, then std::mktime()) against VerifyFormat's parsers on top of
+ * PWSLocalTime's cache, for the text import and XML formats, and of the
+ * start of day computed for date filters. Checks both give the same times.
+ * Checksums may differ slightly, from times in the hour repeated when
+ * daylight saving time ends, as explained below.
+ *
+ * To build, from src -
+ *   g++ -O2 -std=c++17 -I. -Icore -o datebench test/datebench.cpp \
+ *     core/VerifyFormat.cpp core/LocalTime.cpp core/StringX.cpp core/Util.cpp \
+ *     core/UTF8Conv.cpp core/core_st.cpp core/miniutf.cpp \
+ *     os/linux/{UUID,debug,pws_time,dir,file,env,utf8conv,pws_str,mem}.cpp -luuid
+ *
+ * Usage: datebench, with TZ set to the timezone to try
+ */
+
+#include "core/LocalTime.h"
+#include "core/VerifyFormat.h"
+#include "core/StringXStream.h"
+#include "os/funcwrap.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+namespace {
+  const size_t NUM_STRINGS = 100000;
+  const int NUM_RUNS = 5;
+
+  time_t OldMakeTime(int yyyy, int mon, int dd, int hh = 0, int min = 0, int sec = 0)
+  {
+    struct tm xtm;
+    std::memset(&xtm, 0, sizeof(tm));
+    xtm.tm_year = yyyy - 1900;
+    xtm.tm_mon = mon - 1;
+    xtm.tm_mday = dd;
+    xtm.tm_hour = hh;
+    xtm.tm_min = min;
+    xtm.tm_sec = sec;
+    xtm.tm_isdst = -1;
+    return std::mktime(&xtm);
+  }
+
+  // What VerifyImportDateTimeString did, less the checks its input passes
+  bool OldImportDateTime(const stringT &time_str, time_t &t)
+  {
+    if (time_str.length() != 19)
+      return false;
+    istringstreamT is(time_str);
+    TCHAR dummy;
+    int yyyy, mon, dd, hh, min, ss;
+    is >> yyyy >> dummy >> mon >> dummy >> dd
+       >> hh >> dummy >> min >> dummy >> ss;
+    if (!verifyDTvalues(yyyy, mon, dd, hh, min, ss))
+      return false;
+    t = OldMakeTime(yyyy, mon, dd, hh, min, ss);
+    return true;
+  }
+
+  // Likewise VerifyXMLDateTimeString
+  bool OldXMLDateTime(const stringT &time_str, time_t &t)
+  {
+    const size_t len = time_str.length();
+    if (len != 19 && len != 25)
+      return false;
+    istringstreamT is(time_str);
+    TCHAR dummy;
+    int yyyy, mon, dd, hh, min, ss, tz_hh(0), tz_mm(0);
+    is >> yyyy >> dummy >> mon >> dummy >> dd >> dummy
+       >>  hh  >> dummy >> min >> dummy >> ss;
+    if (len == 25)
+      is >> tz_hh >> dummy >> tz_mm;
+    if (!verifyDTvalues(yyyy, mon, dd, hh, min, ss))
+      return false;
+    t = OldMakeTime(yyyy, mon, dd, hh, min, ss);
+    if (tz_hh != 0 || tz_mm != 0)
+      t -= (tz_hh * 60 + tz_mm) * 60;
+    return true;
+  }
+
+  time_t OldStartOfDay(time_t t)
+  {
+    struct tm st;
+    if (localtime_s(&st, &t) != 0)
+      return t;
+    st.tm_hour = st.tm_min = st.tm_sec = 0;
+    st.tm_isdst = -1;
+    return std::mktime(&st);
+  }
+
+  // Whether t1 and t2 are the same local time, i.e., the same time in the
+  // hour repeated when daylight saving time ends, which std::mktime()
+  // resolves either way depending on what it was last asked
+  bool SameLocalTime(time_t t1, time_t t2)
+  {
+    struct tm st1, st2;
+    return localtime_s(&st1, &t1) == 0 && localtime_s(&st2, &t2) == 0 &&
+           st1.tm_year == st2.tm_year && st1.tm_mon == st2.tm_mon &&
+           st1.tm_mday == st2.tm_mday && st1.tm_hour == st2.tm_hour &&
+           st1.tm_min == st2.tm_min && st1.tm_sec == st2.tm_sec;
+  }
+
+  // Deterministic times over 30 years, a few fields per entry being close
+  void MakeCorpus(std::vector<stringT> &imp, std::vector<stringT> &xml,
+                  std::vector<time_t> &times)
+  {
+    unsigned int seed = 12345;
+    TCHAR buf[32];
+    for (size_t i = 0; i < NUM_STRINGS; i++) {
+      seed = seed * 1103515245 + 12345;
+      const time_t base = time_t(631152000) + time_t(seed >> 2) % (30 * 365 * 86400LL);
+      const time_t t = base + time_t(i % 5) * 3600 * 24 * (i % 3);
+      times.push_back(t);
+      struct tm st;
+      localtime_s(&st, &t);
+      std::swprintf(buf, 32, L"%04d/%02d/%02d %02d:%02d:%02d",
+                    st.tm_year + 1900, st.tm_mon + 1, st.tm_mday,
+                    st.tm_hour, st.tm_min, st.tm_sec);
+      imp.push_back(buf);
+      std::swprintf(buf, 32, (i % 4 == 0) ? L"%04d-%02d-%02dT%02d:%02d:%02d+02:00" :
+                                            L"%04d-%02d-%02dT%02d:%02d:%02d",
+                    st.tm_year + 1900, st.tm_mon + 1, st.tm_mday,
+                    st.tm_hour, st.tm_min, st.tm_sec);
+      xml.push_back(buf);
+    }
+  }
+
+  template<typename F> void Time(const char *name, F f)
+  {
+    long long sum = 0;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int run = 0; run < NUM_RUNS; run++)
+      sum += f();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::printf("%-34s %8.0f ns each  (checksum %lld)\n", name,
+                elapsed.count() * 1e9 / (double(NUM_STRINGS) * NUM_RUNS), sum / NUM_RUNS);
+  }
+};
+
+int main()
+{
+  tzset();
+  std::vector<stringT> imp, xml;
+  std::vector<time_t> times;
+  MakeCorpus(imp, xml, times);
+
+  // Same answers first
+  size_t ndiffs = 0, nambiguous = 0;
+  for (size_t i = 0; i < NUM_STRINGS; i++) {
+    time_t t1 = 0, t2 = 0, t3 = 0, t4 = 0;
+    if (!OldImportDateTime(imp[i], t1) || !VerifyImportDateTimeString(imp[i], t2))
+      ndiffs++;
+    else if (t1 != t2)
+      (SameLocalTime(t1, t2) ? nambiguous : ndiffs)++;
+    if (!OldXMLDateTime(xml[i], t3) || !VerifyXMLDateTimeString(xml[i], t4))
+      ndiffs++;
+    else if (t3 != t4)
+      (SameLocalTime(t3, t4) ? nambiguous : ndiffs)++;
+    if (OldStartOfDay(times[i]) != PWSLocalTime::StartOfDay(times[i]))
+      ndiffs++;
+  }
+  std::printf("%zu strings, %zu differences, %zu in a repeated hour\n",
+              NUM_STRINGS, ndiffs, nambiguous);
+
+  Time("import: stream + mktime", [&]() {
+    long long sum = 0;
+    time_t t;
+    for (size_t i = 0; i < imp.size(); i++)
+      sum += OldImportDateTime(imp[i], t) ? (t & 0xff) : 0;
+    return sum;
+  });
+  Time("import: VerifyImportDateTimeString", [&]() {
+    long long sum = 0;
+    time_t t;
+    for (size_t i = 0; i < imp.size(); i++)
+      sum += VerifyImportDateTimeString(imp[i], t) ? (t & 0xff) : 0;
+    return sum;
+  });
+  Time("XML: stream + mktime", [&]() {
+    long long sum = 0;
+    time_t t;
+    for (size_t i = 0; i < xml.size(); i++)
+      sum += OldXMLDateTime(xml[i], t) ? (t & 0xff) : 0;
+    return sum;
+  });
+  Time("XML: VerifyXMLDateTimeString", [&]() {
+    long long sum = 0;
+    time_t t;
+    for (size_t i = 0; i < xml.size(); i++)
+      sum += VerifyXMLDateTimeString(xml[i], t) ? (t & 0xff) : 0;
+    return sum;
+  });
+  Time("filter: localtime + mktime", [&]() {
+    long long sum = 0;
+    for (size_t i = 0; i < times.size(); i++)
+      sum += OldStartOfDay(times[i]) & 0xff;
+    return sum;
+  });
+  Time("filter: PWSLocalTime::StartOfDay", [&]() {
+    long long sum = 0;
+    for (size_t i = 0; i < times.size(); i++)
+      sum += PWSLocalTime::StartOfDay(times[i]) & 0xff;
+    return sum;
+  });
+  return ndiffs == 0 ? 0 : 1;
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+ * All rights reserved. Use of the code is allowed under the
+ * Artistic License 2.0 terms, as specified in the LICENSE file
+ * distributed with this code, or available from
+ * http://www.opensource.org/licenses/artistic-license-2.0.php
+ */
+//-----------------------------------------------------------------------------
+/*
+ * Micro-benchmark of case insensitive substring search over entry-sized
+ * strings: the old way (lowercase copies of both strings, then find())
+ * against PWSMatch::CFinder, on StringX and on a UTF-8 buffer.
+ *
+ * To build, from src -
+ *   g++ -O2 -std=c++17 -I. -Icore -o findbench test/findbench.cpp \
+ *     core/FindText.cpp core/StringX.cpp core/UTF8Conv.cpp core/Util.cpp \
+ *     core/core_st.cpp core/miniutf.cpp os/linux/{UUID,debug,pws_time,dir,file,env,utf8conv,pws_str,mem}.cpp \
+ *     -luuid
+ *
+ * Usage: findbench [search text], in a UTF-8 locale
+ */
+
+#include "core/FindText.h"
+#include "core/UTF8Conv.h"
+
+#include <chrono>
+#include <clocale>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+  const size_t NUM_STRINGS = 20000;
+  const int NUM_RUNS = 20;
+
+  // What FindNoCase in the wx search did
+  bool OldFindNoCase(const StringX &src, const StringX &dest)
+  {
+    StringX srcLower = src;
+    for (size_t i = 0; i < srcLower.length(); i++)
+      srcLower[i] = _totlower(srcLower[i]);
+    StringX destLower = dest;
+    for (size_t i = 0; i < destLower.length(); i++)
+      destLower[i] = _totlower(destLower[i]);
+    return destLower.find(srcLower) != StringX::npos;
+  }
+
+  // Deterministic, vaguely realistic field text
+  std::vector<StringX> MakeCorpus()
+  {
+    static const TCHAR *words[] = {
+      _T("Mail"), _T("bank"), _T("Online"), _T("account"), _T("example.com"),
+      _T("https://"), _T("www"), _T("Login"), _T("user"), _T("Personal"),
+      _T("Work"), _T("Shop"), _T("Forum"), _T("\x00d6sterreich"), _T("server"),
+    };
+    const size_t nwords = sizeof(words) / sizeof(words[0]);
+    std::vector<StringX> corpus;
+    unsigned int seed = 12345;
+    for (size_t i = 0; i < NUM_STRINGS; i++) {
+      StringX sx;
+      const size_t n = 2 + i % 12;
+      for (size_t j = 0; j < n; j++) {
+        seed = seed * 1103515245 + 12345;
+        sx += words[(seed >> 16) % nwords];
+        sx += _T(' ');
+      }
+      corpus.push_back(sx);
+    }
+    return corpus;
+  }
+
+  template<typename F> void Time(const char *name, size_t nchars, F f)
+  {
+    size_t found = 0;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int run = 0; run < NUM_RUNS; run++)
+      found += f();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    const double mchars = double(nchars) * NUM_RUNS / 1e6;
+    std::printf("%-28s %8.1f Mchars/s  (%zu found)\n", name,
+                mchars / elapsed.count(), found / NUM_RUNS);
+  }
+};
+
+int main(int argc, char *argv[])
+{
+  setlocale(LC_ALL, "");
+  StringX sxSearch(_T("FORUM LOGIN"));
+  if (argc > 1) {
+    CUTF8Conv conv;
+    conv.FromUTF8(reinterpret_cast<const unsigned char *>(argv[1]),
+                  std::strlen(argv[1]), sxSearch);
+  }
+
+  const std::vector<StringX> corpus = MakeCorpus();
+  size_t nchars = 0;
+  std::string utf8;
+  std::vector<std::pair<size_t, size_t> > utf8_strings;
+  CUTF8Conv conv;
+  for (size_t i = 0; i < corpus.size(); i++) {
+    nchars += corpus[i].length();
+    const unsigned char *p;
+    size_t len;
+    conv.ToUTF8(corpus[i], p, len);
+    utf8_strings.push_back(std::make_pair(utf8.size(), len));
+    utf8.append(reinterpret_cast<const char *>(p), len);
+  }
+
+  const PWSMatch::CFinder finder(sxSearch, false);
+  const PWSMatch::CFinder finder_case(sxSearch, true);
+
+  Time("lowercase copies + find", nchars, [&]() {
+    size_t n = 0;
+    for (size_t i = 0; i < corpus.size(); i++)
+      n += OldFindNoCase(sxSearch, corpus[i]);
+    return n;
+  });
+  Time("CFinder (ignore case)", nchars, [&]() {
+    size_t n = 0;
+    for (size_t i = 0; i < corpus.size(); i++)
+      n += finder.FoundIn(corpus[i]);
+    return n;
+  });
+  Time("CFinder (match case)", nchars, [&]() {
+    size_t n = 0;
+    for (size_t i = 0; i < corpus.size(); i++)
+      n += finder_case.FoundIn(corpus[i]);
+    return n;
+  });
+  const unsigned char *pUTF8 = reinterpret_cast<const unsigned char *>(utf8.data());
+  Time("CFinder UTF-8 (ignore case)", nchars, [&]() {
+    size_t n = 0;
+    for (size_t i = 0; i < utf8_strings.size(); i++)
+      n += finder.FindUTF8(pUTF8 + utf8_strings[i].first,
+                           utf8_strings[i].second) != StringX::npos;
+    return n;
+  });
+  Time("CFinder UTF-8 (match case)", nchars, [&]() {
+    size_t n = 0;
+    for (size_t i = 0; i < utf8_strings.size(); i++)
+      n += finder_case.FindUTF8(pUTF8 + utf8_strings[i].first,
+                                utf8_strings[i].second) != StringX::npos;
+    return n;
+  });
+  return 0;
+}
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+ * All rights reserved. Use of the code is allowed under the
+ * Artistic License 2.0 terms, as specified in the LICENSE file
+ * distributed with this code, or available from
+ * http://www.opensource.org/licenses/artistic-license-2.0.php
+ */
+//-----------------------------------------------------------------------------
+// Benchmark of renaming a top level group and undoing it, with
+// RenameGroupCommand, against walking all the entries as DoRenameGroup
+// used to (on a copy of the entries, not counting the rebuild of the
+// indices that followed). Checks the groups are those the walk gives.
+//
+// To build, from src, as one command -
+//   g++ -O2 -std=c++17 -DUSE_XML_LIBRARY=PUGIXML -I. -Icore -o groupbench test/groupbench.cpp
+//     core/*.cpp core/XML/*.cpp core/XML/Pugi/*.cpp core/pugixml/pugixml.cpp
+//     os/linux/{UUID,debug,pws_time,dir,file,env,utf8conv,pws_str,mem,rand,registry,logit,sleep,lib,KeySend,media,pws_time}.cpp
+//     -luuid -lsodium -pthread
+//
+// Usage: groupbench [number of entries [number of top level groups]]
+
+#include "core/PWScore.h"
+#include "core/Command.h"
+
+#include <chrono>
+#include <clocale>
+#include <cstdio>
+#include <cstdlib>
+#include <cwchar>
+#include <vector>
+
+namespace {
+  const int NUM_RUNS = 5;
+
+  unsigned int seed = 12345;
+  unsigned int Random(unsigned int n)
+  {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % n;
+  }
+
+  // "Group<n>" with up to two levels of subgroups, some of whose names
+  // end with a dot, so aren't under "Group<n>"
+  StringX RandomGroup(unsigned int ngroups)
+  {
+    TCHAR buf[64];
+    swprintf(buf, 64, L"Group%u", Random(ngroups));
+    StringX sx(buf);
+    const unsigned int depth = Random(3);
+    for (unsigned int i = 0; i < depth; i++) {
+      swprintf(buf, 64, (Random(50) == 0) ? L"..Sub%u" : L".Sub%u", Random(10));
+      sx += buf;
+    }
+    return sx;
+  }
+
+  // The group DoRenameGroup() gave an entry
+  StringX Renamed(const StringX &sxGroup, const StringX &sxOldPath,
+                  const StringX &sxNewPath)
+  {
+    const StringX sxOldPath2 = sxOldPath + _T(".");
+    const size_t len2 = sxOldPath2.length();
+    if (sxGroup == sxOldPath)
+      return sxNewPath;
+    if (sxGroup.length() > len2 && sxGroup.substr(0, len2) == sxOldPath2 &&
+        sxGroup[len2] != _T('.'))
+      return sxNewPath + _T(".") + sxGroup.substr(len2);
+    return sxGroup;
+  }
+
+  bool CheckGroups(const PWScore &core, const std::vector<CItemData> &expected)
+  {
+    for (size_t i = 0; i < expected.size(); i++) {
+      const ItemListConstIter iter = core.Find(expected[i].GetUUID());
+      if (iter == core.GetEntryEndIter() ||
+          iter->second.GetGroup() != expected[i].GetGroup())
+        return false;
+    }
+    return true;
+  }
+
+  double Elapsed(const std::chrono::steady_clock::time_point &start)
+  {
+    const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+  }
+};
+
+int main(int argc, char *argv[])
+{
+  setlocale(LC_ALL, "");
+  const int nentries = argc > 1 ? std::atoi(argv[1]) : 100000;
+  const unsigned int ngroups = argc > 2 ? unsigned(std::atoi(argv[2])) : 20;
+
+  PWScore core;
+  MultiCommands *pmulticmds = MultiCommands::Create(&core);
+  for (int i = 0; i < nentries; i++) {
+    CItemData ci;
+    ci.CreateUUID();
+    ci.SetGroup(RandomGroup(ngroups));
+    TCHAR buf[16];
+    swprintf(buf, 16, L"Entry %d", i);
+    ci.SetTitle(buf);
+    ci.SetPassword(_T("password"));
+    pmulticmds->Add(AddEntryCommand::Create(&core, ci));
+  }
+  core.Execute(pmulticmds);
+  // As if just opened, and not to time TrimCommands() walking the adds
+  core.ClearCommands();
+
+  const StringX sxOldPath(_T("Group1")), sxNewPath(_T("Renamed.Group1"));
+
+  std::vector<CItemData> before, after;
+  for (ItemListConstIter iter = core.GetEntryIter();
+       iter != core.GetEntryEndIter(); iter++) {
+    before.push_back(iter->second);
+  }
+
+  // The old way
+  double walk = 0;
+  for (int run = 0; run < NUM_RUNS; run++) {
+    after = before;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < after.size(); i++) {
+      const StringX sxGroup = after[i].GetGroup();
+      const StringX sxRenamed = Renamed(sxGroup, sxOldPath, sxNewPath);
+      if (sxRenamed != sxGroup)
+        after[i].SetGroup(sxRenamed);
+    }
+    const double ms = Elapsed(start);
+    if (run == 0 || ms < walk)
+      walk = ms;
+  }
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  const size_t nrenamed = core.GetNumGroupEntries(sxOldPath);
+  const double build = Elapsed(start);
+  std::printf("%d entries, %zu in %ls, indices built in %.1f ms\n",
+              nentries, nrenamed, sxOldPath.c_str(), build);
+
+  double rename = 0, undo = 0;
+  for (int run = 0; run < NUM_RUNS; run++) {
+    start = std::chrono::steady_clock::now();
+    core.Execute(RenameGroupCommand::Create(&core, sxOldPath, sxNewPath));
+    double ms = Elapsed(start);
+    if (run == 0 || ms < rename)
+      rename = ms;
+    if (run == 0 && !CheckGroups(core, after)) {
+      std::printf("Rename MISMATCH\n");
+      return 1;
+    }
+
+    start = std::chrono::steady_clock::now();
+    core.Undo();
+    ms = Elapsed(start);
+    if (run == 0 || ms < undo)
+      undo = ms;
+    if (run == 0 && !CheckGroups(core, before)) {
+      std::printf("Undo MISMATCH\n");
+      return 1;
+    }
+  }
+  std::printf("  walk all entries %9.2f ms\n", walk);
+  std::printf("  rename           %9.2f ms\n", rename);
+  std::printf("  undo             %9.2f ms\n", undo);
+  core.ClearData();
+  return 0;
+}
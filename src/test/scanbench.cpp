@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+ * All rights reserved. Use of the code is allowed under the
+ * Artistic License 2.0 terms, as specified in the LICENSE file
+ * distributed with this code, or available from
+ * http://www.opensource.org/licenses/artistic-license-2.0.php
+ */
+//-----------------------------------------------------------------------------
+/*
+ * Benchmark of whole database scans run with CParallelScan on 1, 2, 4...
+ * threads: free text search of all fields, a compiled filter,
+ * Validate's password history check, searches of the current and old
+ * passwords, and a ranked (fuzzy) search for the best 50 entries. Matches are merged in entry order, so each run must
+ * find the same entries as the single threaded one.
+ *
+ * To build, from src -
+ *   g++ -O2 -std=c++17 -I. -Icore -o scanbench test/scanbench.cpp \
+ *     core/{ParallelScan,CompiledFilter,FuzzyMatch,PatternMatch,ItemData,ItemField,Match,FindText,PWHistory,PWPolicy,StringX,Util,UTF8Conv,core_st,miniutf,PWStime,UnknownField,PWSrand,PWCharPool,VerifyFormat,PWSprefs,XMLprefs,PWSdirs,SysInfo,PWSLog}.cpp \
+ *     core/pugixml/pugixml.cpp \
+ *     os/linux/{UUID,debug,pws_time,dir,file,env,utf8conv,pws_str,mem,rand,registry,logit,sleep}.cpp \
+ *     -luuid -lsodium -pthread
+ *
+ * Usage: scanbench [number of entries [maximum number of threads]]
+ */
+
+#include "core/ParallelScan.h"
+#include "core/CompiledFilter.h"
+#include "core/FuzzyMatch.h"
+#include "core/ItemData.h"
+
+#include <algorithm>
+#include <chrono>
+#include <clocale>
+#include <cstdio>
+#include <cstdlib>
+#include <cwchar>
+#include <functional>
+#include <vector>
+
+namespace {
+  const int NUM_RUNS = 5;
+
+  unsigned int seed = 12345;
+  unsigned int Random(unsigned int n)
+  {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % n;
+  }
+
+  StringX RandomText(size_t maxwords)
+  {
+    static const TCHAR *words[] = {
+      _T("Mail"), _T("bank"), _T("Online"), _T("account"), _T("example.com"),
+      _T("https://"), _T("www"), _T("Login"), _T("user"), _T("Personal"),
+      _T("Work"), _T("Shop"), _T("Forum"), _T("\x00d6sterreich"), _T("server"),
+    };
+    StringX sx;
+    const size_t n = 1 + Random(unsigned(maxwords));
+    for (size_t i = 0; i < n; i++) {
+      if (i != 0)
+        sx += _T(' ');
+      sx += words[Random(sizeof(words) / sizeof(words[0]))];
+    }
+    return sx;
+  }
+
+  void MakeEntry(CItemData &ci)
+  {
+    const time_t now = time(NULL);
+    ci.CreateUUID();
+    ci.SetGroup(RandomText(2));
+    ci.SetTitle(RandomText(3));
+    ci.SetUser(RandomText(1));
+    ci.SetPassword(RandomText(2));
+    ci.SetURL(RandomText(2));
+    ci.SetNotes(RandomText(20));
+    ci.SetCTime(now - Random(1000) * 86400);
+    if (Random(4) == 0)
+      ci.SetXTime(now + (time_t(Random(200)) - 100) * 86400);
+    if (Random(2) == 0) {
+      // Status, maximum and number of entries, then for each the
+      // time, password length and password
+      const unsigned int num = Random(4);
+      TCHAR buf[32];
+      swprintf(buf, 32, L"1%02x%02x", 5, num);
+      StringX sxHistory(buf);
+      for (unsigned int i = 0; i < num; i++) {
+        const StringX sxPassword = RandomText(2);
+        swprintf(buf, 32, L"%08x%04x", unsigned(now - Random(1000) * 86400),
+                 unsigned(sxPassword.length()));
+        sxHistory += buf;
+        sxHistory += sxPassword;
+      }
+      ci.SetPWHistory(sxHistory);
+    }
+  }
+
+  // Runs scan on nThreads threads NUM_RUNS times, returns the best time in ms
+  double Time(unsigned int nThreads, size_t &found,
+              const std::function<size_t (const CParallelScan &)> &scan)
+  {
+    const CParallelScan parallel(nThreads);
+    double best = 0;
+    for (int run = 0; run < NUM_RUNS; run++) {
+      const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      found = scan(parallel);
+      const std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+      if (run == 0 || elapsed.count() < best)
+        best = elapsed.count();
+    }
+    return best;
+  }
+
+  // Indices of the entries for which test is true, in order
+  template<typename Test>
+  size_t Select(const CParallelScan &parallel, const std::vector<CItemData> &entries,
+                Test test, std::vector<size_t> &selected)
+  {
+    std::vector<std::vector<size_t> > results;
+    parallel.Scan(entries.size(), results,
+                  [&entries, &test](size_t i, std::vector<size_t> &passed) {
+                    if (test(entries[i]))
+                      passed.push_back(i);
+                    return true;
+                  });
+    selected.clear();
+    for (size_t ichunk = 0; ichunk < results.size(); ichunk++)
+      selected.insert(selected.end(), results[ichunk].begin(), results[ichunk].end());
+    return selected.size();
+  }
+
+  void Benchmark(const char *name, const std::vector<CItemData> &entries,
+                 unsigned int maxThreads,
+                 const std::function<bool (const CItemData &)> &test)
+  {
+    std::printf("%s\n", name);
+    std::vector<size_t> expected, selected;
+    double t1 = 0;
+    for (unsigned int nThreads = 1; nThreads <= maxThreads; nThreads *= 2) {
+      size_t found;
+      const double ms = Time(nThreads, found, [&](const CParallelScan &parallel) {
+        return Select(parallel, entries, test, selected);
+      });
+      if (nThreads == 1) {
+        t1 = ms;
+        expected = selected;
+      }
+      std::printf("  %3u threads %9.1f ms  x%5.2f  (%zu found%s)\n", nThreads, ms,
+                  t1 / ms, found, selected == expected ? "" : ", MISMATCH");
+    }
+  }
+};
+
+int main(int argc, char *argv[])
+{
+  setlocale(LC_ALL, "");
+  const size_t nentries = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 200000;
+  unsigned int maxThreads = argc > 2 ? unsigned(std::strtoul(argv[2], NULL, 10)) : 0;
+  if (maxThreads == 0)
+    maxThreads = std::max(CParallelScan::GetDefaultNumThreads(), 16U);
+
+  std::vector<CItemData> entries(nentries);
+  for (size_t i = 0; i < entries.size(); i++)
+    MakeEntry(entries[i]);
+  std::printf("%zu entries, %u hardware threads\n", entries.size(),
+              CParallelScan::GetDefaultNumThreads());
+
+  // Decode the entries' lazily decoded fields up front, as would have
+  // been done by the time a database has been displayed
+  CItemData::FieldBits bsAll;
+  bsAll.set();
+  for (size_t i = 0; i < entries.size(); i++)
+    entries[i].ContainsText(StringX(_T("?")), false, bsAll);
+
+  const PWSMatch::CFinder finder(_T("ONLINE ACC"), false);
+  Benchmark("Free text search, all fields", entries, maxThreads,
+            [&finder, &bsAll](const CItemData &ci) {
+              return ci.ContainsText(finder, bsAll);
+            });
+
+  st_filters filters;
+  st_FilterRow row;
+  row.bFilterActive = true;
+  row.ftype = FT_TITLE;
+  row.mtype = PWSMatch::MT_STRING;
+  row.rule = PWSMatch::MR_CONTAINS;
+  row.fstring = _T("bank");
+  filters.vMfldata.push_back(row);
+  row.ltype = LC_AND;
+  row.ftype = FT_NOTES;
+  row.rule = PWSMatch::MR_NOTCONTAIN;
+  row.fstring = _T("forum");
+  filters.vMfldata.push_back(row);
+  row.ltype = LC_OR;
+  row.ftype = FT_XTIME;
+  row.mtype = PWSMatch::MT_DATE;
+  row.rule = PWSMatch::MR_BEFORE;
+  row.fdate1 = time(NULL);
+  filters.vMfldata.push_back(row);
+  const CCompiledFilter filter(filters);
+  Benchmark("Compiled filter", entries, maxThreads,
+            [&filter](const CItemData &ci) {return filter.Passes(ci);});
+
+  Benchmark("Password history check", entries, maxThreads,
+            [](const CItemData &ci) {
+              CItemData fixedItem(ci);
+              return !fixedItem.ValidatePWHistory();
+            });
+
+  // Old passwords are searched from the entries' parsed history, so
+  // should take about as long as the current ones
+  CItemData::FieldBits bsPassword, bsHistory;
+  bsPassword.set(CItemData::PASSWORD);
+  bsHistory.set(CItemData::PWHIST);
+  const PWSMatch::CFinder pwfinder(_T("bank Shop"), true);
+  Benchmark("Password search", entries, maxThreads,
+            [&pwfinder, &bsPassword](const CItemData &ci) {
+              return ci.ContainsText(pwfinder, bsPassword);
+            });
+  Benchmark("Old password search", entries, maxThreads,
+            [&pwfinder, &bsHistory](const CItemData &ci) {
+              return ci.ContainsText(pwfinder, bsHistory);
+            });
+  const StringX sxPassword(_T("Online user"));
+  Benchmark("Password use, current and old", entries, maxThreads,
+            [&sxPassword](const CItemData &ci) {
+              return ci.HasPassword(sxPassword, true);
+            });
+
+  std::printf("Fuzzy search, best 50\n");
+  const PWSMatch::CFuzzyMatcher matcher(_T("onlne bnk"));
+  std::vector<size_t> expected, best;
+  double t1 = 0;
+  for (unsigned int nThreads = 1; nThreads <= maxThreads; nThreads *= 2) {
+    CParallelScan::SetDefaultNumThreads(nThreads);
+    size_t found;
+    const double ms = Time(nThreads, found, [&](const CParallelScan &) {
+      PWSMatch::SelectBest(entries.size(), 50, [&](size_t i, int minScore) {
+                             return matcher.ScoreFields(entries[i], minScore);
+                           }, best);
+      return best.size();
+    });
+    if (nThreads == 1) {
+      t1 = ms;
+      expected = best;
+    }
+    std::printf("  %3u threads %9.1f ms  x%5.2f  (%zu found%s)\n", nThreads, ms,
+                t1 / ms, found, best == expected ? "" : ", MISMATCH");
+  }
+  CParallelScan::SetDefaultNumThreads(0);
+  return 0;
+}
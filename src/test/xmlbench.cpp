@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2003-2015 Rony Shapiro <ronys@users.sourceforge.net>.
+ * All rights reserved. Use of the code is allowed under the
+ * Artistic License 2.0 terms, as specified in the LICENSE file
+ * distributed with this code, or available from
+ * http://www.opensource.org/licenses/artistic-license-2.0.php
+ */
+//-----------------------------------------------------------------------------
+// Benchmark of XML import: a database of random entries is exported with
+// WriteXMLFile, then imported (validated, imported and the commands
+// executed) into an empty database, which must then hold the same entries.
+// Xerces validates against the schema with its parser, the pugixml import
+// checks the same in its handlers (see PFileHandlers), so both do the same
+// work.
+//
+// The library is chosen when building (XML_LIBRARY in CMakeLists.txt), so
+// build it once per XML library to compare them: each run leaves its time
+// in the XML file's name followed by .pugixml or .Xerces, and prints the
+// other library's time alongside its own if it's there for as many
+// entries, so running one build then the other compares them.
+//
+// To build, from src, with pugixml, as one command -
+//   g++ -O2 -std=c++17 -DUSE_XML_LIBRARY=PUGIXML -I. -Icore -o xmlbench test/xmlbench.cpp
+//     core/*.cpp core/XML/*.cpp core/XML/Pugi/*.cpp core/pugixml/pugixml.cpp
+//     os/linux/{UUID,debug,pws_time,dir,file,env,utf8conv,pws_str,mem,rand,registry,logit,sleep,lib,KeySend,media,pws_time}.cpp
+//     -luuid -lsodium -pthread
+// or with Xerces, replacing -DUSE_XML_LIBRARY=PUGIXML with
+// -DUSE_XML_LIBRARY=XERCES -DWCHAR_INCOMPATIBLE_XMLCH, core/XML/Pugi/*.cpp
+// with core/XML/Xerces/*.cpp, and adding -lxerces-c.
+//
+// Usage: xmlbench [number of entries [XML file [XSD file]]]
+// where the XSD file, for Xerces, is ../xml/lumimaja.xsd by default.
+
+#include "core/PWScore.h"
+#include "core/Command.h"
+#include "core/Report.h"
+#include "core/XML/XMLDefs.h"
+#include "os/file.h"
+#include "os/utf8conv.h"
+
+#include <chrono>
+#include <clocale>
+#include <cstdio>
+#include <cstdlib>
+#include <cwchar>
+
+namespace {
+  const int NUM_RUNS = 3;
+
+#if USE_XML_LIBRARY == PUGIXML
+  const char *LIBRARY = "pugixml", *OTHER_LIBRARY = "Xerces";
+#elif USE_XML_LIBRARY == XERCES
+  const char *LIBRARY = "Xerces", *OTHER_LIBRARY = "pugixml";
+#else
+  const char *LIBRARY = "?", *OTHER_LIBRARY = "?";
+#endif
+
+  unsigned int seed = 12345;
+  unsigned int Random(unsigned int n)
+  {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % n;
+  }
+
+  StringX RandomText(size_t maxwords)
+  {
+    static const TCHAR *words[] = {
+      _T("Mail"), _T("bank"), _T("Online"), _T("account"), _T("example.com"),
+      _T("https://"), _T("www"), _T("Login"), _T("user"), _T("Personal"),
+      _T("Work"), _T("Shop"), _T("Forum"), _T("\x00d6sterreich"), _T("<&>"),
+    };
+    StringX sx;
+    const size_t n = 1 + Random(unsigned(maxwords));
+    for (size_t i = 0; i < n; i++) {
+      if (i != 0)
+        sx += _T(' ');
+      sx += words[Random(sizeof(words) / sizeof(words[0]))];
+    }
+    return sx;
+  }
+
+  void MakeEntry(CItemData &ci)
+  {
+    const time_t now = time(NULL);
+    ci.CreateUUID();
+    ci.SetGroup(RandomText(2));
+    ci.SetTitle(RandomText(3));
+    ci.SetUser(RandomText(1));
+    ci.SetPassword(RandomText(2));
+    ci.SetURL(RandomText(2));
+    ci.SetNotes(RandomText(20));
+    ci.SetCTime(now - Random(1000) * 86400);
+    if (Random(4) == 0)
+      ci.SetXTime(now + (time_t(Random(200)) - 100) * 86400);
+  }
+
+  // Imports filename into an empty core, returns the time taken in ms,
+  // or a negative time if it failed
+  double Import(PWScore &core, const stringT &filename, const stringT &xsdfilename,
+                int &numImported)
+  {
+    stringT strXMLErrors, strSkippedList, strPWHErrorList, strRenameList;
+    int numValidated, numSkipped, numPWHErrors, numRenamed;
+    int numNoPolicy, numRenamedPolicies, numShortcutsRemoved;
+    CReport rpt;
+    Command *pcmd = NULL;
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const int rc = core.ImportXMLFile(_T(""), filename, xsdfilename, false,
+                                      strXMLErrors, strSkippedList, strPWHErrorList,
+                                      strRenameList, numValidated, numImported,
+                                      numSkipped, numPWHErrors, numRenamed,
+                                      numNoPolicy, numRenamedPolicies,
+                                      numShortcutsRemoved, rpt, pcmd);
+    if (pcmd != NULL)
+      core.Execute(pcmd);
+    const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+    if (rc != PWScore::SUCCESS && rc != PWScore::OK_WITH_ERRORS) {
+      std::printf("Import failed (%d): %ls\n", rc, strXMLErrors.c_str());
+      return -1;
+    }
+    return elapsed.count();
+  }
+
+  // Same entries (by UUID) with the same fields?
+  bool Compare(const PWScore &expected, const PWScore &imported)
+  {
+    if (expected.GetNumEntries() != imported.GetNumEntries())
+      return false;
+    for (ItemListConstIter iter = expected.GetEntryIter();
+         iter != expected.GetEntryEndIter(); iter++) {
+      const CItemData &ci = iter->second;
+      const ItemListConstIter found = imported.Find(ci.GetUUID());
+      if (found == imported.GetEntryEndIter())
+        return false;
+      const CItemData &cj = found->second;
+      if (ci.GetGroup() != cj.GetGroup() || ci.GetTitle() != cj.GetTitle() ||
+          ci.GetUser() != cj.GetUser() || ci.GetPassword() != cj.GetPassword() ||
+          ci.GetURL() != cj.GetURL() || ci.GetNotes() != cj.GetNotes())
+        return false;
+    }
+    return true;
+  }
+
+  // Where a library's time for filename is kept
+  std::string TimesFile(const StringX &filename, const char *library)
+  {
+    return pws_os::tomb(stringT(filename.c_str())) + "." + library;
+  }
+
+  // The time the other library took for as many entries, or a negative
+  // time if it's not been run
+  double OtherTime(const StringX &filename, int nentries)
+  {
+    double ms = -1;
+    std::FILE *fp = std::fopen(TimesFile(filename, OTHER_LIBRARY).c_str(), "r");
+    if (fp != NULL) {
+      int n;
+      if (std::fscanf(fp, "%d %lf", &n, &ms) != 2 || n != nentries)
+        ms = -1;
+      std::fclose(fp);
+    }
+    return ms;
+  }
+};
+
+int main(int argc, char *argv[])
+{
+  setlocale(LC_ALL, "");
+  const int nentries = argc > 1 ? std::atoi(argv[1]) : 100000;
+  const StringX filename = argc > 2 ? StringX(pws_os::towc(argv[2]).c_str()) :
+                                      StringX(_T("/tmp/xmlbench.xml"));
+  const stringT xsdfilename = argc > 3 ? pws_os::towc(argv[3]) :
+                                         stringT(_T("../xml/lumimaja.xsd"));
+
+  // One command for all, as an import does, as each Execute walks the undo list
+  PWScore source;
+  MultiCommands *pmulticmds = MultiCommands::Create(&source);
+  for (int i = 0; i < nentries; i++) {
+    // Entries with the same group, title and user are renamed on import
+    CItemData ci;
+    MakeEntry(ci);
+    TCHAR buf[16];
+    swprintf(buf, 16, L" %d", i);
+    ci.SetTitle(ci.GetTitle() + buf);
+    pmulticmds->Add(AddEntryCommand::Create(&source, ci));
+  }
+  source.Execute(pmulticmds);
+
+  CItemData::FieldBits bsAll;
+  bsAll.set();
+  int numExported = 0;
+  CReport rpt;
+  if (source.WriteXMLFile(filename, bsAll, _T(""), 0, 0, _T('\xbb'),
+                          numExported, NULL, false, &rpt) != PWScore::SUCCESS) {
+    std::printf("Export to %ls failed\n", filename.c_str());
+    return 1;
+  }
+  std::FILE *fp = pws_os::FOpen(filename.c_str(), _T("rb"));
+  const long size = fp != NULL ? long(pws_os::fileLength(fp)) : 0;
+  if (fp != NULL)
+    std::fclose(fp);
+  std::printf("%d entries, %ld bytes, %s\n", numExported, size, LIBRARY);
+
+  double best = 0;
+  for (int run = 0; run < NUM_RUNS; run++) {
+    PWScore imported;
+    int numImported = 0;
+    const double ms = Import(imported, filename.c_str(), xsdfilename, numImported);
+    if (ms < 0)
+      return 1;
+    if (run == 0 && !Compare(source, imported)) {
+      std::printf("Imported %d entries, MISMATCH\n", numImported);
+      return 1;
+    }
+    if (run == 0 || ms < best)
+      best = ms;
+    imported.ClearData();  // frees the commands
+  }
+  std::printf("  import %9.1f ms  %9.0f entries/s  %s\n", best, nentries * 1000. / best,
+              LIBRARY);
+
+  std::FILE *fptimes = std::fopen(TimesFile(filename, LIBRARY).c_str(), "w");
+  if (fptimes != NULL) {
+    std::fprintf(fptimes, "%d %.1f\n", nentries, best);
+    std::fclose(fptimes);
+  }
+  const double other = OtherTime(filename, nentries);
+  if (other > 0)
+    std::printf("  import %9.1f ms  %9.0f entries/s  %s, %.2f times as long\n",
+                other, nentries * 1000. / other, OTHER_LIBRARY, other / best);
+  else
+    std::printf("  (no %s time for %d entries: run the %s build too to compare)\n",
+                OTHER_LIBRARY, nentries, OTHER_LIBRARY);
+  source.ClearData();
+  return 0;
+}
@@ -29,6 +29,9 @@ static void echoOn();
 
 static int ImportText(PWScore &core, const StringX &fname);
 static int ImportXML(PWScore &core, const StringX &fname);
+static void PrintStats(const PWScore &core);
+static void Search(PWScore &core, const StringX &text, bool bRanked);
+static void FindTarget(PWScore &core, const StringX &text);
 static const char *status_text(PWScore::RETURNVALUE);
 
 //-----------------------------------------------------------------
@@ -38,20 +41,24 @@ static struct termios oldTermioFlags; // to restore tty echo
 static void usage(char *pname)
 {
   cerr << "Usage: " << pname << " safe --imp[=file] --text|--xml" << endl
-       << "\t safe --exp[=file] --text|--xml" << endl;
+       << "\t safe --exp[=file] --text|--xml" << endl
+       << "\t safe --stats" << endl
+       << "\t safe --search=text" << endl
+       << "\t safe --find=text" << endl
+       << "\t safe --target=window title or URL" << endl;
 }
 
 
 struct UserArgs {
   UserArgs() : ImpExp(Unset), Format(Unknown) {}
-  StringX safe, fname;
-  enum {Unset, Import, Export} ImpExp;
+  StringX safe, fname, text;
+  enum {Unset, Import, Export, Stats, Search, Find, Target} ImpExp;
   enum {Unknown, XML, Text} Format;
 };
 
 bool parseArgs(int argc, char *argv[], UserArgs &ua)
 {
-  if (argc != 4 && argc != 5)
+  if (argc != 3 && argc != 4 && argc != 5)
     return false;
   CUTF8Conv conv;
   if (!conv.FromUTF8((const unsigned char *)argv[1], strlen(argv[1]),
@@ -67,10 +74,14 @@ bool parseArgs(int argc, char *argv[], UserArgs &ua)
       {"export", optional_argument, 0, 'e'},
       {"text", no_argument, 0, 't'},
       {"xml", no_argument, 0, 'x'},
+      {"stats", no_argument, 0, 's'},
+      {"search", required_argument, 0, 'f'},
+      {"find", required_argument, 0, 'b'},
+      {"target", required_argument, 0, 'g'},
       {0, 0, 0, 0}
     };
 
-    int c = getopt_long(argc-1, argv+1, "i::e::tx",
+    int c = getopt_long(argc-1, argv+1, "i::e::txsf:b:g:",
                         long_options, &option_index);
     if (c == -1)
       break;
@@ -104,6 +115,27 @@ bool parseArgs(int argc, char *argv[], UserArgs &ua)
         }
       }
       break;
+    case 's':
+      if (ua.ImpExp == UserArgs::Unset)
+        ua.ImpExp = UserArgs::Stats;
+      else
+        return false;
+      break;
+    case 'f':
+    case 'b':
+    case 'g':
+      if (ua.ImpExp == UserArgs::Unset)
+        ua.ImpExp = (c == 'f') ? UserArgs::Search :
+          (c == 'b') ? UserArgs::Find : UserArgs::Target;
+      else
+        return false;
+      if (!conv.FromUTF8((const unsigned char *)optarg, strlen(optarg),
+                         ua.text)) {
+        cerr << "Could not convert search text "
+             << optarg << " to StringX" << endl;
+        exit(2);
+      }
+      break;
     case 'x':
       if (ua.Format == UserArgs::Unknown)
         ua.Format = UserArgs::XML;
@@ -124,6 +156,12 @@ bool parseArgs(int argc, char *argv[], UserArgs &ua)
     if (ua.fname.empty())
       ua.fname = (ua.Format == UserArgs::XML) ? L"file.xml" : L"file.txt";
   }
+  // --stats, --search, --find & --target take no format, import/export
+  // need one
+  if ((ua.ImpExp == UserArgs::Stats || ua.ImpExp == UserArgs::Search ||
+       ua.ImpExp == UserArgs::Find || ua.ImpExp == UserArgs::Target) !=
+      (argc == 3))
+    return false;
   return true;
 }
 
@@ -181,7 +219,13 @@ int main(int argc, char *argv[])
     goto done;
   }
 
-  if (ua.ImpExp == UserArgs::Export) {
+  if (ua.ImpExp == UserArgs::Stats) {
+    PrintStats(core);
+  } else if (ua.ImpExp == UserArgs::Search || ua.ImpExp == UserArgs::Find) {
+    Search(core, ua.text, ua.ImpExp == UserArgs::Find);
+  } else if (ua.ImpExp == UserArgs::Target) {
+    FindTarget(core, ua.text);
+  } else if (ua.ImpExp == UserArgs::Export) {
     CItemData::FieldBits all(~0L);
     int N;
     if (ua.Format == UserArgs::XML) {
@@ -233,6 +277,80 @@ static const char *status_text(PWScore::RETURNVALUE val)
   return PWScore::GetReturnValueString(val);
 }
 
+static void PrintUsage(const wchar_t *name, const st_MemoryUsage &usage)
+{
+  wcout << L"  " << name << L": " << usage.bytes << L" bytes in "
+        << usage.allocations << L" allocations" << endl;
+}
+
+static void PrintStats(const PWScore &core)
+{
+  st_MemoryStats stats;
+  core.GetMemoryStats(stats);
+
+  wcout << L"Memory usage (estimated) for " << core.GetCurFile()
+        << L", " << core.GetNumEntries() << L" entries" << endl;
+  wcout << L"Fields:" << endl;
+  std::map<int, st_MemoryUsage>::const_iterator iter;
+  for (iter = stats.fields.begin(); iter != stats.fields.end(); iter++) {
+    const stringT name =
+      CItemData::EngFieldName(static_cast<CItemData::FieldType>(iter->first));
+    PrintUsage(name.empty() ? L"(other)" : name.c_str(), iter->second);
+  }
+  PrintUsage(L"All fields", stats.Fields());
+  wcout << L"Subsystems:" << endl;
+  PrintUsage(L"Entries", stats.entries);
+  PrintUsage(L"Unknown fields", stats.unknownfields);
+  PrintUsage(L"Entry caches", stats.entrycaches);
+  PrintUsage(L"Display info", stats.displayinfo);
+  PrintUsage(L"Indices", stats.indices);
+  PrintUsage(L"Undo/Redo", stats.undo);
+  PrintUsage(L"Filters", stats.filters);
+  PrintUsage(L"Other", stats.other);
+  PrintUsage(L"User interface", stats.ui);
+  PrintUsage(L"Total", stats.Total());
+  wcout << L"Key derivation peak: " << stats.kdf_peak << L" bytes" << endl;
+}
+
+static void PrintMatches(PWScore &core, UUIDVector &matches)
+{
+  for (UUIDVectorIter iter = matches.begin(); iter != matches.end(); iter++) {
+    const CItemData &ci = core.Find(*iter)->second;
+    wcout << L"[" << ci.GetGroup() << L"] " << ci.GetTitle();
+    if (!ci.GetUser().empty())
+      wcout << L" (" << ci.GetUser() << L")";
+    wcout << endl;
+  }
+  wcout << matches.size() << (matches.size() == 1 ? L" match" : L" matches") << endl;
+}
+
+static void Search(PWScore &core, const StringX &text, bool bRanked)
+{
+  UUIDVector matches;
+  if (bRanked) {
+    // Best matches first, see PWSMatch::CFuzzyMatcher
+    const size_t MAX_RANKED = 50;
+    core.FindFuzzy(text, MAX_RANKED, matches);
+  } else {
+    // Same defaults as the GUI's search bar: all text fields, ignoring case
+    CItemData::FieldBits bsFields;
+    bsFields.set();
+    core.FindText(text, false, bsFields, matches);
+  }
+
+  PrintMatches(core, matches);
+}
+
+static void FindTarget(PWScore &core, const StringX &text)
+{
+  // Could be either: a window title won't have a host, and a URL's
+  // words can only help
+  const size_t MAX_TARGETS = 10;
+  UUIDVector matches;
+  core.FindTargets(text, text, MAX_TARGETS, matches);
+  PrintMatches(core, matches);
+}
+
 static int
 ImportText(PWScore &core, const StringX &fname)
 {
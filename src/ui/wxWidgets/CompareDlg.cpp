@@ -36,6 +36,7 @@
 #include <wx/grid.h>
 #include <wx/ptr_scpd.h>
 #include <wx/filename.h>
+#include <wx/progdlg.h>
 
 #ifdef __WXMSW__
 #include <wx/msw/msvcrt.h>
@@ -316,6 +317,10 @@ void CompareDlg::OnCompare(wxCommandEvent& )
 void CompareDlg::DoCompare(wxCommandEvent& /*evt*/)
 {
   bool treatWhitespacesAsEmpty = false;
+  bool bCancel = false;
+  wxProgressDialog progress(_("Compare"), _("Comparing safes..."), 100, this,
+                            wxPD_APP_MODAL | wxPD_AUTO_HIDE | wxPD_CAN_ABORT |
+                            wxPD_ELAPSED_TIME);
   m_currentCore->Compare(m_otherCore,
                          m_selCriteria->GetSelectedFields(),
                          m_selCriteria->HasSubgroupRestriction(),
@@ -326,7 +331,20 @@ void CompareDlg::DoCompare(wxCommandEvent& /*evt*/)
                          m_current->data,
                          m_comparison->data,
                          m_conflicts->data,
-                         m_identical->data);
+                         m_identical->data,
+                         &bCancel,
+                         [&progress, &bCancel](size_t done, size_t total) {
+                           const int percent = total == 0 ? 100 : int(done * 100 / total);
+                           if (!progress.Update(percent))
+                             bCancel = true;
+                         });
+  if (bCancel) {
+    m_current->data.clear();
+    m_comparison->data.clear();
+    m_conflicts->data.clear();
+    m_identical->data.clear();
+    return;
+  }
 
   struct {
     ComparisonData* cd;
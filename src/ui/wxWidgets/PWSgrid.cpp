@@ -443,6 +443,14 @@ void PWSGrid::OnChar( wxKeyEvent& evt )
 }
 
 
+void PWSGrid::GetMemoryUsage(st_MemoryUsage &usage) const
+{
+  usage.Add(m_row_map.size() * (MAP_NODE_OVERHEAD + sizeof(RowUUIDMapT::value_type)),
+            m_row_map.size());
+  usage.Add(m_uuid_map.size() * (MAP_NODE_OVERHEAD + sizeof(UUIDRowMapT::value_type)),
+            m_uuid_map.size());
+}
+
 void PWSGrid::SaveSettings(void) const
 {
   PWSGridTable* table = dynamic_cast<PWSGridTable*>(GetTable());
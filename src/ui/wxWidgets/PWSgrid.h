@@ -127,6 +127,9 @@ public:
 
   void SaveSettings(void) const;
 
+  // Memory held by the row <-> uuid maps, for PWScore::GetMemoryStats
+  void GetMemoryUsage(st_MemoryUsage &usage) const;
+
 ////@begin PWSGrid member variables
 ////@end PWSGrid member variables
 
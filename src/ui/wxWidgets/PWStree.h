@@ -117,6 +117,11 @@ public:
   wxString GetItemGroup(const wxTreeItemId& item) const;
   bool ItemIsGroup(const wxTreeItemId& item) const ;
   void AddEmptyGroup(const StringX& group) { AddGroup(group); }
+  // Memory held by the uuid -> item map, for PWScore::GetMemoryStats.
+  // The native tree control's own storage isn't included.
+  void GetMemoryUsage(st_MemoryUsage &usage) const
+  {usage.Add(m_item_map.size() * (MAP_NODE_OVERHEAD + sizeof(UUIDTIMapT::value_type)),
+             m_item_map.size());}
 
  private:
   //overriden from base for case-insensitive sort
@@ -14,6 +14,7 @@
 #include "../../core/PwsPlatform.h"
 #include "../../core/PWHistory.h"
 #include "../../core/Util.h"
+#include "../../core/ParallelScan.h"
 #include "passwordsafeframe.h"
 #include "wxutils.h"
 #include "AdvancedSelectionDlg.h"
@@ -49,6 +50,7 @@
 #endif
 
 enum { FIND_MENU_POSITION = 4 } ;
+enum { MAX_BEST_MATCHES = 50 } ;
 
 ////////////////////////////////////////////////////////////////////////////
 // PasswordSafeSerach implementation
@@ -122,8 +124,12 @@ void PasswordSafeSearch::OnDoSearchT(Iter begin, Iter end, Accessor afn)
   if (m_criteria->IsDirty() || IsModified() || m_searchPointer.IsEmpty())  {
       m_searchPointer.Clear();
 
-      if (!m_toolbar->GetToolState(ID_FIND_ADVANCED_OPTIONS))
+      if (!m_toolbar->GetToolState(ID_FIND_ADVANCED_OPTIONS)) {
         FindMatches(tostringx(searchText), m_toolbar->GetToolState(ID_FIND_IGNORE_CASE), m_searchPointer, begin, end, afn);
+        // Nothing has the text as typed: go through the closest matches, best first
+        if (m_searchPointer.IsEmpty())
+          FindBestMatches(tostringx(searchText), m_searchPointer, begin, end, afn);
+      }
       else
         FindMatches(tostringx(searchText), m_toolbar->GetToolState(ID_FIND_IGNORE_CASE), m_searchPointer,
                       m_criteria->GetSelectedFields(), m_criteria->HasSubgroupRestriction(), m_criteria->SubgroupSearchText(),
@@ -474,17 +480,6 @@ void PasswordSafeSearch::FindMatches(const StringX& searchText, bool fCaseSensit
   return FindMatches(searchText, fCaseSensitive, searchPtr, bsFields, false, wxEmptyString, CItemData::END, PWSMatch::MR_INVALID, false, begin, end, afn);
 }
 
-bool FindNoCase( const StringX& src, const StringX& dest)
-{
-    StringX srcLower = src;
-    ToLower(srcLower);
-
-    StringX destLower = dest;
-    ToLower(destLower);
-
-    return destLower.find(srcLower) != StringX::npos;
-}
-
 template <class Iter, class Accessor>
 void PasswordSafeSearch::FindMatches(const StringX& searchText, bool fCaseSensitive, SearchPointer& searchPtr,
                                        const CItemData::FieldBits& bsFields, bool fUseSubgroups, const wxString& subgroupText,
@@ -496,63 +491,108 @@ void PasswordSafeSearch::FindMatches(const StringX& searchText, bool fCaseSensit
 
   searchPtr.Clear();
 
-  typedef StringX (CItemData::*ItemDataFuncT)() const;
-
-  struct {
-      CItemData::FieldType type;
-      ItemDataFuncT        func;
-  } ItemDataFields[] = {  {CItemData::GROUP,     &CItemData::GetGroup},
-                          {CItemData::TITLE,     &CItemData::GetTitle},
-                          {CItemData::USER,      &CItemData::GetUser},
-                          {CItemData::PASSWORD,  &CItemData::GetPassword},
-//                        {CItemData::NOTES,     &CItemData::GetNotes},
-                          {CItemData::URL,       &CItemData::GetURL},
-                          {CItemData::EMAIL,     &CItemData::GetEmail},
-                          {CItemData::RUNCMD,    &CItemData::GetRunCommand},
-                          {CItemData::AUTOTYPE,  &CItemData::GetAutoType},
-                          {CItemData::XTIME_INT, &CItemData::GetXTimeInt},
-
-                      };
+  LastSearch search;
+  search.text = searchText;
+  search.fCaseSensitive = fCaseSensitive;
+  search.bsFields = bsFields;
+  search.fUseSubgroups = fUseSubgroups;
+  search.subgroupText = subgroupText;
+  search.subgroupObject = subgroupObject;
+  search.subgroupFunction = subgroupFunction;
+  search.subgroupFunctionCaseSensitive = subgroupFunctionCaseSensitive;
+  search.nModifications = m_parentFrame->GetModificationCount();
+
+  // If the search text just extends the last search's (e.g., while it's being
+  // typed), with the same options, only the last search's matches can match.
+  // Otherwise let the core's search index rule out most entries up front, if
+  // it can. Either way, matches are still reported in display order, hence
+  // the set lookup. The index doesn't hold passwords, so if those are
+  // searched, entries that aren't candidates are still checked for them.
+  UUIDVector vCandidates;
+  bool fUseCandidates;
+  CItemData::FieldBits bsUnindexed;
+  if (m_lastSearch.IsRefinedBy(search)) {
+    vCandidates = m_lastSearch.matches;
+    fUseCandidates = true;
+  } else {
+    fUseCandidates = m_parentFrame->GetSearchCandidates(searchText, vCandidates);
+    bsUnindexed = PWScore::GetUnindexedFields(bsFields);
+  }
+  m_lastSearch = search;
+  if (fUseCandidates && vCandidates.empty() && bsUnindexed.none()) {
+    m_lastSearch.fValid = true;
+    return;
+  }
+  const UUIDSet candidates(vCandidates.begin(), vCandidates.end());
 
+  std::vector<const CItemData *> items;
+  std::vector<const CItemData::FieldBits *> itemFields; // to check for each
   for ( Iter itr = begin; itr != end; ++itr) {
-
-    const int fn = (subgroupFunctionCaseSensitive? -subgroupFunction: subgroupFunction);
-    if (fUseSubgroups && !afn(itr).Matches(stringT(subgroupText.c_str()), subgroupObject, fn))
-        continue;
-
-    bool found = false;
-    for (size_t idx = 0; idx < NumberOf(ItemDataFields) && !found; ++idx) {
-      if (bsFields.test(ItemDataFields[idx].type)) {
-          const StringX str = (afn(itr).*ItemDataFields[idx].func)();
-          found = fCaseSensitive? str.find(searchText) != StringX::npos: FindNoCase(searchText, str);
-      }
+    const CItemData &item = afn(itr);
+    const bool fCandidate = !fUseCandidates ||
+      candidates.find(item.GetUUID()) != candidates.end();
+    if (fCandidate || bsUnindexed.any()) {
+        items.push_back(&item);
+        itemFields.push_back(fCandidate ? &bsFields : &bsUnindexed);
     }
+  }
 
-    if (!found && bsFields.test(CItemData::NOTES)) {
-        StringX str = afn(itr).GetNotes();
-        found = fCaseSensitive? str.find(searchText) != StringX::npos: FindNoCase(searchText, str);
+  // Items are checked in parallel, and each chunk's matches are added in order
+  const PWSMatch::CFinder finder(searchText, fCaseSensitive);
+  const int fn = (subgroupFunctionCaseSensitive? -subgroupFunction: subgroupFunction);
+  const PWSMatch::CCompiledMatch subgroup = fUseSubgroups ?
+    PWSMatch::CCompiledMatch(tostringx(subgroupText), fn) : PWSMatch::CCompiledMatch();
+  std::vector<std::vector<const CItemData *> > matches;
+  CParallelScan().Scan(items.size(), matches,
+                       [&](size_t i, std::vector<const CItemData *> &found) {
+                         const CItemData &item = *items[i];
+                         if ((!fUseSubgroups || item.Matches(subgroup, subgroupObject)) &&
+                             item.ContainsText(finder, *itemFields[i]))
+                           found.push_back(&item);
+                         return true;
+                       });
+
+  for (size_t ichunk = 0; ichunk < matches.size(); ichunk++) {
+    for (size_t i = 0; i < matches[ichunk].size(); i++) {
+        const pws_os::CUUID uuid = matches[ichunk][i]->GetUUID();
+        searchPtr.Add(uuid);
+        m_lastSearch.matches.push_back(uuid);
     }
+  }
+  m_lastSearch.fValid = true;
+}
 
-    if (!found && bsFields.test(CItemData::PWHIST)) {
-        size_t pwh_max, err_num;
-        PWHistList pwhistlist;
-        CreatePWHistoryList(afn(itr).GetPWHistory(), pwh_max, err_num,
-                            pwhistlist, PWSUtil::TMC_XML);
-        for (PWHistList::iterator iter = pwhistlist.begin(); iter != pwhistlist.end(); iter++) {
-          PWHistEntry pwshe = *iter;
-          found = fCaseSensitive? pwshe.password.find(searchText) != StringX::npos: FindNoCase(searchText, pwshe.password );
-          if (found)
-            break;  // break out of for loop
-        }
-        pwhistlist.clear();
-    }
+template <class Iter, class Accessor>
+void PasswordSafeSearch::FindBestMatches(const StringX& searchText, SearchPointer& searchPtr, Iter begin, Iter end, Accessor afn)
+{
+  // Only what the view shows, as for FindMatches()
+  std::vector<const CItemData *> items;
+  for ( Iter itr = begin; itr != end; ++itr)
+    items.push_back(&afn(itr));
+
+  UUIDVector matches;
+  m_parentFrame->FindBestMatches(items, searchText, MAX_BEST_MATCHES, matches);
+  for (UUIDVectorIter iter = matches.begin(); iter != matches.end(); ++iter)
+    searchPtr.Add(*iter);
+}
 
-    if (found) {
-        uuid_array_t uuid;
-        afn(itr).GetUUID(uuid);
-        searchPtr.Add(pws_os::CUUID(uuid));
-    }
-  }
+/////////////////////////////////////////////////
+// PasswordSafeSearch::LastSearch definition
+bool PasswordSafeSearch::LastSearch::IsRefinedBy(const LastSearch& search) const
+{
+  if (!fValid || nModifications != search.nModifications ||
+      fCaseSensitive != search.fCaseSensitive || bsFields != search.bsFields ||
+      fUseSubgroups != search.fUseSubgroups)
+    return false;
+
+  if (fUseSubgroups &&
+      (subgroupText != search.subgroupText || subgroupObject != search.subgroupObject ||
+       subgroupFunction != search.subgroupFunction ||
+       subgroupFunctionCaseSensitive != search.subgroupFunctionCaseSensitive))
+    return false;
+
+  // Any field containing the new text contains the old
+  return PWSMatch::CFinder(text, fCaseSensitive).FoundIn(search.text);
 }
 
 /////////////////////////////////////////////////
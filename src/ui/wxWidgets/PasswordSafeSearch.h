@@ -140,7 +140,7 @@ public:
 
   void Activate(void);
   void RefreshButtons(void);
-  void Invalidate(void) { m_searchPointer.Clear(); }
+  void Invalidate(void) { m_searchPointer.Clear(); m_lastSearch.Clear(); }
   void ReCreateSearchBar(void);
 
 private:
@@ -153,6 +153,9 @@ private:
                      CItemData::FieldType subgroupObject, PWSMatch::MatchRule subgroupFunction,
                      bool subgroupFunctionCaseSensitive, Iter begin, Iter end, Accessor afn);
 
+  template <class Iter, class Accessor>
+  void FindBestMatches(const StringX& searchText, SearchPointer& searchPtr, Iter begin, Iter end, Accessor afn);
+
   void CreateSearchBar(void);
   void HideSearchToolbar();
   void ClearToolbarStatusArea();
@@ -163,11 +166,39 @@ private:
   template <class Iter, class Accessor>
   void OnDoSearchT( Iter begin, Iter end, Accessor afn);
 
+  /*!
+   * The last search's text, options and matches (in no particular order).
+   * All the database's entries are searched, so this stays valid until the
+   * database is modified, however that's done, hence nModifications, the
+   * core's modification count when it was made.
+   */
+  struct LastSearch {
+    bool fValid;
+    StringX text;
+    bool fCaseSensitive;
+    CItemData::FieldBits bsFields;
+    bool fUseSubgroups;
+    wxString subgroupText;
+    CItemData::FieldType subgroupObject;
+    PWSMatch::MatchRule subgroupFunction;
+    bool subgroupFunctionCaseSensitive;
+    UUIDVector matches;
+    size_t nModifications;
+
+    LastSearch() : fValid(false), fCaseSensitive(false), fUseSubgroups(false),
+                   subgroupObject(CItemData::END), subgroupFunction(PWSMatch::MR_INVALID),
+                   subgroupFunctionCaseSensitive(false), nModifications(0) {}
+    void Clear() { fValid = false; matches.clear(); }
+    // True if search's matches are all among ours
+    bool IsRefinedBy(const LastSearch& search) const;
+  };
+
   wxToolBar*           m_toolbar;
   PasswordSafeFrame*   m_parentFrame;
   SelectionCriteria*    m_criteria;
   SearchPointer        m_searchPointer;
   bool                 m_modified;
+  LastSearch           m_lastSearch;
 };
 
 #endif
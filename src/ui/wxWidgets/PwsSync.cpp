@@ -657,7 +657,7 @@ void SyncStatusPage::Synchronize(PWScore* currentCore, const PWScore *otherCore)
                                             UpdateGUICommand::GUI_UNDO_MERGESYNC);
   pmulticmds->Add(pcmd1);
   const SelectionCriteria& criteria = m_syncData->selCriteria;
-  const stringT subgroup_name = tostdstring(criteria.SubgroupSearchText());
+  const PWSMatch::CCompiledMatch subgroup = criteria.GetSubgroupMatch();
 
   wxGauge* gauge = wxDynamicCast(FindWindow(ID_GAUGE), wxGauge);
   gauge->SetRange(int(otherCore->GetNumEntries()));
@@ -688,7 +688,7 @@ void SyncStatusPage::Synchronize(PWScore* currentCore, const PWScore *otherCore)
     SetProgressText((wxString() << currentIndex << wxT(": ")) + towxstring(sx_updated));
     wxSafeYield();
 
-    if (criteria.HasSubgroupRestriction() && !otherItem.Matches(subgroup_name, criteria.SubgroupObject(), criteria.SubgroupFunctionWithCase()))
+    if (!criteria.MatchesSubgroupText(otherItem, subgroup))
       continue;
 
     ItemListConstIter foundPos = currentCore->Find(otherGroup, otherTitle, otherUser);
@@ -44,7 +44,11 @@ struct _subgroupFunctions {
                                                   {_("ends with"),           PWSMatch::MR_ENDS},
                                                   {_("does not end with"),   PWSMatch::MR_NOTEND},
                                                   {_("contains"),            PWSMatch::MR_CONTAINS},
-                                                  {_("does not contain"),    PWSMatch::MR_NOTCONTAIN} } ;
+                                                  {_("does not contain"),    PWSMatch::MR_NOTCONTAIN},
+                                                  {_("matches regex"),       PWSMatch::MR_REGEX},
+                                                  {_("does not match regex"), PWSMatch::MR_NOTREGEX},
+                                                  {_("matches wildcards"),   PWSMatch::MR_GLOB},
+                                                  {_("does not match wildcards"), PWSMatch::MR_NOTGLOB} } ;
 
 CItemData::FieldType selectableFields[] = { CItemData::GROUP,
                                             CItemData::TITLE,
@@ -68,9 +68,14 @@ public:
   size_t TotalFieldsCount() const                 { return m_bsFields.size(); }
   bool IsFieldSelected(CItemData::FieldType ft) const { return m_bsFields.test(ft); }
 
-  bool MatchesSubgroupText(const CItemData& item) const {
-    //could be very inefficient in a loop across the entire DB
-    return !m_fUseSubgroups || item.Matches(tostdstring(m_subgroupText), SubgroupObject(), SubgroupFunction());
+  // The subgroup restriction, compiled once for all the items it's tested on
+  PWSMatch::CCompiledMatch GetSubgroupMatch() const {
+    return m_fUseSubgroups ?
+      PWSMatch::CCompiledMatch(tostringx(m_subgroupText), SubgroupFunctionWithCase()) :
+      PWSMatch::CCompiledMatch();
+  }
+  bool MatchesSubgroupText(const CItemData& item, const PWSMatch::CCompiledMatch& subgroup) const {
+    return !m_fUseSubgroups || item.Matches(subgroup, SubgroupObject());
   }
   
   wxString GetGroupSelectionDescription() const;
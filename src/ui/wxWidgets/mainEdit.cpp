@@ -133,7 +133,15 @@ void PasswordSafeFrame::OnDeleteClick( wxCommandEvent& /* evt */ )
   // If tree view, check if group selected
   if (m_tree->IsShown()) {
     wxTreeItemId sel = m_tree->GetSelection();
-    num_children = static_cast<int>(m_tree->GetChildrenCount(sel));
+    if (sel.IsOk() && sel != m_tree->GetRootItem() && m_tree->ItemIsGroup(sel)) {
+      // What's in the group, from the core's group index
+      const StringX sxGroup = tostringx(m_tree->GetItemGroup(sel));
+      std::vector<StringX> vEmptyGroups;
+      m_core.GetGroupEmptyGroups(sxGroup, vEmptyGroups);
+      num_children = static_cast<int>(m_core.GetNumGroupEntries(sxGroup) +
+                                      vEmptyGroups.size() -
+                                      (m_core.IsEmptyGroup(sxGroup) ? 1 : 0));
+    }
     if (num_children > 0) // ALWAYS confirm group delete
       dontaskquestion = false;
   }
@@ -177,40 +185,40 @@ Command *PasswordSafeFrame::Delete(CItemData *pci)
 Command *PasswordSafeFrame::Delete(wxTreeItemId tid)
 {
   // Called for deleting a group
-  // Recursively build the appropriate multi-command
+  // The group's entries and empty groups are taken from the core's group
+  // index, rather than by walking the tree
 
   if (!tid) return NULL;
   MultiCommands *retval = MultiCommands::Create(&m_core);
-  if (m_tree->GetChildrenCount(tid) > 0) {
-    wxTreeItemIdValue cookie;
-    wxTreeItemId ti = m_tree->GetFirstChild(tid, cookie);
-
-    while (ti.IsOk()) {
-      Command *delCmd = Delete(ti);
-      if (delCmd != NULL)
-        retval->Add(delCmd);
-      ti = m_tree->GetNextChild(tid, cookie);
-    } // while children
-    // Explicitly delete any empty groups coinciding with this wxTreeItem's group hierarchy
-    // Otherwise the user will see a these empty groups still hanging around inspite
-    // of just deleting the parent/ancestor
-    StringX sxGroup = tostringx(m_tree->GetItemGroup(tid));
-    if (m_core.IsEmptyGroup(sxGroup)) {
-      Command *delGrp = DBEmptyGroupsCommand::Create(&m_core, sxGroup, DBEmptyGroupsCommand::EG_DELETE);
-      if (delGrp)
-        retval->Add(delGrp);
-    }
-  } else { // leaf
-    CItemData *leaf = m_tree->GetItem(tid);
-    if (leaf != NULL) {
-      Command *delLeafCmd = Delete(leaf); // gets user conf. if needed
-      if (delLeafCmd != NULL)
-        retval->Add(delLeafCmd);
+  CItemData *leaf = m_tree->GetItem(tid);
+  if (leaf != NULL) {
+    Command *delLeafCmd = Delete(leaf); // gets user conf. if needed
+    if (delLeafCmd != NULL)
+      retval->Add(delLeafCmd);
+  } else {
+    wxASSERT_MSG(m_tree->ItemIsGroup(tid), wxT("Item without CItemData must be a group"));
+    const StringX sxGroup = tostringx(m_tree->GetItemGroup(tid));
+    UUIDVector vuuids;
+    m_core.GetGroupEntries(sxGroup, vuuids);
+    for (UUIDVectorIter uuid_iter = vuuids.begin(); uuid_iter != vuuids.end(); uuid_iter++) {
+      // Only those shown, as the tree may be filtered
+      if (!m_tree->Find(*uuid_iter).IsOk())
+        continue;
+      ItemListIter iter = m_core.Find(*uuid_iter);
+      if (iter != m_core.GetEntryEndIter()) {
+        Command *delCmd = Delete(&iter->second);
+        if (delCmd != NULL)
+          retval->Add(delCmd);
+      }
     }
-    else {
-      wxASSERT_MSG(m_tree->ItemIsGroup(tid), wxT("Childless item without CItemData must be an empty group"));
-      StringX sxGroup = tostringx(m_tree->GetItemGroup(tid));
-      Command *delGrp = DBEmptyGroupsCommand::Create(&m_core, sxGroup, DBEmptyGroupsCommand::EG_DELETE);
+    // Explicitly delete the empty groups in this group's hierarchy (the group
+    // itself included). Otherwise the user will see these empty groups still
+    // hanging around in spite of just deleting the parent/ancestor
+    std::vector<StringX> vEmptyGroups;
+    m_core.GetGroupEmptyGroups(sxGroup, vEmptyGroups);
+    for (size_t i = 0; i < vEmptyGroups.size(); i++) {
+      Command *delGrp = DBEmptyGroupsCommand::Create(&m_core, vEmptyGroups[i],
+                                                     DBEmptyGroupsCommand::EG_DELETE);
       if (delGrp)
         retval->Add(delGrp);
     }
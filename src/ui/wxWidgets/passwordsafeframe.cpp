@@ -343,6 +343,7 @@ void PasswordSafeFrame::Init()
   bsSupportedFunctions.set(UIInterFace::GUISETUPDISPLAYINFO);
   bsSupportedFunctions.set(UIInterFace::GUIREFRESHENTRY);
   //bsSupportedFunctions.set(UIInterFace::UPDATEWIZARD);
+  bsSupportedFunctions.set(UIInterFace::GUIMEMORYUSAGE);
 
   m_core.SetUIInterFace(this, UIInterFace::NUM_SUPPORTED, bsSupportedFunctions);
 
@@ -2054,6 +2055,11 @@ bool PasswordSafeFrame::IsClosed() const
 
 void PasswordSafeFrame::DatabaseModified(bool modified)
 {
+  // Entries may have changed even if the database is now unmodified,
+  // e.g., after undoing all changes, so the last search's results can't be
+  // relied on in any case
+  if (m_search) m_search->Invalidate();
+
   if (!modified)
     return;
 
@@ -2067,7 +2073,6 @@ void PasswordSafeFrame::DatabaseModified(bool modified)
     if (m_grid) m_grid->GetEventHandler()->AddPendingEvent(evt);
   }
   else if (m_core.IsChanged()) {  //"else if" => both DB and it's prefs can't change at the same time
-    if (m_search) m_search->Invalidate();
     if (m_currentView == TREE) {
       if (m_grid != NULL)
         m_grid->OnPasswordListModified();
@@ -2244,6 +2249,14 @@ void PasswordSafeFrame::UpdateWizard(const stringT &)
   // Stub
 }
 
+void PasswordSafeFrame::GUIMemoryUsage(st_MemoryUsage &usage) const
+{
+  if (m_grid != NULL)
+    m_grid->GetMemoryUsage(usage);
+  if (m_tree != NULL)
+    m_tree->GetMemoryUsage(usage);
+}
+
 /*!
  * wxEVT_COMMAND_MENU_SELECTED event handler for wxID_NEW
  */
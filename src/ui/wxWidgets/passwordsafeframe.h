@@ -190,6 +190,8 @@ public:
 
     virtual void UpdateWizard(const stringT &s);
 
+    virtual void GUIMemoryUsage(st_MemoryUsage &usage) const;
+
   ////@begin PasswordSafeFrame event handler declarations
 
   /// wxEVT_CLOSE_WINDOW event handler for ID_PASSWORDSAFEFRAME
@@ -403,6 +405,13 @@ public:
 
   ItemListConstIter GetEntryIter() const {return m_core.GetEntryIter();}
   ItemListConstIter GetEntryEndIter() const {return m_core.GetEntryEndIter();}
+  bool GetSearchCandidates(const StringX &sxText, UUIDVector &candidates)
+  {return m_core.GetSearchCandidates(sxText, candidates);}
+  size_t GetModificationCount() const {return m_core.GetModificationCount();}
+  // Ranked search of vpci's entries, best first, see PWScore::FindFuzzy
+  void FindBestMatches(const std::vector<const CItemData *> &vpci, const StringX &sxText,
+                       size_t maxResults, UUIDVector &matches) const
+  {UUIDList rue; m_RUEList.GetRUEList(rue); m_core.FindFuzzy(vpci, sxText, maxResults, matches, &rue);}
 
   void Execute(Command *pcmd, PWScore *pcore = NULL);
 
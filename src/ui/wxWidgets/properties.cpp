@@ -170,6 +170,15 @@ void CProperties::Init()
   } else {
     m_unknownfields = _("None");
   }
+
+  st_MemoryStats stats;
+  m_core.GetMemoryStats(stats);
+  const st_MemoryUsage total = stats.Total();
+  m_memoryused = wxString::Format(_("%lu KiB in %lu allocations"),
+                                  static_cast<unsigned long>((total.bytes + 1023) >> 10),
+                                  static_cast<unsigned long>(total.allocations));
+  m_kdfpeak = wxString::Format(_("%lu KiB"),
+                               static_cast<unsigned long>(stats.kdf_peak >> 10));
 }
 
 
@@ -218,6 +227,12 @@ void CProperties::CreateControls()
   wxStaticText* itemStaticText14 = new wxStaticText( currDialog, wxID_STATIC, _("Unknown fields:"), wxDefaultPosition, wxDefaultSize, 0 );
   staticVertSizer->Add(itemStaticText14, 0, wxALIGN_LEFT|wxALL, 5);
 
+  wxStaticText* itemStaticText15 = new wxStaticText( currDialog, wxID_STATIC, _("Memory in use:"), wxDefaultPosition, wxDefaultSize, 0 );
+  staticVertSizer->Add(itemStaticText15, 0, wxALIGN_LEFT|wxALL, 5);
+
+  wxStaticText* itemStaticText16 = new wxStaticText( currDialog, wxID_STATIC, _("Key derivation peak:"), wxDefaultPosition, wxDefaultSize, 0 );
+  staticVertSizer->Add(itemStaticText16, 0, wxALIGN_LEFT|wxALL, 5);
+
   wxBoxSizer* dataVertSizer = new wxBoxSizer(wxVERTICAL);
   horizSizer->Add(dataVertSizer, 0, wxALIGN_CENTER_VERTICAL|wxALL, 5);
 
@@ -247,6 +262,12 @@ void CProperties::CreateControls()
   wxStaticText* unknownFieldsText = new wxStaticText( currDialog, wxID_UNKNOWFIELDS, wxT("x"), wxDefaultPosition, wxDefaultSize, 0 );
   dataVertSizer->Add(unknownFieldsText, 0, wxALIGN_LEFT|wxALL, 5);
 
+  wxStaticText* memoryUsedText = new wxStaticText( currDialog, wxID_MEMORYUSED, wxT("99999 KiB in 99999 allocations"), wxDefaultPosition, wxDefaultSize, 0 );
+  dataVertSizer->Add(memoryUsedText, 0, wxALIGN_LEFT|wxALL, 5);
+
+  wxStaticText* kdfPeakText = new wxStaticText( currDialog, wxID_KDFPEAK, wxT("999999 KiB"), wxDefaultPosition, wxDefaultSize, 0 );
+  dataVertSizer->Add(kdfPeakText, 0, wxALIGN_LEFT|wxALL, 5);
+
   wxStdDialogButtonSizer* buttonsSizer = new wxStdDialogButtonSizer;
 
   mainSizer->Add(buttonsSizer, 0, wxALIGN_CENTER_HORIZONTAL|wxALL, 5);
@@ -265,6 +286,8 @@ void CProperties::CreateControls()
   lastSavedAppText->SetValidator( wxGenericValidator(& m_whatlastsaved) );
   uuidText->SetValidator( wxGenericValidator(& m_file_uuid) );
   unknownFieldsText->SetValidator( wxGenericValidator(& m_unknownfields) );
+  memoryUsedText->SetValidator( wxGenericValidator(& m_memoryused) );
+  kdfPeakText->SetValidator( wxGenericValidator(& m_kdfpeak) );
 
 ////@end CProperties content construction
 }
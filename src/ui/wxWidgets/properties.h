@@ -44,6 +44,8 @@
 #define wxID_WHATLASTSAVED 10071
 #define wxID_FILEUUID 10072
 #define wxID_UNKNOWFIELDS 10073
+#define wxID_MEMORYUSED 10074
+#define wxID_KDFPEAK 10075
 #if WXWIN_COMPATIBILITY_2_6
 #define SYMBOL_CPROPERTIES_STYLE wxCAPTION|wxRESIZE_BORDER|wxSYSTEM_MENU|wxCLOSE_BOX|wxDIALOG_MODAL|wxTAB_TRAVERSAL
 #else
@@ -122,6 +124,12 @@ public:
   wxString GetUnknownfields() const { return m_unknownfields ; }
   void SetUnknownfields(wxString value) { m_unknownfields = value ; }
 
+  wxString GetMemoryused() const { return m_memoryused ; }
+  void SetMemoryused(wxString value) { m_memoryused = value ; }
+
+  wxString GetKdfpeak() const { return m_kdfpeak ; }
+  void SetKdfpeak(wxString value) { m_kdfpeak = value ; }
+
   /// Retrieves bitmap resources
   wxBitmap GetBitmapResource( const wxString& name );
 
@@ -144,6 +152,8 @@ private:
   wxString m_whatlastsaved;
   wxString m_file_uuid;
   wxString m_unknownfields;
+  wxString m_memoryused;
+  wxString m_kdfpeak;
 ////@end CProperties member variables
   const PWScore &m_core;
 };
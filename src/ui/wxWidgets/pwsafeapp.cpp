@@ -45,6 +45,7 @@ using namespace std;
 #include "wxMessages.h"
 #include "core/SysInfo.h"
 #include "core/PWSprefs.h"
+#include "core/ItemData.h"
 #include "core/PWSrand.h"
 #include "pwsclip.h"
 #include <wx/timer.h>
@@ -579,6 +580,8 @@ bool PwsafeApp::ActivateLanguage(wxLanguage language, bool tryOnly)
     // (re)set global translation and take care of occupied memory by wxTranslations
     wxTranslations::Set(translations);
     ActivateHelp(language);
+    // Entries' times were formatted for the previous locale
+    CItemData::ResetTimeFormatCache();
   }
   return bRes;
 }